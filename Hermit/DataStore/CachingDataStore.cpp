@@ -0,0 +1,698 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <cstdio>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include "Hermit/Foundation/Notification.h"
+#include "CachingDataStore.h"
+
+namespace hermit {
+	namespace datastore {
+		namespace CachingDataStore_Impl {
+			
+			//
+			const size_t kShardCount = 16;
+			
+			//	Charged to each entry on top of its data, for the key and bookkeeping.
+			const uint64_t kEntryOverhead = 128;
+			
+			//
+			typedef std::shared_ptr<const std::string> ConstStringPtr;
+			
+			//	FNV-1a.
+			uint64_t HashKey(const std::string& key) {
+				uint64_t hash = 0xcbf29ce484222325ULL;
+				for (auto c : key) {
+					hash ^= (uint8_t)c;
+					hash *= 0x100000001b3ULL;
+				}
+				return hash;
+			}
+			
+			//
+			struct Waiter {
+				//
+				Waiter(const LoadDataStoreDataDataBlockPtr& dataBlock, const LoadDataStoreDataCompletionBlockPtr& completion) :
+				mDataBlock(dataBlock),
+				mCompletion(completion) {
+				}
+				
+				//
+				LoadDataStoreDataDataBlockPtr mDataBlock;
+				LoadDataStoreDataCompletionBlockPtr mCompletion;
+			};
+			typedef std::vector<Waiter> WaiterVector;
+			
+			//
+			struct CachedEntry {
+				//
+				std::string mKey;
+				EncryptionSetting mEncryptionSetting;
+				ConstStringPtr mData;
+				uint64_t mCharge;
+			};
+			typedef std::list<CachedEntry> CachedEntryList;
+			
+			//	A disk tier record carries the key and encryption setting along with the
+			//	data, since its name is only a hash of the key:
+			//	[setting:1][key length:4, little-endian][key][data]
+			void EncodeDiskTierRecord(const std::string& key,
+									  const EncryptionSetting& encryptionSetting,
+									  const std::string& data,
+									  std::string& outRecord) {
+				uint32_t keyLength = (uint32_t)key.size();
+				outRecord.clear();
+				outRecord.reserve(5 + key.size() + data.size());
+				outRecord.push_back((char)encryptionSetting);
+				for (int i = 0; i < 4; ++i) {
+					outRecord.push_back((char)((keyLength >> (8 * i)) & 0xff));
+				}
+				outRecord.append(key);
+				outRecord.append(data);
+			}
+			
+			//
+			bool DecodeDiskTierRecord(const std::string& record,
+									  const std::string& key,
+									  const EncryptionSetting& encryptionSetting,
+									  ConstStringPtr& outData) {
+				if (record.size() < 5) {
+					return false;
+				}
+				if (record[0] != (char)encryptionSetting) {
+					return false;
+				}
+				uint32_t keyLength = 0;
+				for (int i = 0; i < 4; ++i) {
+					keyLength |= ((uint32_t)(uint8_t)record[1 + i]) << (8 * i);
+				}
+				if ((keyLength != key.size()) || (record.size() < 5 + (size_t)keyLength)) {
+					return false;
+				}
+				if (record.compare(5, keyLength, key) != 0) {
+					return false;
+				}
+				outData = std::make_shared<const std::string>(record, 5 + keyLength);
+				return true;
+			}
+			
+			//
+			class DiskTierWriteCompletion : public WriteDataStoreDataCompletionFunction {
+			public:
+				//
+				virtual void Call(const HermitPtr& h_, const WriteDataStoreDataResult& result) override {
+					if ((result != WriteDataStoreDataResult::kSuccess) && (result != WriteDataStoreDataResult::kCanceled)) {
+						NOTIFY_ERROR(h_, "CachingDataStore: disk tier WriteData failed, result:", (int)result);
+					}
+				}
+			};
+			
+			//
+			class DiskTierDeleteCompletion : public DeleteDataStoreItemCompletion {
+			public:
+				//
+				virtual void Call(const HermitPtr& h_, const DeleteDataStoreItemResult& result) override {
+				}
+			};
+			
+		} // namespace CachingDataStore_Impl
+		using namespace CachingDataStore_Impl;
+		
+		//	mDiskTierMutex orders the disk tier writes of completed loads against the disk
+		//	tier deletes of invalidations, so a stale copy can't land after the delete.
+		//	It's taken before mMutex, never after.
+		struct CachingDataStoreShard {
+			//
+			CachingDataStoreShard() : mBytes(0) {
+			}
+			
+			//
+			std::mutex mMutex;
+			CachedEntryList mEntries;
+			std::unordered_map<std::string, CachedEntryList::iterator> mIndex;
+			std::unordered_map<std::string, std::shared_ptr<CachingDataStoreLoad>> mLoads;
+			uint64_t mBytes;
+			std::mutex mDiskTierMutex;
+		};
+		
+		//	One load of an item on behalf of every caller waiting on it: the disk tier
+		//	first, if there is one, then the wrapped store.
+		class CachingDataStoreLoad : public std::enable_shared_from_this<CachingDataStoreLoad> {
+		public:
+			//
+			CachingDataStoreLoad(const CachingDataStorePtr& store,
+								 const DataPathPtr& path,
+								 const std::string& key,
+								 const EncryptionSetting& encryptionSetting,
+								 bool cacheable) :
+			mStore(store),
+			mPath(path),
+			mKey(key),
+			mEncryptionSetting(encryptionSetting),
+			mCacheable(cacheable),
+			mInvalidated(false) {
+			}
+			
+			//
+			void Start(const HermitPtr& h_) {
+				if (mStore->mOptions.mDiskTier == nullptr) {
+					LoadFromDataStore(h_);
+					return;
+				}
+				DataPathPtr diskTierPath;
+				if (!mStore->GetDiskTierPath(h_, mKey, diskTierPath)) {
+					LoadFromDataStore(h_);
+					return;
+				}
+				auto data = std::make_shared<LoadDataStoreDataData>();
+				auto completion = std::make_shared<DiskTierLoadCompletion>(shared_from_this(), data);
+				mStore->mOptions.mDiskTier->LoadData(h_, diskTierPath, mStore->mOptions.mDiskTierEncryptionSetting, data, completion);
+			}
+			
+			//
+			void DiskTierLoaded(const HermitPtr& h_, const LoadDataStoreDataResult& result, const std::string& record) {
+				if (result == LoadDataStoreDataResult::kCanceled) {
+					mStore->CompleteLoad(h_, shared_from_this(), result, nullptr, false);
+					return;
+				}
+				ConstStringPtr data;
+				if ((result == LoadDataStoreDataResult::kSuccess) &&
+					DecodeDiskTierRecord(record, mKey, mEncryptionSetting, data)) {
+					mStore->mDiskHits++;
+					mStore->CompleteLoad(h_, shared_from_this(), result, data, false);
+					return;
+				}
+				LoadFromDataStore(h_);
+			}
+			
+			//
+			void LoadFromDataStore(const HermitPtr& h_) {
+				mStore->mMisses++;
+				auto data = std::make_shared<LoadDataStoreDataData>();
+				auto completion = std::make_shared<DataStoreLoadCompletion>(shared_from_this(), data);
+				mStore->mDataStore->LoadData(h_, mPath, mEncryptionSetting, data, completion);
+			}
+			
+			//
+			void DataStoreLoaded(const HermitPtr& h_, const LoadDataStoreDataResult& result, std::string& data) {
+				ConstStringPtr loaded;
+				if (result == LoadDataStoreDataResult::kSuccess) {
+					mStore->mBytesLoaded += data.size();
+					loaded = std::make_shared<const std::string>(std::move(data));
+				}
+				mStore->CompleteLoad(h_, shared_from_this(), result, loaded, true);
+			}
+			
+			//
+			class DiskTierLoadCompletion : public LoadDataStoreDataCompletionBlock {
+			public:
+				//
+				DiskTierLoadCompletion(const std::shared_ptr<CachingDataStoreLoad>& load, const LoadDataStoreDataDataPtr& data) :
+				mLoad(load),
+				mData(data) {
+				}
+				
+				//
+				virtual void Call(const HermitPtr& h_, const LoadDataStoreDataResult& result) override {
+					mLoad->DiskTierLoaded(h_, result, mData->mData);
+				}
+				
+				//
+				std::shared_ptr<CachingDataStoreLoad> mLoad;
+				LoadDataStoreDataDataPtr mData;
+			};
+			
+			//
+			class DataStoreLoadCompletion : public LoadDataStoreDataCompletionBlock {
+			public:
+				//
+				DataStoreLoadCompletion(const std::shared_ptr<CachingDataStoreLoad>& load, const LoadDataStoreDataDataPtr& data) :
+				mLoad(load),
+				mData(data) {
+				}
+				
+				//
+				virtual void Call(const HermitPtr& h_, const LoadDataStoreDataResult& result) override {
+					mLoad->DataStoreLoaded(h_, result, mData->mData);
+				}
+				
+				//
+				std::shared_ptr<CachingDataStoreLoad> mLoad;
+				LoadDataStoreDataDataPtr mData;
+			};
+			
+			//
+			CachingDataStorePtr mStore;
+			DataPathPtr mPath;
+			std::string mKey;
+			EncryptionSetting mEncryptionSetting;
+			bool mCacheable;
+			
+			//	Guarded by the shard's mMutex.
+			bool mInvalidated;
+			WaiterVector mWaiters;
+		};
+		typedef std::shared_ptr<CachingDataStoreLoad> CachingDataStoreLoadPtr;
+		
+		namespace CachingDataStore_Impl {
+			
+			//	Must be called with the shard's mMutex held.
+			void RemoveEntry(CachingDataStoreShard& shard, CachedEntryList::iterator it) {
+				shard.mBytes -= it->mCharge;
+				shard.mIndex.erase(it->mKey);
+				shard.mEntries.erase(it);
+			}
+			
+			//	Must be called with the shard's mMutex held. Returns the number of entries evicted.
+			uint64_t InsertEntry(CachingDataStoreShard& shard,
+								 uint64_t shardBudget,
+								 const std::string& key,
+								 const EncryptionSetting& encryptionSetting,
+								 const ConstStringPtr& data) {
+				auto it = shard.mIndex.find(key);
+				if (it != shard.mIndex.end()) {
+					RemoveEntry(shard, it->second);
+				}
+				uint64_t charge = data->size() + key.size() + kEntryOverhead;
+				if (charge > shardBudget) {
+					return 0;
+				}
+				CachedEntry entry;
+				entry.mKey = key;
+				entry.mEncryptionSetting = encryptionSetting;
+				entry.mData = data;
+				entry.mCharge = charge;
+				shard.mEntries.push_front(std::move(entry));
+				shard.mIndex[key] = shard.mEntries.begin();
+				shard.mBytes += charge;
+				
+				uint64_t evictions = 0;
+				while (shard.mBytes > shardBudget) {
+					RemoveEntry(shard, std::prev(shard.mEntries.end()));
+					++evictions;
+				}
+				return evictions;
+			}
+			
+			//
+			void Deliver(const HermitPtr& h_,
+						 const WaiterVector& waiters,
+						 const LoadDataStoreDataResult& result,
+						 const ConstStringPtr& data) {
+				for (auto& waiter : waiters) {
+					if (result == LoadDataStoreDataResult::kSuccess) {
+						waiter.mDataBlock->Call(h_, DataBuffer(data->data(), data->size()));
+					}
+					waiter.mCompletion->Call(h_, result);
+				}
+			}
+			
+			//
+			class InvalidatingWriteCompletion : public WriteDataStoreDataCompletionFunction {
+			public:
+				//
+				InvalidatingWriteCompletion(const CachingDataStorePtr& store,
+											const DataPathPtr& path,
+											const WriteDataStoreDataCompletionFunctionPtr& completion) :
+				mStore(store),
+				mPath(path),
+				mCompletion(completion) {
+				}
+				
+				//
+				virtual void Call(const HermitPtr& h_, const WriteDataStoreDataResult& result) override {
+					mStore->Invalidate(h_, mPath);
+					mCompletion->Call(h_, result);
+				}
+				
+				//
+				CachingDataStorePtr mStore;
+				DataPathPtr mPath;
+				WriteDataStoreDataCompletionFunctionPtr mCompletion;
+			};
+			
+			//
+			class InvalidatingDeleteCompletion : public DeleteDataStoreItemCompletion {
+			public:
+				//
+				InvalidatingDeleteCompletion(const CachingDataStorePtr& store,
+											 const DataPathPtr& path,
+											 const DeleteDataStoreItemCompletionPtr& completion) :
+				mStore(store),
+				mPath(path),
+				mCompletion(completion) {
+				}
+				
+				//
+				virtual void Call(const HermitPtr& h_, const DeleteDataStoreItemResult& result) override {
+					mStore->Invalidate(h_, mPath);
+					mCompletion->Call(h_, result);
+				}
+				
+				//
+				CachingDataStorePtr mStore;
+				DataPathPtr mPath;
+				DeleteDataStoreItemCompletionPtr mCompletion;
+			};
+			
+			//
+			class InvalidatingWriteItemCallback : public WriteDataStoreItemsItemCallback {
+			public:
+				//
+				InvalidatingWriteItemCallback(const CachingDataStorePtr& store, const WriteDataStoreItemsItemCallbackPtr& itemCallback) :
+				mStore(store),
+				mItemCallback(itemCallback) {
+				}
+				
+				//
+				virtual void Call(const HermitPtr& h_, const DataPathPtr& path, const WriteDataStoreDataResult& result) override {
+					mStore->Invalidate(h_, path);
+					mItemCallback->Call(h_, path, result);
+				}
+				
+				//
+				CachingDataStorePtr mStore;
+				WriteDataStoreItemsItemCallbackPtr mItemCallback;
+			};
+			
+			//
+			class InvalidatingDeleteItemCallback : public DeleteDataStoreItemsItemCallback {
+			public:
+				//
+				InvalidatingDeleteItemCallback(const CachingDataStorePtr& store, const DeleteDataStoreItemsItemCallbackPtr& itemCallback) :
+				mStore(store),
+				mItemCallback(itemCallback) {
+				}
+				
+				//
+				virtual void Call(const HermitPtr& h_, const DataPathPtr& path, const DeleteDataStoreItemResult& result) override {
+					mStore->Invalidate(h_, path);
+					mItemCallback->Call(h_, path, result);
+				}
+				
+				//
+				CachingDataStorePtr mStore;
+				DeleteDataStoreItemsItemCallbackPtr mItemCallback;
+			};
+			
+		} // namespace CachingDataStore_Impl
+		
+		//
+		CachingDataStore::CachingDataStore(const DataStorePtr& dataStore, const CachingDataStoreOptions& options) :
+		mDataStore(dataStore),
+		mOptions(options),
+		mShardBudget(options.mMemoryBudget / kShardCount),
+		mMemoryHits(0),
+		mDiskHits(0),
+		mMisses(0),
+		mCoalescedLoads(0),
+		mEvictions(0),
+		mInvalidations(0),
+		mBytesLoaded(0) {
+			if (mOptions.mDiskTierRoot == nullptr) {
+				mOptions.mDiskTier = nullptr;
+			}
+			for (size_t i = 0; i < kShardCount; ++i) {
+				mShards.push_back(std::unique_ptr<CachingDataStoreShard>(new CachingDataStoreShard()));
+			}
+		}
+		
+		//
+		CachingDataStore::~CachingDataStore() {
+		}
+		
+		//
+		CachingDataStoreShard& CachingDataStore::ShardFor(const std::string& key) {
+			return *mShards[HashKey(key) % kShardCount];
+		}
+		
+		//
+		bool CachingDataStore::GetDiskTierPath(const HermitPtr& h_, const std::string& key, DataPathPtr& outPath) {
+			char name[17];
+			snprintf(name, sizeof(name), "%016llx", (unsigned long long)HashKey(key));
+			DataPathPtr directoryPath;
+			if (!mOptions.mDiskTierRoot->AppendPathComponent(h_, std::string(name, 2), directoryPath)) {
+				NOTIFY_ERROR(h_, "CachingDataStore: AppendPathComponent failed for disk tier directory.");
+				return false;
+			}
+			if (!directoryPath->AppendPathComponent(h_, name, outPath)) {
+				NOTIFY_ERROR(h_, "CachingDataStore: AppendPathComponent failed for disk tier item.");
+				return false;
+			}
+			return true;
+		}
+		
+		//
+		CachingDataStoreMetrics CachingDataStore::GetMetrics() {
+			CachingDataStoreMetrics metrics;
+			metrics.mMemoryHits = mMemoryHits;
+			metrics.mDiskHits = mDiskHits;
+			metrics.mMisses = mMisses;
+			metrics.mCoalescedLoads = mCoalescedLoads;
+			metrics.mEvictions = mEvictions;
+			metrics.mInvalidations = mInvalidations;
+			metrics.mBytesLoaded = mBytesLoaded;
+			for (auto& shard : mShards) {
+				std::lock_guard<std::mutex> lock(shard->mMutex);
+				metrics.mBytesInMemory += shard->mBytes;
+				metrics.mItemsInMemory += shard->mEntries.size();
+			}
+			return metrics;
+		}
+		
+		//
+		void CachingDataStore::Invalidate(const HermitPtr& h_, const DataPathPtr& path) {
+			std::string key;
+			path->GetStringRepresentation(h_, key);
+			InvalidateKey(h_, key);
+		}
+		
+		//
+		void CachingDataStore::InvalidateKey(const HermitPtr& h_, const std::string& key) {
+			auto& shard = ShardFor(key);
+			std::unique_lock<std::mutex> diskTierLock(shard.mDiskTierMutex, std::defer_lock);
+			if (mOptions.mDiskTier != nullptr) {
+				diskTierLock.lock();
+			}
+			{
+				std::lock_guard<std::mutex> lock(shard.mMutex);
+				auto it = shard.mIndex.find(key);
+				if (it != shard.mIndex.end()) {
+					RemoveEntry(shard, it->second);
+				}
+				// Callers already waiting on a load in flight still get its result, but it isn't
+				// kept, and loads that start from here on don't join it.
+				auto loadIt = shard.mLoads.find(key);
+				if (loadIt != shard.mLoads.end()) {
+					loadIt->second->mInvalidated = true;
+					shard.mLoads.erase(loadIt);
+				}
+			}
+			mInvalidations++;
+			
+			if (mOptions.mDiskTier != nullptr) {
+				DataPathPtr diskTierPath;
+				if (GetDiskTierPath(h_, key, diskTierPath)) {
+					mOptions.mDiskTier->DeleteItem(h_, diskTierPath, std::make_shared<DiskTierDeleteCompletion>());
+				}
+			}
+		}
+		
+		//
+		void CachingDataStore::CompleteLoad(const HermitPtr& h_,
+											const CachingDataStoreLoadPtr& load,
+											const LoadDataStoreDataResult& result,
+											const ConstStringPtr& data,
+											bool fromWrappedStore) {
+			auto& shard = ShardFor(load->mKey);
+			
+			// The disk tier lock is held from before the load leaves mLoads until its disk tier
+			// write has been issued. An invalidation either comes first, and finds the load to
+			// mark, or comes after, and its delete lands after the write.
+			bool writesDiskTier = fromWrappedStore && (mOptions.mDiskTier != nullptr);
+			std::unique_lock<std::mutex> diskTierLock(shard.mDiskTierMutex, std::defer_lock);
+			if (writesDiskTier) {
+				diskTierLock.lock();
+			}
+			
+			WaiterVector waiters;
+			bool keep = false;
+			{
+				std::lock_guard<std::mutex> lock(shard.mMutex);
+				auto it = shard.mLoads.find(load->mKey);
+				if ((it != shard.mLoads.end()) && (it->second == load)) {
+					shard.mLoads.erase(it);
+				}
+				keep = load->mCacheable && !load->mInvalidated && (result == LoadDataStoreDataResult::kSuccess);
+				if (keep) {
+					mEvictions += InsertEntry(shard, mShardBudget, load->mKey, load->mEncryptionSetting, data);
+				}
+				waiters.swap(load->mWaiters);
+			}
+			
+			if (keep && writesDiskTier) {
+				DataPathPtr diskTierPath;
+				if (GetDiskTierPath(h_, load->mKey, diskTierPath)) {
+					std::string record;
+					EncodeDiskTierRecord(load->mKey, load->mEncryptionSetting, *data, record);
+					auto buffer = std::make_shared<SharedBuffer>(record);
+					mOptions.mDiskTier->WriteData(h_,
+												  diskTierPath,
+												  buffer,
+												  mOptions.mDiskTierEncryptionSetting,
+												  std::make_shared<DiskTierWriteCompletion>());
+				}
+			}
+			if (diskTierLock.owns_lock()) {
+				diskTierLock.unlock();
+			}
+			
+			Deliver(h_, waiters, result, data);
+		}
+		
+		//
+		void CachingDataStore::ListItems(const HermitPtr& h_,
+										 const DataPathPtr& rootPath,
+										 const ListDataStoreItemsItemCallbackPtr& itemCallback,
+										 const ListDataStoreItemsCompletionPtr& completion) {
+			mDataStore->ListItems(h_, rootPath, itemCallback, completion);
+		}
+		
+		//
+		void CachingDataStore::ItemExists(const HermitPtr& h_,
+										  const DataPathPtr& itemPath,
+										  const ItemExistsInDataStoreCompletionPtr& completion) {
+			std::string key;
+			itemPath->GetStringRepresentation(h_, key);
+			auto& shard = ShardFor(key);
+			bool cached = false;
+			{
+				std::lock_guard<std::mutex> lock(shard.mMutex);
+				cached = (shard.mIndex.find(key) != shard.mIndex.end());
+			}
+			if (cached) {
+				completion->Call(h_, ItemExistsInDataStoreResult::kSuccess, true);
+				return;
+			}
+			mDataStore->ItemExists(h_, itemPath, completion);
+		}
+		
+		//
+		void CachingDataStore::LoadData(const HermitPtr& h_,
+										const DataPathPtr& path,
+										const EncryptionSetting& encryptionSetting,
+										const LoadDataStoreDataDataBlockPtr& dataBlock,
+										const LoadDataStoreDataCompletionBlockPtr& completion) {
+			if (CHECK_FOR_ABORT(h_)) {
+				completion->Call(h_, LoadDataStoreDataResult::kCanceled);
+				return;
+			}
+			
+			std::string key;
+			path->GetStringRepresentation(h_, key);
+			auto& shard = ShardFor(key);
+			ConstStringPtr data;
+			CachingDataStoreLoadPtr load;
+			{
+				std::lock_guard<std::mutex> lock(shard.mMutex);
+				auto it = shard.mIndex.find(key);
+				if ((it != shard.mIndex.end()) && (it->second->mEncryptionSetting == encryptionSetting)) {
+					shard.mEntries.splice(shard.mEntries.begin(), shard.mEntries, it->second);
+					data = it->second->mData;
+				}
+				else {
+					auto loadIt = shard.mLoads.find(key);
+					if (loadIt != shard.mLoads.end()) {
+						if (loadIt->second->mEncryptionSetting == encryptionSetting) {
+							loadIt->second->mWaiters.push_back(Waiter(dataBlock, completion));
+							mCoalescedLoads++;
+							return;
+						}
+						// Same item, read a different way: load it on its own and don't keep it.
+						load = std::make_shared<CachingDataStoreLoad>(shared_from_this(), path, key, encryptionSetting, false);
+					}
+					else {
+						load = std::make_shared<CachingDataStoreLoad>(shared_from_this(), path, key, encryptionSetting, true);
+						shard.mLoads[key] = load;
+					}
+					load->mWaiters.push_back(Waiter(dataBlock, completion));
+				}
+			}
+			
+			if (data != nullptr) {
+				mMemoryHits++;
+				dataBlock->Call(h_, DataBuffer(data->data(), data->size()));
+				completion->Call(h_, LoadDataStoreDataResult::kSuccess);
+				return;
+			}
+			load->Start(h_);
+		}
+		
+		//
+		void CachingDataStore::WriteData(const HermitPtr& h_,
+										 const DataPathPtr& path,
+										 const SharedBufferPtr& data,
+										 const EncryptionSetting& encryptionSetting,
+										 const WriteDataStoreDataCompletionFunctionPtr& completion) {
+			// Before, so no load from here on is served the old data, and again after, for
+			// any load that raced the write and got the old data anyway.
+			Invalidate(h_, path);
+			auto invalidatingCompletion = std::make_shared<InvalidatingWriteCompletion>(shared_from_this(), path, completion);
+			mDataStore->WriteData(h_, path, data, encryptionSetting, invalidatingCompletion);
+		}
+		
+		//
+		void CachingDataStore::DeleteItem(const HermitPtr& h_,
+										  const DataPathPtr& path,
+										  const DeleteDataStoreItemCompletionPtr& completion) {
+			Invalidate(h_, path);
+			auto invalidatingCompletion = std::make_shared<InvalidatingDeleteCompletion>(shared_from_this(), path, completion);
+			mDataStore->DeleteItem(h_, path, invalidatingCompletion);
+		}
+		
+		//
+		void CachingDataStore::WriteItems(const HermitPtr& h_,
+										  const DataStoreWriteItemVector& items,
+										  const EncryptionSetting& encryptionSetting,
+										  const DataStoreBatchOptions& options,
+										  const WriteDataStoreItemsItemCallbackPtr& itemCallback,
+										  const DataStoreBatchCompletionPtr& completion) {
+			for (auto& item : items) {
+				Invalidate(h_, item.mPath);
+			}
+			auto invalidatingCallback = std::make_shared<InvalidatingWriteItemCallback>(shared_from_this(), itemCallback);
+			mDataStore->WriteItems(h_, items, encryptionSetting, options, invalidatingCallback, completion);
+		}
+		
+		//
+		void CachingDataStore::DeleteItems(const HermitPtr& h_,
+										   const DataPathVector& paths,
+										   const DataStoreBatchOptions& options,
+										   const DeleteDataStoreItemsItemCallbackPtr& itemCallback,
+										   const DataStoreBatchCompletionPtr& completion) {
+			for (auto& path : paths) {
+				Invalidate(h_, path);
+			}
+			auto invalidatingCallback = std::make_shared<InvalidatingDeleteItemCallback>(shared_from_this(), itemCallback);
+			mDataStore->DeleteItems(h_, paths, options, invalidatingCallback, completion);
+		}
+		
+	} // namespace datastore
+} // namespace hermit
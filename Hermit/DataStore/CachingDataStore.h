@@ -0,0 +1,201 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef CachingDataStore_h
+#define CachingDataStore_h
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "DataStore.h"
+
+namespace hermit {
+	namespace datastore {
+		
+		//
+		const uint64_t kDefaultCachingDataStoreMemoryBudget = 64 * 1024 * 1024;
+		
+		//
+		struct CachingDataStoreOptions {
+			//
+			CachingDataStoreOptions() :
+			mMemoryBudget(kDefaultCachingDataStoreMemoryBudget),
+			mDiskTierEncryptionSetting(EncryptionSetting::kUnencrypted) {
+			}
+			
+			//	Bytes of item data the in-memory tier may hold, split evenly across its shards.
+			//	An item bigger than a shard's share is never held in memory.
+			uint64_t mMemoryBudget;
+			
+			//	Optional second tier: a local store (a FileDataStore or PackFileDataStore, say)
+			//	that keeps a copy of everything loaded from the wrapped store, under
+			//	mDiskTierRoot. The copies are plaintext unless the tier encrypts them, and the
+			//	tier isn't trimmed; clear it as needed. Its calls should complete in the order
+			//	they're made, as the local stores' do.
+			DataStorePtr mDiskTier;
+			DataPathPtr mDiskTierRoot;
+			EncryptionSetting mDiskTierEncryptionSetting;
+		};
+		
+		//
+		struct CachingDataStoreMetrics {
+			//
+			CachingDataStoreMetrics() :
+			mMemoryHits(0),
+			mDiskHits(0),
+			mMisses(0),
+			mCoalescedLoads(0),
+			mEvictions(0),
+			mInvalidations(0),
+			mBytesLoaded(0),
+			mBytesInMemory(0),
+			mItemsInMemory(0) {
+			}
+			
+			//	Loads answered from each tier, and those that went to the wrapped store.
+			uint64_t mMemoryHits;
+			uint64_t mDiskHits;
+			uint64_t mMisses;
+			
+			//	Loads that waited on an identical load already in flight rather than start one.
+			uint64_t mCoalescedLoads;
+			
+			//
+			uint64_t mEvictions;
+			uint64_t mInvalidations;
+			
+			//	Bytes loaded from the wrapped store.
+			uint64_t mBytesLoaded;
+			
+			//
+			uint64_t mBytesInMemory;
+			uint64_t mItemsInMemory;
+		};
+		
+		//
+		struct CachingDataStoreShard;
+		class CachingDataStoreLoad;
+		
+		//	Wraps another DataStore and keeps what LoadData returns, keyed by the DataPath's
+		//	string representation, in a sharded in-memory LRU and optionally a disk tier.
+		//	Entries are the wrapped store's output, so over an encrypted store they're
+		//	plaintext, and a hit skips both the request and the decryption. A load of an
+		//	item that's already being loaded waits for that load instead of starting
+		//	another. Writes and deletes through the cache invalidate the item both before
+		//	and after they reach the wrapped store; changes made to the wrapped store by
+		//	other means aren't seen. Everything else passes straight through.
+		class CachingDataStore : public DataStore, public std::enable_shared_from_this<CachingDataStore> {
+		public:
+			//
+			CachingDataStore(const DataStorePtr& dataStore, const CachingDataStoreOptions& options);
+			
+			//
+			virtual ~CachingDataStore();
+			
+			//
+			CachingDataStoreMetrics GetMetrics();
+			
+			//	Drops a cached item, for changes made to the wrapped store by other means.
+			void Invalidate(const HermitPtr& h_, const DataPathPtr& path);
+			
+			//
+			virtual void ListItems(const HermitPtr& h_,
+								   const DataPathPtr& rootPath,
+								   const ListDataStoreItemsItemCallbackPtr& itemCallback,
+								   const ListDataStoreItemsCompletionPtr& completion) override;
+			
+			//	Answered from memory when the item is there.
+			virtual void ItemExists(const HermitPtr& h_,
+									const DataPathPtr& itemPath,
+									const ItemExistsInDataStoreCompletionPtr& completion) override;
+			
+			//
+			virtual void LoadData(const HermitPtr& h_,
+								  const DataPathPtr& path,
+								  const EncryptionSetting& encryptionSetting,
+								  const LoadDataStoreDataDataBlockPtr& dataBlock,
+								  const LoadDataStoreDataCompletionBlockPtr& completion) override;
+			
+			//
+			virtual void WriteData(const HermitPtr& h_,
+								   const DataPathPtr& path,
+								   const SharedBufferPtr& data,
+								   const EncryptionSetting& encryptionSetting,
+								   const WriteDataStoreDataCompletionFunctionPtr& completion) override;
+			
+			//
+			virtual void DeleteItem(const HermitPtr& h_,
+									const DataPathPtr& path,
+									const DeleteDataStoreItemCompletionPtr& completion) override;
+			
+			//	Passed to the wrapped store's own batch call, so it can use bulk requests.
+			virtual void WriteItems(const HermitPtr& h_,
+									const DataStoreWriteItemVector& items,
+									const EncryptionSetting& encryptionSetting,
+									const DataStoreBatchOptions& options,
+									const WriteDataStoreItemsItemCallbackPtr& itemCallback,
+									const DataStoreBatchCompletionPtr& completion) override;
+			
+			//
+			virtual void DeleteItems(const HermitPtr& h_,
+									 const DataPathVector& paths,
+									 const DataStoreBatchOptions& options,
+									 const DeleteDataStoreItemsItemCallbackPtr& itemCallback,
+									 const DataStoreBatchCompletionPtr& completion) override;
+			
+		private:
+			//
+			friend class CachingDataStoreLoad;
+			
+			//
+			CachingDataStoreShard& ShardFor(const std::string& key);
+			
+			//
+			void InvalidateKey(const HermitPtr& h_, const std::string& key);
+			
+			//
+			bool GetDiskTierPath(const HermitPtr& h_, const std::string& key, DataPathPtr& outPath);
+			
+			//
+			void CompleteLoad(const HermitPtr& h_,
+							  const std::shared_ptr<CachingDataStoreLoad>& load,
+							  const LoadDataStoreDataResult& result,
+							  const std::shared_ptr<const std::string>& data,
+							  bool fromWrappedStore);
+			
+			//
+			DataStorePtr mDataStore;
+			CachingDataStoreOptions mOptions;
+			uint64_t mShardBudget;
+			std::vector<std::unique_ptr<CachingDataStoreShard>> mShards;
+			std::atomic<uint64_t> mMemoryHits;
+			std::atomic<uint64_t> mDiskHits;
+			std::atomic<uint64_t> mMisses;
+			std::atomic<uint64_t> mCoalescedLoads;
+			std::atomic<uint64_t> mEvictions;
+			std::atomic<uint64_t> mInvalidations;
+			std::atomic<uint64_t> mBytesLoaded;
+		};
+		typedef std::shared_ptr<CachingDataStore> CachingDataStorePtr;
+		
+	} // namespace datastore
+} // namespace hermit
+
+#endif
@@ -21,6 +21,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 #include "Hermit/Foundation/AsyncFunction.h"
 #include "Hermit/Foundation/DataBuffer.h"
 #include "Hermit/Foundation/SharedBuffer.h"
@@ -142,6 +143,76 @@ namespace hermit {
                                  HermitPtr,
                                  DeleteDataStoreItemResult);
         
+		//
+		typedef std::vector<DataPathPtr> DataPathVector;
+		
+		//
+		struct DataStoreWriteItem {
+			//
+			DataStoreWriteItem(const DataPathPtr& path, const SharedBufferPtr& data) : mPath(path), mData(data) {
+			}
+			
+			//
+			DataPathPtr mPath;
+			SharedBufferPtr mData;
+		};
+		typedef std::vector<DataStoreWriteItem> DataStoreWriteItemVector;
+		
+		//	How many single-item operations a batch call keeps in flight by default.
+		const size_t kDefaultDataStoreBatchConcurrency = 8;
+		
+		//
+		struct DataStoreBatchOptions {
+			//
+			DataStoreBatchOptions() : mMaxConcurrency(kDefaultDataStoreBatchConcurrency) {
+			}
+			
+			//	Upper bound on the requests a batch call has outstanding at once. 0 is treated as 1.
+			size_t mMaxConcurrency;
+		};
+		
+		//	kError means at least one item reported a failure through the item callback;
+		//	kCanceled means the batch was aborted, and items not yet started weren't reported.
+		enum class DataStoreBatchResult {
+			kUnknown,
+			kSuccess,
+			kCanceled,
+			kError
+		};
+		
+		//
+		DEFINE_ASYNC_FUNCTION_2A(DataStoreBatchCompletion,
+								 HermitPtr,
+								 DataStoreBatchResult);
+		
+		//	The per-item callbacks of the batch calls below are called once for each item,
+		//	in no particular order, but never from two threads at once, and all before the
+		//	batch completion.
+		DEFINE_ASYNC_FUNCTION_3A(WriteDataStoreItemsItemCallback,
+								 HermitPtr,
+								 DataPathPtr,
+								 WriteDataStoreDataResult);
+		
+		//	The data is only valid for the duration of the call.
+		DEFINE_ASYNC_FUNCTION_4A(LoadDataStoreItemsItemCallback,
+								 HermitPtr,
+								 DataPathPtr,
+								 LoadDataStoreDataResult,
+								 DataBuffer);
+		
+		//
+		DEFINE_ASYNC_FUNCTION_4A(DataStoreItemsExistItemCallback,
+								 HermitPtr,
+								 DataPathPtr,
+								 ItemExistsInDataStoreResult,
+								 bool);
+		
+		//
+		DEFINE_ASYNC_FUNCTION_3A(DeleteDataStoreItemsItemCallback,
+								 HermitPtr,
+								 DataPathPtr,
+								 DeleteDataStoreItemResult);
+		
 		//
 		struct DataStore {
 			//
@@ -173,6 +244,38 @@ namespace hermit {
 			virtual void DeleteItem(const HermitPtr& h_,
                                     const DataPathPtr& inPath,
                                     const DeleteDataStoreItemCompletionPtr& completion);
+			
+			//	The batch calls below default to running the single-item calls above on the
+			//	thread pool, at most options.mMaxConcurrency at a time. As with the single-item
+			//	calls, the store must stay alive until the completion is called.
+			virtual void WriteItems(const HermitPtr& h_,
+									const DataStoreWriteItemVector& items,
+									const EncryptionSetting& encryptionSetting,
+									const DataStoreBatchOptions& options,
+									const WriteDataStoreItemsItemCallbackPtr& itemCallback,
+									const DataStoreBatchCompletionPtr& completion);
+			
+			//
+			virtual void LoadItems(const HermitPtr& h_,
+								   const DataPathVector& paths,
+								   const EncryptionSetting& encryptionSetting,
+								   const DataStoreBatchOptions& options,
+								   const LoadDataStoreItemsItemCallbackPtr& itemCallback,
+								   const DataStoreBatchCompletionPtr& completion);
+			
+			//
+			virtual void ItemsExist(const HermitPtr& h_,
+									const DataPathVector& paths,
+									const DataStoreBatchOptions& options,
+									const DataStoreItemsExistItemCallbackPtr& itemCallback,
+									const DataStoreBatchCompletionPtr& completion);
+			
+			//
+			virtual void DeleteItems(const HermitPtr& h_,
+									 const DataPathVector& paths,
+									 const DataStoreBatchOptions& options,
+									 const DeleteDataStoreItemsItemCallbackPtr& itemCallback,
+									 const DataStoreBatchCompletionPtr& completion);
 
 		protected:
 			//
@@ -0,0 +1,504 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+#include "Hermit/Foundation/AsyncTaskQueue.h"
+#include "Hermit/Foundation/Notification.h"
+#include "DataStoreBatch.h"
+
+namespace hermit {
+	namespace datastore {
+		namespace DataStoreBatch_Impl {
+			
+			//
+			typedef std::shared_ptr<DataStoreBatchRunner> DataStoreBatchRunnerPtr;
+			
+			//
+			class StartItemTask : public AsyncTask {
+			public:
+				//
+				StartItemTask(const DataStoreBatchRunnerPtr& runner, size_t index) : mRunner(runner), mIndex(index) {
+				}
+				
+				//
+				virtual void PerformTask(const HermitPtr& h_) override {
+					mRunner->StartQueuedItem(h_, mIndex);
+				}
+				
+				//
+				DataStoreBatchRunnerPtr mRunner;
+				size_t mIndex;
+			};
+			
+			//
+			template <typename ItemResult>
+			DataStoreBatchResult ItemResultToBatchResult(ItemResult result) {
+				if (result == ItemResult::kSuccess) {
+					return DataStoreBatchResult::kSuccess;
+				}
+				if (result == ItemResult::kCanceled) {
+					return DataStoreBatchResult::kCanceled;
+				}
+				return DataStoreBatchResult::kError;
+			}
+			
+			//
+			class WriteItemsRunner : public DataStoreBatchRunner {
+			public:
+				//
+				WriteItemsRunner(DataStore& dataStore,
+								 const DataStoreWriteItemVector& items,
+								 const EncryptionSetting& encryptionSetting,
+								 const DataStoreBatchOptions& options,
+								 bool startOnThreadPool,
+								 const WriteDataStoreItemsItemCallbackPtr& itemCallback,
+								 const DataStoreBatchCompletionPtr& completion) :
+				DataStoreBatchRunner(items.size(), options, startOnThreadPool, completion),
+				mDataStore(dataStore),
+				mItems(items),
+				mEncryptionSetting(encryptionSetting),
+				mItemCallback(itemCallback) {
+				}
+				
+				//
+				class ItemCompletion : public WriteDataStoreDataCompletionFunction {
+				public:
+					//
+					ItemCompletion(const std::shared_ptr<WriteItemsRunner>& runner, size_t index) : mRunner(runner), mIndex(index) {
+					}
+					
+					//
+					virtual void Call(const HermitPtr& h_, const WriteDataStoreDataResult& result) override {
+						mRunner->ItemDone(h_, mIndex, result);
+					}
+					
+					//
+					std::shared_ptr<WriteItemsRunner> mRunner;
+					size_t mIndex;
+				};
+				
+				//
+				virtual void StartItem(const HermitPtr& h_, size_t index) override {
+					auto runner = std::static_pointer_cast<WriteItemsRunner>(shared_from_this());
+					auto completion = std::make_shared<ItemCompletion>(runner, index);
+					auto& item = mItems[index];
+					mDataStore.WriteData(h_, item.mPath, item.mData, mEncryptionSetting, completion);
+				}
+				
+				//
+				void ItemDone(const HermitPtr& h_, size_t index, const WriteDataStoreDataResult& result) {
+					{
+						std::lock_guard<std::mutex> lock(mCallbackMutex);
+						mItemCallback->Call(h_, mItems[index].mPath, result);
+					}
+					ItemComplete(h_, ItemResultToBatchResult(result));
+				}
+				
+				//
+				DataStore& mDataStore;
+				DataStoreWriteItemVector mItems;
+				EncryptionSetting mEncryptionSetting;
+				WriteDataStoreItemsItemCallbackPtr mItemCallback;
+			};
+			
+			//
+			class LoadItemsRunner : public DataStoreBatchRunner {
+			public:
+				//
+				LoadItemsRunner(DataStore& dataStore,
+								const DataPathVector& paths,
+								const EncryptionSetting& encryptionSetting,
+								const DataStoreBatchOptions& options,
+								bool startOnThreadPool,
+								const LoadDataStoreItemsItemCallbackPtr& itemCallback,
+								const DataStoreBatchCompletionPtr& completion) :
+				DataStoreBatchRunner(paths.size(), options, startOnThreadPool, completion),
+				mDataStore(dataStore),
+				mPaths(paths),
+				mEncryptionSetting(encryptionSetting),
+				mItemCallback(itemCallback) {
+				}
+				
+				//
+				class ItemCompletion : public LoadDataStoreDataCompletionBlock {
+				public:
+					//
+					ItemCompletion(const std::shared_ptr<LoadItemsRunner>& runner,
+								   size_t index,
+								   const LoadDataStoreDataDataPtr& data) :
+					mRunner(runner),
+					mIndex(index),
+					mData(data) {
+					}
+					
+					//
+					virtual void Call(const HermitPtr& h_, const LoadDataStoreDataResult& result) override {
+						mRunner->ItemDone(h_, mIndex, result, mData->mData);
+					}
+					
+					//
+					std::shared_ptr<LoadItemsRunner> mRunner;
+					size_t mIndex;
+					LoadDataStoreDataDataPtr mData;
+				};
+				
+				//
+				virtual void StartItem(const HermitPtr& h_, size_t index) override {
+					auto runner = std::static_pointer_cast<LoadItemsRunner>(shared_from_this());
+					auto data = std::make_shared<LoadDataStoreDataData>();
+					auto completion = std::make_shared<ItemCompletion>(runner, index, data);
+					mDataStore.LoadData(h_, mPaths[index], mEncryptionSetting, data, completion);
+				}
+				
+				//
+				void ItemDone(const HermitPtr& h_, size_t index, const LoadDataStoreDataResult& result, const std::string& data) {
+					{
+						std::lock_guard<std::mutex> lock(mCallbackMutex);
+						mItemCallback->Call(h_, mPaths[index], result, DataBuffer(data.data(), data.size()));
+					}
+					ItemComplete(h_, ItemResultToBatchResult(result));
+				}
+				
+				//
+				DataStore& mDataStore;
+				DataPathVector mPaths;
+				EncryptionSetting mEncryptionSetting;
+				LoadDataStoreItemsItemCallbackPtr mItemCallback;
+			};
+			
+			//
+			class ItemsExistRunner : public DataStoreBatchRunner {
+			public:
+				//
+				ItemsExistRunner(DataStore& dataStore,
+								 const DataPathVector& paths,
+								 const DataStoreBatchOptions& options,
+								 bool startOnThreadPool,
+								 const DataStoreItemsExistItemCallbackPtr& itemCallback,
+								 const DataStoreBatchCompletionPtr& completion) :
+				DataStoreBatchRunner(paths.size(), options, startOnThreadPool, completion),
+				mDataStore(dataStore),
+				mPaths(paths),
+				mItemCallback(itemCallback) {
+				}
+				
+				//
+				class ItemCompletion : public ItemExistsInDataStoreCompletion {
+				public:
+					//
+					ItemCompletion(const std::shared_ptr<ItemsExistRunner>& runner, size_t index) : mRunner(runner), mIndex(index) {
+					}
+					
+					//
+					virtual void Call(const HermitPtr& h_, const ItemExistsInDataStoreResult& result, const bool& exists) override {
+						mRunner->ItemDone(h_, mIndex, result, exists);
+					}
+					
+					//
+					std::shared_ptr<ItemsExistRunner> mRunner;
+					size_t mIndex;
+				};
+				
+				//
+				virtual void StartItem(const HermitPtr& h_, size_t index) override {
+					auto runner = std::static_pointer_cast<ItemsExistRunner>(shared_from_this());
+					auto completion = std::make_shared<ItemCompletion>(runner, index);
+					mDataStore.ItemExists(h_, mPaths[index], completion);
+				}
+				
+				//
+				void ItemDone(const HermitPtr& h_, size_t index, const ItemExistsInDataStoreResult& result, bool exists) {
+					{
+						std::lock_guard<std::mutex> lock(mCallbackMutex);
+						mItemCallback->Call(h_, mPaths[index], result, exists);
+					}
+					ItemComplete(h_, ItemResultToBatchResult(result));
+				}
+				
+				//
+				DataStore& mDataStore;
+				DataPathVector mPaths;
+				DataStoreItemsExistItemCallbackPtr mItemCallback;
+			};
+			
+			//
+			class DeleteItemsRunner : public DataStoreBatchRunner {
+			public:
+				//
+				DeleteItemsRunner(DataStore& dataStore,
+								  const DataPathVector& paths,
+								  const DataStoreBatchOptions& options,
+								  bool startOnThreadPool,
+								  const DeleteDataStoreItemsItemCallbackPtr& itemCallback,
+								  const DataStoreBatchCompletionPtr& completion) :
+				DataStoreBatchRunner(paths.size(), options, startOnThreadPool, completion),
+				mDataStore(dataStore),
+				mPaths(paths),
+				mItemCallback(itemCallback) {
+				}
+				
+				//
+				class ItemCompletion : public DeleteDataStoreItemCompletion {
+				public:
+					//
+					ItemCompletion(const std::shared_ptr<DeleteItemsRunner>& runner, size_t index) : mRunner(runner), mIndex(index) {
+					}
+					
+					//
+					virtual void Call(const HermitPtr& h_, const DeleteDataStoreItemResult& result) override {
+						mRunner->ItemDone(h_, mIndex, result);
+					}
+					
+					//
+					std::shared_ptr<DeleteItemsRunner> mRunner;
+					size_t mIndex;
+				};
+				
+				//
+				virtual void StartItem(const HermitPtr& h_, size_t index) override {
+					auto runner = std::static_pointer_cast<DeleteItemsRunner>(shared_from_this());
+					auto completion = std::make_shared<ItemCompletion>(runner, index);
+					mDataStore.DeleteItem(h_, mPaths[index], completion);
+				}
+				
+				//
+				void ItemDone(const HermitPtr& h_, size_t index, const DeleteDataStoreItemResult& result) {
+					{
+						std::lock_guard<std::mutex> lock(mCallbackMutex);
+						mItemCallback->Call(h_, mPaths[index], result);
+					}
+					ItemComplete(h_, ItemResultToBatchResult(result));
+				}
+				
+				//
+				DataStore& mDataStore;
+				DataPathVector mPaths;
+				DeleteDataStoreItemsItemCallbackPtr mItemCallback;
+			};
+			
+		} // namespace DataStoreBatch_Impl
+		using namespace DataStoreBatch_Impl;
+		
+		//
+		DataStoreBatchRunner::DataStoreBatchRunner(size_t itemCount,
+												   const DataStoreBatchOptions& options,
+												   bool startOnThreadPool,
+												   const DataStoreBatchCompletionPtr& completion) :
+		mItemCount(itemCount),
+		mMaxConcurrency(std::max(options.mMaxConcurrency, (size_t)1)),
+		mStartOnThreadPool(startOnThreadPool),
+		mCompletion(completion),
+		mNextItem(0),
+		mItemsInFlight(0),
+		mPumping(false),
+		mStopped(false),
+		mCanceled(false),
+		mHadError(false),
+		mFinished(false) {
+		}
+		
+		//
+		void DataStoreBatchRunner::Start(const HermitPtr& h_) {
+			Pump(h_);
+		}
+		
+		//
+		void DataStoreBatchRunner::StartQueuedItem(const HermitPtr& h_, size_t index) {
+			StartItem(h_, index);
+		}
+		
+		//
+		void DataStoreBatchRunner::ItemComplete(const HermitPtr& h_, DataStoreBatchResult itemResult) {
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				--mItemsInFlight;
+				if (itemResult == DataStoreBatchResult::kCanceled) {
+					mCanceled = true;
+					mStopped = true;
+				}
+				else if (itemResult != DataStoreBatchResult::kSuccess) {
+					mHadError = true;
+				}
+			}
+			Pump(h_);
+		}
+		
+		//	Only one thread pumps at a time. A call that arrives while another is pumping,
+		//	including one from an item that completed inside StartItem, returns at once and
+		//	leaves the pumping thread to pick up the change on its next pass, which keeps
+		//	stores that complete inline from recursing once per item.
+		void DataStoreBatchRunner::Pump(const HermitPtr& h_) {
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				if (mPumping) {
+					return;
+				}
+				mPumping = true;
+			}
+			
+			bool finished = false;
+			while (true) {
+				std::vector<size_t> itemsToStart;
+				{
+					std::lock_guard<std::mutex> lock(mMutex);
+					if (!mStopped && CHECK_FOR_ABORT(h_)) {
+						mCanceled = true;
+						mStopped = true;
+					}
+					while (!mStopped && (mNextItem < mItemCount) && (mItemsInFlight < mMaxConcurrency)) {
+						itemsToStart.push_back(mNextItem++);
+						++mItemsInFlight;
+					}
+					if (itemsToStart.empty()) {
+						mPumping = false;
+						if (!mFinished && (mItemsInFlight == 0) && (mStopped || (mNextItem == mItemCount))) {
+							mFinished = true;
+							finished = true;
+						}
+						break;
+					}
+				}
+				
+				for (auto it = begin(itemsToStart); it != end(itemsToStart); ++it) {
+					if (!mStartOnThreadPool) {
+						StartItem(h_, *it);
+					}
+					else {
+						auto task = std::make_shared<StartItemTask>(shared_from_this(), *it);
+						if (!QueueAsyncTask(h_, task, 10)) {
+							NOTIFY_ERROR(h_, "DataStoreBatchRunner: QueueAsyncTask failed.");
+							ItemComplete(h_, DataStoreBatchResult::kError);
+						}
+					}
+				}
+			}
+			
+			if (finished) {
+				auto result = DataStoreBatchResult::kSuccess;
+				if (mCanceled) {
+					result = DataStoreBatchResult::kCanceled;
+				}
+				else if (mHadError) {
+					result = DataStoreBatchResult::kError;
+				}
+				mCompletion->Call(h_, result);
+			}
+		}
+		
+		//
+		void WriteDataStoreItems(const HermitPtr& h_,
+								 DataStore& dataStore,
+								 const DataStoreWriteItemVector& items,
+								 const EncryptionSetting& encryptionSetting,
+								 const DataStoreBatchOptions& options,
+								 bool startOnThreadPool,
+								 const WriteDataStoreItemsItemCallbackPtr& itemCallback,
+								 const DataStoreBatchCompletionPtr& completion) {
+			auto runner = std::make_shared<WriteItemsRunner>(dataStore,
+															 items,
+															 encryptionSetting,
+															 options,
+															 startOnThreadPool,
+															 itemCallback,
+															 completion);
+			runner->Start(h_);
+		}
+		
+		//
+		void LoadDataStoreItems(const HermitPtr& h_,
+								DataStore& dataStore,
+								const DataPathVector& paths,
+								const EncryptionSetting& encryptionSetting,
+								const DataStoreBatchOptions& options,
+								bool startOnThreadPool,
+								const LoadDataStoreItemsItemCallbackPtr& itemCallback,
+								const DataStoreBatchCompletionPtr& completion) {
+			auto runner = std::make_shared<LoadItemsRunner>(dataStore,
+															paths,
+															encryptionSetting,
+															options,
+															startOnThreadPool,
+															itemCallback,
+															completion);
+			runner->Start(h_);
+		}
+		
+		//
+		void DataStoreItemsExist(const HermitPtr& h_,
+								 DataStore& dataStore,
+								 const DataPathVector& paths,
+								 const DataStoreBatchOptions& options,
+								 bool startOnThreadPool,
+								 const DataStoreItemsExistItemCallbackPtr& itemCallback,
+								 const DataStoreBatchCompletionPtr& completion) {
+			auto runner = std::make_shared<ItemsExistRunner>(dataStore, paths, options, startOnThreadPool, itemCallback, completion);
+			runner->Start(h_);
+		}
+		
+		//
+		void DeleteDataStoreItems(const HermitPtr& h_,
+								  DataStore& dataStore,
+								  const DataPathVector& paths,
+								  const DataStoreBatchOptions& options,
+								  bool startOnThreadPool,
+								  const DeleteDataStoreItemsItemCallbackPtr& itemCallback,
+								  const DataStoreBatchCompletionPtr& completion) {
+			auto runner = std::make_shared<DeleteItemsRunner>(dataStore, paths, options, startOnThreadPool, itemCallback, completion);
+			runner->Start(h_);
+		}
+		
+		//
+		void DataStore::WriteItems(const HermitPtr& h_,
+								   const DataStoreWriteItemVector& items,
+								   const EncryptionSetting& encryptionSetting,
+								   const DataStoreBatchOptions& options,
+								   const WriteDataStoreItemsItemCallbackPtr& itemCallback,
+								   const DataStoreBatchCompletionPtr& completion) {
+			WriteDataStoreItems(h_, *this, items, encryptionSetting, options, true, itemCallback, completion);
+		}
+		
+		//
+		void DataStore::LoadItems(const HermitPtr& h_,
+								  const DataPathVector& paths,
+								  const EncryptionSetting& encryptionSetting,
+								  const DataStoreBatchOptions& options,
+								  const LoadDataStoreItemsItemCallbackPtr& itemCallback,
+								  const DataStoreBatchCompletionPtr& completion) {
+			LoadDataStoreItems(h_, *this, paths, encryptionSetting, options, true, itemCallback, completion);
+		}
+		
+		//
+		void DataStore::ItemsExist(const HermitPtr& h_,
+								   const DataPathVector& paths,
+								   const DataStoreBatchOptions& options,
+								   const DataStoreItemsExistItemCallbackPtr& itemCallback,
+								   const DataStoreBatchCompletionPtr& completion) {
+			DataStoreItemsExist(h_, *this, paths, options, true, itemCallback, completion);
+		}
+		
+		//
+		void DataStore::DeleteItems(const HermitPtr& h_,
+									const DataPathVector& paths,
+									const DataStoreBatchOptions& options,
+									const DeleteDataStoreItemsItemCallbackPtr& itemCallback,
+									const DataStoreBatchCompletionPtr& completion) {
+			DeleteDataStoreItems(h_, *this, paths, options, true, itemCallback, completion);
+		}
+		
+	} // namespace datastore
+} // namespace hermit
@@ -0,0 +1,125 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef DataStoreBatch_h
+#define DataStoreBatch_h
+
+#include <memory>
+#include <mutex>
+#include "Hermit/Foundation/Hermit.h"
+#include "DataStore.h"
+
+namespace hermit {
+	namespace datastore {
+		
+		//	Runs one asynchronous operation per item of a batch, with at most
+		//	options.mMaxConcurrency in flight. A subclass starts the operation for an item
+		//	in StartItem and, once it completes, calls ItemComplete exactly once for it.
+		//	Items are either started on the thread pool, so that stores whose single-item
+		//	calls do their work before returning still overlap, or inline, for stores whose
+		//	calls only issue a request.
+		class DataStoreBatchRunner : public std::enable_shared_from_this<DataStoreBatchRunner> {
+		public:
+			//
+			DataStoreBatchRunner(size_t itemCount,
+								 const DataStoreBatchOptions& options,
+								 bool startOnThreadPool,
+								 const DataStoreBatchCompletionPtr& completion);
+			
+			//
+			virtual ~DataStoreBatchRunner() = default;
+			
+			//
+			void Start(const HermitPtr& h_);
+			
+			//	Called by the thread pool task queued for an item.
+			void StartQueuedItem(const HermitPtr& h_, size_t index);
+			
+		protected:
+			//
+			virtual void StartItem(const HermitPtr& h_, size_t index) = 0;
+			
+			//	itemResult is kSuccess, kCanceled or kError.
+			void ItemComplete(const HermitPtr& h_, DataStoreBatchResult itemResult);
+			
+			//	Held by subclasses while they call their per-item callback.
+			std::mutex mCallbackMutex;
+			
+		private:
+			//
+			void Pump(const HermitPtr& h_);
+			
+			//
+			size_t mItemCount;
+			size_t mMaxConcurrency;
+			bool mStartOnThreadPool;
+			DataStoreBatchCompletionPtr mCompletion;
+			std::mutex mMutex;
+			size_t mNextItem;
+			size_t mItemsInFlight;
+			bool mPumping;
+			bool mStopped;
+			bool mCanceled;
+			bool mHadError;
+			bool mFinished;
+		};
+		
+		//	These run a batch through the single-item calls of dataStore, so subclasses
+		//	that override those (encryption, for example) are honored. Batch overrides
+		//	use them for the calls they don't map onto a bulk request of their own.
+		void WriteDataStoreItems(const HermitPtr& h_,
+								 DataStore& dataStore,
+								 const DataStoreWriteItemVector& items,
+								 const EncryptionSetting& encryptionSetting,
+								 const DataStoreBatchOptions& options,
+								 bool startOnThreadPool,
+								 const WriteDataStoreItemsItemCallbackPtr& itemCallback,
+								 const DataStoreBatchCompletionPtr& completion);
+		
+		//
+		void LoadDataStoreItems(const HermitPtr& h_,
+								DataStore& dataStore,
+								const DataPathVector& paths,
+								const EncryptionSetting& encryptionSetting,
+								const DataStoreBatchOptions& options,
+								bool startOnThreadPool,
+								const LoadDataStoreItemsItemCallbackPtr& itemCallback,
+								const DataStoreBatchCompletionPtr& completion);
+		
+		//
+		void DataStoreItemsExist(const HermitPtr& h_,
+								 DataStore& dataStore,
+								 const DataPathVector& paths,
+								 const DataStoreBatchOptions& options,
+								 bool startOnThreadPool,
+								 const DataStoreItemsExistItemCallbackPtr& itemCallback,
+								 const DataStoreBatchCompletionPtr& completion);
+		
+		//
+		void DeleteDataStoreItems(const HermitPtr& h_,
+								  DataStore& dataStore,
+								  const DataPathVector& paths,
+								  const DataStoreBatchOptions& options,
+								  bool startOnThreadPool,
+								  const DeleteDataStoreItemsItemCallbackPtr& itemCallback,
+								  const DataStoreBatchCompletionPtr& completion);
+		
+	} // namespace datastore
+} // namespace hermit
+
+#endif
@@ -26,7 +26,11 @@ namespace hermit {
 		enum class EncryptionSetting {
 			kUnknown,
 			kDefault,
-			kUnencrypted
+			kUnencrypted,
+			
+			//	Authenticated AES-256-GCM, written with a versioned header. Items stored with
+			//	kDefault (AES-256-CBC) still load.
+			kAES256GCM
 		};
 		
 	} // namespace datastore
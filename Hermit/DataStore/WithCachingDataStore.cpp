@@ -0,0 +1,39 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "Hermit/Foundation/Notification.h"
+#include "WithCachingDataStore.h"
+
+namespace hermit {
+	namespace datastore {
+		
+		//
+		bool WithCachingDataStore(const HermitPtr& h_,
+								  const DataStorePtr& dataStore,
+								  const CachingDataStoreOptions& options,
+								  CachingDataStorePtr& outDataStore) {
+			if (dataStore == nullptr) {
+				NOTIFY_ERROR(h_, "WithCachingDataStore: dataStore is null.");
+				return false;
+			}
+			outDataStore = std::make_shared<CachingDataStore>(dataStore, options);
+			return true;
+		}
+		
+	} // namespace datastore
+} // namespace hermit
@@ -16,11 +16,25 @@
 //	along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
-#include <iomanip>
-#include <iostream>
+#include <algorithm>
+#include <memory.h>
+#include <thread>
+#include "Hermit/Foundation/CPUFeatures.h"
+#include "Hermit/Foundation/ParallelSlices.h"
 #include "AES256.h"
 
-#define VERBOSE_DEBUG 0
+#ifndef HERMIT_AES256_AESNI
+#if defined(__x86_64__) || defined(__i386__)
+#define HERMIT_AES256_AESNI 1
+#else
+#define HERMIT_AES256_AESNI 0
+#endif
+#endif
+
+#if HERMIT_AES256_AESNI
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#endif
 
 namespace hermit {
 namespace encoding {
@@ -32,13 +46,6 @@ namespace encoding {
 
 namespace
 {	
-	//
-	//
-	struct AESState
-	{
-		uint8_t bytes[4][4];
-	};
-	
 	//
 	//
 	static const uint8_t sGFMultiply9[] = {
@@ -164,241 +171,396 @@ namespace
 	static const uint32_t sRcon[] = {
 					0x8d000000, 0x01000000, 0x02000000, 0x04000000, 0x08000000, 0x10000000, 0x20000000, 0x40000000, 0x80000000 };
 
+
+	//
+	//	Below this many blocks per slice (256KB) handing a slice to another thread costs
+	//	more than it saves.
+	const size_t kMinBlocksPerDecryptThread = 16384;
+
+	//
+	//
+	inline uint32_t RotateRight(
+		uint32_t inValue,
+		int inBits)
+	{
+		return (inValue >> inBits) | (inValue << (32 - inBits));
+	}
+
 	//
 	//
-	void PrintState(
-		const char* inPrefix,
-		const AESState& inState)
+	inline uint32_t LoadWord(
+		const uint8_t* inBytes)
+	{
+		return ((uint32_t)inBytes[0] << 24) | ((uint32_t)inBytes[1] << 16) | ((uint32_t)inBytes[2] << 8) | inBytes[3];
+	}
+
+	//
+	//
+	inline void StoreWord(
+		uint32_t inValue,
+		uint8_t* outBytes)
+	{
+		outBytes[0] = (uint8_t)(inValue >> 24);
+		outBytes[1] = (uint8_t)(inValue >> 16);
+		outBytes[2] = (uint8_t)(inValue >> 8);
+		outBytes[3] = (uint8_t)inValue;
+	}
+
+	//
+	//	32-bit T-tables. Each entry is an S-box output already multiplied through one
+	//	column of MixColumns (or InvMixColumns for the inverse S-box), so a full round is
+	//	16 lookups and XORs on the four column words. Built once from the byte tables above.
+	struct AESTables
 	{
-#if VERBOSE_DEBUG
-		std::cout << inPrefix << " :";
-		for (int r = 0; r < 4; r++)
+		//
+		//
+		AESTables()
 		{
-			for (int c = 0; c < 4; c++)
+			for (int x = 0; x < 256; ++x)
 			{
-				std::cout << " " << std::setw(2) << std::setfill('0') << std::hex << (int)inState.bytes[r][c];
+				uint32_t s = sSBox[x];
+				uint32_t s2 = ((s << 1) ^ ((s & 0x80) ? 0x1b : 0)) & 0xff;
+				uint32_t s3 = s2 ^ s;
+				uint32_t te = (s2 << 24) | (s << 16) | (s << 8) | s3;
+
+				uint8_t i = sInvSBox[x];
+				uint32_t td = ((uint32_t)sGFMultiply14[i] << 24) |
+							  ((uint32_t)sGFMultiply9[i] << 16) |
+							  ((uint32_t)sGFMultiply13[i] << 8) |
+							  ((uint32_t)sGFMultiply11[i]);
+
+				for (int n = 0; n < 4; ++n)
+				{
+					mTe[n][x] = (n == 0) ? te : RotateRight(te, n * 8);
+					mTd[n][x] = (n == 0) ? td : RotateRight(td, n * 8);
+				}
 			}
 		}
-		std::cout << "\n";
-#endif
-	}
-	
+
+		//
+		//
+		uint32_t mTe[4][256];
+		uint32_t mTd[4][256];
+	};
+
 	//
 	//
-	void AESBlockToAESState(
-		const AESBlock& inBlock,
-		AESState& outState)
+	const AESTables& GetTables()
 	{
-		for (int n = 0; n < 16; ++n)
-		{
-			outState.bytes[(n / 4)][n % 4] = inBlock.bytes[n];
-		}
+		static const AESTables sTables;
+		return sTables;
 	}
-	
+
 	//
 	//
-	void AESStateToAESBlock(
-		const AESState& inState,
-		AESBlock& outBlock)
+	void EncryptBlockWithTables(
+		const AESTables& inTables,
+		const uint32_t* inKeys,
+		const uint8_t* inInput,
+		uint8_t* outOutput)
 	{
-		for (int n = 0; n < 16; ++n)
+		const uint32_t (&te)[4][256] = inTables.mTe;
+		const uint32_t* rk = inKeys;
+		uint32_t s0 = LoadWord(inInput) ^ rk[0];
+		uint32_t s1 = LoadWord(inInput + 4) ^ rk[1];
+		uint32_t s2 = LoadWord(inInput + 8) ^ rk[2];
+		uint32_t s3 = LoadWord(inInput + 12) ^ rk[3];
+
+		for (int round = 1; round < 14; ++round)
 		{
-			outBlock.bytes[n] = inState.bytes[(n / 4)][n % 4];
+			rk += 4;
+			uint32_t t0 = te[0][s0 >> 24] ^ te[1][(s1 >> 16) & 0xff] ^ te[2][(s2 >> 8) & 0xff] ^ te[3][s3 & 0xff] ^ rk[0];
+			uint32_t t1 = te[0][s1 >> 24] ^ te[1][(s2 >> 16) & 0xff] ^ te[2][(s3 >> 8) & 0xff] ^ te[3][s0 & 0xff] ^ rk[1];
+			uint32_t t2 = te[0][s2 >> 24] ^ te[1][(s3 >> 16) & 0xff] ^ te[2][(s0 >> 8) & 0xff] ^ te[3][s1 & 0xff] ^ rk[2];
+			uint32_t t3 = te[0][s3 >> 24] ^ te[1][(s0 >> 16) & 0xff] ^ te[2][(s1 >> 8) & 0xff] ^ te[3][s2 & 0xff] ^ rk[3];
+			s0 = t0;
+			s1 = t1;
+			s2 = t2;
+			s3 = t3;
 		}
+
+		//	last round has no MixColumns
+		rk += 4;
+		StoreWord(((uint32_t)sSBox[s0 >> 24] << 24) ^ ((uint32_t)sSBox[(s1 >> 16) & 0xff] << 16) ^
+				  ((uint32_t)sSBox[(s2 >> 8) & 0xff] << 8) ^ sSBox[s3 & 0xff] ^ rk[0], outOutput);
+		StoreWord(((uint32_t)sSBox[s1 >> 24] << 24) ^ ((uint32_t)sSBox[(s2 >> 16) & 0xff] << 16) ^
+				  ((uint32_t)sSBox[(s3 >> 8) & 0xff] << 8) ^ sSBox[s0 & 0xff] ^ rk[1], outOutput + 4);
+		StoreWord(((uint32_t)sSBox[s2 >> 24] << 24) ^ ((uint32_t)sSBox[(s3 >> 16) & 0xff] << 16) ^
+				  ((uint32_t)sSBox[(s0 >> 8) & 0xff] << 8) ^ sSBox[s1 & 0xff] ^ rk[2], outOutput + 8);
+		StoreWord(((uint32_t)sSBox[s3 >> 24] << 24) ^ ((uint32_t)sSBox[(s0 >> 16) & 0xff] << 16) ^
+				  ((uint32_t)sSBox[(s1 >> 8) & 0xff] << 8) ^ sSBox[s2 & 0xff] ^ rk[3], outOutput + 12);
 	}
 
 	//
-	//
-	void AddRoundKey(
-		AESState& ioState,
-		const uint32_t* inKeyWords)
+	//	Equivalent inverse cipher (FIPS-197 5.3.5): inKeys must come from
+	//	MakeDecryptKeys.
+	void DecryptBlockWithTables(
+		const AESTables& inTables,
+		const uint32_t* inKeys,
+		const uint8_t* inInput,
+		uint8_t* outOutput)
 	{
-		for (int i = 0; i < 4; ++i)
+		const uint32_t (&td)[4][256] = inTables.mTd;
+		const uint32_t* rk = inKeys;
+		uint32_t s0 = LoadWord(inInput) ^ rk[0];
+		uint32_t s1 = LoadWord(inInput + 4) ^ rk[1];
+		uint32_t s2 = LoadWord(inInput + 8) ^ rk[2];
+		uint32_t s3 = LoadWord(inInput + 12) ^ rk[3];
+
+		for (int round = 1; round < 14; ++round)
 		{
-//			std::cout << "inKeyWords[i] " << inKeyWords[i] << "\n";
-//
-//			std::cout << "inKeyWords[i] >> 24 " << ((inKeyWords[i] >> 24) & 0xff) << "\n";
-//			std::cout << "inKeyWords[i] >> 16 " << ((inKeyWords[i] >> 16) & 0xff) << "\n";
-//			std::cout << "inKeyWords[i] >> 8 " << ((inKeyWords[i] >> 8) & 0xff) << "\n";
-//			std::cout << "inKeyWords[i] " << ((inKeyWords[i]) & 0xff) << "\n";
-//
-//			std::cout << "ioState.bytes[i][0] " << std::setw(2) << std::setfill('0') << std::hex << (int)ioState.bytes[i][0] << "\n";
-//			std::cout << "ioState.bytes[i][1] " << std::setw(2) << std::setfill('0') << std::hex << (int)ioState.bytes[i][1] << "\n";
-//			std::cout << "ioState.bytes[i][2] " << std::setw(2) << std::setfill('0') << std::hex << (int)ioState.bytes[i][2] << "\n";
-//			std::cout << "ioState.bytes[i][3] " << std::setw(2) << std::setfill('0') << std::hex << (int)ioState.bytes[i][3] << "\n";
-			
-			ioState.bytes[i][0] ^= (inKeyWords[i] >> 24) & 0xff;
-			ioState.bytes[i][1] ^= (inKeyWords[i] >> 16) & 0xff;
-			ioState.bytes[i][2] ^= (inKeyWords[i] >> 8) & 0xff;
-			ioState.bytes[i][3] ^= (inKeyWords[i]) & 0xff;
+			rk += 4;
+			uint32_t t0 = td[0][s0 >> 24] ^ td[1][(s3 >> 16) & 0xff] ^ td[2][(s2 >> 8) & 0xff] ^ td[3][s1 & 0xff] ^ rk[0];
+			uint32_t t1 = td[0][s1 >> 24] ^ td[1][(s0 >> 16) & 0xff] ^ td[2][(s3 >> 8) & 0xff] ^ td[3][s2 & 0xff] ^ rk[1];
+			uint32_t t2 = td[0][s2 >> 24] ^ td[1][(s1 >> 16) & 0xff] ^ td[2][(s0 >> 8) & 0xff] ^ td[3][s3 & 0xff] ^ rk[2];
+			uint32_t t3 = td[0][s3 >> 24] ^ td[1][(s2 >> 16) & 0xff] ^ td[2][(s1 >> 8) & 0xff] ^ td[3][s0 & 0xff] ^ rk[3];
+			s0 = t0;
+			s1 = t1;
+			s2 = t2;
+			s3 = t3;
 		}
+
+		//	last round has no InvMixColumns
+		rk += 4;
+		StoreWord(((uint32_t)sInvSBox[s0 >> 24] << 24) ^ ((uint32_t)sInvSBox[(s3 >> 16) & 0xff] << 16) ^
+				  ((uint32_t)sInvSBox[(s2 >> 8) & 0xff] << 8) ^ sInvSBox[s1 & 0xff] ^ rk[0], outOutput);
+		StoreWord(((uint32_t)sInvSBox[s1 >> 24] << 24) ^ ((uint32_t)sInvSBox[(s0 >> 16) & 0xff] << 16) ^
+				  ((uint32_t)sInvSBox[(s3 >> 8) & 0xff] << 8) ^ sInvSBox[s2 & 0xff] ^ rk[1], outOutput + 4);
+		StoreWord(((uint32_t)sInvSBox[s2 >> 24] << 24) ^ ((uint32_t)sInvSBox[(s1 >> 16) & 0xff] << 16) ^
+				  ((uint32_t)sInvSBox[(s0 >> 8) & 0xff] << 8) ^ sInvSBox[s3 & 0xff] ^ rk[2], outOutput + 8);
+		StoreWord(((uint32_t)sInvSBox[s3 >> 24] << 24) ^ ((uint32_t)sInvSBox[(s2 >> 16) & 0xff] << 16) ^
+				  ((uint32_t)sInvSBox[(s1 >> 8) & 0xff] << 8) ^ sInvSBox[s0 & 0xff] ^ rk[3], outOutput + 12);
 	}
-	
-	//
+
 	//
-	void SubBytes(
-		AESState& ioState)
+	//	Round keys in reverse order with InvMixColumns applied to the inner rounds.
+	void MakeDecryptKeys(
+		const uint32_t* inEncryptKeys,
+		uint32_t* outDecryptKeys)
 	{
-		for (int i = 0; i < 4; ++i)
+		const AESTables& tables = GetTables();
+		for (int round = 0; round < 15; ++round)
 		{
-			for (int j = 0; j < 4; ++j)
+			for (int n = 0; n < 4; ++n)
 			{
-				ioState.bytes[i][j] = sSBox[ioState.bytes[i][j]];
+				uint32_t w = inEncryptKeys[((14 - round) * 4) + n];
+				if ((round > 0) && (round < 14))
+				{
+					w = tables.mTd[0][sSBox[w >> 24]] ^
+						tables.mTd[1][sSBox[(w >> 16) & 0xff]] ^
+						tables.mTd[2][sSBox[(w >> 8) & 0xff]] ^
+						tables.mTd[3][sSBox[w & 0xff]];
+				}
+				outDecryptKeys[(round * 4) + n] = w;
 			}
 		}
 	}
-	
+
 	//
 	//
-	void InvSubBytes(
-		AESState& ioState)
+	inline void XorBlock(
+		const uint8_t* inA,
+		const uint8_t* inB,
+		uint8_t* outResult)
 	{
-		for (int i = 0; i < 4; ++i)
+		for (int n = 0; n < 16; ++n)
 		{
-			for (int j = 0; j < 4; ++j)
-			{
-				ioState.bytes[i][j] = sInvSBox[ioState.bytes[i][j]];
-			}
+			outResult[n] = inA[n] ^ inB[n];
 		}
 	}
 
+#if HERMIT_AES256_AESNI
+
 	//
 	//
-	void ShiftRows(
-		AESState& ioState)
+	bool CPUSupportsAESNI()
 	{
-		AESState tmpState = ioState;
-		
-		tmpState.bytes[0][1] = ioState.bytes[1][1];
-		tmpState.bytes[0][2] = ioState.bytes[2][2];
-		tmpState.bytes[0][3] = ioState.bytes[3][3];
-
-		tmpState.bytes[1][1] = ioState.bytes[2][1];
-		tmpState.bytes[1][2] = ioState.bytes[3][2];
-		tmpState.bytes[1][3] = ioState.bytes[0][3];
-
-		tmpState.bytes[2][1] = ioState.bytes[3][1];
-		tmpState.bytes[2][2] = ioState.bytes[0][2];
-		tmpState.bytes[2][3] = ioState.bytes[1][3];
-
-		tmpState.bytes[3][1] = ioState.bytes[0][1];
-		tmpState.bytes[3][2] = ioState.bytes[1][2];
-		tmpState.bytes[3][3] = ioState.bytes[2][3];
-
-		ioState = tmpState;
+		const CPUFeatures& features = GetCPUFeatures();
+		return features.mAES && features.mSSE2;
 	}
 
-	
 	//
 	//
-	void InvShiftRows(
-		AESState& ioState)
+	__attribute__((target("aes,sse2")))
+	void LoadRoundKeys(
+		const uint8_t* inKeyBytes,
+		__m128i* outKeys)
 	{
-		AESState tmpState = ioState;
-		
-		tmpState.bytes[1][1] = ioState.bytes[0][1];
-		tmpState.bytes[2][2] = ioState.bytes[0][2];
-		tmpState.bytes[3][3] = ioState.bytes[0][3];
-
-		tmpState.bytes[2][1] = ioState.bytes[1][1];
-		tmpState.bytes[3][2] = ioState.bytes[1][2];
-		tmpState.bytes[0][3] = ioState.bytes[1][3];
-
-		tmpState.bytes[3][1] = ioState.bytes[2][1];
-		tmpState.bytes[0][2] = ioState.bytes[2][2];
-		tmpState.bytes[1][3] = ioState.bytes[2][3];
-
-		tmpState.bytes[0][1] = ioState.bytes[3][1];
-		tmpState.bytes[1][2] = ioState.bytes[3][2];
-		tmpState.bytes[2][3] = ioState.bytes[3][3];
-
-		ioState = tmpState;
+		for (int n = 0; n < 15; ++n)
+		{
+			outKeys[n] = _mm_loadu_si128((const __m128i*)(inKeyBytes + (n * 16)));
+		}
 	}
-	
-#ifdef GEMULTIPLY_ENABLED
 
 	//
 	//
-	uint8_t GFMultiply(
-		uint8_t inA,
-		uint8_t inB)
+	__attribute__((target("aes,sse2")))
+	inline __m128i EncryptWithAESNI(
+		const __m128i* inKeys,
+		__m128i inBlock)
 	{
-		uint8_t result = 0;
-		for(int n = 0; n < 8; ++n)
+		__m128i b = _mm_xor_si128(inBlock, inKeys[0]);
+		for (int n = 1; n < 14; ++n)
 		{
-			if (inB & 1) 
-			{
-				result ^= inA;
-			}
-			bool hiBitSet = (inA & 0x80);
-			inA <<= 1;
-			if (hiBitSet) 
-			{
-				inA ^= 0x1b;
-			}
-			inB >>= 1;
+			b = _mm_aesenc_si128(b, inKeys[n]);
 		}
-		return result;
+		return _mm_aesenclast_si128(b, inKeys[14]);
 	}
 
-#endif
-
-	//
 	//
-	void MixColumns(
-		AESState& ioState)
+	//	Four independent blocks per pass keep the AES unit's pipeline full.
+	__attribute__((target("aes,sse2")))
+	void EncryptBlocksWithAESNI(
+		const uint8_t* inKeyBytes,
+		const uint8_t* inInput,
+		uint8_t* outOutput,
+		size_t inBlockCount)
 	{
-		uint8_t a[4];
-		uint8_t b[4];
-		for (int r = 0; r < 4; ++r)
+		__m128i keys[15];
+		LoadRoundKeys(inKeyBytes, keys);
+
+		size_t n = 0;
+		for (; (n + 4) <= inBlockCount; n += 4)
 		{
-			for (int c = 0; c < 4; ++c)
+			const __m128i* in = (const __m128i*)(inInput + (n * 16));
+			__m128i b0 = _mm_xor_si128(_mm_loadu_si128(in), keys[0]);
+			__m128i b1 = _mm_xor_si128(_mm_loadu_si128(in + 1), keys[0]);
+			__m128i b2 = _mm_xor_si128(_mm_loadu_si128(in + 2), keys[0]);
+			__m128i b3 = _mm_xor_si128(_mm_loadu_si128(in + 3), keys[0]);
+			for (int r = 1; r < 14; ++r)
 			{
-				a[c] = ioState.bytes[r][c];
-//				std::cout << "a[c] " << std::setw(2) << std::setfill('0') << std::hex << (int)a[c] << "\n";
-				
-				uint8_t h = ioState.bytes[r][c] & 0x80;
-//				std::cout << "h " << std::setw(2) << std::setfill('0') << std::hex << (int)h << "\n";
+				b0 = _mm_aesenc_si128(b0, keys[r]);
+				b1 = _mm_aesenc_si128(b1, keys[r]);
+				b2 = _mm_aesenc_si128(b2, keys[r]);
+				b3 = _mm_aesenc_si128(b3, keys[r]);
+			}
+			__m128i* out = (__m128i*)(outOutput + (n * 16));
+			_mm_storeu_si128(out, _mm_aesenclast_si128(b0, keys[14]));
+			_mm_storeu_si128(out + 1, _mm_aesenclast_si128(b1, keys[14]));
+			_mm_storeu_si128(out + 2, _mm_aesenclast_si128(b2, keys[14]));
+			_mm_storeu_si128(out + 3, _mm_aesenclast_si128(b3, keys[14]));
+		}
+		for (; n < inBlockCount; ++n)
+		{
+			__m128i b = _mm_loadu_si128((const __m128i*)(inInput + (n * 16)));
+			_mm_storeu_si128((__m128i*)(outOutput + (n * 16)), EncryptWithAESNI(keys, b));
+		}
+	}
 
-				b[c] = ioState.bytes[r][c] << 1;
-//				std::cout << "b[c] " << std::setw(2) << std::setfill('0') << std::hex << (int)b[c] << "\n";
+	//
+	//	CBC encryption is serial by construction: each block needs the previous cipher block.
+	__attribute__((target("aes,sse2")))
+	void EncryptBlocksCBCWithAESNI(
+		const uint8_t* inKeyBytes,
+		uint8_t* ioChain,
+		const uint8_t* inInput,
+		uint8_t* outOutput,
+		size_t inBlockCount)
+	{
+		__m128i keys[15];
+		LoadRoundKeys(inKeyBytes, keys);
 
-				if (h == 0x80)
-				{
-					b[c] ^= 0x1b;
-				}
-//				std::cout << "b[c] " << std::setw(2) << std::setfill('0') << std::hex << (int)b[c] << "\n";
-			}
-			ioState.bytes[r][0] = b[0] ^ a[3] ^ a[2] ^ b[1] ^ a[1];
-			ioState.bytes[r][1] = b[1] ^ a[0] ^ a[3] ^ b[2] ^ a[2];
-			ioState.bytes[r][2] = b[2] ^ a[1] ^ a[0] ^ b[3] ^ a[3];
-			ioState.bytes[r][3] = b[3] ^ a[2] ^ a[1] ^ b[0] ^ a[0];
-
-//			std::cout << "ioState.bytes[r][0] " << std::setw(2) << std::setfill('0') << std::hex << (int)ioState.bytes[r][0] << "\n";
-//			std::cout << "ioState.bytes[r][1] " << std::setw(2) << std::setfill('0') << std::hex << (int)ioState.bytes[r][1] << "\n";
-//			std::cout << "ioState.bytes[r][2] " << std::setw(2) << std::setfill('0') << std::hex << (int)ioState.bytes[r][2] << "\n";
-//			std::cout << "ioState.bytes[r][3] " << std::setw(2) << std::setfill('0') << std::hex << (int)ioState.bytes[r][3] << "\n";
+		__m128i chain = _mm_loadu_si128((const __m128i*)ioChain);
+		for (size_t n = 0; n < inBlockCount; ++n)
+		{
+			__m128i b = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(inInput + (n * 16))), chain);
+			chain = EncryptWithAESNI(keys, b);
+			_mm_storeu_si128((__m128i*)(outOutput + (n * 16)), chain);
 		}
+		_mm_storeu_si128((__m128i*)ioChain, chain);
 	}
-	
+
+	//
 	//
+	__attribute__((target("aes,sse2")))
+	inline __m128i DecryptWithAESNI(
+		const __m128i* inKeys,
+		__m128i inBlock)
+	{
+		__m128i b = _mm_xor_si128(inBlock, inKeys[0]);
+		for (int n = 1; n < 14; ++n)
+		{
+			b = _mm_aesdec_si128(b, inKeys[n]);
+		}
+		return _mm_aesdeclast_si128(b, inKeys[14]);
+	}
+
 	//
-	void InvMixColumns(
-		AESState& ioState)
+	//	inChain is null for ECB. For CBC, all four cipher blocks are loaded before any
+	//	output is stored, so decrypting in place is safe.
+	__attribute__((target("aes,sse2")))
+	void DecryptBlocksWithAESNI(
+		const uint8_t* inKeyBytes,
+		uint8_t* ioChain,
+		const uint8_t* inInput,
+		uint8_t* outOutput,
+		size_t inBlockCount)
 	{
-		uint8_t a[4];
-		for (int r = 0; r < 4; ++r)
+		__m128i keys[15];
+		LoadRoundKeys(inKeyBytes, keys);
+
+		__m128i chain = _mm_setzero_si128();
+		if (ioChain != nullptr)
+		{
+			chain = _mm_loadu_si128((const __m128i*)ioChain);
+		}
+
+		size_t n = 0;
+		for (; (n + 4) <= inBlockCount; n += 4)
 		{
-			for (int c = 0; c < 4; ++c)
+			const __m128i* in = (const __m128i*)(inInput + (n * 16));
+			__m128i c0 = _mm_loadu_si128(in);
+			__m128i c1 = _mm_loadu_si128(in + 1);
+			__m128i c2 = _mm_loadu_si128(in + 2);
+			__m128i c3 = _mm_loadu_si128(in + 3);
+			__m128i b0 = _mm_xor_si128(c0, keys[0]);
+			__m128i b1 = _mm_xor_si128(c1, keys[0]);
+			__m128i b2 = _mm_xor_si128(c2, keys[0]);
+			__m128i b3 = _mm_xor_si128(c3, keys[0]);
+			for (int r = 1; r < 14; ++r)
 			{
-				a[c] = ioState.bytes[r][c];
+				b0 = _mm_aesdec_si128(b0, keys[r]);
+				b1 = _mm_aesdec_si128(b1, keys[r]);
+				b2 = _mm_aesdec_si128(b2, keys[r]);
+				b3 = _mm_aesdec_si128(b3, keys[r]);
 			}
-			ioState.bytes[r][0] = sGFMultiply14[a[0]] ^ sGFMultiply11[a[1]] ^ sGFMultiply13[a[2]] ^ sGFMultiply9[a[3]];
-			ioState.bytes[r][1] = sGFMultiply9[a[0]]  ^ sGFMultiply14[a[1]] ^ sGFMultiply11[a[2]] ^ sGFMultiply13[a[3]];
-			ioState.bytes[r][2] = sGFMultiply13[a[0]] ^ sGFMultiply9[a[1]]  ^ sGFMultiply14[a[2]] ^ sGFMultiply11[a[3]];
-			ioState.bytes[r][3] = sGFMultiply11[a[0]] ^ sGFMultiply13[a[1]] ^ sGFMultiply9[a[2]]  ^ sGFMultiply14[a[3]];
+			b0 = _mm_aesdeclast_si128(b0, keys[14]);
+			b1 = _mm_aesdeclast_si128(b1, keys[14]);
+			b2 = _mm_aesdeclast_si128(b2, keys[14]);
+			b3 = _mm_aesdeclast_si128(b3, keys[14]);
+			if (ioChain != nullptr)
+			{
+				b0 = _mm_xor_si128(b0, chain);
+				b1 = _mm_xor_si128(b1, c0);
+				b2 = _mm_xor_si128(b2, c1);
+				b3 = _mm_xor_si128(b3, c2);
+				chain = c3;
+			}
+			__m128i* out = (__m128i*)(outOutput + (n * 16));
+			_mm_storeu_si128(out, b0);
+			_mm_storeu_si128(out + 1, b1);
+			_mm_storeu_si128(out + 2, b2);
+			_mm_storeu_si128(out + 3, b3);
+		}
+		for (; n < inBlockCount; ++n)
+		{
+			__m128i c = _mm_loadu_si128((const __m128i*)(inInput + (n * 16)));
+			__m128i b = DecryptWithAESNI(keys, c);
+			if (ioChain != nullptr)
+			{
+				b = _mm_xor_si128(b, chain);
+				chain = c;
+			}
+			_mm_storeu_si128((__m128i*)(outOutput + (n * 16)), b);
+		}
+		if (ioChain != nullptr)
+		{
+			_mm_storeu_si128((__m128i*)ioChain, chain);
 		}
 	}
+
+#endif
+
 			
 	//
 	//
@@ -509,6 +671,7 @@ void KeyExpansion(
 	}
 }
 
+
 //
 //
 void Encode(
@@ -516,81 +679,248 @@ void Encode(
 	const AESKeySchedule& inKeySchedule,
 	AESBlock& outResult)
 {
-	AESState state;
-	AESBlockToAESState(inInput, state);
-	PrintState("initial    ", state);
-	
-	AddRoundKey(state, &inKeySchedule.words[0]);
-	PrintState("AddRoundKey", state);
-
-	for (int n = 0; n < 13; ++n)
-	{
-		SubBytes(state);
-		PrintState("SubBytes   ", state);
+	EncryptBlockWithTables(GetTables(), inKeySchedule.words, inInput.bytes, outResult.bytes);
+}
 
-		ShiftRows(state);
-		PrintState("ShiftRows  ", state);
+//
+//	Single blocks go through the tables; bulk callers should use AES256Cipher, which
+//	prepares the decryption round keys once instead of per block.
+void Decode(
+	const AESBlock& inInput,
+	const AESKeySchedule& inKeySchedule,
+	AESBlock& outResult)
+{
+	uint32_t decryptKeys[60];
+	MakeDecryptKeys(inKeySchedule.words, decryptKeys);
+	DecryptBlockWithTables(GetTables(), decryptKeys, inInput.bytes, outResult.bytes);
+}
 
-		MixColumns(state);
-		PrintState("MixColumns ", state);
+//
+//
+AES256Cipher::AES256Cipher(
+	const AESKey& inKey)
+	:
+	mUseAESNI(false)
+{
+	AESKeySchedule keySchedule;
+	KeyExpansion(inKey, keySchedule);
+	memcpy(mEncryptKeys, keySchedule.words, sizeof(mEncryptKeys));
+	MakeDecryptKeys(mEncryptKeys, mDecryptKeys);
+	for (int n = 0; n < 60; ++n)
+	{
+		StoreWord(mEncryptKeys[n], mEncryptKeyBytes + (n * 4));
+		StoreWord(mDecryptKeys[n], mDecryptKeyBytes + (n * 4));
+	}
+#if HERMIT_AES256_AESNI
+	static const bool sCPUSupportsAESNI = CPUSupportsAESNI();
+	mUseAESNI = sCPUSupportsAESNI;
+#endif
+}
 
-		AddRoundKey(state, &inKeySchedule.words[(n + 1) * 4]);
-		PrintState("AddRoundKey", state);
+//
+//
+bool AES256Cipher::SetUsesAESNI(
+	bool inUseAESNI)
+{
+	if (inUseAESNI)
+	{
+#if HERMIT_AES256_AESNI
+		static const bool sCPUSupportsAESNI = CPUSupportsAESNI();
+		if (!sCPUSupportsAESNI)
+		{
+			return false;
+		}
+#else
+		return false;
+#endif
 	}
-	PrintState("end loop   ", state);
+	mUseAESNI = inUseAESNI;
+	return true;
+}
 
-	SubBytes(state);
-	PrintState("SubBytes   ", state);
+//
+//
+void AES256Cipher::EncryptBlocks(
+	const uint8_t* inInput,
+	uint8_t* outOutput,
+	size_t inBlockCount) const
+{
+#if HERMIT_AES256_AESNI
+	if (mUseAESNI)
+	{
+		EncryptBlocksWithAESNI(mEncryptKeyBytes, inInput, outOutput, inBlockCount);
+		return;
+	}
+#endif
+	const AESTables& tables = GetTables();
+	for (size_t n = 0; n < inBlockCount; ++n)
+	{
+		EncryptBlockWithTables(tables, mEncryptKeys, inInput + (n * 16), outOutput + (n * 16));
+	}
+}
 
-	ShiftRows(state);
-	PrintState("ShiftRows  ", state);
+//
+//
+void AES256Cipher::DecryptBlocks(
+	const uint8_t* inInput,
+	uint8_t* outOutput,
+	size_t inBlockCount) const
+{
+#if HERMIT_AES256_AESNI
+	if (mUseAESNI)
+	{
+		DecryptBlocksWithAESNI(mDecryptKeyBytes, nullptr, inInput, outOutput, inBlockCount);
+		return;
+	}
+#endif
+	const AESTables& tables = GetTables();
+	for (size_t n = 0; n < inBlockCount; ++n)
+	{
+		DecryptBlockWithTables(tables, mDecryptKeys, inInput + (n * 16), outOutput + (n * 16));
+	}
+}
 
-	AddRoundKey(state, &inKeySchedule.words[56]);
-	PrintState("AddRoundKey", state);
-	
-	AESStateToAESBlock(state, outResult);
+//
+//
+void AES256Cipher::EncryptBlocksCBC(
+	AESBlock& ioChain,
+	const uint8_t* inInput,
+	uint8_t* outOutput,
+	size_t inBlockCount) const
+{
+#if HERMIT_AES256_AESNI
+	if (mUseAESNI)
+	{
+		EncryptBlocksCBCWithAESNI(mEncryptKeyBytes, ioChain.bytes, inInput, outOutput, inBlockCount);
+		return;
+	}
+#endif
+	const AESTables& tables = GetTables();
+	const uint8_t* chain = ioChain.bytes;
+	for (size_t n = 0; n < inBlockCount; ++n)
+	{
+		uint8_t block[16];
+		XorBlock(inInput + (n * 16), chain, block);
+		EncryptBlockWithTables(tables, mEncryptKeys, block, outOutput + (n * 16));
+		chain = outOutput + (n * 16);
+	}
+	if (inBlockCount > 0)
+	{
+		memcpy(ioChain.bytes, chain, 16);
+	}
 }
 
 //
 //
-void Decode(
-	const AESBlock& inInput,
-	const AESKeySchedule& inKeySchedule,
-	AESBlock& outResult)
+void AES256Cipher::DecryptBlocksCBC(
+	AESBlock& ioChain,
+	const uint8_t* inInput,
+	uint8_t* outOutput,
+	size_t inBlockCount) const
 {
-	AESState state;
-	AESBlockToAESState(inInput, state);
-	PrintState("initial      ", state);
-	
-	AddRoundKey(state, &inKeySchedule.words[56]);
-	PrintState("AddRoundKey  ", state);
+#if HERMIT_AES256_AESNI
+	if (mUseAESNI)
+	{
+		DecryptBlocksWithAESNI(mDecryptKeyBytes, ioChain.bytes, inInput, outOutput, inBlockCount);
+		return;
+	}
+#endif
+	const AESTables& tables = GetTables();
+	for (size_t n = 0; n < inBlockCount; ++n)
+	{
+		//	keep the cipher block; outOutput may overwrite it
+		uint8_t cipherBlock[16];
+		memcpy(cipherBlock, inInput + (n * 16), 16);
+		uint8_t block[16];
+		DecryptBlockWithTables(tables, mDecryptKeys, cipherBlock, block);
+		XorBlock(block, ioChain.bytes, outOutput + (n * 16));
+		memcpy(ioChain.bytes, cipherBlock, 16);
+	}
+}
 
-	for (int n = 12; n >= 0; --n)
+namespace
+{
+	//
+	//	Slice n chains from the last cipher block of slice n - 1, which is still intact
+	//	because the input is never written.
+	class DecryptSlicesJob : public ParallelSlicesJob
 	{
-		InvShiftRows(state);
-		PrintState("InvShiftRows ", state);
+	public:
+		//
+		DecryptSlicesJob(
+			const AES256Cipher& inCipher,
+			const AESBlock& inChain,
+			const uint8_t* inInput,
+			uint8_t* outOutput,
+			size_t inBlockCount,
+			size_t inBlocksPerSlice)
+			:
+			mCipher(inCipher),
+			mChain(inChain),
+			mInput(inInput),
+			mOutput(outOutput),
+			mBlockCount(inBlockCount),
+			mBlocksPerSlice(inBlocksPerSlice)
+		{
+		}
 
-		InvSubBytes(state);
-		PrintState("InvSubBytes  ", state);
+		//
+		virtual void RunSlice(size_t sliceIndex) override
+		{
+			size_t start = sliceIndex * mBlocksPerSlice;
+			if (start >= mBlockCount)
+			{
+				return;
+			}
+			size_t count = mBlockCount - start;
+			if (count > mBlocksPerSlice)
+			{
+				count = mBlocksPerSlice;
+			}
+			AESBlock chain = mChain;
+			if (start > 0)
+			{
+				memcpy(chain.bytes, mInput + ((start - 1) * 16), 16);
+			}
+			mCipher.DecryptBlocksCBC(chain, mInput + (start * 16), mOutput + (start * 16), count);
+		}
 
-		AddRoundKey(state, &inKeySchedule.words[(n + 1) * 4]);
-		PrintState("AddRoundKey  ", state);
+		//
+		const AES256Cipher& mCipher;
+		AESBlock mChain;
+		const uint8_t* mInput;
+		uint8_t* mOutput;
+		size_t mBlockCount;
+		size_t mBlocksPerSlice;
+	};
+}
 
-		InvMixColumns(state);
-		PrintState("InvMixColumns", state);
+//
+//
+void AES256Cipher::DecryptBlocksCBCParallel(
+	const AESBlock& inChain,
+	const uint8_t* inInput,
+	uint8_t* outOutput,
+	size_t inBlockCount) const
+{
+	// hardware_concurrency is a system call on some platforms, too slow to repeat per call
+	static const size_t sCoreCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+	size_t sliceCount = sCoreCount;
+	size_t maxSlices = inBlockCount / kMinBlocksPerDecryptThread;
+	if (sliceCount > maxSlices)
+	{
+		sliceCount = maxSlices;
+	}
+	if (sliceCount <= 1)
+	{
+		AESBlock chain = inChain;
+		DecryptBlocksCBC(chain, inInput, outOutput, inBlockCount);
+		return;
 	}
-	PrintState("end loop     ", state);
-
-	InvShiftRows(state);
-	PrintState("InvShiftRows ", state);
-
-	InvSubBytes(state);
-	PrintState("InvSubBytes  ", state);
 
-	AddRoundKey(state, &inKeySchedule.words[0]);
-	PrintState("AddRoundKey  ", state);
-	
-	AESStateToAESBlock(state, outResult);
+	size_t blocksPerSlice = (inBlockCount + sliceCount - 1) / sliceCount;
+	DecryptSlicesJob job(*this, inChain, inInput, outOutput, inBlockCount, blocksPerSlice);
+	RunParallelSlices(job, sliceCount);
 }
 
 } // namespace encoding
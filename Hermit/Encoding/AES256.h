@@ -19,6 +19,9 @@
 #ifndef AES256_h
 #define AES256_h
 
+#include <stddef.h>
+#include <stdint.h>
+
 namespace hermit {
 namespace encoding {
 
@@ -63,6 +66,86 @@ void Decode(
 	const AESKeySchedule& inKeySchedule,
 	AESBlock& outResult);
 
+//
+//	An AES-256 key expanded once for bulk work. Holds the encryption round keys and the
+//	equivalent-inverse-cipher decryption round keys, and picks the fastest engine this CPU
+//	supports: AES-NI where available (selected at runtime), 32-bit T-tables otherwise.
+//	Input and output buffers may be the same; they need no particular alignment.
+class AES256Cipher
+{
+public:
+	//
+	//
+	explicit AES256Cipher(
+		const AESKey& inKey);
+
+	//
+	//	Encrypts inBlockCount independent 16-byte blocks (ECB).
+	void EncryptBlocks(
+		const uint8_t* inInput,
+		uint8_t* outOutput,
+		size_t inBlockCount) const;
+
+	//
+	//	Decrypts inBlockCount independent 16-byte blocks (ECB).
+	void DecryptBlocks(
+		const uint8_t* inInput,
+		uint8_t* outOutput,
+		size_t inBlockCount) const;
+
+	//
+	//	CBC encryption. ioChain holds the input vector (or the previous cipher block) on
+	//	entry and the last cipher block written on return, so a stream can be encrypted in
+	//	pieces.
+	void EncryptBlocksCBC(
+		AESBlock& ioChain,
+		const uint8_t* inInput,
+		uint8_t* outOutput,
+		size_t inBlockCount) const;
+
+	//
+	//	CBC decryption, chained the same way as EncryptBlocksCBC.
+	void DecryptBlocksCBC(
+		AESBlock& ioChain,
+		const uint8_t* inInput,
+		uint8_t* outOutput,
+		size_t inBlockCount) const;
+
+	//
+	//	CBC decryption split across cores. Each plaintext block depends only on cipher
+	//	blocks i and i - 1, so large inputs are cut into slices that are decrypted on the
+	//	calling thread and ThreadPool workers; small inputs are decrypted on the calling thread. inChain is the
+	//	input vector (or previous cipher block). Unlike the other calls, outOutput must not
+	//	overlap inInput.
+	void DecryptBlocksCBCParallel(
+		const AESBlock& inChain,
+		const uint8_t* inInput,
+		uint8_t* outOutput,
+		size_t inBlockCount) const;
+
+	//
+	//
+	bool UsesAESNI() const
+	{
+		return mUseAESNI;
+	}
+
+	//
+	//	Pins the engine so hermit_bench can measure both. Returns false, leaving the engine
+	//	unchanged, if AES-NI is asked for and this CPU can't run it.
+	bool SetUsesAESNI(
+		bool inUseAESNI);
+
+private:
+	//
+	//
+	uint32_t mEncryptKeys[60];
+	uint32_t mDecryptKeys[60];
+	uint8_t mEncryptKeyBytes[240];
+	uint8_t mDecryptKeyBytes[240];
+	bool mUseAESNI;
+};
+
 } // namespace encoding
 } // namespace hermit
 
@@ -16,6 +16,7 @@
 //	along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#include <memory.h>
 #include <string>
 #include "Hermit/Foundation/Notification.h"
 #include "AES256.h"
@@ -25,18 +26,23 @@ namespace hermit {
 	namespace encoding {
 		
 		//
-		//
-		void AES256DecryptCBC(const HermitPtr& h_,
-							  const DataBuffer& inCipherText,
-							  const std::string& inKey,
-							  const std::string& inInputVector,
-							  const AES256DecryptCBCCallbackRef& inCallback)
+		bool AES256DecryptCBCIntoBuffer(const HermitPtr& h_,
+										const DataBuffer& inCipherText,
+										const std::string& inKey,
+										const std::string& inInputVector,
+										char* outPlainText,
+										uint64_t& outPlainTextSize)
 		{
 			if (inCipherText.second == 0)
 			{
 				NOTIFY_ERROR(h_, "AES256DecryptCBC: no cipherText?");
-				inCallback.Call(false, DataBuffer());
-				return;
+				return false;
+			}
+			size_t textSize = (size_t)inCipherText.second;
+			if ((textSize % 16) != 0)
+			{
+				NOTIFY_ERROR(h_, "AES256DecryptCBC: cipherText size is not a multiple of 16.");
+				return false;
 			}
 			
 			AESKey key;
@@ -50,18 +56,10 @@ namespace hermit {
 			{
 				key.bytes[n] = inKey[n];
 			}
-			AESKeySchedule keySchedule;
-			KeyExpansion(key, keySchedule);
-			
-			size_t textSize = (size_t)inCipherText.second;
-			uint64_t blocks = textSize / 16;
-			if (textSize % 16 != 0)
-			{
-				blocks++;
-			}
+			AES256Cipher cipher(key);
 			
-			AESBlock previousBlock;
-			memset(&previousBlock, 0, sizeof(AESBlock));
+			AESBlock inputVector;
+			memset(&inputVector, 0, sizeof(AESBlock));
 			
 			uint64_t inputVectorSize = inInputVector.size();
 			uint64_t bytes = 16;
@@ -71,52 +69,14 @@ namespace hermit {
 			}
 			for (uint64_t x = 0; x < bytes; ++x)
 			{
-				previousBlock.bytes[x] = inInputVector[x];
-			}
-			
-			std::string plainText;
-			size_t pos = 0;
-			for (uint64_t n = 0; n < blocks; ++n)
-			{
-				AESBlock block;
-				memset(&block, 0, sizeof(AESBlock));
-				
-				uint64_t bytes = 16;
-				if (bytes > (textSize - pos))
-				{
-					bytes = textSize - pos;
-				}
-				for (uint64_t x = 0; x < bytes; ++x)
-				{
-					block.bytes[x] = inCipherText.first[pos];
-					++pos;
-				}
-				
-				AESBlock result;
-				memset(&result, 0, sizeof(AESBlock));
-				Decode(block, keySchedule, result);
-				
-				for (uint64_t x = 0; x < 16; ++x)
-				{
-					result.bytes[x] ^= previousBlock.bytes[x];
-				}
-				
-				for (uint64_t x = 0; x < 16; ++x)
-				{
-					plainText += result.bytes[x];
-				}
-				
-				previousBlock = block;
+				inputVector.bytes[x] = inInputVector[x];
 			}
 			
-			//	Plaintext is not allowed to be empty at this stage because there
-			//	should always be padding.
-			if (plainText.empty())
-			{
-				NOTIFY_ERROR(h_, "AES256DecryptCBC: plainText is empty.");
-				inCallback.Call(false, DataBuffer());
-				return;
-			}
+			uint8_t* plainText = (uint8_t*)outPlainText;
+			cipher.DecryptBlocksCBCParallel(inputVector,
+											(const uint8_t*)inCipherText.first,
+											plainText,
+											textSize / 16);
 			
 			//	pkcs7padding should always be present, and should be
 			//	a value from 1 to 16 inclusive. The padding should be one of:
@@ -124,38 +84,46 @@ namespace hermit {
 			//	02 02
 			//	03 03 03
 			//	etc.
-			uint8_t pkcs7padding = plainText[plainText.size() - 1];
+			uint8_t pkcs7padding = plainText[textSize - 1];
 			if (pkcs7padding > 16)
 			{
 				NOTIFY_ERROR(h_, "AES256DecryptCBC: pkcs7padding > 16.");
-				inCallback.Call(false, DataBuffer());
-				return;
+				return false;
 			}
 			if (pkcs7padding == 0)
 			{
 				NOTIFY_ERROR(h_, "AES256DecryptCBC: pkcs7padding is 0.");
-				inCallback.Call(false, DataBuffer());
-				return;
-			}
-			if (pkcs7padding > plainText.size())
-			{
-				NOTIFY_ERROR(h_, "AES256DecryptCBC: pkcs7padding > plainText.size()");
-				inCallback.Call(false, DataBuffer());
-				return;
+				return false;
 			}
 			for (size_t x = 1; x < pkcs7padding; ++x)
 			{
-				if (plainText[plainText.size() - 1 - x] != pkcs7padding)
+				if (plainText[textSize - 1 - x] != pkcs7padding)
 				{
 					NOTIFY_ERROR(h_, "AES256DecryptCBC: pkcs7padding bytes corrupted.");
-					inCallback.Call(false, DataBuffer());
-					return;
+					return false;
 				}
 			}
-			plainText.resize(plainText.size() - pkcs7padding);
-			
-			inCallback.Call(true, DataBuffer(plainText.data(), plainText.size()));
-		}	
+			outPlainTextSize = textSize - pkcs7padding;
+			return true;
+		}
+		
+		//
+		//
+		void AES256DecryptCBC(const HermitPtr& h_,
+							  const DataBuffer& inCipherText,
+							  const std::string& inKey,
+							  const std::string& inInputVector,
+							  const AES256DecryptCBCCallbackRef& inCallback)
+		{
+			std::string plainText(inCipherText.second, 0);
+			uint64_t plainTextSize = 0;
+			if (!AES256DecryptCBCIntoBuffer(h_, inCipherText, inKey, inInputVector, &plainText[0], plainTextSize))
+			{
+				inCallback.Call(false, DataBuffer());
+				return;
+			}
+			inCallback.Call(true, DataBuffer(plainText.data(), (size_t)plainTextSize));
+		}
 		
 	} // namespace encoding
 } // namespace hermit
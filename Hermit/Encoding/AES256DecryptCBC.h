@@ -60,6 +60,17 @@ namespace hermit {
 							  const std::string& inInputVector,
 							  const AES256DecryptCBCCallbackRef& inCallback);
 		
+		//
+		//	Decrypts straight into outPlainText, which must have room for inCipherText.second
+		//	bytes and must not overlap inCipherText. Large inputs are decrypted on several
+		//	cores. On success outPlainTextSize is the size left once the padding is removed.
+		bool AES256DecryptCBCIntoBuffer(const HermitPtr& h_,
+										const DataBuffer& inCipherText,
+										const std::string& inKey,
+										const std::string& inInputVector,
+										char* outPlainText,
+										uint64_t& outPlainTextSize);
+		
 	} // namespace encoding
 } // namespace hermit
 
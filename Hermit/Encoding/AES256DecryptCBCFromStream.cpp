@@ -36,11 +36,11 @@ namespace hermit {
 			public:
 				//
 				//
-				AES256StreamCalculator(const AESKeySchedule& inKeySchedule,
+				AES256StreamCalculator(const AES256Cipher& inCipher,
 									   const AESBlock& inPreviousBlock,
 									   const AES256DecryptCallbackRef& inCallback)
 				:
-				mKeySchedule(inKeySchedule),
+				mCipher(inCipher),
 				mPreviousBlock(inPreviousBlock),
 				mCallback(inCallback),
 				mSuccess(false)
@@ -48,7 +48,9 @@ namespace hermit {
 				}
 				
 				//
-				//
+				//	Whole blocks are decrypted straight out of inData; a trailing partial block
+				//	waits in mCipherText for the next push. The last plain block is held back
+				//	until the end of the stream, since it's the one carrying the padding.
 				virtual bool Function(const HermitPtr& h_,
 									  const bool& inSuccess,
 									  const DataBuffer& inData,
@@ -57,57 +59,56 @@ namespace hermit {
 					mSuccess = inSuccess;
 					if (inSuccess)
 					{
-						if (inData.second)
-						{
-							mPlainText.append(inData.first, inData.second);
-						}
+						const uint8_t* data = (const uint8_t*)inData.first;
+						size_t dataSize = (size_t)inData.second;
+						size_t blocks = (mCipherText.size() + dataSize) / 16;
 						
 						std::string plainText;
+						plainText.resize(mHeldBlock.size() + (blocks * 16));
+						memcpy(&plainText[0], mHeldBlock.data(), mHeldBlock.size());
+						uint8_t* output = (uint8_t*)&plainText[0] + mHeldBlock.size();
+						mHeldBlock.clear();
 						
-						size_t pos = 0;
-						size_t bytesRemaining = mPlainText.size();
-						while (bytesRemaining > 0)
+						if (!mCipherText.empty() && (blocks > 0))
 						{
-							AESBlock block;
-							memset(&block, 0, sizeof(AESBlock));
-							
-							uint64_t bytes = 16;
-							if (bytes > bytesRemaining) {
-								NOTIFY_ERROR(h_, "AES256DecryptCBCFromStream: bytes > bytesRemaining.");
+							size_t fill = 16 - mCipherText.size();
+							mCipherText.append((const char*)data, fill);
+							data += fill;
+							dataSize -= fill;
+							mCipher.DecryptBlocksCBC(mPreviousBlock, (const uint8_t*)mCipherText.data(), output, 1);
+							output += 16;
+							--blocks;
+							mCipherText.clear();
+						}
+						if (blocks > 0)
+						{
+							mCipher.DecryptBlocksCBCParallel(mPreviousBlock, data, output, blocks);
+							memcpy(mPreviousBlock.bytes, data + ((blocks - 1) * 16), 16);
+							data += blocks * 16;
+							dataSize -= blocks * 16;
+						}
+						if (dataSize > 0)
+						{
+							mCipherText.append((const char*)data, dataSize);
+						}
+						
+						if (inEndOfStream) {
+							if (!mCipherText.empty()) {
+								NOTIFY_ERROR(h_, "AES256DecryptCBCFromStream: cipherText size is not a multiple of 16.");
 								return mCallback.Call(kAES256DecryptCallbackStatus_Error, DataBuffer(), true);
 							}
-							for (size_t x = 0; x < bytes; ++x)
-							{
-								block.bytes[x] = mPlainText[pos];
-								++pos;
-							}
-							
-							AESBlock result;
-							memset(&result, 0, sizeof(AESBlock));
-							Decode(block, mKeySchedule, result);
-							
-							for (uint64_t x = 0; x < 16; ++x)
-							{
-								result.bytes[x] ^= mPreviousBlock.bytes[x];
-							}
-							
-							for (uint64_t x = 0; x < 16; ++x)
-							{
-								plainText += result.bytes[x];
+							if (plainText.empty()) {
+								NOTIFY_ERROR(h_, "AES256DecryptCBCFromStream: plainText is empty.");
+								return mCallback.Call(kAES256DecryptCallbackStatus_Error, DataBuffer(), true);
 							}
 							
-							mPreviousBlock = block;
-							bytesRemaining -= bytes;
-						}
-						
-						if (inEndOfStream) {
 							//	pkcs7padding should always be present, and should be
 							//	a value from 1 to 16 inclusive. The padding should be one of:
 							//	01
 							//	02 02
 							//	03 03 03
 							//	etc.
-							size_t pkcs7padding = plainText[plainText.size() - 1];
+							size_t pkcs7padding = (uint8_t)plainText[plainText.size() - 1];
 							if (pkcs7padding > 16) {
 								NOTIFY_ERROR(h_, "AES256DecryptCBCFromStream: pkcs7padding > 16.");
 								return mCallback.Call(kAES256DecryptCallbackStatus_Error, DataBuffer(), true);
@@ -116,21 +117,18 @@ namespace hermit {
 								NOTIFY_ERROR(h_, "AES256DecryptCBCFromStream: pkcs7padding is 0.");
 								return mCallback.Call(kAES256DecryptCallbackStatus_Error, DataBuffer(), true);
 							}
-							if (pkcs7padding > plainText.size()) {
-								NOTIFY_ERROR(h_, "AES256DecryptCBCFromStream: pkcs7padding > plainText.size()");
-								return mCallback.Call(kAES256DecryptCallbackStatus_Error, DataBuffer(), true);
-							}
 							for (size_t x = 1; x < pkcs7padding; ++x) {
-								if (plainText[plainText.size() - 1 - x] != pkcs7padding) {
+								if ((uint8_t)plainText[plainText.size() - 1 - x] != pkcs7padding) {
 									NOTIFY_ERROR(h_, "AES256DecryptCBCFromStream: pkcs7padding bytes corrupted.");
 									return mCallback.Call(kAES256DecryptCallbackStatus_Error, DataBuffer(), true);
 								}
 							}
 							plainText.resize(plainText.size() - pkcs7padding);
 						}
-						else
+						else if (!plainText.empty())
 						{
-							mPlainText = mPlainText.substr(mPlainText.size() - bytesRemaining);
+							mHeldBlock.assign(plainText, plainText.size() - 16, 16);
+							plainText.resize(plainText.size() - 16);
 						}
 						return mCallback.Call(kAES256DecryptCallbackStatus_Success,
 											  DataBuffer(plainText.data(), plainText.size()),
@@ -141,11 +139,12 @@ namespace hermit {
 				
 				//
 				//
-				AESKeySchedule mKeySchedule;
+				const AES256Cipher& mCipher;
 				AESBlock mPreviousBlock;
 				const AES256DecryptCallbackRef& mCallback;
 				bool mSuccess;
-				std::string mPlainText;
+				std::string mCipherText;
+				std::string mHeldBlock;
 			};
 			
 		} // private namespace
@@ -169,8 +168,7 @@ namespace hermit {
 			{
 				key.bytes[n] = inKey[n];
 			}
-			AESKeySchedule keySchedule;
-			KeyExpansion(key, keySchedule);
+			AES256Cipher cipher(key);
 			
 			AESBlock previousBlock;
 			memset(&previousBlock, 0, sizeof(AESBlock));
@@ -186,7 +184,7 @@ namespace hermit {
 				previousBlock.bytes[x] = inInputVector[x];
 			}
 			
-			AES256StreamCalculator calculator(keySchedule, previousBlock, inCallback);
+			AES256StreamCalculator calculator(cipher, previousBlock, inCallback);
 			if (!inFunction.Call(calculator))
 			{
 				inCallback.Call(kAES256DecryptCallbackStatus_Aborted, DataBuffer(), true);
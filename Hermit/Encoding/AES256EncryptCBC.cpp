@@ -26,11 +26,20 @@ namespace hermit {
 		
 		//
 		//
-		void AES256EncryptCBC(const HermitPtr& h_,
-							  const DataBuffer& inPlainText,
-							  const std::string& inKey,
-							  const std::string& inInputVector,
-							  const AES256EncryptCBCCallbackRef& inCallback)
+		uint64_t AES256EncryptCBCSize(uint64_t inPlainTextSize)
+		{
+			//	PKCS7 always adds a block's worth or less of padding, so the output is exactly
+			//	one block longer than the whole blocks of input.
+			return ((inPlainTextSize / 16) + 1) * 16;
+		}
+		
+		//
+		//
+		AES256EncryptCBCStatus AES256EncryptCBCInto(const HermitPtr& h_,
+													const DataBuffer& inPlainText,
+													const std::string& inKey,
+													const std::string& inInputVector,
+													char* outCipherText)
 		{
 			AESKey key;
 			memset(&key, 0, sizeof(AESKey));
@@ -43,19 +52,13 @@ namespace hermit {
 			{
 				key.bytes[n] = inKey[n];
 			}
-			AESKeySchedule keySchedule;
-			KeyExpansion(key, keySchedule);
-			
-			//	for (int n = 0; n < 60; ++n)
-			//	{
-			//		std::cout << "  " << n << " => " << keySchedule.words[n] << "\n";
-			//	}
+			AES256Cipher cipher(key);
 			
 			uint64_t textSize = inPlainText.second;
-			uint64_t blocks = (textSize / 16) + 1;
+			uint64_t fullBlocks = textSize / 16;
 			
-			AESBlock previousBlock;
-			memset(&previousBlock, 0, sizeof(AESBlock));
+			AESBlock chain;
+			memset(&chain, 0, sizeof(AESBlock));
 			
 			uint64_t inputVectorSize = inInputVector.size();
 			uint64_t bytes = 16;
@@ -65,59 +68,56 @@ namespace hermit {
 			}
 			for (uint64_t x = 0; x < bytes; ++x)
 			{
-				previousBlock.bytes[x] = inInputVector[x];
+				chain.bytes[x] = inInputVector[x];
 			}
 			
-			std::string cipherText;
-			size_t pos = 0;
-			for (uint64_t n = 0; n < blocks; ++n)
+			const uint8_t* plainText = (const uint8_t*)inPlainText.first;
+			uint8_t* output = (uint8_t*)outCipherText;
+			
+			const uint64_t kBlocksPerAbortCheck = 100000;
+			uint64_t blocksDone = 0;
+			while (blocksDone < fullBlocks)
 			{
-				if (((n + 1) % 100000) == 0)
-				{
-					if (CHECK_FOR_ABORT(h_))
-					{
-						inCallback.Call(kAES256EncryptCBC_Canceled, DataBuffer());
-						return;
-					}
-				}
-				
-				AESBlock block;
-				memset(&block, 0, sizeof(AESBlock));
-				
-				uint64_t bytes = 16;
-				if (bytes > (textSize - pos))
-				{
-					bytes = textSize - pos;
-				}
-				for (uint64_t x = 0; x < bytes; ++x)
-				{
-					block.bytes[x] = inPlainText.first[pos];
-					++pos;
-				}
-				if (bytes < 16)
+				if ((blocksDone > 0) && CHECK_FOR_ABORT(h_))
 				{
-					uint8_t pkcs7padding = 16 - bytes;
-					for (uint64_t x = 0; x < pkcs7padding; ++x)
-					{
-						block.bytes[bytes + x] = pkcs7padding;
-					}
+					return kAES256EncryptCBC_Canceled;
 				}
-				
-				for (uint64_t x = 0; x < 16; x++)
+				uint64_t count = fullBlocks - blocksDone;
+				if (count > kBlocksPerAbortCheck)
 				{
-					block.bytes[x] ^= previousBlock.bytes[x];
+					count = kBlocksPerAbortCheck;
 				}
-				
-				AESBlock result;
-				memset(&result, 0, sizeof(AESBlock));
-				Encode(block, keySchedule, result);
-				
-				for (uint64_t x = 0; x < 16; ++x)
-				{
-					cipherText += result.bytes[x];
-				}
-				
-				previousBlock = result;
+				cipher.EncryptBlocksCBC(chain, plainText + (blocksDone * 16), output + (blocksDone * 16), (size_t)count);
+				blocksDone += count;
+			}
+			
+			AESBlock lastBlock;
+			uint64_t remainder = textSize - (fullBlocks * 16);
+			uint8_t pkcs7padding = (uint8_t)(16 - remainder);
+			memset(&lastBlock, pkcs7padding, sizeof(AESBlock));
+			if (remainder > 0)
+			{
+				memcpy(lastBlock.bytes, plainText + (fullBlocks * 16), (size_t)remainder);
+			}
+			cipher.EncryptBlocksCBC(chain, lastBlock.bytes, output + (fullBlocks * 16), 1);
+			return kAES256EncryptCBC_Success;
+		}
+		
+		//
+		//
+		void AES256EncryptCBC(const HermitPtr& h_,
+							  const DataBuffer& inPlainText,
+							  const std::string& inKey,
+							  const std::string& inInputVector,
+							  const AES256EncryptCBCCallbackRef& inCallback)
+		{
+			std::string cipherText;
+			cipherText.resize((size_t)AES256EncryptCBCSize(inPlainText.second));
+			AES256EncryptCBCStatus status = AES256EncryptCBCInto(h_, inPlainText, inKey, inInputVector, &cipherText[0]);
+			if (status != kAES256EncryptCBC_Success)
+			{
+				inCallback.Call(status, DataBuffer());
+				return;
 			}
 			inCallback.Call(kAES256EncryptCBC_Success, DataBuffer(cipherText.data(), cipherText.size()));
 		}
@@ -85,6 +85,20 @@ namespace hermit {
 							  const std::string& inInputVector,
 							  const AES256EncryptCBCCallbackRef& inCallback);
 		
+		//
+		//	The size of the cipher text for inPlainTextSize bytes: the whole blocks plus one
+		//	block of PKCS7 padding.
+		uint64_t AES256EncryptCBCSize(uint64_t inPlainTextSize);
+		
+		//
+		//	Like AES256EncryptCBC, but writes the cipher text to outCipherText, which must hold
+		//	AES256EncryptCBCSize(inPlainText.second) bytes.
+		AES256EncryptCBCStatus AES256EncryptCBCInto(const HermitPtr& h_,
+													const DataBuffer& inPlainText,
+													const std::string& inKey,
+													const std::string& inInputVector,
+													char* outCipherText);
+		
 	} // namespace encoding
 } // namespace hermit
 
@@ -36,11 +36,11 @@ namespace
 		//
 		//
 		AES256StreamCalculator(
-			const AESKeySchedule& inKeySchedule,
+			const AES256Cipher& inCipher,
 			const AESBlock& inPreviousBlock,
 			const AES256EncryptCallbackRef& inCallback)
 			:
-			mKeySchedule(inKeySchedule),
+			mCipher(inCipher),
 			mPreviousBlock(inPreviousBlock),
 			mCallback(inCallback),
 			mSuccess(false)
@@ -48,7 +48,8 @@ namespace
 		}
 				
 		//
-		//
+		//	Whole blocks are encrypted straight out of inData; only a trailing partial block
+		//	is carried over (in mPlainText) to the next call.
 		bool Function(
 			const bool& inSuccess,
 			const DataBuffer& inData,
@@ -57,67 +58,47 @@ namespace
 			mSuccess = inSuccess;
 			if (inSuccess)
 			{
-				if (inData.second > 0)
+				const uint8_t* data = (const uint8_t*)inData.first;
+				size_t dataSize = (size_t)inData.second;
+				size_t blocks = (mPlainText.size() + dataSize) / 16;
+
+				std::string cipherText;
+				cipherText.resize((blocks + (inEndOfStream ? 1 : 0)) * 16);
+				uint8_t* output = (uint8_t*)cipherText.data();
+
+				if (!mPlainText.empty() && (blocks > 0))
 				{
-					mPlainText.append(inData.first, inData.second);
+					size_t fill = 16 - mPlainText.size();
+					mPlainText.append((const char*)data, fill);
+					data += fill;
+					dataSize -= fill;
+					mCipher.EncryptBlocksCBC(mPreviousBlock, (const uint8_t*)mPlainText.data(), output, 1);
+					output += 16;
+					--blocks;
+					mPlainText.clear();
 				}
-				
-				std::string cipherText;
-			
-				size_t pos = 0;
-				size_t bytesRemaining = mPlainText.size();
-				while ((bytesRemaining > 0) || inEndOfStream)
+				if (blocks > 0)
 				{
-					AESBlock block;
-					memset(&block, 0, sizeof(AESBlock));
-		
-					uint64_t bytes = 16;
-					if (bytes > bytesRemaining)
-					{
-						if (!inEndOfStream)
-						{
-							break;
-						}					
-						bytes = bytesRemaining;
-					}
-					for (size_t x = 0; x < bytes; ++x)
-					{
-						block.bytes[x] = mPlainText[pos];
-						++pos;
-					}
-					if (bytes < 16)
-					{
-						uint8_t pkcs7padding = 16 - bytes;
-						for (uint64_t x = 0; x < pkcs7padding; ++x)
-						{
-							block.bytes[bytes + x] = pkcs7padding;
-						}
-					}
-			
-					for (uint64_t x = 0; x < 16; x++)
-					{
-						block.bytes[x] ^= mPreviousBlock.bytes[x];
-					}
-		
-					AESBlock result;
-					memset(&result, 0, sizeof(AESBlock));
-					Encode(block, mKeySchedule, result);
-		
-					for (uint64_t x = 0; x < 16; ++x)
-					{
-						cipherText += result.bytes[x];
-					}
-		
-					mPreviousBlock = result;
+					mCipher.EncryptBlocksCBC(mPreviousBlock, data, output, blocks);
+					output += blocks * 16;
+					data += blocks * 16;
+					dataSize -= blocks * 16;
+				}
+				if (dataSize > 0)
+				{
+					mPlainText.append((const char*)data, dataSize);
+				}
 
-					if (bytes < 16)
-					{
-						break;
-					}
-		
-					bytesRemaining -= bytes;
+				if (inEndOfStream)
+				{
+					AESBlock block;
+					uint8_t pkcs7padding = (uint8_t)(16 - mPlainText.size());
+					memset(&block, pkcs7padding, sizeof(AESBlock));
+					memcpy(block.bytes, mPlainText.data(), mPlainText.size());
+					mCipher.EncryptBlocksCBC(mPreviousBlock, block.bytes, output, 1);
+					mPlainText.clear();
 				}
-				mPlainText = mPlainText.substr(mPlainText.size() - bytesRemaining);
+
 				return mCallback.Call(kAES256EncryptCallbackStatus_Success,
 									  DataBuffer(cipherText.data(), cipherText.size()),
 									  inEndOfStream);
@@ -127,7 +108,7 @@ namespace
 		
 		//
 		//
-		AESKeySchedule mKeySchedule;
+		const AES256Cipher& mCipher;
 		AESBlock mPreviousBlock;
 		const AES256EncryptCallbackRef& mCallback;
 		bool mSuccess;
@@ -155,8 +136,7 @@ void AES256EncryptCBCFromStream(
 	{
 		key.bytes[n] = inKey[n];
 	}
-	AESKeySchedule keySchedule;
-	KeyExpansion(key, keySchedule);
+	AES256Cipher cipher(key);
 
 	AESBlock previousBlock;
 	memset(&previousBlock, 0, sizeof(AESBlock));
@@ -172,7 +152,7 @@ void AES256EncryptCBCFromStream(
 		previousBlock.bytes[x] = inInputVector[x];
 	}
 
-	AES256StreamCalculator calculator(keySchedule, previousBlock, inCallback);
+	AES256StreamCalculator calculator(cipher, previousBlock, inCallback);
 	if (!inFunction.Call(calculator))
 	{
 		inCallback.Call(kAES256EncryptCallbackStatus_Aborted, DataBuffer(), true);
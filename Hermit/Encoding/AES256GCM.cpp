@@ -0,0 +1,496 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+#include <memory.h>
+#include <thread>
+#include <vector>
+#include "Hermit/Foundation/CPUFeatures.h"
+#include "Hermit/Foundation/ParallelSlices.h"
+#include "AES256GCM.h"
+
+#ifndef HERMIT_AES256GCM_PCLMUL
+#if defined(__x86_64__) || defined(__i386__)
+#define HERMIT_AES256GCM_PCLMUL 1
+#else
+#define HERMIT_AES256GCM_PCLMUL 0
+#endif
+#endif
+
+#if HERMIT_AES256GCM_PCLMUL
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <wmmintrin.h>
+#endif
+
+namespace hermit {
+	namespace encoding {
+		namespace AES256GCM_Impl {
+			
+			//
+			//	Below this many bytes per slice (256KB) handing a slice to another thread costs
+			//	more than it saves.
+			const size_t kMinBytesPerSlice = 256 * 1024;
+			
+			//
+			//	Counter blocks are encrypted in batches of this many so EncryptBlocks can
+			//	pipeline them.
+			const size_t kBlocksPerBatch = 256;
+			
+			//
+			//	Reduction constants for the 4-bit table method (Shoup), as used by most
+			//	portable GCM implementations.
+			const uint64_t sLast4[16] = {
+				0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+				0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0 };
+			
+			//
+			inline uint64_t LoadBigEndian64(const uint8_t* inBytes) {
+				uint64_t value = 0;
+				for (int n = 0; n < 8; ++n) {
+					value = (value << 8) | inBytes[n];
+				}
+				return value;
+			}
+			
+			//
+			inline void StoreBigEndian64(uint64_t inValue, uint8_t* outBytes) {
+				for (int n = 7; n >= 0; --n) {
+					outBytes[n] = (uint8_t)inValue;
+					inValue >>= 8;
+				}
+			}
+			
+			//
+			//	Multiplication in GF(2^128) with the GCM bit order, one bit at a time. Only used
+			//	a handful of times per message, to combine slices.
+			void GFMultiply(const uint8_t* inA, const uint8_t* inB, uint8_t* outResult) {
+				uint64_t zh = 0;
+				uint64_t zl = 0;
+				uint64_t vh = LoadBigEndian64(inB);
+				uint64_t vl = LoadBigEndian64(inB + 8);
+				for (int i = 0; i < 128; ++i) {
+					if ((inA[i / 8] >> (7 - (i % 8))) & 1) {
+						zh ^= vh;
+						zl ^= vl;
+					}
+					bool lsb = (vl & 1) != 0;
+					vl = (vl >> 1) | (vh << 63);
+					vh >>= 1;
+					if (lsb) {
+						vh ^= 0xe100000000000000ULL;
+					}
+				}
+				StoreBigEndian64(zh, outResult);
+				StoreBigEndian64(zl, outResult + 8);
+			}
+			
+			//
+			//	outResult = H^inExponent
+			void GFPower(const uint8_t* inH, uint64_t inExponent, uint8_t* outResult) {
+				uint8_t result[16] = { 0x80 };
+				uint8_t square[16];
+				memcpy(square, inH, 16);
+				while (inExponent > 0) {
+					if (inExponent & 1) {
+						GFMultiply(result, square, result);
+					}
+					inExponent >>= 1;
+					if (inExponent > 0) {
+						GFMultiply(square, square, square);
+					}
+				}
+				memcpy(outResult, result, 16);
+			}
+			
+#if HERMIT_AES256GCM_PCLMUL
+			
+			//
+			//	Carry-less multiply and reduce on byte-reflected operands (Intel, "Carry-Less
+			//	Multiplication and Its Usage for Computing the GCM Mode", algorithm 5).
+			__attribute__((target("pclmul,ssse3,sse2")))
+			inline __m128i CLMulMultiply(__m128i a, __m128i b) {
+				__m128i t3 = _mm_clmulepi64_si128(a, b, 0x00);
+				__m128i t4 = _mm_clmulepi64_si128(a, b, 0x10);
+				__m128i t5 = _mm_clmulepi64_si128(a, b, 0x01);
+				__m128i t6 = _mm_clmulepi64_si128(a, b, 0x11);
+				
+				t4 = _mm_xor_si128(t4, t5);
+				t5 = _mm_slli_si128(t4, 8);
+				t4 = _mm_srli_si128(t4, 8);
+				t3 = _mm_xor_si128(t3, t5);
+				t6 = _mm_xor_si128(t6, t4);
+				
+				//	shift the 256-bit product left by one to undo the bit reflection
+				__m128i t7 = _mm_srli_epi32(t3, 31);
+				__m128i t8 = _mm_srli_epi32(t6, 31);
+				t3 = _mm_slli_epi32(t3, 1);
+				t6 = _mm_slli_epi32(t6, 1);
+				__m128i t9 = _mm_srli_si128(t7, 12);
+				t8 = _mm_slli_si128(t8, 4);
+				t7 = _mm_slli_si128(t7, 4);
+				t3 = _mm_or_si128(t3, t7);
+				t6 = _mm_or_si128(t6, t8);
+				t6 = _mm_or_si128(t6, t9);
+				
+				//	reduce modulo x^128 + x^7 + x^2 + x + 1
+				t7 = _mm_slli_epi32(t3, 31);
+				t8 = _mm_slli_epi32(t3, 30);
+				t9 = _mm_slli_epi32(t3, 25);
+				t7 = _mm_xor_si128(t7, t8);
+				t7 = _mm_xor_si128(t7, t9);
+				t8 = _mm_srli_si128(t7, 4);
+				t7 = _mm_slli_si128(t7, 12);
+				t3 = _mm_xor_si128(t3, t7);
+				
+				__m128i t2 = _mm_srli_epi32(t3, 1);
+				t4 = _mm_srli_epi32(t3, 2);
+				t5 = _mm_srli_epi32(t3, 7);
+				t2 = _mm_xor_si128(t2, t4);
+				t2 = _mm_xor_si128(t2, t5);
+				t2 = _mm_xor_si128(t2, t8);
+				t3 = _mm_xor_si128(t3, t2);
+				return _mm_xor_si128(t6, t3);
+			}
+			
+			//
+			__attribute__((target("pclmul,ssse3,sse2")))
+			void GHashBlocksWithCLMul(const uint8_t* inH, uint8_t* ioX, const uint8_t* inData, size_t inBlockCount) {
+				const __m128i reverse = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+				__m128i h = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)inH), reverse);
+				__m128i x = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)ioX), reverse);
+				for (size_t n = 0; n < inBlockCount; ++n) {
+					__m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(inData + (n * 16))), reverse);
+					x = CLMulMultiply(_mm_xor_si128(x, b), h);
+				}
+				_mm_storeu_si128((__m128i*)ioX, _mm_shuffle_epi8(x, reverse));
+			}
+			
+#endif
+			
+			//
+			//	The hash subkey H = E(K, 0^128), with the per-key 4-bit multiplication tables.
+			class GHashKey {
+			public:
+				//
+				GHashKey(const AES256Cipher& inCipher) : mUseCLMul(false) {
+					uint8_t zero[16] = { 0 };
+					inCipher.EncryptBlocks(zero, mH, 1);
+					
+					uint64_t vh = LoadBigEndian64(mH);
+					uint64_t vl = LoadBigEndian64(mH + 8);
+					mHL[8] = vl;
+					mHH[8] = vh;
+					mHL[0] = 0;
+					mHH[0] = 0;
+					for (int i = 4; i > 0; i >>= 1) {
+						uint64_t t = (vl & 1) * 0xe1000000ULL;
+						vl = (vh << 63) | (vl >> 1);
+						vh = (vh >> 1) ^ (t << 32);
+						mHL[i] = vl;
+						mHH[i] = vh;
+					}
+					for (int i = 2; i <= 8; i *= 2) {
+						for (int j = 1; j < i; ++j) {
+							mHH[i + j] = mHH[i] ^ mHH[j];
+							mHL[i + j] = mHL[i] ^ mHL[j];
+						}
+					}
+#if HERMIT_AES256GCM_PCLMUL
+					const CPUFeatures& features = GetCPUFeatures();
+					mUseCLMul = features.mPCLMUL && features.mSSSE3 && features.mSSE2;
+#endif
+				}
+				
+				//
+				//	ioX = ioX * H
+				void Multiply(uint8_t* ioX) const {
+					uint8_t lo = ioX[15] & 0xf;
+					uint64_t zh = mHH[lo];
+					uint64_t zl = mHL[lo];
+					for (int i = 15; i >= 0; --i) {
+						lo = ioX[i] & 0xf;
+						uint8_t hi = (ioX[i] >> 4) & 0xf;
+						if (i != 15) {
+							uint8_t rem = (uint8_t)(zl & 0xf);
+							zl = (zh << 60) | (zl >> 4);
+							zh = (zh >> 4) ^ (sLast4[rem] << 48);
+							zh ^= mHH[lo];
+							zl ^= mHL[lo];
+						}
+						uint8_t rem = (uint8_t)(zl & 0xf);
+						zl = (zh << 60) | (zl >> 4);
+						zh = (zh >> 4) ^ (sLast4[rem] << 48);
+						zh ^= mHH[hi];
+						zl ^= mHL[hi];
+					}
+					StoreBigEndian64(zh, ioX);
+					StoreBigEndian64(zl, ioX + 8);
+				}
+				
+				//
+				//	Folds inSize bytes into ioX; a trailing partial block is zero-padded.
+				void Hash(uint8_t* ioX, const uint8_t* inData, size_t inSize) const {
+					size_t blocks = inSize / 16;
+#if HERMIT_AES256GCM_PCLMUL
+					if (mUseCLMul) {
+						GHashBlocksWithCLMul(mH, ioX, inData, blocks);
+					}
+					else
+#endif
+					{
+						for (size_t n = 0; n < blocks; ++n) {
+							for (int x = 0; x < 16; ++x) {
+								ioX[x] ^= inData[(n * 16) + x];
+							}
+							Multiply(ioX);
+						}
+					}
+					size_t remainder = inSize - (blocks * 16);
+					if (remainder > 0) {
+						uint8_t last[16] = { 0 };
+						memcpy(last, inData + (blocks * 16), remainder);
+						Hash(ioX, last, 16);
+					}
+				}
+				
+				//
+				uint8_t mH[16];
+				uint64_t mHL[16];
+				uint64_t mHH[16];
+				bool mUseCLMul;
+			};
+			
+			//
+			//	Runs counter mode over one slice starting at block inFirstBlock of the message,
+			//	and GHASHes the slice's cipher text (from a zero start) into outX.
+			void CryptSlice(const AES256Cipher& inCipher,
+							const GHashKey& inKey,
+							const uint8_t* inNonce,
+							const bool& inEncrypt,
+							const uint64_t& inFirstBlock,
+							const uint8_t* inInput,
+							uint8_t* outOutput,
+							size_t inSize,
+							uint8_t* outX) {
+				memset(outX, 0, 16);
+				uint8_t counters[kBlocksPerBatch * 16];
+				uint64_t block = inFirstBlock;
+				size_t pos = 0;
+				while (pos < inSize) {
+					size_t size = inSize - pos;
+					if (size > sizeof(counters)) {
+						size = sizeof(counters);
+					}
+					size_t blocks = (size + 15) / 16;
+					for (size_t n = 0; n < blocks; ++n) {
+						//	message block i uses counter inc32(J0, i + 1), J0 = nonce || 1
+						uint32_t counter = (uint32_t)(block + n + 2);
+						uint8_t* c = counters + (n * 16);
+						memcpy(c, inNonce, 12);
+						c[12] = (uint8_t)(counter >> 24);
+						c[13] = (uint8_t)(counter >> 16);
+						c[14] = (uint8_t)(counter >> 8);
+						c[15] = (uint8_t)counter;
+					}
+					inCipher.EncryptBlocks(counters, counters, blocks);
+					
+					if (!inEncrypt) {
+						inKey.Hash(outX, inInput + pos, size);
+					}
+					for (size_t n = 0; n < size; ++n) {
+						outOutput[pos + n] = inInput[pos + n] ^ counters[n];
+					}
+					if (inEncrypt) {
+						inKey.Hash(outX, outOutput + pos, size);
+					}
+					pos += size;
+					block += blocks;
+				}
+			}
+			
+			//	Each slice is counter-mode encrypted and GHASHed from zero on its own.
+			class CryptSlicesJob : public ParallelSlicesJob {
+			public:
+				//
+				CryptSlicesJob(const AES256Cipher& cipher,
+							   const GHashKey& key,
+							   const uint8_t* nonce,
+							   bool encrypt,
+							   const uint8_t* input,
+							   size_t size,
+							   uint8_t* output,
+							   size_t blocksPerSlice,
+							   uint8_t* sliceX) :
+				mCipher(cipher),
+				mKey(key),
+				mNonce(nonce),
+				mEncrypt(encrypt),
+				mInput(input),
+				mSize(size),
+				mOutput(output),
+				mBlocksPerSlice(blocksPerSlice),
+				mSliceX(sliceX) {
+				}
+				
+				//
+				virtual void RunSlice(size_t sliceIndex) override {
+					size_t bytesPerSlice = mBlocksPerSlice * 16;
+					size_t start = sliceIndex * bytesPerSlice;
+					if (start >= mSize) {
+						return;
+					}
+					size_t size = mSize - start;
+					if (size > bytesPerSlice) {
+						size = bytesPerSlice;
+					}
+					CryptSlice(mCipher,
+							   mKey,
+							   mNonce,
+							   mEncrypt,
+							   sliceIndex * mBlocksPerSlice,
+							   mInput + start,
+							   mOutput + start,
+							   size,
+							   mSliceX + (sliceIndex * 16));
+				}
+				
+				//
+				const AES256Cipher& mCipher;
+				const GHashKey& mKey;
+				const uint8_t* mNonce;
+				bool mEncrypt;
+				const uint8_t* mInput;
+				size_t mSize;
+				uint8_t* mOutput;
+				size_t mBlocksPerSlice;
+				uint8_t* mSliceX;
+			};
+			
+			//
+			void Crypt(const AES256Cipher& inCipher,
+					   const bool& inEncrypt,
+					   const uint8_t* inNonce,
+					   const uint8_t* inAAD,
+					   const size_t& inAADSize,
+					   const uint8_t* inInput,
+					   const size_t& inSize,
+					   uint8_t* outOutput,
+					   uint8_t* outTag) {
+				GHashKey key(inCipher);
+				
+				// hardware_concurrency is a system call on some platforms, too slow to repeat per call
+				static const size_t sCoreCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+				size_t sliceCount = sCoreCount;
+				size_t maxSlices = inSize / kMinBytesPerSlice;
+				if (sliceCount > maxSlices) {
+					sliceCount = maxSlices;
+				}
+				if (sliceCount == 0) {
+					sliceCount = 1;
+				}
+				
+				//	slices are whole blocks, except possibly the last
+				size_t blocks = (inSize + 15) / 16;
+				size_t blocksPerSlice = (blocks + sliceCount - 1) / sliceCount;
+				size_t bytesPerSlice = blocksPerSlice * 16;
+				std::vector<uint8_t> sliceX(sliceCount * 16, 0);
+				std::vector<size_t> sliceBlocks(sliceCount, 0);
+				for (size_t slice = 0; slice < sliceCount; ++slice) {
+					size_t start = slice * bytesPerSlice;
+					if (start >= inSize) {
+						break;
+					}
+					size_t size = inSize - start;
+					if (size > bytesPerSlice) {
+						size = bytesPerSlice;
+					}
+					sliceBlocks[slice] = (size + 15) / 16;
+				}
+				CryptSlicesJob job(inCipher, key, inNonce, inEncrypt, inInput, inSize, outOutput, blocksPerSlice, &sliceX[0]);
+				RunParallelSlices(job, sliceCount);
+				
+				//	S = GHASH(A || C || len(A) || len(C)); a slice hashed from zero contributes
+				//	X * H^m + Xslice, where m is the slice's block count
+				uint8_t s[16] = { 0 };
+				key.Hash(s, inAAD, inAADSize);
+				for (size_t slice = 0; slice < sliceCount; ++slice) {
+					if (sliceBlocks[slice] == 0) {
+						break;
+					}
+					uint8_t hPower[16];
+					GFPower(key.mH, sliceBlocks[slice], hPower);
+					GFMultiply(s, hPower, s);
+					for (int n = 0; n < 16; ++n) {
+						s[n] ^= sliceX[(slice * 16) + n];
+					}
+				}
+				uint8_t lengths[16];
+				StoreBigEndian64((uint64_t)inAADSize * 8, lengths);
+				StoreBigEndian64((uint64_t)inSize * 8, lengths + 8);
+				key.Hash(s, lengths, 16);
+				
+				uint8_t j0[16];
+				memcpy(j0, inNonce, 12);
+				j0[12] = 0;
+				j0[13] = 0;
+				j0[14] = 0;
+				j0[15] = 1;
+				inCipher.EncryptBlocks(j0, j0, 1);
+				for (int n = 0; n < 16; ++n) {
+					outTag[n] = s[n] ^ j0[n];
+				}
+			}
+			
+		} // namespace AES256GCM_Impl
+		using namespace AES256GCM_Impl;
+		
+		//
+		void AES256GCMEncrypt(const AES256Cipher& inCipher,
+							  const uint8_t* inNonce,
+							  const uint8_t* inAAD,
+							  const size_t& inAADSize,
+							  const uint8_t* inPlainText,
+							  const size_t& inSize,
+							  uint8_t* outCipherText,
+							  uint8_t* outTag) {
+			Crypt(inCipher, true, inNonce, inAAD, inAADSize, inPlainText, inSize, outCipherText, outTag);
+		}
+		
+		//
+		bool AES256GCMDecrypt(const AES256Cipher& inCipher,
+							  const uint8_t* inNonce,
+							  const uint8_t* inAAD,
+							  const size_t& inAADSize,
+							  const uint8_t* inCipherText,
+							  const size_t& inSize,
+							  const uint8_t* inTag,
+							  uint8_t* outPlainText) {
+			uint8_t tag[kAES256GCMTagSize];
+			Crypt(inCipher, false, inNonce, inAAD, inAADSize, inCipherText, inSize, outPlainText, tag);
+			
+			//	compare without an early exit so timing doesn't reveal how much matched
+			uint8_t difference = 0;
+			for (size_t n = 0; n < kAES256GCMTagSize; ++n) {
+				difference |= tag[n] ^ inTag[n];
+			}
+			return difference == 0;
+		}
+		
+	} // namespace encoding
+} // namespace hermit
@@ -0,0 +1,64 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef AES256GCM_h
+#define AES256GCM_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include "AES256.h"
+
+namespace hermit {
+	namespace encoding {
+		
+		//
+		const size_t kAES256GCMNonceSize = 12;
+		
+		//
+		const size_t kAES256GCMTagSize = 16;
+		
+		//
+		//	AES-256 in Galois/Counter Mode (NIST SP 800-38D) with a 96-bit nonce. Large inputs
+		//	are cut into slices that are encrypted and hashed on separate cores in one pass;
+		//	the per-slice GHASH values are combined afterwards. outCipherText may be the same
+		//	buffer as inPlainText. A nonce must never be reused with the same key.
+		void AES256GCMEncrypt(const AES256Cipher& inCipher,
+							  const uint8_t* inNonce,
+							  const uint8_t* inAAD,
+							  const size_t& inAADSize,
+							  const uint8_t* inPlainText,
+							  const size_t& inSize,
+							  uint8_t* outCipherText,
+							  uint8_t* outTag);
+		
+		//
+		//	Returns false if inTag doesn't match, in which case outPlainText holds garbage and
+		//	must not be used. outPlainText may be the same buffer as inCipherText.
+		bool AES256GCMDecrypt(const AES256Cipher& inCipher,
+							  const uint8_t* inNonce,
+							  const uint8_t* inAAD,
+							  const size_t& inAADSize,
+							  const uint8_t* inCipherText,
+							  const size_t& inSize,
+							  const uint8_t* inTag,
+							  uint8_t* outPlainText);
+		
+	} // namespace encoding
+} // namespace hermit
+
+#endif
@@ -0,0 +1,142 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <memory.h>
+#include <string>
+#include "Hermit/Foundation/Notification.h"
+#include "AES256GCM.h"
+#include "CreateInputVector.h"
+#include "AES256GCMItem.h"
+
+namespace hermit {
+	namespace encoding {
+		namespace AES256GCMItem_Impl {
+			
+			//
+			const char kMagic[] = { 'H', 'r', 'm', 't', 'G', 'C', 'M' };
+			
+			//
+			void MakeKey(const std::string& inKey, AESKey& outKey) {
+				memset(&outKey, 0, sizeof(AESKey));
+				size_t len = inKey.size();
+				if (len > 32) {
+					len = 32;
+				}
+				memcpy(outKey.bytes, inKey.data(), len);
+			}
+			
+		} // namespace AES256GCMItem_Impl
+		using namespace AES256GCMItem_Impl;
+		
+		//
+		bool IsAES256GCMItem(const DataBuffer& inItem) {
+			if (inItem.second < (kAES256GCMItemHeaderSize + kAES256GCMNonceSize + kAES256GCMTagSize)) {
+				return false;
+			}
+			return memcmp(inItem.first, kMagic, sizeof(kMagic)) == 0;
+		}
+		
+		//
+		size_t AES256GCMItemSize(size_t inPlainTextSize) {
+			return kAES256GCMItemHeaderSize + kAES256GCMNonceSize + inPlainTextSize + kAES256GCMTagSize;
+		}
+		
+		//
+		bool AES256EncryptGCMItemInto(const HermitPtr& h_,
+									  const DataBuffer& inPlainText,
+									  const std::string& inKey,
+									  char* outItem) {
+			std::string nonce;
+			if (!CreateInputVector(h_, kAES256GCMNonceSize, nonce)) {
+				NOTIFY_ERROR(h_, "AES256EncryptGCMItem: CreateInputVector failed.");
+				return false;
+			}
+			
+			AESKey key;
+			MakeKey(inKey, key);
+			AES256Cipher cipher(key);
+			
+			uint8_t* p = (uint8_t*)outItem;
+			memcpy(p, kMagic, sizeof(kMagic));
+			p[sizeof(kMagic)] = kAES256GCMItemVersion;
+			memcpy(p + kAES256GCMItemHeaderSize, nonce.data(), kAES256GCMNonceSize);
+			
+			uint8_t* cipherText = p + kAES256GCMItemHeaderSize + kAES256GCMNonceSize;
+			AES256GCMEncrypt(cipher,
+							 p + kAES256GCMItemHeaderSize,
+							 p,
+							 kAES256GCMItemHeaderSize,
+							 (const uint8_t*)inPlainText.first,
+							 inPlainText.second,
+							 cipherText,
+							 cipherText + inPlainText.second);
+			return true;
+		}
+		
+		//
+		bool AES256EncryptGCMItem(const HermitPtr& h_,
+								  const DataBuffer& inPlainText,
+								  const std::string& inKey,
+								  std::string& outItem) {
+			std::string item(AES256GCMItemSize(inPlainText.second), 0);
+			if (!AES256EncryptGCMItemInto(h_, inPlainText, inKey, &item[0])) {
+				return false;
+			}
+			outItem.swap(item);
+			return true;
+		}
+		
+		//
+		bool AES256DecryptGCMItem(const HermitPtr& h_,
+								  const DataBuffer& inItem,
+								  const std::string& inKey,
+								  std::string& outPlainText) {
+			if (!IsAES256GCMItem(inItem)) {
+				NOTIFY_ERROR(h_, "AES256DecryptGCMItem: not an AES-256-GCM item.");
+				return false;
+			}
+			const uint8_t* p = (const uint8_t*)inItem.first;
+			if (p[sizeof(kMagic)] != kAES256GCMItemVersion) {
+				NOTIFY_ERROR(h_, "AES256DecryptGCMItem: unsupported version:", (int)p[sizeof(kMagic)]);
+				return false;
+			}
+			
+			AESKey key;
+			MakeKey(inKey, key);
+			AES256Cipher cipher(key);
+			
+			size_t size = inItem.second - kAES256GCMItemHeaderSize - kAES256GCMNonceSize - kAES256GCMTagSize;
+			const uint8_t* cipherText = p + kAES256GCMItemHeaderSize + kAES256GCMNonceSize;
+			std::string plainText(size, 0);
+			if (!AES256GCMDecrypt(cipher,
+								  p + kAES256GCMItemHeaderSize,
+								  p,
+								  kAES256GCMItemHeaderSize,
+								  cipherText,
+								  size,
+								  cipherText + size,
+								  (uint8_t*)&plainText[0])) {
+				NOTIFY_ERROR(h_, "AES256DecryptGCMItem: authentication failed.");
+				return false;
+			}
+			outPlainText.swap(plainText);
+			return true;
+		}
+		
+	} // namespace encoding
+} // namespace hermit
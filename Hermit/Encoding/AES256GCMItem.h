@@ -0,0 +1,72 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef AES256GCMItem_h
+#define AES256GCMItem_h
+
+#include <string>
+#include "Hermit/Foundation/DataBuffer.h"
+#include "Hermit/Foundation/Hermit.h"
+
+namespace hermit {
+	namespace encoding {
+		
+		//
+		//	Layout of an item sealed with AES-256-GCM:
+		//		"HrmtGCM" | version (1 byte) | nonce (12 bytes) | cipher text | tag (16 bytes)
+		//	The 8-byte header is authenticated along with the cipher text. Items without the
+		//	header are the older CBC format, whose 16-byte random IV matches it with
+		//	probability 2^-64.
+		const size_t kAES256GCMItemHeaderSize = 8;
+		
+		//
+		const uint8_t kAES256GCMItemVersion = 1;
+		
+		//
+		bool IsAES256GCMItem(const DataBuffer& inItem);
+		
+		//
+		//	Uses a fresh random nonce for every item.
+		bool AES256EncryptGCMItem(const HermitPtr& h_,
+								  const DataBuffer& inPlainText,
+								  const std::string& inKey,
+								  std::string& outItem);
+		
+		//
+		//	The size of the item AES256EncryptGCMItemInto writes for inPlainTextSize bytes.
+		size_t AES256GCMItemSize(size_t inPlainTextSize);
+		
+		//
+		//	Like AES256EncryptGCMItem, but writes the item to outItem, which must hold
+		//	AES256GCMItemSize(inPlainText.second) bytes.
+		bool AES256EncryptGCMItemInto(const HermitPtr& h_,
+									  const DataBuffer& inPlainText,
+									  const std::string& inKey,
+									  char* outItem);
+		
+		//
+		//	Fails (without output) if the item is malformed or fails authentication.
+		bool AES256DecryptGCMItem(const HermitPtr& h_,
+								  const DataBuffer& inItem,
+								  const std::string& inKey,
+								  std::string& outPlainText);
+		
+	} // namespace encoding
+} // namespace hermit
+
+#endif
@@ -16,122 +16,425 @@
 //	along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
-#include <sstream>
-#include <vector>
+#include <cstdint>
+#include <cstring>
+
+#ifndef HERMIT_BASE64_SIMD
+#if defined(__x86_64__) || defined(__i386__)
+#define HERMIT_BASE64_SIMD 1
+#else
+#define HERMIT_BASE64_SIMD 0
+#endif
+#endif
+
+#if HERMIT_BASE64_SIMD
+#include <immintrin.h>
+#endif
+
+#include "Hermit/Foundation/CPUFeatures.h"
 #include "Base64.h"
 
 namespace hermit {
 	namespace encoding {
-		
-		//
-		const char kIndexToBase64Table[64] =
-		{	'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H',
-			'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P',
-			'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X',
-			'Y', 'Z', 'a', 'b', 'c', 'd', 'e', 'f',
-			'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n',
-			'o', 'p', 'q', 'r', 's', 't', 'u', 'v',
-			'w', 'x', 'y', 'z', '0', '1', '2', '3',
-			'4', '5', '6', '7', '8', '9', '+', '/'	};
-		
-		//
-		static void Encode3Bytes(const unsigned char* inBytes, size_t inBytesRead, char* inResult) {
-			inResult[0] = kIndexToBase64Table[inBytes[0] >> 2];
-			inResult[1] = kIndexToBase64Table[((inBytes[0] & 0x3) << 4) + (inBytesRead > 1 ? (inBytes[1] >> 4) : 0)];
-			if (inBytesRead >= 2) {
-				inResult[2] = kIndexToBase64Table[((inBytes[1] & 0xf) << 2) + (inBytesRead > 2 ? (inBytes[2] >> 6) : 0)];
-			}
-			else {
-				inResult[2] = '=';
-			}
-			if (inBytesRead >= 3) {
-				inResult[3] = kIndexToBase64Table[(inBytes[2] & 0x3f)];
+		namespace Base64_Impl {
+			
+			//
+			const char kIndexToBase64Table[64] =
+			{	'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H',
+				'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P',
+				'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X',
+				'Y', 'Z', 'a', 'b', 'c', 'd', 'e', 'f',
+				'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n',
+				'o', 'p', 'q', 'r', 's', 't', 'u', 'v',
+				'w', 'x', 'y', 'z', '0', '1', '2', '3',
+				'4', '5', '6', '7', '8', '9', '+', '/'	};
+			
+			//
+			const char kIndexToBase64ModifiedTable[64] =
+			{	'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H',
+				'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P',
+				'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X',
+				'Y', 'Z', 'a', 'b', 'c', 'd', 'e', 'f',
+				'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n',
+				'o', 'p', 'q', 'r', 's', 't', 'u', 'v',
+				'w', 'x', 'y', 'z', '0', '1', '2', '3',
+				'4', '5', '6', '7', '8', '9', '-', '_'	};
+			
+			//	Encodes whole 3-byte groups, then the 1 or 2 bytes left over, padded or not
+			//	according to the alphabet. Returns the number of characters written.
+			size_t EncodeWithScalar(const unsigned char* data, size_t dataSize, const Base64Alphabet& alphabet, char* out) {
+				const char* table = (alphabet == Base64Alphabet::kStandard) ? kIndexToBase64Table : kIndexToBase64ModifiedTable;
+				char* start = out;
+				size_t pos = 0;
+				for (; (pos + 3) <= dataSize; pos += 3) {
+					uint32_t bits = ((uint32_t)data[pos] << 16) | ((uint32_t)data[pos + 1] << 8) | data[pos + 2];
+					out[0] = table[bits >> 18];
+					out[1] = table[(bits >> 12) & 0x3f];
+					out[2] = table[(bits >> 6) & 0x3f];
+					out[3] = table[bits & 0x3f];
+					out += 4;
+				}
+				size_t remaining = dataSize - pos;
+				if (remaining > 0) {
+					uint32_t bits = (uint32_t)data[pos] << 16;
+					if (remaining > 1) {
+						bits |= (uint32_t)data[pos + 1] << 8;
+					}
+					*out++ = table[bits >> 18];
+					*out++ = table[(bits >> 12) & 0x3f];
+					if (remaining > 1) {
+						*out++ = table[(bits >> 6) & 0x3f];
+					}
+					if (alphabet == Base64Alphabet::kStandard) {
+						if (remaining == 1) {
+							*out++ = '=';
+						}
+						*out++ = '=';
+					}
+				}
+				return out - start;
 			}
-			else {
-				inResult[3] = '=';
+			
+			//
+			int Decode1Byte(char inByte) {
+				if ((inByte >= 'A') && (inByte <= 'Z')) {
+					return inByte - 'A';
+				}
+				
+				if ((inByte >= 'a') && (inByte <= 'z')) {
+					return 26 + (inByte - 'a');
+				}
+				
+				if ((inByte >= '0') && (inByte <= '9')) {
+					return 52 + (inByte - '0');
+				}
+				
+				if (inByte == '+') {
+					return 62;
+				}
+				
+				if (inByte == '/') {
+					return 63;
+				}
+				
+				if (inByte == '=') {
+					return -1;
+				}
+				
+				return -2;
 			}
-		}
-		
-		//
-		void Base64Encode(const char* inData, size_t inDataSize, std::string& outBase64) {
-			if (inDataSize == 0) {
-				//	empty data is represented in base64 by... empty string
-				outBase64.clear();
-				return;
-			}
-			
-			std::string base64;
-			const unsigned char* p = reinterpret_cast<const unsigned char*>(inData);
-			size_t bytesRemaining = inDataSize;
-			while (bytesRemaining > 0) {
-				char result[4];
-				int bytesRead = 3;
-				if (bytesRemaining < 3) {
-					bytesRead = static_cast<int>(bytesRemaining);
-				}
-				Encode3Bytes(p, bytesRead, result);
-				base64.push_back(result[0]);
-				base64.push_back(result[1]);
-				base64.push_back(result[2]);
-				base64.push_back(result[3]);
+			
+			//
+			int Decode4Bytes(const char* inBytes, unsigned char* inResult) {
+				int decodedBytes[4];
+				for (int n = 0; n < 4; n++) {
+					decodedBytes[n] = Decode1Byte(inBytes[n]);
+					if (decodedBytes[n] == -2) {
+						return -2;
+					}
+				}
 				
-				bytesRemaining -= bytesRead;
-				p += bytesRead;
+				inResult[0] = (decodedBytes[0] << 2) + (decodedBytes[1] >> 4);
+				if (decodedBytes[2] == -1) {
+					return 1;
+				}
+				
+				inResult[1] = ((decodedBytes[1] & 0xf) << 4) + (decodedBytes[2] >> 2);
+				if (decodedBytes[3] == -1) {
+					return 2;
+				}
+				
+				inResult[2] = ((decodedBytes[2] & 0x3) << 6) + (decodedBytes[3]);
+				return 3;
 			}
-			outBase64 = base64;
-		}
-		
-		//
-		static int Decode1Byte(char inByte) {
-			if ((inByte >= 'A') && (inByte <= 'Z')) {
-				return inByte - 'A';
+			
+			//	The characters operator>> skips by default.
+			bool IsWhitespace(char c) {
+				return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\v') || (c == '\f') || (c == '\r');
 			}
 			
-			if ((inByte >= 'a') && (inByte <= 'z')) {
-				return 26 + (inByte - 'a');
+			//	Groups of four characters, whitespace skipped, each group decoded on its own so
+			//	padding may also end a group in the middle of the data. Returns false on any
+			//	other character or a group cut short by the end of the data.
+			bool DecodeWithScalar(const char* base64, size_t base64Size, unsigned char* out, size_t& ioOutSize) {
+				size_t pos = 0;
+				while (true) {
+					char inBytes[4];
+					int bytesRead = 0;
+					while ((pos < base64Size) && (bytesRead < 4)) {
+						char c = base64[pos++];
+						if (!IsWhitespace(c)) {
+							inBytes[bytesRead++] = c;
+						}
+					}
+					if (bytesRead == 0) {
+						return true;
+					}
+					if (bytesRead < 4) {
+						return false;
+					}
+					int bytesDecoded = Decode4Bytes(inBytes, out + ioOutSize);
+					if (bytesDecoded == -2) {
+						return false;
+					}
+					ioOutSize += bytesDecoded;
+				}
 			}
 			
-			if ((inByte >= '0') && (inByte <= '9')) {
-				return 52 + (inByte - '0');
+#if HERMIT_BASE64_SIMD
+			
+			//	The SIMD paths follow Muła and Lemire. To encode, each 3 input bytes are spread
+			//	over a 32-bit lane, the four 6-bit indices pulled into their own bytes with one
+			//	multiply-high and one multiply-low, and each index mapped to its character by
+			//	adding an offset picked by which range (A-Z, a-z, 0-9, 62, 63) it falls in. To
+			//	decode, a pair of nibble lookups rejects any byte outside the alphabet, a third
+			//	gives the offset back to 0-63, and two multiply-adds pack four 6-bit values back
+			//	into 3 bytes. A block with anything else in it (whitespace, padding, bad data) is
+			//	left to DecodeWithScalar from there on.
+			
+			//	Offsets from an index's range, picked by pshufb on a reduced index: 0 for 26-51,
+			//	1-10 for 52-61, 11 for 62, 12 for 63 and 13 for 0-25.
+			__attribute__((target("ssse3")))
+			__m128i EncodeShiftTable(const Base64Alphabet& alphabet) {
+				char c62 = (alphabet == Base64Alphabet::kStandard) ? '+' : '-';
+				char c63 = (alphabet == Base64Alphabet::kStandard) ? '/' : '_';
+				return _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+									 '0' - 52, '0' - 52, '0' - 52, '0' - 52, c62 - 62, c63 - 63, 'A', 0, 0);
 			}
 			
-			if (inByte == '+') {
-				return 62;
+			//
+			__attribute__((target("ssse3")))
+			__m128i EncodeIndicesWithSSSE3(__m128i in, __m128i shiftTable) {
+				in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+				__m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+				__m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+				__m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+				__m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+				__m128i indices = _mm_or_si128(t1, t3);
+				
+				__m128i reduced = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+				__m128i isUpper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+				reduced = _mm_or_si128(reduced, _mm_and_si128(isUpper, _mm_set1_epi8(13)));
+				return _mm_add_epi8(_mm_shuffle_epi8(shiftTable, reduced), indices);
 			}
 			
-			if (inByte == '/') {
-				return 63;
+			//	12 bytes to 16 characters per step; each load reads 16 bytes.
+			__attribute__((target("ssse3")))
+			size_t EncodeWithSSSE3(const unsigned char* data, size_t dataSize, const Base64Alphabet& alphabet, char* out) {
+				__m128i shiftTable = EncodeShiftTable(alphabet);
+				size_t pos = 0;
+				char* start = out;
+				for (; (pos + 16) <= dataSize; pos += 12) {
+					__m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(out), EncodeIndicesWithSSSE3(in, shiftTable));
+					out += 16;
+				}
+				return (out - start) + EncodeWithScalar(data + pos, dataSize - pos, alphabet, out);
 			}
 			
-			if (inByte == '=') {
-				return -1;
+			//	24 bytes to 32 characters per step, with the 12-byte halves loaded into the two
+			//	128-bit lanes; each step reads 28 bytes.
+			__attribute__((target("avx2")))
+			size_t EncodeWithAVX2(const unsigned char* data, size_t dataSize, const Base64Alphabet& alphabet, char* out) {
+				char c62 = (alphabet == Base64Alphabet::kStandard) ? '+' : '-';
+				char c63 = (alphabet == Base64Alphabet::kStandard) ? '/' : '_';
+				__m256i shiftTable = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+													  '0' - 52, '0' - 52, '0' - 52, '0' - 52, c62 - 62, c63 - 63, 'A', 0, 0,
+													  'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+													  '0' - 52, '0' - 52, '0' - 52, '0' - 52, c62 - 62, c63 - 63, 'A', 0, 0);
+				__m256i spread = _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+												 10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+				size_t pos = 0;
+				char* start = out;
+				for (; (pos + 28) <= dataSize; pos += 24) {
+					__m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+					__m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + 12));
+					__m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+					in = _mm256_shuffle_epi8(in, spread);
+					__m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+					__m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+					__m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+					__m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+					__m256i indices = _mm256_or_si256(t1, t3);
+					
+					__m256i reduced = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+					__m256i isUpper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+					reduced = _mm256_or_si256(reduced, _mm256_and_si256(isUpper, _mm256_set1_epi8(13)));
+					__m256i result = _mm256_add_epi8(_mm256_shuffle_epi8(shiftTable, reduced), indices);
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(out), result);
+					out += 32;
+				}
+				//	the tail runs legacy SSE code, which stalls on dirty upper halves
+				_mm256_zeroupper();
+				return (out - start) + EncodeWithSSSE3(data + pos, dataSize - pos, alphabet, out);
 			}
 			
-			return -2;
-		}
-		
-		//
-		static int Decode4Bytes(const char* inBytes, unsigned char* inResult) {
-			int decodedBytes[4];
-			for (int n = 0; n < 4; n++) {
-				decodedBytes[n] = Decode1Byte(inBytes[n]);
-				if (decodedBytes[n] == -2) {
-					return -2;
+			//	16 characters to 12 bytes per step. Returns the number of characters consumed,
+			//	stopping at the first block that isn't all alphabet characters.
+			__attribute__((target("ssse3")))
+			size_t DecodeWithSSSE3(const char* base64, size_t base64Size, unsigned char* out, size_t outCapacity, size_t& ioOutSize) {
+				const __m128i lutLo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+													0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+				const __m128i lutHi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+													0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+				const __m128i lutRoll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+				const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+				size_t pos = 0;
+				for (; (pos + 16) <= base64Size; pos += 16) {
+					__m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(base64 + pos));
+					__m128i hiNibbles = _mm_and_si128(_mm_srli_epi32(in, 4), _mm_set1_epi8(0x0f));
+					__m128i loNibbles = _mm_and_si128(in, _mm_set1_epi8(0x0f));
+					__m128i lo = _mm_shuffle_epi8(lutLo, loNibbles);
+					__m128i hi = _mm_shuffle_epi8(lutHi, hiNibbles);
+					if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())) != 0xFFFF) {
+						break;
+					}
+					__m128i isSlash = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+					__m128i roll = _mm_shuffle_epi8(lutRoll, _mm_add_epi8(isSlash, hiNibbles));
+					__m128i values = _mm_add_epi8(in, roll);
+					__m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+					__m128i packed = _mm_shuffle_epi8(_mm_madd_epi16(merged, _mm_set1_epi32(0x00011000)), pack);
+					if ((ioOutSize + 16) <= outCapacity) {
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(out + ioOutSize), packed);
+					}
+					else {
+						char bytes[16];
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(bytes), packed);
+						memcpy(out + ioOutSize, bytes, 12);
+					}
+					ioOutSize += 12;
 				}
+				return pos;
 			}
 			
-			inResult[0] = (decodedBytes[0] << 2) + (decodedBytes[1] >> 4);
-			if (decodedBytes[2] == -1) {
-				return 1;
+			//	32 characters to 24 bytes per step, as above.
+			__attribute__((target("avx2")))
+			size_t DecodeWithAVX2(const char* base64, size_t base64Size, unsigned char* out, size_t outCapacity, size_t& ioOutSize) {
+				const __m256i lutLo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+													   0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+													   0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+													   0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+				const __m256i lutHi = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+													   0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+													   0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+													   0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+				const __m256i lutRoll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+														 0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+				const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+													  2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+				const __m256i gather = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+				size_t pos = 0;
+				for (; (pos + 32) <= base64Size; pos += 32) {
+					__m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(base64 + pos));
+					__m256i hiNibbles = _mm256_and_si256(_mm256_srli_epi32(in, 4), _mm256_set1_epi8(0x0f));
+					__m256i loNibbles = _mm256_and_si256(in, _mm256_set1_epi8(0x0f));
+					__m256i lo = _mm256_shuffle_epi8(lutLo, loNibbles);
+					__m256i hi = _mm256_shuffle_epi8(lutHi, hiNibbles);
+					if (!_mm256_testz_si256(lo, hi)) {
+						break;
+					}
+					__m256i isSlash = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('/'));
+					__m256i roll = _mm256_shuffle_epi8(lutRoll, _mm256_add_epi8(isSlash, hiNibbles));
+					__m256i values = _mm256_add_epi8(in, roll);
+					__m256i merged = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+					__m256i packed = _mm256_shuffle_epi8(_mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000)), pack);
+					packed = _mm256_permutevar8x32_epi32(packed, gather);
+					if ((ioOutSize + 32) <= outCapacity) {
+						_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + ioOutSize), packed);
+					}
+					else {
+						char bytes[32];
+						_mm256_storeu_si256(reinterpret_cast<__m256i*>(bytes), packed);
+						memcpy(out + ioOutSize, bytes, 24);
+					}
+					ioOutSize += 24;
+				}
+				_mm256_zeroupper();
+				return pos + DecodeWithSSSE3(base64 + pos, base64Size - pos, out, outCapacity, ioOutSize);
 			}
 			
-			inResult[1] = ((decodedBytes[1] & 0xf) << 4) + (decodedBytes[2] >> 2);
-			if (decodedBytes[3] == -1) {
-				return 2;
+#endif
+			
+			//
+			enum class SIMDLevel {
+				kNone,
+				kSSSE3,
+				kAVX2
+			};
+			
+			//
+			SIMDLevel GetSIMDLevel() {
+#if HERMIT_BASE64_SIMD
+				const CPUFeatures& features = GetCPUFeatures();
+				static const SIMDLevel sLevel = features.mAVX2 ? SIMDLevel::kAVX2 : (features.mSSSE3 ? SIMDLevel::kSSSE3 : SIMDLevel::kNone);
+				return sLevel;
+#else
+				return SIMDLevel::kNone;
+#endif
 			}
 			
-			inResult[2] = ((decodedBytes[2] & 0x3) << 6) + (decodedBytes[3]);
-			return 3;
+		} // namespace Base64_Impl
+		using namespace Base64_Impl;
+		
+		//
+		size_t Base64EncodedSize(size_t dataSize, const Base64Alphabet& alphabet) {
+			if (alphabet == Base64Alphabet::kStandard) {
+				return ((dataSize + 2) / 3) * 4;
+			}
+			size_t remaining = dataSize % 3;
+			return (dataSize / 3) * 4 + ((remaining > 0) ? (remaining + 1) : 0);
+		}
+		
+		//
+		size_t Base64Encode(const char* data, size_t dataSize, const Base64Alphabet& alphabet, char* outBase64) {
+			const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+#if HERMIT_BASE64_SIMD
+			SIMDLevel level = GetSIMDLevel();
+			if (level == SIMDLevel::kAVX2) {
+				return EncodeWithAVX2(bytes, dataSize, alphabet, outBase64);
+			}
+			if (level == SIMDLevel::kSSSE3) {
+				return EncodeWithSSSE3(bytes, dataSize, alphabet, outBase64);
+			}
+#endif
+			return EncodeWithScalar(bytes, dataSize, alphabet, outBase64);
+		}
+		
+		//
+		void Base64Encode(const char* inData, size_t inDataSize, std::string& outBase64) {
+			//	empty data is represented in base64 by... empty string
+			std::string base64(Base64EncodedSize(inDataSize, Base64Alphabet::kStandard), 0);
+			if (!base64.empty()) {
+				Base64Encode(inData, inDataSize, Base64Alphabet::kStandard, &base64[0]);
+			}
+			outBase64.swap(base64);
+		}
+		
+		//
+		size_t Base64DecodedMaxSize(size_t base64Size) {
+			return (base64Size / 4) * 3;
+		}
+		
+		//
+		bool Base64Decode(const DataBuffer& base64Data, char* outData, size_t& outDataSize) {
+			unsigned char* out = reinterpret_cast<unsigned char*>(outData);
+			size_t outSize = 0;
+			size_t pos = 0;
+#if HERMIT_BASE64_SIMD
+			SIMDLevel level = GetSIMDLevel();
+			size_t outCapacity = Base64DecodedMaxSize(base64Data.second);
+			if (level == SIMDLevel::kAVX2) {
+				pos = DecodeWithAVX2(base64Data.first, base64Data.second, out, outCapacity, outSize);
+			}
+			else if (level == SIMDLevel::kSSSE3) {
+				pos = DecodeWithSSSE3(base64Data.first, base64Data.second, out, outCapacity, outSize);
+			}
+#endif
+			if (!DecodeWithScalar(base64Data.first + pos, base64Data.second - pos, out, outSize)) {
+				return false;
+			}
+			outDataSize = outSize;
+			return true;
 		}
 		
 		//
@@ -142,39 +445,13 @@ namespace hermit {
 				return true;
 			}
 			
-			std::istringstream stream(std::string(base64Data.first, base64Data.second));
-			stream.setf(std::ios_base::skipws);
-			std::vector<char> buffer;
-			while (true) {
-				char inBytes[4];
-				for (int n = 0; n < 4; ++n) {
-					inBytes[n] = 0;
-				}
-				
-				int bytesRead = 0;
-				while (stream.good() && (bytesRead < 4)) {
-					//  Use operator>> to automatically skip whitespace.
-					if (stream >> inBytes[bytesRead]) {
-						++bytesRead;
-					}
-				}
-				if (bytesRead == 0) {
-					break;
-				}
-				
-				unsigned char outBytes[3];
-				int bytesDecoded = Decode4Bytes(inBytes, outBytes);
-				if (bytesDecoded == -2) {
-					return false;
-				}
-				for (int m = 0; m < bytesDecoded; ++m) {
-					buffer.push_back(outBytes[m]);
-				}
-			}
-			if (buffer.empty()) {
+			std::string result(Base64DecodedMaxSize(base64Data.second), 0);
+			size_t resultSize = 0;
+			if (result.empty() || !Base64Decode(base64Data, &result[0], resultSize) || (resultSize == 0)) {
 				return false;
 			}
-			outResult = std::string(&buffer.at(0), buffer.size());
+			result.resize(resultSize);
+			outResult.swap(result);
 			return true;
 		}
 		
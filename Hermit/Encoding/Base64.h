@@ -16,17 +16,44 @@
 //	along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#ifndef Base64_h
+#define Base64_h
+
+#include <cstddef>
 #include <string>
 #include "Hermit/Foundation/DataBuffer.h"
 
 namespace hermit {
 	namespace encoding {
 		
+		//
+		enum class Base64Alphabet {
+			kStandard,		// '+' and '/', padded with '=' to a multiple of 4
+			kModified		// '-' and '_', unpadded; safe in URLs and file names
+		};
+		
+		//	Number of characters Base64Encode writes for dataSize bytes.
+		size_t Base64EncodedSize(size_t dataSize, const Base64Alphabet& alphabet);
+		
+		//	Encodes into outBase64, which must have room for Base64EncodedSize(dataSize, alphabet)
+		//	characters, and returns the number written. Uses AVX2 or SSSE3 where the CPU has them.
+		size_t Base64Encode(const char* data, size_t dataSize, const Base64Alphabet& alphabet, char* outBase64);
+		
 		//
 		void Base64Encode(const char* inData, size_t inDataSize, std::string& outResult);
 		
+		//	Most bytes Base64Decode can produce from base64Size characters.
+		size_t Base64DecodedMaxSize(size_t base64Size);
+		
+		//	Decodes standard-alphabet base64, skipping whitespace, into outData, which must have
+		//	room for Base64DecodedMaxSize(base64Data.second) bytes. Returns false for input
+		//	that isn't base64, leaving outDataSize unset.
+		bool Base64Decode(const DataBuffer& base64Data, char* outData, size_t& outDataSize);
+		
 		//
 		bool Base64Decode(const DataBuffer& inBase64Data, std::string& outResult);
 		
 	} // namespace encoding
 } // namespace hermit
+
+#endif
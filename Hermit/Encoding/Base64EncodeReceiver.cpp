@@ -0,0 +1,70 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "Base64EncodeReceiver.h"
+
+namespace hermit {
+	namespace encoding {
+		
+		//
+		Base64EncodeReceiver::Base64EncodeReceiver(const Base64Alphabet& alphabet, const DataReceiverPtr& receiver) :
+		mAlphabet(alphabet),
+		mReceiver(receiver),
+		mCarrySize(0) {
+		}
+		
+		//
+		void Base64EncodeReceiver::Call(const HermitPtr& h_,
+										const DataBuffer& data,
+										const bool& isEndOfData,
+										const DataCompletionPtr& completion) {
+			mEncoded.resize(Base64EncodedSize(mCarrySize + data.second, mAlphabet));
+			size_t encodedSize = 0;
+			
+			const char* p = data.first;
+			size_t remaining = data.second;
+			if (mCarrySize > 0) {
+				while ((mCarrySize < 3) && (remaining > 0)) {
+					mCarry[mCarrySize++] = *p++;
+					--remaining;
+				}
+				if ((mCarrySize == 3) || isEndOfData) {
+					encodedSize += Base64Encode(mCarry, mCarrySize, mAlphabet, mEncoded.data() + encodedSize);
+					mCarrySize = 0;
+				}
+			}
+			
+			//	the carry is empty here unless it took everything in this chunk
+			size_t wholeGroupBytes = isEndOfData ? remaining : (remaining - (remaining % 3));
+			if (wholeGroupBytes > 0) {
+				encodedSize += Base64Encode(p, wholeGroupBytes, mAlphabet, mEncoded.data() + encodedSize);
+			}
+			for (size_t n = wholeGroupBytes; n < remaining; ++n) {
+				mCarry[mCarrySize++] = p[n];
+			}
+			
+			if ((encodedSize == 0) && !isEndOfData) {
+				completion->Call(h_, StreamDataResult::kSuccess);
+				return;
+			}
+			mReceiver->Call(h_, DataBuffer(mEncoded.data(), encodedSize), isEndOfData, completion);
+		}
+		
+	} // namespace encoding
+} // namespace hermit
@@ -0,0 +1,60 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef Base64EncodeReceiver_h
+#define Base64EncodeReceiver_h
+
+#include <vector>
+#include "Hermit/Foundation/Hermit.h"
+#include "Hermit/Foundation/StreamDataFunction.h"
+#include "Base64.h"
+
+namespace hermit {
+	namespace encoding {
+		
+		//	Base64-encodes a stream on its way to another receiver, one chunk at a time, so a
+		//	large payload never has to be held in memory twice. Up to 2 bytes that don't make
+		//	a whole group are carried over to the next chunk; padding (for kStandard) is added
+		//	to the chunk marked isEndOfData. Each encoded chunk is passed on with the caller's
+		//	completion, and stays valid until that completion is called.
+		class Base64EncodeReceiver : public DataReceiver {
+		public:
+			//
+			Base64EncodeReceiver(const Base64Alphabet& alphabet, const DataReceiverPtr& receiver);
+			
+			//
+			virtual void Call(const HermitPtr& h_,
+							  const DataBuffer& data,
+							  const bool& isEndOfData,
+							  const DataCompletionPtr& completion) override;
+			
+		private:
+			//
+			Base64Alphabet mAlphabet;
+			DataReceiverPtr mReceiver;
+			char mCarry[3];
+			size_t mCarrySize;
+			std::vector<char> mEncoded;
+		};
+		typedef std::shared_ptr<Base64EncodeReceiver> Base64EncodeReceiverPtr;
+		
+	} // namespace encoding
+} // namespace hermit
+
+#endif
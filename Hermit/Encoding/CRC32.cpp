@@ -1,6 +1,6 @@
 //
 //	Hermit
-//	Copyright (C) 2017 Paul Young (aka peymojo)
+//	Copyright (C) 2018 Paul Young (aka peymojo)
 //
 //	This program is free software: you can redistribute it and/or modify
 //	it under the terms of the GNU General Public License as published by
@@ -16,44 +16,267 @@
 //	along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#include "Hermit/Foundation/CPUFeatures.h"
 #include "CRC32.h"
 
+#ifndef HERMIT_CRC32_PCLMUL
+#if defined(__x86_64__) || defined(__i386__)
+#define HERMIT_CRC32_PCLMUL 1
+#else
+#define HERMIT_CRC32_PCLMUL 0
+#endif
+#endif
+
+#if HERMIT_CRC32_PCLMUL
+#include <emmintrin.h>
+#include <smmintrin.h>
+#include <wmmintrin.h>
+#endif
+
 namespace hermit {
 namespace encoding {
 
 namespace
 {
 	//
+	//	Reflected CRC-32 (IEEE 802.3) polynomial.
+	const uint32_t kPolynomial = 0xedb88320;
+
+	//
+	//	Inputs shorter than this aren't worth setting up the folding kernel for.
+	const uint64_t kMinPCLMULSize = 64;
+
 	//
-	static uint32_t sCRC32Table[256];
+	//	Slicing-by-8 tables: mTables[0] is the classic byte table, and mTables[k][n] is the
+	//	CRC of byte n followed by k zero bytes, so eight bytes can be folded in per step.
+	struct CRC32Tables
+	{
+		//
+		//
+		CRC32Tables()
+		{
+			for (int n = 0; n < 256; ++n)
+			{
+				uint32_t c = n;
+				for (int x = 0; x < 8; ++x)
+				{
+					if (c & 1)
+					{
+						c = kPolynomial ^ (c >> 1);
+					}
+					else
+					{
+						c >>= 1;
+					}
+				}
+				mTables[0][n] = c;
+			}
+			for (int n = 0; n < 256; ++n)
+			{
+				for (int k = 1; k < 8; ++k)
+				{
+					uint32_t c = mTables[k - 1][n];
+					mTables[k][n] = (c >> 8) ^ mTables[0][c & 0xff];
+				}
+			}
+		}
+
+		//
+		//
+		uint32_t mTables[8][256];
+	};
 
 	//
+	//	Built on first use; function-local statics are initialized exactly once even
+	//	when several threads get here together.
+	const CRC32Tables& GetTables()
+	{
+		static const CRC32Tables sTables;
+		return sTables;
+	}
+
+	//
+	//
+	inline uint32_t LoadLittleEndian32(
+		const unsigned char* inBytes)
+	{
+		return (uint32_t)inBytes[0] | ((uint32_t)inBytes[1] << 8) | ((uint32_t)inBytes[2] << 16) | ((uint32_t)inBytes[3] << 24);
+	}
+
+	//
+	//
+	uint32_t UpdateCRC32WithTables(
+		uint32_t inCRC32,
+		const unsigned char* inData,
+		uint64_t inDataSize)
+	{
+		const uint32_t (&t)[8][256] = GetTables().mTables;
+		uint32_t c = inCRC32;
+		const unsigned char* p = inData;
+		uint64_t remaining = inDataSize;
+		while (remaining >= 8)
+		{
+			uint32_t one = LoadLittleEndian32(p) ^ c;
+			uint32_t two = LoadLittleEndian32(p + 4);
+			c = t[7][one & 0xff] ^ t[6][(one >> 8) & 0xff] ^ t[5][(one >> 16) & 0xff] ^ t[4][one >> 24] ^
+				t[3][two & 0xff] ^ t[2][(two >> 8) & 0xff] ^ t[1][(two >> 16) & 0xff] ^ t[0][two >> 24];
+			p += 8;
+			remaining -= 8;
+		}
+		while (remaining > 0)
+		{
+			c = t[0][(c ^ *p++) & 0xff] ^ (c >> 8);
+			--remaining;
+		}
+		return c;
+	}
+
+#if HERMIT_CRC32_PCLMUL
+
 	//
-	static bool sTableBuilt = false;
+	//	Folding constants for the reflected polynomial, from Intel's "Fast CRC Computation
+	//	for Generic Polynomials Using PCLMULQDQ Instruction".
+	alignas(16) const uint64_t sK1K2[2] = { 0x0154442bd4, 0x01c6e41596 };
+	alignas(16) const uint64_t sK3K4[2] = { 0x01751997d0, 0x00ccaa009e };
+	alignas(16) const uint64_t sK5K0[2] = { 0x0163cd6124, 0x0000000000 };
+	alignas(16) const uint64_t sPoly[2] = { 0x01db710641, 0x01f7011641 };
 
 	//
+	//	Folds four 128-bit lanes across the input 64 bytes at a time, then reduces to 32
+	//	bits with a Barrett reduction. inDataSize must be at least 64 and a multiple of 16.
+	__attribute__((target("pclmul,sse4.1")))
+	uint32_t UpdateCRC32WithPCLMUL(
+		uint32_t inCRC32,
+		const unsigned char* inData,
+		uint64_t inDataSize)
+	{
+		const unsigned char* p = inData;
+		uint64_t remaining = inDataSize;
+
+		__m128i x1 = _mm_loadu_si128((const __m128i*)(p + 0x00));
+		__m128i x2 = _mm_loadu_si128((const __m128i*)(p + 0x10));
+		__m128i x3 = _mm_loadu_si128((const __m128i*)(p + 0x20));
+		__m128i x4 = _mm_loadu_si128((const __m128i*)(p + 0x30));
+		x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)inCRC32));
+		__m128i x0 = _mm_load_si128((const __m128i*)sK1K2);
+		p += 64;
+		remaining -= 64;
+
+		while (remaining >= 64)
+		{
+			__m128i x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+			__m128i x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+			__m128i x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+			__m128i x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+			x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+			x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+			x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+			x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+			x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i*)(p + 0x00)));
+			x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i*)(p + 0x10)));
+			x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i*)(p + 0x20)));
+			x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i*)(p + 0x30)));
+			p += 64;
+			remaining -= 64;
+		}
+
+		//	fold the four lanes into one
+		x0 = _mm_load_si128((const __m128i*)sK3K4);
+		__m128i x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+		while (remaining >= 16)
+		{
+			x2 = _mm_loadu_si128((const __m128i*)p);
+			x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+			x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+			x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+			p += 16;
+			remaining -= 16;
+		}
+
+		//	128 bits down to 64
+		x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+		x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+		x1 = _mm_srli_si128(x1, 8);
+		x1 = _mm_xor_si128(x1, x2);
+		x0 = _mm_loadl_epi64((const __m128i*)sK5K0);
+		x2 = _mm_srli_si128(x1, 4);
+		x1 = _mm_and_si128(x1, x3);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x1 = _mm_xor_si128(x1, x2);
+
+		//	Barrett reduction to 32 bits
+		x0 = _mm_load_si128((const __m128i*)sPoly);
+		x2 = _mm_and_si128(x1, x3);
+		x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+		x2 = _mm_and_si128(x2, x3);
+		x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+		x1 = _mm_xor_si128(x1, x2);
+		return (uint32_t)_mm_extract_epi32(x1, 1);
+	}
+
+#endif
+
 	//
-	void BuildCRC32Table()
+	//	a * b modulo the polynomial, in the reflected bit order.
+	uint32_t MultiplyModP(
+		uint32_t inA,
+		uint32_t inB)
 	{
-		for (int n = 0; n < 256; ++n)
+		uint32_t m = (uint32_t)1 << 31;
+		uint32_t p = 0;
+		uint32_t b = inB;
+		while (m != 0)
 		{
-			uint32_t c = n;
-			for (int x = 0; x < 8; ++x)
+			if (inA & m)
 			{
-				if (c & 1)
+				p ^= b;
+				if ((inA & (m - 1)) == 0)
 				{
-					c = 0xedb88320L ^ (c >> 1);
-				}
-				else
-				{
-					c >>= 1;
+					break;
 				}
 			}
-			sCRC32Table[n] = c;
+			m >>= 1;
+			b = (b & 1) ? ((b >> 1) ^ kPolynomial) : (b >> 1);
 		}
-		sTableBuilt = true;
+		return p;
 	}
-  
+
+	//
+	//	x^(inN * 2^inK) modulo the polynomial, by repeated squaring.
+	uint32_t PowerOfXModP(
+		uint64_t inN,
+		int inK)
+	{
+		uint32_t x2n[32];
+		x2n[0] = (uint32_t)1 << 30;
+		for (int n = 1; n < 32; ++n)
+		{
+			x2n[n] = MultiplyModP(x2n[n - 1], x2n[n - 1]);
+		}
+		uint32_t p = (uint32_t)1 << 31;
+		int k = inK;
+		uint64_t n = inN;
+		while (n != 0)
+		{
+			if (n & 1)
+			{
+				p = MultiplyModP(x2n[k & 31], p);
+			}
+			n >>= 1;
+			++k;
+		}
+		return p;
+	}
+
 } // private namespace
 
 //
@@ -72,18 +295,29 @@ uint32_t UpdateCRC32(
 	const char* inData,
 	uint64_t inDataSize)
 {
-	uint32_t c = inCRC32;
-	if (!sTableBuilt)
+	const unsigned char* p = (const unsigned char*)inData;
+#if HERMIT_CRC32_PCLMUL
+	const CPUFeatures& features = GetCPUFeatures();
+	if (features.mPCLMUL && features.mSSE41 && (inDataSize >= kMinPCLMULSize))
 	{
-		BuildCRC32Table();
+		uint64_t foldSize = inDataSize & ~(uint64_t)15;
+		uint32_t c = UpdateCRC32WithPCLMUL(inCRC32, p, foldSize);
+		return UpdateCRC32WithTables(c, p + foldSize, inDataSize - foldSize);
 	}
-	const char* p = inData;
-	for (uint64_t n = 0; n < inDataSize; ++n)
-	{
-		c = sCRC32Table[(c ^ *p++) & 0xff] ^ (c >> 8);
-	}
-	return c;
+#endif
+	return UpdateCRC32WithTables(inCRC32, p, inDataSize);
+}
+
+//
+//
+uint32_t CombineCRC32(
+	uint32_t inCRC32A,
+	uint32_t inCRC32B,
+	uint64_t inDataSizeB)
+{
+	//	appending inDataSizeB bytes multiplies A's contribution by x^(8 * inDataSizeB)
+	return MultiplyModP(PowerOfXModP(inDataSizeB, 3), inCRC32A) ^ inCRC32B;
 }
-   
+
 } // namespace encoding
 } // namespace hermit
@@ -30,6 +30,12 @@ namespace hermit {
 		//
 		std::uint32_t UpdateCRC32(std::uint32_t inCRC32, const char* inData, std::uint64_t inDataSize);
 		
+		//
+		//	Given finished CRC32 values for two adjacent pieces of data, returns the CRC32 of
+		//	their concatenation, so pieces can be hashed separately (e.g. in parallel) and
+		//	merged. Costs O(log inDataSizeB), independent of the data.
+		std::uint32_t CombineCRC32(std::uint32_t inCRC32A, std::uint32_t inCRC32B, std::uint64_t inDataSizeB);
+		
 	} // namespace encoding
 } // namespace hermit
 
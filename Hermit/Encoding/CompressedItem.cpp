@@ -0,0 +1,241 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "Hermit/Foundation/Notification.h"
+#include "CompressedItem.h"
+
+namespace hermit {
+	namespace encoding {
+		namespace CompressedItem_Impl {
+			
+			//
+			const char kMagic[] = "HrmtCmp";
+			const size_t kMagicSize = 7;
+			
+			//	Below this the header and codec framing eat most of any gain.
+			const size_t kMinCompressibleSize = 128;
+			
+			//	Samples taken by LooksCompressible, and their size.
+			const size_t kSampleCount = 8;
+			const size_t kSampleSize = 512;
+			
+			//	Bits per byte above which data is taken to be incompressible. Random data over
+			//	4KB of samples measures about 7.95.
+			const double kMaxCompressibleEntropy = 7.5;
+			
+			//	Input is fed to the compressor in chunks of this size, so a poor ratio is
+			//	noticed early.
+			const size_t kInputChunkSize = 256 * 1024;
+			
+			//	Decompression refuses items claiming to expand by more than this.
+			const uint64_t kMaxExpansion = 1024;
+			
+			//
+			void WriteHeader(const CompressionCodec& codec, uint64_t originalSize, std::string& outItem) {
+				outItem.assign(kMagic, kMagicSize);
+				outItem.push_back((char)kCompressedItemVersion);
+				outItem.push_back((char)codec);
+				for (int i = 0; i < 8; ++i) {
+					outItem.push_back((char)((originalSize >> (8 * i)) & 0xff));
+				}
+			}
+			
+			//	Appends to a string, refusing to let it grow past a limit.
+			class AppendReceiver : public DataReceiver {
+			public:
+				//
+				AppendReceiver(std::string& output, size_t limit) : mOutput(output), mLimit(limit) {
+				}
+				
+				//
+				virtual void Call(const HermitPtr& h_,
+								  const DataBuffer& data,
+								  const bool& isEndOfData,
+								  const DataCompletionPtr& completion) override {
+					if ((mOutput.size() + data.second) > mLimit) {
+						completion->Call(h_, StreamDataResult::kCanceled);
+						return;
+					}
+					mOutput.append(data.first, data.second);
+					completion->Call(h_, StreamDataResult::kSuccess);
+				}
+				
+				//
+				std::string& mOutput;
+				size_t mLimit;
+			};
+			
+			//
+			class ResultCompletion : public DataCompletion {
+			public:
+				//
+				ResultCompletion() : mResult(StreamDataResult::kUnknown) {
+				}
+				
+				//
+				virtual void Call(const HermitPtr& h_, const StreamDataResult& result) override {
+					mResult = result;
+				}
+				
+				//
+				StreamDataResult mResult;
+			};
+			
+			//	Both receivers in the chain complete before returning, so each chunk's result
+			//	is known as soon as the call comes back.
+			StreamDataResult FeedInChunks(const HermitPtr& h_, const DataBuffer& data, const DataReceiverPtr& receiver) {
+				size_t offset = 0;
+				while (true) {
+					size_t chunkSize = std::min(kInputChunkSize, data.second - offset);
+					bool isEndOfData = ((offset + chunkSize) == data.second);
+					auto completion = std::make_shared<ResultCompletion>();
+					receiver->Call(h_, DataBuffer(data.first + offset, chunkSize), isEndOfData, completion);
+					if ((completion->mResult != StreamDataResult::kSuccess) || isEndOfData) {
+						return completion->mResult;
+					}
+					offset += chunkSize;
+				}
+			}
+			
+		} // namespace CompressedItem_Impl
+		using namespace CompressedItem_Impl;
+		
+		//
+		bool IsCompressedItem(const DataBuffer& inItem) {
+			return (inItem.second >= kCompressedItemHeaderSize) && (memcmp(inItem.first, kMagic, kMagicSize) == 0);
+		}
+		
+		//
+		bool LooksCompressible(const DataBuffer& inData) {
+			if (inData.second < kMinCompressibleSize) {
+				return false;
+			}
+			
+			uint32_t counts[256] = { 0 };
+			size_t sampled = 0;
+			if (inData.second <= (kSampleCount * kSampleSize)) {
+				for (size_t n = 0; n < inData.second; ++n) {
+					++counts[(uint8_t)inData.first[n]];
+				}
+				sampled = inData.second;
+			}
+			else {
+				size_t stride = (inData.second - kSampleSize) / (kSampleCount - 1);
+				for (size_t i = 0; i < kSampleCount; ++i) {
+					const char* p = inData.first + (i * stride);
+					for (size_t n = 0; n < kSampleSize; ++n) {
+						++counts[(uint8_t)p[n]];
+					}
+				}
+				sampled = kSampleCount * kSampleSize;
+			}
+			
+			double entropy = 0;
+			for (auto count : counts) {
+				if (count > 0) {
+					double p = (double)count / (double)sampled;
+					entropy -= p * std::log2(p);
+				}
+			}
+			return (entropy <= kMaxCompressibleEntropy);
+		}
+		
+		//
+		bool CompressItem(const HermitPtr& h_,
+						  const DataBuffer& inData,
+						  const CompressionCodec& inCodec,
+						  std::string& outItem) {
+			outItem.clear();
+			if ((inCodec != CompressionCodec::kNone) && LooksCompressible(inData)) {
+				WriteHeader(inCodec, inData.second, outItem);
+				size_t limit = inData.second - (inData.second / 16);
+				auto appendReceiver = std::make_shared<AppendReceiver>(outItem, limit);
+				auto compressor = std::make_shared<CompressionReceiver>(CompressionOperation::kCompress, inCodec, appendReceiver);
+				auto result = FeedInChunks(h_, inData, compressor);
+				if (result == StreamDataResult::kSuccess) {
+					return true;
+				}
+				outItem.clear();
+				if (result != StreamDataResult::kCanceled) {
+					NOTIFY_ERROR(h_, "CompressItem: compression failed, result:", (int)result);
+					return false;
+				}
+			}
+			
+			if (IsCompressedItem(inData)) {
+				WriteHeader(CompressionCodec::kNone, inData.second, outItem);
+				outItem.append(inData.first, inData.second);
+			}
+			return true;
+		}
+		
+		//
+		bool DecompressItem(const HermitPtr& h_,
+							const DataBuffer& inItem,
+							std::string& outData) {
+			if (!IsCompressedItem(inItem)) {
+				NOTIFY_ERROR(h_, "DecompressItem: not a compressed item.");
+				return false;
+			}
+			uint8_t version = (uint8_t)inItem.first[kMagicSize];
+			if (version != kCompressedItemVersion) {
+				NOTIFY_ERROR(h_, "DecompressItem: unknown version:", (int)version);
+				return false;
+			}
+			auto codec = (CompressionCodec)inItem.first[kMagicSize + 1];
+			uint64_t originalSize = 0;
+			for (int i = 0; i < 8; ++i) {
+				originalSize |= ((uint64_t)(uint8_t)inItem.first[kMagicSize + 2 + i]) << (8 * i);
+			}
+			DataBuffer payload(inItem.first + kCompressedItemHeaderSize, inItem.second - kCompressedItemHeaderSize);
+			
+			if (codec == CompressionCodec::kNone) {
+				if (payload.second != originalSize) {
+					NOTIFY_ERROR(h_, "DecompressItem: stored item size mismatch.");
+					return false;
+				}
+				outData.assign(payload.first, payload.second);
+				return true;
+			}
+			if ((codec != CompressionCodec::kLZ4) && (codec != CompressionCodec::kZlib)) {
+				NOTIFY_ERROR(h_, "DecompressItem: unknown codec:", (int)codec);
+				return false;
+			}
+			if (originalSize > ((uint64_t)payload.second * kMaxExpansion)) {
+				NOTIFY_ERROR(h_, "DecompressItem: implausible original size:", originalSize);
+				return false;
+			}
+			
+			std::string data;
+			data.reserve((size_t)originalSize);
+			auto appendReceiver = std::make_shared<AppendReceiver>(data, (size_t)originalSize);
+			auto decompressor = std::make_shared<CompressionReceiver>(CompressionOperation::kDecompress, codec, appendReceiver);
+			auto result = FeedInChunks(h_, payload, decompressor);
+			if ((result != StreamDataResult::kSuccess) || (data.size() != originalSize)) {
+				NOTIFY_ERROR(h_, "DecompressItem: decompression failed, result:", (int)result);
+				return false;
+			}
+			outData.swap(data);
+			return true;
+		}
+		
+	} // namespace encoding
+} // namespace hermit
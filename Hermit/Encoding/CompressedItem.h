@@ -0,0 +1,71 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef CompressedItem_h
+#define CompressedItem_h
+
+#include <string>
+#include "Hermit/Foundation/DataBuffer.h"
+#include "Hermit/Foundation/Hermit.h"
+#include "CompressionReceiver.h"
+
+namespace hermit {
+	namespace encoding {
+		
+		//
+		//	Layout of a compressed item:
+		//		"HrmtCmp" | version (1 byte) | codec (1 byte) | original size (8 bytes, little-endian) | data
+		//	Items are meant to be compressed before they're encrypted. Data that isn't worth
+		//	compressing is stored as it is, without the header, which is also how items written
+		//	before compression existed look; only data that happens to start with the header
+		//	magic is given a header (with codec kNone) so it can't be mistaken for a compressed item.
+		const size_t kCompressedItemHeaderSize = 17;
+		
+		//
+		const uint8_t kCompressedItemVersion = 1;
+		
+		//
+		bool IsCompressedItem(const DataBuffer& inItem);
+		
+		//
+		//	Estimates the data's entropy from a few samples spread across it. Data that's
+		//	already compressed or encrypted, or is too small to gain anything, says no.
+		bool LooksCompressible(const DataBuffer& inData);
+		
+		//
+		//	Returns false on error. On success, outItem is the item to store, or is left empty
+		//	when the data should be stored as it is: codec kNone, too small, incompressible by
+		//	the sampled estimate, or not shrunk by at least 1/16th when compressed. Compression
+		//	is abandoned as soon as the output passes that limit, so outItem never grows
+		//	bigger than the data.
+		bool CompressItem(const HermitPtr& h_,
+						  const DataBuffer& inData,
+						  const CompressionCodec& inCodec,
+						  std::string& outItem);
+		
+		//
+		//	The item must pass IsCompressedItem. Fails (without output) if it's malformed,
+		//	uses an unknown version or codec, or doesn't decompress to the recorded size.
+		bool DecompressItem(const HermitPtr& h_,
+							const DataBuffer& inItem,
+							std::string& outData);
+		
+	} // namespace encoding
+} // namespace hermit
+
+#endif
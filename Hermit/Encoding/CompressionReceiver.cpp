@@ -0,0 +1,167 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <compression.h>
+#include "Hermit/Foundation/Notification.h"
+#include "CompressionReceiver.h"
+
+namespace hermit {
+	namespace encoding {
+		namespace CompressionReceiver_Impl {
+			
+			//	Output space is added in steps of this size while a chunk is processed.
+			const size_t kOutputStepSize = 64 * 1024;
+			
+			//
+			bool GetAlgorithm(const CompressionCodec& codec, compression_algorithm& outAlgorithm) {
+				switch (codec) {
+					case CompressionCodec::kLZ4:
+						outAlgorithm = COMPRESSION_LZ4;
+						return true;
+					case CompressionCodec::kZlib:
+						outAlgorithm = COMPRESSION_ZLIB;
+						return true;
+					default:
+						return false;
+				}
+			}
+			
+		} // namespace CompressionReceiver_Impl
+		using namespace CompressionReceiver_Impl;
+		
+		//
+		struct CompressionStreamState {
+			//
+			compression_stream mStream;
+		};
+		
+		//
+		CompressionReceiver::CompressionReceiver(const CompressionOperation& operation,
+												 const CompressionCodec& codec,
+												 const DataReceiverPtr& receiver) :
+		mOperation(operation),
+		mCodec(codec),
+		mReceiver(receiver),
+		mEnded(false),
+		mFailed(false) {
+		}
+		
+		//
+		CompressionReceiver::~CompressionReceiver() {
+			if (mStream != nullptr) {
+				compression_stream_destroy(&mStream->mStream);
+			}
+		}
+		
+		//
+		void CompressionReceiver::Call(const HermitPtr& h_,
+									   const DataBuffer& data,
+									   const bool& isEndOfData,
+									   const DataCompletionPtr& completion) {
+			if (mFailed) {
+				completion->Call(h_, StreamDataResult::kError);
+				return;
+			}
+			if (mEnded) {
+				//	the decoder has seen the end of the compressed stream
+				if (data.second > 0) {
+					NOTIFY_ERROR(h_, "CompressionReceiver: data after the end of the compressed stream.");
+					mFailed = true;
+					completion->Call(h_, StreamDataResult::kError);
+					return;
+				}
+				if (isEndOfData) {
+					mReceiver->Call(h_, DataBuffer(mOutput.data(), 0), true, completion);
+					return;
+				}
+				completion->Call(h_, StreamDataResult::kSuccess);
+				return;
+			}
+			
+			if (mStream == nullptr) {
+				compression_algorithm algorithm;
+				if (!GetAlgorithm(mCodec, algorithm)) {
+					NOTIFY_ERROR(h_, "CompressionReceiver: unsupported codec:", (int)mCodec);
+					mFailed = true;
+					completion->Call(h_, StreamDataResult::kError);
+					return;
+				}
+				std::unique_ptr<CompressionStreamState> stream(new CompressionStreamState());
+				auto operation = (mOperation == CompressionOperation::kCompress) ? COMPRESSION_STREAM_ENCODE : COMPRESSION_STREAM_DECODE;
+				if (compression_stream_init(&stream->mStream, operation, algorithm) != COMPRESSION_STATUS_OK) {
+					NOTIFY_ERROR(h_, "CompressionReceiver: compression_stream_init failed.");
+					mFailed = true;
+					completion->Call(h_, StreamDataResult::kError);
+					return;
+				}
+				mStream = std::move(stream);
+			}
+			
+			compression_stream& stream = mStream->mStream;
+			stream.src_ptr = (const uint8_t*)data.first;
+			stream.src_size = data.second;
+			int flags = ((mOperation == CompressionOperation::kCompress) && isEndOfData) ? COMPRESSION_STREAM_FINALIZE : 0;
+			
+			size_t produced = 0;
+			while (true) {
+				if (produced == mOutput.size()) {
+					mOutput.resize(mOutput.size() + kOutputStepSize);
+				}
+				stream.dst_ptr = (uint8_t*)mOutput.data() + produced;
+				stream.dst_size = mOutput.size() - produced;
+				
+				auto status = compression_stream_process(&stream, flags);
+				produced = mOutput.size() - stream.dst_size;
+				if (status == COMPRESSION_STATUS_ERROR) {
+					NOTIFY_ERROR(h_, "CompressionReceiver: compression_stream_process failed.");
+					mFailed = true;
+					completion->Call(h_, StreamDataResult::kError);
+					return;
+				}
+				if (status == COMPRESSION_STATUS_END) {
+					mEnded = true;
+					break;
+				}
+				//	all the input is taken, and the codec stopped short of filling the output,
+				//	so it has nothing more to give until there's more input (or the finalize)
+				if ((flags == 0) && (stream.src_size == 0) && (stream.dst_size > 0)) {
+					break;
+				}
+			}
+			
+			if (mEnded && (stream.src_size > 0)) {
+				NOTIFY_ERROR(h_, "CompressionReceiver: data after the end of the compressed stream.");
+				mFailed = true;
+				completion->Call(h_, StreamDataResult::kError);
+				return;
+			}
+			if (isEndOfData && !mEnded) {
+				NOTIFY_ERROR(h_, "CompressionReceiver: compressed stream is truncated.");
+				mFailed = true;
+				completion->Call(h_, StreamDataResult::kError);
+				return;
+			}
+			if ((produced == 0) && !isEndOfData) {
+				completion->Call(h_, StreamDataResult::kSuccess);
+				return;
+			}
+			mReceiver->Call(h_, DataBuffer(mOutput.data(), produced), isEndOfData, completion);
+		}
+		
+	} // namespace encoding
+} // namespace hermit
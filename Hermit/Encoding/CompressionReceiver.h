@@ -0,0 +1,88 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef CompressionReceiver_h
+#define CompressionReceiver_h
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Hermit/Foundation/Hermit.h"
+#include "Hermit/Foundation/StreamDataFunction.h"
+
+namespace hermit {
+	namespace encoding {
+		
+		//	The values are stored in compressed items, so don't renumber them.
+		enum class CompressionCodec : uint8_t {
+			kNone = 0,
+			
+			//	Fast, modest ratio; the default.
+			kLZ4 = 1,
+			
+			//	Raw deflate: slower, smaller.
+			kZlib = 2
+		};
+		
+		//
+		enum class CompressionOperation {
+			kCompress,
+			kDecompress
+		};
+		
+		//
+		struct CompressionStreamState;
+		
+		//	Compresses or decompresses a stream on its way to another receiver, using the
+		//	system compression library, so neither side has to be held in memory whole. Each
+		//	incoming chunk is run through the codec and whatever comes out is passed on in one
+		//	call, with the caller's completion; it stays valid until that completion is
+		//	called. Chunks that produce nothing yet are completed straight away. A compressed
+		//	stream that's truncated, or has data after its end, fails with kError.
+		class CompressionReceiver : public DataReceiver {
+		public:
+			//
+			CompressionReceiver(const CompressionOperation& operation,
+								const CompressionCodec& codec,
+								const DataReceiverPtr& receiver);
+			
+			//
+			virtual ~CompressionReceiver();
+			
+			//
+			virtual void Call(const HermitPtr& h_,
+							  const DataBuffer& data,
+							  const bool& isEndOfData,
+							  const DataCompletionPtr& completion) override;
+			
+		private:
+			//
+			CompressionOperation mOperation;
+			CompressionCodec mCodec;
+			DataReceiverPtr mReceiver;
+			std::unique_ptr<CompressionStreamState> mStream;
+			bool mEnded;
+			bool mFailed;
+			std::vector<char> mOutput;
+		};
+		typedef std::shared_ptr<CompressionReceiver> CompressionReceiverPtr;
+		
+	} // namespace encoding
+} // namespace hermit
+
+#endif
@@ -0,0 +1,286 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "Hermit/Foundation/Notification.h"
+#include "Hermit/Foundation/ParallelSlices.h"
+#include "CalculateDataCRC32.h"
+#include "CalculateMD5FromStream.h"
+#include "CalculateMurmur3_128.h"
+#include "CalculateSHA256FromStream.h"
+#include "MultiDigestReceiver.h"
+
+namespace hermit {
+	namespace encoding {
+		namespace MultiDigestReceiver_Impl {
+			
+			//	Smaller buffers are hashed faster than they can be handed to another thread.
+			const size_t kMinParallelBufferSize = 256 * 1024;
+			
+			//	Stands in for the DataProvider of a single-digest FromStream function, holding on
+			//	to the receiver and completion it's handed so MultiDigestReceiver can drive them.
+			class CapturingProvider : public DataProvider {
+			public:
+				//
+				virtual void Call(const HermitPtr& h_,
+								  const DataReceiverPtr& receiver,
+								  const DataCompletionPtr& completion) override {
+					mReceiver = receiver;
+					mCompletion = completion;
+				}
+				
+				//
+				DataReceiverPtr mReceiver;
+				DataCompletionPtr mCompletion;
+			};
+			typedef std::shared_ptr<CapturingProvider> CapturingProviderPtr;
+			
+			//
+			class ReceiveCompletion : public DataCompletion {
+			public:
+				//
+				ReceiveCompletion() : mResult(StreamDataResult::kUnknown) {
+				}
+				
+				//
+				virtual void Call(const HermitPtr& h_, const StreamDataResult& result) override {
+					mResult = result;
+				}
+				
+				//
+				StreamDataResult mResult;
+			};
+			typedef std::shared_ptr<ReceiveCompletion> ReceiveCompletionPtr;
+			
+			//
+			void MergeResult(CalculateHashResult& ioResult, const CalculateHashResult& result) {
+				if ((result != CalculateHashResult::kSuccess) && (ioResult != CalculateHashResult::kError)) {
+					ioResult = result;
+				}
+			}
+			
+			//
+			class HashCompletion : public CalculateHashCompletion {
+			public:
+				//
+				HashCompletion(CalculateHashResult& result, std::string& hash) : mResult(result), mHash(hash) {
+				}
+				
+				//
+				virtual void Call(const HermitPtr& h_, const CalculateHashResult& result, const std::string& hash) override {
+					MergeResult(mResult, result);
+					mHash = hash;
+				}
+				
+				//
+				CalculateHashResult& mResult;
+				std::string& mHash;
+			};
+			
+			//
+			class CRC32Completion : public CalculateDataCRC32Completion {
+			public:
+				//
+				CRC32Completion(CalculateHashResult& result, std::uint32_t& crc32) : mResult(result), mCRC32(crc32) {
+				}
+				
+				//
+				virtual void Call(const HermitPtr& h_, const CalculateDataCRC32Result& result, const std::uint32_t& crc32) override {
+					if (result == CalculateDataCRC32Result::kCanceled) {
+						MergeResult(mResult, CalculateHashResult::kCanceled);
+					}
+					else if (result != CalculateDataCRC32Result::kSuccess) {
+						MergeResult(mResult, CalculateHashResult::kError);
+					}
+					mCRC32 = crc32;
+				}
+				
+				//
+				CalculateHashResult& mResult;
+				std::uint32_t& mCRC32;
+			};
+			
+			//	Slice n feeds the buffer to digest receiver n.
+			class ReceiveSlicesJob : public ParallelSlicesJob {
+			public:
+				//
+				ReceiveSlicesJob(const HermitPtr& h_,
+								 const std::vector<DataReceiverPtr>& receivers,
+								 const DataBuffer& data,
+								 const bool& isEndOfData,
+								 const std::vector<ReceiveCompletionPtr>& results) :
+				mH_(h_),
+				mReceivers(receivers),
+				mData(data),
+				mIsEndOfData(isEndOfData),
+				mResults(results) {
+				}
+				
+				//
+				virtual void RunSlice(size_t sliceIndex) override {
+					mReceivers[sliceIndex]->Call(mH_, mData, mIsEndOfData, mResults[sliceIndex]);
+				}
+				
+				//
+				const HermitPtr& mH_;
+				const std::vector<DataReceiverPtr>& mReceivers;
+				const DataBuffer& mData;
+				bool mIsEndOfData;
+				const std::vector<ReceiveCompletionPtr>& mResults;
+			};
+			
+			//
+			class StreamCompletion : public DataCompletion {
+			public:
+				//
+				StreamCompletion(const MultiDigestReceiverPtr& receiver, const MultiDigestCompletionPtr& completion) :
+				mReceiver(receiver),
+				mCompletion(completion) {
+				}
+				
+				//
+				virtual void Call(const HermitPtr& h_, const StreamDataResult& result) override {
+					mReceiver->Finish(h_, result, mCompletion);
+				}
+				
+				//
+				MultiDigestReceiverPtr mReceiver;
+				MultiDigestCompletionPtr mCompletion;
+			};
+			
+		} // namespace MultiDigestReceiver_Impl
+		using namespace MultiDigestReceiver_Impl;
+		
+		//
+		MultiDigestReceiver::MultiDigestReceiver(const MultiDigestTypes& digests, bool useSeparateThreads) :
+		mDigests(digests),
+		mUseSeparateThreads(useSeparateThreads),
+		mStarted(false),
+		mResult(CalculateHashResult::kSuccess) {
+		}
+		
+		//	Each digest is set going against a CapturingProvider, which hands back the digest's
+		//	receiver and completion without any data having moved yet.
+		void MultiDigestReceiver::Start(const HermitPtr& h_) {
+			if (mStarted) {
+				return;
+			}
+			mStarted = true;
+			
+			std::vector<CapturingProviderPtr> providers;
+			if (mDigests & kMultiDigestMD5) {
+				providers.push_back(std::make_shared<CapturingProvider>());
+				auto completion = std::make_shared<HashCompletion>(mResult, mResults.mMD5Hex);
+				CalculateMD5FromStream(h_, providers.back(), completion);
+			}
+			if (mDigests & kMultiDigestSHA256) {
+				providers.push_back(std::make_shared<CapturingProvider>());
+				auto completion = std::make_shared<HashCompletion>(mResult, mResults.mSHA256Hex);
+				CalculateSHA256FromStream(h_, providers.back(), completion);
+			}
+			if (mDigests & kMultiDigestCRC32) {
+				providers.push_back(std::make_shared<CapturingProvider>());
+				auto completion = std::make_shared<CRC32Completion>(mResult, mResults.mCRC32);
+				CalculateDataCRC32(h_, providers.back(), completion);
+			}
+			if (mDigests & kMultiDigestMurmur3_128) {
+				providers.push_back(std::make_shared<CapturingProvider>());
+				auto completion = std::make_shared<HashCompletion>(mResult, mResults.mMurmur3_128Hex);
+				CalculateMurmur3_128(h_, providers.back(), completion);
+			}
+			for (auto it = begin(providers); it != end(providers); ++it) {
+				mReceivers.push_back((*it)->mReceiver);
+				mCompletions.push_back((*it)->mCompletion);
+			}
+		}
+		
+		//
+		void MultiDigestReceiver::Call(const HermitPtr& h_,
+									   const DataBuffer& data,
+									   const bool& isEndOfData,
+									   const DataCompletionPtr& completion) {
+			Start(h_);
+			
+			std::vector<ReceiveCompletionPtr> results;
+			for (size_t n = 0; n < mReceivers.size(); ++n) {
+				results.push_back(std::make_shared<ReceiveCompletion>());
+			}
+			if (mUseSeparateThreads && (mReceivers.size() > 1) && (data.second >= kMinParallelBufferSize)) {
+				ReceiveSlicesJob job(h_, mReceivers, data, isEndOfData, results);
+				RunParallelSlices(job, mReceivers.size());
+			}
+			else {
+				for (size_t n = 0; n < mReceivers.size(); ++n) {
+					mReceivers[n]->Call(h_, data, isEndOfData, results[n]);
+				}
+			}
+			
+			for (auto it = begin(results); it != end(results); ++it) {
+				if ((*it)->mResult != StreamDataResult::kSuccess) {
+					if ((*it)->mResult != StreamDataResult::kCanceled) {
+						NOTIFY_ERROR(h_, "MultiDigestReceiver: digest receiver failed.");
+					}
+					completion->Call(h_, (*it)->mResult);
+					return;
+				}
+			}
+			if (CHECK_FOR_ABORT(h_)) {
+				completion->Call(h_, StreamDataResult::kCanceled);
+				return;
+			}
+			completion->Call(h_, StreamDataResult::kSuccess);
+		}
+		
+		//
+		void MultiDigestReceiver::Finish(const HermitPtr& h_,
+										 const StreamDataResult& result,
+										 const MultiDigestCompletionPtr& completion) {
+			if (result == StreamDataResult::kCanceled) {
+				completion->Call(h_, CalculateHashResult::kCanceled, MultiDigestResults());
+				return;
+			}
+			if (result != StreamDataResult::kSuccess) {
+				NOTIFY_ERROR(h_, "MultiDigestReceiver: dataProvider returned an error.");
+				completion->Call(h_, CalculateHashResult::kError, MultiDigestResults());
+				return;
+			}
+			
+			Start(h_);
+			for (auto it = begin(mCompletions); it != end(mCompletions); ++it) {
+				(*it)->Call(h_, result);
+			}
+			if (mResult != CalculateHashResult::kSuccess) {
+				completion->Call(h_, mResult, MultiDigestResults());
+				return;
+			}
+			completion->Call(h_, CalculateHashResult::kSuccess, mResults);
+		}
+		
+		//
+		void CalculateMultiDigestFromStream(const HermitPtr& h_,
+											const DataProviderPtr& dataProvider,
+											const MultiDigestTypes& digests,
+											bool useSeparateThreads,
+											const MultiDigestCompletionPtr& completion) {
+			auto receiver = std::make_shared<MultiDigestReceiver>(digests, useSeparateThreads);
+			auto streamCompletion = std::make_shared<StreamCompletion>(receiver, completion);
+			dataProvider->Call(h_, receiver, streamCompletion);
+		}
+		
+	} // namespace encoding
+} // namespace hermit
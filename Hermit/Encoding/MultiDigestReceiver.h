@@ -0,0 +1,108 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef MultiDigestReceiver_h
+#define MultiDigestReceiver_h
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Hermit/Foundation/AsyncFunction.h"
+#include "Hermit/Foundation/Hermit.h"
+#include "Hermit/Foundation/StreamDataFunction.h"
+#include "CalculateHashResult.h"
+
+namespace hermit {
+	namespace encoding {
+		
+		//	Digests a MultiDigestReceiver can calculate, combined with |.
+		typedef std::uint32_t MultiDigestTypes;
+		const MultiDigestTypes kMultiDigestMD5 = 1 << 0;
+		const MultiDigestTypes kMultiDigestSHA256 = 1 << 1;
+		const MultiDigestTypes kMultiDigestCRC32 = 1 << 2;
+		const MultiDigestTypes kMultiDigestMurmur3_128 = 1 << 3;
+		
+		//	Each value matches what the corresponding single-digest function reports
+		//	(CalculateMD5FromStream, CalculateSHA256FromStream, CalculateDataCRC32,
+		//	CalculateMurmur3_128). Digests that weren't requested are left empty / 0.
+		struct MultiDigestResults {
+			//
+			MultiDigestResults() : mCRC32(0) {
+			}
+			
+			//
+			std::string mMD5Hex;
+			std::string mSHA256Hex;
+			std::uint32_t mCRC32;
+			std::string mMurmur3_128Hex;
+		};
+		
+		//
+		DEFINE_ASYNC_FUNCTION_3A(MultiDigestCompletion,
+								 HermitPtr,
+								 CalculateHashResult,
+								 MultiDigestResults);
+		
+		//	Calculates several digests from a single pass over the data: each buffer it receives
+		//	is handed to every requested digest in turn, or with useSeparateThreads, to the digests
+		//	side by side on ThreadPool workers (the buffer is only read, and isn't released until
+		//	all are done).
+		//	Pass it to a DataProvider, then call Finish with the provider's result.
+		class MultiDigestReceiver : public DataReceiver {
+		public:
+			//
+			MultiDigestReceiver(const MultiDigestTypes& digests, bool useSeparateThreads);
+			
+			//
+			virtual void Call(const HermitPtr& h_,
+							  const DataBuffer& data,
+							  const bool& isEndOfData,
+							  const DataCompletionPtr& completion) override;
+			
+			//
+			void Finish(const HermitPtr& h_,
+						const StreamDataResult& result,
+						const MultiDigestCompletionPtr& completion);
+			
+		private:
+			//
+			void Start(const HermitPtr& h_);
+			
+			//
+			MultiDigestTypes mDigests;
+			bool mUseSeparateThreads;
+			bool mStarted;
+			std::vector<DataReceiverPtr> mReceivers;
+			std::vector<DataCompletionPtr> mCompletions;
+			CalculateHashResult mResult;
+			MultiDigestResults mResults;
+		};
+		typedef std::shared_ptr<MultiDigestReceiver> MultiDigestReceiverPtr;
+		
+		//	Convenience wrapper: streams dataProvider once through a MultiDigestReceiver.
+		void CalculateMultiDigestFromStream(const HermitPtr& h_,
+											const DataProviderPtr& dataProvider,
+											const MultiDigestTypes& digests,
+											bool useSeparateThreads,
+											const MultiDigestCompletionPtr& completion);
+		
+	} // namespace encoding
+} // namespace hermit
+
+#endif
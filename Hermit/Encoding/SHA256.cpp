@@ -18,8 +18,23 @@
 
 #include <stddef.h>
 #include <string.h>
+#include <atomic>
+#include <vector>
+#include "Hermit/Foundation/CPUFeatures.h"
 #include "SHA256.h"
 
+#ifndef HERMIT_SHA256_SIMD
+#if defined(__x86_64__) || defined(__i386__)
+#define HERMIT_SHA256_SIMD 1
+#else
+#define HERMIT_SHA256_SIMD 0
+#endif
+#endif
+
+#if HERMIT_SHA256_SIMD
+#include <immintrin.h>
+#endif
+
 //
 //
 #ifdef E38_CONFIG_BIGENDIAN
@@ -28,18 +43,6 @@
 #define E38_SWAP(n) (((n) << 24) | (((n) & 0xff00) << 8) | (((n) >> 8) & 0xff00) | ((n) >> 24))
 #endif
 
-//
-template <
-typename T>
-struct Sizer {
-	char c;
-	T x;
-};
-
-//
-#define E38_alignof(type) offsetof(Sizer<type>, x)
-#define E38_UNALIGNED_P(p) (((uint64_t) p) % E38_alignof(uint32_t) != 0)
-
 namespace hermit {
 	namespace encoding {
 		
@@ -74,31 +77,28 @@ namespace hermit {
 				0x90befffaUL, 0xa4506cebUL, 0xbef9a3f7UL, 0xc67178f2UL,
 			};
 			
-			//	Process LEN bytes of BUFFER, accumulating context into CTX.
-			//	It is assumed that LEN % 64 == 0.
-			void SHA256ProcessBlock(SHA256State& ioState,
-									const void* inBuffer,
-									uint64_t inDataSize) {
-				const uint32_t *words = static_cast<const uint32_t*>(inBuffer);
-				uint64_t nwords = inDataSize / sizeof (uint32_t);
-				const uint32_t *endp = words + nwords;
+			//	Streams hashed side by side by the AVX2 multi-buffer kernel.
+			const size_t kSHA256Lanes = 8;
+			
+			//	Fewer streams than this leave too many AVX2 lanes idle to beat hashing them one
+			//	at a time.
+			const size_t kMinAVX2Lanes = 4;
+			
+			//	Compress inBlockCount 64-byte blocks into ioDigest, one 32-bit word at a time.
+			void SHA256CompressWithScalar(uint32_t* ioDigest,
+										  const unsigned char* inBlocks,
+										  uint64_t inBlockCount) {
+				const unsigned char* words = inBlocks;
+				const unsigned char* endp = words + inBlockCount * 64;
 				uint32_t x[16];
-				uint32_t a = ioState.state[0];
-				uint32_t b = ioState.state[1];
-				uint32_t c = ioState.state[2];
-				uint32_t d = ioState.state[3];
-				uint32_t e = ioState.state[4];
-				uint32_t f = ioState.state[5];
-				uint32_t g = ioState.state[6];
-				uint32_t h = ioState.state[7];
-				
-				//	First increment the byte count.  FIPS PUB 180-2 specifies the possible
-				//	length of the file up to 2^64 bits.  Here we only compute the
-				//	number of bytes.  Do a double word increment.
-				ioState.total[0] += inDataSize;
-				if (ioState.total[0] < inDataSize) {
-					++ioState.total[1];
-				}
+				uint32_t a = ioDigest[0];
+				uint32_t b = ioDigest[1];
+				uint32_t c = ioDigest[2];
+				uint32_t d = ioDigest[3];
+				uint32_t e = ioDigest[4];
+				uint32_t f = ioDigest[5];
+				uint32_t g = ioDigest[6];
+				uint32_t h = ioDigest[7];
 				
 #define E38_SHA256_rol(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
 #define E38_SHA256_S0(x) (E38_SHA256_rol(x, 25) ^ E38_SHA256_rol(x, 14) ^ (x>>3))
@@ -122,8 +122,10 @@ H = t0 + t1; \
 					uint32_t tm;
 					uint32_t t0, t1;
 					for (int t = 0; t < 16; t++) {
-						x[t] = E38_SWAP(*words);
-						words++;
+						uint32_t word;
+						memcpy(&word, words, sizeof(word));
+						x[t] = E38_SWAP(word);
+						words += sizeof(word);
 					}
 					
 					E38_SHA256_R( a, b, c, d, e, f, g, h, E38_SHA256_K( 0), x[ 0] );
@@ -191,19 +193,338 @@ H = t0 + t1; \
 					E38_SHA256_R( c, d, e, f, g, h, a, b, E38_SHA256_K(62), E38_SHA256_M(62) );
 					E38_SHA256_R( b, c, d, e, f, g, h, a, E38_SHA256_K(63), E38_SHA256_M(63) );
 					
-					a = ioState.state[0] += a;
-					b = ioState.state[1] += b;
-					c = ioState.state[2] += c;
-					d = ioState.state[3] += d;
-					e = ioState.state[4] += e;
-					f = ioState.state[5] += f;
-					g = ioState.state[6] += g;
-					h = ioState.state[7] += h;
+					a = ioDigest[0] += a;
+					b = ioDigest[1] += b;
+					c = ioDigest[2] += c;
+					d = ioDigest[3] += d;
+					e = ioDigest[4] += e;
+					f = ioDigest[5] += f;
+					g = ioDigest[6] += g;
+					h = ioDigest[7] += h;
+				}
+			}
+			
+#if HERMIT_SHA256_SIMD
+			
+			//	Compress inBlockCount 64-byte blocks into ioDigest with the SHA extensions. The
+			//	state is kept as ABEF/CDGH pairs, the layout sha256rnds2 works on, and each
+			//	group of four rounds finishes part of the message schedule for a later group.
+			__attribute__((target("sha,sse4.1,ssse3")))
+			void SHA256CompressWithSHA(uint32_t* ioDigest,
+									   const unsigned char* inBlocks,
+									   uint64_t inBlockCount) {
+				const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+				
+				__m128i tmp = _mm_loadu_si128((const __m128i*)&ioDigest[0]);
+				__m128i state1 = _mm_loadu_si128((const __m128i*)&ioDigest[4]);
+				tmp = _mm_shuffle_epi32(tmp, 0xB1);
+				state1 = _mm_shuffle_epi32(state1, 0x1B);
+				__m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+				state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+				
+				for (uint64_t n = 0; n < inBlockCount; ++n) {
+					const unsigned char* block = inBlocks + n * 64;
+					__m128i saveABEF = state0;
+					__m128i saveCDGH = state1;
+					__m128i w0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(block + 0)), byteSwap);
+					__m128i w1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(block + 16)), byteSwap);
+					__m128i w2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(block + 32)), byteSwap);
+					__m128i w3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(block + 48)), byteSwap);
+					
+#define HERMIT_SHA256_ROUNDS(I, W) do \
+{ \
+__m128i msg = _mm_add_epi32(W, _mm_loadu_si128((const __m128i*)&SHA256_round_constants[(I) * 4])); \
+state1 = _mm_sha256rnds2_epu32(state1, state0, msg); \
+state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0E)); \
+} while(0)
+#define HERMIT_SHA256_MSG2(WNEXT, W, WPREV) \
+( WNEXT = _mm_sha256msg2_epu32(_mm_add_epi32(WNEXT, _mm_alignr_epi8(W, WPREV, 4)), W) )
+#define HERMIT_SHA256_MSG1(WPREV, W) ( WPREV = _mm_sha256msg1_epu32(WPREV, W) )
+					
+					HERMIT_SHA256_ROUNDS( 0, w0);
+					HERMIT_SHA256_ROUNDS( 1, w1); HERMIT_SHA256_MSG1(w0, w1);
+					HERMIT_SHA256_ROUNDS( 2, w2); HERMIT_SHA256_MSG1(w1, w2);
+					HERMIT_SHA256_ROUNDS( 3, w3); HERMIT_SHA256_MSG2(w0, w3, w2); HERMIT_SHA256_MSG1(w2, w3);
+					HERMIT_SHA256_ROUNDS( 4, w0); HERMIT_SHA256_MSG2(w1, w0, w3); HERMIT_SHA256_MSG1(w3, w0);
+					HERMIT_SHA256_ROUNDS( 5, w1); HERMIT_SHA256_MSG2(w2, w1, w0); HERMIT_SHA256_MSG1(w0, w1);
+					HERMIT_SHA256_ROUNDS( 6, w2); HERMIT_SHA256_MSG2(w3, w2, w1); HERMIT_SHA256_MSG1(w1, w2);
+					HERMIT_SHA256_ROUNDS( 7, w3); HERMIT_SHA256_MSG2(w0, w3, w2); HERMIT_SHA256_MSG1(w2, w3);
+					HERMIT_SHA256_ROUNDS( 8, w0); HERMIT_SHA256_MSG2(w1, w0, w3); HERMIT_SHA256_MSG1(w3, w0);
+					HERMIT_SHA256_ROUNDS( 9, w1); HERMIT_SHA256_MSG2(w2, w1, w0); HERMIT_SHA256_MSG1(w0, w1);
+					HERMIT_SHA256_ROUNDS(10, w2); HERMIT_SHA256_MSG2(w3, w2, w1); HERMIT_SHA256_MSG1(w1, w2);
+					HERMIT_SHA256_ROUNDS(11, w3); HERMIT_SHA256_MSG2(w0, w3, w2); HERMIT_SHA256_MSG1(w2, w3);
+					HERMIT_SHA256_ROUNDS(12, w0); HERMIT_SHA256_MSG2(w1, w0, w3); HERMIT_SHA256_MSG1(w3, w0);
+					HERMIT_SHA256_ROUNDS(13, w1); HERMIT_SHA256_MSG2(w2, w1, w0);
+					HERMIT_SHA256_ROUNDS(14, w2); HERMIT_SHA256_MSG2(w3, w2, w1);
+					HERMIT_SHA256_ROUNDS(15, w3);
+					
+#undef HERMIT_SHA256_ROUNDS
+#undef HERMIT_SHA256_MSG2
+#undef HERMIT_SHA256_MSG1
+					
+					state0 = _mm_add_epi32(state0, saveABEF);
+					state1 = _mm_add_epi32(state1, saveCDGH);
+				}
+				
+				tmp = _mm_shuffle_epi32(state0, 0x1B);
+				state1 = _mm_shuffle_epi32(state1, 0xB1);
+				state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+				state1 = _mm_alignr_epi8(state1, tmp, 8);
+				_mm_storeu_si128((__m128i*)&ioDigest[0], state0);
+				_mm_storeu_si128((__m128i*)&ioDigest[4], state1);
+			}
+			
+			//
+			__attribute__((target("avx2")))
+			inline __m256i RotateRight8x32(__m256i inValue, int inBits) {
+				return _mm256_or_si256(_mm256_srli_epi32(inValue, inBits), _mm256_slli_epi32(inValue, 32 - inBits));
+			}
+			
+			//	Turns eight rows of eight words (one row per lane) into eight vectors each
+			//	holding the same word from every lane.
+			__attribute__((target("avx2")))
+			void Transpose8x32(__m256i* ioRows) {
+				__m256i t0 = _mm256_unpacklo_epi32(ioRows[0], ioRows[1]);
+				__m256i t1 = _mm256_unpackhi_epi32(ioRows[0], ioRows[1]);
+				__m256i t2 = _mm256_unpacklo_epi32(ioRows[2], ioRows[3]);
+				__m256i t3 = _mm256_unpackhi_epi32(ioRows[2], ioRows[3]);
+				__m256i t4 = _mm256_unpacklo_epi32(ioRows[4], ioRows[5]);
+				__m256i t5 = _mm256_unpackhi_epi32(ioRows[4], ioRows[5]);
+				__m256i t6 = _mm256_unpacklo_epi32(ioRows[6], ioRows[7]);
+				__m256i t7 = _mm256_unpackhi_epi32(ioRows[6], ioRows[7]);
+				__m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+				__m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+				__m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+				__m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+				__m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+				__m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+				__m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+				__m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+				ioRows[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+				ioRows[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+				ioRows[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+				ioRows[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+				ioRows[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+				ioRows[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+				ioRows[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+				ioRows[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+			}
+			
+			//	Compress up to eight independent streams at once, stream n in 32-bit lane n of
+			//	every vector. Streams run out of blocks at different points; from then on their
+			//	lane reads a block of zeros and its result is masked off.
+			__attribute__((target("avx2")))
+			void SHA256CompressLanesWithAVX2(uint32_t* const* ioDigests,
+											 const unsigned char* const* inBlocks,
+											 const uint64_t* inBlockCounts,
+											 size_t inLaneCount) {
+				alignas(32) static const unsigned char sZeroBlock[64] = { 0 };
+				const __m256i byteSwap = _mm256_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL,
+														   0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+				
+				uint64_t blockCounts[kSHA256Lanes] = { 0 };
+				uint64_t maxBlockCount = 0;
+				alignas(32) uint32_t digests[8][kSHA256Lanes] = { { 0 } };
+				for (size_t lane = 0; lane < inLaneCount; ++lane) {
+					blockCounts[lane] = inBlockCounts[lane];
+					if (blockCounts[lane] > maxBlockCount) {
+						maxBlockCount = blockCounts[lane];
+					}
+					for (int i = 0; i < 8; ++i) {
+						digests[i][lane] = ioDigests[lane][i];
+					}
+				}
+				__m256i s[8];
+				for (int i = 0; i < 8; ++i) {
+					s[i] = _mm256_load_si256((const __m256i*)digests[i]);
+				}
+				
+				for (uint64_t n = 0; n < maxBlockCount; ++n) {
+					const unsigned char* blocks[kSHA256Lanes];
+					alignas(32) uint32_t active[kSHA256Lanes];
+					for (size_t lane = 0; lane < kSHA256Lanes; ++lane) {
+						bool live = (n < blockCounts[lane]);
+						blocks[lane] = live ? inBlocks[lane] + n * 64 : sZeroBlock;
+						active[lane] = live ? 0xffffffff : 0;
+					}
+					
+					__m256i w[16];
+					for (int half = 0; half < 2; ++half) {
+						for (size_t lane = 0; lane < kSHA256Lanes; ++lane) {
+							__m256i row = _mm256_loadu_si256((const __m256i*)(blocks[lane] + half * 32));
+							w[half * 8 + lane] = _mm256_shuffle_epi8(row, byteSwap);
+						}
+						Transpose8x32(&w[half * 8]);
+					}
+					
+					__m256i a = s[0];
+					__m256i b = s[1];
+					__m256i c = s[2];
+					__m256i d = s[3];
+					__m256i e = s[4];
+					__m256i f = s[5];
+					__m256i g = s[6];
+					__m256i h = s[7];
+					for (int t = 0; t < 64; ++t) {
+						if (t >= 16) {
+							__m256i w15 = w[(t - 15) & 15];
+							__m256i w2 = w[(t - 2) & 15];
+							__m256i sigma0 = _mm256_xor_si256(_mm256_xor_si256(RotateRight8x32(w15, 7), RotateRight8x32(w15, 18)),
+															  _mm256_srli_epi32(w15, 3));
+							__m256i sigma1 = _mm256_xor_si256(_mm256_xor_si256(RotateRight8x32(w2, 17), RotateRight8x32(w2, 19)),
+															  _mm256_srli_epi32(w2, 10));
+							w[t & 15] = _mm256_add_epi32(_mm256_add_epi32(w[t & 15], sigma0),
+														 _mm256_add_epi32(w[(t - 7) & 15], sigma1));
+						}
+						__m256i bigSigma1 = _mm256_xor_si256(_mm256_xor_si256(RotateRight8x32(e, 6), RotateRight8x32(e, 11)),
+															 RotateRight8x32(e, 25));
+						__m256i choose = _mm256_xor_si256(g, _mm256_and_si256(e, _mm256_xor_si256(f, g)));
+						__m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, bigSigma1),
+													  _mm256_add_epi32(_mm256_add_epi32(choose, w[t & 15]),
+																	   _mm256_set1_epi32((int)SHA256_round_constants[t])));
+						__m256i bigSigma0 = _mm256_xor_si256(_mm256_xor_si256(RotateRight8x32(a, 2), RotateRight8x32(a, 13)),
+															 RotateRight8x32(a, 22));
+						__m256i majority = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+						__m256i t2 = _mm256_add_epi32(bigSigma0, majority);
+						h = g;
+						g = f;
+						f = e;
+						e = _mm256_add_epi32(d, t1);
+						d = c;
+						c = b;
+						b = a;
+						a = _mm256_add_epi32(t1, t2);
+					}
+					
+					__m256i mask = _mm256_load_si256((const __m256i*)active);
+					s[0] = _mm256_add_epi32(s[0], _mm256_and_si256(a, mask));
+					s[1] = _mm256_add_epi32(s[1], _mm256_and_si256(b, mask));
+					s[2] = _mm256_add_epi32(s[2], _mm256_and_si256(c, mask));
+					s[3] = _mm256_add_epi32(s[3], _mm256_and_si256(d, mask));
+					s[4] = _mm256_add_epi32(s[4], _mm256_and_si256(e, mask));
+					s[5] = _mm256_add_epi32(s[5], _mm256_and_si256(f, mask));
+					s[6] = _mm256_add_epi32(s[6], _mm256_and_si256(g, mask));
+					s[7] = _mm256_add_epi32(s[7], _mm256_and_si256(h, mask));
+				}
+				
+				for (int i = 0; i < 8; ++i) {
+					_mm256_store_si256((__m256i*)digests[i], s[i]);
+				}
+				for (size_t lane = 0; lane < inLaneCount; ++lane) {
+					for (int i = 0; i < 8; ++i) {
+						ioDigests[lane][i] = digests[i][lane];
+					}
+				}
+			}
+			
+#endif
+			
+			//	FIPS PUB 180-2 specifies the possible length of the file up to 2^64 bits.
+			//	Here we only compute the number of bytes.  Do a double word increment.
+			void SHA256AddToTotal(SHA256State& ioState, uint64_t inDataSize) {
+				uint64_t total = ((uint64_t)ioState.total[1] << 32) + ioState.total[0] + inDataSize;
+				ioState.total[0] = (uint32_t)total;
+				ioState.total[1] = (uint32_t)(total >> 32);
+			}
+			
+			//
+			static std::atomic<int> sEngine((int)SHA256Engine::kAuto);
+			
+			//
+			bool CPUSupportsSHAExtensions() {
+#if HERMIT_SHA256_SIMD
+				const CPUFeatures& features = GetCPUFeatures();
+				return features.mSHA && features.mSSE41 && features.mSSSE3;
+#else
+				return false;
+#endif
+			}
+			
+			//
+			bool CPUSupportsAVX2MultiBuffer() {
+#if HERMIT_SHA256_SIMD
+				return GetCPUFeatures().mAVX2;
+#else
+				return false;
+#endif
+			}
+			
+			//
+			bool UseSHAExtensions() {
+				auto engine = (SHA256Engine)sEngine.load(std::memory_order_relaxed);
+				if (engine == SHA256Engine::kAuto) {
+					return CPUSupportsSHAExtensions();
 				}
+				return (engine == SHA256Engine::kSHAExtensions);
+			}
+			
+			//	Only worth it when the SHA extensions aren't there to hash each stream faster.
+			bool UseAVX2MultiBuffer() {
+				auto engine = (SHA256Engine)sEngine.load(std::memory_order_relaxed);
+				if (engine == SHA256Engine::kAuto) {
+					return !CPUSupportsSHAExtensions() && CPUSupportsAVX2MultiBuffer();
+				}
+				return (engine == SHA256Engine::kAVX2MultiBuffer);
+			}
+			
+			//	Process LEN bytes of BUFFER, accumulating context into CTX.
+			//	It is assumed that LEN % 64 == 0.
+			void SHA256ProcessBlock(SHA256State& ioState,
+									const void* inBuffer,
+									uint64_t inDataSize) {
+				SHA256AddToTotal(ioState, inDataSize);
+				
+				const unsigned char* blocks = static_cast<const unsigned char*>(inBuffer);
+#if HERMIT_SHA256_SIMD
+				if (UseSHAExtensions()) {
+					SHA256CompressWithSHA(ioState.state, blocks, inDataSize / 64);
+					return;
+				}
+#endif
+				SHA256CompressWithScalar(ioState.state, blocks, inDataSize / 64);
+			}
+			
+			//	Tops up a partially filled buffer from the front of the data, so whatever is
+			//	left starts on a block boundary. Returns the number of bytes taken.
+			uint64_t SHA256FillBuffer(SHA256State& ioState, const void* inData, uint64_t inDataSize) {
+				if (ioState.buflen == 0) {
+					return 0;
+				}
+				uint64_t add = 0;
+				if (ioState.buflen < 64) {
+					add = 64 - ioState.buflen > inDataSize ? inDataSize : 64 - ioState.buflen;
+					memcpy(&((char *) ioState.buffer)[ioState.buflen], inData, add);
+					ioState.buflen += add;
+				}
+				if (ioState.buflen == 64) {
+					SHA256ProcessBlock(ioState, ioState.buffer, 64);
+					ioState.buflen = 0;
+				}
+				return add;
 			}
 			
 		} // private namespace
 		
+		//
+		bool SetSHA256Engine(SHA256Engine inEngine) {
+			switch (inEngine) {
+				case SHA256Engine::kSHAExtensions:
+					if (!CPUSupportsSHAExtensions()) {
+						return false;
+					}
+					break;
+				case SHA256Engine::kAVX2MultiBuffer:
+					if (!CPUSupportsAVX2MultiBuffer()) {
+						return false;
+					}
+					break;
+				default:
+					break;
+			}
+			sEngine = (int)inEngine;
+			return true;
+		}
+		
 		//
 		void SHA256Init(SHA256State& ioState) {
 			ioState.state[0] = 0x6a09e667UL;
@@ -262,20 +583,12 @@ H = t0 + t1; \
 				len -= add;
 			}
 			
-			//	Process available complete blocks.
+			//	Process available complete blocks. The kernels load words bytewise, so the
+			//	data needn't be aligned.
 			if (len >= 64) {
-				if (E38_UNALIGNED_P(buffer)) {
-					while (len > 64) {
-						SHA256ProcessBlock(ioState, memcpy(ioState.buffer, buffer, 64), 64);
-						buffer = (const char *) buffer + 64;
-						len -= 64;
-					}
-				}
-				else {
-					SHA256ProcessBlock(ioState, buffer, len & ~63);
-					buffer = (const char *) buffer + (len & ~63);
-					len &= 63;
-				}
+				SHA256ProcessBlock(ioState, buffer, len & ~63);
+				buffer = (const char *) buffer + (len & ~63);
+				len &= 63;
 			}
 			
 			//	Move remaining bytes in internal buffer.
@@ -293,6 +606,50 @@ H = t0 + t1; \
 			}
 		}
 		
+		//
+		void SHA256ProcessBytesMulti(SHA256State* const* ioStates,
+									 const void* const* inData,
+									 const uint64_t* inDataSizes,
+									 size_t inCount) {
+#if HERMIT_SHA256_SIMD
+			if (UseAVX2MultiBuffer()) {
+				size_t start = 0;
+				while ((inCount - start) >= kMinAVX2Lanes) {
+					size_t laneCount = (inCount - start) < kSHA256Lanes ? (inCount - start) : kSHA256Lanes;
+					uint32_t* digests[kSHA256Lanes];
+					const unsigned char* blocks[kSHA256Lanes];
+					uint64_t blockCounts[kSHA256Lanes];
+					for (size_t lane = 0; lane < laneCount; ++lane) {
+						SHA256State& state = *ioStates[start + lane];
+						const unsigned char* p = static_cast<const unsigned char*>(inData[start + lane]);
+						uint64_t size = inDataSizes[start + lane];
+						uint64_t taken = SHA256FillBuffer(state, p, size);
+						digests[lane] = state.state;
+						blocks[lane] = p + taken;
+						blockCounts[lane] = (size - taken) / 64;
+					}
+					SHA256CompressLanesWithAVX2(digests, blocks, blockCounts, laneCount);
+					for (size_t lane = 0; lane < laneCount; ++lane) {
+						SHA256State& state = *ioStates[start + lane];
+						const unsigned char* p = static_cast<const unsigned char*>(inData[start + lane]);
+						uint64_t size = inDataSizes[start + lane];
+						uint64_t done = blocks[lane] - p + blockCounts[lane] * 64;
+						SHA256AddToTotal(state, blockCounts[lane] * 64);
+						SHA256ProcessBytes(state, p + done, size - done);
+					}
+					start += laneCount;
+				}
+				for (; start < inCount; ++start) {
+					SHA256ProcessBytes(*ioStates[start], inData[start], inDataSizes[start]);
+				}
+				return;
+			}
+#endif
+			for (size_t n = 0; n < inCount; ++n) {
+				SHA256ProcessBytes(*ioStates[n], inData[n], inDataSizes[n]);
+			}
+		}
+		
 		//
 		void* SHA256Read(const SHA256State& inState, void* outResult) {
 			for (int i = 0; i < 8; i++) {
@@ -351,6 +708,23 @@ H = t0 + t1; \
 			return SHA256Finish(state, outResult);
 		}
 		
+		//
+		void CalculateSHA256Multi(const char* const* inData,
+								  const uint64_t* inDataSizes,
+								  size_t inCount,
+								  void* const* outResults) {
+			std::vector<SHA256State> states(inCount);
+			std::vector<SHA256State*> statePtrs(inCount);
+			for (size_t n = 0; n < inCount; ++n) {
+				SHA256Init(states[n]);
+				statePtrs[n] = &states[n];
+			}
+			SHA256ProcessBytesMulti(statePtrs.data(), (const void* const*)inData, inDataSizes, inCount);
+			for (size_t n = 0; n < inCount; ++n) {
+				SHA256Finish(states[n], outResults[n]);
+			}
+		}
+		
 		//
 		void* CalculateSHA224(const char* inData, uint64_t inDataSize, void* outResult) {
 			SHA256State state;
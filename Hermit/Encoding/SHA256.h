@@ -19,11 +19,25 @@
 #ifndef SHA256_H
 #define SHA256_H
 
+#include <cstddef>
 #include <cstdint>
 
 namespace hermit {
 namespace encoding {
 
+//	The compression engines behind SHA256ProcessBytes and SHA256ProcessBytesMulti. kAuto,
+//	the default, uses the fastest one the CPU supports; the others pin one path so that
+//	hermit_bench can measure each of them.
+enum class SHA256Engine {
+	kAuto,
+	kScalar,
+	kSHAExtensions,
+	kAVX2MultiBuffer
+};
+
+//	Returns false, leaving the engine unchanged, if this CPU can't run the one asked for.
+bool SetSHA256Engine(SHA256Engine inEngine);
+
 //
 struct SHA256State {
 	std::uint32_t state[8];
@@ -41,6 +55,15 @@ void SHA224Init(SHA256State& ioState);
 //
 void SHA256ProcessBytes(SHA256State& ioState, const void* inData, std::uint64_t inDataSize);
 
+//	Feeds inData[n] into *ioStates[n] for each of inCount independent streams. Results are
+//	the same as calling SHA256ProcessBytes on each; on CPUs with AVX2 but no SHA extensions,
+//	batches of four to eight streams (the parts of a multipart upload, say) are hashed
+//	side by side, which is worthwhile when they're of similar size.
+void SHA256ProcessBytesMulti(SHA256State* const* ioStates,
+							 const void* const* inData,
+							 const std::uint64_t* inDataSizes,
+							 std::size_t inCount);
+
 //
 void* SHA256Read(const SHA256State& inState, void* outResult);
 
@@ -56,6 +79,13 @@ void* SHA224Finish(SHA256State& ioState, void* outResult);
 //
 void* CalculateSHA256(const char* inData, std::uint64_t inDataSize, void* outResult);
 
+//	Writes the SHA-256 of inData[n] to outResults[n] for each of inCount buffers, using
+//	SHA256ProcessBytesMulti.
+void CalculateSHA256Multi(const char* const* inData,
+						  const std::uint64_t* inDataSizes,
+						  std::size_t inCount,
+						  void* const* outResults);
+
 //
 void* CalculateSHA224(const char* inData, std::uint64_t inDataSize, void* outResult);
 	
@@ -16,10 +16,15 @@
 //	along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#include <algorithm>
+#include <atomic>
+#include <deque>
 #include <list>
+#include <mutex>
 #include <set>
 #include <string>
 #include <vector>
+#include "Hermit/Foundation/AsyncTaskQueue.h"
 #include "Hermit/Foundation/Notification.h"
 #include "Hermit/String/GetRelativePath.h"
 #include "AppendToFilePath.h"
@@ -692,14 +697,14 @@ namespace hermit {
 								  const FilePathPtr& filePath1,
 								  const FilePathPtr& filePath2) {
 					FileType fileType1 = FileType::kUnknown;
-					if (!GetFileType(h_, filePath1, fileType1)) {
+					if (GetFileType(h_, filePath1, fileType1) != GetFileTypeStatus::kSuccess) {
 						NOTIFY_ERROR(h_, "GetFileType failed for:", filePath1);
 						mStatus = CompareFilesStatus::kError;
 						ClearBusyFlag(h_);
 						return;
 					}
 					FileType fileType2 = FileType::kUnknown;
-					if (!GetFileType(h_, filePath2, fileType2)) {
+					if (GetFileType(h_, filePath2, fileType2) != GetFileTypeStatus::kSuccess) {
 						NOTIFY_ERROR(h_, "GetFileType failed for:", filePath2);
 						mStatus = CompareFilesStatus::kError;
 						ClearBusyFlag(h_);
@@ -905,9 +910,846 @@ namespace hermit {
 				pthread_cond_t mCondition;
 			};
 			
+			//	Listing stops getting ahead of the comparisons once this many items are waiting
+			//	to be compared or, with ordered notifications, to be delivered.
+			const size_t kMaxPendingItems = 4096;
+			
+			//	A notification held back until those of the items before it have been sent.
+			class HeldNotification {
+			public:
+				//
+				virtual ~HeldNotification() = default;
+				
+				//
+				virtual void Deliver(const HermitPtr& h_) = 0;
+			};
+			typedef std::shared_ptr<HeldNotification> HeldNotificationPtr;
+			typedef std::vector<HeldNotificationPtr> HeldNotifications;
+			
+			//
+			class HeldFileNotification : public HeldNotification {
+			public:
+				//
+				HeldFileNotification(const char* name, const FileNotificationParams& params) :
+				mName(name),
+				mParams(params) {
+				}
+				
+				//
+				virtual void Deliver(const HermitPtr& h_) override {
+					NOTIFY(h_, mName.c_str(), &mParams);
+				}
+				
+				//
+				std::string mName;
+				FileNotificationParams mParams;
+			};
+			
+			//
+			class HeldMessage : public HeldNotification {
+			public:
+				//
+				HeldMessage(const MessageParams& params) :
+				mSeverity(params.severity),
+				mMessage(params.message) {
+				}
+				
+				//
+				virtual void Deliver(const HermitPtr& h_) override {
+					NotifyMessage(h_, mSeverity, mMessage.c_str());
+				}
+				
+				//
+				MessageSeverity mSeverity;
+				std::string mMessage;
+			};
+			
+			//
+			bool IsFileNotification(const std::string& name) {
+				return ((name == kFilesMatchNotification) ||
+						(name == kFilesDifferNotification) ||
+						(name == kFileSkippedNotification) ||
+						(name == kPermissionDeniedNotification) ||
+						(name == kFileErrorNotification));
+			}
+			
+			//
+			struct DirectoryPair;
+			typedef std::shared_ptr<DirectoryPair> DirectoryPairPtr;
+			
+			//	One step of the comparison whose notifications are delivered together: the listing
+			//	of a directory pair, the comparison of an item pair, or a directory's attributes.
+			struct Item {
+				//
+				Item() : mDone(false) {
+				}
+				
+				//
+				bool mDone;
+				HeldNotifications mNotifications;
+				//	The directories whose listing finishes this item, until delivered.
+				DirectoryPairPtr mDirectoryPair;
+			};
+			typedef std::shared_ptr<Item> ItemPtr;
+			
+			//
+			struct DirectoryPair {
+				//
+				DirectoryPair(const DirectoryPairPtr& parent,
+							  const ItemPtr& item,
+							  const FilePathPtr& path1,
+							  const FilePathPtr& path2) :
+				mParent(parent),
+				mItem(item),
+				mPath1(path1),
+				mPath2(path2),
+				mListResult1(ListDirectoryContentsResult::kUnknown),
+				mListResult2(ListDirectoryContentsResult::kUnknown),
+				mListing1(std::make_shared<Item>()),
+				mListing2(std::make_shared<Item>()),
+				mListingsPending(2),
+				mAttributes(std::make_shared<Item>()),
+				mPendingItems(0),
+				mChildrenMatch(true) {
+				}
+				
+				//	Released once the listing is over, since the parent's items refer back here.
+				DirectoryPairPtr mParent;
+				//	The item in the parent that this pair's listing finishes.
+				ItemPtr mItem;
+				FilePathPtr mPath1;
+				FilePathPtr mPath2;
+				DirectoryPtr mDir1;
+				DirectoryPtr mDir2;
+				ListDirectoryContentsResult mListResult1;
+				ListDirectoryContentsResult mListResult2;
+				ItemPtr mListing1;
+				ItemPtr mListing2;
+				int mListingsPending;
+				//	Only kept when notifications are ordered.
+				std::vector<ItemPtr> mItems;
+				ItemPtr mAttributes;
+				uint64_t mPendingItems;
+				bool mChildrenMatch;
+			};
+			
+			//
+			struct ListJob {
+				//
+				ListJob(const DirectoryPairPtr& pair, int side) : mPair(pair), mSide(side) {
+				}
+				
+				//
+				DirectoryPairPtr mPair;
+				int mSide;
+			};
+			
+			//
+			struct CompareJob {
+				//
+				CompareJob(const DirectoryPairPtr& pair, const ItemPtr& item, const FilePathPtr& path1, const FilePathPtr& path2) :
+				mPair(pair),
+				mItem(item),
+				mPath1(path1),
+				mPath2(path2) {
+				}
+				
+				//
+				DirectoryPairPtr mPair;
+				ItemPtr mItem;
+				FilePathPtr mPath1;
+				FilePathPtr mPath2;
+			};
+			
+			//
+			class SerializedPreprocessFunction : public PreprocessFileFunction {
+			public:
+				//
+				SerializedPreprocessFunction(const PreprocessFileFunctionPtr& function) : mFunction(function) {
+				}
+				
+				//
+				virtual PreprocessFileInstruction Preprocess(const HermitPtr& h_,
+															 const FilePathPtr& parent,
+															 const std::string& itemName) override {
+					std::lock_guard<std::mutex> lock(mMutex);
+					return mFunction->Preprocess(h_, parent, itemName);
+				}
+				
+				//
+				PreprocessFileFunctionPtr mFunction;
+				std::mutex mMutex;
+			};
+			
+			//
+			class ParallelComparator;
+			typedef std::shared_ptr<ParallelComparator> ParallelComparatorPtr;
+			
+			//	The Hermit handed to each listing and item comparison. It notes whether the items
+			//	matched, as HermitProxy does, and either holds notifications in the item or passes
+			//	them on through the comparator.
+			class ItemHermit : public Hermit {
+			public:
+				//
+				ItemHermit(const ParallelComparatorPtr& owner, const HermitPtr& h_, const ItemPtr& item) :
+				mOwner(owner),
+				mH_(h_),
+				mItem(item),
+				mMatchStatus(MatchStatus::kUnknown) {
+				}
+				
+				//
+				virtual bool ShouldAbort() override {
+					return CHECK_FOR_ABORT(mH_);
+				}
+				
+				//
+				virtual void Notify(const char* name, const void* param) override;
+				
+				//
+				ParallelComparatorPtr mOwner;
+				HermitPtr mH_;
+				ItemPtr mItem;
+				MatchStatus mMatchStatus;
+			};
+			typedef std::shared_ptr<ItemHermit> ItemHermitPtr;
+			
+			//	Compares directory trees with both sides of each directory pair listed at once and
+			//	their items compared by up to mConcurrency pool tasks. Directories are listed in
+			//	the same breadth-first order as Comparator, and notifications and results match
+			//	it: as there, a directory's attributes are compared once the items directly in it
+			//	are, so differences further down don't make its contents differ.
+			class ParallelComparator : public std::enable_shared_from_this<ParallelComparator> {
+			public:
+				//
+				ParallelComparator(const FilePathPtr& filePath1,
+								   const FilePathPtr& filePath2,
+								   const HardLinkMapPtr& hardLinkMap1,
+								   const HardLinkMapPtr& hardLinkMap2,
+								   const IgnoreDates& ignoreDates,
+								   const IgnoreFinderInfo& ignoreFinderInfo,
+								   const PreprocessFileFunctionPtr& preprocessFunction,
+								   const CompareDirectoriesOptions& options,
+								   const CompareDirectoriesCompletionPtr& completion) :
+				mFilePath1(filePath1),
+				mFilePath2(filePath2),
+				mHardLinkMap1(hardLinkMap1),
+				mHardLinkMap2(hardLinkMap2),
+				mIgnoreDates(ignoreDates),
+				mIgnoreFinderInfo(ignoreFinderInfo),
+				mConcurrency(std::max(options.mConcurrency, (uint32_t)1)),
+				mOrdered(options.mOrderedNotifications),
+				mCompletion(completion),
+				mStatus(CompareFilesStatus::kSuccess),
+				mJobsInFlight(0),
+				mJobsOutstanding(0),
+				mHeldItems(0),
+				mFlushIndex(0),
+				mStopped(false),
+				mFinished(false) {
+					if (preprocessFunction != nullptr) {
+						mPreprocessFunction = std::make_shared<SerializedPreprocessFunction>(preprocessFunction);
+					}
+				}
+				
+				//
+				class ListTask : public AsyncTask {
+				public:
+					//
+					ListTask(const ParallelComparatorPtr& owner, const ListJob& job) : mOwner(owner), mJob(job) {
+					}
+					
+					//
+					virtual void PerformTask(const HermitPtr& h_) override {
+						mOwner->List(h_, mJob);
+					}
+					
+					//
+					ParallelComparatorPtr mOwner;
+					ListJob mJob;
+				};
+				
+				//
+				class CompareTask : public AsyncTask {
+				public:
+					//
+					CompareTask(const ParallelComparatorPtr& owner, const CompareJob& job) : mOwner(owner), mJob(job) {
+					}
+					
+					//
+					virtual void PerformTask(const HermitPtr& h_) override {
+						mOwner->Compare(h_, mJob);
+					}
+					
+					//
+					ParallelComparatorPtr mOwner;
+					CompareJob mJob;
+				};
+				
+				//
+				class CompareItemCompletion : public CompareFilesCompletion {
+				public:
+					//
+					CompareItemCompletion(const ParallelComparatorPtr& owner, const ItemHermitPtr& proxy, const CompareJob& job) :
+					mOwner(owner),
+					mProxy(proxy),
+					mJob(job) {
+					}
+					
+					//
+					virtual void Call(const HermitPtr& h_, const CompareFilesStatus& status) override {
+						mOwner->CompareComplete(mProxy, mJob, status);
+					}
+					
+					//
+					ParallelComparatorPtr mOwner;
+					ItemHermitPtr mProxy;
+					CompareJob mJob;
+				};
+				
+				//
+				void Start(const HermitPtr& h_) {
+					mH_ = h_;
+					auto item = std::make_shared<Item>();
+					auto pair = std::make_shared<DirectoryPair>(nullptr, item, mFilePath1, mFilePath2);
+					{
+						std::lock_guard<std::mutex> lock(mMutex);
+						if (mOrdered) {
+							item->mDirectoryPair = pair;
+							mRootItem = item;
+						}
+						mListJobs.push_back(ListJob(pair, 1));
+						mListJobs.push_back(ListJob(pair, 2));
+						mJobsOutstanding += 2;
+					}
+					Dispatch(h_);
+				}
+				
+				//
+				void Dispatch(const HermitPtr& h_) {
+					if (CHECK_FOR_ABORT(h_)) {
+						SetStatus(CompareFilesStatus::kCancel);
+					}
+					
+					std::vector<ListJob> readyListings;
+					std::vector<CompareJob> readyComparisons;
+					{
+						std::lock_guard<std::mutex> lock(mMutex);
+						if (mStopped || (mStatus == CompareFilesStatus::kCancel)) {
+							mStopped = true;
+							for (auto it = begin(mListJobs); it != end(mListJobs); ++it) {
+								it->mPair->mParent = nullptr;
+							}
+							mJobsOutstanding -= (mListJobs.size() + mCompareJobs.size());
+							mListJobs.clear();
+							mCompareJobs.clear();
+						}
+						while (mJobsInFlight < mConcurrency) {
+							// keep listing ahead of the comparisons, but only so far
+							if (!mListJobs.empty() &&
+								((mJobsInFlight == 0) || ((mCompareJobs.size() + mHeldItems) < kMaxPendingItems))) {
+								readyListings.push_back(mListJobs.front());
+								mListJobs.pop_front();
+							}
+							else if (!mCompareJobs.empty()) {
+								readyComparisons.push_back(mCompareJobs.front());
+								mCompareJobs.pop_front();
+							}
+							else {
+								break;
+							}
+							++mJobsInFlight;
+						}
+					}
+					for (auto it = begin(readyListings); it != end(readyListings); ++it) {
+						auto task = std::make_shared<ListTask>(shared_from_this(), *it);
+						if (!QueueAsyncTask(h_, task, 10)) {
+							{
+								std::lock_guard<std::mutex> lock(mMutex);
+								it->mPair->mParent = nullptr;
+							}
+							QueueFailed(h_);
+						}
+					}
+					for (auto it = begin(readyComparisons); it != end(readyComparisons); ++it) {
+						auto task = std::make_shared<CompareTask>(shared_from_this(), *it);
+						if (!QueueAsyncTask(h_, task, 10)) {
+							QueueFailed(h_);
+						}
+					}
+				}
+				
+				//	Without the pool nothing more can be done, so what's left is dropped.
+				void QueueFailed(const HermitPtr& h_) {
+					NOTIFY_ERROR(h_, "ParallelComparator: QueueAsyncTask failed.");
+					{
+						std::lock_guard<std::mutex> lock(mMutex);
+						mStopped = true;
+					}
+					SetStatus(CompareFilesStatus::kError);
+					JobDone(h_);
+				}
+				
+				//
+				void List(const HermitPtr& h_, const ListJob& job) {
+					auto pair = job.mPair;
+					auto path = (job.mSide == 1) ? pair->mPath1 : pair->mPath2;
+					auto listing = (job.mSide == 1) ? pair->mListing1 : pair->mListing2;
+					auto proxy = std::make_shared<ItemHermit>(shared_from_this(), h_, mOrdered ? listing : nullptr);
+					auto dir = std::make_shared<Directory>(mPreprocessFunction);
+					auto status = ListDirectoryContents(proxy, path, false, *dir);
+					if ((status != ListDirectoryContentsResult::kSuccess) && (status != ListDirectoryContentsResult::kPermissionDenied)) {
+						NOTIFY_ERROR(proxy, "ListDirectoryContents failed for:", path);
+					}
+					
+					bool listed = false;
+					{
+						std::lock_guard<std::mutex> lock(mMutex);
+						if (job.mSide == 1) {
+							pair->mDir1 = dir;
+							pair->mListResult1 = status;
+						}
+						else {
+							pair->mDir2 = dir;
+							pair->mListResult2 = status;
+						}
+						listed = (--pair->mListingsPending == 0);
+					}
+					if (listed) {
+						PrepareDirectories(h_, pair);
+					}
+					JobDone(h_);
+				}
+				
+				//	Mirrors Comparator::PrepareDirectories once both sides are listed.
+				void PrepareDirectories(const HermitPtr& h_, const DirectoryPairPtr& pair) {
+					auto item = pair->mItem;
+					if (mOrdered) {
+						auto& held = item->mNotifications;
+						held.insert(end(held), begin(pair->mListing1->mNotifications), end(pair->mListing1->mNotifications));
+						held.insert(end(held), begin(pair->mListing2->mNotifications), end(pair->mListing2->mNotifications));
+						pair->mListing1 = nullptr;
+						pair->mListing2 = nullptr;
+					}
+					auto proxy = std::make_shared<ItemHermit>(shared_from_this(), h_, mOrdered ? item : nullptr);
+					auto status1 = pair->mListResult1;
+					auto status2 = pair->mListResult2;
+					DirectoryPairPtr parent;
+					{
+						std::lock_guard<std::mutex> lock(mMutex);
+						parent = pair->mParent;
+						pair->mParent = nullptr;
+					}
+					
+					bool failed = false;
+					if (((status1 != ListDirectoryContentsResult::kSuccess) && (status1 != ListDirectoryContentsResult::kPermissionDenied)) ||
+						((status2 != ListDirectoryContentsResult::kSuccess) && (status2 != ListDirectoryContentsResult::kPermissionDenied))) {
+						NOTIFY_ERROR(proxy, "PrepareDirectories failed for:", pair->mPath1, pair->mPath2);
+						SetStatus(CompareFilesStatus::kError);
+						failed = true;
+					}
+					else if ((status1 == ListDirectoryContentsResult::kPermissionDenied) ||
+							 (status2 == ListDirectoryContentsResult::kPermissionDenied)) {
+						if (status1 != status2) {
+							FileNotificationParams params(kDirectoryAccessDiffers, pair->mPath1, pair->mPath2);
+							NOTIFY(proxy, kFilesDifferNotification, &params);
+						}
+						if (status1 == ListDirectoryContentsResult::kPermissionDenied) {
+							FileNotificationParams params(kPermissionDenied, pair->mPath1);
+							NOTIFY(proxy, kPermissionDeniedNotification, &params);
+						}
+						if (status2 == ListDirectoryContentsResult::kPermissionDenied) {
+							FileNotificationParams params(kPermissionDenied, pair->mPath2);
+							NOTIFY(proxy, kPermissionDeniedNotification, &params);
+						}
+						failed = true;
+						if (parent != nullptr) {
+							std::lock_guard<std::mutex> lock(mMutex);
+							parent->mChildrenMatch = false;
+						}
+					}
+					
+					bool compareAttributes = false;
+					if (!failed) {
+						compareAttributes = MergeListings(h_, pair);
+					}
+					else {
+						std::lock_guard<std::mutex> lock(mMutex);
+						item->mDirectoryPair = nullptr;
+					}
+					if (ItemDone(h_, parent, item)) {
+						CompareDirectoryAttributes(h_, parent);
+					}
+					if (compareAttributes) {
+						CompareDirectoryAttributes(h_, pair);
+					}
+				}
+				
+				//	Queues the item pairs and notes the items on only one side. Returns true if
+				//	there was nothing to queue, leaving the directories' attributes to compare.
+				bool MergeListings(const HermitPtr& h_, const DirectoryPairPtr& pair) {
+					std::vector<CompareJob> jobs;
+					CompareFileInfoPtrs firstComesBeforeSecondFn;
+					auto it1 = begin(pair->mDir1->mFiles);
+					auto end1 = end(pair->mDir1->mFiles);
+					auto it2 = begin(pair->mDir2->mFiles);
+					auto end2 = end(pair->mDir2->mFiles);
+					bool childrenMatch = true;
+					while ((it1 != end1) || (it2 != end2)) {
+						auto item = std::make_shared<Item>();
+						auto proxy = std::make_shared<ItemHermit>(shared_from_this(), h_, mOrdered ? item : nullptr);
+						if ((it2 == end2) || ((it1 != end1) && firstComesBeforeSecondFn(*it1, *it2))) {
+							childrenMatch = false;
+							FileNotificationParams params(kItemInPath1Only, (*it1)->mPath, NULL);
+							NOTIFY(proxy, kFilesDifferNotification, &params);
+							item->mDone = true;
+							++it1;
+						}
+						else if ((it1 == end1) || firstComesBeforeSecondFn(*it2, *it1)) {
+							childrenMatch = false;
+							FileNotificationParams params(kItemInPath2Only, NULL, (*it2)->mPath);
+							NOTIFY(proxy, kFilesDifferNotification, &params);
+							item->mDone = true;
+							++it2;
+						}
+						else {
+							jobs.push_back(CompareJob(pair, item, (*it1)->mPath, (*it2)->mPath));
+							++it1;
+							++it2;
+						}
+						if (mOrdered) {
+							pair->mItems.push_back(item);
+						}
+					}
+					
+					std::lock_guard<std::mutex> lock(mMutex);
+					pair->mDir1 = nullptr;
+					pair->mDir2 = nullptr;
+					if (!childrenMatch) {
+						pair->mChildrenMatch = false;
+					}
+					if (mOrdered) {
+						mHeldItems += (pair->mItems.size() - jobs.size());
+					}
+					pair->mPendingItems = jobs.size();
+					mCompareJobs.insert(end(mCompareJobs), begin(jobs), end(jobs));
+					mJobsOutstanding += jobs.size();
+					return jobs.empty();
+				}
+				
+				//	Mirrors Comparator::ProcessFiles.
+				void Compare(const HermitPtr& h_, const CompareJob& job) {
+					auto proxy = std::make_shared<ItemHermit>(shared_from_this(), h_, mOrdered ? job.mItem : nullptr);
+					FileType fileType1 = FileType::kUnknown;
+					if (GetFileType(proxy, job.mPath1, fileType1) != GetFileTypeStatus::kSuccess) {
+						NOTIFY_ERROR(proxy, "GetFileType failed for:", job.mPath1);
+						SetStatus(CompareFilesStatus::kError);
+						CompareDone(h_, job);
+						return;
+					}
+					FileType fileType2 = FileType::kUnknown;
+					if (GetFileType(proxy, job.mPath2, fileType2) != GetFileTypeStatus::kSuccess) {
+						NOTIFY_ERROR(proxy, "GetFileType failed for:", job.mPath2);
+						SetStatus(CompareFilesStatus::kError);
+						CompareDone(h_, job);
+						return;
+					}
+					
+					if (fileType1 != fileType2) {
+						FileNotificationParams params(kFileTypesDiffer, job.mPath1, job.mPath2);
+						NOTIFY(proxy, kFilesDifferNotification, &params);
+						{
+							std::lock_guard<std::mutex> lock(mMutex);
+							job.mPair->mChildrenMatch = false;
+						}
+						CompareDone(h_, job);
+						return;
+					}
+					
+					if (fileType1 == FileType::kDirectory) {
+						// the item is done once the pair inside it is listed
+						auto pair = std::make_shared<DirectoryPair>(job.mPair, job.mItem, job.mPath1, job.mPath2);
+						{
+							std::lock_guard<std::mutex> lock(mMutex);
+							if (mOrdered) {
+								job.mItem->mDirectoryPair = pair;
+							}
+							mListJobs.push_back(ListJob(pair, 1));
+							mListJobs.push_back(ListJob(pair, 2));
+							mJobsOutstanding += 2;
+						}
+						JobDone(h_);
+						return;
+					}
+					
+					if (fileType1 == FileType::kSymbolicLink) {
+						auto status = CompareLinks(proxy, mFilePath1, job.mPath1, mFilePath2, job.mPath2, mIgnoreDates);
+						if (status == CompareLinksStatus::kCancel) {
+							SetStatus(CompareFilesStatus::kCancel);
+						}
+						else if (status != CompareLinksStatus::kSuccess) {
+							NOTIFY_ERROR(proxy, "CompareLinks failed for path 1:", job.mPath1, "path 2:", job.mPath2);
+							SetStatus(CompareFilesStatus::kError);
+						}
+						CompareDone(h_, job);
+						return;
+					}
+					
+					auto completion = std::make_shared<CompareItemCompletion>(shared_from_this(), proxy, job);
+					CompareFiles(proxy,
+								 job.mPath1,
+								 job.mPath2,
+								 mHardLinkMap1,
+								 mHardLinkMap2,
+								 mIgnoreDates,
+								 mIgnoreFinderInfo,
+								 mPreprocessFunction,
+								 completion);
+				}
+				
+				//	Mirrors Comparator::CompareComplete.
+				void CompareComplete(const ItemHermitPtr& proxy, const CompareJob& job, const CompareFilesStatus& status) {
+					if ((status != CompareFilesStatus::kSuccess) && (status != CompareFilesStatus::kCancel)) {
+						NOTIFY_ERROR(proxy, "CompareFiles failed for:", job.mPath1, "and:", job.mPath2);
+					}
+					SetStatus(status);
+					if (proxy->mMatchStatus == MatchStatus::kUnknown) {
+						NOTIFY_ERROR(proxy, "matchStatus == MatchStatus::kUnknown");
+						SetStatus(CompareFilesStatus::kError);
+					}
+					else if (proxy->mMatchStatus == MatchStatus::kFilesDontMatch) {
+						std::lock_guard<std::mutex> lock(mMutex);
+						job.mPair->mChildrenMatch = false;
+					}
+					CompareDone(proxy->mH_, job);
+				}
+				
+				//
+				void CompareDone(const HermitPtr& h_, const CompareJob& job) {
+					bool compareAttributes = ItemDone(h_, job.mPair, job.mItem);
+					if (compareAttributes) {
+						CompareDirectoryAttributes(h_, job.mPair);
+					}
+					JobDone(h_);
+				}
+				
+				//	Returns true if that was the last item the parent was waiting on.
+				bool ItemDone(const HermitPtr& h_, const DirectoryPairPtr& parent, const ItemPtr& item) {
+					bool lastItem = false;
+					{
+						std::lock_guard<std::mutex> lock(mMutex);
+						item->mDone = true;
+						if (mOrdered) {
+							++mHeldItems;
+						}
+						if (parent != nullptr) {
+							lastItem = (--parent->mPendingItems == 0);
+						}
+					}
+					Flush(h_);
+					return lastItem;
+				}
+				
+				//
+				void CompareDirectoryAttributes(const HermitPtr& h_, const DirectoryPairPtr& pair) {
+					auto proxy = std::make_shared<ItemHermit>(shared_from_this(), h_, mOrdered ? pair->mAttributes : nullptr);
+					bool childrenMatch = true;
+					{
+						std::lock_guard<std::mutex> lock(mMutex);
+						childrenMatch = pair->mChildrenMatch;
+					}
+					bool attributesMatch = false;
+					if (!CompareAttributes(proxy,
+										   pair->mPath1,
+										   pair->mPath2,
+										   childrenMatch,
+										   mIgnoreDates,
+										   mIgnoreFinderInfo,
+										   attributesMatch)) {
+						NOTIFY_ERROR(proxy, "CompareAttributes failed");
+						SetStatus(CompareFilesStatus::kError);
+					}
+					ItemDone(h_, nullptr, pair->mAttributes);
+				}
+				
+				//
+				void SetStatus(const CompareFilesStatus& status) {
+					std::lock_guard<std::mutex> lock(mMutex);
+					if (status == CompareFilesStatus::kCancel) {
+						if (mStatus == CompareFilesStatus::kSuccess) {
+							mStatus = CompareFilesStatus::kCancel;
+						}
+					}
+					else if (status != CompareFilesStatus::kSuccess) {
+						mStatus = status;
+					}
+				}
+				
+				//
+				void JobDone(const HermitPtr& h_) {
+					{
+						std::lock_guard<std::mutex> lock(mMutex);
+						--mJobsInFlight;
+						--mJobsOutstanding;
+					}
+					Dispatch(h_);
+					
+					CompareFilesStatus status = CompareFilesStatus::kUnknown;
+					{
+						std::lock_guard<std::mutex> lock(mMutex);
+						if (mFinished || (mJobsOutstanding > 0)) {
+							return;
+						}
+						mFinished = true;
+						status = mStatus;
+					}
+					
+					// stopping early can leave items unfinished, and whatever follows them is dropped
+					Flush(h_);
+					{
+						std::lock_guard<std::mutex> lock(mMutex);
+						mRootItem = nullptr;
+						mFlushPairs.clear();
+					}
+					
+					if (status == CompareFilesStatus::kCancel) {
+						mCompletion->Call(mH_, CompareDirectoriesStatus::kCancel);
+						return;
+					}
+					if (status != CompareFilesStatus::kSuccess) {
+						NOTIFY_ERROR(mH_, "mStatus != CompareFilesStatus::kSuccess");
+						mCompletion->Call(mH_, CompareDirectoriesStatus::kError);
+						return;
+					}
+					mCompletion->Call(mH_, CompareDirectoriesStatus::kSuccess);
+				}
+				
+				//	Sends the held notifications of every finished item not waiting on an
+				//	unfinished one, in Comparator's order.
+				void Flush(const HermitPtr& h_) {
+					if (!mOrdered) {
+						return;
+					}
+					std::lock_guard<std::mutex> flushLock(mFlushMutex);
+					while (true) {
+						HeldNotifications ready;
+						{
+							std::lock_guard<std::mutex> lock(mMutex);
+							TakeReadyNotifications(ready);
+						}
+						if (ready.empty()) {
+							break;
+						}
+						std::lock_guard<std::mutex> lock(mCallbackMutex);
+						for (auto it = begin(ready); it != end(ready); ++it) {
+							(*it)->Deliver(mH_);
+						}
+					}
+				}
+				
+				//
+				void TakeReadyNotifications(HeldNotifications& outReady) {
+					if (mRootItem != nullptr) {
+						if (!mRootItem->mDone) {
+							return;
+						}
+						TakeItem(mRootItem, outReady);
+						mRootItem = nullptr;
+					}
+					while (!mFlushPairs.empty()) {
+						auto pair = mFlushPairs.front();
+						if (mFlushIndex < pair->mItems.size()) {
+							auto& item = pair->mItems[mFlushIndex];
+							if (!item->mDone) {
+								return;
+							}
+							TakeItem(item, outReady);
+							item = nullptr;
+							++mFlushIndex;
+						}
+						else {
+							if (!pair->mAttributes->mDone) {
+								return;
+							}
+							TakeItem(pair->mAttributes, outReady);
+							mFlushPairs.pop_front();
+							mFlushIndex = 0;
+						}
+					}
+				}
+				
+				//
+				void TakeItem(const ItemPtr& item, HeldNotifications& outReady) {
+					outReady.insert(end(outReady), begin(item->mNotifications), end(item->mNotifications));
+					item->mNotifications.clear();
+					if (item->mDirectoryPair != nullptr) {
+						mFlushPairs.push_back(item->mDirectoryPair);
+						item->mDirectoryPair = nullptr;
+					}
+					--mHeldItems;
+				}
+				
+				//
+				void Forward(const char* name, const void* param) {
+					std::lock_guard<std::mutex> lock(mCallbackMutex);
+					NOTIFY(mH_, name, param);
+				}
+				
+				//
+				FilePathPtr mFilePath1;
+				FilePathPtr mFilePath2;
+				HardLinkMapPtr mHardLinkMap1;
+				HardLinkMapPtr mHardLinkMap2;
+				IgnoreDates mIgnoreDates;
+				IgnoreFinderInfo mIgnoreFinderInfo;
+				PreprocessFileFunctionPtr mPreprocessFunction;
+				const uint32_t mConcurrency;
+				const bool mOrdered;
+				CompareDirectoriesCompletionPtr mCompletion;
+				HermitPtr mH_;
+				
+				std::mutex mMutex;
+				std::mutex mFlushMutex;
+				std::mutex mCallbackMutex;
+				CompareFilesStatus mStatus;
+				std::deque<ListJob> mListJobs;
+				std::deque<CompareJob> mCompareJobs;
+				uint32_t mJobsInFlight;
+				uint64_t mJobsOutstanding;
+				uint64_t mHeldItems;
+				ItemPtr mRootItem;
+				std::deque<DirectoryPairPtr> mFlushPairs;
+				size_t mFlushIndex;
+				bool mStopped;
+				bool mFinished;
+			};
+			
+			//
+			void ItemHermit::Notify(const char* name, const void* param) {
+				std::string nameStr(name);
+				if (nameStr == kFilesMatchNotification) {
+					mMatchStatus = MatchStatus::kFilesMatch;
+				}
+				else if (nameStr == kFilesDifferNotification) {
+					mMatchStatus = MatchStatus::kFilesDontMatch;
+				}
+				if (mItem != nullptr) {
+					if (IsFileNotification(nameStr)) {
+						mItem->mNotifications.push_back(std::make_shared<HeldFileNotification>(name, *(const FileNotificationParams*)param));
+						return;
+					}
+					if (nameStr == kMessageNotification) {
+						mItem->mNotifications.push_back(std::make_shared<HeldMessage>(*(const MessageParams*)param));
+						return;
+					}
+				}
+				mOwner->Forward(name, param);
+			}
+			
 		} // namespace CompareDirectories_Impl
         using namespace CompareDirectories_Impl;
 		
+		//
 		void CompareDirectories(const HermitPtr& h_,
 								const FilePathPtr& filePath1,
 								const FilePathPtr& filePath2,
@@ -917,8 +1759,31 @@ namespace hermit {
 								const IgnoreFinderInfo& ignoreFinderInfo,
 								const PreprocessFileFunctionPtr& preprocessFunction,
 								const CompareDirectoriesCompletionPtr& completion) {
+			CompareDirectories(h_,
+							   filePath1,
+							   filePath2,
+							   hardLinkMap1,
+							   hardLinkMap2,
+							   ignoreDates,
+							   ignoreFinderInfo,
+							   preprocessFunction,
+							   CompareDirectoriesOptions(),
+							   completion);
+		}
+		
+		//
+		void CompareDirectories(const HermitPtr& h_,
+								const FilePathPtr& filePath1,
+								const FilePathPtr& filePath2,
+								const HardLinkMapPtr& hardLinkMap1,
+								const HardLinkMapPtr& hardLinkMap2,
+								const IgnoreDates& ignoreDates,
+								const IgnoreFinderInfo& ignoreFinderInfo,
+								const PreprocessFileFunctionPtr& preprocessFunction,
+								const CompareDirectoriesOptions& options,
+								const CompareDirectoriesCompletionPtr& completion) {
 			FileType fileType1 = FileType::kUnknown;
-			if (!GetFileType(h_, filePath1, fileType1)) {
+			if (GetFileType(h_, filePath1, fileType1) != GetFileTypeStatus::kSuccess) {
 				NOTIFY_ERROR(h_, "GetFileType failed for:", filePath1);
 				completion->Call(h_, CompareDirectoriesStatus::kError);
 				return;
@@ -929,7 +1794,7 @@ namespace hermit {
 				return;
 			}
 			FileType fileType2 = FileType::kUnknown;
-			if (!GetFileType(h_, filePath2, fileType2)) {
+			if (GetFileType(h_, filePath2, fileType2) != GetFileTypeStatus::kSuccess) {
 				NOTIFY_ERROR(h_, "GetFileType failed for:", filePath2);
 				completion->Call(h_, CompareDirectoriesStatus::kError);
 				return;
@@ -940,6 +1805,20 @@ namespace hermit {
 				return;
 			}
 			
+			if (options.mConcurrency > 1) {
+				auto comparator = std::make_shared<ParallelComparator>(filePath1,
+																	   filePath2,
+																	   hardLinkMap1,
+																	   hardLinkMap2,
+																	   ignoreDates,
+																	   ignoreFinderInfo,
+																	   preprocessFunction,
+																	   options,
+																	   completion);
+				comparator->Start(h_);
+				return;
+			}
+			
 			auto comparator = std::make_shared<Comparator>(filePath1,
 														   filePath2,
 														   hardLinkMap1,
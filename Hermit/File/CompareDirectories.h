@@ -19,6 +19,7 @@
 #ifndef CompareDirectories_h
 #define CompareDirectories_h
 
+#include <cstdint>
 #include "Hermit/Foundation/AsyncFunction.h"
 #include "Hermit/Foundation/Hermit.h"
 #include "CompareFiles.h"
@@ -54,6 +55,39 @@ namespace hermit {
 								const PreprocessFileFunctionPtr& preprocessFunction,
 								const CompareDirectoriesCompletionPtr& completion);
 		
+		//
+		struct CompareDirectoriesOptions {
+			//
+			CompareDirectoriesOptions() :
+			mConcurrency(1),
+			mOrderedNotifications(false) {
+			}
+			
+			//	How many directory listings and item comparisons may run at once. With 1, the
+			//	trees are compared one item at a time on the calling thread. With more, both
+			//	trees are listed and their items compared by the thread pool. Notifications
+			//	then come from pool threads, but never from two at once, and preprocessFunction
+			//	is likewise only called from one thread at a time.
+			uint32_t mConcurrency;
+			
+			//	When comparing more than one item at a time, hold back each item's notifications
+			//	until those of the items before it have been sent, so they arrive in the same
+			//	order as with an mConcurrency of 1.
+			bool mOrderedNotifications;
+		};
+		
+		//
+		void CompareDirectories(const HermitPtr& h_,
+								const FilePathPtr& filePath1,
+								const FilePathPtr& filePath2,
+								const HardLinkMapPtr& hardLinkMap1,
+								const HardLinkMapPtr& hardLinkMap2,
+								const IgnoreDates& ignoreDates,
+								const IgnoreFinderInfo& ignoreFinderInfo,
+								const PreprocessFileFunctionPtr& preprocessFunction,
+								const CompareDirectoriesOptions& options,
+								const CompareDirectoriesCompletionPtr& completion);
+		
 	} // namespace file
 } // namespace hermit
 
@@ -0,0 +1,384 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "Hermit/Foundation/AsyncTaskQueue.h"
+#include "Hermit/Foundation/CompareMemory.h"
+#include "Hermit/Foundation/Notification.h"
+#include "FilePathToCocoaPathString.h"
+#include "CompareFileData.h"
+
+namespace hermit {
+	namespace file {
+		namespace CompareFileData_Impl {
+			
+			//
+			const size_t kChunkSize = 4 * 1024 * 1024;
+			
+			//	Page alignment lets the kernel copy straight into the buffers.
+			const size_t kBufferAlignment = 4096;
+			
+			//
+			struct AlignedBufferDeleter {
+				void operator()(char* p) const {
+					::free(p);
+				}
+			};
+			typedef std::unique_ptr<char, AlignedBufferDeleter> AlignedBuffer;
+			
+			//
+			AlignedBuffer AllocateBuffer(size_t size) {
+				void* p = nullptr;
+				if (::posix_memalign(&p, kBufferAlignment, std::max(size, (size_t)1)) != 0) {
+					return nullptr;
+				}
+				return AlignedBuffer(static_cast<char*>(p));
+			}
+			
+			//	Reads until size bytes are in or the file ends. Returns an errno, or 0.
+			int ReadFully(int fd, char* data, size_t size, uint64_t offset, size_t& outBytesRead) {
+				outBytesRead = 0;
+				while (outBytesRead < size) {
+					ssize_t bytesRead = ::pread(fd, data + outBytesRead, size - outBytesRead, (off_t)(offset + outBytesRead));
+					if (bytesRead < 0) {
+						int err = errno;
+						if (err == EINTR) {
+							continue;
+						}
+						return err;
+					}
+					if (bytesRead == 0) {
+						break;
+					}
+					outBytesRead += (size_t)bytesRead;
+				}
+				return 0;
+			}
+			
+			//
+			class OpenFile {
+			public:
+				//
+				OpenFile() : mFileDescriptor(-1), mSize(0) {
+				}
+				
+				//
+				~OpenFile() {
+					if (mFileDescriptor != -1) {
+						::close(mFileDescriptor);
+					}
+				}
+				
+				//
+				bool Open(const HermitPtr& h_, const FilePathPtr& filePath) {
+					std::string filePathUTF8;
+					FilePathToCocoaPathString(h_, filePath, filePathUTF8);
+					mFileDescriptor = ::open(filePathUTF8.c_str(), O_RDONLY | O_CLOEXEC);
+					if (mFileDescriptor == -1) {
+						int err = errno;
+						NOTIFY_ERROR(h_, "CompareFileData: open failed for:", filePath, "err:", err);
+						return false;
+					}
+					struct stat s;
+					if (::fstat(mFileDescriptor, &s) != 0) {
+						int err = errno;
+						NOTIFY_ERROR(h_, "CompareFileData: fstat failed for:", filePath, "err:", err);
+						return false;
+					}
+					mSize = (s.st_size > 0) ? (uint64_t)s.st_size : 0;
+#if defined(POSIX_FADV_SEQUENTIAL)
+					::posix_fadvise(mFileDescriptor, 0, 0, POSIX_FADV_SEQUENTIAL);
+#elif defined(F_RDAHEAD)
+					::fcntl(mFileDescriptor, F_RDAHEAD, 1);
+#endif
+					return true;
+				}
+				
+				//
+				int mFileDescriptor;
+				uint64_t mSize;
+			};
+			
+			//
+			enum class FillState {
+				kQueued,
+				kFilling,
+				kFilled
+			};
+			
+			//	Reads one file into a pair of chunk buffers with ThreadPool tasks, staying one
+			//	chunk ahead of the chunk being compared. Chunk n is at n * kChunkSize, so each
+			//	fill knows its offset up front; one at or past the end reads nothing, which is
+			//	how the end of the file shows up.
+			class ChunkReader : public std::enable_shared_from_this<ChunkReader> {
+			public:
+				//
+				ChunkReader(int fileDescriptor, uint64_t size) :
+				mFileDescriptor(fileDescriptor),
+				mSize(size),
+				mNextChunk(0) {
+				}
+				
+				//
+				bool Start(const HermitPtr& h_) {
+					for (int n = 0; n < 2; ++n) {
+						mSlots[n].mData = AllocateBuffer(kChunkSize);
+						if (mSlots[n].mData == nullptr) {
+							return false;
+						}
+					}
+					for (int n = 0; n < 2; ++n) {
+						QueueFill(h_, mSlots[n], (uint64_t)n * kChunkSize);
+					}
+					return true;
+				}
+				
+				//	Waits for the next chunk. Size 0 means the end of the file. Returns an errno, or 0.
+				int Next(const char*& outData, size_t& outSize) {
+					Slot& slot = mSlots[mNextChunk % 2];
+					RunFill(slot);
+					std::unique_lock<std::mutex> lock(mMutex);
+					while (slot.mState != FillState::kFilled) {
+						mCondition.wait(lock);
+					}
+					outData = slot.mData.get();
+					outSize = slot.mSize;
+					return slot.mError;
+				}
+				
+				//	Hands the chunk from the last Next back to be filled with the one after next.
+				void Release(const HermitPtr& h_) {
+					Slot& slot = mSlots[mNextChunk % 2];
+					QueueFill(h_, slot, (mNextChunk + 2) * kChunkSize);
+					++mNextChunk;
+				}
+				
+				//	Must be called before the file is closed: fills still queued are dropped and
+				//	running ones waited for.
+				void Stop() {
+					std::unique_lock<std::mutex> lock(mMutex);
+					for (int n = 0; n < 2; ++n) {
+						if (mSlots[n].mState == FillState::kQueued) {
+							mSlots[n].mState = FillState::kFilled;
+						}
+						while (mSlots[n].mState != FillState::kFilled) {
+							mCondition.wait(lock);
+						}
+					}
+				}
+				
+			private:
+				//
+				struct Slot {
+					//
+					Slot() : mSize(0), mError(0), mOffset(0), mState(FillState::kFilled) {
+					}
+					
+					//
+					AlignedBuffer mData;
+					size_t mSize;
+					int mError;
+					uint64_t mOffset;
+					FillState mState;
+				};
+				
+				//
+				class FillTask : public AsyncTask {
+				public:
+					//
+					FillTask(const std::shared_ptr<ChunkReader>& reader, Slot& slot) : mReader(reader), mSlot(slot) {
+					}
+					
+					//
+					virtual void PerformTask(const HermitPtr& h_) override {
+						mReader->RunFill(mSlot);
+					}
+					
+					//
+					std::shared_ptr<ChunkReader> mReader;
+					Slot& mSlot;
+				};
+				
+				//
+				void QueueFill(const HermitPtr& h_, Slot& slot, uint64_t offset) {
+					{
+						std::lock_guard<std::mutex> lock(mMutex);
+						slot.mOffset = offset;
+						slot.mState = FillState::kQueued;
+					}
+					// if the pool won't take it the slot stays queued and Next reads it
+					QueueAsyncTask(h_, std::make_shared<FillTask>(shared_from_this(), slot), 10);
+				}
+				
+				//	Fills the slot unless someone else already has or is doing so. Runs on a
+				//	ThreadPool worker, or in Next when the comparison gets there first.
+				void RunFill(Slot& slot) {
+					{
+						std::lock_guard<std::mutex> lock(mMutex);
+						if (slot.mState != FillState::kQueued) {
+							return;
+						}
+						slot.mState = FillState::kFilling;
+					}
+					
+					size_t wanted = (slot.mOffset < mSize) ? (size_t)std::min((uint64_t)kChunkSize, mSize - slot.mOffset) : 0;
+					size_t bytesRead = 0;
+					int err = ReadFully(mFileDescriptor, slot.mData.get(), wanted, slot.mOffset, bytesRead);
+					
+					std::lock_guard<std::mutex> lock(mMutex);
+					slot.mSize = bytesRead;
+					slot.mError = err;
+					slot.mState = FillState::kFilled;
+					mCondition.notify_all();
+				}
+				
+				//
+				int mFileDescriptor;
+				uint64_t mSize;
+				Slot mSlots[2];
+				uint64_t mNextChunk;
+				std::mutex mMutex;
+				std::condition_variable mCondition;
+			};
+			typedef std::shared_ptr<ChunkReader> ChunkReaderPtr;
+			
+			//
+			CompareFileDataResult CompareChunks(const HermitPtr& h_,
+												const FilePathPtr& filePath1,
+												const FilePathPtr& filePath2,
+												ChunkReader& reader1,
+												ChunkReader& reader2,
+												uint64_t& outDifferenceOffset) {
+				uint64_t offset = 0;
+				while (true) {
+					if (CHECK_FOR_ABORT(h_)) {
+						return CompareFileDataResult::kCanceled;
+					}
+					
+					const char* data1 = nullptr;
+					size_t size1 = 0;
+					int err = reader1.Next(data1, size1);
+					if (err != 0) {
+						NOTIFY_ERROR(h_, "CompareFileData: pread failed for:", filePath1, "err:", err);
+						return CompareFileDataResult::kError;
+					}
+					const char* data2 = nullptr;
+					size_t size2 = 0;
+					err = reader2.Next(data2, size2);
+					if (err != 0) {
+						NOTIFY_ERROR(h_, "CompareFileData: pread failed for:", filePath2, "err:", err);
+						return CompareFileDataResult::kError;
+					}
+					
+					size_t commonSize = std::min(size1, size2);
+					uint64_t matchingBytes = FindFirstMismatch(data1, data2, commonSize);
+					if ((matchingBytes < commonSize) || (size1 != size2)) {
+						outDifferenceOffset = offset + matchingBytes;
+						return CompareFileDataResult::kDifferent;
+					}
+					if (size1 == 0) {
+						return CompareFileDataResult::kMatch;
+					}
+					offset += size1;
+					reader1.Release(h_);
+					reader2.Release(h_);
+				}
+			}
+			
+			//
+			CompareFileDataResult CompareSmallFiles(const HermitPtr& h_,
+													const FilePathPtr& filePath1,
+													const FilePathPtr& filePath2,
+													const OpenFile& file1,
+													const OpenFile& file2,
+													uint64_t& outDifferenceOffset) {
+				AlignedBuffer data1 = AllocateBuffer((size_t)file1.mSize);
+				AlignedBuffer data2 = AllocateBuffer((size_t)file2.mSize);
+				if ((data1 == nullptr) || (data2 == nullptr)) {
+					NOTIFY_ERROR(h_, "CompareFileData: buffer allocation failed for:", filePath1);
+					return CompareFileDataResult::kError;
+				}
+				size_t size1 = 0;
+				int err = ReadFully(file1.mFileDescriptor, data1.get(), (size_t)file1.mSize, 0, size1);
+				if (err != 0) {
+					NOTIFY_ERROR(h_, "CompareFileData: pread failed for:", filePath1, "err:", err);
+					return CompareFileDataResult::kError;
+				}
+				size_t size2 = 0;
+				err = ReadFully(file2.mFileDescriptor, data2.get(), (size_t)file2.mSize, 0, size2);
+				if (err != 0) {
+					NOTIFY_ERROR(h_, "CompareFileData: pread failed for:", filePath2, "err:", err);
+					return CompareFileDataResult::kError;
+				}
+				
+				size_t commonSize = std::min(size1, size2);
+				uint64_t matchingBytes = FindFirstMismatch(data1.get(), data2.get(), commonSize);
+				if ((matchingBytes < commonSize) || (size1 != size2)) {
+					outDifferenceOffset = matchingBytes;
+					return CompareFileDataResult::kDifferent;
+				}
+				return CompareFileDataResult::kMatch;
+			}
+			
+		} // namespace CompareFileData_Impl
+		using namespace CompareFileData_Impl;
+		
+		//
+		CompareFileDataResult CompareFileData(const HermitPtr& h_,
+											  const FilePathPtr& filePath1,
+											  const FilePathPtr& filePath2,
+											  uint64_t& outDifferenceOffset) {
+			OpenFile file1;
+			if (!file1.Open(h_, filePath1)) {
+				return CompareFileDataResult::kError;
+			}
+			OpenFile file2;
+			if (!file2.Open(h_, filePath2)) {
+				return CompareFileDataResult::kError;
+			}
+			if ((file1.mSize <= kChunkSize) && (file2.mSize <= kChunkSize)) {
+				return CompareSmallFiles(h_, filePath1, filePath2, file1, file2, outDifferenceOffset);
+			}
+			
+			auto reader1 = std::make_shared<ChunkReader>(file1.mFileDescriptor, file1.mSize);
+			auto reader2 = std::make_shared<ChunkReader>(file2.mFileDescriptor, file2.mSize);
+			CompareFileDataResult result = CompareFileDataResult::kUnknown;
+			if (!reader1->Start(h_) || !reader2->Start(h_)) {
+				NOTIFY_ERROR(h_, "CompareFileData: buffer allocation failed for:", filePath1);
+				result = CompareFileDataResult::kError;
+			}
+			else {
+				result = CompareChunks(h_, filePath1, filePath2, *reader1, *reader2, outDifferenceOffset);
+			}
+			reader1->Stop();
+			reader2->Stop();
+			return result;
+		}
+		
+	} // namespace file
+} // namespace hermit
@@ -0,0 +1,52 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef CompareFileData_h
+#define CompareFileData_h
+
+#include <cstdint>
+#include "Hermit/Foundation/Hermit.h"
+#include "FilePath.h"
+
+namespace hermit {
+	namespace file {
+		
+		//
+		enum class CompareFileDataResult {
+			kUnknown,
+			kMatch,
+			kDifferent,
+			kCanceled,
+			kError
+		};
+		
+		//	Compares the data forks of two files. Each file is read in 4MB chunks at
+		//	chunk-aligned offsets by ThreadPool tasks, one chunk ahead of the pair the calling
+		//	thread is comparing with FindFirstMismatch. Files no bigger than one chunk are read
+		//	on the calling thread. On kDifferent, outDifferenceOffset is the first byte that differs, which
+		//	for files of different sizes may be the end of the shorter one.
+		CompareFileDataResult CompareFileData(const HermitPtr& h_,
+											  const FilePathPtr& filePath1,
+											  const FilePathPtr& filePath2,
+											  uint64_t& outDifferenceOffset);
+		
+	} // namespace file
+} // namespace hermit
+
+#endif
@@ -20,13 +20,12 @@
 #import <set>
 #import <string>
 #import <vector>
-#import "Hermit/Foundation/CompareMemory.h"
 #import "Hermit/Foundation/Notification.h"
+#import "CompareFileData.h"
 #import "CompareFinderInfo.h"
 #import "CompareLinks.h"
 #import "CompareXAttrs.h"
 #import "FileNotification.h"
-#import "FilePathToCocoaPathString.h"
 #import "GetAliasTarget.h"
 #import "GetCanonicalFilePathString.h"
 #import "GetFileACL.h"
@@ -272,150 +271,6 @@ namespace hermit {
 				completion->Call(h_, CompareFilesStatus::kSuccess);
 			}
 			
-			//
-			bool CompareData(const HermitPtr& h_,
-							 const FilePathPtr& inPath1,
-							 const FilePathPtr& inPath2,
-							 bool& outMatch,
-							 uint64_t& outDifferenceOffset) {
-				
-				std::string path1UTF8;
-				FilePathToCocoaPathString(h_, inPath1, path1UTF8);
-				
-				NSString* path1String = [NSString stringWithUTF8String:path1UTF8.c_str()];
-				NSError* error = nil;
-				NSFileHandle* file1Handle = [NSFileHandle fileHandleForReadingFromURL:[NSURL fileURLWithPath:path1String] error:&error];
-				if (error != nil) {
-					NSInteger errorCode = [error code];
-					NOTIFY_ERROR(h_,
-								 "CompareData: NSFileHandle fileHandleForReadingFromURL failed for path 1:",
-								 inPath1,
-								 "error code:",
-								 (int32_t)errorCode,
-								 "error:",
-								 [[error localizedDescription] UTF8String]);
-					return false;
-				}
-				if (file1Handle == nil) {
-					NOTIFY_ERROR(h_, "CompareData: NSFileHandle fileHandleForReadingAtPath returned nil fileHandle for path :", inPath1);
-					return false;
-				}
-				
-				std::string path2UTF8;
-				FilePathToCocoaPathString(h_, inPath2, path2UTF8);
-				
-				NSString* path2String = [NSString stringWithUTF8String:path2UTF8.c_str()];
-				NSFileHandle* file2Handle = [NSFileHandle fileHandleForReadingFromURL:[NSURL fileURLWithPath:path2String] error:&error];
-				if (error != nil) {
-					NSInteger errorCode = [error code];
-					NOTIFY_ERROR(h_,
-								 "CompareData: NSFileHandle fileHandleForReadingFromURL failed for path 2:",
-								 inPath2,
-								 "error code:",
-								 (int32_t)errorCode,
-								 "error",
-								 [[error localizedDescription] UTF8String]);
-					return false;
-				}
-				if (file2Handle == nil) {
-					[file1Handle closeFile];
-					
-					NOTIFY_ERROR(h_, "CompareData: NSFileHandle fileHandleForReadingAtPath returned nil fileHandle for path 2:", inPath2);
-					return false;
-				}
-				
-				bool failed = false;
-				uint64_t matchingBytes = 0;
-				bool match = false;
-				static const int kBufferSize = 32768;
-				while (true) {
-					@autoreleasepool {
-						@try {
-							NSData* data1 = nil;
-							@try {
-								data1 = [file1Handle readDataOfLength:kBufferSize];
-							}
-							@catch (NSException* ex) {
-								NOTIFY_ERROR(h_,
-											 "CompareData: exception during [file1Handle readDataOfLength] for path:",
-											 inPath1,
-											 "exception:",
-											 [[ex name] UTF8String],
-											 "reason:",
-											 [[ex reason] UTF8String]);
-								
-								failed = true;
-								break;
-							}
-							uint64_t actualCount1 = [data1 length];
-							
-							NSData* data2 = nil;
-							@try {
-								data2 = [file2Handle readDataOfLength:kBufferSize];
-							}
-							@catch (NSException* ex) {
-								NOTIFY_ERROR(h_,
-											 "CompareData: exception during [file2Handle readDataOfLength] for path:",
-											 inPath2,
-											 "exception:",
-											 [[ex name] UTF8String],
-											 "reason:",
-											 [[ex reason] UTF8String]);
-								
-								failed = true;
-								break;
-							}
-							uint64_t actualCount2 = [data2 length];
-							
-							if (actualCount1 != actualCount2) {
-								break;
-							}
-							if (actualCount1 == 0) {
-								match = true;
-								break;
-							}
-							
-							typedef const char* const_char_ptr;
-							const_char_ptr p1 = (const char*)[data1 bytes];
-							const_char_ptr p2 = (const char*)[data2 bytes];
-							size_t size = actualCount1;
-							
-							CompareMemoryCallbackClass compareCallback;
-							CompareMemory(p1, p2, size, compareCallback);
-							if (!compareCallback.mMatch) {
-								matchingBytes += compareCallback.mBytesThatMatch;
-								break;
-							}
-							if (actualCount1 < kBufferSize) {
-								match = true;
-								break;
-							}
-							matchingBytes += actualCount1;
-						}
-						@catch (NSException* ex) {
-							NOTIFY_ERROR(h_,
-										 "CompareData: Inner Exception:",
-										 [[ex name] UTF8String],
-										 "reason:",
-										 [[ex reason] UTF8String]);
-							failed = true;
-							break;
-						}
-					}
-				}
-				[file1Handle closeFile];
-				[file2Handle closeFile];
-				
-				if (failed) {
-					return false;
-				}
-				if (!match) {
-					outDifferenceOffset = matchingBytes;
-				}
-				outMatch = match;
-				return true;
-			}
-			
 			//
 			void CompareFiles_DataStep(const HermitPtr& h_,
 									   const FilePathPtr& filePath1,
@@ -450,19 +305,20 @@ namespace hermit {
 					NOTIFY(h_, kFilesDifferNotification, &params);
 				}
 				else if (fileSize1 > 0) {
-					@autoreleasepool {
-						uint64_t differenceOffset = 0;
-						bool dataMatch = false;
-						bool result = CompareData(h_, filePath1, filePath2, dataMatch, differenceOffset);
-						if (!result) {
-							completion->Call(h_, CompareFilesStatus::kError);
-							return;
-						}
-						if (!dataMatch) {
-							match = IsMatch::kNo;
-							FileNotificationParams params(kFileContentsDiffer, filePath1, filePath2, differenceOffset, 0);
-							NOTIFY(h_, kFilesDifferNotification, &params);
-						}
+					uint64_t differenceOffset = 0;
+					auto result = CompareFileData(h_, filePath1, filePath2, differenceOffset);
+					if (result == CompareFileDataResult::kCanceled) {
+						completion->Call(h_, CompareFilesStatus::kCancel);
+						return;
+					}
+					if (result == CompareFileDataResult::kError) {
+						completion->Call(h_, CompareFilesStatus::kError);
+						return;
+					}
+					if (result == CompareFileDataResult::kDifferent) {
+						match = IsMatch::kNo;
+						FileNotificationParams params(kFileContentsDiffer, filePath1, filePath2, differenceOffset, 0);
+						NOTIFY(h_, kFilesDifferNotification, &params);
 					}
 				}
 				
@@ -0,0 +1,281 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+#if defined(__linux__)
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#elif defined(__APPLE__)
+#include <sys/clonefile.h>
+#endif
+#include "Hermit/Foundation/Notification.h"
+#include "FilePathToCocoaPathString.h"
+#include "CopyFileDataInKernel.h"
+
+#if defined(__linux__) && !defined(FICLONE)
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+
+namespace hermit {
+	namespace file {
+		namespace CopyFileDataInKernel_Impl {
+			
+#if defined(__APPLE__)
+			
+			//	clonefile errors meaning "not here" rather than "failed": a file system other
+			//	than APFS, source and dest on different volumes. destPath already existing is
+			//	left to the buffered copy too, which replaces it as the Linux path does.
+			bool IsUnsupportedError(int err) {
+				return ((err == ENOTSUP) ||
+						(err == EXDEV) ||
+						(err == EEXIST));
+			}
+			
+#elif defined(__linux__)
+			
+			//	Largest piece handed to the kernel at once, so cancellation is noticed.
+			const size_t kMaxCopyChunkSize = 256 * 1024 * 1024;
+			
+			//	Errors meaning "not here" rather than "failed": a different file system on each
+			//	side, a file system or kernel without the call, and so on.
+			bool IsUnsupportedError(int err) {
+				return ((err == EXDEV) ||
+						(err == ENOSYS) ||
+						(err == EOPNOTSUPP) ||
+						(err == ENOTSUP) ||
+						(err == EINVAL) ||
+						(err == ENOTTY) ||
+						(err == EBADF));
+			}
+			
+			//
+			class FileDescriptors {
+			public:
+				//
+				FileDescriptors() : mSource(-1), mDest(-1) {
+				}
+				
+				//
+				~FileDescriptors() {
+					if (mSource != -1) {
+						::close(mSource);
+					}
+					if (mDest != -1) {
+						::close(mDest);
+					}
+				}
+				
+				//
+				int mSource;
+				int mDest;
+			};
+			
+			//	Copies [offset, offset + size) at the same offset in dest. Returns 0 or an errno;
+			//	fails with an unsupported error only if nothing has been copied by this strategy.
+			int CopyRange(const HermitPtr& h_,
+						  int source,
+						  int dest,
+						  off_t offset,
+						  off_t size,
+						  FileCopyStrategy strategy) {
+				if ((strategy == FileCopyStrategy::kSendFile) && (::lseek(dest, offset, SEEK_SET) < 0)) {
+					return errno;
+				}
+				off_t end = offset + size;
+				while (offset < end) {
+					if (CHECK_FOR_ABORT(h_)) {
+						return ECANCELED;
+					}
+					size_t chunkSize = (end - offset > (off_t)kMaxCopyChunkSize) ? kMaxCopyChunkSize : (size_t)(end - offset);
+					ssize_t bytesCopied = 0;
+					if (strategy == FileCopyStrategy::kCopyFileRange) {
+#if defined(__NR_copy_file_range)
+						loff_t sourceOffset = offset;
+						loff_t destOffset = offset;
+						bytesCopied = ::syscall(__NR_copy_file_range, source, &sourceOffset, dest, &destOffset, chunkSize, 0);
+#else
+						errno = ENOSYS;
+						bytesCopied = -1;
+#endif
+					}
+					else {
+						off_t sourceOffset = offset;
+						bytesCopied = ::sendfile(dest, source, &sourceOffset, chunkSize);
+					}
+					if (bytesCopied < 0) {
+						int err = errno;
+						if (err == EINTR) {
+							continue;
+						}
+						return err;
+					}
+					if (bytesCopied == 0) {
+						//	The source shrank underneath us.
+						return EIO;
+					}
+					offset += bytesCopied;
+				}
+				return 0;
+			}
+			
+			//	Walks the source's data extents, copying each with the current strategy and
+			//	dropping from copy_file_range to sendfile if the former turns out not to work.
+			int CopyDataExtents(const HermitPtr& h_,
+								int source,
+								int dest,
+								off_t size,
+								FileCopyStrategy& ioStrategy) {
+				off_t position = 0;
+				while (position < size) {
+					off_t dataStart = ::lseek(source, position, SEEK_DATA);
+					off_t dataEnd = size;
+					if (dataStart < 0) {
+						int err = errno;
+						if (err == ENXIO) {
+							//	Nothing but hole from here to the end.
+							break;
+						}
+						//	No SEEK_DATA support: treat the rest as one extent.
+						dataStart = position;
+					}
+					else {
+						dataEnd = ::lseek(source, dataStart, SEEK_HOLE);
+						if ((dataEnd < 0) || (dataEnd > size)) {
+							dataEnd = size;
+						}
+					}
+					
+					while (true) {
+						int err = CopyRange(h_, source, dest, dataStart, dataEnd - dataStart, ioStrategy);
+						if (err == 0) {
+							break;
+						}
+						if ((ioStrategy == FileCopyStrategy::kCopyFileRange) && IsUnsupportedError(err)) {
+							ioStrategy = FileCopyStrategy::kSendFile;
+							continue;
+						}
+						return err;
+					}
+					position = dataEnd;
+				}
+				
+				//	Sets the size, leaving any trailing hole as a hole.
+				if (::ftruncate(dest, size) != 0) {
+					return errno;
+				}
+				return 0;
+			}
+			
+#endif
+			
+			//
+			CopyFileDataResult ResultForError(const HermitPtr& h_, int err, const FilePathPtr& sourcePath) {
+				if (err == ECANCELED) {
+					return CopyFileDataResult::kCanceled;
+				}
+				if ((err == ENOSPC) || (err == EDQUOT)) {
+					return CopyFileDataResult::kDiskFull;
+				}
+				NOTIFY_ERROR(h_, "CopyFileDataInKernel: copy failed for:", sourcePath, "err:", err);
+				return CopyFileDataResult::kError;
+			}
+			
+		} // namespace CopyFileDataInKernel_Impl
+		using namespace CopyFileDataInKernel_Impl;
+		
+		//
+		CopyFileDataResult CopyFileDataInKernel(const HermitPtr& h_,
+												const FilePathPtr& sourcePath,
+												const FilePathPtr& destPath,
+												FileCopyStrategy& outStrategy) {
+			outStrategy = FileCopyStrategy::kUnknown;
+			std::string sourcePathUTF8;
+			FilePathToCocoaPathString(h_, sourcePath, sourcePathUTF8);
+			std::string destPathUTF8;
+			FilePathToCocoaPathString(h_, destPath, destPathUTF8);
+			
+#if defined(__APPLE__)
+			//	clonefile creates destPath itself, and only on APFS.
+			if (::clonefile(sourcePathUTF8.c_str(), destPathUTF8.c_str(), CLONE_NOFOLLOW) == 0) {
+				outStrategy = FileCopyStrategy::kClone;
+				return CopyFileDataResult::kSuccess;
+			}
+			int err = errno;
+			if (IsUnsupportedError(err)) {
+				return CopyFileDataResult::kUnsupported;
+			}
+			return ResultForError(h_, err, sourcePath);
+#elif defined(__linux__)
+			FileDescriptors files;
+			files.mSource = ::open(sourcePathUTF8.c_str(), O_RDONLY | O_CLOEXEC);
+			if (files.mSource == -1) {
+				return ResultForError(h_, errno, sourcePath);
+			}
+			struct stat s;
+			if (::fstat(files.mSource, &s) != 0) {
+				return ResultForError(h_, errno, sourcePath);
+			}
+			if (!S_ISREG(s.st_mode)) {
+				return CopyFileDataResult::kUnsupported;
+			}
+			files.mDest = ::open(destPathUTF8.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+			if (files.mDest == -1) {
+				return ResultForError(h_, errno, destPath);
+			}
+			
+			int err = 0;
+			if (::ioctl(files.mDest, FICLONE, files.mSource) == 0) {
+				outStrategy = FileCopyStrategy::kClone;
+			}
+			else {
+				err = errno;
+				if (IsUnsupportedError(err)) {
+					FileCopyStrategy strategy = FileCopyStrategy::kCopyFileRange;
+					err = CopyDataExtents(h_, files.mSource, files.mDest, s.st_size, strategy);
+					if (err == 0) {
+						outStrategy = strategy;
+					}
+				}
+			}
+			int closeErr = ::close(files.mDest);
+			files.mDest = -1;
+			if ((err == 0) && (closeErr != 0)) {
+				err = errno;
+			}
+			if (err == 0) {
+				return CopyFileDataResult::kSuccess;
+			}
+			
+			::unlink(destPathUTF8.c_str());
+			if (IsUnsupportedError(err)) {
+				return CopyFileDataResult::kUnsupported;
+			}
+			return ResultForError(h_, err, sourcePath);
+#else
+			return CopyFileDataResult::kUnsupported;
+#endif
+		}
+		
+	} // namespace file
+} // namespace hermit
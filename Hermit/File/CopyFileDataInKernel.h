@@ -0,0 +1,65 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef CopyFileDataInKernel_h
+#define CopyFileDataInKernel_h
+
+#include "Hermit/Foundation/Hermit.h"
+#include "FilePath.h"
+
+namespace hermit {
+	namespace file {
+		
+		//	How a file's data was copied, fastest first.
+		enum class FileCopyStrategy {
+			kUnknown,
+			kClone,				// reflink (FICLONE on Linux, clonefile on Darwin); no data moved
+			kCopyFileRange,		// copy_file_range, done inside the kernel or by the file system
+			kSendFile,			// sendfile, done inside the kernel
+			kBuffered			// ReadFileData into StreamOutFileData, through user space
+		};
+		
+		//
+		enum class CopyFileDataResult {
+			kUnknown,
+			kSuccess,
+			kUnsupported,
+			kCanceled,
+			kDiskFull,
+			kError
+		};
+		
+		//	Copies the data of sourcePath to a new file at destPath without passing it through
+		//	user-space buffers: a reflink where the file system supports it, otherwise
+		//	copy_file_range, otherwise sendfile. Holes in the source (found with
+		//	SEEK_DATA / SEEK_HOLE) are skipped, so sparse files stay sparse. On Darwin the
+		//	reflink is clonefile, which also carries the source's metadata (mode, ACLs, xattrs,
+		//	BSD flags and dates) to destPath. The FICLONE, copy_file_range and sendfile paths
+		//	copy data only and leave destPath a new file. Returns kUnsupported, leaving no file
+		//	at destPath, when none of these apply and the caller should copy through buffers
+		//	instead.
+		CopyFileDataResult CopyFileDataInKernel(const HermitPtr& h_,
+												const FilePathPtr& sourcePath,
+												const FilePathPtr& destPath,
+												FileCopyStrategy& outStrategy);
+		
+	} // namespace file
+} // namespace hermit
+
+#endif
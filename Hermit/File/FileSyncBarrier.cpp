@@ -0,0 +1,139 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include "Hermit/Foundation/Notification.h"
+#include "FileSyncBarrier.h"
+
+namespace hermit {
+	namespace file {
+		
+		//	On Darwin, fsync only reaches the drive's cache; F_FULLFSYNC asks the drive to
+		//	flush too, and isn't supported everywhere, hence the fallback.
+		int SyncFileData(int fileDescriptor) {
+#if defined(F_FULLFSYNC)
+			if (::fcntl(fileDescriptor, F_FULLFSYNC) == 0) {
+				return 0;
+			}
+#endif
+#if defined(__linux__)
+			int result = ::fdatasync(fileDescriptor);
+#else
+			int result = ::fsync(fileDescriptor);
+#endif
+			return (result == 0) ? 0 : errno;
+		}
+		
+		//
+		int SyncParentDirectory(const std::string& pathUTF8) {
+			std::string directoryPath(".");
+			size_t slash = pathUTF8.rfind('/');
+			if (slash == 0) {
+				directoryPath = "/";
+			}
+			else if (slash != std::string::npos) {
+				directoryPath = pathUTF8.substr(0, slash);
+			}
+			int fileDescriptor = ::open(directoryPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+			if (fileDescriptor == -1) {
+				return errno;
+			}
+			int err = (::fsync(fileDescriptor) == 0) ? 0 : errno;
+			::close(fileDescriptor);
+			return err;
+		}
+		
+		//
+		FileSyncBarrier::FileSyncBarrier() {
+		}
+		
+		//
+		void FileSyncBarrier::AddFile(const std::string& pathUTF8, dev_t device) {
+			std::lock_guard<std::mutex> lock(mMutex);
+			mPaths.push_back(pathUTF8);
+			mDevices.push_back(device);
+		}
+		
+		//	On Linux, syncfs through any one file flushes its whole file system, so the other
+		//	paths on that device are only needed if the first has since been deleted.
+		bool FileSyncBarrier::Commit(const HermitPtr& h_) {
+			std::vector<std::string> paths;
+			std::vector<dev_t> devices;
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				paths.swap(mPaths);
+				devices.swap(mDevices);
+			}
+			
+			bool success = true;
+			std::vector<dev_t> syncedDevices;
+			for (size_t n = 0; n < paths.size(); ++n) {
+#if defined(__linux__)
+				if (std::find(begin(syncedDevices), end(syncedDevices), devices[n]) != end(syncedDevices)) {
+					continue;
+				}
+#endif
+				int fileDescriptor = ::open(paths[n].c_str(), O_RDONLY | O_CLOEXEC);
+				if (fileDescriptor == -1) {
+					int err = errno;
+					if (err == ENOENT) {
+						//	Deleted since it was written; nothing left to make durable.
+						continue;
+					}
+					NOTIFY_ERROR(h_, "FileSyncBarrier: open failed for:", paths[n], "err:", err);
+					success = false;
+					continue;
+				}
+#if defined(__linux__)
+				int err = (::syncfs(fileDescriptor) == 0) ? 0 : errno;
+#else
+				int err = SyncFileData(fileDescriptor);
+#endif
+				if (err != 0) {
+					NOTIFY_ERROR(h_, "FileSyncBarrier: sync failed for:", paths[n], "err:", err);
+					success = false;
+				}
+				syncedDevices.push_back(devices[n]);
+				::close(fileDescriptor);
+			}
+			
+#if !defined(__linux__)
+			//	syncfs covered the directory entries too; a per-file sync doesn't.
+			std::vector<std::string> syncedDirectories;
+			for (auto it = begin(paths); it != end(paths); ++it) {
+				std::string directoryPath(it->substr(0, it->rfind('/') + 1));
+				if (std::find(begin(syncedDirectories), end(syncedDirectories), directoryPath) != end(syncedDirectories)) {
+					continue;
+				}
+				syncedDirectories.push_back(directoryPath);
+				int err = SyncParentDirectory(*it);
+				if ((err != 0) && (err != ENOENT)) {
+					NOTIFY_ERROR(h_, "FileSyncBarrier: directory sync failed for:", *it, "err:", err);
+					success = false;
+				}
+			}
+#endif
+			return success;
+		}
+		
+	} // namespace file
+} // namespace hermit
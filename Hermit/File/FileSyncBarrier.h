@@ -0,0 +1,69 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef FileSyncBarrier_h
+#define FileSyncBarrier_h
+
+#include <sys/types.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Hermit/Foundation/Hermit.h"
+
+namespace hermit {
+	namespace file {
+		
+		//	Flushes the data (and size) of an open file to stable storage. Returns 0 or an errno.
+		int SyncFileData(int fileDescriptor);
+		
+		//	Flushes the directory holding pathUTF8, so that a newly created file's entry survives
+		//	a crash along with its data. Returns 0 or an errno.
+		int SyncParentDirectory(const std::string& pathUTF8);
+		
+		//	Collects files written with FileDurability::kGroupCommit so they can be made durable
+		//	together: a restore of many small items writes them all, then calls Commit once.
+		//	Files aren't durable until Commit returns true.
+		class FileSyncBarrier {
+		public:
+			//
+			FileSyncBarrier();
+			
+			//	Called by StreamOutFileData once a file's data is written; device is the file's
+			//	st_dev. Safe to call from several threads.
+			void AddFile(const std::string& pathUTF8, dev_t device);
+			
+			//	Syncs every file added since the last Commit. On Linux that's one syncfs per
+			//	file system touched; elsewhere each file is reopened and synced in turn, then
+			//	each directory holding them. Files that have been deleted in the meantime are
+			//	skipped.
+			bool Commit(const HermitPtr& h_);
+			
+		private:
+			//
+			std::mutex mMutex;
+			std::vector<std::string> mPaths;
+			std::vector<dev_t> mDevices;
+		};
+		typedef std::shared_ptr<FileSyncBarrier> FileSyncBarrierPtr;
+		
+	} // namespace file
+} // namespace hermit
+
+#endif
@@ -16,10 +16,14 @@
 //	along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#include <algorithm>
+#include <deque>
+#include <mutex>
 #include <set>
 #include <string>
 #include <vector>
 #include "Hermit/File/AppendToFilePath.h"
+#include "Hermit/File/CopyFileDataInKernel.h"
 #include "Hermit/File/CopySymbolicLink.h"
 #include "Hermit/File/CopyXAttrs.h"
 #include "Hermit/File/CreateDirectory.h"
@@ -56,16 +60,19 @@ namespace hermit {
 	namespace file {
 		namespace FileSystemCopy_Impl {
 			
-			//
+			//	copyXAttrs is false when destPath already carries the source's xattrs, as a clone does.
 			void CopyAttributes(const HermitPtr& h_,
 								const FilePathPtr& sourcePath,
 								const FilePathPtr& destPath,
+								bool copyXAttrs,
 								const FileSystemCopyCompletionPtr& completion) {
 				bool success = true;
-				auto copyXAttrsResult = CopyXAttrs(h_, sourcePath, destPath);
-				if (copyXAttrsResult != CopyXAttrsResult::kSuccess) {
-					NOTIFY_ERROR(h_, "CopyXAttrs failed for source path:", sourcePath, "dest path:", destPath);
-					success = false;
+				if (copyXAttrs) {
+					auto copyXAttrsResult = CopyXAttrs(h_, sourcePath, destPath);
+					if (copyXAttrsResult != CopyXAttrsResult::kSuccess) {
+						NOTIFY_ERROR(h_, "CopyXAttrs failed for source path:", sourcePath, "dest path:", destPath);
+						success = false;
+					}
 				}
 
 				GetFileBSDFlagsCallbackClass bsdFlags;
@@ -125,32 +132,71 @@ namespace hermit {
 				completion->Call(h_, success ? FileSystemCopyResult::kSuccess : FileSystemCopyResult::kError);
 			}
 			
+			//
+			void CopyAttributes(const HermitPtr& h_,
+								const FilePathPtr& sourcePath,
+								const FilePathPtr& destPath,
+								const FileSystemCopyCompletionPtr& completion) {
+				CopyAttributes(h_, sourcePath, destPath, true, completion);
+			}
+			
+			//	A file made by clonefile already has the source's xattrs, ACLs, mode and BSD flags,
+			//	and with UF_IMMUTABLE or a read-only mode among them the attribute pass couldn't
+			//	write to it. So the flags are cleared first, the xattrs are left as cloned, and
+			//	the rest of the pass puts flags, mode, ownership and dates back as usual. A Linux
+			//	FICLONE target is a new file like any other.
+			void CopyAttributesToClone(const HermitPtr& h_,
+									   const FilePathPtr& sourcePath,
+									   const FilePathPtr& destPath,
+									   const FileSystemCopyCompletionPtr& completion) {
+#if defined(__APPLE__)
+				if (!SetFileBSDFlags(h_, destPath, 0)) {
+					NOTIFY_ERROR(h_, "SetFileBSDFlags failed to clear flags on clone:", destPath);
+					completion->Call(h_, FileSystemCopyResult::kError);
+					return;
+				}
+				CopyAttributes(h_, sourcePath, destPath, false, completion);
+#else
+				CopyAttributes(h_, sourcePath, destPath, true, completion);
+#endif
+			}
+			
 			//
 			class CopyDataCompletion : public DataCompletion {
 			public:
 				//
 				CopyDataCompletion(const FilePathPtr& source,
 								   const FilePathPtr& dest,
+								   const FileSystemCopyIntermediateUpdateCallbackPtr& updateCallback,
 								   const FileSystemCopyCompletionPtr& completion) :
 				mSource(source),
 				mDest(dest),
+				mUpdateCallback(updateCallback),
 				mCompletion(completion) {
 				}
 				
 				//
 				virtual void Call(const HermitPtr& h_, const StreamDataResult& result) override {
+					if (result == StreamDataResult::kDiskFull) {
+						mCompletion->Call(h_, FileSystemCopyResult::kDiskFull);
+						return;
+					}
 					if (result != StreamDataResult::kSuccess) {
 						NOTIFY_ERROR(h_, "CopyFileData failed for source path:", mSource, "dest path:", mDest);
 						mCompletion->Call(h_, FileSystemCopyResult::kError);
 						return;
 					}
 					
+					if (mUpdateCallback != nullptr) {
+						mUpdateCallback->OnFileDataCopied(h_, FileCopyStrategy::kBuffered, mSource, mDest);
+					}
 					CopyAttributes(h_, mSource, mDest, mCompletion);
 				}
 				
 				//
 				FilePathPtr mSource;
 				FilePathPtr mDest;
+				FileSystemCopyIntermediateUpdateCallbackPtr mUpdateCallback;
 				FileSystemCopyCompletionPtr mCompletion;
 			};
 
@@ -176,6 +222,7 @@ namespace hermit {
 			void CopyOneFile(const HermitPtr& h_,
 							 const FilePathPtr& sourcePath,
 							 const FilePathPtr& destPath,
+							 const FileSystemCopyIntermediateUpdateCallbackPtr& updateCallback,
 							 const FileSystemCopyCompletionPtr& completion) {
 				PathIsAliasCallbackClass isAliasCallback;
 				PathIsAlias(h_, sourcePath, isAliasCallback);
@@ -211,8 +258,41 @@ namespace hermit {
 					return;
 				}
 				
+				//	Regular files first try a copy that never leaves the kernel (or, for a
+				//	reflink, never moves the data at all).
+				FileType fileType = FileType::kUnknown;
+				if ((GetFileType(h_, sourcePath, fileType) == GetFileTypeStatus::kSuccess) && (fileType == FileType::kFile)) {
+					FileCopyStrategy strategy = FileCopyStrategy::kUnknown;
+					auto result = CopyFileDataInKernel(h_, sourcePath, destPath, strategy);
+					if (result == CopyFileDataResult::kSuccess) {
+						if (updateCallback != nullptr) {
+							updateCallback->OnFileDataCopied(h_, strategy, sourcePath, destPath);
+						}
+						if (strategy == FileCopyStrategy::kClone) {
+							CopyAttributesToClone(h_, sourcePath, destPath, completion);
+						}
+						else {
+							CopyAttributes(h_, sourcePath, destPath, completion);
+						}
+						return;
+					}
+					if (result == CopyFileDataResult::kCanceled) {
+						completion->Call(h_, FileSystemCopyResult::kCanceled);
+						return;
+					}
+					if (result == CopyFileDataResult::kDiskFull) {
+						completion->Call(h_, FileSystemCopyResult::kDiskFull);
+						return;
+					}
+					if (result != CopyFileDataResult::kUnsupported) {
+						NOTIFY_ERROR(h_, "CopyFileDataInKernel failed for source path:", sourcePath, "dest path:", destPath);
+						completion->Call(h_, FileSystemCopyResult::kError);
+						return;
+					}
+				}
+				
 				auto dataProvider = std::make_shared<FileDataProvider>(sourcePath);
-				auto dataCompletion = std::make_shared<CopyDataCompletion>(sourcePath, destPath, completion);
+				auto dataCompletion = std::make_shared<CopyDataCompletion>(sourcePath, destPath, updateCallback, completion);
 				StreamOutFileData(h_, destPath, dataProvider, dataCompletion);
 			}
 			
@@ -662,7 +742,7 @@ namespace hermit {
 					}
 					
 					auto completion = std::make_shared<Completion>(shared_from_this(), fileInfo->mPath, destFilePath);
-					CopyOneFile(h_, fileInfo->mPath, destFilePath, completion);
+					CopyOneFile(h_, fileInfo->mPath, destFilePath, mUpdateCallback, completion);
 				}
 				
 				//
@@ -714,6 +794,432 @@ namespace hermit {
 																	  completion);
 				copyFiles->ProcessNextItem(h_);
 			}
+			
+			//	Buffer memory charged against FileSystemCopyOptions::mMaxBytesInFlight for one
+			//	streamed copy: ReadFileData's read-ahead pair plus StreamOutFileData's write-behind
+			//	pair. Smaller files are charged their size.
+			const uint64_t kFileCopyBufferCost = 4 * kDefaultReadFileDataBufferSize;
+			
+			//	How many listed but unstarted files the walk may get ahead by before it waits for
+			//	the copies to catch up.
+			const size_t kMaxPendingFiles = 4096;
+			
+			//
+			struct DirectoryNode;
+			typedef std::shared_ptr<DirectoryNode> DirectoryNodePtr;
+			
+			//
+			struct DirectoryNode {
+				//
+				DirectoryNode(const FilePathPtr& sourcePath, const FilePathPtr& destPath, const DirectoryNodePtr& parent) :
+				mSourcePath(sourcePath),
+				mDestPath(destPath),
+				mParent(parent),
+				mPendingItems(1) {
+				}
+				
+				//
+				FilePathPtr mSourcePath;
+				FilePathPtr mDestPath;
+				DirectoryNodePtr mParent;
+				
+				//	Files and subdirectories not yet finished, plus one held by the walk until the
+				//	directory has been listed. Guarded by ParallelCopy::mMutex.
+				uint64_t mPendingItems;
+			};
+			
+			//
+			struct FileJob {
+				//
+				FileJob(const FilePathPtr& sourcePath, const FilePathPtr& destPath, const DirectoryNodePtr& parent, uint64_t cost) :
+				mSourcePath(sourcePath),
+				mDestPath(destPath),
+				mParent(parent),
+				mCost(cost) {
+				}
+				
+				//
+				FilePathPtr mSourcePath;
+				FilePathPtr mDestPath;
+				DirectoryNodePtr mParent;
+				uint64_t mCost;
+			};
+			typedef std::shared_ptr<FileJob> FileJobPtr;
+			
+			//
+			class CapturingCompletion : public FileSystemCopyCompletion {
+			public:
+				//
+				CapturingCompletion() : mResult(FileSystemCopyResult::kUnknown) {
+				}
+				
+				//
+				virtual void Call(const HermitPtr& h_, const FileSystemCopyResult& result) override {
+					mResult = result;
+				}
+				
+				//
+				FileSystemCopyResult mResult;
+			};
+			typedef std::shared_ptr<CapturingCompletion> CapturingCompletionPtr;
+			
+			//
+			class ParallelCopy;
+			typedef std::shared_ptr<ParallelCopy> ParallelCopyPtr;
+			
+			//	Copies a directory tree with one walk creating directories in order and queueing
+			//	their files, which are copied by up to mQueueDepth pool tasks at a time. It is
+			//	also the update callback handed to those copies, so that the caller's callback
+			//	only ever sees one thread at a time.
+			class ParallelCopy : public FileSystemCopyIntermediateUpdateCallback, public std::enable_shared_from_this<ParallelCopy> {
+			public:
+				//
+				ParallelCopy(const FileSystemCopyOptions& options,
+							 const FileSystemCopyIntermediateUpdateCallbackPtr& updateCallback,
+							 const FileSystemCopyCompletionPtr& completion) :
+				mQueueDepth(std::max(options.mQueueDepth, (uint32_t)1)),
+				mMaxBytesInFlight(options.mMaxBytesInFlight),
+				mUpdateCallback(updateCallback),
+				mCompletion(completion),
+				mFilesInFlight(0),
+				mBytesInFlight(0),
+				mWalking(false),
+				mStopResult(FileSystemCopyResult::kUnknown),
+				mFinished(false) {
+				}
+				
+				//
+				class WalkTask : public AsyncTask {
+				public:
+					//
+					WalkTask(const ParallelCopyPtr& owner) : mOwner(owner) {
+					}
+					
+					//
+					virtual void PerformTask(const HermitPtr& h_) override {
+						mOwner->Walk(h_);
+					}
+					
+					//
+					ParallelCopyPtr mOwner;
+				};
+				
+				//
+				class FileTask : public AsyncTask {
+				public:
+					//
+					FileTask(const ParallelCopyPtr& owner, const FileJobPtr& job) : mOwner(owner), mJob(job) {
+					}
+					
+					//
+					virtual void PerformTask(const HermitPtr& h_) override {
+						mOwner->CopyFile(h_, mJob);
+					}
+					
+					//
+					ParallelCopyPtr mOwner;
+					FileJobPtr mJob;
+				};
+				
+				//
+				class FileCompletion : public FileSystemCopyCompletion {
+				public:
+					//
+					FileCompletion(const ParallelCopyPtr& owner, const FileJobPtr& job) : mOwner(owner), mJob(job) {
+					}
+					
+					//
+					virtual void Call(const HermitPtr& h_, const FileSystemCopyResult& result) override {
+						mOwner->OnFileDone(h_, mJob, result);
+					}
+					
+					//
+					ParallelCopyPtr mOwner;
+					FileJobPtr mJob;
+				};
+				
+				//
+				virtual bool OnUpdate(const HermitPtr& h_,
+									  const FileSystemCopyResult& result,
+									  const FilePathPtr& source,
+									  const FilePathPtr& dest) override {
+					std::lock_guard<std::mutex> lock(mCallbackMutex);
+					return mUpdateCallback->OnUpdate(h_, result, source, dest);
+				}
+				
+				//
+				virtual void OnFileDataCopied(const HermitPtr& h_,
+											  const FileCopyStrategy& strategy,
+											  const FilePathPtr& source,
+											  const FilePathPtr& dest) override {
+					std::lock_guard<std::mutex> lock(mCallbackMutex);
+					mUpdateCallback->OnFileDataCopied(h_, strategy, source, dest);
+				}
+				
+				//
+				void Start(const HermitPtr& h_, const FilePathPtr& sourcePath, const FilePathPtr& destPath) {
+					{
+						std::lock_guard<std::mutex> lock(mMutex);
+						mDirectories.push_back(std::make_shared<DirectoryNode>(sourcePath, destPath, nullptr));
+						mWalking = true;
+					}
+					Walk(h_);
+				}
+				
+				//
+				void Walk(const HermitPtr& h_) {
+					while (true) {
+						bool aborted = CHECK_FOR_ABORT(h_);
+						DirectoryNodePtr node;
+						{
+							std::lock_guard<std::mutex> lock(mMutex);
+							if (aborted && (mStopResult == FileSystemCopyResult::kUnknown)) {
+								mStopResult = FileSystemCopyResult::kCanceled;
+							}
+							if ((mStopResult != FileSystemCopyResult::kUnknown) ||
+								mDirectories.empty() ||
+								(mPendingFiles.size() >= kMaxPendingFiles)) {
+								mWalking = false;
+								break;
+							}
+							node = mDirectories.back();
+							mDirectories.pop_back();
+						}
+						WalkDirectory(h_, node);
+						Dispatch(h_);
+					}
+					FinishIfStopped(h_);
+				}
+				
+				//
+				void WalkDirectory(const HermitPtr& h_, const DirectoryNodePtr& node) {
+					auto createResult = CreateDirectory(h_, node->mDestPath);
+					if (createResult != CreateDirectoryResult::kSuccess) {
+						NOTIFY_ERROR(h_, "CreateDirectory failed for:", node->mDestPath);
+						OnDirectoryDone(h_, node, FileSystemCopyResult::kError);
+						return;
+					}
+					
+					Directory directory;
+					auto listResult = ListDirectoryContentsWithType(h_, node->mSourcePath, false, directory);
+					if (listResult != ListDirectoryContentsResult::kSuccess) {
+						NOTIFY_ERROR(h_, "ListDirectoryContentsWithType failed for:", node->mSourcePath);
+						OnDirectoryDone(h_, node, FileSystemCopyResult::kError);
+						return;
+					}
+					
+					std::vector<FileJobPtr> files;
+					for (auto it = begin(directory.mFiles); it != end(directory.mFiles); ++it) {
+						FilePathPtr destFilePath;
+						AppendToFilePath(h_, node->mDestPath, (*it)->mName, destFilePath);
+						if (destFilePath == nullptr) {
+							NOTIFY_ERROR(h_, "ParallelCopy: AppendToFilePath failed, path:", node->mDestPath, "item name:", (*it)->mName);
+							continue;
+						}
+						uint64_t dataSize = 0;
+						if (!GetFileDataSize(h_, (*it)->mPath, dataSize)) {
+							dataSize = kFileCopyBufferCost;
+						}
+						files.push_back(std::make_shared<FileJob>((*it)->mPath, destFilePath, node, std::min(dataSize, kFileCopyBufferCost)));
+					}
+					
+					std::vector<DirectoryNodePtr> directories;
+					for (auto it = begin(directory.mDirectories); it != end(directory.mDirectories); ++it) {
+						FilePathPtr destDirectoryPath;
+						AppendToFilePath(h_, node->mDestPath, (*it)->mName, destDirectoryPath);
+						if (destDirectoryPath == nullptr) {
+							NOTIFY_ERROR(h_, "ParallelCopy: AppendToFilePath failed, path:", node->mDestPath, "item name:", (*it)->mName);
+							continue;
+						}
+						directories.push_back(std::make_shared<DirectoryNode>((*it)->mPath, destDirectoryPath, node));
+					}
+					
+					{
+						std::lock_guard<std::mutex> lock(mMutex);
+						node->mPendingItems += files.size() + directories.size();
+						mPendingFiles.insert(end(mPendingFiles), begin(files), end(files));
+						// pushed last to first so the walk visits them in name order
+						mDirectories.insert(end(mDirectories), directories.rbegin(), directories.rend());
+					}
+					Dispatch(h_);
+					
+					// links are cheap, so the walk copies them itself
+					for (auto it = begin(directory.mSymbolicLinks); it != end(directory.mSymbolicLinks); ++it) {
+						FilePathPtr destLinkPath;
+						AppendToFilePath(h_, node->mDestPath, (*it)->mName, destLinkPath);
+						if (destLinkPath == nullptr) {
+							NOTIFY_ERROR(h_, "ParallelCopy: AppendToFilePath failed, path:", node->mDestPath, "item name:", (*it)->mName);
+							continue;
+						}
+						auto completion = std::make_shared<CapturingCompletion>();
+						CopyOneSymbolicLink(h_, (*it)->mPath, destLinkPath, completion);
+						Report(h_, completion->mResult, (*it)->mPath, destLinkPath);
+					}
+					
+					OnItemDone(h_, node);
+				}
+				
+				//
+				void Dispatch(const HermitPtr& h_) {
+					std::vector<FileJobPtr> ready;
+					{
+						std::lock_guard<std::mutex> lock(mMutex);
+						while ((mStopResult == FileSystemCopyResult::kUnknown) &&
+							   !mPendingFiles.empty() &&
+							   (mFilesInFlight < mQueueDepth)) {
+							auto job = mPendingFiles.front();
+							if ((mMaxBytesInFlight != 0) &&
+								(mFilesInFlight > 0) &&
+								((mBytesInFlight + job->mCost) > mMaxBytesInFlight)) {
+								break;
+							}
+							mPendingFiles.pop_front();
+							++mFilesInFlight;
+							mBytesInFlight += job->mCost;
+							ready.push_back(job);
+						}
+					}
+					for (auto it = begin(ready); it != end(ready); ++it) {
+						auto task = std::make_shared<FileTask>(shared_from_this(), *it);
+						if (!QueueAsyncTask(h_, task, 10)) {
+							NOTIFY_ERROR(h_, "ParallelCopy: QueueAsyncTask failed.");
+							OnFileDone(h_, *it, FileSystemCopyResult::kError);
+						}
+					}
+				}
+				
+				//
+				void CopyFile(const HermitPtr& h_, const FileJobPtr& job) {
+					auto completion = std::make_shared<FileCompletion>(shared_from_this(), job);
+					CopyOneFile(h_, job->mSourcePath, job->mDestPath, shared_from_this(), completion);
+				}
+				
+				//
+				void OnFileDone(const HermitPtr& h_, const FileJobPtr& job, const FileSystemCopyResult& result) {
+					{
+						std::lock_guard<std::mutex> lock(mMutex);
+						--mFilesInFlight;
+						mBytesInFlight -= job->mCost;
+					}
+					Report(h_, result, job->mSourcePath, job->mDestPath);
+					OnItemDone(h_, job->mParent);
+					Dispatch(h_);
+					ResumeWalk(h_);
+					FinishIfStopped(h_);
+				}
+				
+				//
+				void OnItemDone(const HermitPtr& h_, const DirectoryNodePtr& node) {
+					{
+						std::lock_guard<std::mutex> lock(mMutex);
+						if ((--node->mPendingItems > 0) || (mStopResult != FileSystemCopyResult::kUnknown)) {
+							return;
+						}
+					}
+					
+					// everything inside is done, so setting the dates now makes them stick
+					auto completion = std::make_shared<CapturingCompletion>();
+					CopyAttributes(h_, node->mSourcePath, node->mDestPath, completion);
+					OnDirectoryDone(h_, node, completion->mResult);
+				}
+				
+				//
+				void OnDirectoryDone(const HermitPtr& h_, const DirectoryNodePtr& node, const FileSystemCopyResult& result) {
+					if (node->mParent == nullptr) {
+						Finish(h_, result);
+						return;
+					}
+					Report(h_, result, node->mSourcePath, node->mDestPath);
+					OnItemDone(h_, node->mParent);
+				}
+				
+				//
+				void Report(const HermitPtr& h_,
+							const FileSystemCopyResult& result,
+							const FilePathPtr& sourcePath,
+							const FilePathPtr& destPath) {
+					{
+						std::lock_guard<std::mutex> lock(mMutex);
+						if (mStopResult != FileSystemCopyResult::kUnknown) {
+							return;
+						}
+					}
+					if (!OnUpdate(h_, result, sourcePath, destPath)) {
+						std::lock_guard<std::mutex> lock(mMutex);
+						if (mStopResult == FileSystemCopyResult::kUnknown) {
+							mStopResult = FileSystemCopyResult::kStoppedViaUpdateCallback;
+						}
+					}
+				}
+				
+				//
+				void ResumeWalk(const HermitPtr& h_) {
+					{
+						std::lock_guard<std::mutex> lock(mMutex);
+						if (mWalking ||
+							(mStopResult != FileSystemCopyResult::kUnknown) ||
+							mDirectories.empty() ||
+							(mPendingFiles.size() >= (kMaxPendingFiles / 2))) {
+							return;
+						}
+						mWalking = true;
+					}
+					auto task = std::make_shared<WalkTask>(shared_from_this());
+					if (!QueueAsyncTask(h_, task, 10)) {
+						NOTIFY_ERROR(h_, "ParallelCopy: QueueAsyncTask failed.");
+						std::lock_guard<std::mutex> lock(mMutex);
+						mWalking = false;
+						if (mStopResult == FileSystemCopyResult::kUnknown) {
+							mStopResult = FileSystemCopyResult::kError;
+						}
+					}
+				}
+				
+				//	Once stopped, the copy is finished when the last copy in flight and the walk
+				//	have both wound down.
+				void FinishIfStopped(const HermitPtr& h_) {
+					FileSystemCopyResult result = FileSystemCopyResult::kUnknown;
+					{
+						std::lock_guard<std::mutex> lock(mMutex);
+						if (mFinished ||
+							(mStopResult == FileSystemCopyResult::kUnknown) ||
+							(mFilesInFlight > 0) ||
+							mWalking) {
+							return;
+						}
+						mFinished = true;
+						result = mStopResult;
+					}
+					mCompletion->Call(h_, result);
+				}
+				
+				//
+				void Finish(const HermitPtr& h_, const FileSystemCopyResult& result) {
+					{
+						std::lock_guard<std::mutex> lock(mMutex);
+						if (mFinished) {
+							return;
+						}
+						mFinished = true;
+					}
+					mCompletion->Call(h_, result);
+				}
+				
+				//
+				const uint32_t mQueueDepth;
+				const uint64_t mMaxBytesInFlight;
+				FileSystemCopyIntermediateUpdateCallbackPtr mUpdateCallback;
+				FileSystemCopyCompletionPtr mCompletion;
+				std::mutex mCallbackMutex;
+				std::mutex mMutex;
+				std::vector<DirectoryNodePtr> mDirectories;
+				std::deque<FileJobPtr> mPendingFiles;
+				uint32_t mFilesInFlight;
+				uint64_t mBytesInFlight;
+				bool mWalking;
+				FileSystemCopyResult mStopResult;
+				bool mFinished;
+			};
 						
 		} // namespace FileSystemCopy_Impl
 		using namespace FileSystemCopy_Impl;
@@ -724,6 +1230,16 @@ namespace hermit {
 							const FilePathPtr& destPath,
 							const FileSystemCopyIntermediateUpdateCallbackPtr& updateCallback,
 							const FileSystemCopyCompletionPtr& completion) {
+			FileSystemCopy(h_, sourcePath, destPath, FileSystemCopyOptions(), updateCallback, completion);
+		}
+		
+		//
+		void FileSystemCopy(const HermitPtr& h_,
+							const FilePathPtr& sourcePath,
+							const FilePathPtr& destPath,
+							const FileSystemCopyOptions& options,
+							const FileSystemCopyIntermediateUpdateCallbackPtr& updateCallback,
+							const FileSystemCopyCompletionPtr& completion) {
 			bool sourceFileExists = false;
 			if (!FileExists(h_, sourcePath, sourceFileExists)) {
 				NOTIFY_ERROR(h_, "FileExists failed for source path:", sourcePath);
@@ -755,6 +1271,11 @@ namespace hermit {
 				return;
 			}
 			if (fileType == FileType::kDirectory) {
+				if (options.mQueueDepth > 1) {
+					auto copy = std::make_shared<ParallelCopy>(options, updateCallback, completion);
+					copy->Start(h_, sourcePath, destPath);
+					return;
+				}
 				CopyOneDirectory(h_, sourcePath, destPath, updateCallback, completion);
 				return;
 			}
@@ -763,7 +1284,7 @@ namespace hermit {
 				return;
 			}
 			if ((fileType == FileType::kFile) || (fileType == FileType::kDevice)) {
-				CopyOneFile(h_, sourcePath, destPath, completion);
+				CopyOneFile(h_, sourcePath, destPath, updateCallback, completion);
 				return;
 			}
 			NOTIFY_ERROR(h_, "GetFileType returned unexpected file type for path:", sourcePath);
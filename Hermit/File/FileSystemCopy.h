@@ -19,8 +19,10 @@
 #ifndef FileSystemCopy_h
 #define FileSystemCopy_h
 
+#include <cstdint>
 #include <memory>
 #include "Hermit/Foundation/AsyncFunction.h"
+#include "CopyFileDataInKernel.h"
 #include "FilePath.h"
 
 namespace hermit {
@@ -34,6 +36,7 @@ namespace hermit {
 			kStoppedViaUpdateCallback,
 			kSourceNotFound,
 			kTargetAlreadyExists,
+			kDiskFull,
 			kError
 		};
 
@@ -45,6 +48,13 @@ namespace hermit {
 			
 			//
 			virtual bool OnUpdate(const HermitPtr& h_, const FileSystemCopyResult& result, const FilePathPtr& source, const FilePathPtr& dest) = 0;
+			
+			//	Called once a file's data has been copied, before its attributes, saying how.
+			virtual void OnFileDataCopied(const HermitPtr& h_,
+										  const FileCopyStrategy& strategy,
+										  const FilePathPtr& source,
+										  const FilePathPtr& dest) {
+			}
 		};
 		typedef std::shared_ptr<FileSystemCopyIntermediateUpdateCallback> FileSystemCopyIntermediateUpdateCallbackPtr;
 		
@@ -53,10 +63,43 @@ namespace hermit {
 								 HermitPtr,
 								 FileSystemCopyResult);
 		
+		//	Default cap on the buffer memory held by file copies running at once.
+		const uint64_t kDefaultFileSystemCopyMaxBytesInFlight = 256 * 1024 * 1024;
+		
+		//
+		struct FileSystemCopyOptions {
+			//
+			FileSystemCopyOptions() :
+			mQueueDepth(1),
+			mMaxBytesInFlight(kDefaultFileSystemCopyMaxBytesInFlight) {
+			}
+			
+			//	How many file copies may run at once when copying a directory tree. With 1,
+			//	items are copied one at a time, in order. With more, directories are still
+			//	created parent-first by a single walk, but the files beneath them are copied by
+			//	the thread pool. Each directory's attributes are applied after everything inside
+			//	it is done, and OnUpdate is called for each item as it finishes, never from two
+			//	threads at once.
+			uint32_t mQueueDepth;
+			
+			//	Limit on the read and write buffers held by the copies in flight, each charged
+			//	the smaller of its file size and the buffers a streamed copy uses. A copy larger
+			//	than the limit still runs, alone. 0 means no limit.
+			uint64_t mMaxBytesInFlight;
+		};
+		
+		//
+		void FileSystemCopy(const HermitPtr& h_,
+							const FilePathPtr& sourcePath,
+							const FilePathPtr& destPath,
+							const FileSystemCopyIntermediateUpdateCallbackPtr& updateCallback,
+							const FileSystemCopyCompletionPtr& completion);
+		
 		//
 		void FileSystemCopy(const HermitPtr& h_,
 							const FilePathPtr& sourcePath,
 							const FilePathPtr& destPath,
+							const FileSystemCopyOptions& options,
 							const FileSystemCopyIntermediateUpdateCallbackPtr& updateCallback,
 							const FileSystemCopyCompletionPtr& completion);
 		
@@ -0,0 +1,78 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef ListDirectoryContentsWithInfo_h
+#define ListDirectoryContentsWithInfo_h
+
+#include <cstdint>
+#include <string>
+#include "Hermit/Foundation/Hermit.h"
+#include "FilePath.h"
+#include "FileType.h"
+#include "ListDirectoryContents.h"
+
+namespace hermit {
+	namespace file {
+		
+		//	What a single lstat says about an item, in the forms the rest of the file layer uses:
+		//	dates as GetFileDates formats them, permissions as GetFilePosixPermissions returns them.
+		struct DirectoryItemInfo {
+			//
+			DirectoryItemInfo() :
+			mType(FileType::kUnknown),
+			mDataSize(0),
+			mPermissions(0),
+			mUserID(0),
+			mGroupID(0) {
+			}
+			
+			//
+			FileType mType;
+			uint64_t mDataSize;
+			std::string mCreationDate;
+			std::string mModificationDate;
+			uint32_t mPermissions;
+			uint32_t mUserID;
+			uint32_t mGroupID;
+		};
+		
+		//
+		class ListDirectoryContentsWithInfoItemCallback {
+		public:
+			//
+			virtual bool OnItem(const HermitPtr& h_,
+								const ListDirectoryContentsResult& result,
+								const FilePathPtr& parentPath,
+								const std::string& itemName,
+								const DirectoryItemInfo& itemInfo) = 0;
+		};
+		
+		//	Lists the immediate contents of a directory, with the type, size, dates, permissions
+		//	and ownership of each item taken from the one lstat made while listing it.
+		ListDirectoryContentsResult ListDirectoryContentsWithInfo(const HermitPtr& h_,
+																  const FilePathPtr& directoryPath,
+																  ListDirectoryContentsWithInfoItemCallback& itemCallback);
+		
+		//	The same information for a single item.
+		bool GetDirectoryItemInfo(const HermitPtr& h_, const FilePathPtr& itemPath, DirectoryItemInfo& outInfo);
+		
+	} // namespace file
+} // namespace hermit
+
+#endif
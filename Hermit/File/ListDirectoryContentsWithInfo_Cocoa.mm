@@ -0,0 +1,155 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#import <Cocoa/Cocoa.h>
+#import <sys/stat.h>
+#import <string>
+#import "Hermit/Foundation/Notification.h"
+#import "Hermit/String/AddTrailingSlash.h"
+#import "FilePathToCocoaPathString.h"
+#import "ListDirectoryContentsWithInfo.h"
+
+namespace hermit {
+	namespace file {
+		namespace ListDirectoryContentsWithInfo_Cocoa_Impl {
+			
+			//
+			bool FormatDate(const struct timespec& date, std::string& outDate) {
+				struct tm t;
+				gmtime_r(&date.tv_sec, &t);
+				
+				char dateString[256];
+				size_t used = strftime(dateString, 256, "%Y-%m-%d %H:%M:%S UTC", &t);
+				if (used == 0) {
+					return false;
+				}
+				outDate.assign(dateString, used);
+				return true;
+			}
+			
+			//
+			bool GetInfo(const HermitPtr& h_, const std::string& pathUTF8, DirectoryItemInfo& outInfo) {
+				struct stat s;
+				int err = lstat(pathUTF8.c_str(), &s);
+				if (err != 0) {
+					NOTIFY_ERROR(h_, "lstat failed for path:", pathUTF8, "errno:", errno);
+					return false;
+				}
+				
+				DirectoryItemInfo info;
+				if (S_ISREG(s.st_mode)) {
+					info.mType = FileType::kFile;
+				}
+				else if (S_ISDIR(s.st_mode)) {
+					info.mType = FileType::kDirectory;
+				}
+				else if (S_ISLNK(s.st_mode)) {
+					info.mType = FileType::kSymbolicLink;
+				}
+				else if (S_ISBLK(s.st_mode) || S_ISCHR(s.st_mode) || S_ISFIFO(s.st_mode) || S_ISSOCK(s.st_mode)) {
+					info.mType = FileType::kDevice;
+				}
+				else {
+					NOTIFY_ERROR(h_, "Unrecognized item type:", pathUTF8);
+					return false;
+				}
+				
+				if (!FormatDate(s.st_birthtimespec, info.mCreationDate) ||
+					!FormatDate(s.st_mtimespec, info.mModificationDate)) {
+					NOTIFY_ERROR(h_, "strftime failed for path:", pathUTF8);
+					return false;
+				}
+				info.mDataSize = (uint64_t)s.st_size;
+				info.mPermissions = (uint32_t)(s.st_mode & ALLPERMS);
+				info.mUserID = (uint32_t)s.st_uid;
+				info.mGroupID = (uint32_t)s.st_gid;
+				outInfo = info;
+				return true;
+			}
+			
+		} // namespace ListDirectoryContentsWithInfo_Cocoa_Impl
+		using namespace ListDirectoryContentsWithInfo_Cocoa_Impl;
+		
+		//
+		ListDirectoryContentsResult ListDirectoryContentsWithInfo(const HermitPtr& h_,
+																  const FilePathPtr& directoryPath,
+																  ListDirectoryContentsWithInfoItemCallback& itemCallback) {
+			@autoreleasepool {
+				if (CHECK_FOR_ABORT(h_)) {
+					return ListDirectoryContentsResult::kCanceled;
+				}
+				
+				std::string pathUTF8;
+				FilePathToCocoaPathString(h_, directoryPath, pathUTF8);
+				string::AddTrailingSlash(pathUTF8, pathUTF8);
+				NSString* pathString = [NSString stringWithUTF8String:pathUTF8.c_str()];
+				
+				NSError* error = nil;
+				NSArray* items = [[NSFileManager defaultManager] contentsOfDirectoryAtPath:pathString error:&error];
+				if (error != nil) {
+					auto result = ListDirectoryContentsResult::kError;
+					if (error.code == NSFileReadNoSuchFileError) {
+						result = ListDirectoryContentsResult::kDirectoryNotFound;
+					} else if (error.code == NSFileReadNoPermissionError) {
+						result = ListDirectoryContentsResult::kPermissionDenied;
+					}
+					else {
+						NOTIFY_ERROR(h_,
+									 "ListDirectoryContentsWithInfo: contentsOfDirectoryAtPath failed for path:", directoryPath,
+									 "error:", [[error localizedDescription] UTF8String]);
+					}
+					return result;
+				}
+				
+				NSInteger numItems = [items count];
+				for (NSInteger n = 0; n < numItems; ++n) {
+					NSString* fileName = [items objectAtIndex:n];
+					std::string fileNameUTF8([fileName cStringUsingEncoding:NSUTF8StringEncoding]);
+					std::string itemPathUTF8(pathUTF8);
+					itemPathUTF8 += fileNameUTF8;
+					
+					for (std::string::size_type n = 0; n < fileNameUTF8.size(); ++n) {
+						if (fileNameUTF8[n] == ':') {
+							fileNameUTF8[n] = '/';
+						}
+					}
+					
+					DirectoryItemInfo info;
+					auto result = ListDirectoryContentsResult::kSuccess;
+					if (!GetInfo(h_, itemPathUTF8, info)) {
+						NOTIFY_ERROR(h_, "ListDirectoryContentsWithInfo: GetInfo failed for item:", fileNameUTF8, "in:", directoryPath);
+						result = ListDirectoryContentsResult::kError;
+					}
+					if (!itemCallback.OnItem(h_, result, directoryPath, fileNameUTF8, info)) {
+						return result;
+					}
+				}
+				return ListDirectoryContentsResult::kSuccess;
+			}
+		}
+		
+		//
+		bool GetDirectoryItemInfo(const HermitPtr& h_, const FilePathPtr& itemPath, DirectoryItemInfo& outInfo) {
+			std::string pathUTF8;
+			FilePathToCocoaPathString(h_, itemPath, pathUTF8);
+			return GetInfo(h_, pathUTF8, outInfo);
+		}
+		
+	} // namespace file
+} // namespace hermit
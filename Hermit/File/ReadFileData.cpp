@@ -16,155 +16,370 @@
 //	along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 #include <errno.h>
-#include <stdlib.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
+#include "Hermit/Foundation/AsyncTaskQueue.h"
 #include "Hermit/Foundation/Notification.h"
 #include "FilePathToCocoaPathString.h"
 #include "ReadFileData.h"
 
 namespace hermit {
 	namespace file {
-		
-		//
-		class DataLoader : public std::enable_shared_from_this<DataLoader> {
-			//
-			typedef std::shared_ptr<DataLoader> DataLoaderPtr;
-
-		public:
+		namespace ReadFileData_Impl {
+			
+			//	Buffers rotated between the read-ahead tasks and the receiver: one being
+			//	consumed while the other is filled.
+			const size_t kReadAheadBufferCount = 2;
+			
+			//	Largest file kMapped will map; beyond this (or on 32-bit builds, well before it)
+			//	address space is better spent elsewhere and streaming is as fast.
+			const uint64_t kMaxMappedFileSize = (sizeof(size_t) < 8) ? (256ULL * 1024 * 1024) : (64ULL * 1024 * 1024 * 1024);
+			
 			//
-			DataLoader(const std::string& filePathUTF8,
-					   const DataReceiverPtr& dataReceiver,
-					   const DataCompletionPtr& completion) :
-			mFilePathUTF8(filePathUTF8),
-			mDataReceiver(dataReceiver),
-			mCompletion(completion),
-			mFileHandle(nullptr),
-			mBuf(nullptr),
-			mBufSize(0),
-			mStreamResult(StreamDataResult::kSuccess),
-			mDone(false) {
-				pthread_mutex_init(&mMutex, nullptr);
-				pthread_cond_init(&mCondition, nullptr);
-			}
+			enum class FillState {
+				kQueued,
+				kFilling,
+				kFilled
+			};
 			
 			//
-			~DataLoader() {
-				if (mBuf != nullptr) {
-					::free(mBuf);
-				}
-				if (mFileHandle != nullptr) {
-					::fclose(mFileHandle);
+			struct ReadBuffer {
+				//
+				ReadBuffer(size_t capacity) :
+				mData(new char[capacity]),
+				mSize(0),
+				mIsEnd(false),
+				mError(0),
+				mOffset(0),
+				mState(FillState::kFilled) {
 				}
-			}
+				
+				//
+				std::unique_ptr<char[]> mData;
+				size_t mSize;
+				bool mIsEnd;
+				int mError;
+				uint64_t mOffset;
+				FillState mState;
+			};
 			
 			//
-			void ReadData(const HermitPtr& h_) {
-				mFileHandle = ::fopen(mFilePathUTF8.c_str(), "rb");
-				if (mFileHandle == nullptr) {
-					int err = errno;
-					if (err == ENOENT) {
-						mCompletion->Call(h_, StreamDataResult::kFileNotFound);
+			class DataLoader : public std::enable_shared_from_this<DataLoader> {
+				//
+				typedef std::shared_ptr<DataLoader> DataLoaderPtr;
+				
+			public:
+				//
+				DataLoader(const DataReceiverPtr& dataReceiver, const DataCompletionPtr& completion) :
+				mDataReceiver(dataReceiver),
+				mCompletion(completion),
+				mFileDescriptor(-1),
+				mMappedData(nullptr),
+				mMappedSize(0),
+				mChunkSize(0),
+				mReceiveResult(StreamDataResult::kSuccess) {
+				}
+				
+				//
+				~DataLoader() {
+					if (mMappedData != nullptr) {
+						::munmap(mMappedData, mMappedSize);
+					}
+					if (mFileDescriptor != -1) {
+						::close(mFileDescriptor);
+					}
+				}
+				
+				//
+				void ReadData(const HermitPtr& h_,
+							  const std::string& filePathUTF8,
+							  const size_t& bufferSize,
+							  const ReadFileDataMode& mode) {
+					mFileDescriptor = ::open(filePathUTF8.c_str(), O_RDONLY | O_CLOEXEC);
+					if (mFileDescriptor == -1) {
+						int err = errno;
+						if (err == ENOENT) {
+							mCompletion->Call(h_, StreamDataResult::kFileNotFound);
+							return;
+						}
+						NOTIFY_ERROR(h_, "ReadFileData: open failed, err:", err);
+						mCompletion->Call(h_, StreamDataResult::kError);
+						return;
+					}
+					struct stat s;
+					if (::fstat(mFileDescriptor, &s) != 0) {
+						int err = errno;
+						NOTIFY_ERROR(h_, "ReadFileData: fstat failed, err:", err);
+						mCompletion->Call(h_, StreamDataResult::kError);
 						return;
 					}
-					NOTIFY_ERROR(h_, "ReadFileData: fopen failed, err:", err);
-					mCompletion->Call(h_, StreamDataResult::kError);
-					return;
+					uint64_t fileSize = (s.st_size > 0) ? (uint64_t)s.st_size : 0;
+					size_t chunkSize = (bufferSize > 0) ? bufferSize : kDefaultReadFileDataBufferSize;
+					
+					if ((mode == ReadFileDataMode::kMapped) && (fileSize > 0) && (fileSize <= kMaxMappedFileSize)) {
+						void* mappedData = ::mmap(nullptr, (size_t)fileSize, PROT_READ, MAP_PRIVATE, mFileDescriptor, 0);
+						if (mappedData != MAP_FAILED) {
+							mMappedData = mappedData;
+							mMappedSize = (size_t)fileSize;
+							::posix_madvise(mMappedData, mMappedSize, POSIX_MADV_SEQUENTIAL);
+							mCompletion->Call(h_, DeliverMappedData(h_, chunkSize));
+							return;
+						}
+					}
+					
+#if defined(POSIX_FADV_SEQUENTIAL)
+					::posix_fadvise(mFileDescriptor, 0, 0, POSIX_FADV_SEQUENTIAL);
+#elif defined(F_RDAHEAD)
+					::fcntl(mFileDescriptor, F_RDAHEAD, 1);
+#endif
+					
+					//	A read that comes up short marks the end of the file, so a buffer one byte
+					//	larger than the file finds the end in a single read.
+					if (fileSize < chunkSize) {
+						mChunkSize = (size_t)fileSize + 1;
+						mCompletion->Call(h_, DeliverSingleBuffer(h_, chunkSize));
+						return;
+					}
+					mChunkSize = chunkSize;
+					mCompletion->Call(h_, DeliverWithReadAhead(h_));
 				}
+				
+			private:
+				//
+				class FillTask : public AsyncTask {
+				public:
+					//
+					FillTask(const DataLoaderPtr& loader, ReadBuffer* buffer) : mLoader(loader), mBuffer(buffer) {
+					}
 					
-				const int kBufferSize = 16 * 1024 * 1024;
-				mBuf = (char*)malloc(kBufferSize);
-				if (mBuf == nullptr) {
-					NOTIFY_ERROR(h_, "ReadFileData: malloc failed.");
-					mCompletion->Call(h_, StreamDataResult::kError);
-					return;
+					//
+					virtual void PerformTask(const HermitPtr& h_) override {
+						mLoader->RunFill(mBuffer);
+					}
+					
+					//
+					DataLoaderPtr mLoader;
+					ReadBuffer* mBuffer;
+				};
+				
+				//
+				class ReceiveCompletion : public DataCompletion {
+				public:
+					//
+					ReceiveCompletion(const DataLoaderPtr& loader) : mLoader(loader) {
+					}
+					
+					//
+					virtual void Call(const HermitPtr& h_, const StreamDataResult& result) override {
+						mLoader->HandleReceiveResult(h_, result);
+					}
+					
+					//
+					DataLoaderPtr mLoader;
+				};
+				
+				//
+				void HandleReceiveResult(const HermitPtr& h_, const StreamDataResult& result) {
+					std::lock_guard<std::mutex> lock(mMutex);
+					mReceiveResult = result;
+					mCondition.notify_all();
 				}
-				mBufSize = kBufferSize;
 				
-				while (true) {
-					pthread_mutex_lock(&mMutex);
-					while (mStreamResult == StreamDataResult::kUnknown) {
-						pthread_cond_wait(&mCondition, &mMutex);
+				//	Hands one chunk to the receiver and waits for its completion, which may fire
+				//	before Call returns or later on another thread.
+				StreamDataResult Deliver(const HermitPtr& h_, const DataBuffer& data, bool isEndOfData) {
+					{
+						std::lock_guard<std::mutex> lock(mMutex);
+						mReceiveResult = StreamDataResult::kUnknown;
 					}
-					pthread_mutex_unlock(&mMutex);
-
-					if (mStreamResult == StreamDataResult::kCanceled) {
-						break;
+					auto receiveCompletion = std::make_shared<ReceiveCompletion>(shared_from_this());
+					mDataReceiver->Call(h_, data, isEndOfData, receiveCompletion);
+					
+					std::unique_lock<std::mutex> lock(mMutex);
+					while (mReceiveResult == StreamDataResult::kUnknown) {
+						mCondition.wait(lock);
 					}
-					if (mStreamResult != StreamDataResult::kSuccess) {
+					if ((mReceiveResult != StreamDataResult::kSuccess) && (mReceiveResult != StreamDataResult::kCanceled)) {
 						NOTIFY_ERROR(h_, "ReadFileData: result != StreamDataResult::kSuccess");
-						break;
-					}
-					if (mDone) {
-						break;
-					}
-	
-					size_t bytesRead = 0;
-					if (::feof(mFileHandle)) {
-						mDone = true;
-					}
-					else {
-						bytesRead = ::fread(mBuf, 1, mBufSize, mFileHandle);
-						int err = ::ferror(mFileHandle);
-						if (err != 0) {
-							NOTIFY_ERROR(h_, "ReadFileData: ferror:", err);
-							mStreamResult = StreamDataResult::kError;
+					}
+					return mReceiveResult;
+				}
+				
+				//	Reads until the buffer is full or the file ends. Returns an errno, or 0.
+				int FillBuffer(ReadBuffer& buffer, uint64_t offset) {
+					buffer.mSize = 0;
+					while (buffer.mSize < mChunkSize) {
+						ssize_t bytesRead = ::pread(mFileDescriptor,
+													buffer.mData.get() + buffer.mSize,
+													mChunkSize - buffer.mSize,
+													(off_t)(offset + buffer.mSize));
+						if (bytesRead < 0) {
+							int err = errno;
+							if (err == EINTR) {
+								continue;
+							}
+							return err;
+						}
+						if (bytesRead == 0) {
 							break;
 						}
+						buffer.mSize += (size_t)bytesRead;
 					}
-					mStreamResult = StreamDataResult::kUnknown;
-					auto receiveCompletion = std::make_shared<ReceiveCompletion>(shared_from_this());
-					mDataReceiver->Call(h_, DataBuffer(mBuf, bytesRead), mDone, receiveCompletion);
+					buffer.mIsEnd = (buffer.mSize < mChunkSize);
+					return 0;
 				}
 				
-				mCompletion->Call(h_, mStreamResult);
-			}
-			
-			//
-			class ReceiveCompletion : public DataCompletion {
-			public:
 				//
-				ReceiveCompletion(const DataLoaderPtr& loader) : mLoader(loader) {
+				StreamDataResult DeliverSingleBuffer(const HermitPtr& h_, size_t chunkSize) {
+					ReadBuffer buffer(mChunkSize);
+					int err = FillBuffer(buffer, 0);
+					if (err != 0) {
+						NOTIFY_ERROR(h_, "ReadFileData: pread failed, err:", err);
+						return StreamDataResult::kError;
+					}
+					if (!buffer.mIsEnd) {
+						//	The file grew since we checked its size; stream it instead.
+						mChunkSize = chunkSize;
+						return DeliverWithReadAhead(h_);
+					}
+					return Deliver(h_, DataBuffer(buffer.mData.get(), buffer.mSize), true);
 				}
 				
 				//
-				virtual void Call(const HermitPtr& h_, const StreamDataResult& result) override {
-					mLoader->HandleReceiveResult(h_, result);
+				StreamDataResult DeliverMappedData(const HermitPtr& h_, size_t chunkSize) {
+					size_t offset = 0;
+					while (true) {
+						size_t size = (mMappedSize - offset < chunkSize) ? (mMappedSize - offset) : chunkSize;
+						bool isEndOfData = (offset + size == mMappedSize);
+						auto result = Deliver(h_, DataBuffer((const char*)mMappedData + offset, size), isEndOfData);
+						if ((result != StreamDataResult::kSuccess) || isEndOfData) {
+							return result;
+						}
+						offset += size;
+					}
+				}
+				
+				//	Fills the buffer unless someone else already has or is doing so. Runs on a
+				//	ThreadPool worker, or on the delivering thread when it needs the buffer before
+				//	any worker got to it.
+				void RunFill(ReadBuffer* buffer) {
+					{
+						std::lock_guard<std::mutex> lock(mMutex);
+						if (buffer->mState != FillState::kQueued) {
+							return;
+						}
+						buffer->mState = FillState::kFilling;
+					}
+					
+					int err = FillBuffer(*buffer, buffer->mOffset);
+					
+					std::lock_guard<std::mutex> lock(mMutex);
+					buffer->mError = err;
+					buffer->mState = FillState::kFilled;
+					mCondition.notify_all();
 				}
 				
 				//
-				DataLoaderPtr mLoader;
+				void QueueFill(const HermitPtr& h_, ReadBuffer* buffer, uint64_t offset) {
+					{
+						std::lock_guard<std::mutex> lock(mMutex);
+						buffer->mOffset = offset;
+						buffer->mState = FillState::kQueued;
+					}
+					// if the pool won't take it the buffer stays queued and WaitForFill reads it
+					QueueAsyncTask(h_, std::make_shared<FillTask>(shared_from_this(), buffer), 10);
+				}
+				
+				//	Only ever waits on a fill that's already running; one still queued is run here.
+				void WaitForFill(ReadBuffer* buffer) {
+					RunFill(buffer);
+					std::unique_lock<std::mutex> lock(mMutex);
+					while (buffer->mState != FillState::kFilled) {
+						mCondition.wait(lock);
+					}
+				}
+				
+				//	Each buffer in turn is filled by a ThreadPool task while the other is with the
+				//	receiver. Every read starts at a multiple of mChunkSize since only the last
+				//	one comes up short.
+				StreamDataResult DeliverWithReadAhead(const HermitPtr& h_) {
+					for (size_t n = 0; n < kReadAheadBufferCount; ++n) {
+						mBuffers.push_back(std::unique_ptr<ReadBuffer>(new ReadBuffer(mChunkSize)));
+						QueueFill(h_, mBuffers.back().get(), n * mChunkSize);
+					}
+					
+					StreamDataResult result = StreamDataResult::kSuccess;
+					for (uint64_t index = 0; ; ++index) {
+						ReadBuffer* buffer = mBuffers[index % kReadAheadBufferCount].get();
+						WaitForFill(buffer);
+						if (buffer->mError != 0) {
+							NOTIFY_ERROR(h_, "ReadFileData: pread failed, err:", buffer->mError);
+							result = StreamDataResult::kError;
+							break;
+						}
+						result = Deliver(h_, DataBuffer(buffer->mData.get(), buffer->mSize), buffer->mIsEnd);
+						if ((result != StreamDataResult::kSuccess) || buffer->mIsEnd) {
+							break;
+						}
+						QueueFill(h_, buffer, (index + kReadAheadBufferCount) * mChunkSize);
+					}
+					
+					//	A fill that's still queued is claimed (and so skipped) here; one that's
+					//	running has to finish before the buffers can go.
+					std::unique_lock<std::mutex> lock(mMutex);
+					for (auto it = begin(mBuffers); it != end(mBuffers); ++it) {
+						if ((*it)->mState == FillState::kQueued) {
+							(*it)->mState = FillState::kFilled;
+						}
+						while ((*it)->mState != FillState::kFilled) {
+							mCondition.wait(lock);
+						}
+					}
+					return result;
+				}
+				
+				//
+				DataReceiverPtr mDataReceiver;
+				DataCompletionPtr mCompletion;
+				int mFileDescriptor;
+				void* mMappedData;
+				size_t mMappedSize;
+				size_t mChunkSize;
+				std::vector<std::unique_ptr<ReadBuffer>> mBuffers;
+				StreamDataResult mReceiveResult;
+				std::mutex mMutex;
+				std::condition_variable mCondition;
 			};
 			
-			//
-			void HandleReceiveResult(const HermitPtr& h_, const StreamDataResult& result) {
-				pthread_mutex_lock(&mMutex);
-				mStreamResult = result;
-				pthread_cond_signal(&mCondition);
-				pthread_mutex_unlock(&mMutex);
-			}
-
-			//
-			std::string mFilePathUTF8;
-			DataReceiverPtr mDataReceiver;
-			DataCompletionPtr mCompletion;
-			FILE* mFileHandle;
-			char* mBuf;
-			size_t mBufSize;
-			StreamDataResult mStreamResult;
-			bool mDone;
-			pthread_mutex_t mMutex;
-			pthread_cond_t mCondition;
-		};
+		} // namespace ReadFileData_Impl
+		using namespace ReadFileData_Impl;
+		
+		//
+		void ReadFileData(const HermitPtr& h_,
+						  const FilePathPtr& filePath,
+						  const DataReceiverPtr& dataReceiver,
+						  const DataCompletionPtr& completion) {
+			ReadFileData(h_, filePath, kDefaultReadFileDataBufferSize, ReadFileDataMode::kStreamed, dataReceiver, completion);
+		}
 		
 		//
 		void ReadFileData(const HermitPtr& h_,
 						  const FilePathPtr& filePath,
+						  const size_t& bufferSize,
+						  const ReadFileDataMode& mode,
 						  const DataReceiverPtr& dataReceiver,
 						  const DataCompletionPtr& completion) {
 			std::string pathUTF8;
 			FilePathToCocoaPathString(h_, filePath, pathUTF8);
-			auto dataLoader = std::make_shared<DataLoader>(pathUTF8, dataReceiver, completion);
-			dataLoader->ReadData(h_);
+			auto dataLoader = std::make_shared<DataLoader>(dataReceiver, completion);
+			dataLoader->ReadData(h_, pathUTF8, bufferSize, mode);
 		}
 		
 	} // namespace file
@@ -26,12 +26,36 @@
 namespace hermit {
 	namespace file {
 		
+		//	Chunk size used by the short form of ReadFileData. Buffers are never larger than the
+		//	file (plus one byte), so small files don't pay for the full size.
+		const size_t kDefaultReadFileDataBufferSize = 4 * 1024 * 1024;
+		
+		//
+		enum class ReadFileDataMode {
+			//	pread into a small pool of buffers, reading the next chunk on a ThreadPool worker
+			//	while the receiver works on the current one.
+			kStreamed,
+			
+			//	mmap the file and hand the receiver slices of the mapping, avoiding the copy.
+			//	Falls back to kStreamed for files too large to map. The file mustn't be
+			//	truncated while it's being read.
+			kMapped
+		};
+		
 		//
 		void ReadFileData(const HermitPtr& h_,
 						  const FilePathPtr& filePath,
 						  const DataReceiverPtr& dataReceiver,
 						  const DataCompletionPtr& completion);
 		
+		//	Each chunk stays valid until the receiver calls its completion.
+		void ReadFileData(const HermitPtr& h_,
+						  const FilePathPtr& filePath,
+						  const size_t& bufferSize,
+						  const ReadFileDataMode& mode,
+						  const DataReceiverPtr& dataReceiver,
+						  const DataCompletionPtr& completion);
+		
 	} // namespace file
 } // namespace hermit
 
@@ -0,0 +1,50 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <errno.h>
+#include <string>
+#include <sys/xattr.h>
+#include "Hermit/Foundation/Notification.h"
+#include "FilePathToCocoaPathString.h"
+#include "RemoveFileXAttr.h"
+
+namespace hermit {
+	namespace file {
+		
+		//
+		bool RemoveFileXAttr(const HermitPtr& h_, const FilePathPtr& filePath, const std::string& xAttrName) {
+			std::string pathUTF8;
+			FilePathToCocoaPathString(h_, filePath, pathUTF8);
+			
+			int result = removexattr(pathUTF8.c_str(), xAttrName.c_str(), XATTR_NOFOLLOW);
+			if (result != 0) {
+				int err = errno;
+				if (err == ENOATTR) {
+					return true;
+				}
+				NOTIFY_ERROR(h_, "RemoveFileXAttr: removexattr failed for path:", filePath);
+				NOTIFY_ERROR(h_, "-- xattr name:", xAttrName);
+				NOTIFY_ERROR(h_, "-- errno:", err);
+				return false;
+			}
+			return true;
+		}
+		
+	} // namespace file
+} // namespace hermit
@@ -19,16 +19,54 @@
 #ifndef StreamOutFileFork_h
 #define StreamOutFileFork_h
 
+#include <cstdint>
 #include "Hermit/Foundation/Hermit.h"
 #include "Hermit/Foundation/StreamDataFunction.h"
 #include "FilePath.h"
+#include "FileSyncBarrier.h"
 
 namespace hermit {
 	namespace file {
 		
+		//
+		enum class FileDurability {
+			//	Leave flushing to the OS.
+			kNone,
+			
+			//	Sync each file's data before reporting success.
+			kSyncEachFile,
+			
+			//	Hand the file to mSyncBarrier, which syncs a whole batch of files at once.
+			kGroupCommit
+		};
+		
+		//
+		struct StreamOutFileDataOptions {
+			//
+			StreamOutFileDataOptions() : mExpectedSize(0), mDurability(FileDurability::kNone) {
+			}
+			
+			//	When nonzero, space for this many bytes is reserved up front where the
+			//	platform supports it. Writing more or less is fine.
+			std::uint64_t mExpectedSize;
+			
+			//
+			FileDurability mDurability;
+			
+			//	Required for FileDurability::kGroupCommit.
+			FileSyncBarrierPtr mSyncBarrier;
+		};
+		
+		//
+		void StreamOutFileData(const HermitPtr& h_,
+							   const FilePathPtr& filePath,
+							   const DataProviderPtr& dataProvider,
+							   const DataCompletionPtr& completion);
+		
 		//
 		void StreamOutFileData(const HermitPtr& h_,
 							   const FilePathPtr& filePath,
+							   const StreamOutFileDataOptions& options,
 							   const DataProviderPtr& dataProvider,
 							   const DataCompletionPtr& completion);
 		
@@ -16,6 +16,8 @@
 //	along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#import <fcntl.h>
+#import <sys/stat.h>
 #import <string>
 #import <Foundation/Foundation.h>
 #import <Foundation/FoundationErrors.h>
@@ -97,17 +99,22 @@ namespace hermit {
 			public:
 				//
 				Completion(const FilePathPtr& filePath,
+						   const std::string& pathUTF8,
 						   NSFileHandle* fileHandle,
+						   const StreamOutFileDataOptions& options,
 						   const DataWriterPtr& dataWriter,
 						   const DataCompletionPtr& completion) :
 				mFilePath(filePath),
+				mPathUTF8(pathUTF8),
 				mFileHandle(fileHandle),
+				mOptions(options),
 				mDataWriter(dataWriter),
 				mCompletion(completion) {
 				}
 				
 				//
-				virtual void Call(const HermitPtr& h_, const StreamDataResult& result) override {
+				virtual void Call(const HermitPtr& h_, const StreamDataResult& inResult) override {
+					StreamDataResult result = inResult;
 					bool deleteFile = false;
 					if (result == StreamDataResult::kCanceled) {
 						deleteFile = true;
@@ -122,6 +129,10 @@ namespace hermit {
 					}
 					else {
 						[mFileHandle truncateFileAtOffset:mDataWriter->mBytesWritten];
+						if (!ApplyDurability(h_)) {
+							deleteFile = true;
+							result = StreamDataResult::kError;
+						}
 					}
 					[mFileHandle closeFile];
 					
@@ -131,9 +142,38 @@ namespace hermit {
 					mCompletion->Call(h_, result);
 				}
 				
+				//
+				bool ApplyDurability(const HermitPtr& h_) {
+					int fileDescriptor = [mFileHandle fileDescriptor];
+					FileDurability durability = mOptions.mDurability;
+					if ((durability == FileDurability::kGroupCommit) && (mOptions.mSyncBarrier == nullptr)) {
+						NOTIFY_ERROR(h_, "StreamOutFileData: kGroupCommit without a sync barrier, syncing now:", mFilePath);
+						durability = FileDurability::kSyncEachFile;
+					}
+					if (durability == FileDurability::kSyncEachFile) {
+						int err = SyncFileData(fileDescriptor);
+						if (err != 0) {
+							NOTIFY_ERROR(h_, "StreamOutFileData: SyncFileData failed for:", mFilePath, "err:", err);
+							return false;
+						}
+					}
+					else if (durability == FileDurability::kGroupCommit) {
+						struct stat s;
+						if (::fstat(fileDescriptor, &s) != 0) {
+							int err = errno;
+							NOTIFY_ERROR(h_, "StreamOutFileData: fstat failed for:", mFilePath, "err:", err);
+							return false;
+						}
+						mOptions.mSyncBarrier->AddFile(mPathUTF8, s.st_dev);
+					}
+					return true;
+				}
+				
 				//
 				FilePathPtr mFilePath;
+				std::string mPathUTF8;
 				NSFileHandle* mFileHandle;
+				StreamOutFileDataOptions mOptions;
 				DataWriterPtr mDataWriter;
 				DataCompletionPtr mCompletion;
 			};
@@ -146,6 +186,16 @@ namespace hermit {
 							   const FilePathPtr& filePath,
 							   const DataProviderPtr& dataProvider,
 							   const DataCompletionPtr& completion) {
+			StreamOutFileData(h_, filePath, StreamOutFileDataOptions(), dataProvider, completion);
+		}
+		
+		//	Chunks are written as they arrive; the write-behind thread of the Unix backend
+		//	isn't used here.
+		void StreamOutFileData(const HermitPtr& h_,
+							   const FilePathPtr& filePath,
+							   const StreamOutFileDataOptions& options,
+							   const DataProviderPtr& dataProvider,
+							   const DataCompletionPtr& completion) {
 			@autoreleasepool {
 				try {
 					std::string pathUTF8;
@@ -191,8 +241,17 @@ namespace hermit {
 						return;
 					}
 					
+					if (options.mExpectedSize > 0) {
+						//	Best effort: ask for contiguous space first, then for any space.
+						fstore_t store = { F_ALLOCATECONTIG, F_PEOFPOSMODE, 0, (off_t)options.mExpectedSize, 0 };
+						if (::fcntl([fileHandle fileDescriptor], F_PREALLOCATE, &store) == -1) {
+							store.fst_flags = F_ALLOCATEALL;
+							::fcntl([fileHandle fileDescriptor], F_PREALLOCATE, &store);
+						}
+					}
+					
 					auto writer = std::make_shared<DataWriter>(filePath, fileHandle);
-					auto providerCompletion = std::make_shared<Completion>(filePath, fileHandle, writer, completion);
+					auto providerCompletion = std::make_shared<Completion>(filePath, pathUTF8, fileHandle, options, writer, completion);
 					dataProvider->Call(h_, writer, providerCompletion);
 				}
 				catch (NSException* ex) {
@@ -0,0 +1,395 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Hermit/Foundation/Notification.h"
+#include "FileNotification.h"
+#include "FilePathToCocoaPathString.h"
+#include "StreamOutFileData.h"
+
+namespace hermit {
+	namespace file {
+		namespace StreamOutFileData_Impl {
+			
+			//	Chunks held for the writer thread: one being written while the next is copied in.
+			const size_t kWriteBehindBufferCount = 2;
+			
+			//
+			bool IsDiskFullError(int err) {
+				return (err == ENOSPC) || (err == EDQUOT);
+			}
+			
+			//	Removes a partly written file.
+			void UnlinkFile(const HermitPtr& h_, const std::string& pathUTF8) {
+				if (::unlink(pathUTF8.c_str()) != 0) {
+					int err = errno;
+					if (err != ENOENT) {
+						NOTIFY_ERROR(h_, "StreamOutFileData: unlink failed for:", pathUTF8, "err:", err);
+					}
+				}
+			}
+			
+			//	Writes all of inData at the current offset. Returns 0 or an errno.
+			int WriteAll(int fileDescriptor, const char* inData, size_t inDataSize) {
+				while (inDataSize > 0) {
+					ssize_t bytesWritten = ::write(fileDescriptor, inData, inDataSize);
+					if (bytesWritten < 0) {
+						int err = errno;
+						if (err == EINTR) {
+							continue;
+						}
+						return err;
+					}
+					inData += bytesWritten;
+					inDataSize -= (size_t)bytesWritten;
+				}
+				return 0;
+			}
+			
+			//	A provider that hands over its whole payload in one call (WriteFileData, small
+			//	store items) is written directly. Otherwise each chunk is copied to a pooled
+			//	buffer and written on a writer thread, so the provider can produce chunk N+1
+			//	while chunk N goes to disk. Write errors surface on the next call or at the end;
+			//	kBytesWrittenNotification is only sent once a chunk is actually in the file.
+			class DataWriter : public DataReceiver {
+			public:
+				//
+				DataWriter(const FilePathPtr& filePath, int fileDescriptor) :
+				mBytesWritten(0),
+				mFilePath(filePath),
+				mFileDescriptor(fileDescriptor),
+				mWriteError(0),
+				mStopWriting(false) {
+				}
+				
+				//
+				~DataWriter() {
+					FinishWriting();
+				}
+				
+				//
+				virtual void Call(const HermitPtr& h_,
+								  const DataBuffer& data,
+								  const bool& isEndOfData,
+								  const DataCompletionPtr& completion) override {
+					int err = 0;
+					if (data.second == 0) {
+						std::lock_guard<std::mutex> lock(mMutex);
+						err = mWriteError;
+					}
+					else if (!mWriterThread.joinable() && isEndOfData) {
+						err = WriteAll(mFileDescriptor, data.first, data.second);
+						if (err == 0) {
+							BytesWritten(h_, data.second);
+						}
+					}
+					else {
+						err = QueueData(h_, data);
+					}
+					if (err != 0) {
+						if (IsDiskFullError(err)) {
+							completion->Call(h_, StreamDataResult::kDiskFull);
+							return;
+						}
+						NOTIFY_ERROR(h_, "DataWriter: write failed for:", mFilePath, "err:", err);
+						completion->Call(h_, StreamDataResult::kError);
+						return;
+					}
+					completion->Call(h_, StreamDataResult::kSuccess);
+				}
+				
+				//	Waits for queued chunks to reach the file. Returns 0 or the first write errno.
+				//	mBytesWritten is only settled once this returns.
+				int FinishWriting() {
+					if (mWriterThread.joinable()) {
+						{
+							std::lock_guard<std::mutex> lock(mMutex);
+							mStopWriting = true;
+							mCondition.notify_all();
+						}
+						mWriterThread.join();
+					}
+					std::lock_guard<std::mutex> lock(mMutex);
+					return mWriteError;
+				}
+				
+				//
+				uint64_t mBytesWritten;
+				
+			private:
+				//
+				struct Buffer {
+					//
+					std::vector<char> mData;
+					HermitPtr mH_;
+				};
+				
+				//
+				void BytesWritten(const HermitPtr& h_, size_t size) {
+					mBytesWritten += size;
+					BytesWrittenNotificationParam param(mFilePath, size);
+					NOTIFY(h_, kBytesWrittenNotification, &param);
+				}
+				
+				//
+				int QueueData(const HermitPtr& h_, const DataBuffer& data) {
+					if (!mWriterThread.joinable()) {
+						for (size_t n = 0; n < kWriteBehindBufferCount; ++n) {
+							mBuffers.push_back(std::unique_ptr<Buffer>(new Buffer()));
+							mFreeBuffers.push_back(mBuffers.back().get());
+						}
+						mWriterThread = std::thread(&DataWriter::WriteQueuedData, this);
+					}
+					
+					Buffer* buffer = nullptr;
+					{
+						std::unique_lock<std::mutex> lock(mMutex);
+						while (mFreeBuffers.empty() && (mWriteError == 0)) {
+							mCondition.wait(lock);
+						}
+						if (mWriteError != 0) {
+							return mWriteError;
+						}
+						buffer = mFreeBuffers.front();
+						mFreeBuffers.pop_front();
+					}
+					buffer->mData.assign(data.first, data.first + data.second);
+					buffer->mH_ = h_;
+					
+					std::lock_guard<std::mutex> lock(mMutex);
+					mQueuedBuffers.push_back(buffer);
+					mCondition.notify_all();
+					return 0;
+				}
+				
+				//	Runs on mWriterThread. After a failed write, later chunks are dropped.
+				void WriteQueuedData() {
+					while (true) {
+						Buffer* buffer = nullptr;
+						{
+							std::unique_lock<std::mutex> lock(mMutex);
+							while (mQueuedBuffers.empty() && !mStopWriting) {
+								mCondition.wait(lock);
+							}
+							if (mQueuedBuffers.empty()) {
+								return;
+							}
+							buffer = mQueuedBuffers.front();
+							mQueuedBuffers.pop_front();
+						}
+						
+						int err = 0;
+						bool failed = false;
+						{
+							std::lock_guard<std::mutex> lock(mMutex);
+							failed = (mWriteError != 0);
+						}
+						if (!failed) {
+							err = WriteAll(mFileDescriptor, buffer->mData.data(), buffer->mData.size());
+							if (err == 0) {
+								BytesWritten(buffer->mH_, buffer->mData.size());
+							}
+						}
+						buffer->mH_ = nullptr;
+						
+						std::lock_guard<std::mutex> lock(mMutex);
+						if ((err != 0) && (mWriteError == 0)) {
+							mWriteError = err;
+						}
+						mFreeBuffers.push_back(buffer);
+						mCondition.notify_all();
+					}
+				}
+				
+				//
+				FilePathPtr mFilePath;
+				int mFileDescriptor;
+				std::vector<std::unique_ptr<Buffer>> mBuffers;
+				std::deque<Buffer*> mFreeBuffers;
+				std::deque<Buffer*> mQueuedBuffers;
+				int mWriteError;
+				bool mStopWriting;
+				std::thread mWriterThread;
+				std::mutex mMutex;
+				std::condition_variable mCondition;
+			};
+			typedef std::shared_ptr<DataWriter> DataWriterPtr;
+			
+			//
+			class Completion : public DataCompletion {
+			public:
+				//
+				Completion(const FilePathPtr& filePath,
+						   const std::string& pathUTF8,
+						   int fileDescriptor,
+						   const StreamOutFileDataOptions& options,
+						   const DataWriterPtr& dataWriter,
+						   const DataCompletionPtr& completion) :
+				mFilePath(filePath),
+				mPathUTF8(pathUTF8),
+				mFileDescriptor(fileDescriptor),
+				mOptions(options),
+				mDataWriter(dataWriter),
+				mCompletion(completion) {
+				}
+				
+				//
+				virtual void Call(const HermitPtr& h_, const StreamDataResult& result) override {
+					StreamDataResult finalResult = result;
+					int err = mDataWriter->FinishWriting();
+					if ((finalResult == StreamDataResult::kSuccess) && (err != 0)) {
+						finalResult = IsDiskFullError(err) ? StreamDataResult::kDiskFull : StreamDataResult::kError;
+					}
+					if (finalResult == StreamDataResult::kSuccess) {
+						finalResult = FinishFile(h_);
+					}
+					if (::close(mFileDescriptor) != 0) {
+						if (finalResult == StreamDataResult::kSuccess) {
+							err = errno;
+							finalResult = IsDiskFullError(err) ? StreamDataResult::kDiskFull : StreamDataResult::kError;
+						}
+					}
+					
+					if ((finalResult != StreamDataResult::kSuccess) &&
+						(finalResult != StreamDataResult::kCanceled) &&
+						(finalResult != StreamDataResult::kDiskFull)) {
+						NOTIFY_ERROR(h_, "StreamOutFileData: Error encountered while streaming data for:", mFilePath);
+					}
+					if (finalResult != StreamDataResult::kSuccess) {
+						UnlinkFile(h_, mPathUTF8);
+					}
+					mCompletion->Call(h_, finalResult);
+				}
+				
+				//	Trims any preallocation we didn't use, then applies the durability option.
+				StreamDataResult FinishFile(const HermitPtr& h_) {
+					if ((mOptions.mExpectedSize > 0) && (mOptions.mExpectedSize != mDataWriter->mBytesWritten)) {
+						if (::ftruncate(mFileDescriptor, (off_t)mDataWriter->mBytesWritten) != 0) {
+							int err = errno;
+							NOTIFY_ERROR(h_, "StreamOutFileData: ftruncate failed for:", mFilePath, "err:", err);
+							return StreamDataResult::kError;
+						}
+					}
+					
+					FileDurability durability = mOptions.mDurability;
+					if ((durability == FileDurability::kGroupCommit) && (mOptions.mSyncBarrier == nullptr)) {
+						NOTIFY_ERROR(h_, "StreamOutFileData: kGroupCommit without a sync barrier, syncing now:", mFilePath);
+						durability = FileDurability::kSyncEachFile;
+					}
+					if (durability == FileDurability::kSyncEachFile) {
+						int err = SyncFileData(mFileDescriptor);
+						if (err != 0) {
+							NOTIFY_ERROR(h_, "StreamOutFileData: SyncFileData failed for:", mFilePath, "err:", err);
+							return IsDiskFullError(err) ? StreamDataResult::kDiskFull : StreamDataResult::kError;
+						}
+						//	The file was created (or truncated) here, so its directory entry needs syncing too.
+						err = SyncParentDirectory(mPathUTF8);
+						if (err != 0) {
+							NOTIFY_ERROR(h_, "StreamOutFileData: SyncParentDirectory failed for:", mFilePath, "err:", err);
+							return StreamDataResult::kError;
+						}
+					}
+					else if (durability == FileDurability::kGroupCommit) {
+						struct stat s;
+						if (::fstat(mFileDescriptor, &s) != 0) {
+							int err = errno;
+							NOTIFY_ERROR(h_, "StreamOutFileData: fstat failed for:", mFilePath, "err:", err);
+							return StreamDataResult::kError;
+						}
+						mOptions.mSyncBarrier->AddFile(mPathUTF8, s.st_dev);
+					}
+					return StreamDataResult::kSuccess;
+				}
+				
+				//
+				FilePathPtr mFilePath;
+				std::string mPathUTF8;
+				int mFileDescriptor;
+				StreamOutFileDataOptions mOptions;
+				DataWriterPtr mDataWriter;
+				DataCompletionPtr mCompletion;
+			};
+			
+		} // namespace StreamOutFileData_Impl
+		using namespace StreamOutFileData_Impl;
+		
+		//
+		void StreamOutFileData(const HermitPtr& h_,
+							   const FilePathPtr& filePath,
+							   const DataProviderPtr& dataProvider,
+							   const DataCompletionPtr& completion) {
+			StreamOutFileData(h_, filePath, StreamOutFileDataOptions(), dataProvider, completion);
+		}
+		
+		//
+		void StreamOutFileData(const HermitPtr& h_,
+							   const FilePathPtr& filePath,
+							   const StreamOutFileDataOptions& options,
+							   const DataProviderPtr& dataProvider,
+							   const DataCompletionPtr& completion) {
+			std::string pathUTF8;
+			FilePathToCocoaPathString(h_, filePath, pathUTF8);
+			int fileDescriptor = ::open(pathUTF8.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+			if (fileDescriptor == -1) {
+				int err = errno;
+				if (IsDiskFullError(err)) {
+					completion->Call(h_, StreamDataResult::kDiskFull);
+					return;
+				}
+				if (err == ENOENT) {
+					completion->Call(h_, StreamDataResult::kFileNotFound);
+					return;
+				}
+				NOTIFY_ERROR(h_, "StreamOutFileData: open failed for:", filePath, "err:", err);
+				completion->Call(h_, StreamDataResult::kError);
+				return;
+			}
+			
+#if defined(__linux__)
+			//	KEEP_SIZE reserves the blocks without moving EOF, so until the data lands the file
+			//	never shows a zero-filled tail. File systems without fallocate support just skip
+			//	the reservation.
+			if ((options.mExpectedSize > 0) &&
+				(::fallocate(fileDescriptor, FALLOC_FL_KEEP_SIZE, 0, (off_t)options.mExpectedSize) != 0)) {
+				int err = errno;
+				if (IsDiskFullError(err)) {
+					::close(fileDescriptor);
+					UnlinkFile(h_, pathUTF8);
+					completion->Call(h_, StreamDataResult::kDiskFull);
+					return;
+				}
+			}
+#endif
+			
+			auto writer = std::make_shared<DataWriter>(filePath, fileDescriptor);
+			auto providerCompletion = std::make_shared<Completion>(filePath, pathUTF8, fileDescriptor, options, writer, completion);
+			dataProvider->Call(h_, writer, providerCompletion);
+		}
+		
+	} // namespace file
+} // namespace hermit
@@ -16,1789 +16,808 @@
 //	along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
-#include <set>
+#include <algorithm>
+#include <deque>
+#include <mutex>
 #include <string>
+#include <vector>
+#include "Hermit/Foundation/AsyncTaskQueue.h"
+#include "Hermit/Foundation/Notification.h"
 #include "Hermit/String/GetRelativePath.h"
 #include "AppendToFilePath.h"
-#include "CompareFiles.h"
 #include "CompareFinderInfo.h"
-#include "CopyFinderInfo.h"
-#include "CopySymbolicLink.h"
 #include "DeleteFile.h"
+#include "FileExists.h"
 #include "FileSystemCopy.h"
-#include "GetFileDates.h"
-#include "GetFileForkSize.h"
 #include "GetFilePathUTF8String.h"
 #include "GetFilePosixOwnership.h"
-#include "GetFilePosixPermissions.h"
-#include "GetFileType.h"
+#include "GetFileXAttrs.h"
 #include "GetSymbolicLinkTarget.h"
-#include "ListDirectoryContents.h"
-#include "PathIsPackage.h"
-#include "SetDirectoryIsPackage.h"
+#include "ListDirectoryContentsWithInfo.h"
+#include "RemoveFileXAttr.h"
 #include "SetFileDates.h"
 #include "SetFilePosixOwnership.h"
 #include "SetFilePosixPermissions.h"
+#include "SetFileXAttr.h"
 #include "SyncDirectories.h"
 
-#if 000
-
 namespace hermit {
-namespace file {
-
-namespace {
-
-	//
-	bool CompareFiles(const HermitPtr& h_,
-					  const FilePathPtr& inSourcePath,
-					  const FilePathPtr& inDestPath,
-					  bool& outQuickMatch)
-	{
-		GetFileDatesCallbackClassT<std::string> sourceDates;
-		GetFileDates(inSourcePath, h_, sourceDates);
-		if (!sourceDates.mSuccess)
-		{
-			NOTIFY_ERROR(h_,
-						 "CompareFiles: GetFileDates failed for source: ",
-						 inSourcePath);
-
-			return false;
-		}
-
-		GetFileDatesCallbackClassT<std::string> destDates;
-		GetFileDates(inDestPath, h_, destDates);
-		if (!destDates.mSuccess)
-		{
-			NOTIFY_ERROR(h_,
-						 "CompareFiles: GetFileDates failed for dest: ",
-						 inDestPath);
-
-			return false;
-		}
-
-		if ((sourceDates.mCreationDate != destDates.mCreationDate) ||
-			(sourceDates.mModificationDate != destDates.mModificationDate))
-		{
-			outQuickMatch = false;
-			return true;
-		}
-		
-		GetFileForkSizeCallbackClass sourceSize;
-		GetFileForkSize(inSourcePath, "", h_, sourceSize);
-		if (!sourceSize.mSuccess)
-		{
-			NOTIFY_ERROR(h_,
-						 "CompareFiles: GetFileForkSize failed for source: ",
-						 inSourcePath);
-
-			return false;
-		}
-		
-		GetFileForkSizeCallbackClass destSize;
-		GetFileForkSize(inDestPath, "", h_, destSize);
-		if (!destSize.mSuccess)
-		{
-			NOTIFY_ERROR(h_,
-						 "CompareFiles: GetFileForkSize failed for dest: ",
-						 inDestPath);
-
-			return false;
-		}
-		
-		outQuickMatch = (sourceSize.mSize == destSize.mSize);
-		return true;
-	}
-		
-	//
-	//
-	bool SyncDates(const HermitPtr& h_,
-				   const FilePathPtr& inSourcePath,
-				   const FilePathPtr& inDestPath,
-				   const bool& inPreviewOnly,
-				   const SyncDirectoriesActionCallbackRef& inActionCallback)
-	{
-		GetFileDatesCallbackClassT<std::string> sourceDates;
-		GetFileDates(inSourcePath, h_, sourceDates);
-		if (!sourceDates.mSuccess)
-		{
-			NOTIFY_ERROR(h_,
-				"SyncDates: GetFileDates failed for source: ",
-				inSourcePath);
-
-			return false;
-		}
-
-		GetFileDatesCallbackClassT<std::string> destDates;
-		GetFileDates(inDestPath, h_, destDates);
-		if (!destDates.mSuccess)
-		{
-			NOTIFY_ERROR(h_,
-				"SyncDates: GetFileDates failed for dest: ",
-				inDestPath);
-
-			return false;
-		}
-
-		if ((sourceDates.mCreationDate != destDates.mCreationDate) ||
-			(sourceDates.mModificationDate != destDates.mModificationDate))
-		{
-			if (!inPreviewOnly)
-			{
-				BasicCallbackClass callback;
-				SetFileDates(inDestPath,
-							 sourceDates.mCreationDate,
-							 sourceDates.mModificationDate,
-							 h_,
-							 callback);
-				
-				if (!callback.mSuccess)
-				{
-					NOTIFY_ERROR(h_,
-								 "SyncDates: SetFileDates failed for dest: ",
-								 inDestPath);
-
-					return false;
-				}
-			}
-
-			inActionCallback.Call(kSyncDirectoriesActionStatus_UpdatedDatesForItem, inDestPath);
-		}
-
-		return true;
-	}
-
-	//
-	//
-	bool SyncPosixOwnership(const HermitPtr& h_,
-							const FilePathPtr& inSourcePath,
-							const FilePathPtr& inDestPath,
-							const bool& inPreviewOnly,
-							const SyncDirectoriesActionCallbackRef& inActionCallback)
-	{
-		GetFilePosixOwnershipCallbackClassT<std::string> sourceOwnership;
-		GetFilePosixOwnership(inSourcePath, h_, sourceOwnership);
-		if (!sourceOwnership.mSuccess)
-		{
-			NOTIFY_ERROR(h_,
-						 "SyncPosixOwnership: GetFilePosixOwnership failed for source path: ",
-						 inSourcePath);
-			
-			return false;
-		}
-		
-		GetFilePosixOwnershipCallbackClassT<std::string> destOwnership;
-		GetFilePosixOwnership(inDestPath, h_, destOwnership);
-		if (!destOwnership.mSuccess)
-		{
-			NOTIFY_ERROR(h_,
-						 "SyncPosixOwnership: GetFilePosixOwnership failed for dest path: ",
-						 inDestPath);
-			
-			return false;
-		}
-		
-		if ((sourceOwnership.mUserOwner == destOwnership.mUserOwner) &&
-			(sourceOwnership.mGroupOwner == destOwnership.mGroupOwner))
-		{
-			return true;
-		}
-		
-		if (!inPreviewOnly)
-		{
-			SetFilePosixOwnershipCallbackClass callback;
-			SetFilePosixOwnership(inDestPath,
-								  sourceOwnership.mUserOwner,
-								  sourceOwnership.mGroupOwner,
-								  h_,
-								  callback);
+	namespace file {
+		namespace SyncDirectories_Impl {
 			
-			if (callback.mResult != SetFilePosixOwnershipResult::kSuccess)
-			{
-				NOTIFY_ERROR(h_,
-							 "SyncPosixOwnership: SetFilePosixOwnership failed for source path:",
-							 inSourcePath,
-							 "dest path:",
-							 inDestPath);
-
-				return false;
-			}
-		}
-		inActionCallback.Call(kSyncDirectoriesActionStatus_UpdatedPosixOwnershipForItem, inDestPath);
-		return true;
-	}
-
-	//
-	//
-	bool SyncPosixPermissions(const HermitPtr& h_,
-							  const FilePathPtr& inSourcePath,
-							  const FilePathPtr& inDestPath,
-							  const bool& inPreviewOnly,
-							  const SyncDirectoriesActionCallbackRef& inActionCallback)
-	{
-		GetFilePosixPermissionsCallbackClass sourcePermissions;
-		GetFilePosixPermissions(inSourcePath, h_, sourcePermissions);
-		if (!sourcePermissions.mSuccess) {
-			NOTIFY_ERROR(h_,
-						 "SyncPosixPermissions: GetFilePosixPermissions failed for source path: ",
-						 inSourcePath);
+			const size_t kMaxPendingCopies = 4096;
 			
-			return false;
-		}
-		
-		GetFilePosixPermissionsCallbackClass destPermissions;
-		GetFilePosixPermissions(inDestPath, h_, destPermissions);
-		if (!destPermissions.mSuccess)
-		{
-			NOTIFY_ERROR(h_,
-						 "SyncPosixPermissions: GetFilePosixPermissions failed for dest path: ",
-						 inDestPath);
-			
-			return false;
-		}
-		
-		if (sourcePermissions.mPermissions == destPermissions.mPermissions)
-		{
-			return true;
-		}
-		
-		if (!inPreviewOnly)
-		{
-			BasicCallbackClass callback;
-			SetFilePosixPermissions(inDestPath,
-									sourcePermissions.mPermissions,
-									h_,
-									callback);
-			
-			if (!callback.mSuccess)
-			{
-				NOTIFY_ERROR(h_,
-							 "SyncPosixPermissions: SetFilePosixPermissions failed for source path:",
-							 inSourcePath,
-							 "dest path:",
-							 inDestPath);
-
-				return false;
-			}
-		}
-		inActionCallback.Call(kSyncDirectoriesActionStatus_UpdatedPosixPermissionsForItem, inDestPath);
-		return true;
-	}
-
-	//
-	//
-	bool SyncFinderInfo(const HermitPtr& h_,
-						const FilePathPtr& inSourcePath,
-						const FilePathPtr& inDestPath,
-						const bool& inPreviewOnly,
-						const SyncDirectoriesActionCallbackRef& inActionCallback)
-	{
-		CompareFinderInfoCallbackClass compareFinderInfoCallback;
-		CompareFinderInfo(inSourcePath,
-						  inDestPath,
-						  compareFinderInfoCallback);
-		
-		if (compareFinderInfoCallback.mStatus == kCompareFinderInfoStatus_Match)
-		{
-			return true;
-		}
-		
-		if ((compareFinderInfoCallback.mStatus != kCompareFinderInfoStatus_FinderInfosDiffer) &&
-			(compareFinderInfoCallback.mStatus != kCompareFinderInfoStatus_FolderPackageStatesDiffer))
-		{
-			NOTIFY_ERROR(h_,
-						 "SyncFinderInfo: CompareFinderInfo failed for source path: ",
-						 inSourcePath,
-						 "-- dest path: ",
-						 inDestPath);
-
-			return false;
-		}
-		
-		if (compareFinderInfoCallback.mStatus == kCompareFinderInfoStatus_FolderPackageStatesDiffer)
-		{
-			//	This should've been handled elsewhere.
-			NOTIFY_ERROR(h_,
-						 "SyncFinderInfo: Unexpected state, kCompareFinderInfoStatus_FolderPackageStatesDiffer for source path:",
-						 inSourcePath,
-						 "dest path:",
-						 inDestPath);
-
-			return false;
-		}
-
-		if (compareFinderInfoCallback.mStatus != kCompareFinderInfoStatus_FinderInfosDiffer)
-		{
-			NOTIFY_ERROR(h_,
-						 "SyncFinderInfo: Unexpected state, != kCompareFinderInfoStatus_FinderInfosDiffer for source path:",
-						 inSourcePath,
-						 "dest path:",
-						 inDestPath);
-
-			return false;
-		}
-
-		if (!inPreviewOnly)
-		{
-			BasicCallbackClass callback;
-			CopyFinderInfo(inSourcePath, inDestPath, callback);
-			if (!callback.mSuccess)
-			{
-				NOTIFY_ERROR(h_,
-							 "SyncFinderInfo: CopyFinderInfo failed for source path:",
-							 inSourcePath,
-							 "dest path:",
-							 inDestPath);
-
-				return false;
-			}
-		}
-		inActionCallback.Call(kSyncDirectoriesActionStatus_UpdatedFinderInfoForItem, inDestPath);
-		return true;
-	}
-
-	//
-	//
-	class CopyFileCallback
-		:
-		public FileSystemCopyCallback
-	{
-	public:
-		//
-		//
-		CopyFileCallback()
-			:
-			mStatus(kFileSystemCopyStatus_Unknown)
-		{
-		}
-		
-		//
-		//
-		virtual bool Function(
-			const FileSystemCopyStatus& inStatus,
-			const FilePathPtr& inSourcePath,
-			const FilePathPtr& inDestPath)
-		{
-			mStatus = inStatus;
-			return true;
-		}
-		
-		//
-		//
-		FileSystemCopyStatus mStatus;
-	};
-	
-	//
-	//
-	bool CopyFileWithOverwrite(const HermitPtr& h_,
-							   const FilePathPtr& inSourcePath,
-							   const FilePathPtr& inDestParentPath,
-							   const std::string& inFilename,
-							   const bool& inPreviewOnly,
-							   const SyncDirectoriesActionCallbackRef& inActionCallback)
-	{
-		FilePathCallbackClassT<FilePathPtr> destPath;
-		AppendToFilePath(inDestParentPath, inFilename, h_, destPath);
-		if (destPath.mFilePath == nullptr)
-		{
-			NOTIFY_ERROR(h_,
-						 "CopyFileWithOverwrite: AppendToFilePath failed for destParentPath:",
-						 inDestParentPath,
-						 "item name:",
-						 inFilename);
-
-			return false;
-		}
-
-		if (!inPreviewOnly)
-		{
-			DeleteFileCallbackClass deleteCallback;
-			DeleteFile(destPath.mFilePath, h_, deleteCallback);
-			if (!deleteCallback.Success())
-			{
-				NOTIFY_ERROR(h_,
-							 "CopyFileWithOverwrite: DeleteFile failed for dest path: ",
-							 destPath.mFilePath);
-
-				return false;
-			}
-		
-			//	??? If this is a directory, should exclusions be taken into account?
-			CopyFileCallback copyCallback;
-			FileSystemCopy(inSourcePath, destPath.mFilePath, copyCallback);
-			if (copyCallback.mStatus != kFileSystemCopyStatus_Success)
-			{
-				NOTIFY_ERROR(h_,
-							 "CopyFileWithOverwrite: FileSystemCopy failed for source path:",
-							 inSourcePath,
-							 "dest path:",
-							 destPath.mFilePath);
-
-				return false;
-			}
-		}
-		inActionCallback.Call(kSyncDirectoriesActionStatus_CopiedItem, destPath.mFilePath);
-		return true;
-	}
-
-	//
-	//
-	bool CopyLinkWithOverwrite(const HermitPtr& h_,
-							   const FilePathPtr& inSourcePath,
-							   const FilePathPtr& inDestPath,
-							   const bool& inPreviewOnly,
-							   const SyncDirectoriesActionCallbackRef& inActionCallback)
-	{
-		if (!inPreviewOnly)
-		{
-			DeleteFileCallbackClass deleteCallback;
-			DeleteFile(inDestPath, h_, deleteCallback);
-			if (!deleteCallback.Success())
-			{
-				NOTIFY_ERROR(h_,
-							 "CopyLinkWithOverwrite: DeleteFile failed for dest path:",
-							 inDestPath);
-
-				return false;
-			}
-		
-			BasicCallbackClass copyCallback;
-			CopySymbolicLink(inSourcePath, inDestPath, h_, copyCallback);
-			if (!copyCallback.mSuccess)
-			{
-				NOTIFY_ERROR(h_,
-							 "CopyLinkWithOverwrite: CopySymbolicLink failed for source path:",
-							 inSourcePath,
-							 "dest path:",
-							 inDestPath);
-
-				return false;
-			}
-		}
-		inActionCallback.Call(kSyncDirectoriesActionStatus_CopiedItem, inDestPath);
-		return true;
-	}
-
-	//
-	//
-	bool CopyLinkWithOverwrite(const HermitPtr& h_,
-							   const FilePathPtr& inSourcePath,
-							   const FilePathPtr& inDestParentPath,
-							   const std::string& inFilename,
-							   const bool& inPreviewOnly,
-							   const SyncDirectoriesActionCallbackRef& inActionCallback)
-	{
-		FilePathCallbackClassT<FilePathPtr> destPath;
-		AppendToFilePath(inDestParentPath, inFilename, h_, destPath);
-		if (destPath.mFilePath == nullptr)
-		{
-			NOTIFY_ERROR(h_,
-						 "CopyLinkWithOverwrite: AppendToFilePath failed for destParentPath:",
-						 inDestParentPath,
-						 "item name:",
-						 inFilename);
-
-			return false;
-		}
-		
-		return CopyLinkWithOverwrite(inSourcePath, destPath.mFilePath, inPreviewOnly, h_, inActionCallback);
-	}
-
-	//
-	//
-	struct FileInfo {
-		//
-		//
-		FileInfo(
-			FilePathPtr inPath,
-			const char* inName)
-			:
-			mPath(inPath),
-			mName(inName)
-		{
-		}
-		
-		//
-		//
-		~FileInfo()
-		{
-		}
-					
-		//
-		//
-		FilePathPtr mPath;
-		std::string mName;
-	};
-	
-	//
-	//
-	typedef std::set<std::string> StringSet;
-	
-	//
-	//
-	typedef std::shared_ptr<FileInfo> FileInfoPtr;
-
-	//
-	//
-	struct SortFileInfoPtrs
-		:
-		public std::binary_function<FileInfoPtr, FileInfoPtr, bool>
-	{
-		//
-		//
-		bool operator ()(
-			const FileInfoPtr& inLHS,
-			const FileInfoPtr& inRHS) const
-		{
-			return inLHS->mName < inRHS->mName;
-		}
-	};
-				
-	//
-	//
-	typedef std::set<FileInfoPtr, SortFileInfoPtrs> FileSet;
-	
-	//
-	//
-	class Directory
-		:
-		public ListDirectoryContentsCallback
-	{
-	public:
-		//
-		//
-		Directory(
-			FilePathPtr inFilePath,
-			const StringSet& inExclusions)
-			:
-			mFilePath(inFilePath),
-			mExclusions(inExclusions),
-			mStatus(kListDirectoryContentsStatus_Unknown)
-		{
-		}
-		
-		//
-		//
-		bool Function(const HermitPtr& h_,
-					  const ListDirectoryContentsStatus& inStatus,
-					  const FilePathPtr& inParentPath,
-					  const std::string& inItemName)
-		{
-			mStatus = inStatus;
-			if (inStatus == kListDirectoryContentsStatus_Success)
-			{				
-				FilePathCallbackClassT<FilePathPtr> itemPath;
-				AppendToFilePath(inParentPath, inItemName, h_, itemPath);
-				if (itemPath.mFilePath == 0)
-				{
-					NOTIFY_ERROR(h_, "Directory::Function: AppendToFilePath failed.");
-					return false;
+			//
+			struct Entry {
+				//
+				Entry(const std::string& name, const DirectoryItemInfo& info) : mName(name), mInfo(info) {
 				}
-
-				if (mExclusions.find(inItemName) != mExclusions.end())
-				{
+				
+				//
+				std::string mName;
+				DirectoryItemInfo mInfo;
+			};
+			typedef std::vector<Entry> Entries;
+			
+			//
+			class Listing : public ListDirectoryContentsWithInfoItemCallback {
+			public:
+				//
+				virtual bool OnItem(const HermitPtr& h_,
+									const ListDirectoryContentsResult& result,
+									const FilePathPtr& parentPath,
+									const std::string& itemName,
+									const DirectoryItemInfo& itemInfo) override {
+					// an item missing from either listing would be deleted or copied, so any
+					// error abandons the directory
+					if (result != ListDirectoryContentsResult::kSuccess) {
+						NOTIFY_ERROR(h_, "SyncDirectories: error listing item:", itemName, "in:", parentPath);
+						return false;
+					}
+					if (itemName != ".DS_Store") {
+						mEntries.push_back(Entry(itemName, itemInfo));
+					}
 					return true;
 				}
 				
-				FileInfoPtr p(new FileInfo(itemPath.mFilePath, inItemName));
-				
-				GetFileTypeCallbackClass callback;
-				GetFileType(itemPath.mFilePath, h_, callback);
-				if (!callback.mSuccess)
-				{
-					NOTIFY_ERROR(
-						h_,
-						"Directory::Function: GetFileType failed for: ",
-						itemPath.mFilePath);
-
-					mStatus = kListDirectoryContentsStatus_Error;
+				//
+				Entries mEntries;
+			};
+			
+			//
+			bool ListSorted(const HermitPtr& h_, const FilePathPtr& directoryPath, Entries& outEntries) {
+				Listing listing;
+				auto result = ListDirectoryContentsWithInfo(h_, directoryPath, listing);
+				if (result != ListDirectoryContentsResult::kSuccess) {
+					NOTIFY_ERROR(h_, "SyncDirectories: ListDirectoryContentsWithInfo failed for:", directoryPath);
 					return false;
 				}
-				if (callback.mFileType == FileType::kDirectory)
-				{
-					mDirectories.insert(p);
+				std::sort(begin(listing.mEntries), end(listing.mEntries), [](const Entry& lhs, const Entry& rhs) {
+					return lhs.mName < rhs.mName;
+				});
+				outEntries.swap(listing.mEntries);
+				return true;
+			}
+			
+			//	Link targets as CompareLinks sees them, so that links which point to the same
+			//	place relative to themselves match even when their absolute targets differ.
+			bool GetComparableLinkTarget(const HermitPtr& h_, const FilePathPtr& linkPath, std::string& outTarget) {
+				FilePathPtr target;
+				bool targetIsRelative = false;
+				if (!GetSymbolicLinkTarget(h_, linkPath, target, targetIsRelative)) {
+					NOTIFY_ERROR(h_, "SyncDirectories: GetSymbolicLinkTarget failed for:", linkPath);
+					return false;
 				}
-				else if (callback.mFileType == FileType::kSymbolicLink)
-				{
-					mSymbolicLinks.insert(p);
+				std::string linkPathUTF8;
+				GetFilePathUTF8String(h_, linkPath, linkPathUTF8);
+				std::string targetUTF8;
+				GetFilePathUTF8String(h_, target, targetUTF8);
+				
+				if ((linkPathUTF8.find("/Volumes/") == 0) && (targetUTF8.find("/Volumes/") == 0)) {
+					linkPathUTF8 = linkPathUTF8.substr(8);
+					targetUTF8 = targetUTF8.substr(8);
 				}
-				else if (callback.mFileType == FileType::kFile)
-				{
-					mFiles.insert(p);
+				std::string relativeTargetUTF8;
+				string::GetRelativePath(linkPathUTF8, targetUTF8, relativeTargetUTF8);
+				if (relativeTargetUTF8.empty()) {
+					GetFilePathUTF8String(h_, target, outTarget);
 				}
-				else
-				{
-					NOTIFY_ERROR(
-						inHub,
-						"Directory::Function: GetFileType returned unexpected type for: ",
-						itemPath.mFilePath.P());
-						
-					return false;
+				else {
+					outTarget = relativeTargetUTF8;
 				}
-			}
-			return true;
-		}
-		
-		//
-		//
-		FilePathPtr mFilePath;
-		const StringSet& mExclusions;
-		ListDirectoryContentsStatus mStatus;
-		FileSet mFiles;
-		FileSet mDirectories;
-		FileSet mSymbolicLinks;
-	};
-	
-	//
-	//
-	class SyncLinksClass
-	{
-	public:
-		//
-		//
-		static bool SyncDirectoryLinks(
-			const ConstHubPtr& inHub,
-			const FilePathPtr& inSourceDirectoryPath,
-			const FilePathPtr& inDestDirectoryPath,
-			const bool& inPreviewOnly,
-			const bool& inIgnoreDates,
-			const StringSet& inExclusions,
-			const SyncDirectoriesActionCallbackRef& inActionCallback)
-		{
-			Directory sourceDir(inSourceDirectoryPath, inExclusions);
-			ListDirectoryContents(inSourceDirectoryPath, false, sourceDir);
-			if ((sourceDir.mStatus != kListDirectoryContentsStatus_Success) &&
-				(sourceDir.mStatus != kListDirectoryContentsStatus_DirectoryEmpty))
-			{
-				NOTIFY_ERROR(
-					inHub,
-					"SyncDirectoryLinks: ListDirectoryContents failed for source dir: ",
-					inSourceDirectoryPath);
-
-				return false;
-			}
-			
-			Directory destDir(inDestDirectoryPath, inExclusions);
-			ListDirectoryContents(inDestDirectoryPath, false, destDir);
-			if ((destDir.mStatus != kListDirectoryContentsStatus_Success) &&
-				(destDir.mStatus != kListDirectoryContentsStatus_DirectoryEmpty))
-			{
-				NOTIFY_ERROR(
-					inHub,
-					"SyncDirectoryLinks: ListDirectoryContents failed for dest dir: ",
-					inDestDirectoryPath);
-
-				return false;
-			}
-		
-			if (!SyncLinks(sourceDir, inDestDirectoryPath, destDir, inPreviewOnly, inIgnoreDates, inActionCallback))
-			{
-				NOTIFY_ERROR(
-					inHub,
-					"SyncDirectoryLinks: SyncLinks failed for source dir: ",
-					inSourceDirectoryPath);
-
-				NOTIFY_ERROR(
-					inHub,
-					"-- dest dir: ",
-					inDestDirectoryPath);
-
-				return false;
+				return true;
 			}
 			
-			if (!SyncDirectories(sourceDir, destDir, inPreviewOnly, inIgnoreDates, inExclusions, inActionCallback))
-			{
-				NOTIFY_ERROR(
-					inHub,
-					"SyncDirectoryLinks: SyncDirectories failed for source dir: ",
-					inSourceDirectoryPath);
-
-				NOTIFY_ERROR(
-					inHub,
-					"-- dest dir: ",
-					inDestDirectoryPath);
-
-				return false;
-			}
-						
-			if (!inIgnoreDates)
-			{
-				if (!SyncDates(inSourceDirectoryPath, inDestDirectoryPath, inPreviewOnly, inActionCallback))
-				{
-					NOTIFY_ERROR(
-						inHub,
-						"SyncDirectoryLinks: SyncDates failed for source dir: ",
-						inSourceDirectoryPath);
-
-					NOTIFY_ERROR(
-						inHub,
-						"-- dest dir: ",
-						inDestDirectoryPath);
+			//
+			class FinderInfoCallback : public GetFileXAttrsCallback {
+			public:
+				//
+				FinderInfoCallback() : mFound(false) {
+				}
+				
+				//
+				bool Function(const HermitPtr& h_, const std::string& xAttrName, const std::string& xAttrData) {
+					if (xAttrName == "com.apple.FinderInfo") {
+						mFinderInfo.assign(xAttrData);
+						mFound = true;
+						return false;
+					}
+					return true;
+				}
 				
+				//
+				std::string mFinderInfo;
+				bool mFound;
+			};
+			
+			//	The package state of a directory is a Finder flag, so this fixes both.
+			bool CopyFinderInfo(const HermitPtr& h_, const FilePathPtr& sourcePath, const FilePathPtr& destPath) {
+				FinderInfoCallback info;
+				if (GetFileXAttrs(h_, sourcePath, info) != GetFileXAttrsResult::kSuccess) {
+					NOTIFY_ERROR(h_, "SyncDirectories: GetFileXAttrs failed for:", sourcePath);
 					return false;
 				}
+				if (!info.mFound) {
+					return RemoveFileXAttr(h_, destPath, "com.apple.FinderInfo");
+				}
+				return SetFileXAttr(h_, destPath, "com.apple.FinderInfo", info.mFinderInfo);
 			}
-			return true;
-		}
-		
-		//
-		//
-		static bool SyncLinks(
-			const ConstHubPtr& inHub,
-			const Directory& inSourceDir,
-			const FilePathPtr& inDestDirPath,
-			const Directory& inDestDir,
-			const bool& inPreviewOnly,
-			const bool& inIgnoreDates,
-			const SyncDirectoriesActionCallbackRef& inActionCallback)
-		{
-			const FileSet& sourceLinks = inSourceDir.mSymbolicLinks;
-			const FileSet& destLinks = inDestDir.mSymbolicLinks;
 			
-			FileSet::const_iterator sourceEnd = sourceLinks.end();
-			FileSet::const_iterator destEnd = destLinks.end();
+			//
+			struct DirectoryNode;
+			typedef std::shared_ptr<DirectoryNode> DirectoryNodePtr;
 			
-			FileSet::const_iterator sourceIt = sourceLinks.begin();
-			FileSet::const_iterator destIt = destLinks.begin();
+			//
+			struct DirectoryNode {
+				//
+				DirectoryNode(const FilePathPtr& sourcePath,
+							  const FilePathPtr& destPath,
+							  const DirectoryItemInfo& sourceInfo,
+							  const DirectoryItemInfo& destInfo,
+							  const DirectoryNodePtr& parent) :
+				mSourcePath(sourcePath),
+				mDestPath(destPath),
+				mSourceInfo(sourceInfo),
+				mDestInfo(destInfo),
+				mParent(parent),
+				mPendingItems(1),
+				mContentsChanged(false) {
+				}
+				
+				//
+				FilePathPtr mSourcePath;
+				FilePathPtr mDestPath;
+				DirectoryItemInfo mSourceInfo;
+				DirectoryItemInfo mDestInfo;
+				DirectoryNodePtr mParent;
+				
+				//	Copies and subdirectories not yet finished, plus one held by the walk until the
+				//	directory has been planned. Guarded by Syncer::mMutex, as is mContentsChanged.
+				uint64_t mPendingItems;
+				
+				//	Set once anything inside has been added or removed, which moves the directory's
+				//	modification date.
+				bool mContentsChanged;
+			};
 			
-			while (true)
-			{
-				if (sourceIt == sourceEnd)
-				{
-					while (destIt != destEnd)
-					{
-						if (!inPreviewOnly)
-						{
-							DeleteFileCallbackClass callback;
-							DeleteFile((*destIt)->mPath.P(), callback);
-							if (!callback.Success())
-							{
-								NOTIFY_ERROR(
-									inHub,
-									"SyncLinks: DeleteFile failed for dest path: ",
-									(*destIt)->mPath.P());
-
-								return false;
-							}
-						}
-						inActionCallback.Call(kSyncDirectoriesActionStatus_DeletedItem, (*destIt)->mPath.P());
-
-						++destIt;
-					}
-					break;
+			//
+			struct CopyJob {
+				//
+				CopyJob(const FilePathPtr& sourcePath,
+						const FilePathPtr& destPath,
+						bool replace,
+						const DirectoryNodePtr& parent) :
+				mSourcePath(sourcePath),
+				mDestPath(destPath),
+				mReplace(replace),
+				mParent(parent) {
 				}
-				if (destIt == destEnd)
-				{
-					while (sourceIt != sourceEnd)
-					{
-						if (!CopyLinkWithOverwrite((*sourceIt)->mPath.P(), inDestDirPath, (*sourceIt)->mName, inActionCallback))
-						{
-							NOTIFY_ERROR(
-								inHub,
-								"SyncLinks: CopyLinkWithOverwrite failed for source path: ",
-								(*sourceIt)->mPath.P());
-
-							return false;
-						}
-
-						++sourceIt;
+				
+				//
+				FilePathPtr mSourcePath;
+				FilePathPtr mDestPath;
+				bool mReplace;
+				DirectoryNodePtr mParent;
+			};
+			typedef std::shared_ptr<CopyJob> CopyJobPtr;
+			
+			//
+			class Syncer;
+			typedef std::shared_ptr<Syncer> SyncerPtr;
+			
+			//	Walks the two trees together, listing each directory pair once and merging the two
+			//	sorted listings into a plan for that directory. Deletes and attribute fixes are done
+			//	by the walk; copies are queued for up to mQueueDepth pool tasks. A directory's own
+			//	attributes are fixed once everything inside it is done.
+			class Syncer : public FileSystemCopyIntermediateUpdateCallback, public std::enable_shared_from_this<Syncer> {
+			public:
+				//
+				Syncer(const bool& previewOnly,
+					   const SyncDirectoriesOptions& options,
+					   const SyncDirectoriesActionCallbackPtr& actionCallback,
+					   const SyncDirectoriesCompletionPtr& completion) :
+				mPreviewOnly(previewOnly),
+				mQueueDepth(std::max(options.mQueueDepth, (uint32_t)1)),
+				mIgnoreDates(options.mIgnoreDates),
+				mIgnoreFinderInfo(options.mIgnoreFinderInfo),
+				mActionCallback(actionCallback),
+				mCompletion(completion),
+				mCopiesInFlight(0),
+				mWalking(false),
+				mHadError(false),
+				mStopResult(SyncDirectoriesResult::kUnknown),
+				mFinished(false) {
+				}
+				
+				//
+				class WalkTask : public AsyncTask {
+				public:
+					//
+					WalkTask(const SyncerPtr& owner) : mOwner(owner) {
 					}
-					break;
+					
+					//
+					virtual void PerformTask(const HermitPtr& h_) override {
+						mOwner->Walk(h_);
+					}
+					
+					//
+					SyncerPtr mOwner;
+				};
+				
+				//
+				class CopyTask : public AsyncTask {
+				public:
+					//
+					CopyTask(const SyncerPtr& owner, const CopyJobPtr& job) : mOwner(owner), mJob(job) {
+					}
+					
+					//
+					virtual void PerformTask(const HermitPtr& h_) override {
+						mOwner->Copy(h_, mJob);
+					}
+					
+					//
+					SyncerPtr mOwner;
+					CopyJobPtr mJob;
+				};
+				
+				//
+				class CopyCompletion : public FileSystemCopyCompletion {
+				public:
+					//
+					CopyCompletion(const SyncerPtr& owner, const CopyJobPtr& job) : mOwner(owner), mJob(job) {
+					}
+					
+					//
+					virtual void Call(const HermitPtr& h_, const FileSystemCopyResult& result) override {
+						mOwner->OnCopyDone(h_, mJob, result);
+					}
+					
+					//
+					SyncerPtr mOwner;
+					CopyJobPtr mJob;
+				};
+				
+				//	Copies report each finished item here; only the whole copy is reported onward.
+				virtual bool OnUpdate(const HermitPtr& h_,
+									  const FileSystemCopyResult& result,
+									  const FilePathPtr& source,
+									  const FilePathPtr& dest) override {
+					std::lock_guard<std::mutex> lock(mMutex);
+					return (mStopResult == SyncDirectoriesResult::kUnknown);
 				}
 				
-				if ((*sourceIt)->mName < (*destIt)->mName)
-				{
-					if (!CopyLinkWithOverwrite((*sourceIt)->mPath.P(), inDestDirPath, (*sourceIt)->mName, inActionCallback))
+				//
+				void Start(const HermitPtr& h_,
+						   const FilePathPtr& sourcePath,
+						   const FilePathPtr& destPath,
+						   const DirectoryItemInfo& sourceInfo,
+						   const DirectoryItemInfo& destInfo) {
 					{
-						NOTIFY_ERROR(
-							inHub,
-							"SyncLinks: CopyLinkWithOverwrite failed for source path: ",
-							(*sourceIt)->mPath.P());
-
-						return false;
+						std::lock_guard<std::mutex> lock(mMutex);
+						mDirectories.push_back(std::make_shared<DirectoryNode>(sourcePath, destPath, sourceInfo, destInfo, nullptr));
+						mWalking = true;
 					}
-
-					++sourceIt;
+					Walk(h_);
 				}
-				else if ((*sourceIt)->mName > (*destIt)->mName)
-				{
-					if (!inPreviewOnly)
-					{
-						DeleteFileCallbackClass callback;
-						DeleteFile((*destIt)->mPath.P(), callback);
-						if (!callback.Success())
+				
+				//
+				void Walk(const HermitPtr& h_) {
+					while (true) {
+						bool aborted = CHECK_FOR_ABORT(h_);
+						DirectoryNodePtr node;
 						{
-							NOTIFY_ERROR(
-								inHub,
-								"SyncLinks: DeleteFile failed for dest path: ",
-								(*destIt)->mPath.P());
-
-							return false;
+							std::lock_guard<std::mutex> lock(mMutex);
+							if (aborted && (mStopResult == SyncDirectoriesResult::kUnknown)) {
+								mStopResult = SyncDirectoriesResult::kCanceled;
+							}
+							if ((mStopResult != SyncDirectoriesResult::kUnknown) ||
+								mDirectories.empty() ||
+								(mPendingCopies.size() >= kMaxPendingCopies)) {
+								mWalking = false;
+								break;
+							}
+							node = mDirectories.back();
+							mDirectories.pop_back();
 						}
+						SyncDirectory(h_, node);
+						Dispatch(h_);
 					}
-					inActionCallback.Call(kSyncDirectoriesActionStatus_DeletedItem, (*destIt)->mPath.P());
-
-					++destIt;
+					FinishIfStopped(h_);
 				}
-				else
-				{
-					if (!SyncOneLink((*sourceIt)->mPath.P(), (*destIt)->mPath.P(), inPreviewOnly, inActionCallback))
-					{
-						NOTIFY_ERROR(
-							inHub,
-							"SyncLinks: SyncOneLink failed for source path: ",
-							(*sourceIt)->mPath.P());
-								
-						NOTIFY_ERROR(
-							inHub,
-							"-- dest path: ",
-							(*destIt)->mPath.P());
-							
-						return false;
+				
+				//
+				void SyncDirectory(const HermitPtr& h_, const DirectoryNodePtr& node) {
+					Entries sourceEntries;
+					Entries destEntries;
+					if (!ListSorted(h_, node->mSourcePath, sourceEntries) || !ListSorted(h_, node->mDestPath, destEntries)) {
+						Report(h_, kSyncDirectoriesActionStatus_Error, node->mDestPath);
+						OnDirectoryDone(h_, node);
+						return;
 					}
 					
-					if (!SyncPosixOwnership((*sourceIt)->mPath.P(), (*destIt)->mPath.P(), inPreviewOnly, inActionCallback))
-					{
-							NOTIFY_ERROR(
-								inHub,
-								"SyncLinks: SyncPosixOwnership failed for source dir: ",
-								(*sourceIt)->mPath.P());
-
-							NOTIFY_ERROR(
-								inHub,
-								"-- dest dir: ",
-								(*destIt)->mPath.P());
-
-							return false;
-					}
-
-					if (!SyncPosixPermissions((*sourceIt)->mPath.P(), (*destIt)->mPath.P(), inPreviewOnly, inActionCallback))
-					{
-							NOTIFY_ERROR(
-								inHub,
-								"SyncLinks: SyncPosixPermissions failed for source dir: ",
-								(*sourceIt)->mPath.P());
-
-							NOTIFY_ERROR(
-								inHub,
-								"-- dest dir: ",
-								(*destIt)->mPath.P());
-
-							return false;
+					//	The plan: both listings are sorted by name, so one pass pairs them up.
+					std::vector<const Entry*> deletes;
+					std::vector<std::pair<const Entry*, bool>> copies;
+					std::vector<std::pair<const Entry*, const Entry*>> matches;
+					auto sourceIt = begin(sourceEntries);
+					auto destIt = begin(destEntries);
+					while ((sourceIt != end(sourceEntries)) || (destIt != end(destEntries))) {
+						if ((destIt == end(destEntries)) ||
+							((sourceIt != end(sourceEntries)) && (sourceIt->mName < destIt->mName))) {
+							copies.push_back(std::make_pair(&*sourceIt, false));
+							++sourceIt;
+						}
+						else if ((sourceIt == end(sourceEntries)) || (destIt->mName < sourceIt->mName)) {
+							deletes.push_back(&*destIt);
+							++destIt;
+						}
+						else {
+							if (sourceIt->mInfo.mType != destIt->mInfo.mType) {
+								copies.push_back(std::make_pair(&*sourceIt, true));
+							}
+							else {
+								matches.push_back(std::make_pair(&*sourceIt, &*destIt));
+							}
+							++sourceIt;
+							++destIt;
+						}
 					}
-
-					if (!inIgnoreDates)
-					{
-						if (!SyncDates((*sourceIt)->mPath.P(), (*destIt)->mPath.P(), inPreviewOnly, inActionCallback))
-						{
-							NOTIFY_ERROR(
-								inHub,
-								"SyncLinks: SyncDates failed for source dir: ",
-								(*sourceIt)->mPath.P());
-
-							NOTIFY_ERROR(
-								inHub,
-								"-- dest dir: ",
-								(*destIt)->mPath.P());
-						
-							return false;
+					
+					//	Matching files whose data may differ and links whose targets do are replaced;
+					//	directories are descended into; the rest only need their attributes fixed.
+					std::vector<std::pair<const Entry*, const Entry*>> fixes;
+					std::vector<DirectoryNodePtr> directories;
+					for (auto it = begin(matches); it != end(matches); ++it) {
+						const Entry& source = *it->first;
+						const Entry& dest = *it->second;
+						FilePathPtr sourcePath;
+						FilePathPtr destPath;
+						if (!AppendPaths(h_, node, source.mName, sourcePath, destPath)) {
+							continue;
+						}
+						if (source.mInfo.mType == FileType::kDirectory) {
+							directories.push_back(std::make_shared<DirectoryNode>(sourcePath, destPath, source.mInfo, dest.mInfo, node));
+						}
+						else if (source.mInfo.mType == FileType::kSymbolicLink) {
+							std::string sourceTarget;
+							std::string destTarget;
+							if (!GetComparableLinkTarget(h_, sourcePath, sourceTarget) ||
+								!GetComparableLinkTarget(h_, destPath, destTarget)) {
+								Report(h_, kSyncDirectoriesActionStatus_Error, destPath);
+							}
+							else if (sourceTarget != destTarget) {
+								copies.push_back(std::make_pair(it->first, true));
+							}
+							else {
+								fixes.push_back(*it);
+							}
+						}
+						else if ((source.mInfo.mDataSize != dest.mInfo.mDataSize) ||
+								 (source.mInfo.mCreationDate != dest.mInfo.mCreationDate) ||
+								 (source.mInfo.mModificationDate != dest.mInfo.mModificationDate)) {
+							copies.push_back(std::make_pair(it->first, true));
+						}
+						else {
+							fixes.push_back(*it);
 						}
 					}
 					
-					++sourceIt;
-					++destIt;
-				}
-			}
-			return true;
-		}
-
-		//
-		//
-		static bool SyncOneLink(
-			const ConstHubPtr& inHub,
-			const FilePathPtr& inLinkPath1,
-			const FilePathPtr& inLinkPath2,
-			const bool& inPreviewOnly,
-			const SyncDirectoriesActionCallbackRef& inActionCallback)
-		{
-			StringCallbackClass stringCallback;
-			GetFilePathUTF8String(inLinkPath1, stringCallback);
-			std::string link1PathUTF8(stringCallback.mValue);
-
-			GetSymbolicLinkTargetCallbackClassT<FilePathPtr> link1TargetCallback;
-			GetSymbolicLinkTarget(inLinkPath1, link1TargetCallback);
-			if (!link1TargetCallback.mSuccess)
-			{
-				NOTIFY_ERROR(
-					inHub,
-					"SyncOneLink: GetSymbolicLinkTarget failed for path: ",
-					inLinkPath1);
+					//	Deletes come first, and from the walk itself, so that on a case-insensitive
+					//	volume an item whose name differs only in case is gone before its
+					//	replacement is copied in.
+					for (auto it = begin(deletes); it != end(deletes); ++it) {
+						FilePathPtr destPath;
+						AppendToFilePath(h_, node->mDestPath, (*it)->mName, destPath);
+						if (destPath == nullptr) {
+							NOTIFY_ERROR(h_, "SyncDirectories: AppendToFilePath failed, path:", node->mDestPath, "item name:", (*it)->mName);
+							Report(h_, kSyncDirectoriesActionStatus_Error, node->mDestPath);
+							continue;
+						}
+						if (!mPreviewOnly) {
+							auto status = DeleteFile(h_, destPath);
+							if ((status != kDeleteFileStatus_Success) && (status != kDeleteFileStatus_FileNotFound)) {
+								NOTIFY_ERROR(h_, "SyncDirectories: DeleteFile failed for:", destPath);
+								Report(h_, kSyncDirectoriesActionStatus_Error, destPath);
+								continue;
+							}
+							SetContentsChanged(node);
+						}
+						Report(h_, kSyncDirectoriesActionStatus_DeletedItem, destPath);
+					}
 					
-				return false;
-			}
-
-			GetFilePathUTF8String(inLinkPath2, stringCallback);
-			std::string link2PathUTF8(stringCallback.mValue);
-
-			GetSymbolicLinkTargetCallbackClassT<FilePathPtr> link2TargetCallback;
-			GetSymbolicLinkTarget(inLinkPath2, link2TargetCallback);
-			if (!link2TargetCallback.mSuccess)
-			{
-				NOTIFY_ERROR(
-					inHub,
-					"SyncOneLink: GetSymbolicLinkTarget failed for path: ",
-					inLinkPath2);
-						
-				return false;
-			}
-
-			GetFilePathUTF8String(link1TargetCallback.mFilePath.P(), stringCallback);
-			std::string link1TargetPathUTF8(stringCallback.mValue);
-						
-			GetFilePathUTF8String(link2TargetCallback.mFilePath.P(), stringCallback);
-			std::string link2TargetPathUTF8(stringCallback.mValue);
-		
-			if (link1TargetPathUTF8 == link2TargetPathUTF8)
-			{
-				return true;
-			}
-
-			std::string originalLink1TargetPathUTF8(link1TargetPathUTF8);
-			if ((link1PathUTF8.find("/Volumes/") == 0) &&
-				(link1TargetPathUTF8.find("/Volumes/") == 0))
-			{
-				link1PathUTF8 = link1PathUTF8.substr(8);
-				link1TargetPathUTF8 = link1TargetPathUTF8.substr(8);
-			}
-
-			GetRelativePath(link1PathUTF8, link1TargetPathUTF8, stringCallback);
-			std::string link1TargetRelativePathUTF8(stringCallback.mValue);
-			if (link1TargetRelativePathUTF8.empty())
-			{
-				link1TargetPathUTF8 = originalLink1TargetPathUTF8;
-			}
-			else
-			{
-				link1TargetPathUTF8 = link1TargetRelativePathUTF8;
-			}
-
-			std::string originalLink2TargetPathUTF8(link2TargetPathUTF8);
-			if ((link2PathUTF8.find("/Volumes/") == 0) &&
-				(link2TargetPathUTF8.find("/Volumes/") == 0))
-			{
-				link2PathUTF8 = link2PathUTF8.substr(8);
-				link2TargetPathUTF8 = link2TargetPathUTF8.substr(8);
-			}
-
-			GetRelativePath(link2PathUTF8, link2TargetPathUTF8, stringCallback);
-			std::string link2TargetRelativePathUTF8(stringCallback.mValue);
-			if (link2TargetRelativePathUTF8.empty())
-			{
-				link2TargetPathUTF8 = originalLink2TargetPathUTF8;
-			}
-			else
-			{
-				link2TargetPathUTF8 = link2TargetRelativePathUTF8;
-			}
-
-			if (link1TargetPathUTF8 == link2TargetPathUTF8)
-			{
-				return true;
-			}
-			
-			if (!CopyLinkWithOverwrite(inLinkPath1, inLinkPath2, inPreviewOnly, inActionCallback))
-			{
-				NOTIFY_ERROR(
-					inHub,
-					"SyncOneLink: CopyLinkWithOverwrite failed for source path: ",
-					inLinkPath1);
-
-				return false;
-			}
-
-			return true;
-		}
-
-		//
-		//
-		static bool SyncDirectories(
-			const ConstHubPtr& inHub,
-			const Directory& inSourceDir,
-			const Directory& inDestDir,
-			const bool& inPreviewOnly,
-			const bool& inIgnoreDates,
-			const StringSet& inExclusions,
-			const SyncDirectoriesActionCallbackRef& inActionCallback)
-		{
-			const FileSet& sourceDirs = inSourceDir.mDirectories;
-			const FileSet& destDirs = inDestDir.mDirectories;
-			
-			FileSet::const_iterator sourceEnd = sourceDirs.end();
-			FileSet::const_iterator destEnd = destDirs.end();
-			
-			FileSet::const_iterator sourceIt = sourceDirs.begin();
-			FileSet::const_iterator destIt = destDirs.begin();
-
-			while (true)
-			{
-				//	since this is used for the second pass, the directory structures should already match.
-				//	so each variation of mismatch is an unexpected error condition.
-				if (sourceIt == sourceEnd)
-				{
-					if ((destIt != destEnd) && !inPreviewOnly)
-					{
-						NOTIFY_ERROR(
-							inHub,
-							"SyncDirectories: Unexpected case, sourceIt == sourceEnd but destIt != destEnd for source dir: ",
-							inSourceDir.mFilePath.P());
-								
-						NOTIFY_ERROR(
-							inHub,
-							"-- dest dir: ",
-							inDestDir.mFilePath.P());
-							
-						LogString("-- (*destIt)->mName: ", (*destIt)->mName);
-
-						return false;
+					std::vector<CopyJobPtr> jobs;
+					for (auto it = begin(copies); it != end(copies); ++it) {
+						FilePathPtr sourcePath;
+						FilePathPtr destPath;
+						if (!AppendPaths(h_, node, it->first->mName, sourcePath, destPath)) {
+							continue;
+						}
+						if (mPreviewOnly) {
+							Report(h_, kSyncDirectoriesActionStatus_CopiedItem, destPath);
+						}
+						else {
+							jobs.push_back(std::make_shared<CopyJob>(sourcePath, destPath, it->second, node));
+						}
 					}
-					break;
-				}
-				if (destIt == destEnd)
-				{
-					if ((sourceIt != sourceEnd) && !inPreviewOnly)
+					
 					{
-						NOTIFY_ERROR(
-							inHub,
-							"SyncDirectories: Unexpected case, destIt == destEnd but sourceIt != sourceEnd for source dir: ",
-							inSourceDir.mFilePath.P());
-								
-						NOTIFY_ERROR(
-							inHub,
-							"-- dest dir: ",
-							inDestDir.mFilePath.P());
-
-						LogString("-- (*sourceIt)->mName: ", (*sourceIt)->mName);
-
-						return false;
+						std::lock_guard<std::mutex> lock(mMutex);
+						node->mPendingItems += jobs.size() + directories.size();
+						mPendingCopies.insert(end(mPendingCopies), begin(jobs), end(jobs));
+						// pushed last to first so the walk visits them in name order
+						mDirectories.insert(end(mDirectories), directories.rbegin(), directories.rend());
 					}
-					break;
-				}
-				if ((*sourceIt)->mName < (*destIt)->mName)
-				{
-					if (!inPreviewOnly)
-					{
-						NOTIFY_ERROR(
-							inHub,
-							"SyncDirectories: Unexpected case, (*sourceIt)->mName < (*destIt)->mName for source dir: ",
-							inSourceDir.mFilePath.P());
-								
-						NOTIFY_ERROR(
-							inHub,
-							"-- dest dir: ",
-							inDestDir.mFilePath.P());
-
-						LogString("-- (*sourceIt)->mName: ", (*sourceIt)->mName);
-						LogString("-- (*destIt)->mName: ", (*destIt)->mName);
-
-						return false;
+					Dispatch(h_);
+					
+					// attribute fixes for the whole directory run while its copies do
+					for (auto it = begin(fixes); it != end(fixes); ++it) {
+						FilePathPtr sourcePath;
+						FilePathPtr destPath;
+						if (AppendPaths(h_, node, it->first->mName, sourcePath, destPath)) {
+							FixAttributes(h_, sourcePath, destPath, it->first->mInfo, it->second->mInfo, false);
+						}
 					}
-					++sourceIt;
+					
+					OnItemDone(h_, node);
 				}
-				else if ((*sourceIt)->mName > (*destIt)->mName)
-				{
-					if (!inPreviewOnly)
-					{
-						NOTIFY_ERROR(
-							inHub,
-							"SyncDirectories: Unexpected case, (*sourceIt)->mName < (*destIt)->mName for source dir: ",
-							inSourceDir.mFilePath.P());
-						
-						NOTIFY_ERROR(
-							inHub,
-							"-- dest dir: ",
-							inDestDir.mFilePath.P());
-
-						LogString("-- (*sourceIt)->mName: ", (*sourceIt)->mName);
-						LogString("-- (*destIt)->mName: ", (*destIt)->mName);
-
+				
+				//
+				bool AppendPaths(const HermitPtr& h_,
+								 const DirectoryNodePtr& node,
+								 const std::string& name,
+								 FilePathPtr& outSourcePath,
+								 FilePathPtr& outDestPath) {
+					AppendToFilePath(h_, node->mSourcePath, name, outSourcePath);
+					AppendToFilePath(h_, node->mDestPath, name, outDestPath);
+					if ((outSourcePath == nullptr) || (outDestPath == nullptr)) {
+						NOTIFY_ERROR(h_, "SyncDirectories: AppendToFilePath failed, path:", node->mDestPath, "item name:", name);
+						Report(h_, kSyncDirectoriesActionStatus_Error, node->mDestPath);
 						return false;
 					}
-					++destIt;
+					return true;
 				}
-				else
-				{
-					if (!SyncDirectoryLinks(
-						inHub,
-						(*sourceIt)->mPath.P(),
-						(*destIt)->mPath.P(),
-						inPreviewOnly,
-						inIgnoreDates,
-						inExclusions,
-						inActionCallback))
-					{
-						NOTIFY_ERROR(
-							inHub,
-							"SyncDirectories: SyncDirectoryLinks failed for source path: ",
-							(*sourceIt)->mPath.P());
-								
-						NOTIFY_ERROR(
-							inHub,
-							"-- dest path: ",
-							(*destIt)->mPath.P());
-
-						return false;
+				
+				//	Ownership, permissions, Finder info and dates, in that order, each compared from
+				//	the listings where they can be.
+				void FixAttributes(const HermitPtr& h_,
+								   const FilePathPtr& sourcePath,
+								   const FilePathPtr& destPath,
+								   const DirectoryItemInfo& sourceInfo,
+								   const DirectoryItemInfo& destInfo,
+								   bool contentsChanged) {
+					if ((sourceInfo.mUserID != destInfo.mUserID) || (sourceInfo.mGroupID != destInfo.mGroupID)) {
+						if (!mPreviewOnly && !CopyOwnership(h_, sourcePath, destPath)) {
+							Report(h_, kSyncDirectoriesActionStatus_Error, destPath);
+						}
+						else {
+							Report(h_, kSyncDirectoriesActionStatus_UpdatedPosixOwnershipForItem, destPath);
+						}
 					}
 					
-					++sourceIt;
-					++destIt;
-				}
-			}
-
-			return true;
-		}
-	};
-
-	//
-	//
-	class SyncFilesAndDirectoriesClass
-	{
-	public:
-		//
-		//
-		static bool SyncFilesAndDirectories(
-			const ConstHubPtr& inHub,
-			const FilePathPtr& inSourceDirectoryPath,
-			const FilePathPtr& inDestDirectoryPath,
-			const bool& inPreviewOnly,
-			const bool& inIgnoreDates,
-			const bool& inIgnoreFinderInfo,
-			const StringSet& inExclusions,
-			const SyncDirectoriesActionCallbackRef& inActionCallback)
-		{
-			Directory sourceDir(inSourceDirectoryPath, inExclusions);
-			ListDirectoryContents(inSourceDirectoryPath, false, sourceDir);
-			if ((sourceDir.mStatus != kListDirectoryContentsStatus_Success) &&
-				(sourceDir.mStatus != kListDirectoryContentsStatus_DirectoryEmpty))
-			{
-				NOTIFY_ERROR(
-					inHub,
-					"SyncFilesAndDirectories: ListDirectoryContents failed for: ",
-					inSourceDirectoryPath);
-
-				return false;
-			}
-			
-			Directory destDir(inDestDirectoryPath, inExclusions);
-			ListDirectoryContents(inDestDirectoryPath, false, destDir);
-			if ((destDir.mStatus != kListDirectoryContentsStatus_Success) &&
-				(destDir.mStatus != kListDirectoryContentsStatus_DirectoryEmpty))
-			{
-				NOTIFY_ERROR(
-					inHub,
-					"SyncFilesAndDirectories: ListDirectoryContents failed for: ",
-					inDestDirectoryPath);
-
-				return false;
-			}
-			
-			if (!SyncFiles(
-				inHub,
-				sourceDir,
-				inDestDirectoryPath,
-				destDir,
-				inPreviewOnly,
-				inIgnoreDates,
-				inIgnoreFinderInfo,
-				inActionCallback))
-			{
-				NOTIFY_ERROR(
-					inHub,
-					"SyncFilesAndDirectories: SyncFiles failed for source dir: ",
-					inSourceDirectoryPath);
-
-				NOTIFY_ERROR(
-					inHub,
-					"-- dest dir: ",
-					inDestDirectoryPath);
-
-				return false;
-			}
-
-			if (!SyncDirectories(
-				inHub,
-				sourceDir,
-				inDestDirectoryPath,
-				destDir,
-				inPreviewOnly,
-				inIgnoreDates,
-				inIgnoreFinderInfo,
-				inExclusions,
-				inActionCallback))
-			{
-				NOTIFY_ERROR(
-					inHub,
-					"SyncFilesAndDirectories: SyncDirectories failed for source dir: ",
-					inSourceDirectoryPath);
-
-				NOTIFY_ERROR(
-					inHub,
-					"-- dest dir: ",
-					inDestDirectoryPath);
-
-				return false;
-			}
-			
-			PathIsPackageCallbackClass sourceIsPackage;
-			PathIsPackage(inSourceDirectoryPath, sourceIsPackage);
-			if (!sourceIsPackage.mSuccess)
-			{
-				NOTIFY_ERROR(
-					inHub,
-					"SyncFilesAndDirectories: PathIsPackage failed for soure dir: ",
-					inSourceDirectoryPath);
-
-				return false;
-			}
-			
-			PathIsPackageCallbackClass destIsPackage;
-			PathIsPackage(inDestDirectoryPath, destIsPackage);
-			if (!destIsPackage.mSuccess)
-			{
-				NOTIFY_ERROR(
-					inHub,
-					"SyncFilesAndDirectories: PathIsPackage failed for dest dir: ",
-					inDestDirectoryPath);
-
-				return false;
-			}
-			
-			if (sourceIsPackage.mIsPackage != destIsPackage.mIsPackage)
-			{
-				if (!inPreviewOnly)
-				{
-					BasicCallbackClass callback;
-					SetDirectoryIsPackage(inDestDirectoryPath, sourceIsPackage.mIsPackage, callback);
-					if (!callback.mSuccess)
-					{
-						NOTIFY_ERROR(
-							inHub,
-							"SyncFilesAndDirectories: SetDirectoryIsPackage failed for dest dir: ",
-							inDestDirectoryPath);
-
-						return false;
+					if (sourceInfo.mPermissions != destInfo.mPermissions) {
+						if (!mPreviewOnly && !SetFilePosixPermissions(h_, destPath, sourceInfo.mPermissions)) {
+							NOTIFY_ERROR(h_, "SyncDirectories: SetFilePosixPermissions failed for:", destPath);
+							Report(h_, kSyncDirectoriesActionStatus_Error, destPath);
+						}
+						else {
+							Report(h_, kSyncDirectoriesActionStatus_UpdatedPosixPermissionsForItem, destPath);
+						}
 					}
-				}
-				inActionCallback.Call(kSyncDirectoriesActionStatus_UpdatedPackageStateForDirectory, inDestDirectoryPath);
-			}
-			
-			if (!SyncPosixOwnership(inSourceDirectoryPath, inDestDirectoryPath, inPreviewOnly, inActionCallback))
-			{
-					NOTIFY_ERROR(
-						inHub,
-						"SyncFilesAndDirectories: SyncPosixOwnership failed for source dir: ",
-						inSourceDirectoryPath);
-
-					NOTIFY_ERROR(
-						inHub,
-						"-- dest dir: ",
-						inDestDirectoryPath);
-
-					return false;
-			}
-
-			if (!SyncPosixPermissions(inSourceDirectoryPath, inDestDirectoryPath, inPreviewOnly, inActionCallback))
-			{
-					NOTIFY_ERROR(
-						inHub,
-						"SyncFilesAndDirectories: SyncPosixPermissions failed for source dir: ",
-						inSourceDirectoryPath);
-
-					NOTIFY_ERROR(
-						inHub,
-						"-- dest dir: ",
-						inDestDirectoryPath);
-
-					return false;
-			}
-
-			if (!inIgnoreFinderInfo)
-			{
-				if (!SyncFinderInfo(inSourceDirectoryPath, inDestDirectoryPath, inPreviewOnly, inActionCallback))
-				{
-					NOTIFY_ERROR(
-						inHub,
-						"SyncFilesAndDirectories: SyncFinderInfo failed for source dir: ",
-						inSourceDirectoryPath);
-
-					NOTIFY_ERROR(
-						inHub,
-						"-- dest dir: ",
-						inDestDirectoryPath);
-
-					return false;
-				}
-			}
-			
-			if (!inIgnoreDates)
-			{
-				if (!SyncDates(inSourceDirectoryPath, inDestDirectoryPath, inPreviewOnly, inActionCallback))
-				{
-					NOTIFY_ERROR(
-						inHub,
-						"SyncFilesAndDirectories: SyncDates failed for source dir: ",
-						inSourceDirectoryPath);
-
-					NOTIFY_ERROR(
-						inHub,
-						"-- dest dir: ",
-						inDestDirectoryPath);
-
-					return false;
-				}
-			}
-
-			return true;
-		}
-		
-		//
-		//
-		static bool SyncFiles(
-			const ConstHubPtr& inHub,
-			const Directory& inSourceDir,
-			const FilePathPtr& inDestDirPath,
-			const Directory& inDestDir,
-			const bool& inPreviewOnly,
-			const bool& inIgnoreDates,
-			const bool& inIgnoreFinderInfo,
-			const SyncDirectoriesActionCallbackRef& inActionCallback)
-		{
-			const FileSet& sourceFiles = inSourceDir.mFiles;
-			const FileSet& destFiles = inDestDir.mFiles;
-			
-			FileSet::const_iterator sourceEnd = sourceFiles.end();
-			FileSet::const_iterator destEnd = destFiles.end();
-			
-			FileSet::const_iterator sourceIt = sourceFiles.begin();
-			FileSet::const_iterator destIt = destFiles.begin();
-			
-			while (true)
-			{
-				if (sourceIt == sourceEnd)
-				{
-					while (destIt != destEnd)
-					{
-						if (!inPreviewOnly)
-						{
-							DeleteFileCallbackClass callback;
-							DeleteFile((*destIt)->mPath.P(), callback);
-							if (!callback.Success())
-							{
-								NOTIFY_ERROR(
-									inHub,
-									"SyncFiles: DeleteFile failed for dest path: ",
-									(*destIt)->mPath.P());
-
-								return false;
+					
+					// links don't carry Finder info of their own
+					if (sourceInfo.mType != FileType::kSymbolicLink) {
+						auto status = CompareFinderInfo(h_, sourcePath, destPath);
+						SyncDirectoriesActionStatus action = kSyncDirectoriesActionStatus_Unknown;
+						if (status == kCompareFinderInfoStatus_FolderPackageStatesDiffer) {
+							action = kSyncDirectoriesActionStatus_UpdatedPackageStateForDirectory;
+						}
+						else if ((status == kCompareFinderInfoStatus_FinderInfosDiffer) && (mIgnoreFinderInfo == IgnoreFinderInfo::kNo)) {
+							action = kSyncDirectoriesActionStatus_UpdatedFinderInfoForItem;
+						}
+						else if (status == kCompareFinderInfoStatus_Error) {
+							NOTIFY_ERROR(h_, "SyncDirectories: CompareFinderInfo failed for:", sourcePath, "and:", destPath);
+							action = kSyncDirectoriesActionStatus_Error;
+						}
+						if (action != kSyncDirectoriesActionStatus_Unknown) {
+							if ((action != kSyncDirectoriesActionStatus_Error) &&
+								!mPreviewOnly &&
+								!CopyFinderInfo(h_, sourcePath, destPath)) {
+								NOTIFY_ERROR(h_, "SyncDirectories: CopyFinderInfo failed for:", destPath);
+								action = kSyncDirectoriesActionStatus_Error;
 							}
+							Report(h_, action, destPath);
 						}
-						inActionCallback.Call(kSyncDirectoriesActionStatus_DeletedItem, (*destIt)->mPath.P());
-
-						++destIt;
 					}
-					break;
-				}
-				if (destIt == destEnd)
-				{
-					while (sourceIt != sourceEnd)
-					{
-						if (!CopyFileWithOverwrite(
-							inHub,
-							(*sourceIt)->mPath.P(),
-							inDestDirPath,
-							(*sourceIt)->mName,
-							inPreviewOnly,
-							inActionCallback))
-						{
-							NOTIFY_ERROR(
-								inHub,
-								"SyncFiles: CopyFileWithOverwrite failed for source path: ",
-								(*destIt)->mPath.P());
-								
-							return false;
+					
+					if (mIgnoreDates == IgnoreDates::kNo) {
+						bool datesDiffer = ((sourceInfo.mCreationDate != destInfo.mCreationDate) ||
+											(sourceInfo.mModificationDate != destInfo.mModificationDate));
+						if (datesDiffer || (contentsChanged && !mPreviewOnly)) {
+							if (!mPreviewOnly && !SetFileDates(h_, destPath, sourceInfo.mCreationDate, sourceInfo.mModificationDate)) {
+								NOTIFY_ERROR(h_, "SyncDirectories: SetFileDates failed for:", destPath);
+								Report(h_, kSyncDirectoriesActionStatus_Error, destPath);
+							}
+							else if (datesDiffer) {
+								// a date moved only by this sync's own changes isn't worth reporting
+								Report(h_, kSyncDirectoriesActionStatus_UpdatedDatesForItem, destPath);
+							}
 						}
-
-						++sourceIt;
 					}
-					break;
 				}
 				
-				if ((*sourceIt)->mName < (*destIt)->mName)
-				{
-					if (!CopyFileWithOverwrite(
-						inHub,
-						(*sourceIt)->mPath.P(),
-						inDestDirPath,
-						(*sourceIt)->mName,
-						inPreviewOnly,
-						inActionCallback))
-					{
-						NOTIFY_ERROR(
-							inHub,
-							"SyncFiles: CopyFileWithOverwrite failed for source path: ",
-							(*destIt)->mPath.P());
-								
+				//
+				bool CopyOwnership(const HermitPtr& h_, const FilePathPtr& sourcePath, const FilePathPtr& destPath) {
+					std::string userOwner;
+					std::string groupOwner;
+					if (!GetFilePosixOwnership(h_, sourcePath, userOwner, groupOwner)) {
+						NOTIFY_ERROR(h_, "SyncDirectories: GetFilePosixOwnership failed for:", sourcePath);
 						return false;
 					}
-
-					++sourceIt;
+					auto result = SetFilePosixOwnership(h_, destPath, userOwner, groupOwner);
+					if (result != SetFilePosixOwnershipResult::kSuccess) {
+						NOTIFY_ERROR(h_, "SyncDirectories: SetFilePosixOwnership failed for:", destPath);
+						return false;
+					}
+					return true;
 				}
-				else if ((*sourceIt)->mName > (*destIt)->mName)
-				{
-					if (!inPreviewOnly)
+				
+				//
+				void Dispatch(const HermitPtr& h_) {
+					std::vector<CopyJobPtr> ready;
 					{
-						DeleteFileCallbackClass callback;
-						DeleteFile((*destIt)->mPath.P(), callback);
-						if (!callback.Success())
-						{
-							NOTIFY_ERROR(
-								inHub,
-								"SyncFiles: DeleteFile failed for dest path: ",
-								(*destIt)->mPath.P());
-
-							return false;
+						std::lock_guard<std::mutex> lock(mMutex);
+						while ((mStopResult == SyncDirectoriesResult::kUnknown) &&
+							   !mPendingCopies.empty() &&
+							   (mCopiesInFlight < mQueueDepth)) {
+							ready.push_back(mPendingCopies.front());
+							mPendingCopies.pop_front();
+							++mCopiesInFlight;
+						}
+					}
+					for (auto it = begin(ready); it != end(ready); ++it) {
+						auto task = std::make_shared<CopyTask>(shared_from_this(), *it);
+						if (!QueueAsyncTask(h_, task, 10)) {
+							NOTIFY_ERROR(h_, "SyncDirectories: QueueAsyncTask failed.");
+							OnCopyDone(h_, *it, FileSystemCopyResult::kError);
 						}
 					}
-					inActionCallback.Call(kSyncDirectoriesActionStatus_DeletedItem, (*destIt)->mPath.P());
-
-					++destIt;
 				}
-				else
-				{
-					bool quickMatch = false;
-					if (!CompareFiles((*sourceIt)->mPath.P(), (*destIt)->mPath.P(), quickMatch))
-					{
-						NOTIFY_ERROR(
-							inHub,
-							"SyncFiles: CompareFiles failed for source path: ",
-							(*sourceIt)->mPath.P());
-								
-						NOTIFY_ERROR(
-							inHub,
-							"-- dest path: ",
-							(*destIt)->mPath.P());
-
-						return false;
+				
+				//
+				void Copy(const HermitPtr& h_, const CopyJobPtr& job) {
+					if (job->mReplace) {
+						auto status = DeleteFile(h_, job->mDestPath);
+						if ((status != kDeleteFileStatus_Success) && (status != kDeleteFileStatus_FileNotFound)) {
+							NOTIFY_ERROR(h_, "SyncDirectories: DeleteFile failed for:", job->mDestPath);
+							OnCopyDone(h_, job, FileSystemCopyResult::kError);
+							return;
+						}
+						SetContentsChanged(job->mParent);
 					}
-					
-					if (!quickMatch)
+					auto completion = std::make_shared<CopyCompletion>(shared_from_this(), job);
+					FileSystemCopy(h_, job->mSourcePath, job->mDestPath, shared_from_this(), completion);
+				}
+				
+				//
+				void OnCopyDone(const HermitPtr& h_, const CopyJobPtr& job, const FileSystemCopyResult& result) {
 					{
-						if (!CopyFileWithOverwrite(
-							inHub,
-							(*sourceIt)->mPath.P(),
-							inDestDirPath,
-							(*sourceIt)->mName,
-							inPreviewOnly,
-							inActionCallback))
-						{
-							NOTIFY_ERROR(
-								inHub,
-								"SyncFiles: CopyFileWithOverwrite failed for source path: ",
-								(*destIt)->mPath.P());
-								
-							return false;
+						std::lock_guard<std::mutex> lock(mMutex);
+						--mCopiesInFlight;
+						if ((result == FileSystemCopyResult::kCanceled) && (mStopResult == SyncDirectoriesResult::kUnknown)) {
+							mStopResult = SyncDirectoriesResult::kCanceled;
 						}
 					}
-
-					if (!SyncPosixOwnership((*sourceIt)->mPath.P(), (*destIt)->mPath.P(), inPreviewOnly, inActionCallback))
-					{
-							NOTIFY_ERROR(
-								inHub,
-								"SyncFiles: SyncPosixOwnership failed for source dir: ",
-								(*sourceIt)->mPath.P());
-
-							NOTIFY_ERROR(
-								inHub,
-								"-- dest dir: ",
-								(*destIt)->mPath.P());
-
-							return false;
+					if (result == FileSystemCopyResult::kSuccess) {
+						SetContentsChanged(job->mParent);
+						Report(h_, kSyncDirectoriesActionStatus_CopiedItem, job->mDestPath);
 					}
-
-					if (!SyncPosixPermissions((*sourceIt)->mPath.P(), (*destIt)->mPath.P(), inPreviewOnly, inActionCallback))
-					{
-							NOTIFY_ERROR(
-								inHub,
-								"SyncFiles: SyncPosixPermissions failed for source dir: ",
-								(*sourceIt)->mPath.P());
-
-							NOTIFY_ERROR(
-								inHub,
-								"-- dest dir: ",
-								(*destIt)->mPath.P());
-
-							return false;
+					else if ((result != FileSystemCopyResult::kCanceled) &&
+							 (result != FileSystemCopyResult::kStoppedViaUpdateCallback)) {
+						NOTIFY_ERROR(h_, "SyncDirectories: FileSystemCopy failed for:", job->mSourcePath);
+						Report(h_, kSyncDirectoriesActionStatus_Error, job->mDestPath);
 					}
-
-					if (!inIgnoreFinderInfo)
+					OnItemDone(h_, job->mParent);
+					Dispatch(h_);
+					ResumeWalk(h_);
+					FinishIfStopped(h_);
+				}
+				
+				//
+				void SetContentsChanged(const DirectoryNodePtr& node) {
+					std::lock_guard<std::mutex> lock(mMutex);
+					node->mContentsChanged = true;
+				}
+				
+				//
+				void OnItemDone(const HermitPtr& h_, const DirectoryNodePtr& node) {
+					bool contentsChanged = false;
 					{
-						if (!SyncFinderInfo((*sourceIt)->mPath.P(), (*destIt)->mPath.P(), inPreviewOnly, inActionCallback))
-						{
-							NOTIFY_ERROR(
-								inHub,
-								"SyncFiles: SyncFinderInfo failed for source dir: ",
-								(*sourceIt)->mPath.P());
-
-							NOTIFY_ERROR(
-								inHub,
-								"-- dest dir: ",
-								(*destIt)->mPath.P());
-
-							return false;
+						std::lock_guard<std::mutex> lock(mMutex);
+						if ((--node->mPendingItems > 0) || (mStopResult != SyncDirectoriesResult::kUnknown)) {
+							return;
 						}
+						contentsChanged = node->mContentsChanged;
 					}
-
-					if (!inIgnoreDates)
-					{
-						if (!SyncDates((*sourceIt)->mPath.P(), (*destIt)->mPath.P(), inPreviewOnly, inActionCallback))
-						{
-							NOTIFY_ERROR(
-								inHub,
-								"SyncFiles: SyncDates failed for source dir: ",
-								(*sourceIt)->mPath.P());
-
-							NOTIFY_ERROR(
-								inHub,
-								"-- dest dir: ",
-								(*destIt)->mPath.P());
-						
-							return false;
-						}
+					
+					// everything inside is done, so setting the dates now makes them stick
+					FixAttributes(h_, node->mSourcePath, node->mDestPath, node->mSourceInfo, node->mDestInfo, contentsChanged);
+					OnDirectoryDone(h_, node);
+				}
+				
+				//
+				void OnDirectoryDone(const HermitPtr& h_, const DirectoryNodePtr& node) {
+					if (node->mParent == nullptr) {
+						Finish(h_);
+						return;
 					}
-										
-					++sourceIt;
-					++destIt;
+					OnItemDone(h_, node->mParent);
 				}
-			}
-			return true;
-		}
-
-		//
-		//
-		static bool SyncDirectories(
-			const ConstHubPtr& inHub,
-			const Directory& inSourceDir,
-			const FilePathPtr& inDestDirPath,
-			const Directory& inDestDir,
-			const bool& inPreviewOnly,
-			const bool& inIgnoreDates,
-			const bool& inIgnoreFinderInfo,
-			const StringSet& inExclusions,
-			const SyncDirectoriesActionCallbackRef& inActionCallback)
-		{
-			const FileSet& sourceDirs = inSourceDir.mDirectories;
-			const FileSet& destDirs = inDestDir.mDirectories;
-			
-			FileSet::const_iterator sourceEnd = sourceDirs.end();
-			FileSet::const_iterator destEnd = destDirs.end();
-			
-			FileSet::const_iterator sourceIt = sourceDirs.begin();
-			FileSet::const_iterator destIt = destDirs.begin();
-
-			while (true)
-			{
-				if (sourceIt == sourceEnd)
-				{
-					while (destIt != destEnd)
+				
+				//
+				void Report(const HermitPtr& h_, const SyncDirectoriesActionStatus& status, const FilePathPtr& itemPath) {
 					{
-						if (!inPreviewOnly)
-						{
-							DeleteFileCallbackClass callback;
-							DeleteFile((*destIt)->mPath.P(), callback);
-							if (!callback.Success())
-							{
-								NOTIFY_ERROR(
-									inHub,
-									"SyncDirectories: DeleteFile failed for dest path: ",
-									(*destIt)->mPath.P());
-
-								return false;
-							}
+						std::lock_guard<std::mutex> lock(mMutex);
+						if (status == kSyncDirectoriesActionStatus_Error) {
+							mHadError = true;
+						}
+						if (mStopResult != SyncDirectoriesResult::kUnknown) {
+							return;
 						}
-						inActionCallback.Call(kSyncDirectoriesActionStatus_DeletedItem, (*destIt)->mPath.P());
-
-						++destIt;
 					}
-					break;
-				}
-				if (destIt == destEnd)
-				{
-					while (sourceIt != sourceEnd)
+					bool keepGoing = true;
 					{
-						if (!CopyFileWithOverwrite(
-							inHub,
-							(*sourceIt)->mPath.P(),
-							inDestDirPath,
-							(*sourceIt)->mName,
-							inPreviewOnly,
-							inActionCallback))
-						{
-							NOTIFY_ERROR(
-								inHub,
-								"SyncDirectories: CopyFileWithOverwrite failed for source path: ",
-								(*sourceIt)->mPath.P());
-								
-							return false;
+						std::lock_guard<std::mutex> lock(mCallbackMutex);
+						keepGoing = mActionCallback->OnAction(h_, status, itemPath);
+					}
+					if (!keepGoing) {
+						std::lock_guard<std::mutex> lock(mMutex);
+						if (mStopResult == SyncDirectoriesResult::kUnknown) {
+							mStopResult = SyncDirectoriesResult::kStoppedViaActionCallback;
 						}
-
-						++sourceIt;
 					}
-					break;
 				}
 				
-				if ((*sourceIt)->mName < (*destIt)->mName)
-				{
-					if (!CopyFileWithOverwrite(
-						inHub,
-						(*sourceIt)->mPath.P(),
-						inDestDirPath,
-						(*sourceIt)->mName,
-						inPreviewOnly,
-						inActionCallback))
+				//
+				void ResumeWalk(const HermitPtr& h_) {
 					{
-						NOTIFY_ERROR(
-							inHub,
-							"SyncDirectories: CopyFileWithOverwrite failed for source path: ",
-							(*destIt)->mPath.P());
-								
-						return false;
+						std::lock_guard<std::mutex> lock(mMutex);
+						if (mWalking ||
+							(mStopResult != SyncDirectoriesResult::kUnknown) ||
+							mDirectories.empty() ||
+							(mPendingCopies.size() >= (kMaxPendingCopies / 2))) {
+							return;
+						}
+						mWalking = true;
+					}
+					auto task = std::make_shared<WalkTask>(shared_from_this());
+					if (!QueueAsyncTask(h_, task, 10)) {
+						NOTIFY_ERROR(h_, "SyncDirectories: QueueAsyncTask failed.");
+						std::lock_guard<std::mutex> lock(mMutex);
+						mWalking = false;
+						if (mStopResult == SyncDirectoriesResult::kUnknown) {
+							mStopResult = SyncDirectoriesResult::kError;
+						}
 					}
-
-					++sourceIt;
 				}
-				else if ((*sourceIt)->mName > (*destIt)->mName)
-				{
-					if (!inPreviewOnly)
+				
+				//	Once stopped, the sync is finished when the last copy in flight and the walk
+				//	have both wound down.
+				void FinishIfStopped(const HermitPtr& h_) {
+					SyncDirectoriesResult result = SyncDirectoriesResult::kUnknown;
 					{
-						DeleteFileCallbackClass callback;
-						DeleteFile((*destIt)->mPath.P(), callback);
-						if (!callback.Success())
-						{
-							NOTIFY_ERROR(
-								inHub,
-								"SyncDirectories: DeleteFile failed for dest path: ",
-								(*destIt)->mPath.P());
-
-							return false;
+						std::lock_guard<std::mutex> lock(mMutex);
+						if (mFinished ||
+							(mStopResult == SyncDirectoriesResult::kUnknown) ||
+							(mCopiesInFlight > 0) ||
+							mWalking) {
+							return;
 						}
+						mFinished = true;
+						result = mStopResult;
 					}
-					inActionCallback.Call(kSyncDirectoriesActionStatus_DeletedItem, (*destIt)->mPath.P());
-
-					++destIt;
+					mCompletion->Call(h_, result);
 				}
-				else
-				{
-					if (!SyncFilesAndDirectories(
-						inHub,
-						(*sourceIt)->mPath.P(),
-						(*destIt)->mPath.P(),
-						inPreviewOnly,
-						inIgnoreDates,
-						inIgnoreFinderInfo,
-						inExclusions,
-						inActionCallback))
+				
+				//
+				void Finish(const HermitPtr& h_) {
+					SyncDirectoriesResult result = SyncDirectoriesResult::kSuccess;
 					{
-						NOTIFY_ERROR(
-							inHub,
-							"SyncDirectories: SyncFilesAndDirectories failed for source path: ",
-							(*sourceIt)->mPath.P());
-								
-						NOTIFY_ERROR(
-							inHub,
-							"-- dest path: ",
-							(*destIt)->mPath.P());
-
-						return false;
+						std::lock_guard<std::mutex> lock(mMutex);
+						if (mFinished) {
+							return;
+						}
+						mFinished = true;
+						if (mHadError) {
+							result = SyncDirectoriesResult::kError;
+						}
 					}
-					
-					++sourceIt;
-					++destIt;
+					mCompletion->Call(h_, result);
 				}
+				
+				//
+				const bool mPreviewOnly;
+				const uint32_t mQueueDepth;
+				const IgnoreDates mIgnoreDates;
+				const IgnoreFinderInfo mIgnoreFinderInfo;
+				SyncDirectoriesActionCallbackPtr mActionCallback;
+				SyncDirectoriesCompletionPtr mCompletion;
+				std::mutex mCallbackMutex;
+				std::mutex mMutex;
+				std::vector<DirectoryNodePtr> mDirectories;
+				std::deque<CopyJobPtr> mPendingCopies;
+				uint32_t mCopiesInFlight;
+				bool mWalking;
+				bool mHadError;
+				SyncDirectoriesResult mStopResult;
+				bool mFinished;
+			};
+			
+		} // namespace SyncDirectories_Impl
+		using namespace SyncDirectories_Impl;
+		
+		//
+		void SyncDirectories(const HermitPtr& h_,
+							 const FilePathPtr& sourcePath,
+							 const FilePathPtr& destPath,
+							 const bool& previewOnly,
+							 const SyncDirectoriesOptions& options,
+							 const SyncDirectoriesActionCallbackPtr& actionCallback,
+							 const SyncDirectoriesCompletionPtr& completion) {
+			bool sourceExists = false;
+			if (!FileExists(h_, sourcePath, sourceExists)) {
+				NOTIFY_ERROR(h_, "FileExists failed for source path:", sourcePath);
+				completion->Call(h_, SyncDirectoriesResult::kError);
+				return;
+			}
+			if (!sourceExists) {
+				NOTIFY_ERROR(h_, "Source directory doesn't exist at path:", sourcePath);
+				completion->Call(h_, SyncDirectoriesResult::kSourceNotFound);
+				return;
 			}
-
-			return true;
-		}
-	};
-
-} // private namespace
-
-//
-//
-void SyncDirectories(
-	const ConstHubPtr& inHub,
-	const FilePathPtr& inSourcePath,
-	const FilePathPtr& inDestPath,
-	const bool& inPreviewOnly,
-	const SyncDirectoriesActionCallbackRef& inActionCallback,
-	const BasicCallbackRef& inCallback)
-{
-	//	??? if source is case-sensitive and dest is not... here be dragons
-	//	??? posix permissions?
-	
-	StringSet exclusions;
-	exclusions.insert(".DS_Store");
-
-	if (!SyncFilesAndDirectoriesClass::SyncFilesAndDirectories(
-		inHub,
-		inSourcePath,
-		inDestPath,
-		inPreviewOnly,
-		false,
-		false,
-		exclusions,
-		inActionCallback))
-	{
-		NOTIFY_ERROR(
-			inHub,
-			"SyncDirectories: SyncFilesAndDirectories failed for source dir: ",
-			inSourcePath);
-
-		NOTIFY_ERROR(
-			inHub,
-			"-- dest dir: ",
-			inDestPath);
 			
-		inCallback.Call(false);
-		return;
-	}
-
-	//	??? are there cases which require multiple passes? link1 -> link2 but link2 isn't synced yet?
-	if (!SyncLinksClass::SyncDirectoryLinks(
-		inHub,
-		inSourcePath,
-		inDestPath,
-		inPreviewOnly,
-		false,
-		exclusions,
-		inActionCallback))
-	{
-		NOTIFY_ERROR(
-			inHub,
-			"SyncDirectories: SyncDirectoryLinks failed for source dir: ",
-			inSourcePath);
-
-		NOTIFY_ERROR(
-			inHub,
-			"-- dest dir: ",
-			inDestPath);
-				
-		inCallback.Call(false);
-		return;
-	}
+			DirectoryItemInfo sourceInfo;
+			if (!GetDirectoryItemInfo(h_, sourcePath, sourceInfo)) {
+				NOTIFY_ERROR(h_, "GetDirectoryItemInfo failed for source path:", sourcePath);
+				completion->Call(h_, SyncDirectoriesResult::kError);
+				return;
+			}
+			DirectoryItemInfo destInfo;
+			if (!GetDirectoryItemInfo(h_, destPath, destInfo)) {
+				NOTIFY_ERROR(h_, "GetDirectoryItemInfo failed for dest path:", destPath);
+				completion->Call(h_, SyncDirectoriesResult::kError);
+				return;
+			}
+			if ((sourceInfo.mType != FileType::kDirectory) || (destInfo.mType != FileType::kDirectory)) {
+				NOTIFY_ERROR(h_, "SyncDirectories: not a directory, source path:", sourcePath, "dest path:", destPath);
+				completion->Call(h_, SyncDirectoriesResult::kError);
+				return;
+			}
+			
+			auto syncer = std::make_shared<Syncer>(previewOnly, options, actionCallback, completion);
+			syncer->Start(h_, sourcePath, destPath, sourceInfo, destInfo);
+		}
 		
-	inCallback.Call(true);
-}
-	
-} // namespace file
+	} // namespace file
 } // namespace hermit
-
-#endif
-
@@ -19,7 +19,10 @@
 #ifndef SyncDirectories_h
 #define SyncDirectories_h
 
-#include "Hermit/Foundation/Callback.h"
+#include <cstdint>
+#include <memory>
+#include "Hermit/Foundation/AsyncFunction.h"
+#include "CompareFiles.h"
 #include "FilePath.h"
 
 namespace hermit {
@@ -39,17 +42,68 @@ namespace hermit {
 		};
 		
 		//
-		DEFINE_CALLBACK_2A(SyncDirectoriesActionCallback,
-						   SyncDirectoriesActionStatus,			// inStatus
-						   FilePathPtr);						// inItemPath
+		class SyncDirectoriesActionCallback {
+		public:
+			//
+			virtual ~SyncDirectoriesActionCallback() = default;
+			
+			//	Called once per action, with the dest path it applies to, after the action is done
+			//	or, in preview mode, instead of doing it. Never called from two threads at once.
+			//	Return false to stop the sync.
+			virtual bool OnAction(const HermitPtr& h_,
+								  const SyncDirectoriesActionStatus& status,
+								  const FilePathPtr& itemPath) = 0;
+		};
+		typedef std::shared_ptr<SyncDirectoriesActionCallback> SyncDirectoriesActionCallbackPtr;
+		
+		//
+		enum class SyncDirectoriesResult {
+			kUnknown,
+			kSuccess,
+			kCanceled,
+			kStoppedViaActionCallback,
+			kSourceNotFound,
+			kError
+		};
 		
 		//
-		bool SyncDirectories(const FilePathPtr& inSourcePath,
-							 const FilePathPtr& inDestPath,
-							 const bool& inPreviewOnly,
-							 const SyncDirectoriesActionCallbackRef& inActionCallback);
+		DEFINE_ASYNC_FUNCTION_2A(SyncDirectoriesCompletion,
+								 HermitPtr,
+								 SyncDirectoriesResult);
+		
+		//
+		struct SyncDirectoriesOptions {
+			//
+			SyncDirectoriesOptions() :
+			mQueueDepth(1),
+			mIgnoreDates(IgnoreDates::kNo),
+			mIgnoreFinderInfo(IgnoreFinderInfo::kNo) {
+			}
+			
+			//	How many copies may run at once. Each directory pair is listed once and planned
+			//	by a single walk; the items to copy are handed to the thread pool, and the
+			//	attributes of a directory are fixed after everything inside it is done.
+			uint32_t mQueueDepth;
+			
+			//
+			IgnoreDates mIgnoreDates;
+			IgnoreFinderInfo mIgnoreFinderInfo;
+		};
+		
+		//	Makes the contents of destPath match sourcePath: items only in the dest are deleted,
+		//	items only in the source or whose data may differ are copied, and the ownership,
+		//	permissions, Finder info and dates of the rest are brought into line. A file is taken
+		//	to match when its size and dates do. With previewOnly, the actions are reported but
+		//	nothing on disk is changed.
+		void SyncDirectories(const HermitPtr& h_,
+							 const FilePathPtr& sourcePath,
+							 const FilePathPtr& destPath,
+							 const bool& previewOnly,
+							 const SyncDirectoriesOptions& options,
+							 const SyncDirectoriesActionCallbackPtr& actionCallback,
+							 const SyncDirectoriesCompletionPtr& completion);
 		
 	} // namespace file
 } // namespace hermit
 
-#endif 
+#endif
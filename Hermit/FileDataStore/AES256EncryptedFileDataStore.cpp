@@ -23,7 +23,8 @@ namespace hermit {
 
 		//
 		AES256EncryptedFileDataStore::AES256EncryptedFileDataStore(const std::string& inAESKey) :
-			mAESKey(inAESKey) {
+			mAESKey(inAESKey),
+			mCompressionCodec(encoding::CompressionCodec::kLZ4) {
 		}
 				
 	} // namespace filedatastore
@@ -20,6 +20,7 @@
 #define AES256EncryptedFileDataStore_h
 
 #include <string>
+#include "Hermit/Encoding/CompressionReceiver.h"
 #include "FileDataStore.h"
 
 namespace hermit {
@@ -47,6 +48,9 @@ namespace hermit {
 
             //
 			std::string mAESKey;
+			
+			//	Codec for items written encrypted; kNone leaves them uncompressed. Items load either way.
+			encoding::CompressionCodec mCompressionCodec;
 		};
 		typedef std::shared_ptr<AES256EncryptedFileDataStore> AES256EncryptedFileDataStorePtr;
 
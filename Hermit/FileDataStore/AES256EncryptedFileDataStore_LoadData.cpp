@@ -19,6 +19,8 @@
 #include <string>
 #include "Hermit/DataStore/DataPath.h"
 #include "Hermit/Encoding/AES256DecryptCBC.h"
+#include "Hermit/Encoding/AES256GCMItem.h"
+#include "Hermit/Encoding/CompressedItem.h"
 #include "Hermit/Foundation/Notification.h"
 #include "AES256EncryptedFileDataStore.h"
 
@@ -65,6 +67,18 @@ namespace hermit {
 						return;
 					}
 					
+					DataBuffer item(mData->mData.data(), mData->mData.size());
+					if (encoding::IsAES256GCMItem(item)) {
+						std::string plainText;
+						if (!encoding::AES256DecryptGCMItem(h_, item, mAESKey, plainText)) {
+							NOTIFY_ERROR(h_, "LoadAES256EncryptedFileDataStoreData: AES256DecryptGCMItem failed for item at path:", mPath);
+							mCompletion->Call(h_, datastore::LoadDataStoreDataResult::kError);
+							return;
+						}
+						DeliverPlainText(h_, DataBuffer(plainText.data(), plainText.size()));
+						return;
+					}
+					
 					if (mData->mData.size() < 16) {
 						NOTIFY_ERROR(h_, "LoadAES256EncryptedFileDataStoreData: dataSize < 16 for item at path:", mPath);
 						mCompletion->Call(h_, datastore::LoadDataStoreDataResult::kError);
@@ -78,14 +92,30 @@ namespace hermit {
 					p += 16;
 					size -= 16;
 					
-					encoding::AES256DecryptCBCCallbackClass callback;
-					encoding::AES256DecryptCBC(h_, DataBuffer(p, size), mAESKey, inputVector, callback);
-					if (!callback.mSuccess) {
+					std::string plainText(size, 0);
+					uint64_t plainTextSize = 0;
+					if (!encoding::AES256DecryptCBCIntoBuffer(h_, DataBuffer(p, size), mAESKey, inputVector, &plainText[0], plainTextSize)) {
 						NOTIFY_ERROR(h_, "LoadAES256EncryptedFileDataStoreData: AES256DecryptCBC failed for item at path:", mPath);
 						mCompletion->Call(h_, datastore::LoadDataStoreDataResult::kError);
 						return;
 					}
-					mDataBlock->Call(h_, DataBuffer(callback.mData.data(), callback.mData.size()));
+					DeliverPlainText(h_, DataBuffer(plainText.data(), (size_t)plainTextSize));
+				}
+				
+				//	Items may be compressed inside the encryption; older ones never are.
+				void DeliverPlainText(const HermitPtr& h_, const DataBuffer& plainText) {
+					if (encoding::IsCompressedItem(plainText)) {
+						std::string data;
+						if (!encoding::DecompressItem(h_, plainText, data)) {
+							NOTIFY_ERROR(h_, "LoadAES256EncryptedFileDataStoreData: DecompressItem failed for item at path:", mPath);
+							mCompletion->Call(h_, datastore::LoadDataStoreDataResult::kError);
+							return;
+						}
+						mDataBlock->Call(h_, DataBuffer(data.data(), data.size()));
+						mCompletion->Call(h_, datastore::LoadDataStoreDataResult::kSuccess);
+						return;
+					}
+					mDataBlock->Call(h_, plainText);
 					mCompletion->Call(h_, datastore::LoadDataStoreDataResult::kSuccess);
 				}
 
@@ -16,7 +16,11 @@
 //    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#include <memory.h>
+#include <stdlib.h>
 #include "Hermit/Encoding/AES256EncryptCBC.h"
+#include "Hermit/Encoding/AES256GCMItem.h"
+#include "Hermit/Encoding/CompressedItem.h"
 #include "Hermit/Encoding/CreateInputVector.h"
 #include "Hermit/Foundation/Notification.h"
 #include "AES256EncryptedFileDataStore.h"
@@ -35,9 +39,44 @@ namespace hermit {
 				return;
 			}
 			
-			std::string encryptedFileData;
 			if (encryptionSetting == datastore::EncryptionSetting::kUnencrypted) {
-				encryptedFileData.assign(data->Data(), data->Size());
+				FileDataStore::WriteData(h_,
+										 path,
+										 data,
+										 encryptionSetting,
+										 completion);
+				return;
+			}
+			
+			//	Compress ahead of the encryption, which leaves nothing to compress.
+			DataBuffer plainText(data->Data(), data->Size());
+			std::string compressedItem;
+			if (!encoding::CompressItem(h_, plainText, mCompressionCodec, compressedItem)) {
+				NOTIFY_ERROR(h_, "CompressItem failed.");
+				completion->Call(h_, datastore::WriteDataStoreDataResult::kError);
+				return;
+			}
+			if (!compressedItem.empty()) {
+				plainText = DataBuffer(compressedItem.data(), compressedItem.size());
+			}
+			
+			//	Encrypt straight into the buffer that gets written, which takes it over.
+			uint64_t encryptedFileDataSize = 0;
+			char* encryptedFileData = nullptr;
+			if (encryptionSetting == datastore::EncryptionSetting::kAES256GCM) {
+				encryptedFileDataSize = encoding::AES256GCMItemSize(plainText.second);
+				encryptedFileData = (char*)malloc(encryptedFileDataSize);
+				if (encryptedFileData == nullptr) {
+					NOTIFY_ERROR(h_, "malloc failed for size:", encryptedFileDataSize);
+					completion->Call(h_, datastore::WriteDataStoreDataResult::kError);
+					return;
+				}
+				if (!encoding::AES256EncryptGCMItemInto(h_, plainText, mAESKey, encryptedFileData)) {
+					free(encryptedFileData);
+					NOTIFY_ERROR(h_, "AES256EncryptGCMItemInto failed.");
+					completion->Call(h_, datastore::WriteDataStoreDataResult::kError);
+					return;
+				}
 			}
 			else {
 				std::string inputVector;
@@ -47,28 +86,32 @@ namespace hermit {
 					return;
 				}
 				
-				encoding::AES256EncryptCBCCallbackClass dataCallback;
-				encoding::AES256EncryptCBC(h_,
-										   DataBuffer(data->Data(), data->Size()),
-										   mAESKey,
-										   inputVector,
-										   dataCallback);
-				
-				if (dataCallback.mStatus == encoding::kAES256EncryptCBC_Canceled) {
-					completion->Call(h_, datastore::WriteDataStoreDataResult::kCanceled);
+				encryptedFileDataSize = inputVector.size() + encoding::AES256EncryptCBCSize(plainText.second);
+				encryptedFileData = (char*)malloc(encryptedFileDataSize);
+				if (encryptedFileData == nullptr) {
+					NOTIFY_ERROR(h_, "malloc failed for size:", encryptedFileDataSize);
+					completion->Call(h_, datastore::WriteDataStoreDataResult::kError);
 					return;
 				}
-				if (dataCallback.mStatus != encoding::kAES256EncryptCBC_Success) {
-					NOTIFY_ERROR(h_, "AES256EncryptCBC failed.");
+				memcpy(encryptedFileData, inputVector.data(), inputVector.size());
+				auto status = encoding::AES256EncryptCBCInto(h_,
+															 plainText,
+															 mAESKey,
+															 inputVector,
+															 encryptedFileData + inputVector.size());
+				if (status != encoding::kAES256EncryptCBC_Success) {
+					free(encryptedFileData);
+					if (status == encoding::kAES256EncryptCBC_Canceled) {
+						completion->Call(h_, datastore::WriteDataStoreDataResult::kCanceled);
+						return;
+					}
+					NOTIFY_ERROR(h_, "AES256EncryptCBCInto failed.");
 					completion->Call(h_, datastore::WriteDataStoreDataResult::kError);
 					return;
 				}
-				
-				encryptedFileData = inputVector;
-				encryptedFileData += dataCallback.mValue;
 			}
 			
-			SharedBufferPtr buffer = std::make_shared<SharedBuffer>(encryptedFileData);
+			SharedBufferPtr buffer = std::make_shared<SharedBuffer>(encryptedFileData, encryptedFileDataSize, true);
 			FileDataStore::WriteData(h_,
 									 path,
 									 buffer,
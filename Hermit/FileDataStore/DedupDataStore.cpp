@@ -0,0 +1,303 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+#include <cstring>
+#include "Hermit/Encoding/SHA256.h"
+#include "Hermit/Foundation/Notification.h"
+#include "Hermit/String/BinaryStringToHex.h"
+#include "DedupDataStore.h"
+
+namespace hermit {
+	namespace filedatastore {
+		namespace DedupDataStore_Impl {
+			
+			//
+			const char kManifestMagic[] = "HrmtDdp";
+			const size_t kManifestMagicSize = 7;
+			const uint8_t kManifestVersion = 1;
+			const size_t kManifestHeaderSize = 17;
+			const size_t kManifestChunkEntrySize = 36;
+			
+			//
+			enum ManifestKind : uint8_t {
+				kManifestKind_Chunked = 0,
+				kManifestKind_Inline = 1
+			};
+			
+			//	The gear table fixes where chunk boundaries fall, so it must never change: it's
+			//	generated by splitmix64 from a fixed seed.
+			struct GearTable {
+				//
+				GearTable() {
+					uint64_t x = 0x48726d7444647570ULL;
+					for (int i = 0; i < 256; ++i) {
+						x += 0x9e3779b97f4a7c15ULL;
+						uint64_t z = x;
+						z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+						z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+						mValues[i] = z ^ (z >> 31);
+					}
+				}
+				
+				//
+				uint64_t mValues[256];
+			};
+			
+			//
+			const GearTable& GetGearTable() {
+				static const GearTable sGearTable;
+				return sGearTable;
+			}
+			
+			//	The top bits of the gear hash depend on the most recent 64 bytes, so the masks
+			//	select from those.
+			uint64_t TopBitsMask(int bits) {
+				return ~0ULL << (64 - bits);
+			}
+			
+			//
+			void PutLE(std::string& out, uint64_t value, int bytes) {
+				for (int i = 0; i < bytes; ++i) {
+					out.push_back((char)((value >> (8 * i)) & 0xff));
+				}
+			}
+			
+			//
+			uint64_t GetLE(const char* p, int bytes) {
+				uint64_t value = 0;
+				for (int i = 0; i < bytes; ++i) {
+					value |= ((uint64_t)(uint8_t)p[i]) << (8 * i);
+				}
+				return value;
+			}
+			
+		} // namespace DedupDataStore_Impl
+		using namespace DedupDataStore_Impl;
+		
+		//
+		void FindDedupChunkBoundaries(const DataBuffer& data,
+									  const DedupDataStoreOptions& options,
+									  std::vector<size_t>& outChunkEnds) {
+			size_t minSize = std::max<size_t>(options.mMinChunkSize, 64);
+			int averageBits = 6;
+			while (((size_t)1 << (averageBits + 1)) <= options.mAverageChunkSize) {
+				++averageBits;
+			}
+			size_t averageSize = std::max(minSize, (size_t)1 << averageBits);
+			size_t maxSize = std::max(averageSize, options.mMaxChunkSize);
+			
+			//	normalized chunking: a harder test before the average size and an easier one
+			//	after it pull chunk sizes in towards the average
+			uint64_t maskS = TopBitsMask(averageBits + 1);
+			uint64_t maskL = TopBitsMask(averageBits - 1);
+			const uint64_t* gear = GetGearTable().mValues;
+			
+			outChunkEnds.clear();
+			const uint8_t* base = (const uint8_t*)data.first;
+			size_t offset = 0;
+			while (offset < data.second) {
+				const uint8_t* p = base + offset;
+				size_t remaining = data.second - offset;
+				size_t cut = remaining;
+				if (remaining > minSize) {
+					size_t limit = std::min(remaining, maxSize);
+					size_t normal = std::min(averageSize, limit);
+					cut = limit;
+					uint64_t fingerprint = 0;
+					size_t i = minSize;
+					for (; i < normal; ++i) {
+						fingerprint = (fingerprint << 1) + gear[p[i]];
+						if ((fingerprint & maskS) == 0) {
+							cut = i + 1;
+							break;
+						}
+					}
+					if (i == normal) {
+						for (; i < limit; ++i) {
+							fingerprint = (fingerprint << 1) + gear[p[i]];
+							if ((fingerprint & maskL) == 0) {
+								cut = i + 1;
+								break;
+							}
+						}
+					}
+				}
+				offset += cut;
+				outChunkEnds.push_back(offset);
+			}
+		}
+		
+		//
+		bool IsDedupManifest(const DataBuffer& data) {
+			return (data.second >= kManifestHeaderSize) && (memcmp(data.first, kManifestMagic, kManifestMagicSize) == 0);
+		}
+		
+		//
+		void EncodeDedupManifest(const DedupManifest& manifest, std::string& outData) {
+			outData.assign(kManifestMagic, kManifestMagicSize);
+			outData.push_back((char)kManifestVersion);
+			outData.push_back((char)(manifest.mInline ? kManifestKind_Inline : kManifestKind_Chunked));
+			PutLE(outData, manifest.mSize, 8);
+			if (manifest.mInline) {
+				outData.append(manifest.mInlineData);
+				return;
+			}
+			outData.reserve(outData.size() + 4 + (manifest.mChunks.size() * kManifestChunkEntrySize));
+			PutLE(outData, manifest.mChunks.size(), 4);
+			for (auto& chunk : manifest.mChunks) {
+				outData.append(chunk.mHash);
+				PutLE(outData, chunk.mSize, 4);
+			}
+		}
+		
+		//
+		bool DecodeDedupManifest(const DataBuffer& data, DedupManifest& outManifest) {
+			if (!IsDedupManifest(data) || ((uint8_t)data.first[kManifestMagicSize] != kManifestVersion)) {
+				return false;
+			}
+			uint8_t kind = (uint8_t)data.first[kManifestMagicSize + 1];
+			uint64_t size = GetLE(data.first + kManifestMagicSize + 2, 8);
+			const char* p = data.first + kManifestHeaderSize;
+			size_t remaining = data.second - kManifestHeaderSize;
+			
+			DedupManifest manifest;
+			manifest.mSize = size;
+			if (kind == kManifestKind_Inline) {
+				if (remaining != size) {
+					return false;
+				}
+				manifest.mInline = true;
+				manifest.mInlineData.assign(p, remaining);
+			}
+			else if (kind == kManifestKind_Chunked) {
+				if (remaining < 4) {
+					return false;
+				}
+				uint64_t count = GetLE(p, 4);
+				p += 4;
+				remaining -= 4;
+				if (remaining != (count * kManifestChunkEntrySize)) {
+					return false;
+				}
+				uint64_t total = 0;
+				manifest.mChunks.resize((size_t)count);
+				for (auto& chunk : manifest.mChunks) {
+					chunk.mHash.assign(p, 32);
+					chunk.mSize = (uint32_t)GetLE(p + 32, 4);
+					total += chunk.mSize;
+					p += kManifestChunkEntrySize;
+				}
+				if (total != size) {
+					return false;
+				}
+			}
+			else {
+				return false;
+			}
+			outManifest = std::move(manifest);
+			return true;
+		}
+		
+		//
+		DedupDataStore::DedupDataStore(const datastore::DataStorePtr& dataStore, const DedupDataStoreOptions& options) :
+		mDataStore(dataStore),
+		mOptions(options),
+		mItemsWritten(0),
+		mBytesWritten(0),
+		mChunksWritten(0),
+		mChunksUploaded(0),
+		mBytesUploaded(0),
+		mChunksInIndex(0),
+		mChunksInStore(0),
+		mChunksRepeated(0),
+		mItemsLoaded(0),
+		mChunksLoaded(0) {
+			if (mOptions.mMaxConcurrency == 0) {
+				mOptions.mMaxConcurrency = 1;
+			}
+			if (mOptions.mExistenceCheckBatchSize == 0) {
+				mOptions.mExistenceCheckBatchSize = 1;
+			}
+		}
+		
+		//
+		DedupDataStoreMetrics DedupDataStore::GetMetrics() {
+			DedupDataStoreMetrics metrics;
+			metrics.mItemsWritten = mItemsWritten;
+			metrics.mBytesWritten = mBytesWritten;
+			metrics.mChunksWritten = mChunksWritten;
+			metrics.mChunksUploaded = mChunksUploaded;
+			metrics.mBytesUploaded = mBytesUploaded;
+			metrics.mChunksInIndex = mChunksInIndex;
+			metrics.mChunksInStore = mChunksInStore;
+			metrics.mChunksRepeated = mChunksRepeated;
+			metrics.mItemsLoaded = mItemsLoaded;
+			metrics.mChunksLoaded = mChunksLoaded;
+			return metrics;
+		}
+		
+		//
+		bool DedupDataStore::GetChunkPath(const HermitPtr& h_, const std::string& hash, datastore::DataPathPtr& outPath) {
+			std::string name;
+			if (mOptions.mChunkNameSalt.empty()) {
+				string::BinaryStringToHex(hash, name);
+			}
+			else {
+				std::string salted(mOptions.mChunkNameSalt);
+				salted.append(hash);
+				char saltedHash[32];
+				encoding::CalculateSHA256(salted.data(), salted.size(), saltedHash);
+				string::BinaryStringToHex(std::string(saltedHash, 32), name);
+			}
+			datastore::DataPathPtr directoryPath;
+			if (!mOptions.mChunkRoot->AppendPathComponent(h_, name.substr(0, 2), directoryPath)) {
+				NOTIFY_ERROR(h_, "DedupDataStore: AppendPathComponent failed for chunk directory.");
+				return false;
+			}
+			if (!directoryPath->AppendPathComponent(h_, name, outPath)) {
+				NOTIFY_ERROR(h_, "DedupDataStore: AppendPathComponent failed for chunk.");
+				return false;
+			}
+			return true;
+		}
+		
+		//
+		void DedupDataStore::ListItems(const HermitPtr& h_,
+									   const datastore::DataPathPtr& rootPath,
+									   const datastore::ListDataStoreItemsItemCallbackPtr& itemCallback,
+									   const datastore::ListDataStoreItemsCompletionPtr& completion) {
+			mDataStore->ListItems(h_, rootPath, itemCallback, completion);
+		}
+		
+		//
+		void DedupDataStore::ItemExists(const HermitPtr& h_,
+										const datastore::DataPathPtr& itemPath,
+										const datastore::ItemExistsInDataStoreCompletionPtr& completion) {
+			mDataStore->ItemExists(h_, itemPath, completion);
+		}
+		
+		//
+		void DedupDataStore::DeleteItem(const HermitPtr& h_,
+										const datastore::DataPathPtr& path,
+										const datastore::DeleteDataStoreItemCompletionPtr& completion) {
+			mDataStore->DeleteItem(h_, path, completion);
+		}
+		
+	} // namespace filedatastore
+} // namespace hermit
@@ -0,0 +1,242 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef DedupDataStore_h
+#define DedupDataStore_h
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Hermit/DataStore/DataStore.h"
+#include "PackFileDataStore.h"
+
+namespace hermit {
+	namespace filedatastore {
+		
+		//
+		const size_t kDefaultDedupMinChunkSize = 16 * 1024;
+		const size_t kDefaultDedupAverageChunkSize = 64 * 1024;
+		const size_t kDefaultDedupMaxChunkSize = 256 * 1024;
+		const size_t kDefaultDedupInlineSize = 4 * 1024;
+		
+		//
+		struct DedupDataStoreOptions {
+			//
+			DedupDataStoreOptions() :
+			mMinChunkSize(kDefaultDedupMinChunkSize),
+			mAverageChunkSize(kDefaultDedupAverageChunkSize),
+			mMaxChunkSize(kDefaultDedupMaxChunkSize),
+			mInlineSize(kDefaultDedupInlineSize),
+			mTrustChunkIndex(false),
+			mMaxConcurrency(datastore::kDefaultDataStoreBatchConcurrency),
+			mExistenceCheckBatchSize(64) {
+			}
+			
+			//	Chunk size bounds. The average is rounded down to a power of two. Changing any
+			//	of them moves the chunk boundaries, so data written before stops deduplicating
+			//	against data written after (though it all still loads).
+			size_t mMinChunkSize;
+			size_t mAverageChunkSize;
+			size_t mMaxChunkSize;
+			
+			//	Items up to this size are kept inside their manifest rather than chunked.
+			size_t mInlineSize;
+			
+			//	Where chunks are kept in the wrapped store. Keep it outside the paths items are
+			//	written to and listed under.
+			datastore::DataPathPtr mChunkRoot;
+			
+			//	Optional local record of the chunks known to be in the wrapped store, so they
+			//	needn't be asked about. It has to be kept for that store alone, and it goes stale
+			//	if chunks are removed from the store by other means.
+			PackFileDataStorePtr mChunkIndex;
+			
+			//	With a chunk index, upload the chunks it doesn't have without first asking the
+			//	wrapped store; right when this is the only writer and the index is never lost.
+			bool mTrustChunkIndex;
+			
+			//	When set, chunk names are the SHA-256 of this salt and the chunk's hash rather
+			//	than the chunk's hash itself, so someone who can list the wrapped store can't
+			//	tell whether it holds a given piece of data.
+			std::string mChunkNameSalt;
+			
+			//	Chunk uploads, downloads and existence checks kept in flight per item.
+			size_t mMaxConcurrency;
+			
+			//	Chunks asked about in one ItemsExist call.
+			size_t mExistenceCheckBatchSize;
+		};
+		
+		//
+		struct DedupDataStoreMetrics {
+			//
+			DedupDataStoreMetrics() :
+			mItemsWritten(0),
+			mBytesWritten(0),
+			mChunksWritten(0),
+			mChunksUploaded(0),
+			mBytesUploaded(0),
+			mChunksInIndex(0),
+			mChunksInStore(0),
+			mChunksRepeated(0),
+			mItemsLoaded(0),
+			mChunksLoaded(0) {
+			}
+			
+			//	Items and bytes passed to WriteData, and the chunks they were split into.
+			uint64_t mItemsWritten;
+			uint64_t mBytesWritten;
+			uint64_t mChunksWritten;
+			
+			//	Chunks that had to be uploaded.
+			uint64_t mChunksUploaded;
+			uint64_t mBytesUploaded;
+			
+			//	Chunks that didn't: found in the chunk index, found in the wrapped store, or
+			//	repeated within the same item.
+			uint64_t mChunksInIndex;
+			uint64_t mChunksInStore;
+			uint64_t mChunksRepeated;
+			
+			//
+			uint64_t mItemsLoaded;
+			uint64_t mChunksLoaded;
+		};
+		
+		//	A manifest, stored at an item's path in place of its data:
+		//		"HrmtDdp" | version (1 byte) | kind (1 byte) | size (8 bytes, little-endian) | ...
+		//	followed, for a chunked item, by a chunk count (4 bytes) and each chunk's SHA-256
+		//	(32 bytes) and size (4 bytes), or for an inline item, by its data.
+		struct DedupManifestChunk {
+			//
+			std::string mHash;
+			uint32_t mSize;
+		};
+		
+		//
+		struct DedupManifest {
+			//
+			DedupManifest() : mSize(0), mInline(false) {
+			}
+			
+			//
+			uint64_t mSize;
+			bool mInline;
+			std::vector<DedupManifestChunk> mChunks;
+			std::string mInlineData;
+		};
+		
+		//	Splits data with FastCDC (gear-hash content-defined chunking with normalized
+		//	chunk sizes), giving the end offset of each chunk.
+		void FindDedupChunkBoundaries(const DataBuffer& data,
+									  const DedupDataStoreOptions& options,
+									  std::vector<size_t>& outChunkEnds);
+		
+		//
+		bool IsDedupManifest(const DataBuffer& data);
+		
+		//
+		void EncodeDedupManifest(const DedupManifest& manifest, std::string& outData);
+		
+		//
+		bool DecodeDedupManifest(const DataBuffer& data, DedupManifest& outManifest);
+		
+		//
+		class DedupWrite;
+		class DedupLoad;
+		
+		//	Wraps another DataStore and stores each item as a manifest at its path plus
+		//	content-defined chunks, named by their SHA-256, under options.mChunkRoot, so an
+		//	item that changes a little between writes only uploads the chunks that changed,
+		//	and chunks shared between items are stored once. While an item is hashed on the
+		//	thread pool, the chunks hashed so far are checked for (the chunk index first, then
+		//	the wrapped store, in batches) and the missing ones uploaded; the manifest is
+		//	written last, so a failed write leaves the previous version in place. Loads
+		//	fetch the chunks concurrently and check each against its hash. Items that don't
+		//	decode as manifests, written before the store was wrapped, load as they are.
+		//	Deleting an item deletes its manifest only, since chunks may be shared;
+		//	unreferenced chunks are left for a separate sweep. Create it with make_shared
+		//	(see WithDedupDataStore).
+		class DedupDataStore : public datastore::DataStore, public std::enable_shared_from_this<DedupDataStore> {
+		public:
+			//
+			DedupDataStore(const datastore::DataStorePtr& dataStore, const DedupDataStoreOptions& options);
+			
+			//
+			DedupDataStoreMetrics GetMetrics();
+			
+			//
+			virtual void ListItems(const HermitPtr& h_,
+								   const datastore::DataPathPtr& rootPath,
+								   const datastore::ListDataStoreItemsItemCallbackPtr& itemCallback,
+								   const datastore::ListDataStoreItemsCompletionPtr& completion) override;
+			
+			//
+			virtual void ItemExists(const HermitPtr& h_,
+									const datastore::DataPathPtr& itemPath,
+									const datastore::ItemExistsInDataStoreCompletionPtr& completion) override;
+			
+			//
+			virtual void LoadData(const HermitPtr& h_,
+								  const datastore::DataPathPtr& path,
+								  const datastore::EncryptionSetting& encryptionSetting,
+								  const datastore::LoadDataStoreDataDataBlockPtr& dataBlock,
+								  const datastore::LoadDataStoreDataCompletionBlockPtr& completion) override;
+			
+			//
+			virtual void WriteData(const HermitPtr& h_,
+								   const datastore::DataPathPtr& path,
+								   const SharedBufferPtr& data,
+								   const datastore::EncryptionSetting& encryptionSetting,
+								   const datastore::WriteDataStoreDataCompletionFunctionPtr& completion) override;
+			
+			//
+			virtual void DeleteItem(const HermitPtr& h_,
+									const datastore::DataPathPtr& path,
+									const datastore::DeleteDataStoreItemCompletionPtr& completion) override;
+			
+		private:
+			//
+			friend class DedupWrite;
+			friend class DedupLoad;
+			
+			//	Chunks are spread over 256 directories by the first byte of their name.
+			bool GetChunkPath(const HermitPtr& h_, const std::string& hash, datastore::DataPathPtr& outPath);
+			
+			//
+			datastore::DataStorePtr mDataStore;
+			DedupDataStoreOptions mOptions;
+			std::atomic<uint64_t> mItemsWritten;
+			std::atomic<uint64_t> mBytesWritten;
+			std::atomic<uint64_t> mChunksWritten;
+			std::atomic<uint64_t> mChunksUploaded;
+			std::atomic<uint64_t> mBytesUploaded;
+			std::atomic<uint64_t> mChunksInIndex;
+			std::atomic<uint64_t> mChunksInStore;
+			std::atomic<uint64_t> mChunksRepeated;
+			std::atomic<uint64_t> mItemsLoaded;
+			std::atomic<uint64_t> mChunksLoaded;
+		};
+		typedef std::shared_ptr<DedupDataStore> DedupDataStorePtr;
+		
+	} // namespace filedatastore
+} // namespace hermit
+
+#endif
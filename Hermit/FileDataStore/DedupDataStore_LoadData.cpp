@@ -0,0 +1,259 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include "Hermit/Encoding/SHA256.h"
+#include "Hermit/Foundation/Notification.h"
+#include "DedupDataStore.h"
+
+namespace hermit {
+	namespace filedatastore {
+		
+		//	Loads an item's manifest, then its chunks, each fetched once however often it
+		//	appears, checked against its hash and copied to each place it belongs.
+		class DedupLoad : public std::enable_shared_from_this<DedupLoad> {
+		public:
+			//
+			DedupLoad(const DedupDataStorePtr& store,
+					  const datastore::DataPathPtr& path,
+					  const datastore::EncryptionSetting& encryptionSetting,
+					  const datastore::LoadDataStoreDataDataBlockPtr& dataBlock,
+					  const datastore::LoadDataStoreDataCompletionBlockPtr& completion) :
+			mStore(store),
+			mPath(path),
+			mEncryptionSetting(encryptionSetting),
+			mDataBlock(dataBlock),
+			mCompletion(completion),
+			mResult(datastore::LoadDataStoreDataResult::kSuccess) {
+			}
+			
+			//
+			class ManifestCompletion : public datastore::LoadDataStoreDataCompletionBlock {
+			public:
+				//
+				ManifestCompletion(const std::shared_ptr<DedupLoad>& load, const datastore::LoadDataStoreDataDataPtr& data) :
+				mLoad(load),
+				mData(data) {
+				}
+				
+				//
+				virtual void Call(const HermitPtr& h_, const datastore::LoadDataStoreDataResult& result) override {
+					mLoad->ManifestLoaded(h_, result, mData->mData);
+				}
+				
+				//
+				std::shared_ptr<DedupLoad> mLoad;
+				datastore::LoadDataStoreDataDataPtr mData;
+			};
+			
+			//
+			class ChunkCallback : public datastore::LoadDataStoreItemsItemCallback {
+			public:
+				//
+				ChunkCallback(const std::shared_ptr<DedupLoad>& load) : mLoad(load) {
+				}
+				
+				//
+				virtual void Call(const HermitPtr& h_,
+								  const datastore::DataPathPtr& path,
+								  const datastore::LoadDataStoreDataResult& result,
+								  const DataBuffer& data) override {
+					mLoad->ChunkLoaded(h_, path, result, data);
+				}
+				
+				//
+				std::shared_ptr<DedupLoad> mLoad;
+			};
+			
+			//
+			class ChunksCompletion : public datastore::DataStoreBatchCompletion {
+			public:
+				//
+				ChunksCompletion(const std::shared_ptr<DedupLoad>& load) : mLoad(load) {
+				}
+				
+				//
+				virtual void Call(const HermitPtr& h_, const datastore::DataStoreBatchResult& result) override {
+					mLoad->ChunksLoaded(h_, result);
+				}
+				
+				//
+				std::shared_ptr<DedupLoad> mLoad;
+			};
+			
+			//
+			void Start(const HermitPtr& h_) {
+				auto data = std::make_shared<datastore::LoadDataStoreDataData>();
+				auto completion = std::make_shared<ManifestCompletion>(shared_from_this(), data);
+				mStore->mDataStore->LoadData(h_, mPath, mEncryptionSetting, data, completion);
+			}
+			
+			//
+			void ManifestLoaded(const HermitPtr& h_, const datastore::LoadDataStoreDataResult& result, const std::string& data) {
+				if (result != datastore::LoadDataStoreDataResult::kSuccess) {
+					mCompletion->Call(h_, result);
+					return;
+				}
+				DataBuffer buffer(data.data(), data.size());
+				DedupManifest manifest;
+				if (!IsDedupManifest(buffer) || !DecodeDedupManifest(buffer, manifest)) {
+					//	written before the store was wrapped, and possibly starting with the
+					//	manifest magic by chance
+					mStore->mItemsLoaded++;
+					mDataBlock->Call(h_, buffer);
+					mCompletion->Call(h_, datastore::LoadDataStoreDataResult::kSuccess);
+					return;
+				}
+				if (manifest.mInline) {
+					mStore->mItemsLoaded++;
+					mDataBlock->Call(h_, DataBuffer(manifest.mInlineData.data(), manifest.mInlineData.size()));
+					mCompletion->Call(h_, datastore::LoadDataStoreDataResult::kSuccess);
+					return;
+				}
+				
+				datastore::DataPathVector paths;
+				uint64_t offset = 0;
+				for (auto& chunk : manifest.mChunks) {
+					datastore::DataPathPtr path;
+					if (!mStore->GetChunkPath(h_, chunk.mHash, path)) {
+						mCompletion->Call(h_, datastore::LoadDataStoreDataResult::kError);
+						return;
+					}
+					std::string pathString;
+					path->GetStringRepresentation(h_, pathString);
+					auto it = mChunks.find(pathString);
+					if (it == mChunks.end()) {
+						it = mChunks.insert(std::make_pair(pathString, ChunkPlacement())).first;
+						it->second.mHash = chunk.mHash;
+						it->second.mSize = chunk.mSize;
+						paths.push_back(path);
+					}
+					it->second.mOffsets.push_back((size_t)offset);
+					offset += chunk.mSize;
+				}
+				mData.resize((size_t)manifest.mSize);
+				
+				datastore::DataStoreBatchOptions batchOptions;
+				batchOptions.mMaxConcurrency = mStore->mOptions.mMaxConcurrency;
+				mStore->mDataStore->LoadItems(h_,
+											  paths,
+											  mEncryptionSetting,
+											  batchOptions,
+											  std::make_shared<ChunkCallback>(shared_from_this()),
+											  std::make_shared<ChunksCompletion>(shared_from_this()));
+			}
+			
+			//	Calls are never concurrent, but they aren't all on the same thread.
+			void ChunkLoaded(const HermitPtr& h_,
+							 const datastore::DataPathPtr& path,
+							 const datastore::LoadDataStoreDataResult& result,
+							 const DataBuffer& data) {
+				std::lock_guard<std::mutex> lock(mMutex);
+				if (result != datastore::LoadDataStoreDataResult::kSuccess) {
+					if (result == datastore::LoadDataStoreDataResult::kCanceled) {
+						mResult = result;
+					}
+					else if (mResult != datastore::LoadDataStoreDataResult::kCanceled) {
+						NOTIFY_ERROR(h_, "DedupDataStore: couldn't load chunk:", path);
+						mResult = datastore::LoadDataStoreDataResult::kError;
+					}
+					return;
+				}
+				std::string pathString;
+				path->GetStringRepresentation(h_, pathString);
+				auto it = mChunks.find(pathString);
+				if (it == mChunks.end()) {
+					NOTIFY_ERROR(h_, "DedupDataStore: unexpected path from LoadItems:", path);
+					mResult = datastore::LoadDataStoreDataResult::kError;
+					return;
+				}
+				auto& placement = it->second;
+				char hash[32];
+				if ((data.second == placement.mSize) && (data.second > 0)) {
+					encoding::CalculateSHA256(data.first, data.second, hash);
+				}
+				if ((data.second != placement.mSize) || (data.second == 0) || (placement.mHash.compare(0, 32, hash, 32) != 0)) {
+					NOTIFY_ERROR(h_, "DedupDataStore: chunk doesn't match its hash:", path);
+					mResult = datastore::LoadDataStoreDataResult::kError;
+					return;
+				}
+				for (auto offset : placement.mOffsets) {
+					memcpy(&mData[offset], data.first, data.second);
+				}
+				mStore->mChunksLoaded++;
+			}
+			
+			//
+			void ChunksLoaded(const HermitPtr& h_, const datastore::DataStoreBatchResult& result) {
+				auto loadResult = datastore::LoadDataStoreDataResult::kSuccess;
+				{
+					std::lock_guard<std::mutex> lock(mMutex);
+					loadResult = mResult;
+				}
+				if ((loadResult == datastore::LoadDataStoreDataResult::kSuccess) && (result != datastore::DataStoreBatchResult::kSuccess)) {
+					loadResult = (result == datastore::DataStoreBatchResult::kCanceled) ?
+						datastore::LoadDataStoreDataResult::kCanceled :
+						datastore::LoadDataStoreDataResult::kError;
+				}
+				if (loadResult != datastore::LoadDataStoreDataResult::kSuccess) {
+					mCompletion->Call(h_, loadResult);
+					return;
+				}
+				mStore->mItemsLoaded++;
+				mDataBlock->Call(h_, DataBuffer(mData.data(), mData.size()));
+				mCompletion->Call(h_, datastore::LoadDataStoreDataResult::kSuccess);
+			}
+			
+			//
+			struct ChunkPlacement {
+				//
+				std::string mHash;
+				uint32_t mSize;
+				std::vector<size_t> mOffsets;
+			};
+			
+			//
+			DedupDataStorePtr mStore;
+			datastore::DataPathPtr mPath;
+			datastore::EncryptionSetting mEncryptionSetting;
+			datastore::LoadDataStoreDataDataBlockPtr mDataBlock;
+			datastore::LoadDataStoreDataCompletionBlockPtr mCompletion;
+			std::unordered_map<std::string, ChunkPlacement> mChunks;
+			std::string mData;
+			std::mutex mMutex;
+			datastore::LoadDataStoreDataResult mResult;
+		};
+		
+		//
+		void DedupDataStore::LoadData(const HermitPtr& h_,
+									  const datastore::DataPathPtr& path,
+									  const datastore::EncryptionSetting& encryptionSetting,
+									  const datastore::LoadDataStoreDataDataBlockPtr& dataBlock,
+									  const datastore::LoadDataStoreDataCompletionBlockPtr& completion) {
+			if (CHECK_FOR_ABORT(h_)) {
+				completion->Call(h_, datastore::LoadDataStoreDataResult::kCanceled);
+				return;
+			}
+			auto load = std::make_shared<DedupLoad>(shared_from_this(), path, encryptionSetting, dataBlock, completion);
+			load->Start(h_);
+		}
+		
+	} // namespace filedatastore
+} // namespace hermit
@@ -0,0 +1,545 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include "Hermit/Encoding/SHA256.h"
+#include "Hermit/Foundation/AsyncTaskQueue.h"
+#include "Hermit/Foundation/Notification.h"
+#include "Hermit/String/BinaryStringToHex.h"
+#include "DedupDataStore.h"
+
+namespace hermit {
+	namespace filedatastore {
+		namespace DedupDataStore_WriteData_Impl {
+			
+			//	Chunks hashed together by CalculateSHA256Multi.
+			const size_t kHashGroupSize = 8;
+			
+			//
+			struct Chunk {
+				//
+				size_t mOffset;
+				uint32_t mSize;
+				char mHash[32];
+				std::string mKey;
+			};
+			
+		} // namespace DedupDataStore_WriteData_Impl
+		using namespace DedupDataStore_WriteData_Impl;
+		
+		//	Hash tasks on the thread pool hash groups of chunks and hand them over; the pump
+		//	takes them from there, through the chunk index, batched existence checks and
+		//	uploads, keeping each stage going while the others run, and writes the manifest
+		//	once every chunk is accounted for.
+		class DedupWrite : public std::enable_shared_from_this<DedupWrite> {
+		public:
+			//
+			DedupWrite(const DedupDataStorePtr& store,
+					   const datastore::DataPathPtr& path,
+					   const SharedBufferPtr& data,
+					   const datastore::EncryptionSetting& encryptionSetting,
+					   const datastore::WriteDataStoreDataCompletionFunctionPtr& completion) :
+			mStore(store),
+			mPath(path),
+			mData(data),
+			mEncryptionSetting(encryptionSetting),
+			mCompletion(completion),
+			mNextGroup(0),
+			mGroupCount(0),
+			mHashTasksRunning(0),
+			mCheckInFlight(false),
+			mUploadsInFlight(0),
+			mPumping(false),
+			mStopped(false),
+			mCanceled(false),
+			mHadError(false),
+			mFinished(false) {
+			}
+			
+			//
+			class HashTask : public AsyncTask {
+			public:
+				//
+				HashTask(const std::shared_ptr<DedupWrite>& write) : mWrite(write) {
+				}
+				
+				//
+				virtual void PerformTask(const HermitPtr& h_) override {
+					mWrite->HashGroups(h_);
+				}
+				
+				//
+				std::shared_ptr<DedupWrite> mWrite;
+			};
+			
+			//
+			class ExistsCallback : public datastore::DataStoreItemsExistItemCallback {
+			public:
+				//
+				ExistsCallback(const std::shared_ptr<DedupWrite>& write) : mWrite(write) {
+				}
+				
+				//
+				virtual void Call(const HermitPtr& h_,
+								  const datastore::DataPathPtr& path,
+								  const datastore::ItemExistsInDataStoreResult& result,
+								  const bool& exists) override {
+					mWrite->ChunkChecked(h_, path, result, exists);
+				}
+				
+				//
+				std::shared_ptr<DedupWrite> mWrite;
+			};
+			
+			//
+			class ExistsCompletion : public datastore::DataStoreBatchCompletion {
+			public:
+				//
+				ExistsCompletion(const std::shared_ptr<DedupWrite>& write) : mWrite(write) {
+				}
+				
+				//
+				virtual void Call(const HermitPtr& h_, const datastore::DataStoreBatchResult& result) override {
+					mWrite->CheckDone(h_, result);
+				}
+				
+				//
+				std::shared_ptr<DedupWrite> mWrite;
+			};
+			
+			//
+			class UploadCompletion : public datastore::WriteDataStoreDataCompletionFunction {
+			public:
+				//
+				UploadCompletion(const std::shared_ptr<DedupWrite>& write, size_t index) : mWrite(write), mIndex(index) {
+				}
+				
+				//
+				virtual void Call(const HermitPtr& h_, const datastore::WriteDataStoreDataResult& result) override {
+					mWrite->ChunkUploaded(h_, mIndex, result);
+				}
+				
+				//
+				std::shared_ptr<DedupWrite> mWrite;
+				size_t mIndex;
+			};
+			
+			//
+			class ManifestCompletion : public datastore::WriteDataStoreDataCompletionFunction {
+			public:
+				//
+				ManifestCompletion(const std::shared_ptr<DedupWrite>& write) : mWrite(write) {
+				}
+				
+				//
+				virtual void Call(const HermitPtr& h_, const datastore::WriteDataStoreDataResult& result) override {
+					mWrite->ManifestWritten(h_, result);
+				}
+				
+				//
+				std::shared_ptr<DedupWrite> mWrite;
+			};
+			
+			//
+			void Start(const HermitPtr& h_) {
+				auto& options = mStore->mOptions;
+				DataBuffer data(mData->Data(), mData->Size());
+				mStore->mBytesWritten += data.second;
+				if (data.second <= options.mInlineSize) {
+					DedupManifest manifest;
+					manifest.mSize = data.second;
+					manifest.mInline = true;
+					manifest.mInlineData.assign(data.first, data.second);
+					WriteManifest(h_, manifest);
+					return;
+				}
+				if (options.mChunkRoot == nullptr) {
+					NOTIFY_ERROR(h_, "DedupDataStore: no chunk root.");
+					mCompletion->Call(h_, datastore::WriteDataStoreDataResult::kError);
+					return;
+				}
+				
+				std::vector<size_t> ends;
+				FindDedupChunkBoundaries(data, options, ends);
+				mChunks.resize(ends.size());
+				size_t offset = 0;
+				for (size_t n = 0; n < ends.size(); ++n) {
+					mChunks[n].mOffset = offset;
+					mChunks[n].mSize = (uint32_t)(ends[n] - offset);
+					offset = ends[n];
+				}
+				mStore->mChunksWritten += mChunks.size();
+				mGroupCount = (mChunks.size() + kHashGroupSize - 1) / kHashGroupSize;
+				
+				static const size_t sCoreCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+				size_t taskCount = std::min(sCoreCount, mGroupCount);
+				mHashTasksRunning = taskCount;
+				for (size_t n = 0; n < taskCount; ++n) {
+					auto task = std::make_shared<HashTask>(shared_from_this());
+					if (!QueueAsyncTask(h_, task, 10)) {
+						NOTIFY_ERROR(h_, "DedupDataStore: QueueAsyncTask failed.");
+						std::lock_guard<std::mutex> lock(mMutex);
+						mStopped = true;
+						mHadError = true;
+						mHashTasksRunning -= (taskCount - n);
+						break;
+					}
+				}
+				Pump(h_);
+			}
+			
+			//
+			void HashGroups(const HermitPtr& h_) {
+				while (true) {
+					size_t group = 0;
+					{
+						std::lock_guard<std::mutex> lock(mMutex);
+						if (mStopped || (mNextGroup == mGroupCount)) {
+							--mHashTasksRunning;
+							break;
+						}
+						group = mNextGroup++;
+					}
+					
+					size_t first = group * kHashGroupSize;
+					size_t count = std::min(kHashGroupSize, mChunks.size() - first);
+					const char* data[kHashGroupSize];
+					uint64_t sizes[kHashGroupSize];
+					void* hashes[kHashGroupSize];
+					for (size_t n = 0; n < count; ++n) {
+						auto& chunk = mChunks[first + n];
+						data[n] = mData->Data() + chunk.mOffset;
+						sizes[n] = chunk.mSize;
+						hashes[n] = chunk.mHash;
+					}
+					encoding::CalculateSHA256Multi(data, sizes, count, hashes);
+					for (size_t n = 0; n < count; ++n) {
+						auto& chunk = mChunks[first + n];
+						string::BinaryStringToHex(std::string(chunk.mHash, 32), chunk.mKey);
+					}
+					
+					{
+						std::lock_guard<std::mutex> lock(mMutex);
+						for (size_t n = 0; n < count; ++n) {
+							mHashed.push_back(first + n);
+						}
+					}
+					Pump(h_);
+				}
+				Pump(h_);
+			}
+			
+			//	Called with mMutex held.
+			void SortHashedChunks(const HermitPtr& h_) {
+				auto& options = mStore->mOptions;
+				for (auto index : mHashed) {
+					auto& chunk = mChunks[index];
+					if (!mSeen.insert(chunk.mKey).second) {
+						mStore->mChunksRepeated++;
+						continue;
+					}
+					if (options.mChunkIndex != nullptr) {
+						bool exists = false;
+						if (options.mChunkIndex->HasItem(h_, chunk.mKey, exists) != PackFileResult::kSuccess) {
+							NOTIFY_ERROR(h_, "DedupDataStore: chunk index lookup failed.");
+							exists = false;
+						}
+						if (exists) {
+							mStore->mChunksInIndex++;
+							continue;
+						}
+						if (options.mTrustChunkIndex) {
+							mToUpload.push_back(index);
+							continue;
+						}
+					}
+					mToCheck.push_back(index);
+				}
+				mHashed.clear();
+			}
+			
+			//
+			void Pump(const HermitPtr& h_) {
+				{
+					std::lock_guard<std::mutex> lock(mMutex);
+					if (mPumping) {
+						return;
+					}
+					mPumping = true;
+				}
+				
+				auto& options = mStore->mOptions;
+				bool finished = false;
+				while (true) {
+					std::vector<size_t> toCheck;
+					std::vector<size_t> toUpload;
+					{
+						std::lock_guard<std::mutex> lock(mMutex);
+						if (!mStopped && CHECK_FOR_ABORT(h_)) {
+							mCanceled = true;
+							mStopped = true;
+						}
+						if (!mStopped) {
+							SortHashedChunks(h_);
+							bool hashingDone = (mHashTasksRunning == 0);
+							if (!mCheckInFlight &&
+								((mToCheck.size() >= options.mExistenceCheckBatchSize) || (hashingDone && !mToCheck.empty()))) {
+								size_t count = std::min(mToCheck.size(), options.mExistenceCheckBatchSize);
+								toCheck.assign(mToCheck.begin(), mToCheck.begin() + count);
+								mToCheck.erase(mToCheck.begin(), mToCheck.begin() + count);
+								mCheckInFlight = true;
+							}
+							while ((mUploadsInFlight < options.mMaxConcurrency) && !mToUpload.empty()) {
+								toUpload.push_back(mToUpload.front());
+								mToUpload.pop_front();
+								++mUploadsInFlight;
+							}
+						}
+						if (toCheck.empty() && toUpload.empty()) {
+							mPumping = false;
+							bool idle = (mHashTasksRunning == 0) && !mCheckInFlight && (mUploadsInFlight == 0);
+							bool done = mStopped || (mHashed.empty() && mToCheck.empty() && mToUpload.empty());
+							if (!mFinished && idle && done) {
+								mFinished = true;
+								finished = true;
+							}
+							break;
+						}
+					}
+					
+					if (!toCheck.empty()) {
+						StartCheck(h_, toCheck);
+					}
+					for (auto index : toUpload) {
+						StartUpload(h_, index);
+					}
+				}
+				
+				if (finished) {
+					if (mCanceled) {
+						mCompletion->Call(h_, datastore::WriteDataStoreDataResult::kCanceled);
+						return;
+					}
+					if (mHadError) {
+						mCompletion->Call(h_, datastore::WriteDataStoreDataResult::kError);
+						return;
+					}
+					DedupManifest manifest;
+					manifest.mSize = mData->Size();
+					manifest.mChunks.resize(mChunks.size());
+					for (size_t n = 0; n < mChunks.size(); ++n) {
+						manifest.mChunks[n].mHash.assign(mChunks[n].mHash, 32);
+						manifest.mChunks[n].mSize = mChunks[n].mSize;
+					}
+					WriteManifest(h_, manifest);
+				}
+			}
+			
+			//
+			void StartCheck(const HermitPtr& h_, const std::vector<size_t>& chunks) {
+				datastore::DataPathVector paths;
+				{
+					std::lock_guard<std::mutex> lock(mMutex);
+					for (auto index : chunks) {
+						datastore::DataPathPtr path;
+						if (!mStore->GetChunkPath(h_, std::string(mChunks[index].mHash, 32), path)) {
+							mStopped = true;
+							mHadError = true;
+							break;
+						}
+						std::string pathString;
+						path->GetStringRepresentation(h_, pathString);
+						mCheckPaths[pathString] = index;
+						paths.push_back(path);
+					}
+					if (mStopped) {
+						mCheckPaths.clear();
+						mCheckInFlight = false;
+						paths.clear();
+					}
+				}
+				if (paths.empty()) {
+					Pump(h_);
+					return;
+				}
+				datastore::DataStoreBatchOptions batchOptions;
+				batchOptions.mMaxConcurrency = mStore->mOptions.mMaxConcurrency;
+				mStore->mDataStore->ItemsExist(h_,
+											   paths,
+											   batchOptions,
+											   std::make_shared<ExistsCallback>(shared_from_this()),
+											   std::make_shared<ExistsCompletion>(shared_from_this()));
+			}
+			
+			//
+			void ChunkChecked(const HermitPtr& h_,
+							  const datastore::DataPathPtr& path,
+							  const datastore::ItemExistsInDataStoreResult& result,
+							  const bool& exists) {
+				std::string pathString;
+				path->GetStringRepresentation(h_, pathString);
+				
+				std::lock_guard<std::mutex> lock(mMutex);
+				auto it = mCheckPaths.find(pathString);
+				if (it == mCheckPaths.end()) {
+					NOTIFY_ERROR(h_, "DedupDataStore: unexpected path from ItemsExist:", path);
+					return;
+				}
+				size_t index = it->second;
+				mCheckPaths.erase(it);
+				if (result != datastore::ItemExistsInDataStoreResult::kSuccess) {
+					if (result != datastore::ItemExistsInDataStoreResult::kCanceled) {
+						NOTIFY_ERROR(h_, "DedupDataStore: ItemsExist failed for chunk:", path);
+					}
+					return;
+				}
+				if (exists) {
+					mStore->mChunksInStore++;
+					RecordChunk(h_, index);
+					return;
+				}
+				mToUpload.push_back(index);
+			}
+			
+			//
+			void CheckDone(const HermitPtr& h_, const datastore::DataStoreBatchResult& result) {
+				{
+					std::lock_guard<std::mutex> lock(mMutex);
+					mCheckInFlight = false;
+					mCheckPaths.clear();
+					if (result == datastore::DataStoreBatchResult::kCanceled) {
+						mStopped = true;
+						mCanceled = true;
+					}
+					else if (result != datastore::DataStoreBatchResult::kSuccess) {
+						mStopped = true;
+						mHadError = true;
+					}
+				}
+				Pump(h_);
+			}
+			
+			//
+			void StartUpload(const HermitPtr& h_, size_t index) {
+				auto& chunk = mChunks[index];
+				datastore::DataPathPtr path;
+				if (!mStore->GetChunkPath(h_, std::string(chunk.mHash, 32), path)) {
+					ChunkUploaded(h_, index, datastore::WriteDataStoreDataResult::kError);
+					return;
+				}
+				auto buffer = std::make_shared<SharedBuffer>(mData->Data() + chunk.mOffset, chunk.mSize);
+				auto completion = std::make_shared<UploadCompletion>(shared_from_this(), index);
+				mStore->mDataStore->WriteData(h_, path, buffer, mEncryptionSetting, completion);
+			}
+			
+			//
+			void ChunkUploaded(const HermitPtr& h_, size_t index, const datastore::WriteDataStoreDataResult& result) {
+				{
+					std::lock_guard<std::mutex> lock(mMutex);
+					--mUploadsInFlight;
+					if (result == datastore::WriteDataStoreDataResult::kSuccess) {
+						mStore->mChunksUploaded++;
+						mStore->mBytesUploaded += mChunks[index].mSize;
+						RecordChunk(h_, index);
+					}
+					else {
+						if (result != datastore::WriteDataStoreDataResult::kCanceled) {
+							NOTIFY_ERROR(h_, "DedupDataStore: chunk upload failed, result:", (int)result);
+						}
+						mStopped = true;
+						if (result == datastore::WriteDataStoreDataResult::kCanceled) {
+							mCanceled = true;
+						}
+						else {
+							mHadError = true;
+						}
+					}
+				}
+				Pump(h_);
+			}
+			
+			//	Called with mMutex held.
+			void RecordChunk(const HermitPtr& h_, size_t index) {
+				auto& chunkIndex = mStore->mOptions.mChunkIndex;
+				if ((chunkIndex != nullptr) && (chunkIndex->PutItem(h_, mChunks[index].mKey, DataBuffer("", 0)) != PackFileResult::kSuccess)) {
+					NOTIFY_ERROR(h_, "DedupDataStore: chunk index update failed.");
+				}
+			}
+			
+			//
+			void WriteManifest(const HermitPtr& h_, const DedupManifest& manifest) {
+				std::string manifestData;
+				EncodeDedupManifest(manifest, manifestData);
+				auto buffer = std::make_shared<SharedBuffer>(manifestData);
+				mStore->mDataStore->WriteData(h_, mPath, buffer, mEncryptionSetting, std::make_shared<ManifestCompletion>(shared_from_this()));
+			}
+			
+			//
+			void ManifestWritten(const HermitPtr& h_, const datastore::WriteDataStoreDataResult& result) {
+				if (result == datastore::WriteDataStoreDataResult::kSuccess) {
+					mStore->mItemsWritten++;
+				}
+				mCompletion->Call(h_, result);
+			}
+			
+			//
+			DedupDataStorePtr mStore;
+			datastore::DataPathPtr mPath;
+			SharedBufferPtr mData;
+			datastore::EncryptionSetting mEncryptionSetting;
+			datastore::WriteDataStoreDataCompletionFunctionPtr mCompletion;
+			std::vector<Chunk> mChunks;
+			std::mutex mMutex;
+			size_t mNextGroup;
+			size_t mGroupCount;
+			size_t mHashTasksRunning;
+			std::vector<size_t> mHashed;
+			std::unordered_set<std::string> mSeen;
+			std::deque<size_t> mToCheck;
+			std::unordered_map<std::string, size_t> mCheckPaths;
+			bool mCheckInFlight;
+			std::deque<size_t> mToUpload;
+			size_t mUploadsInFlight;
+			bool mPumping;
+			bool mStopped;
+			bool mCanceled;
+			bool mHadError;
+			bool mFinished;
+		};
+		
+		//
+		void DedupDataStore::WriteData(const HermitPtr& h_,
+									   const datastore::DataPathPtr& path,
+									   const SharedBufferPtr& data,
+									   const datastore::EncryptionSetting& encryptionSetting,
+									   const datastore::WriteDataStoreDataCompletionFunctionPtr& completion) {
+			if (CHECK_FOR_ABORT(h_)) {
+				completion->Call(h_, datastore::WriteDataStoreDataResult::kCanceled);
+				return;
+			}
+			auto write = std::make_shared<DedupWrite>(shared_from_this(), path, data, encryptionSetting, completion);
+			write->Start(h_);
+		}
+		
+	} // namespace filedatastore
+} // namespace hermit
@@ -0,0 +1,1063 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <set>
+#include "Hermit/Encoding/CRC32.h"
+#include "Hermit/File/CreateDirectoryParentChain.h"
+#include "Hermit/File/FileSyncBarrier.h"
+#include "Hermit/File/GetFilePathUTF8String.h"
+#include "Hermit/Foundation/AsyncTaskQueue.h"
+#include "Hermit/Foundation/Notification.h"
+#include "PackFileDataStore.h"
+
+namespace hermit {
+	namespace filedatastore {
+		
+		//	One segment file. The descriptor stays open until the last reference goes, so a
+		//	read can finish even if compaction deletes the file meanwhile.
+		class PackFileSegment {
+		public:
+			//
+			PackFileSegment(uint32_t number, const std::string& path, int fileDescriptor, uint64_t size) :
+			mNumber(number),
+			mPath(path),
+			mFileDescriptor(fileDescriptor),
+			mSize(size),
+			mLiveBytes(0),
+			mDirty(false),
+			mCompactionFailed(false) {
+			}
+			
+			//
+			~PackFileSegment() {
+				::close(mFileDescriptor);
+			}
+			
+			//
+			uint32_t mNumber;
+			std::string mPath;
+			int mFileDescriptor;
+			uint64_t mSize;
+			uint64_t mLiveBytes;
+			bool mDirty;
+			bool mCompactionFailed;
+		};
+		
+		//	mHash is 0 for a slot that was never used and 1 for one whose item was deleted;
+		//	HashKey never returns either.
+		struct PackFileIndexSlot {
+			uint64_t mHash;
+			uint64_t mRecordOffset;
+			uint64_t mDataLength;
+			uint32_t mSegment;
+			uint32_t mKeyLength;
+		};
+		
+		//
+		class PackFileCompactionTask : public AsyncTask {
+		public:
+			//
+			PackFileCompactionTask(const PackFileDataStorePtr& store) : mStore(store) {
+			}
+			
+			//
+			virtual void PerformTask(const HermitPtr& h_) override {
+				mStore->CompactSegments(h_);
+			}
+			
+			//
+			PackFileDataStorePtr mStore;
+		};
+		
+		namespace PackFileDataStore_Impl {
+			
+			//
+			const char kIndexMagic[8] = { 'H', 'P', 'A', 'C', 'K', 'I', 'D', 'X' };
+			const uint32_t kIndexVersion = 1;
+			const uint64_t kIndexHeaderSize = 4096;
+			const uint64_t kInitialIndexCapacity = 64 * 1024;
+			const uint64_t kEmptySlot = 0;
+			const uint64_t kDeletedSlot = 1;
+			
+			//
+			const uint32_t kRecordMagic = 0x4b504852;
+			const uint32_t kPutRecord = 0;
+			const uint32_t kTombstoneRecord = 1;
+			
+			//	Records up to this size are assembled and written with one call.
+			const uint64_t kSingleWriteLimit = 64 * 1024;
+			
+			//
+			struct IndexHeader {
+				char mMagic[8];
+				uint32_t mVersion;
+				uint32_t mClean;
+				uint64_t mCapacity;
+				uint64_t mLiveCount;
+				uint64_t mUsedSlots;
+				uint32_t mActiveSegment;
+				uint32_t mReserved;
+			};
+			
+			//	Followed by the key, then the data. The CRC covers both.
+			struct RecordHeader {
+				uint32_t mMagic;
+				uint32_t mType;
+				uint32_t mKeyLength;
+				uint32_t mCRC32;
+				uint64_t mDataLength;
+			};
+			static_assert(sizeof(RecordHeader) == 24, "RecordHeader must be packed");
+			static_assert(sizeof(PackFileIndexSlot) == 32, "PackFileIndexSlot must be packed");
+			
+			//	FNV-1a, which, unlike std::hash, is the same on every platform and release.
+			uint64_t HashKey(const std::string& key) {
+				uint64_t hash = 0xcbf29ce484222325ULL;
+				for (auto c : key) {
+					hash ^= (unsigned char)c;
+					hash *= 0x100000001b3ULL;
+				}
+				if (hash <= kDeletedSlot) {
+					hash += 2;
+				}
+				return hash;
+			}
+			
+			//
+			uint64_t RecordSize(uint64_t keyLength, uint64_t dataLength) {
+				return sizeof(RecordHeader) + keyLength + dataLength;
+			}
+			
+			//
+			uint32_t RecordCRC32(const char* key, size_t keyLength, const char* data, uint64_t dataLength) {
+				uint32_t crc = encoding::UpdateCRC32(0xffffffff, key, keyLength);
+				return encoding::UpdateCRC32(crc, data, dataLength) ^ 0xffffffff;
+			}
+			
+			//
+			IndexHeader& Header(char* indexMap) {
+				return *reinterpret_cast<IndexHeader*>(indexMap);
+			}
+			
+			//
+			PackFileIndexSlot* Slots(char* indexMap) {
+				return reinterpret_cast<PackFileIndexSlot*>(indexMap + kIndexHeaderSize);
+			}
+			
+			//	Returns 0 or an errno.
+			int WriteFully(int fileDescriptor, const char* data, uint64_t size, uint64_t offset) {
+				while (size > 0) {
+					ssize_t written = ::pwrite(fileDescriptor, data, (size_t)size, (off_t)offset);
+					if (written < 0) {
+						if (errno == EINTR) {
+							continue;
+						}
+						return errno;
+					}
+					data += written;
+					size -= written;
+					offset += written;
+				}
+				return 0;
+			}
+			
+			//	Returns 0, an errno, or -1 if the file ends first.
+			int ReadFully(int fileDescriptor, char* data, uint64_t size, uint64_t offset) {
+				while (size > 0) {
+					ssize_t bytesRead = ::pread(fileDescriptor, data, (size_t)size, (off_t)offset);
+					if (bytesRead < 0) {
+						if (errno == EINTR) {
+							continue;
+						}
+						return errno;
+					}
+					if (bytesRead == 0) {
+						return -1;
+					}
+					data += bytesRead;
+					size -= bytesRead;
+					offset += bytesRead;
+				}
+				return 0;
+			}
+			
+			//	Reads and checks the record at offset, leaving its key and data in outRecord.
+			//	Returns false if it's torn or corrupt.
+			bool ReadRecord(int fileDescriptor,
+							uint64_t fileSize,
+							uint64_t offset,
+							RecordHeader& outHeader,
+							std::string& outRecord) {
+				if ((fileSize < offset) || (fileSize - offset < sizeof(RecordHeader))) {
+					return false;
+				}
+				if (ReadFully(fileDescriptor, (char*)&outHeader, sizeof(RecordHeader), offset) != 0) {
+					return false;
+				}
+				if ((outHeader.mMagic != kRecordMagic) ||
+					((outHeader.mType != kPutRecord) && (outHeader.mType != kTombstoneRecord)) ||
+					(RecordSize(outHeader.mKeyLength, outHeader.mDataLength) > fileSize - offset)) {
+					return false;
+				}
+				outRecord.resize(outHeader.mKeyLength + outHeader.mDataLength);
+				if (ReadFully(fileDescriptor, &outRecord[0], outRecord.size(), offset + sizeof(RecordHeader)) != 0) {
+					return false;
+				}
+				auto crc = RecordCRC32(outRecord.data(),
+									   outHeader.mKeyLength,
+									   outRecord.data() + outHeader.mKeyLength,
+									   outHeader.mDataLength);
+				return (crc == outHeader.mCRC32);
+			}
+			
+			//
+			std::string SegmentFileName(uint32_t number) {
+				char name[32];
+				snprintf(name, sizeof(name), "segment-%08u.pack", number);
+				return name;
+			}
+			
+			//
+			bool ParseSegmentFileName(const char* name, uint32_t& outNumber) {
+				unsigned int number = 0;
+				char suffix[8] = { 0 };
+				if ((sscanf(name, "segment-%8u.%5s", &number, suffix) != 2) || (strcmp(suffix, "pack") != 0)) {
+					return false;
+				}
+				if (SegmentFileName(number) != name) {
+					return false;
+				}
+				outNumber = number;
+				return true;
+			}
+			
+			//
+			bool SyncDirectory(const std::string& path) {
+				int fileDescriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+				if (fileDescriptor == -1) {
+					return false;
+				}
+				bool success = (::fsync(fileDescriptor) == 0);
+				::close(fileDescriptor);
+				return success;
+			}
+			
+		} // namespace PackFileDataStore_Impl
+		using namespace PackFileDataStore_Impl;
+		
+		//
+		PackFileDataStore::PackFileDataStore(const file::FilePathPtr& directoryPath, const PackFileDataStoreOptions& options) :
+		mDirectoryPath(directoryPath),
+		mOptions(options),
+		mOpen(false),
+		mIndexFile(-1),
+		mIndexMap(nullptr),
+		mIndexMapSize(0),
+		mCompacting(false) {
+		}
+		
+		//
+		PackFileDataStore::~PackFileDataStore() {
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (mOpen) {
+				HermitPtr h_;
+				if (SyncLocked(h_)) {
+					Header(mIndexMap).mClean = 1;
+					::msync(mIndexMap, kIndexHeaderSize, MS_SYNC);
+				}
+			}
+			UnmapIndex();
+		}
+		
+		//
+		bool PackFileDataStore::Open(const HermitPtr& h_) {
+			file::GetFilePathUTF8String(h_, mDirectoryPath, mDirectoryPathUTF8);
+			if (mDirectoryPathUTF8.empty()) {
+				NOTIFY_ERROR(h_, "PackFileDataStore: GetFilePathUTF8String failed for:", mDirectoryPath);
+				return false;
+			}
+			auto createResult = file::CreateDirectoryParentChain(h_, mDirectoryPath);
+			if (createResult != file::CreateDirectoryParentChainResult::kSuccess) {
+				NOTIFY_ERROR(h_, "PackFileDataStore: CreateDirectoryParentChain failed for:", mDirectoryPath);
+				return false;
+			}
+			
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (mOpen) {
+				NOTIFY_ERROR(h_, "PackFileDataStore: already open:", mDirectoryPath);
+				return false;
+			}
+			if (!OpenSegments(h_)) {
+				return false;
+			}
+			if (mSegments.empty()) {
+				std::string indexPath(mDirectoryPathUTF8 + "/index");
+				if (!MapIndexFile(h_, indexPath, kInitialIndexCapacity, true, mIndexFile, mIndexMap, mIndexMapSize)) {
+					return false;
+				}
+				mSlotKeys.assign(kInitialIndexCapacity, std::string());
+				if (!StartSegment(h_, 1)) {
+					return false;
+				}
+			}
+			else {
+				mActiveSegment = mSegments.rbegin()->second;
+				if (!LoadIndex(h_) && !RebuildIndex(h_)) {
+					return false;
+				}
+			}
+			
+			//	Until a clean close says otherwise, the index can't be trusted.
+			Header(mIndexMap).mClean = 0;
+			if (::msync(mIndexMap, kIndexHeaderSize, MS_SYNC) != 0) {
+				NOTIFY_ERROR(h_, "PackFileDataStore: msync failed, errno:", errno);
+				return false;
+			}
+			mOpen = true;
+			StartBackgroundCompactionIfNeeded(h_);
+			return true;
+		}
+		
+		//
+		bool PackFileDataStore::Sync(const HermitPtr& h_) {
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (!mOpen) {
+				NOTIFY_ERROR(h_, "PackFileDataStore: not open:", mDirectoryPath);
+				return false;
+			}
+			return SyncLocked(h_);
+		}
+		
+		//
+		bool PackFileDataStore::SyncLocked(const HermitPtr& h_) {
+			bool success = true;
+			for (auto it = begin(mSegments); it != end(mSegments); ++it) {
+				auto& segment = *it->second;
+				if (segment.mDirty) {
+					int err = file::SyncFileData(segment.mFileDescriptor);
+					if (err != 0) {
+						NOTIFY_ERROR(h_, "PackFileDataStore: SyncFileData failed for:", segment.mPath, "err:", err);
+						success = false;
+						continue;
+					}
+					segment.mDirty = false;
+				}
+			}
+			if (::msync(mIndexMap, mIndexMapSize, MS_SYNC) != 0) {
+				NOTIFY_ERROR(h_, "PackFileDataStore: msync failed, errno:", errno);
+				success = false;
+			}
+			if (!SyncDirectory(mDirectoryPathUTF8)) {
+				NOTIFY_ERROR(h_, "PackFileDataStore: fsync failed for directory:", mDirectoryPathUTF8);
+				success = false;
+			}
+			return success;
+		}
+		
+		//
+		bool PackFileDataStore::OpenSegments(const HermitPtr& h_) {
+			DIR* dir = ::opendir(mDirectoryPathUTF8.c_str());
+			if (dir == nullptr) {
+				NOTIFY_ERROR(h_, "PackFileDataStore: opendir failed for:", mDirectoryPathUTF8, "errno:", errno);
+				return false;
+			}
+			bool success = true;
+			while (struct dirent* entry = ::readdir(dir)) {
+				uint32_t number = 0;
+				if (!ParseSegmentFileName(entry->d_name, number)) {
+					continue;
+				}
+				std::string path(mDirectoryPathUTF8 + "/" + entry->d_name);
+				int fileDescriptor = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+				if (fileDescriptor == -1) {
+					NOTIFY_ERROR(h_, "PackFileDataStore: open failed for:", path, "errno:", errno);
+					success = false;
+					break;
+				}
+				struct stat s;
+				if (::fstat(fileDescriptor, &s) != 0) {
+					NOTIFY_ERROR(h_, "PackFileDataStore: fstat failed for:", path, "errno:", errno);
+					::close(fileDescriptor);
+					success = false;
+					break;
+				}
+				mSegments[number] = std::make_shared<PackFileSegment>(number, path, fileDescriptor, (uint64_t)s.st_size);
+			}
+			::closedir(dir);
+			if (!success) {
+				mSegments.clear();
+			}
+			return success;
+		}
+		
+		//
+		bool PackFileDataStore::MapIndexFile(const HermitPtr& h_,
+											 const std::string& path,
+											 uint64_t capacity,
+											 bool create,
+											 int& outFile,
+											 char*& outMap,
+											 size_t& outMapSize) {
+			int fileDescriptor = ::open(path.c_str(), create ? (O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC) : (O_RDWR | O_CLOEXEC), 0644);
+			if (fileDescriptor == -1) {
+				if (create || (errno != ENOENT)) {
+					NOTIFY_ERROR(h_, "PackFileDataStore: open failed for:", path, "errno:", errno);
+				}
+				return false;
+			}
+			if (!create) {
+				IndexHeader header;
+				struct stat s;
+				if ((ReadFully(fileDescriptor, (char*)&header, sizeof(header), 0) != 0) ||
+					(memcmp(header.mMagic, kIndexMagic, sizeof(kIndexMagic)) != 0) ||
+					(header.mVersion != kIndexVersion) ||
+					(header.mCapacity == 0) ||
+					((header.mCapacity & (header.mCapacity - 1)) != 0) ||
+					(::fstat(fileDescriptor, &s) != 0) ||
+					((uint64_t)s.st_size != kIndexHeaderSize + header.mCapacity * sizeof(PackFileIndexSlot))) {
+					::close(fileDescriptor);
+					return false;
+				}
+				capacity = header.mCapacity;
+			}
+			
+			size_t mapSize = (size_t)(kIndexHeaderSize + capacity * sizeof(PackFileIndexSlot));
+			if (create && (::ftruncate(fileDescriptor, (off_t)mapSize) != 0)) {
+				NOTIFY_ERROR(h_, "PackFileDataStore: ftruncate failed for:", path, "errno:", errno);
+				::close(fileDescriptor);
+				return false;
+			}
+			void* map = ::mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+			if (map == MAP_FAILED) {
+				NOTIFY_ERROR(h_, "PackFileDataStore: mmap failed for:", path, "errno:", errno);
+				::close(fileDescriptor);
+				return false;
+			}
+			if (create) {
+				IndexHeader& header = Header((char*)map);
+				memcpy(header.mMagic, kIndexMagic, sizeof(kIndexMagic));
+				header.mVersion = kIndexVersion;
+				header.mClean = 0;
+				header.mCapacity = capacity;
+				header.mLiveCount = 0;
+				header.mUsedSlots = 0;
+				header.mActiveSegment = 0;
+			}
+			outFile = fileDescriptor;
+			outMap = (char*)map;
+			outMapSize = mapSize;
+			return true;
+		}
+		
+		//
+		void PackFileDataStore::UnmapIndex() {
+			if (mIndexMap != nullptr) {
+				::munmap(mIndexMap, mIndexMapSize);
+				mIndexMap = nullptr;
+				mIndexMapSize = 0;
+			}
+			if (mIndexFile != -1) {
+				::close(mIndexFile);
+				mIndexFile = -1;
+			}
+		}
+		
+		//	Uses the index on disk if the store was closed cleanly and the index agrees with
+		//	the segments that are there.
+		bool PackFileDataStore::LoadIndex(const HermitPtr& h_) {
+			std::string indexPath(mDirectoryPathUTF8 + "/index");
+			if (!MapIndexFile(h_, indexPath, 0, false, mIndexFile, mIndexMap, mIndexMapSize)) {
+				return false;
+			}
+			auto& header = Header(mIndexMap);
+			if ((header.mClean != 1) || (header.mActiveSegment != mActiveSegment->mNumber)) {
+				UnmapIndex();
+				return false;
+			}
+			
+			auto slots = Slots(mIndexMap);
+			for (uint64_t n = 0; n < header.mCapacity; ++n) {
+				auto& slot = slots[n];
+				if (slot.mHash <= kDeletedSlot) {
+					continue;
+				}
+				auto it = mSegments.find(slot.mSegment);
+				auto recordSize = RecordSize(slot.mKeyLength, slot.mDataLength);
+				if ((it == mSegments.end()) || (slot.mRecordOffset + recordSize > it->second->mSize)) {
+					NOTIFY_ERROR(h_, "PackFileDataStore: index refers to missing data, rebuilding:", mDirectoryPathUTF8);
+					for (auto& segment : mSegments) {
+						segment.second->mLiveBytes = 0;
+					}
+					UnmapIndex();
+					return false;
+				}
+				it->second->mLiveBytes += recordSize;
+			}
+			if (!LoadSlotKeys(h_)) {
+				NOTIFY_ERROR(h_, "PackFileDataStore: index doesn't match the segments, rebuilding:", mDirectoryPathUTF8);
+				for (auto& segment : mSegments) {
+					segment.second->mLiveBytes = 0;
+				}
+				UnmapIndex();
+				return false;
+			}
+			return true;
+		}
+		
+		//	Reads the key of each live slot from its record. Returns false if one can't be
+		//	read or doesn't hash to its slot.
+		bool PackFileDataStore::LoadSlotKeys(const HermitPtr& h_) {
+			auto& header = Header(mIndexMap);
+			auto slots = Slots(mIndexMap);
+			mSlotKeys.assign((size_t)header.mCapacity, std::string());
+			for (uint64_t n = 0; n < header.mCapacity; ++n) {
+				auto& slot = slots[n];
+				if (slot.mHash <= kDeletedSlot) {
+					continue;
+				}
+				auto& key = mSlotKeys[n];
+				key.resize(slot.mKeyLength);
+				auto& segment = *mSegments[slot.mSegment];
+				if ((ReadFully(segment.mFileDescriptor, &key[0], key.size(), slot.mRecordOffset + sizeof(RecordHeader)) != 0) ||
+					(HashKey(key) != slot.mHash)) {
+					mSlotKeys.clear();
+					return false;
+				}
+			}
+			return true;
+		}
+		
+		//
+		bool PackFileDataStore::RebuildIndex(const HermitPtr& h_) {
+			std::string indexPath(mDirectoryPathUTF8 + "/index");
+			if (!MapIndexFile(h_, indexPath, kInitialIndexCapacity, true, mIndexFile, mIndexMap, mIndexMapSize)) {
+				return false;
+			}
+			Header(mIndexMap).mActiveSegment = mActiveSegment->mNumber;
+			mSlotKeys.assign(kInitialIndexCapacity, std::string());
+			for (auto& segment : mSegments) {
+				segment.second->mLiveBytes = 0;
+			}
+			for (auto it = begin(mSegments); it != end(mSegments); ++it) {
+				bool isLastSegment = (it->second == mActiveSegment);
+				if (!RebuildFromSegment(h_, it->second, isLastSegment)) {
+					UnmapIndex();
+					return false;
+				}
+			}
+			return true;
+		}
+		
+		//	Replays a segment's records in order. A bad record at the end of the last segment
+		//	is a write that was cut short, and is cut off; one anywhere else is reported and
+		//	the rest of that segment is skipped.
+		bool PackFileDataStore::RebuildFromSegment(const HermitPtr& h_, const PackFileSegmentPtr& segment, bool isLastSegment) {
+			uint64_t offset = 0;
+			RecordHeader header;
+			std::string record;
+			while (offset < segment->mSize) {
+				if (!ReadRecord(segment->mFileDescriptor, segment->mSize, offset, header, record)) {
+					if (!isLastSegment) {
+						NOTIFY_ERROR(h_, "PackFileDataStore: bad record in:", segment->mPath, "at offset:", offset);
+						return true;
+					}
+					if (::ftruncate(segment->mFileDescriptor, (off_t)offset) != 0) {
+						NOTIFY_ERROR(h_, "PackFileDataStore: ftruncate failed for:", segment->mPath, "errno:", errno);
+						return false;
+					}
+					segment->mSize = offset;
+					segment->mDirty = true;
+					return true;
+				}
+				
+				std::string key(record, 0, header.mKeyLength);
+				auto hash = HashKey(key);
+				if (header.mType == kPutRecord) {
+					if (!SetSlot(h_, key, hash, segment->mNumber, offset, header.mDataLength)) {
+						return false;
+					}
+				}
+				else {
+					auto slot = FindSlot(key, hash);
+					if (slot != nullptr) {
+						ClearSlot(slot);
+					}
+				}
+				offset += RecordSize(header.mKeyLength, header.mDataLength);
+			}
+			return true;
+		}
+		
+		//
+		PackFileIndexSlot* PackFileDataStore::FindSlot(const std::string& key, uint64_t hash) {
+			auto& header = Header(mIndexMap);
+			auto slots = Slots(mIndexMap);
+			uint64_t mask = header.mCapacity - 1;
+			for (uint64_t n = hash & mask; ; n = (n + 1) & mask) {
+				auto& slot = slots[n];
+				if (slot.mHash == kEmptySlot) {
+					return nullptr;
+				}
+				if ((slot.mHash == hash) && (mSlotKeys[n] == key)) {
+					return &slot;
+				}
+			}
+		}
+		
+		//
+		bool PackFileDataStore::SetSlot(const HermitPtr& h_,
+										const std::string& key,
+										uint64_t hash,
+										uint32_t segment,
+										uint64_t recordOffset,
+										uint64_t dataLength) {
+			auto existing = FindSlot(key, hash);
+			if (existing == nullptr) {
+				//	Keep at least 30% of the slots empty so probes stay short.
+				auto& header = Header(mIndexMap);
+				if ((header.mUsedSlots + 1) * 10 > header.mCapacity * 7) {
+					if (!GrowIndex(h_)) {
+						return false;
+					}
+				}
+			}
+			else {
+				ReleaseRecord(existing->mSegment, RecordSize(existing->mKeyLength, existing->mDataLength));
+			}
+			
+			auto& header = Header(mIndexMap);
+			auto slots = Slots(mIndexMap);
+			PackFileIndexSlot* slot = existing;
+			if (slot == nullptr) {
+				uint64_t mask = header.mCapacity - 1;
+				uint64_t n = hash & mask;
+				while (slots[n].mHash > kDeletedSlot) {
+					n = (n + 1) & mask;
+				}
+				slot = &slots[n];
+				if (slot->mHash == kEmptySlot) {
+					++header.mUsedSlots;
+				}
+				++header.mLiveCount;
+			}
+			slot->mHash = hash;
+			slot->mRecordOffset = recordOffset;
+			slot->mDataLength = dataLength;
+			slot->mSegment = segment;
+			slot->mKeyLength = (uint32_t)key.size();
+			if (existing == nullptr) {
+				mSlotKeys[slot - slots] = key;
+			}
+			
+			auto it = mSegments.find(segment);
+			if (it != mSegments.end()) {
+				it->second->mLiveBytes += RecordSize(key.size(), dataLength);
+			}
+			return true;
+		}
+		
+		//
+		bool PackFileDataStore::ClearSlot(PackFileIndexSlot* slot) {
+			ReleaseRecord(slot->mSegment, RecordSize(slot->mKeyLength, slot->mDataLength));
+			slot->mHash = kDeletedSlot;
+			std::string().swap(mSlotKeys[slot - Slots(mIndexMap)]);
+			--Header(mIndexMap).mLiveCount;
+			return true;
+		}
+		
+		//	Rehashes the live slots into a new file, twice the size unless most of the used
+		//	slots are deleted ones, then swaps it in for the old.
+		bool PackFileDataStore::GrowIndex(const HermitPtr& h_) {
+			auto& oldHeader = Header(mIndexMap);
+			uint64_t capacity = oldHeader.mCapacity;
+			if (oldHeader.mLiveCount * 10 >= capacity * 3) {
+				capacity *= 2;
+			}
+			
+			std::string indexPath(mDirectoryPathUTF8 + "/index");
+			std::string newIndexPath(indexPath + ".new");
+			int newFile = -1;
+			char* newMap = nullptr;
+			size_t newMapSize = 0;
+			if (!MapIndexFile(h_, newIndexPath, capacity, true, newFile, newMap, newMapSize)) {
+				return false;
+			}
+			auto& newHeader = Header(newMap);
+			newHeader.mActiveSegment = oldHeader.mActiveSegment;
+			auto oldSlots = Slots(mIndexMap);
+			auto newSlots = Slots(newMap);
+			std::vector<std::pair<uint64_t, uint64_t>> moves;
+			moves.reserve((size_t)oldHeader.mLiveCount);
+			uint64_t mask = capacity - 1;
+			for (uint64_t n = 0; n < oldHeader.mCapacity; ++n) {
+				if (oldSlots[n].mHash <= kDeletedSlot) {
+					continue;
+				}
+				uint64_t m = oldSlots[n].mHash & mask;
+				while (newSlots[m].mHash != kEmptySlot) {
+					m = (m + 1) & mask;
+				}
+				newSlots[m] = oldSlots[n];
+				moves.push_back(std::make_pair(n, m));
+				++newHeader.mLiveCount;
+			}
+			newHeader.mUsedSlots = newHeader.mLiveCount;
+			
+			if (::rename(newIndexPath.c_str(), indexPath.c_str()) != 0) {
+				NOTIFY_ERROR(h_, "PackFileDataStore: rename failed for:", newIndexPath, "errno:", errno);
+				::munmap(newMap, newMapSize);
+				::close(newFile);
+				::unlink(newIndexPath.c_str());
+				return false;
+			}
+			UnmapIndex();
+			mIndexFile = newFile;
+			mIndexMap = newMap;
+			mIndexMapSize = newMapSize;
+			
+			std::vector<std::string> slotKeys((size_t)capacity);
+			for (auto it = begin(moves); it != end(moves); ++it) {
+				slotKeys[it->second].swap(mSlotKeys[it->first]);
+			}
+			mSlotKeys.swap(slotKeys);
+			return true;
+		}
+		
+		//
+		bool PackFileDataStore::StartSegment(const HermitPtr& h_, uint32_t number) {
+			std::string path(mDirectoryPathUTF8 + "/" + SegmentFileName(number));
+			int fileDescriptor = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+			if (fileDescriptor == -1) {
+				NOTIFY_ERROR(h_, "PackFileDataStore: open failed for:", path, "errno:", errno);
+				return false;
+			}
+			auto segment = std::make_shared<PackFileSegment>(number, path, fileDescriptor, 0);
+			mSegments[number] = segment;
+			mActiveSegment = segment;
+			Header(mIndexMap).mActiveSegment = number;
+			return true;
+		}
+		
+		//
+		PackFileResult PackFileDataStore::AppendRecord(const HermitPtr& h_,
+													   uint32_t type,
+													   const std::string& key,
+													   const DataBuffer& data,
+													   PackFileSegmentPtr& outSegment,
+													   uint64_t& outRecordOffset) {
+			uint64_t recordSize = RecordSize(key.size(), data.second);
+			if ((mActiveSegment->mSize > 0) && (mActiveSegment->mSize + recordSize > mOptions.mMaxSegmentSize)) {
+				if (!StartSegment(h_, mActiveSegment->mNumber + 1)) {
+					return PackFileResult::kError;
+				}
+			}
+			
+			RecordHeader header;
+			header.mMagic = kRecordMagic;
+			header.mType = type;
+			header.mKeyLength = (uint32_t)key.size();
+			header.mCRC32 = RecordCRC32(key.data(), key.size(), data.first, data.second);
+			header.mDataLength = data.second;
+			
+			auto& segment = *mActiveSegment;
+			uint64_t offset = segment.mSize;
+			std::string buffer((const char*)&header, sizeof(header));
+			buffer += key;
+			int err = 0;
+			if (recordSize <= kSingleWriteLimit) {
+				buffer.append(data.first, data.second);
+				err = WriteFully(segment.mFileDescriptor, buffer.data(), buffer.size(), offset);
+			}
+			else {
+				err = WriteFully(segment.mFileDescriptor, buffer.data(), buffer.size(), offset);
+				if (err == 0) {
+					err = WriteFully(segment.mFileDescriptor, data.first, data.second, offset + buffer.size());
+				}
+			}
+			segment.mDirty = true;
+			if (err != 0) {
+				//	Don't leave a partial record for the next one to follow.
+				if (::ftruncate(segment.mFileDescriptor, (off_t)offset) != 0) {
+					NOTIFY_ERROR(h_, "PackFileDataStore: ftruncate failed for:", segment.mPath, "errno:", errno);
+				}
+				if (err == ENOSPC) {
+					return PackFileResult::kStorageFull;
+				}
+				NOTIFY_ERROR(h_, "PackFileDataStore: write failed for:", segment.mPath, "err:", err);
+				return PackFileResult::kError;
+			}
+			segment.mSize += recordSize;
+			outSegment = mActiveSegment;
+			outRecordOffset = offset;
+			return PackFileResult::kSuccess;
+		}
+		
+		//
+		void PackFileDataStore::ReleaseRecord(uint32_t segment, uint64_t recordSize) {
+			auto it = mSegments.find(segment);
+			if (it != mSegments.end()) {
+				it->second->mLiveBytes -= std::min(recordSize, it->second->mLiveBytes);
+			}
+		}
+		
+		//	The full segment with the smallest live fraction below the threshold, if any.
+		PackFileSegmentPtr PackFileDataStore::FindCompactionCandidate() {
+			PackFileSegmentPtr candidate;
+			double candidateFraction = mOptions.mCompactionThreshold;
+			for (auto it = begin(mSegments); it != end(mSegments); ++it) {
+				auto& segment = it->second;
+				if ((segment == mActiveSegment) || segment->mCompactionFailed) {
+					continue;
+				}
+				double liveFraction = (segment->mSize == 0) ? 0.0 : (double)segment->mLiveBytes / (double)segment->mSize;
+				if (liveFraction < candidateFraction) {
+					candidate = segment;
+					candidateFraction = liveFraction;
+				}
+			}
+			return candidate;
+		}
+		
+		//
+		void PackFileDataStore::StartBackgroundCompactionIfNeeded(const HermitPtr& h_) {
+			if (mCompacting || (FindCompactionCandidate() == nullptr)) {
+				return;
+			}
+			mCompacting = true;
+			auto task = std::make_shared<PackFileCompactionTask>(shared_from_this());
+			if (!QueueAsyncTask(h_, task, 10)) {
+				mCompacting = false;
+			}
+		}
+		
+		//
+		bool PackFileDataStore::Compact(const HermitPtr& h_) {
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				if (!mOpen || mCompacting) {
+					return false;
+				}
+				mCompacting = true;
+			}
+			return CompactSegments(h_);
+		}
+		
+		//	Called with mCompacting set; clears it when done.
+		bool PackFileDataStore::CompactSegments(const HermitPtr& h_) {
+			while (true) {
+				PackFileSegmentPtr segment;
+				{
+					std::lock_guard<std::mutex> lock(mMutex);
+					segment = FindCompactionCandidate();
+					if ((segment == nullptr) || CHECK_FOR_ABORT(h_)) {
+						mCompacting = false;
+						return true;
+					}
+				}
+				if (!CompactSegment(h_, segment)) {
+					std::lock_guard<std::mutex> lock(mMutex);
+					segment->mCompactionFailed = true;
+					mCompacting = false;
+					return false;
+				}
+			}
+		}
+		
+		//	Segments other than the active one never change, so records are read without the
+		//	lock, and each is copied forward only if the index still points at it. A
+		//	tombstone is copied too if its key is still deleted and an older segment might
+		//	hold an earlier version for a rebuild to bring back. The copies are synced
+		//	before the old segment is deleted.
+		bool PackFileDataStore::CompactSegment(const HermitPtr& h_, const PackFileSegmentPtr& segment) {
+			std::set<PackFileSegmentPtr> touchedSegments;
+			uint64_t offset = 0;
+			RecordHeader header;
+			std::string record;
+			while (offset < segment->mSize) {
+				if (!ReadRecord(segment->mFileDescriptor, segment->mSize, offset, header, record)) {
+					NOTIFY_ERROR(h_, "PackFileDataStore: bad record in:", segment->mPath, "at offset:", offset);
+					return false;
+				}
+				
+				std::string key(record, 0, header.mKeyLength);
+				auto hash = HashKey(key);
+				std::lock_guard<std::mutex> lock(mMutex);
+				auto slot = FindSlot(key, hash);
+				PackFileSegmentPtr newSegment;
+				uint64_t newOffset = 0;
+				if (header.mType == kPutRecord) {
+					if ((slot != nullptr) && (slot->mSegment == segment->mNumber) && (slot->mRecordOffset == offset)) {
+						DataBuffer data(record.data() + header.mKeyLength, header.mDataLength);
+						if (AppendRecord(h_, kPutRecord, key, data, newSegment, newOffset) != PackFileResult::kSuccess) {
+							return false;
+						}
+						if (!SetSlot(h_, key, hash, newSegment->mNumber, newOffset, header.mDataLength)) {
+							return false;
+						}
+						touchedSegments.insert(newSegment);
+					}
+				}
+				else if ((slot == nullptr) && (mSegments.begin()->first < segment->mNumber)) {
+					if (AppendRecord(h_, kTombstoneRecord, key, DataBuffer(nullptr, 0), newSegment, newOffset) != PackFileResult::kSuccess) {
+						return false;
+					}
+					//	Count the copy as live, or a segment of nothing but carried tombstones
+					//	would stay a candidate and be copied forward again and again.
+					newSegment->mLiveBytes += RecordSize(header.mKeyLength, 0);
+					touchedSegments.insert(newSegment);
+				}
+				offset += RecordSize(header.mKeyLength, header.mDataLength);
+			}
+			
+			for (auto it = begin(touchedSegments); it != end(touchedSegments); ++it) {
+				int err = file::SyncFileData((*it)->mFileDescriptor);
+				if (err != 0) {
+					NOTIFY_ERROR(h_, "PackFileDataStore: SyncFileData failed for:", (*it)->mPath, "err:", err);
+					return false;
+				}
+			}
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mSegments.erase(segment->mNumber);
+			}
+			if (::unlink(segment->mPath.c_str()) != 0) {
+				NOTIFY_ERROR(h_, "PackFileDataStore: unlink failed for:", segment->mPath, "errno:", errno);
+			}
+			return true;
+		}
+		
+		//
+		PackFileResult PackFileDataStore::PutItem(const HermitPtr& h_, const std::string& key, const DataBuffer& data) {
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (!mOpen) {
+				NOTIFY_ERROR(h_, "PackFileDataStore: not open:", mDirectoryPath);
+				return PackFileResult::kError;
+			}
+			PackFileSegmentPtr segment;
+			uint64_t offset = 0;
+			auto result = AppendRecord(h_, kPutRecord, key, data, segment, offset);
+			if (result != PackFileResult::kSuccess) {
+				return result;
+			}
+			if (!SetSlot(h_, key, HashKey(key), segment->mNumber, offset, data.second)) {
+				return PackFileResult::kError;
+			}
+			StartBackgroundCompactionIfNeeded(h_);
+			return PackFileResult::kSuccess;
+		}
+		
+		//
+		PackFileResult PackFileDataStore::GetItem(const HermitPtr& h_, const std::string& key, std::string& outData) {
+			PackFileSegmentPtr segment;
+			uint64_t offset = 0;
+			uint64_t recordSize = 0;
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				if (!mOpen) {
+					NOTIFY_ERROR(h_, "PackFileDataStore: not open:", mDirectoryPath);
+					return PackFileResult::kError;
+				}
+				auto slot = FindSlot(key, HashKey(key));
+				if (slot == nullptr) {
+					return PackFileResult::kNotFound;
+				}
+				segment = mSegments[slot->mSegment];
+				offset = slot->mRecordOffset;
+				recordSize = RecordSize(slot->mKeyLength, slot->mDataLength);
+			}
+			
+			//	The record is read outside the lock. Records are never changed in place, and
+			//	the segment's descriptor outlives any compaction that deletes it.
+			RecordHeader header;
+			if (!ReadRecord(segment->mFileDescriptor, offset + recordSize, offset, header, outData) ||
+				(header.mType != kPutRecord) ||
+				(RecordSize(header.mKeyLength, header.mDataLength) != recordSize) ||
+				(outData.compare(0, header.mKeyLength, key) != 0)) {
+				NOTIFY_ERROR(h_, "PackFileDataStore: bad record in:", segment->mPath, "at offset:", offset);
+				outData.clear();
+				return PackFileResult::kError;
+			}
+			outData.erase(0, header.mKeyLength);
+			return PackFileResult::kSuccess;
+		}
+		
+		//
+		PackFileResult PackFileDataStore::HasItem(const HermitPtr& h_, const std::string& key, bool& outExists) {
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (!mOpen) {
+				NOTIFY_ERROR(h_, "PackFileDataStore: not open:", mDirectoryPath);
+				return PackFileResult::kError;
+			}
+			outExists = (FindSlot(key, HashKey(key)) != nullptr);
+			return PackFileResult::kSuccess;
+		}
+		
+		//
+		PackFileResult PackFileDataStore::RemoveItem(const HermitPtr& h_, const std::string& key) {
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (!mOpen) {
+				NOTIFY_ERROR(h_, "PackFileDataStore: not open:", mDirectoryPath);
+				return PackFileResult::kError;
+			}
+			auto slot = FindSlot(key, HashKey(key));
+			if (slot == nullptr) {
+				return PackFileResult::kSuccess;
+			}
+			PackFileSegmentPtr segment;
+			uint64_t offset = 0;
+			auto result = AppendRecord(h_, kTombstoneRecord, key, DataBuffer(nullptr, 0), segment, offset);
+			if (result != PackFileResult::kSuccess) {
+				return result;
+			}
+			ClearSlot(slot);
+			StartBackgroundCompactionIfNeeded(h_);
+			return PackFileResult::kSuccess;
+		}
+		
+		//
+		PackFileResult PackFileDataStore::GetKeysWithPrefix(const HermitPtr& h_, const std::string& prefix, std::vector<std::string>& outKeys) {
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (!mOpen) {
+				NOTIFY_ERROR(h_, "PackFileDataStore: not open:", mDirectoryPath);
+				return PackFileResult::kError;
+			}
+			auto& header = Header(mIndexMap);
+			auto slots = Slots(mIndexMap);
+			for (uint64_t n = 0; n < header.mCapacity; ++n) {
+				if (slots[n].mHash <= kDeletedSlot) {
+					continue;
+				}
+				auto& key = mSlotKeys[n];
+				if (key.compare(0, prefix.size(), prefix) == 0) {
+					outKeys.push_back(key);
+				}
+			}
+			return PackFileResult::kSuccess;
+		}
+		
+	} // namespace filedatastore
+} // namespace hermit
@@ -0,0 +1,241 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef PackFileDataStore_h
+#define PackFileDataStore_h
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Hermit/DataStore/DataStore.h"
+#include "Hermit/File/FilePath.h"
+
+namespace hermit {
+	namespace filedatastore {
+		
+		//
+		const uint64_t kDefaultPackFileSegmentSize = 256 * 1024 * 1024;
+		
+		//
+		struct PackFileDataStoreOptions {
+			//
+			PackFileDataStoreOptions() :
+			mMaxSegmentSize(kDefaultPackFileSegmentSize),
+			mCompactionThreshold(0.5) {
+			}
+			
+			//	A new segment is started once an append would take the current one past this
+			//	size. An item larger than this gets a segment to itself.
+			uint64_t mMaxSegmentSize;
+			
+			//	A full segment is compacted once less than this fraction of it belongs to
+			//	items that are still live. 0 turns compaction off.
+			double mCompactionThreshold;
+		};
+		
+		//
+		enum class PackFileResult {
+			kUnknown,
+			kSuccess,
+			kNotFound,
+			kStorageFull,
+			kError
+		};
+		
+		//
+		class PackFileSegment;
+		typedef std::shared_ptr<PackFileSegment> PackFileSegmentPtr;
+		
+		//
+		struct PackFileIndexSlot;
+		
+		//	A DataStore that keeps all of its items in one directory. Items are appended to
+		//	large segment files, and a memory-mapped hash index maps each DataPath's string
+		//	representation to the record holding its data, so no per-item files or
+		//	directories are created. The keys themselves are kept in memory next to the
+		//	index, so ItemExists and ListItems never touch the file system. Deletes append a
+		//	tombstone. Full segments
+		//	that are mostly dead are compacted on the thread pool by copying their live
+		//	records forward. Items aren't synced to disk one by one; Sync makes everything
+		//	written so far durable, as does closing the store. If the store wasn't closed,
+		//	the next Open rebuilds the index from the segments. Create it with make_shared
+		//	(see WithPackFileDataStore), since compaction tasks hold a reference to it.
+		class PackFileDataStore : public datastore::DataStore, public std::enable_shared_from_this<PackFileDataStore> {
+		public:
+			//
+			PackFileDataStore(const file::FilePathPtr& directoryPath, const PackFileDataStoreOptions& options);
+			
+			//	Syncs and closes the store.
+			virtual ~PackFileDataStore();
+			
+			//	Creates the directory and an empty store if need be, otherwise loads (or
+			//	rebuilds) the index. Must succeed before any other call.
+			bool Open(const HermitPtr& h_);
+			
+			//
+			bool Sync(const HermitPtr& h_);
+			
+			//	Compacts any full segments below the threshold now, unless a compaction is
+			//	already running. Returns false if one was, or if compacting failed.
+			bool Compact(const HermitPtr& h_);
+			
+			//
+			virtual void ListItems(const HermitPtr& h_,
+								   const datastore::DataPathPtr& rootPath,
+								   const datastore::ListDataStoreItemsItemCallbackPtr& itemCallback,
+								   const datastore::ListDataStoreItemsCompletionPtr& completion) override;
+			
+			//
+			virtual void ItemExists(const HermitPtr& h_,
+									const datastore::DataPathPtr& itemPath,
+									const datastore::ItemExistsInDataStoreCompletionPtr& completion) override;
+			
+			//
+			virtual void LoadData(const HermitPtr& h_,
+								  const datastore::DataPathPtr& path,
+								  const datastore::EncryptionSetting& encryptionSetting,
+								  const datastore::LoadDataStoreDataDataBlockPtr& dataBlock,
+								  const datastore::LoadDataStoreDataCompletionBlockPtr& completion) override;
+			
+			//
+			virtual void WriteData(const HermitPtr& h_,
+								   const datastore::DataPathPtr& path,
+								   const SharedBufferPtr& data,
+								   const datastore::EncryptionSetting& encryptionSetting,
+								   const datastore::WriteDataStoreDataCompletionFunctionPtr& completion) override;
+			
+			//
+			virtual void DeleteItem(const HermitPtr& h_,
+									const datastore::DataPathPtr& path,
+									const datastore::DeleteDataStoreItemCompletionPtr& completion) override;
+			
+			//	The operations behind the DataStore calls, keyed by path string.
+			PackFileResult PutItem(const HermitPtr& h_, const std::string& key, const DataBuffer& data);
+			
+			//
+			PackFileResult GetItem(const HermitPtr& h_, const std::string& key, std::string& outData);
+			
+			//
+			PackFileResult HasItem(const HermitPtr& h_, const std::string& key, bool& outExists);
+			
+			//	Removing a key that isn't there succeeds.
+			PackFileResult RemoveItem(const HermitPtr& h_, const std::string& key);
+			
+			//
+			PackFileResult GetKeysWithPrefix(const HermitPtr& h_, const std::string& prefix, std::vector<std::string>& outKeys);
+			
+		private:
+			//
+			bool OpenSegments(const HermitPtr& h_);
+			
+			//
+			bool LoadIndex(const HermitPtr& h_);
+			
+			//
+			bool RebuildIndex(const HermitPtr& h_);
+			
+			//
+			bool RebuildFromSegment(const HermitPtr& h_, const PackFileSegmentPtr& segment, bool isLastSegment);
+			
+			//
+			bool MapIndexFile(const HermitPtr& h_,
+							  const std::string& path,
+							  uint64_t capacity,
+							  bool create,
+							  int& outFile,
+							  char*& outMap,
+							  size_t& outMapSize);
+			
+			//
+			void UnmapIndex();
+			
+			//
+			bool SyncLocked(const HermitPtr& h_);
+			
+			//
+			bool LoadSlotKeys(const HermitPtr& h_);
+			
+			//
+			PackFileIndexSlot* FindSlot(const std::string& key, uint64_t hash);
+			
+			//
+			bool SetSlot(const HermitPtr& h_,
+						 const std::string& key,
+						 uint64_t hash,
+						 uint32_t segment,
+						 uint64_t recordOffset,
+						 uint64_t dataLength);
+			
+			//
+			bool ClearSlot(PackFileIndexSlot* slot);
+			
+			//
+			bool GrowIndex(const HermitPtr& h_);
+			
+			//
+			PackFileResult AppendRecord(const HermitPtr& h_,
+										uint32_t type,
+										const std::string& key,
+										const DataBuffer& data,
+										PackFileSegmentPtr& outSegment,
+										uint64_t& outRecordOffset);
+			
+			//
+			bool StartSegment(const HermitPtr& h_, uint32_t number);
+			
+			//
+			void ReleaseRecord(uint32_t segment, uint64_t recordSize);
+			
+			//
+			PackFileSegmentPtr FindCompactionCandidate();
+			
+			//
+			void StartBackgroundCompactionIfNeeded(const HermitPtr& h_);
+			
+			//
+			bool CompactSegments(const HermitPtr& h_);
+			
+			//
+			bool CompactSegment(const HermitPtr& h_, const PackFileSegmentPtr& segment);
+			
+			//
+			friend class PackFileCompactionTask;
+			
+			//
+			file::FilePathPtr mDirectoryPath;
+			std::string mDirectoryPathUTF8;
+			PackFileDataStoreOptions mOptions;
+			std::mutex mMutex;
+			bool mOpen;
+			int mIndexFile;
+			char* mIndexMap;
+			size_t mIndexMapSize;
+			std::vector<std::string> mSlotKeys;
+			std::map<uint32_t, PackFileSegmentPtr> mSegments;
+			PackFileSegmentPtr mActiveSegment;
+			bool mCompacting;
+		};
+		typedef std::shared_ptr<PackFileDataStore> PackFileDataStorePtr;
+		
+	} // namespace filedatastore
+} // namespace hermit
+
+#endif
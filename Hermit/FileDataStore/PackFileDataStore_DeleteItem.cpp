@@ -0,0 +1,39 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <string>
+#include "PackFileDataStore.h"
+
+namespace hermit {
+	namespace filedatastore {
+		
+		//
+		void PackFileDataStore::DeleteItem(const HermitPtr& h_,
+										   const datastore::DataPathPtr& path,
+										   const datastore::DeleteDataStoreItemCompletionPtr& completion) {
+			std::string key;
+			path->GetStringRepresentation(h_, key);
+			if (RemoveItem(h_, key) != PackFileResult::kSuccess) {
+				completion->Call(h_, datastore::DeleteDataStoreItemResult::kError);
+				return;
+			}
+			completion->Call(h_, datastore::DeleteDataStoreItemResult::kSuccess);
+		}
+		
+	} // namespace filedatastore
+} // namespace hermit
@@ -0,0 +1,77 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <string>
+#include <vector>
+#include "Hermit/Foundation/Notification.h"
+#include "PackFileDataStore.h"
+
+namespace hermit {
+	namespace filedatastore {
+		
+		//	Items are found by the string form of their paths, and each is handed back as
+		//	rootPath with the rest of its path appended a component at a time.
+		void PackFileDataStore::ListItems(const HermitPtr& h_,
+										  const datastore::DataPathPtr& rootPath,
+										  const datastore::ListDataStoreItemsItemCallbackPtr& itemCallback,
+										  const datastore::ListDataStoreItemsCompletionPtr& completion) {
+			std::string prefix;
+			rootPath->GetStringRepresentation(h_, prefix);
+			if (prefix.empty() || (prefix.back() != '/')) {
+				prefix += "/";
+			}
+			
+			std::vector<std::string> keys;
+			if (GetKeysWithPrefix(h_, prefix, keys) != PackFileResult::kSuccess) {
+				completion->Call(h_, datastore::ListDataStoreItemsResult::kError);
+				return;
+			}
+			
+			for (auto it = begin(keys); it != end(keys); ++it) {
+				if (CHECK_FOR_ABORT(h_)) {
+					completion->Call(h_, datastore::ListDataStoreItemsResult::kCanceled);
+					return;
+				}
+				
+				datastore::DataPathPtr itemPath(rootPath);
+				size_t start = prefix.size();
+				while (start < it->size()) {
+					size_t end = it->find('/', start);
+					if (end == std::string::npos) {
+						end = it->size();
+					}
+					if (end > start) {
+						datastore::DataPathPtr childPath;
+						if (!itemPath->AppendPathComponent(h_, it->substr(start, end - start), childPath)) {
+							NOTIFY_ERROR(h_, "AppendPathComponent failed for:", *it);
+							completion->Call(h_, datastore::ListDataStoreItemsResult::kError);
+							return;
+						}
+						itemPath = childPath;
+					}
+					start = end + 1;
+				}
+				if (!itemCallback->OnOneItem(h_, itemPath)) {
+					break;
+				}
+			}
+			completion->Call(h_, datastore::ListDataStoreItemsResult::kSuccess);
+		}
+		
+	} // namespace filedatastore
+} // namespace hermit
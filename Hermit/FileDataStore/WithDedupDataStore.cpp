@@ -0,0 +1,43 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "Hermit/Foundation/Notification.h"
+#include "WithDedupDataStore.h"
+
+namespace hermit {
+	namespace filedatastore {
+		
+		//
+		bool WithDedupDataStore(const HermitPtr& h_,
+								const datastore::DataStorePtr& dataStore,
+								const DedupDataStoreOptions& options,
+								DedupDataStorePtr& outDataStore) {
+			if (dataStore == nullptr) {
+				NOTIFY_ERROR(h_, "WithDedupDataStore: dataStore is null.");
+				return false;
+			}
+			if (options.mChunkRoot == nullptr) {
+				NOTIFY_ERROR(h_, "WithDedupDataStore: options.mChunkRoot is null.");
+				return false;
+			}
+			outDataStore = std::make_shared<DedupDataStore>(dataStore, options);
+			return true;
+		}
+		
+	} // namespace filedatastore
+} // namespace hermit
@@ -0,0 +1,39 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef WithPackFileDataStore_h
+#define WithPackFileDataStore_h
+
+#include "Hermit/DataStore/DataStore.h"
+#include "Hermit/File/FilePath.h"
+#include "PackFileDataStore.h"
+
+namespace hermit {
+	namespace filedatastore {
+		
+		//	Opens (creating if need be) the pack-file store kept in directoryPath. Only one
+		//	store should have a given directory open at a time.
+		bool WithPackFileDataStore(const HermitPtr& h_,
+								   const file::FilePathPtr& directoryPath,
+								   const PackFileDataStoreOptions& options,
+								   datastore::DataStorePtr& outDataStore);
+		
+	} // namespace filedatastore
+} // namespace hermit
+
+#endif
@@ -0,0 +1,72 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#include "CPUFeatures.h"
+
+namespace hermit {
+	namespace CPUFeatures_Impl {
+		
+		//
+		CPUFeatures DetectCPUFeatures() {
+			CPUFeatures features;
+#if defined(__x86_64__) || defined(__i386__)
+			unsigned int eax = 0;
+			unsigned int ebx = 0;
+			unsigned int ecx = 0;
+			unsigned int edx = 0;
+			if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+				return features;
+			}
+			features.mSSE2 = ((edx & bit_SSE2) != 0);
+			features.mSSSE3 = ((ecx & bit_SSSE3) != 0);
+			features.mSSE41 = ((ecx & bit_SSE4_1) != 0);
+			features.mPCLMUL = ((ecx & bit_PCLMUL) != 0);
+			features.mAES = ((ecx & bit_AES) != 0);
+			
+			bool osSavesYMM = false;
+			if ((ecx & bit_OSXSAVE) && (ecx & bit_AVX)) {
+				unsigned int xcr0 = 0;
+				unsigned int xcr0High = 0;
+				__asm__ ("xgetbv" : "=a"(xcr0), "=d"(xcr0High) : "c"(0));
+				osSavesYMM = ((xcr0 & 6) == 6);
+			}
+			
+			if (__get_cpuid_max(0, nullptr) >= 7) {
+				__cpuid_count(7, 0, eax, ebx, ecx, edx);
+				features.mAVX2 = osSavesYMM && ((ebx & bit_AVX2) != 0);
+				features.mSHA = ((ebx & bit_SHA) != 0);
+			}
+#endif
+			return features;
+		}
+		
+	} // namespace CPUFeatures_Impl
+	using namespace CPUFeatures_Impl;
+	
+	//
+	const CPUFeatures& GetCPUFeatures() {
+		static const CPUFeatures sFeatures = DetectCPUFeatures();
+		return sFeatures;
+	}
+	
+} // namespace hermit
@@ -0,0 +1,47 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef CPUFeatures_h
+#define CPUFeatures_h
+
+namespace hermit {
+	
+	//	The x86 instruction set extensions our SIMD paths choose between at run time.
+	struct CPUFeatures {
+		//
+		CPUFeatures() : mSSE2(false), mSSSE3(false), mSSE41(false), mAVX2(false), mPCLMUL(false), mAES(false), mSHA(false) {
+		}
+		
+		//
+		bool mSSE2;
+		bool mSSSE3;
+		bool mSSE41;
+		bool mAVX2;
+		bool mPCLMUL;
+		bool mAES;
+		bool mSHA;
+	};
+	
+	//	Asks CPUID once, on first use. mAVX2 also requires the OS to save the upper halves of
+	//	the YMM registers, which CPUID alone doesn't tell us. All false off x86.
+	const CPUFeatures& GetCPUFeatures();
+	
+} // namespace hermit
+
+#endif
@@ -1,6 +1,6 @@
 //
 //	Hermit
-//	Copyright (C) 2017 Paul Young (aka peymojo)
+//	Copyright (C) 2018 Paul Young (aka peymojo)
 //
 //	This program is free software: you can redistribute it and/or modify
 //	it under the terms of the GNU General Public License as published by
@@ -16,49 +16,154 @@
 //	along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+
+#include <cstring>
+
+#ifndef HERMIT_COMPARE_MEMORY_SIMD
+#if defined(__x86_64__) || defined(__i386__)
+#define HERMIT_COMPARE_MEMORY_SIMD 1
+#else
+#define HERMIT_COMPARE_MEMORY_SIMD 0
+#endif
+#endif
+
+#if HERMIT_COMPARE_MEMORY_SIMD
+#include <immintrin.h>
+#endif
+
+#include "CPUFeatures.h"
 #include "CompareMemory.h"
 
 namespace hermit {
-	
-	//
-	static uint64_t CompareMemory(const char* inData1, const char* inData2, uint64_t inSize) {
-		uint64_t pos = 0;
-		uint64_t sizeOfLong = sizeof(long);
-		uint64_t slop = inSize - (inSize & ~(sizeOfLong - 1));
-		uint64_t longs = inSize / sizeOfLong;
-		const long* data1 = reinterpret_cast<const long*>(inData1);
-		const long* data2 = reinterpret_cast<const long*>(inData2);
-		for (uint64_t n = 0; n < longs; ++n) {
-			if (*data1 != *data2) {
-				const char* slop1 = reinterpret_cast<const char*>(data1);
-				const char* slop2 = reinterpret_cast<const char*>(data2);
-				for (uint64_t m = 0; m < sizeOfLong; ++m) {
-					if (*slop1 != *slop2) {
-						break;
-					}
-					++slop1;
-					++slop2;
-					++pos;
+	namespace CompareMemory_Impl {
+		
+		//	Sixteen and then eight bytes at a time, loaded with memcpy so neither pointer needs
+		//	to be aligned, then byte by byte within the first word that differs.
+		uint64_t FindFirstMismatchWithScalar(const char* data1, const char* data2, uint64_t size, uint64_t pos) {
+			while ((pos + 2 * sizeof(uint64_t)) <= size) {
+				uint64_t words1[2];
+				uint64_t words2[2];
+				memcpy(words1, data1 + pos, sizeof(words1));
+				memcpy(words2, data2 + pos, sizeof(words2));
+				if (((words1[0] ^ words2[0]) | (words1[1] ^ words2[1])) != 0) {
+					break;
 				}
-				break;
+				pos += 2 * sizeof(uint64_t);
 			}
-			++data1;
-			++data2;
-			pos += sizeOfLong;
-		}
-		if (pos == (inSize - slop)) {
-			const char* slop1 = reinterpret_cast<const char*>(data1);
-			const char* slop2 = reinterpret_cast<const char*>(data2);
-			for (uint64_t n = 0; n < slop; ++n) {
-				if (*slop1 != *slop2) {
+			while ((pos + sizeof(uint64_t)) <= size) {
+				uint64_t word1 = 0;
+				uint64_t word2 = 0;
+				memcpy(&word1, data1 + pos, sizeof(word1));
+				memcpy(&word2, data2 + pos, sizeof(word2));
+				if (word1 != word2) {
 					break;
 				}
-				++slop1;
-				++slop2;
+				pos += sizeof(uint64_t);
+			}
+			while ((pos < size) && (data1[pos] == data2[pos])) {
 				++pos;
 			}
+			return pos;
+		}
+		
+#if HERMIT_COMPARE_MEMORY_SIMD
+		
+		//	128 bytes per step while everything matches, folding four compares into a single
+		//	movemask test, then 32 bytes at a time to pin down the mismatch. A tail of fewer
+		//	than 32 bytes is covered by one overlapping compare ending at size.
+		__attribute__((target("avx2")))
+		uint64_t FindFirstMismatchWithAVX2(const char* data1, const char* data2, uint64_t size) {
+			uint64_t pos = 0;
+			while ((pos + 128) <= size) {
+				const __m256i* p1 = reinterpret_cast<const __m256i*>(data1 + pos);
+				const __m256i* p2 = reinterpret_cast<const __m256i*>(data2 + pos);
+				__m256i e0 = _mm256_cmpeq_epi8(_mm256_loadu_si256(p1), _mm256_loadu_si256(p2));
+				__m256i e1 = _mm256_cmpeq_epi8(_mm256_loadu_si256(p1 + 1), _mm256_loadu_si256(p2 + 1));
+				__m256i e2 = _mm256_cmpeq_epi8(_mm256_loadu_si256(p1 + 2), _mm256_loadu_si256(p2 + 2));
+				__m256i e3 = _mm256_cmpeq_epi8(_mm256_loadu_si256(p1 + 3), _mm256_loadu_si256(p2 + 3));
+				__m256i equal = _mm256_and_si256(_mm256_and_si256(e0, e1), _mm256_and_si256(e2, e3));
+				if ((uint32_t)_mm256_movemask_epi8(equal) != 0xFFFFFFFFu) {
+					break;
+				}
+				pos += 128;
+			}
+			while ((pos + 32) <= size) {
+				__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data1 + pos));
+				__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data2 + pos));
+				uint32_t differ = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b));
+				if (differ != 0) {
+					return pos + __builtin_ctz(differ);
+				}
+				pos += 32;
+			}
+			if ((pos < size) && (size >= 32)) {
+				// everything before pos already matched, so any difference found is at or past it
+				uint64_t start = size - 32;
+				__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data1 + start));
+				__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data2 + start));
+				uint32_t differ = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b));
+				return (differ != 0) ? (start + __builtin_ctz(differ)) : size;
+			}
+			return FindFirstMismatchWithScalar(data1, data2, size, pos);
+		}
+		
+		//	The same shape with 16-byte registers.
+		__attribute__((target("sse2")))
+		uint64_t FindFirstMismatchWithSSE2(const char* data1, const char* data2, uint64_t size) {
+			uint64_t pos = 0;
+			while ((pos + 64) <= size) {
+				__m128i e0 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data1 + pos)),
+											_mm_loadu_si128(reinterpret_cast<const __m128i*>(data2 + pos)));
+				__m128i e1 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data1 + pos + 16)),
+											_mm_loadu_si128(reinterpret_cast<const __m128i*>(data2 + pos + 16)));
+				__m128i e2 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data1 + pos + 32)),
+											_mm_loadu_si128(reinterpret_cast<const __m128i*>(data2 + pos + 32)));
+				__m128i e3 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data1 + pos + 48)),
+											_mm_loadu_si128(reinterpret_cast<const __m128i*>(data2 + pos + 48)));
+				__m128i equal = _mm_and_si128(_mm_and_si128(e0, e1), _mm_and_si128(e2, e3));
+				if (_mm_movemask_epi8(equal) != 0xFFFF) {
+					break;
+				}
+				pos += 64;
+			}
+			while ((pos + 16) <= size) {
+				__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data1 + pos));
+				__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data2 + pos));
+				uint32_t differ = ~(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) & 0xFFFFu;
+				if (differ != 0) {
+					return pos + __builtin_ctz(differ);
+				}
+				pos += 16;
+			}
+			if ((pos < size) && (size >= 16)) {
+				uint64_t start = size - 16;
+				__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data1 + start));
+				__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data2 + start));
+				uint32_t differ = ~(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) & 0xFFFFu;
+				return (differ != 0) ? (start + __builtin_ctz(differ)) : size;
+			}
+			return FindFirstMismatchWithScalar(data1, data2, size, pos);
+		}
+		
+#endif
+		
+	} // namespace CompareMemory_Impl
+	using namespace CompareMemory_Impl;
+	
+	//
+	uint64_t FindFirstMismatch(const void* data1, const void* data2, uint64_t size) {
+		const char* bytes1 = static_cast<const char*>(data1);
+		const char* bytes2 = static_cast<const char*>(data2);
+#if HERMIT_COMPARE_MEMORY_SIMD
+		const CPUFeatures& features = GetCPUFeatures();
+		if (features.mAVX2) {
+			return FindFirstMismatchWithAVX2(bytes1, bytes2, size);
+		}
+		if (features.mSSE2) {
+			return FindFirstMismatchWithSSE2(bytes1, bytes2, size);
 		}
-		return pos;
+#endif
+		return FindFirstMismatchWithScalar(bytes1, bytes2, size, 0);
 	}
 	
 	//
@@ -67,7 +172,7 @@ namespace hermit {
 					   const uint64_t& inSize,
 					   const CompareMemoryCallbackRef& inCallback) {
 		
-		uint64_t equalBytes = CompareMemory(inData1, inData2, inSize);
+		uint64_t equalBytes = FindFirstMismatch(inData1, inData2, inSize);
 		inCallback.Call((equalBytes == inSize), equalBytes);
 	}
 	
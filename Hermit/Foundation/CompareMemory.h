@@ -51,6 +51,10 @@ namespace hermit {
 		std::uint64_t mBytesThatMatch;
 	};
 	
+	//	Returns the offset of the first byte at which data1 and data2 differ, or size if they
+	//	don't. Uses 32-byte AVX2 or 16-byte SSE2 compares where the CPU has them.
+	std::uint64_t FindFirstMismatch(const void* data1, const void* data2, std::uint64_t size);
+	
 	//
 	void CompareMemory(const char* inData1,
 					   const char* inData2,
@@ -0,0 +1,188 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "StaticLog.h"
+#include "DelayedTaskQueue.h"
+
+namespace hermit {
+	namespace DelayedTaskQueue_Impl {
+		
+		//
+		typedef std::chrono::steady_clock Clock;
+		
+		// how often pending tasks are checked for abort
+		const std::chrono::milliseconds kAbortCheckInterval(200);
+		
+		//
+		class QueueEntry {
+		public:
+			//
+			QueueEntry(const HermitPtr& h_, const AsyncTaskPtr& task, int32_t priority) :
+			mH_(h_),
+			mTask(task),
+			mPriority(priority) {
+			}
+			
+			//
+			HermitPtr mH_;
+			AsyncTaskPtr mTask;
+			int32_t mPriority;
+		};
+		typedef std::shared_ptr<QueueEntry> QueueEntryPtr;
+		
+		//
+		typedef std::multimap<Clock::time_point, QueueEntryPtr> PendingTaskMap;
+		
+		// Passed to tasks canceled by shutdown so that their abort check fires.
+		class AbortingHermit : public Hermit {
+		public:
+			//
+			AbortingHermit(const HermitPtr& h_) : mH_(h_) {
+			}
+			
+			//
+			virtual bool ShouldAbort() override {
+				return true;
+			}
+			
+			//
+			virtual void Notify(const char* name, const void* param) override {
+				NOTIFY(mH_, name, param);
+			}
+			
+			//
+			HermitPtr mH_;
+		};
+		
+		//
+		static std::mutex sMutex;
+		static std::condition_variable sCondition;
+		static std::thread sThread;
+		static bool sThreadStarted = false;
+		static bool sQuitThread = false;
+		static PendingTaskMap sPendingTasks;
+		
+		//
+		void TimerThreadProc() {
+			std::unique_lock<std::mutex> lock(sMutex);
+			while (!sQuitThread) {
+				if (sPendingTasks.empty()) {
+					sCondition.wait(lock);
+					continue;
+				}
+				
+				// ShouldAbort is the client's code and may well queue another retry, so it's
+				// asked with the lock released. Only this thread removes entries (other than
+				// shutdown, which also stops this thread), so the snapshot stays valid.
+				auto now = Clock::now();
+				PendingTaskMap pendingTasks(sPendingTasks);
+				lock.unlock();
+				std::vector<QueueEntryPtr> readyTasks;
+				std::vector<Clock::time_point> readyTimes;
+				for (auto& pending : pendingTasks) {
+					if ((pending.first <= now) || CHECK_FOR_ABORT(pending.second->mH_)) {
+						readyTasks.push_back(pending.second);
+						readyTimes.push_back(pending.first);
+					}
+				}
+				lock.lock();
+				if (sQuitThread) {
+					break;
+				}
+				for (size_t n = 0; n < readyTasks.size(); ++n) {
+					auto range = sPendingTasks.equal_range(readyTimes[n]);
+					for (auto it = range.first; it != range.second; ++it) {
+						if (it->second == readyTasks[n]) {
+							sPendingTasks.erase(it);
+							break;
+						}
+					}
+				}
+				
+				if (!readyTasks.empty()) {
+					lock.unlock();
+					for (auto& entry : readyTasks) {
+						if (!QueueAsyncTask(entry->mH_, entry->mTask, entry->mPriority)) {
+							StaticLog("DelayedTaskQueue: QueueAsyncTask failed");
+						}
+					}
+					lock.lock();
+					continue;
+				}
+				
+				auto wakeTime = now + kAbortCheckInterval;
+				if (sPendingTasks.begin()->first < wakeTime) {
+					wakeTime = sPendingTasks.begin()->first;
+				}
+				sCondition.wait_until(lock, wakeTime);
+			}
+		}
+		
+	} // namespace DelayedTaskQueue_Impl
+	using namespace DelayedTaskQueue_Impl;
+	
+	//
+	bool QueueDelayedTask(const HermitPtr& h_,
+						  const AsyncTaskPtr& task,
+						  const int32_t& priority,
+						  const uint64_t& delayInMilliseconds) {
+		auto entry = std::make_shared<QueueEntry>(h_, task, priority);
+		auto fireTime = Clock::now() + std::chrono::milliseconds(delayInMilliseconds);
+		{
+			std::lock_guard<std::mutex> lock(sMutex);
+			if (sQuitThread) {
+				return false;
+			}
+			if (!sThreadStarted) {
+				sThread = std::thread(TimerThreadProc);
+				sThreadStarted = true;
+			}
+			sPendingTasks.insert(PendingTaskMap::value_type(fireTime, entry));
+		}
+		sCondition.notify_one();
+		return true;
+	}
+	
+	//
+	void ShutdownDelayedTaskQueue() {
+		PendingTaskMap pendingTasks;
+		bool threadStarted = false;
+		{
+			std::lock_guard<std::mutex> lock(sMutex);
+			pendingTasks.swap(sPendingTasks);
+			sQuitThread = true;
+			threadStarted = sThreadStarted;
+			sThreadStarted = false;
+		}
+		sCondition.notify_one();
+		if (threadStarted) {
+			sThread.join();
+		}
+		for (auto& pending : pendingTasks) {
+			auto& entry = pending.second;
+			entry->mTask->PerformTask(std::make_shared<AbortingHermit>(entry->mH_));
+		}
+	}
+	
+} // namespace hermit
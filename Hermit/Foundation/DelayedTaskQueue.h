@@ -0,0 +1,43 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef DelayedTaskQueue_h
+#define DelayedTaskQueue_h
+
+#include <cstdint>
+#include "AsyncTaskQueue.h"
+#include "Hermit.h"
+
+namespace hermit {
+	
+	// Hands task to QueueAsyncTask once delayInMilliseconds has passed. Nothing is blocked
+	// while the delay runs: a single timer thread keeps track of every pending task. If h_
+	// asks to abort, the task is queued early so it can cancel promptly.
+	bool QueueDelayedTask(const HermitPtr& h_,
+						  const AsyncTaskPtr& task,
+						  const int32_t& priority,
+						  const uint64_t& delayInMilliseconds);
+	
+	// Called by ShutdownAsyncTaskQueue. Tasks still waiting are performed right away on the
+	// calling thread with an h_ that asks them to abort, so each gets to report that it was
+	// canceled rather than silently never running.
+	void ShutdownDelayedTaskQueue();
+	
+} // namespace hermit
+
+#endif
@@ -0,0 +1,111 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include "AsyncTaskQueue.h"
+#include "ParallelSlices.h"
+
+namespace hermit {
+	namespace ParallelSlices_Impl {
+		
+		//
+		const int32_t kParallelSlicesPriority = 10;
+		
+		//	Outlives the call if a pool task only gets to run after every slice was claimed.
+		class SliceState {
+		public:
+			//
+			SliceState(ParallelSlicesJob& job, size_t sliceCount) :
+			mJob(&job),
+			mSliceCount(sliceCount),
+			mNextSlice(0),
+			mSlicesDone(0) {
+			}
+			
+			//	Runs unclaimed slices until there are none left.
+			void RunSlices() {
+				while (true) {
+					size_t slice = mNextSlice++;
+					if (slice >= mSliceCount) {
+						return;
+					}
+					mJob->RunSlice(slice);
+					std::lock_guard<std::mutex> lock(mMutex);
+					if (++mSlicesDone == mSliceCount) {
+						mCondition.notify_all();
+					}
+				}
+			}
+			
+			//
+			void WaitForSlices() {
+				std::unique_lock<std::mutex> lock(mMutex);
+				while (mSlicesDone < mSliceCount) {
+					mCondition.wait(lock);
+				}
+			}
+			
+			//
+			ParallelSlicesJob* mJob;
+			size_t mSliceCount;
+			std::atomic<size_t> mNextSlice;
+			std::mutex mMutex;
+			std::condition_variable mCondition;
+			size_t mSlicesDone;
+		};
+		typedef std::shared_ptr<SliceState> SliceStatePtr;
+		
+		//
+		class SliceTask : public AsyncTask {
+		public:
+			//
+			SliceTask(const SliceStatePtr& state) : mState(state) {
+			}
+			
+			//
+			virtual void PerformTask(const HermitPtr& h_) override {
+				mState->RunSlices();
+			}
+			
+			//
+			SliceStatePtr mState;
+		};
+		
+	} // namespace ParallelSlices_Impl
+	using namespace ParallelSlices_Impl;
+	
+	//
+	void RunParallelSlices(ParallelSlicesJob& job, size_t sliceCount) {
+		if (sliceCount == 0) {
+			return;
+		}
+		auto state = std::make_shared<SliceState>(job, sliceCount);
+		for (size_t n = 1; n < sliceCount; ++n) {
+			// if the pool is gone the caller just runs more of the slices itself
+			if (!QueueAsyncTask(nullptr, std::make_shared<SliceTask>(state), kParallelSlicesPriority)) {
+				break;
+			}
+		}
+		state->RunSlices();
+		state->WaitForSlices();
+	}
+	
+} // namespace hermit
@@ -0,0 +1,46 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef ParallelSlices_h
+#define ParallelSlices_h
+
+#include <cstddef>
+
+namespace hermit {
+	
+	//	A piece of work split into independent slices that can run on any thread.
+	class ParallelSlicesJob {
+	public:
+		//
+		virtual ~ParallelSlicesJob() {
+		}
+		
+		//
+		virtual void RunSlice(size_t sliceIndex) = 0;
+	};
+	
+	//	Runs job.RunSlice for every index below sliceCount on the calling thread and up to
+	//	sliceCount - 1 ThreadPool workers, returning once every slice is done. Slices go to
+	//	whichever thread is free first, so the caller only ever waits on slices that are
+	//	already running, never on ones still queued behind other work; that makes it safe to
+	//	call from a task that's itself running on the pool.
+	void RunParallelSlices(ParallelSlicesJob& job, size_t sliceCount);
+	
+} // namespace hermit
+
+#endif
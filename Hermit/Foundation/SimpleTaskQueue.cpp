@@ -16,15 +16,20 @@
 //	along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#include <condition_variable>
+#include <mutex>
 #include <queue>
 #include <thread>
-#include <vector>
 #include "StaticLog.h"
+#include "ThreadPool.h"
 #include "SimpleTaskQueue.h"
 
 namespace hermit {
 	namespace SimpleTaskQueue_Impl {
 		
+		//
+		const int32_t kSimpleTaskQueuePriority = 0;
+		
 		//
 		class QueueEntry {
 		public:
@@ -44,20 +49,68 @@ namespace hermit {
 	} // namespace SimpleTaskQueue_Impl
 	using namespace SimpleTaskQueue_Impl;
 	
-	//
-	class SimpleTaskQueueImpl {
+	// Runs its tasks in order, one at a time, on the shared ThreadPool. The next task is
+	// dispatched when the previous one returns from PerformTask.
+	class SimpleTaskQueueImpl : public std::enable_shared_from_this<SimpleTaskQueueImpl> {
 	public:
 		//
-		SimpleTaskQueueImpl() : mQuit(false) {
-			pthread_mutex_init(&mMutex, nullptr);
-			pthread_cond_init(&mCondition, nullptr);
-			pthread_attr_init(&mAttr);
-			pthread_attr_setdetachstate(&mAttr, PTHREAD_CREATE_JOINABLE);
+		SimpleTaskQueueImpl() : mRunning(false), mQuit(false) {
+		}
+		
+		//
+		bool QueueTask(const QueueEntryPtr& entry) {
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				if (mQuit) {
+					return false;
+				}
+				mTasks.push(entry);
+				if (mRunning) {
+					return true;
+				}
+				mRunning = true;
+			}
+			Dispatch();
+			return true;
+		}
+		
+		//
+		void Dispatch();
+		
+		//
+		void RunNextTask() {
+			QueueEntryPtr nextTask;
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				if (!mQuit && !mTasks.empty()) {
+					nextTask = mTasks.front();
+					mTasks.pop();
+					mRunningThread = std::this_thread::get_id();
+				}
+			}
+			if (nextTask != nullptr) {
+				nextTask->mTask->PerformTask(nextTask->mH_);
+			}
+			
+			bool more = false;
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mRunningThread = std::thread::id();
+				more = !mQuit && !mTasks.empty();
+				if (!more) {
+					mRunning = false;
+					mCondition.notify_all();
+				}
+			}
+			// requeue rather than loop so one busy queue can't hold a pool thread indefinitely
+			if (more) {
+				Dispatch();
+			}
 		}
 		
 		//
 		void Shutdown() {
-			pthread_mutex_lock(&mMutex);
+			std::unique_lock<std::mutex> lock(mMutex);
 			if (!mTasks.empty()) {
 				StaticLog("SimpleTaskQueueImpl::Shutdown(): !mTasks.empty()");
 				while (!mTasks.empty()) {
@@ -65,51 +118,62 @@ namespace hermit {
 				}
 			}
 			mQuit = true;
-			pthread_cond_signal(&mCondition);
-			pthread_mutex_unlock(&mMutex);
 			
-			mThread.join();
+			// like joining the old dedicated thread, wait for a task that's still running
+			while (mRunning && (mRunningThread != std::this_thread::get_id())) {
+				mCondition.wait(lock);
+			}
 		}
 
 		//
+		std::mutex mMutex;
+		std::condition_variable mCondition;
 		Queue mTasks;
-		std::thread mThread;
-		pthread_attr_t mAttr;
-		pthread_mutex_t mMutex;
-		pthread_cond_t mCondition;
+		bool mRunning;
+		std::thread::id mRunningThread;
 		bool mQuit;
 	};
 	
-	//
-	void SimpleTaskQueueThreadProc(SimpleTaskQueueImplPtr impl) {
-		while (true) {
-			pthread_mutex_lock(&impl->mMutex);
-			while (!impl->mQuit && impl->mTasks.empty()) {
-				pthread_cond_wait(&impl->mCondition, &impl->mMutex);
-			}
-			if (impl->mQuit) {
-				pthread_mutex_unlock(&impl->mMutex);
-				break;
+	namespace SimpleTaskQueue_Impl {
+		
+		//
+		class RunNextTaskTask : public AsyncTask {
+		public:
+			//
+			RunNextTaskTask(const SimpleTaskQueueImplPtr& impl) : mImpl(impl) {
 			}
 			
-			QueueEntryPtr nextTask = impl->mTasks.front();
-			impl->mTasks.pop();
-			pthread_mutex_unlock(&impl->mMutex);
+			//
+			virtual void PerformTask(const HermitPtr& h_) override {
+				mImpl->RunNextTask();
+			}
 			
-			nextTask->mTask->PerformTask(nextTask->mH_);
-		}
-		
-		pthread_mutex_lock(&impl->mMutex);
-		pthread_cond_signal(&impl->mCondition);
-		pthread_mutex_unlock(&impl->mMutex);
+			//
+			SimpleTaskQueueImplPtr mImpl;
+		};
 		
-		pthread_exit(nullptr);
+	} // namespace SimpleTaskQueue_Impl
+	
+	//
+	void SimpleTaskQueueImpl::Dispatch() {
+		auto task = std::make_shared<RunNextTaskTask>(shared_from_this());
+		if (!QueueThreadPoolTask(nullptr, task, kSimpleTaskQueuePriority)) {
+			// the pool only refuses work once it has been shut down, so the queued tasks can't
+			// run either; drop them and refuse new work, as TaskQueue does
+			StaticLog("SimpleTaskQueue: QueueThreadPoolTask failed");
+			std::lock_guard<std::mutex> lock(mMutex);
+			while (!mTasks.empty()) {
+				mTasks.pop();
+			}
+			mQuit = true;
+			mRunning = false;
+			mCondition.notify_all();
+		}
 	}
-
+	
 	//
 	SimpleTaskQueue::SimpleTaskQueue() :
 	mImpl(std::make_shared<SimpleTaskQueueImpl>()) {
-		mImpl->mThread = std::thread(SimpleTaskQueueThreadProc, mImpl);
 	}
 	
 	//
@@ -120,11 +184,7 @@ namespace hermit {
 	//
 	bool SimpleTaskQueue::QueueTask(const HermitPtr& h_, const AsyncTaskPtr& task) {
 		QueueEntryPtr entry(new QueueEntry(h_, task));
-		pthread_mutex_lock(&mImpl->mMutex);
-		mImpl->mTasks.push(entry);
-		pthread_cond_signal(&mImpl->mCondition);
-		pthread_mutex_unlock(&mImpl->mMutex);
-		return true;
+		return mImpl->QueueTask(entry);
 	}
 	
 } // namespace hermit
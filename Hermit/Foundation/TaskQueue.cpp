@@ -16,16 +16,24 @@
 //	along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
 #include <queue>
 #include <thread>
 #include <vector>
 #include "Notification.h"
 #include "StaticLog.h"
+#include "ThreadPool.h"
 #include "TaskQueue.h"
 
 namespace hermit {
 	namespace TaskQueue_Impl {
 		
+		// queued tasks already wait their turn behind the rest of the queue so they go
+		// ahead of general pool work
+		const int32_t kTaskQueuePriority = 0;
+		
 		//
 		class QueueEntry {
 		public:
@@ -43,54 +51,69 @@ namespace hermit {
 		typedef std::queue<QueueEntryPtr> Queue;
 		
 		//
-		class QueueInfoImpl : public QueueInfo {
+		class QueueInfoImpl;
+		typedef std::shared_ptr<QueueInfoImpl> QueueInfoImplPtr;
+		
+		// Tasks run one at a time on the shared ThreadPool; the next one isn't started until
+		// TaskComplete() is called for the current one. That can happen before the current
+		// one returns from PerformTask, so two RunTasks can briefly be in flight at once.
+		class QueueInfoImpl : public QueueInfo, public std::enable_shared_from_this<QueueInfoImpl> {
 		public:
 			//
 			QueueInfoImpl();
 			
+			//
+			bool QueueTask(const QueueEntryPtr& entry);
+			
+			//
+			void TaskComplete();
+			
+			//
+			void Dispatch(const QueueEntryPtr& entry);
+			
+			//
+			bool TaskStarting();
+			
+			//
+			void TaskReturned(bool started);
+			
 			//
 			void Shutdown();
 			
 			//
+			std::mutex mMutex;
+			std::condition_variable mCondition;
 			Queue mTasks;
-			std::thread mThread;
-			pthread_attr_t mAttr;
-			pthread_mutex_t mMutex;
-			pthread_cond_t mCondition;
 			bool mBusy;
+			int mTasksInFlight;
+			std::vector<std::thread::id> mRunningThreads;
 			bool mQuit;
 		};
-		typedef std::shared_ptr<QueueInfoImpl> QueueInfoImplPtr;
 		
 		//
-		void ThreadProc(QueueInfoPtr param) {
-			auto queueInfo = std::static_pointer_cast<QueueInfoImpl>(param);
-			while (true) {
-				pthread_mutex_lock(&queueInfo->mMutex);
-				while (!queueInfo->mQuit && (queueInfo->mTasks.empty() || queueInfo->mBusy)) {
-					pthread_cond_wait(&queueInfo->mCondition, &queueInfo->mMutex);
-				}
-				if (queueInfo->mQuit) {
-					pthread_mutex_unlock(&queueInfo->mMutex);
-					break;
+		class RunTask : public AsyncTask {
+		public:
+			//
+			RunTask(const QueueInfoImplPtr& queueInfo, const QueueEntryPtr& entry) :
+			mQueueInfo(queueInfo),
+			mEntry(entry) {
+			}
+			
+			//
+			virtual void PerformTask(const HermitPtr& h_) override {
+				if (mQueueInfo->TaskStarting()) {
+					mEntry->mTask->PerformTask(mEntry->mH_);
+					mQueueInfo->TaskReturned(true);
 				}
-				
-				QueueEntryPtr nextTask = queueInfo->mTasks.front();
-				queueInfo->mTasks.pop();
-				queueInfo->mBusy = true;
-				pthread_mutex_unlock(&queueInfo->mMutex);
-				
-				if (nextTask != nullptr) {
-					nextTask->mTask->PerformTask(nextTask->mH_);
+				else {
+					mQueueInfo->TaskReturned(false);
 				}
 			}
 			
-			pthread_mutex_lock(&queueInfo->mMutex);
-			pthread_cond_signal(&queueInfo->mCondition);
-			pthread_mutex_unlock(&queueInfo->mMutex);
-			
-			pthread_exit(nullptr);
-		}
+			//
+			QueueInfoImplPtr mQueueInfo;
+			QueueEntryPtr mEntry;
+		};
 		
 	} // namespace TaskQueue_Impl
 	using namespace TaskQueue_Impl;
@@ -98,17 +121,96 @@ namespace hermit {
 	//
 	QueueInfoImpl::QueueInfoImpl() :
 		mBusy(false),
+		mTasksInFlight(0),
 		mQuit(false) {
-		
-		pthread_mutex_init(&mMutex, nullptr);
-		pthread_cond_init(&mCondition, nullptr);
-		pthread_attr_init(&mAttr);
-		pthread_attr_setdetachstate(&mAttr, PTHREAD_CREATE_JOINABLE);
+	}
+	
+	//
+	bool QueueInfoImpl::QueueTask(const QueueEntryPtr& entry) {
+		QueueEntryPtr nextTask;
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (mQuit) {
+				return false;
+			}
+			mTasks.push(entry);
+			if (!mBusy) {
+				nextTask = mTasks.front();
+				mTasks.pop();
+				mBusy = true;
+				++mTasksInFlight;
+			}
+		}
+		if (nextTask != nullptr) {
+			Dispatch(nextTask);
+		}
+		return true;
+	}
+	
+	//
+	void QueueInfoImpl::TaskComplete() {
+		QueueEntryPtr nextTask;
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mBusy = false;
+			if (!mQuit && !mTasks.empty()) {
+				nextTask = mTasks.front();
+				mTasks.pop();
+				mBusy = true;
+				++mTasksInFlight;
+			}
+		}
+		if (nextTask != nullptr) {
+			Dispatch(nextTask);
+		}
+	}
+	
+	//
+	void QueueInfoImpl::Dispatch(const QueueEntryPtr& entry) {
+		auto task = std::make_shared<RunTask>(shared_from_this(), entry);
+		if (!QueueThreadPoolTask(entry->mH_, task, kTaskQueuePriority)) {
+			// the pool only refuses work once it has been shut down, so nothing behind this
+			// entry could run either. drop them all and refuse new work, rather than leave the
+			// queue busy with a task that will never complete.
+			StaticLog("TaskQueue: QueueThreadPoolTask failed");
+			NOTIFY_ERROR(entry->mH_, "TaskQueue: QueueThreadPoolTask failed, task dropped.");
+			std::lock_guard<std::mutex> lock(mMutex);
+			while (!mTasks.empty()) {
+				mTasks.pop();
+			}
+			mQuit = true;
+			mBusy = false;
+			--mTasksInFlight;
+			mCondition.notify_all();
+		}
+	}
+	
+	// a task dispatched just before Shutdown() is dropped like the rest of the queue
+	bool QueueInfoImpl::TaskStarting() {
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (mQuit) {
+			return false;
+		}
+		mRunningThreads.push_back(std::this_thread::get_id());
+		return true;
+	}
+	
+	//
+	void QueueInfoImpl::TaskReturned(bool started) {
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (started) {
+			auto it = std::find(mRunningThreads.begin(), mRunningThreads.end(), std::this_thread::get_id());
+			if (it != mRunningThreads.end()) {
+				mRunningThreads.erase(it);
+			}
+		}
+		--mTasksInFlight;
+		mCondition.notify_all();
 	}
 	
 	//
 	void QueueInfoImpl::Shutdown() {
-		pthread_mutex_lock(&mMutex);
+		std::unique_lock<std::mutex> lock(mMutex);
 		
 		if (!mTasks.empty()) {
 			StaticLog("QueueInfoImpl::Shutdown(): !mTasks.empty()");
@@ -117,18 +219,19 @@ namespace hermit {
 			}
 		}
 		mQuit = true;
-		pthread_cond_signal(&mCondition);
-		pthread_mutex_unlock(&mMutex);
 		
-		mThread.join();
+		// like joining the old dedicated thread, wait for tasks that are still running, other
+		// than the one calling us
+		auto thisThread = std::this_thread::get_id();
+		int calledFromTask = (std::find(mRunningThreads.begin(), mRunningThreads.end(), thisThread) != mRunningThreads.end()) ? 1 : 0;
+		while (mTasksInFlight > calledFromTask) {
+			mCondition.wait(lock);
+		}
 	}
 	
 	//
 	TaskQueue::TaskQueue() :
 		mQueueInfo(std::make_shared<QueueInfoImpl>()) {
-		
-		auto queueInfo = std::static_pointer_cast<QueueInfoImpl>(mQueueInfo);
-		queueInfo->mThread = std::thread(ThreadProc, mQueueInfo);
 	}
 	
 	//
@@ -139,24 +242,15 @@ namespace hermit {
 	
 	//
 	bool TaskQueue::QueueTask(const HermitPtr& h_, const AsyncTaskPtr& task) {
-		QueueEntryPtr entry(new QueueEntry(h_, task));				
+		QueueEntryPtr entry(new QueueEntry(h_, task));
 		auto queueInfo = std::static_pointer_cast<QueueInfoImpl>(mQueueInfo);
-		pthread_mutex_lock(&queueInfo->mMutex);
-		queueInfo->mTasks.push(entry);
-		pthread_cond_signal(&queueInfo->mCondition);
-		pthread_mutex_unlock(&queueInfo->mMutex);
-		
-		return true;
+		return queueInfo->QueueTask(entry);
 	}
 	
 	//
 	void TaskQueue::TaskComplete() {
 		auto queueInfo = std::static_pointer_cast<QueueInfoImpl>(mQueueInfo);
-		pthread_mutex_lock(&queueInfo->mMutex);
-				
-		queueInfo->mBusy = false;
-		pthread_cond_signal(&queueInfo->mCondition);
-		pthread_mutex_unlock(&queueInfo->mMutex);
+		queueInfo->TaskComplete();
 	}
 	
 } // namespace hermit
@@ -0,0 +1,243 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "StaticLog.h"
+#include "ThreadPool.h"
+
+namespace hermit {
+	namespace ThreadPool_Impl {
+		
+		// at least as many workers as the old fixed-size async queue had, since some tasks block
+		// waiting on others (e.g. streaming file reads waiting on their receivers)
+		const unsigned int kMinWorkerCount = 8;
+		
+		//
+		class QueueEntry {
+		public:
+			//
+			QueueEntry(const HermitPtr& h_, const AsyncTaskPtr& task) : mH_(h_), mTask(task) {
+			}
+			
+			//
+			HermitPtr mH_;
+			AsyncTaskPtr mTask;
+		};
+		typedef std::shared_ptr<QueueEntry> QueueEntryPtr;
+		
+		//
+		typedef std::deque<QueueEntryPtr> Lane;
+		
+		//
+		typedef std::map<int32_t, Lane> LaneMap;
+		
+		//
+		class Worker {
+		public:
+			//
+			void Push(const QueueEntryPtr& entry, int32_t priority) {
+				std::lock_guard<std::mutex> lock(mMutex);
+				mLanes[priority].push_back(entry);
+			}
+			
+			// the owner takes the oldest task of the most urgent lane...
+			QueueEntryPtr Pop() {
+				std::lock_guard<std::mutex> lock(mMutex);
+				auto it = mLanes.begin();
+				if (it == mLanes.end()) {
+					return nullptr;
+				}
+				QueueEntryPtr entry = it->second.front();
+				it->second.pop_front();
+				if (it->second.empty()) {
+					mLanes.erase(it);
+				}
+				return entry;
+			}
+			
+			// ...while thieves take from the other end to stay out of its way
+			QueueEntryPtr Steal() {
+				std::lock_guard<std::mutex> lock(mMutex);
+				auto it = mLanes.begin();
+				if (it == mLanes.end()) {
+					return nullptr;
+				}
+				QueueEntryPtr entry = it->second.back();
+				it->second.pop_back();
+				if (it->second.empty()) {
+					mLanes.erase(it);
+				}
+				return entry;
+			}
+			
+			//
+			size_t Clear() {
+				std::lock_guard<std::mutex> lock(mMutex);
+				size_t count = 0;
+				for (auto& lane : mLanes) {
+					count += lane.second.size();
+				}
+				mLanes.clear();
+				return count;
+			}
+			
+			//
+			std::mutex mMutex;
+			LaneMap mLanes;
+			std::thread mThread;
+		};
+		typedef std::shared_ptr<Worker> WorkerPtr;
+		
+		//
+		static std::mutex sPoolMutex;
+		static bool sPoolStarted = false;
+		static bool sPoolShutDown = false;
+		static std::vector<WorkerPtr> sWorkers;
+		static std::atomic<uint32_t> sNextWorker(0);
+		
+		// idle workers sleep here until sPendingTaskCount goes non-zero
+		static std::mutex sIdleMutex;
+		static std::condition_variable sIdleCondition;
+		static std::atomic<int64_t> sPendingTaskCount(0);
+		static std::atomic<bool> sQuitWorkers(false);
+		
+		//
+		static thread_local int sWorkerIndex = -1;
+		
+		//
+		QueueEntryPtr FindTask(size_t workerIndex) {
+			QueueEntryPtr entry = sWorkers[workerIndex]->Pop();
+			if (entry != nullptr) {
+				return entry;
+			}
+			size_t workerCount = sWorkers.size();
+			for (size_t n = 1; n < workerCount; ++n) {
+				entry = sWorkers[(workerIndex + n) % workerCount]->Steal();
+				if (entry != nullptr) {
+					return entry;
+				}
+			}
+			return nullptr;
+		}
+		
+		//
+		void WorkerThreadProc(size_t workerIndex) {
+			sWorkerIndex = (int)workerIndex;
+			while (!sQuitWorkers) {
+				QueueEntryPtr entry = FindTask(workerIndex);
+				if (entry != nullptr) {
+					--sPendingTaskCount;
+					entry->mTask->PerformTask(entry->mH_);
+					continue;
+				}
+				
+				std::unique_lock<std::mutex> lock(sIdleMutex);
+				while (!sQuitWorkers && (sPendingTaskCount == 0)) {
+					sIdleCondition.wait(lock);
+				}
+			}
+		}
+		
+		// must be called with sPoolMutex held
+		void StartWorkers() {
+			unsigned int workerCount = std::max(std::thread::hardware_concurrency(), kMinWorkerCount);
+			for (unsigned int n = 0; n < workerCount; ++n) {
+				sWorkers.push_back(std::make_shared<Worker>());
+			}
+			for (unsigned int n = 0; n < workerCount; ++n) {
+				sWorkers[n]->mThread = std::thread(WorkerThreadProc, (size_t)n);
+			}
+			sPoolStarted = true;
+		}
+		
+	} // namespace ThreadPool_Impl
+	using namespace ThreadPool_Impl;
+	
+	//
+	bool QueueThreadPoolTask(const HermitPtr& h_, const AsyncTaskPtr& task, const int32_t& priority) {
+		{
+			std::lock_guard<std::mutex> lock(sPoolMutex);
+			if (sPoolShutDown) {
+				return false;
+			}
+			if (!sPoolStarted) {
+				StartWorkers();
+			}
+		}
+		
+		// tasks queued by a worker stay with it (and are likely to find its caches warm), others
+		// are dealt out round-robin
+		size_t workerIndex = 0;
+		if ((sWorkerIndex >= 0) && ((size_t)sWorkerIndex < sWorkers.size())) {
+			workerIndex = (size_t)sWorkerIndex;
+		}
+		else {
+			workerIndex = sNextWorker++ % sWorkers.size();
+		}
+		
+		sWorkers[workerIndex]->Push(std::make_shared<QueueEntry>(h_, task), priority);
+		++sPendingTaskCount;
+		{
+			std::lock_guard<std::mutex> lock(sIdleMutex);
+		}
+		sIdleCondition.notify_one();
+		return true;
+	}
+	
+	//
+	void ShutdownThreadPool() {
+		// a worker can't join itself
+		if (sWorkerIndex >= 0) {
+			StaticLog("ShutdownThreadPool: called from a pool worker, ignored");
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(sPoolMutex);
+			if (!sPoolStarted || sPoolShutDown) {
+				sPoolShutDown = true;
+				return;
+			}
+			sPoolShutDown = true;
+		}
+		
+		size_t abandonedTaskCount = 0;
+		for (auto& worker : sWorkers) {
+			abandonedTaskCount += worker->Clear();
+		}
+		if (abandonedTaskCount > 0) {
+			StaticLog("ShutdownThreadPool: tasks were still queued");
+		}
+		
+		{
+			std::lock_guard<std::mutex> lock(sIdleMutex);
+			sQuitWorkers = true;
+		}
+		sIdleCondition.notify_all();
+		for (auto& worker : sWorkers) {
+			worker->mThread.join();
+		}
+	}
+	
+} // namespace hermit
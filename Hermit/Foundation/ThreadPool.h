@@ -0,0 +1,41 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef ThreadPool_h
+#define ThreadPool_h
+
+#include <cstdint>
+#include "AsyncTaskQueue.h"
+#include "Hermit.h"
+
+namespace hermit {
+	
+	// The process-wide pool of worker threads behind QueueAsyncTask, TaskQueue and SimpleTaskQueue.
+	// Each worker has its own deque per priority (lower values run first); tasks queued from a worker
+	// go on that worker's deque and idle workers steal from the others, so independent work spreads
+	// across every core. Tasks run in no particular order, see TaskQueue / SimpleTaskQueue for
+	// ordered execution. Returns false once the pool has been shut down.
+	bool QueueThreadPoolTask(const HermitPtr& h_, const AsyncTaskPtr& task, const int32_t& priority);
+	
+	// Drops queued tasks and joins the workers. Must not be called from a task running on the
+	// pool; that call is logged and ignored.
+	void ShutdownThreadPool();
+	
+} // namespace hermit
+
+#endif
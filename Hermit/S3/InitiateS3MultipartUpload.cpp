@@ -264,6 +264,12 @@ namespace hermit {
 					
 					std::string contentSHA256("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
 					
+					// the whole-object hash isn't known up front when the object is being streamed
+					std::string signedHeaders("host;x-amz-content-sha256;x-amz-date");
+					if (!dataSHA256Hex.empty()) {
+						signedHeaders += ";x-amz-meta-sha256";
+					}
+					
 					std::string method("POST");
 					std::string canonicalRequest(method);
 					canonicalRequest += "\n";
@@ -280,11 +286,13 @@ namespace hermit {
 					canonicalRequest += "x-amz-date:";
 					canonicalRequest += dateTime;
 					canonicalRequest += "\n";
-					canonicalRequest += "x-amz-meta-sha256:";
-					canonicalRequest += dataSHA256Hex;
-					canonicalRequest += "\n";
+					if (!dataSHA256Hex.empty()) {
+						canonicalRequest += "x-amz-meta-sha256:";
+						canonicalRequest += dataSHA256Hex;
+						canonicalRequest += "\n";
+					}
 					canonicalRequest += "\n";
-					canonicalRequest += "host;x-amz-content-sha256;x-amz-date;x-amz-meta-sha256";
+					canonicalRequest += signedHeaders;
 					canonicalRequest += "\n";
 					canonicalRequest += contentSHA256;
 					
@@ -317,7 +325,8 @@ namespace hermit {
 					authorization += awsRegion;
 					authorization += "/s3/aws4_request";
 					authorization += ",";
-					authorization += "SignedHeaders=host;x-amz-content-sha256;x-amz-date;x-amz-meta-sha256";
+					authorization += "SignedHeaders=";
+					authorization += signedHeaders;
 					authorization += ",";
 					authorization += "Signature=";
 					authorization += stringToSignSHA256Hex;
@@ -325,7 +334,9 @@ namespace hermit {
 					S3ParamVector params;
 					params.push_back(std::make_pair("x-amz-date", dateTime));
 					params.push_back(std::make_pair("x-amz-content-sha256", contentSHA256));
-					params.push_back(std::make_pair("x-amz-meta-sha256", dataSHA256Hex));
+					if (!dataSHA256Hex.empty()) {
+						params.push_back(std::make_pair("x-amz-meta-sha256", dataSHA256Hex));
+					}
 					params.push_back(std::make_pair("Authorization", authorization));
 					
 					std::string url("https://");
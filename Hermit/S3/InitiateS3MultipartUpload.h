@@ -33,7 +33,7 @@ namespace hermit {
 								 S3Result,								// result
 								 std::string);							// uploadId
 		
-		//
+		// dataSHA256Hex may be empty if the hash of the whole object isn't known
 		void InitiateS3MultipartUpload(const HermitPtr& h_,
 									   const http::HTTPSessionPtr& session,
 									   const std::string& awsPublicKey,
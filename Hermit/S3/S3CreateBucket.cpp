@@ -26,6 +26,7 @@
 #include "SignAWSRequestVersion2.h"
 #include "S3CreateBucket.h"
 #include "S3Notification.h"
+#include "S3RetryPolicy.h"
 
 namespace hermit {
 	namespace s3 {
@@ -201,11 +202,7 @@ namespace hermit {
 				mAWSPublicKey(awsPublicKey),
 				mAWSPrivateKey(awsPrivateKey),
 				mCompletion(completion),
-				mLatestResult(S3Result::kUnknown),
-				mRetries(0),
-				mAccessDeniedRetries(0),
-				mSleepInterval(1),
-				mSleepIntervalStep(2) {
+				mRetryPolicy("GetObject", kMaxRetries, false) {
 				}
 				
 				//
@@ -215,10 +212,7 @@ namespace hermit {
 						return;
 					}
 					
-					if (mRetries > 0) {
-						S3NotificationParams params("GetObject", mRetries, mLatestResult);
-						NOTIFY(h_, kS3RetryNotification, &params);
-					}
+					mRetryPolicy.WillAttempt(h_);
 					
 					std::string method("PUT");
 					std::string contentType;
@@ -273,58 +267,19 @@ namespace hermit {
 								const S3Result& result,
 								const S3ParamVector& params,
 								const DataBuffer& responseData) {
-					mLatestResult = result;
-					
-					if (!ShouldRetry(result)) {
-						if (mRetries > 0) {
-							S3NotificationParams params("GetObject", mRetries, result);
-							NOTIFY(h_, kS3RetryCompleteNotification, &params);
-						}
+					auto decision = mRetryPolicy.AttemptComplete(h_, result);
+					if (decision == S3RetryDecision::kDone) {
 						ProcessResult(h_, result, params, responseData);
 						return;
 					}
-					if (++mRetries == kMaxRetries) {
-						S3NotificationParams params("GetObject", mRetries, result);
-						NOTIFY(h_, kS3MaxRetriesExceededNotification, &params);
-						
+					if (decision == S3RetryDecision::kMaxRetriesExceeded) {
 						NOTIFY_ERROR(h_, "Maximum retries exceeded, most recent result:", (int)result);
 						mCompletion->Call(h_, result);
 						return;
 					}
-					
-					int fifthSecondIntervals = mSleepInterval * 5;
-					for (int i = 0; i < fifthSecondIntervals; ++i) {
-						if (CHECK_FOR_ABORT(h_)) {
-							mCompletion->Call(h_, S3Result::kCanceled);
-							return;
-						}
-						std::this_thread::sleep_for(std::chrono::milliseconds(200));
-					}
-					mSleepInterval += mSleepIntervalStep;
-					mSleepIntervalStep += 2;
-					
-					S3CreateBucket(h_);
-				}
-				
-				//
-				bool ShouldRetry(const S3Result& result) {
-					if ((result == S3Result::kTimedOut) ||
-						(result == S3Result::kNetworkConnectionLost) ||
-						(result == S3Result::k500InternalServerError) ||
-						(result == S3Result::k503ServiceUnavailable) ||
-						(result == S3Result::kS3InternalError) ||
-						// borderline candidate for retry, but I've seen it recover "in the wild":
-						(result == S3Result::kHostNotFound)) {
-						return true;
-					}
-					// we allow a single retry on PermissionDenied since i've seen this fail due to
-					// flaky network behavior in the wild. (but we don't want to spam the server in
-					// cases where access is indeed denied so we only do it once.)
-					if ((result == S3Result::k403AccessDenied) && (mAccessDeniedRetries == 0)) {
-						++mAccessDeniedRetries;
-						return true;
+					if (!mRetryPolicy.ScheduleRetry(h_, shared_from_this(), &CreateBucketClass::S3CreateBucket)) {
+						mCompletion->Call(h_, S3Result::kCanceled);
 					}
-					return false;
 				}
 				
 				//
@@ -358,11 +313,7 @@ namespace hermit {
 				std::string mAWSPublicKey;
 				std::string mAWSPrivateKey;
 				S3CompletionBlockPtr mCompletion;
-				S3Result mLatestResult;
-				int mRetries;
-				int mAccessDeniedRetries;
-				int mSleepInterval;
-				int mSleepIntervalStep;
+				S3RetryPolicy mRetryPolicy;
 			};
 			
 			//
@@ -16,118 +16,545 @@
 //	along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#include <map>
+#include <stack>
 #include <string>
+#include <vector>
+#include "Hermit/Encoding/BinaryToBase64.h"
+#include "Hermit/Encoding/CalculateHMACSHA256.h"
+#include "Hermit/Encoding/CalculateMD5.h"
+#include "Hermit/Encoding/CalculateSHA256.h"
 #include "Hermit/Foundation/Notification.h"
-#include "S3DeleteObject.h"
-#include "S3DeleteObjectVersion.h"
-#include "S3ListObjectsWithVersions.h"
+#include "Hermit/String/BinaryStringToHex.h"
+#include "Hermit/String/DecodeXMLEntities.h"
+#include "Hermit/String/EncodeXMLEntities.h"
+#include "Hermit/String/HexStringToBinary.h"
+#include "Hermit/XML/ParseXMLData.h"
+#include "SendS3CommandWithData.h"
 #include "S3DeleteObjects.h"
 
 namespace hermit {
 	namespace s3 {
 		namespace S3DeleteObjects_Impl {
-
-#if 000
+			
 			//
-			class S3ListObjectsWithVersionsClass : public S3ListObjectsWithVersionsCompletion {
+			std::string GetEndpoint(const S3ParamVector& params) {
+				auto end = params.end();
+				for (auto it = params.begin(); it != end; ++it) {
+					if ((*it).first == "Endpoint") {
+						return (*it).second;
+					}
+				}
+				return "";
+			}
+			
+			//	Keys go into the request without the leading slash the single-object calls tolerate.
+			std::string KeyWithoutLeadingSlash(const std::string& key) {
+				if (!key.empty() && (key[0] == '/')) {
+					return key.substr(1);
+				}
+				return key;
+			}
+			
+			//
+			typedef std::vector<std::pair<std::string, std::string>> KeyErrorVector;
+			
+			//	Picks the Key and Code out of each Error element of a DeleteResult. In quiet mode
+			//	those are all the response lists.
+			class ProcessXMLClass : xml::ParseXMLClient {
+			private:
+				//
+				enum class ParseState {
+					kNew,
+					kDeleteResult,
+					kError,
+					kKey,
+					kCode,
+					kIgnoredElement
+				};
+				
+				//
+				typedef std::stack<ParseState> ParseStateStack;
+				
 			public:
 				//
+				ProcessXMLClass(const HermitPtr& h_) : mH_(h_), mParseState(ParseState::kNew) {
+				}
+				
 				//
-				S3ListObjectsWithVersionsClass(const HermitPtr& h_,
-											   const std::string& inAWSPublicKey,
-											   const std::string& inAWSSigningKey,
-											   const uint64_t& inAWSSigningKeySize,
-											   const std::string& inAWSRegion,
-											   const std::string& inBucketName,
-											   const S3DeleteObjectsCallbackRef& inCallback)
-				:
-				mH_(h_),
-				mBucketName(inBucketName),
-				mAWSPublicKey(inAWSPublicKey),
-				mAWSSigingKey(inAWSSigningKey, inAWSSigningKeySize),
-				mAWSRegion(inAWSRegion),
-				mCallback(inCallback) {
+				xml::ParseXMLStatus Process(const std::string& inXMLData) {
+					return xml::ParseXMLData(mH_, inXMLData, *this);
 				}
 				
 				//
-				bool Function(const S3ListObjectsWithVersionsStatus& inStatus,
-							  const std::string& inObjectKey,
-							  const std::string& inVersion,
-							  const bool& inIsDeleteMarker) {
-					if (inStatus == kS3ListObjectsWithVersionsStatus_Success) {
-						if (inVersion == "null") {
-							auto result = S3DeleteObject(mH_,
-														 mAWSPublicKey,
-														 mAWSSigingKey,
-														 mAWSRegion,
-														 mBucketName,
-														 inObjectKey);
-							
-							if (!mCallback.Call(mBucketName, inObjectKey, "", (result == S3Result::kSuccess))) {
-								return false;
-							}
+				virtual xml::ParseXMLStatus OnStart(const std::string& inStartTag,
+													const std::string& inAttributes,
+													bool inIsEmptyElement) override {
+					if (mParseState == ParseState::kNew) {
+						if (inStartTag == "DeleteResult") {
+							PushState(ParseState::kDeleteResult);
+						}
+						else if (inStartTag != "?xml") {
+							PushState(ParseState::kIgnoredElement);
+						}
+					}
+					else if (mParseState == ParseState::kDeleteResult) {
+						if (inStartTag == "Error") {
+							mErrors.push_back(std::make_pair("", ""));
+							PushState(ParseState::kError);
+						}
+						else {
+							PushState(ParseState::kIgnoredElement);
+						}
+					}
+					else if (mParseState == ParseState::kError) {
+						if (inStartTag == "Key") {
+							PushState(ParseState::kKey);
+						}
+						else if (inStartTag == "Code") {
+							PushState(ParseState::kCode);
 						}
 						else {
-							bool success = S3DeleteObjectVersion(mH_,
-																 mAWSPublicKey,
-																 mAWSSigingKey.data(),
-																 mAWSSigingKey.size(),
-																 mAWSRegion,
-																 mBucketName,
-																 inObjectKey,
-																 inVersion);
-							return mCallback.Call(mBucketName, inObjectKey, inVersion, success);
+							PushState(ParseState::kIgnoredElement);
 						}
 					}
-					return true;
+					else {
+						PushState(ParseState::kIgnoredElement);
+					}
+					if (inIsEmptyElement) {
+						PopState();
+					}
+					return xml::kParseXMLStatus_OK;
+				}
+				
+				//
+				virtual xml::ParseXMLStatus OnContent(const std::string& inContent) override {
+					if (mParseState == ParseState::kKey) {
+						string::DecodeXMLEntities(mH_, inContent, mErrors.back().first);
+					}
+					else if (mParseState == ParseState::kCode) {
+						mErrors.back().second = inContent;
+					}
+					return xml::kParseXMLStatus_OK;
+				}
+				
+				//
+				virtual xml::ParseXMLStatus OnEnd(const std::string& inEndTag) override {
+					PopState();
+					return xml::kParseXMLStatus_OK;
+				}
+				
+				//
+				void PushState(ParseState inNewState) {
+					mParseStateStack.push(mParseState);
+					mParseState = inNewState;
+				}
+				
+				//
+				void PopState() {
+					mParseState = mParseStateStack.top();
+					mParseStateStack.pop();
 				}
 				
-			private:
 				//
 				HermitPtr mH_;
+				ParseState mParseState;
+				ParseStateStack mParseStateStack;
+				KeyErrorVector mErrors;
+			};
+			
+			//
+			S3Result ErrorCodeToResult(const std::string& code) {
+				if (code == "AccessDenied") {
+					return S3Result::k403AccessDenied;
+				}
+				if ((code == "InternalError") || (code == "SlowDown")) {
+					return S3Result::kS3InternalError;
+				}
+				return S3Result::kError;
+			}
+			
+			//
+			class Redirector {
+				//
+				class SendCommandCompletion : public SendS3CommandCompletion {
+				public:
+					//
+					SendCommandCompletion(const http::HTTPSessionPtr& session,
+										  const std::string& url,
+										  int redirectCount,
+										  const std::string& host,
+										  const std::vector<std::string>& objectKeys,
+										  const std::string& payload,
+										  const std::string& contentSHA256Hex,
+										  const std::string& contentMD5Base64,
+										  const std::string& awsPublicKey,
+										  const std::string& awsSigningKey,
+										  const std::string& awsRegion,
+										  const S3DeletedObjectReporterPtr& reporter,
+										  const S3CompletionBlockPtr& completion) :
+					mSession(session),
+					mURL(url),
+					mRedirectCount(redirectCount),
+					mHost(host),
+					mObjectKeys(objectKeys),
+					mPayload(payload),
+					mContentSHA256Hex(contentSHA256Hex),
+					mContentMD5Base64(contentMD5Base64),
+					mAWSPublicKey(awsPublicKey),
+					mAWSSigningKey(awsSigningKey),
+					mAWSRegion(awsRegion),
+					mReporter(reporter),
+					mCompletion(completion) {
+					}
+					
+					//
+					virtual void Call(const HermitPtr& h_,
+									  const S3Result& result,
+									  const S3ParamVector& params,
+									  const DataBuffer& responseData) override {
+						if (result == S3Result::kCanceled) {
+							mCompletion->Call(h_, S3Result::kCanceled);
+							return;
+						}
+						
+						if (result == S3Result::k307TemporaryRedirect) {
+							std::string newEndpoint(GetEndpoint(params));
+							if (newEndpoint.empty()) {
+								NOTIFY_ERROR(h_,
+											 "S3Result::k307TemporaryRedirect but new endpoint is empty for url:",
+											 mURL);
+								mCompletion->Call(h_, S3Result::kError);
+								return;
+							}
+							if (newEndpoint == mHost) {
+								NOTIFY_ERROR(h_,
+											 "S3Result::k307TemporaryRedirect but new endpoint is the same for url:",
+											 mURL);
+								mCompletion->Call(h_, S3Result::kError);
+								return;
+							}
+							S3DeleteObjects(h_,
+											mSession,
+											mRedirectCount + 1,
+											newEndpoint,
+											mObjectKeys,
+											mPayload,
+											mContentSHA256Hex,
+											mContentMD5Base64,
+											mAWSPublicKey,
+											mAWSSigningKey,
+											mAWSRegion,
+											mReporter,
+											mCompletion);
+							return;
+						}
+						if ((result == S3Result::kTimedOut) ||
+							(result == S3Result::kNetworkConnectionLost) ||
+							(result == S3Result::kNoNetworkConnection) ||
+							(result == S3Result::k403AccessDenied) ||
+							(result == S3Result::kS3InternalError) ||
+							(result == S3Result::k500InternalServerError) ||
+							(result == S3Result::k503ServiceUnavailable)) {
+							mCompletion->Call(h_, result);
+							return;
+						}
+						if (result != S3Result::kSuccess) {
+							NOTIFY_ERROR(h_, "SendS3CommandWithData failed for URL:", mURL);
+							mCompletion->Call(h_, S3Result::kError);
+							return;
+						}
+						
+						ProcessXMLClass pxc(h_);
+						std::string responseString(responseData.first, responseData.second);
+						auto status = pxc.Process(responseString);
+						if (status != xml::kParseXMLStatus_OK) {
+							NOTIFY_ERROR(h_, "S3DeleteObjects: ParseXMLData failed for response to URL:", mURL);
+							mCompletion->Call(h_, S3Result::kError);
+							return;
+						}
+						
+						std::map<std::string, std::string> failedKeys;
+						for (auto it = begin(pxc.mErrors); it != end(pxc.mErrors); ++it) {
+							NOTIFY_ERROR(h_, "S3DeleteObjects: failed to delete key:", it->first, "code:", it->second);
+							failedKeys.insert(*it);
+						}
+						for (auto it = begin(mObjectKeys); it != end(mObjectKeys); ++it) {
+							auto failure = failedKeys.find(KeyWithoutLeadingSlash(*it));
+							if (failure != failedKeys.end()) {
+								mReporter->Call(h_, *it, ErrorCodeToResult(failure->second));
+							}
+							else {
+								mReporter->Call(h_, *it, S3Result::kSuccess);
+							}
+						}
+						mCompletion->Call(h_, S3Result::kSuccess);
+					}
+					
+					//
+					http::HTTPSessionPtr mSession;
+					std::string mURL;
+					int mRedirectCount;
+					std::string mHost;
+					std::vector<std::string> mObjectKeys;
+					std::string mPayload;
+					std::string mContentSHA256Hex;
+					std::string mContentMD5Base64;
+					std::string mAWSPublicKey;
+					std::string mAWSSigningKey;
+					std::string mAWSRegion;
+					S3DeletedObjectReporterPtr mReporter;
+					S3CompletionBlockPtr mCompletion;
+				};
+				
+			public:
+				//
+				static void S3DeleteObjects(const HermitPtr& h_,
+											const http::HTTPSessionPtr& session,
+											int redirectCount,
+											const std::string& host,
+											const std::vector<std::string>& objectKeys,
+											const std::string& payload,
+											const std::string& contentSHA256Hex,
+											const std::string& contentMD5Base64,
+											const std::string& awsPublicKey,
+											const std::string& awsSigningKey,
+											const std::string& awsRegion,
+											const S3DeletedObjectReporterPtr& reporter,
+											const S3CompletionBlockPtr& completion) {
+					if (redirectCount > 5) {
+						NOTIFY_ERROR(h_, "Too many temporary redirects for S3DeleteObjects, host:", host);
+						completion->Call(h_, S3Result::kError);
+						return;
+					}
+					
+					time_t now;
+					time(&now);
+					tm globalTime;
+					gmtime_r(&now, &globalTime);
+					char dateBuf[2048];
+					strftime(dateBuf, 2048, "%Y%m%dT%H%M%SZ", &globalTime);
+					std::string dateTime(dateBuf);
+					std::string date(dateTime.substr(0, 8));
+					
+					std::string method("POST");
+					std::string canonicalRequest(method);
+					canonicalRequest += "\n";
+					canonicalRequest += "/";
+					canonicalRequest += "\n";
+					canonicalRequest += "delete=";
+					canonicalRequest += "\n";
+					canonicalRequest += "content-md5:";
+					canonicalRequest += contentMD5Base64;
+					canonicalRequest += "\n";
+					canonicalRequest += "host:";
+					canonicalRequest += host;
+					canonicalRequest += "\n";
+					canonicalRequest += "x-amz-content-sha256:";
+					canonicalRequest += contentSHA256Hex;
+					canonicalRequest += "\n";
+					canonicalRequest += "x-amz-date:";
+					canonicalRequest += dateTime;
+					canonicalRequest += "\n";
+					canonicalRequest += "\n";
+					canonicalRequest += "content-md5;host;x-amz-content-sha256;x-amz-date";
+					canonicalRequest += "\n";
+					canonicalRequest += contentSHA256Hex;
+					
+					std::string canonicalRequestSHA256;
+					encoding::CalculateSHA256(canonicalRequest, canonicalRequestSHA256);
+					std::string canonicalRequestSHA256Hex;
+					string::BinaryStringToHex(canonicalRequestSHA256, canonicalRequestSHA256Hex);
+					
+					std::string stringToSign("AWS4-HMAC-SHA256");
+					stringToSign += "\n";
+					stringToSign += dateTime;
+					stringToSign += "\n";
+					stringToSign += date;
+					stringToSign += "/";
+					stringToSign += awsRegion;
+					stringToSign += "/s3/aws4_request";
+					stringToSign += "\n";
+					stringToSign += canonicalRequestSHA256Hex;
+					
+					std::string stringToSignSHA256;
+					encoding::CalculateHMACSHA256(awsSigningKey, stringToSign, stringToSignSHA256);
+					std::string stringToSignSHA256Hex;
+					string::BinaryStringToHex(stringToSignSHA256, stringToSignSHA256Hex);
+					
+					std::string authorization("AWS4-HMAC-SHA256 Credential=");
+					authorization += awsPublicKey;
+					authorization += "/";
+					authorization += date;
+					authorization += "/";
+					authorization += awsRegion;
+					authorization += "/s3/aws4_request";
+					authorization += ",";
+					authorization += "SignedHeaders=content-md5;host;x-amz-content-sha256;x-amz-date";
+					authorization += ",";
+					authorization += "Signature=";
+					authorization += stringToSignSHA256Hex;
+					
+					S3ParamVector params;
+					params.push_back(std::make_pair("x-amz-date", dateTime));
+					params.push_back(std::make_pair("x-amz-content-sha256", contentSHA256Hex));
+					params.push_back(std::make_pair("Authorization", authorization));
+					params.push_back(std::make_pair("Content-MD5", contentMD5Base64));
+					params.push_back(std::make_pair("Content-Type", "application/xml"));
+					
+					std::string url("https://");
+					url += host;
+					url += "/?delete";
+					
+					auto commandCompletion = std::make_shared<SendCommandCompletion>(session,
+																					 url,
+																					 redirectCount,
+																					 host,
+																					 objectKeys,
+																					 payload,
+																					 contentSHA256Hex,
+																					 contentMD5Base64,
+																					 awsPublicKey,
+																					 awsSigningKey,
+																					 awsRegion,
+																					 reporter,
+																					 completion);
+					SendS3CommandWithData(h_,
+										  session,
+										  url,
+										  method,
+										  params,
+										  std::make_shared<SharedBuffer>(payload),
+										  commandCompletion);
+				}
+			};
+			
+			//	S3 requires a Content-MD5 header on multi-object deletes.
+			class MD5Completion : public encoding::CalculateHashCompletion {
+			public:
+				//
+				MD5Completion(const http::HTTPSessionPtr& session,
+							  const std::string& host,
+							  const std::vector<std::string>& objectKeys,
+							  const std::string& payload,
+							  const std::string& contentSHA256Hex,
+							  const std::string& awsPublicKey,
+							  const std::string& awsSigningKey,
+							  const std::string& awsRegion,
+							  const S3DeletedObjectReporterPtr& reporter,
+							  const S3CompletionBlockPtr& completion) :
+				mSession(session),
+				mHost(host),
+				mObjectKeys(objectKeys),
+				mPayload(payload),
+				mContentSHA256Hex(contentSHA256Hex),
+				mAWSPublicKey(awsPublicKey),
+				mAWSSigningKey(awsSigningKey),
+				mAWSRegion(awsRegion),
+				mReporter(reporter),
+				mCompletion(completion) {
+				}
+				
+				//
+				virtual void Call(const HermitPtr& h_, const encoding::CalculateHashResult& result, const std::string& md5Hex) override {
+					if (result == encoding::CalculateHashResult::kCanceled) {
+						mCompletion->Call(h_, S3Result::kCanceled);
+						return;
+					}
+					if (result != encoding::CalculateHashResult::kSuccess) {
+						NOTIFY_ERROR(h_, "S3DeleteObjects: CalculateMD5 failed for payload.");
+						mCompletion->Call(h_, S3Result::kError);
+						return;
+					}
+					std::string md5;
+					string::HexStringToBinary(md5Hex, md5);
+					std::string md5Base64;
+					encoding::BinaryToBase64(md5, md5Base64);
+					Redirector::S3DeleteObjects(h_,
+												mSession,
+												0,
+												mHost,
+												mObjectKeys,
+												mPayload,
+												mContentSHA256Hex,
+												md5Base64,
+												mAWSPublicKey,
+												mAWSSigningKey,
+												mAWSRegion,
+												mReporter,
+												mCompletion);
+				}
+				
+				//
+				http::HTTPSessionPtr mSession;
+				std::string mHost;
+				std::vector<std::string> mObjectKeys;
+				std::string mPayload;
+				std::string mContentSHA256Hex;
 				std::string mAWSPublicKey;
-				std::string mAWSSigingKey;
+				std::string mAWSSigningKey;
 				std::string mAWSRegion;
-				std::string mBucketName;
-				S3DeletedObjectReporterPtr mDeletedObjectReporter;
+				S3DeletedObjectReporterPtr mReporter;
 				S3CompletionBlockPtr mCompletion;
 			};
-#endif
 			
 		} // namespace S3DeleteObjects_Impl
 		using namespace S3DeleteObjects_Impl;
 		
 		//
 		void S3DeleteObjects(const HermitPtr& h_,
+							 const http::HTTPSessionPtr& session,
 							 const std::string& awsPublicKey,
 							 const std::string& awsSigningKey,
 							 const std::string& awsRegion,
-							 const std::string& bucketName,
-							 const std::string& pathPrefix,
+							 const std::string& s3BucketName,
+							 const std::vector<std::string>& s3ObjectKeys,
 							 const S3DeletedObjectReporterPtr& deletedObjectReporter,
 							 const S3CompletionBlockPtr& completion) {
+			if (s3ObjectKeys.size() > kS3DeleteObjectsMaxKeys) {
+				NOTIFY_ERROR(h_, "S3DeleteObjects: too many keys:", s3ObjectKeys.size());
+				completion->Call(h_, S3Result::kError);
+				return;
+			}
+			if (s3ObjectKeys.empty()) {
+				completion->Call(h_, S3Result::kSuccess);
+				return;
+			}
 			
-			NOTIFY_ERROR(h_, "S3DeleteObjects: not implemented");
-			completion->Call(h_, S3Result::kError);
-		
-			// needs to be updated for async processing and underlying calls need to be updated
-#if 000
-			auto lister = std::make_shared<S3ListObjectsWithVersionsClass>(h_,
-																		   awsPublicKey,
-																		   awsSigningKey,
-																		   awsRegion,
-																		   bucketName,
-																		   deletedObjectReporter,
-																		   completion);
+			std::string payload("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<Delete>\n<Quiet>true</Quiet>\n");
+			for (auto it = begin(s3ObjectKeys); it != end(s3ObjectKeys); ++it) {
+				std::string encodedKey;
+				string::EncodeXMLEntities(KeyWithoutLeadingSlash(*it), encodedKey);
+				payload += "<Object><Key>";
+				payload += encodedKey;
+				payload += "</Key></Object>\n";
+			}
+			payload += "</Delete>";
+			
+			std::string contentSHA256;
+			encoding::CalculateSHA256(payload, contentSHA256);
+			std::string contentSHA256Hex;
+			string::BinaryStringToHex(contentSHA256, contentSHA256Hex);
+			if (contentSHA256Hex.empty()) {
+				NOTIFY_ERROR(h_, "S3DeleteObjects: CalculateSHA256 failed for payload.");
+				completion->Call(h_, S3Result::kError);
+				return;
+			}
+			
+			std::string host(s3BucketName);
+			host += ".s3.amazonaws.com";
 			
-			S3ListObjectsWithVersions(h_,
-									  awsPublicKey,
-									  awsSigningKey,
-									  awsRegion,
-									  bucketName,
-									  pathPrefix,
-									  lister);
-#endif
+			auto md5Completion = std::make_shared<MD5Completion>(session,
+																 host,
+																 s3ObjectKeys,
+																 payload,
+																 contentSHA256Hex,
+																 awsPublicKey,
+																 awsSigningKey,
+																 awsRegion,
+																 deletedObjectReporter,
+																 completion);
+			encoding::CalculateMD5(h_, DataBuffer(md5Completion->mPayload.data(), md5Completion->mPayload.size()), md5Completion);
 		}
 		
 	} // namespace s3
@@ -19,27 +19,37 @@
 #ifndef S3DeleteObjects_h
 #define S3DeleteObjects_h
 
+#include <string>
+#include <vector>
 #include "Hermit/Foundation/AsyncFunction.h"
 #include "Hermit/Foundation/Hermit.h"
+#include "Hermit/HTTP/HTTPSession.h"
 #include "S3Result.h"
 
 namespace hermit {
 	namespace s3 {
 		
+		//	The most keys S3 accepts in one multi-object delete request.
+		const size_t kS3DeleteObjectsMaxKeys = 1000;
+		
 		//
-		DEFINE_ASYNC_FUNCTION_4A(S3DeletedObjectReporter,
+		DEFINE_ASYNC_FUNCTION_3A(S3DeletedObjectReporter,
 								 HermitPtr,
-								 std::string,					// inBucketName
-								 std::string,					// inObjectKey
-								 std::string);					// inObjectVersion
+								 std::string,					// objectKey
+								 S3Result);						// result
 		
-		//
+		//	Deletes up to kS3DeleteObjectsMaxKeys objects with a single multi-object delete
+		//	request. If the request itself succeeds, the reporter is called once for each key,
+		//	before the completion, with that key's own result; as with S3DeleteObject, a key
+		//	with no object counts as deleted. If the request fails, the completion says why and
+		//	the reporter isn't called.
 		void S3DeleteObjects(const HermitPtr& h_,
+							 const http::HTTPSessionPtr& session,
 							 const std::string& awsPublicKey,
 							 const std::string& awsSigningKey,
 							 const std::string& awsRegion,
-							 const std::string& bucketName,
-							 const std::string& pathPrefix,
+							 const std::string& s3BucketName,
+							 const std::vector<std::string>& s3ObjectKeys,
 							 const S3DeletedObjectReporterPtr& deletedObjectReporter,
 							 const S3CompletionBlockPtr& completion);
 		
@@ -0,0 +1,99 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+#include "S3MultipartUploadPlan.h"
+
+namespace hermit {
+	namespace s3 {
+		namespace S3MultipartUploadPlan_Impl {
+			
+			//
+			const int32_t kDefaultMaxPartsInFlight = 4;
+			const uint64_t kDefaultMemoryBudget = 64 * 1024 * 1024;
+			
+			// part sizes are rounded up to a whole number of these
+			const uint64_t kPartSizeGranularity = 1024 * 1024;
+			
+			//
+			uint64_t DivideRoundingUp(uint64_t value, uint64_t divisor) {
+				return (value + divisor - 1) / divisor;
+			}
+			
+		} // namespace S3MultipartUploadPlan_Impl
+		using namespace S3MultipartUploadPlan_Impl;
+		
+		//
+		S3MultipartUploadOptions::S3MultipartUploadOptions() :
+		mMaxPartsInFlight(kDefaultMaxPartsInFlight),
+		mMemoryBudget(kDefaultMemoryBudget) {
+		}
+		
+		//
+		S3MultipartUploadOptions::S3MultipartUploadOptions(int32_t maxPartsInFlight, uint64_t memoryBudget) :
+		mMaxPartsInFlight(maxPartsInFlight),
+		mMemoryBudget(memoryBudget) {
+		}
+		
+		//
+		S3MultipartUploadPlan::S3MultipartUploadPlan() :
+		mObjectSize(0),
+		mPartSize(0),
+		mNumberOfParts(0),
+		mMaxPartsInFlight(0) {
+		}
+		
+		//
+		bool PlanS3MultipartUpload(uint64_t objectSize,
+								   const S3MultipartUploadOptions& options,
+								   S3MultipartUploadPlan& outPlan) {
+			if (objectSize > kS3MaxObjectSize) {
+				return false;
+			}
+			
+			uint64_t window = (uint64_t)std::max(options.mMaxPartsInFlight, 1);
+			uint64_t minPartSize = std::max(kS3MinPartSize, DivideRoundingUp(objectSize, kS3MaxParts));
+			
+			// as large as the memory budget allows, but no larger than needed to keep the window full
+			uint64_t partSize = options.mMemoryBudget / window;
+			if (objectSize > 0) {
+				partSize = std::min(partSize, DivideRoundingUp(objectSize, window));
+			}
+			partSize = std::max(partSize, minPartSize);
+			partSize = DivideRoundingUp(partSize, kPartSizeGranularity) * kPartSizeGranularity;
+			partSize = std::min(partSize, kS3MaxPartSize);
+			
+			// if the parts had to be larger than the budget allows, give up concurrency rather than memory
+			uint64_t partsInBudget = std::max(options.mMemoryBudget / partSize, (uint64_t)1);
+			uint64_t maxPartsInFlight = std::min(window, partsInBudget);
+			
+			uint64_t numberOfParts = 0;
+			if (objectSize > 0) {
+				numberOfParts = DivideRoundingUp(objectSize, partSize);
+				maxPartsInFlight = std::min(maxPartsInFlight, numberOfParts);
+			}
+			
+			outPlan.mObjectSize = objectSize;
+			outPlan.mPartSize = partSize;
+			outPlan.mNumberOfParts = (int32_t)numberOfParts;
+			outPlan.mMaxPartsInFlight = (int32_t)maxPartsInFlight;
+			return true;
+		}
+		
+	} // namespace s3
+} // namespace hermit
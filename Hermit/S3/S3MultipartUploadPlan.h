@@ -0,0 +1,75 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef S3MultipartUploadPlan_h
+#define S3MultipartUploadPlan_h
+
+#include <cstdint>
+
+namespace hermit {
+	namespace s3 {
+		
+		// limits imposed by S3 on multipart uploads
+		const uint64_t kS3MinPartSize = 5ULL * 1024 * 1024;
+		const uint64_t kS3MaxPartSize = 5ULL * 1024 * 1024 * 1024;
+		const uint64_t kS3MaxObjectSize = 5ULL * 1024 * 1024 * 1024 * 1024;
+		const int32_t kS3MaxParts = 10000;
+		
+		//
+		struct S3MultipartUploadOptions {
+			//
+			S3MultipartUploadOptions();
+			
+			//
+			S3MultipartUploadOptions(int32_t maxPartsInFlight, uint64_t memoryBudget);
+			
+			// how many parts may be uploading at once
+			int32_t mMaxPartsInFlight;
+			
+			// upper bound on the bytes held by part buffers that are in flight; larger budgets
+			// allow larger parts and therefore fewer requests
+			uint64_t mMemoryBudget;
+		};
+		
+		//
+		struct S3MultipartUploadPlan {
+			//
+			S3MultipartUploadPlan();
+			
+			//
+			uint64_t mObjectSize;
+			uint64_t mPartSize;
+			int32_t mNumberOfParts;
+			int32_t mMaxPartsInFlight;
+		};
+		
+		// Picks a part size within S3's bounds that keeps the part count under kS3MaxParts,
+		// keeps mMaxPartsInFlight parts within the memory budget where possible, and doesn't
+		// make parts so large that the concurrency window can't be filled. Every part is
+		// mPartSize bytes except the last, which holds whatever remains.
+		// An objectSize of 0 means the size isn't known up front (e.g. a stream); the plan then
+		// has no part count and the object can be at most kS3MaxParts * mPartSize bytes.
+		// Returns false if the object is too large to upload.
+		bool PlanS3MultipartUpload(uint64_t objectSize,
+								   const S3MultipartUploadOptions& options,
+								   S3MultipartUploadPlan& outPlan);
+		
+	} // namespace s3
+} // namespace hermit
+
+#endif
@@ -25,6 +25,7 @@ namespace s3 {
 const char* kS3RetryNotification = "s3retry";
 const char* kS3RetryCompleteNotification = "s3retrycomplete";
 const char* kS3MaxRetriesExceededNotification = "s3maxretriesexceeded";
+const char* kS3MultipartUploadPlanNotification = "s3multipartuploadplan";
 
 //
 S3NotificationParams::S3NotificationParams(const char* opName, int32_t count, S3Result result) :
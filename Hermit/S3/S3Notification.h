@@ -30,6 +30,9 @@ extern const char* kS3RetryNotification;
 extern const char* kS3RetryCompleteNotification;
 extern const char* kS3MaxRetriesExceededNotification;
 
+// param is const S3MultipartUploadPlan*
+extern const char* kS3MultipartUploadPlanNotification;
+
 //
 struct S3NotificationParams {
 	//
@@ -0,0 +1,45 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "S3RangedGetOptions.h"
+
+namespace hermit {
+	namespace s3 {
+		namespace S3RangedGetOptions_Impl {
+			
+			//
+			const uint64_t kDefaultRangeSize = 8 * 1024 * 1024;
+			const int32_t kDefaultMaxRangesInFlight = 4;
+			
+		} // namespace S3RangedGetOptions_Impl
+		using namespace S3RangedGetOptions_Impl;
+		
+		//
+		S3RangedGetOptions::S3RangedGetOptions() :
+		mRangeSize(kDefaultRangeSize),
+		mMaxRangesInFlight(kDefaultMaxRangesInFlight) {
+		}
+		
+		//
+		S3RangedGetOptions::S3RangedGetOptions(uint64_t rangeSize, int32_t maxRangesInFlight) :
+		mRangeSize(rangeSize),
+		mMaxRangesInFlight(maxRangesInFlight) {
+		}
+		
+	} // namespace s3
+} // namespace hermit
@@ -0,0 +1,46 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef S3RangedGetOptions_h
+#define S3RangedGetOptions_h
+
+#include <cstdint>
+
+namespace hermit {
+	namespace s3 {
+		
+		//
+		struct S3RangedGetOptions {
+			//
+			S3RangedGetOptions();
+			
+			//
+			S3RangedGetOptions(uint64_t rangeSize, int32_t maxRangesInFlight);
+			
+			// bytes requested per GET; objects no larger than this take a single request
+			uint64_t mRangeSize;
+			
+			// how many ranges may be downloading or waiting to be delivered in order at once;
+			// at most mRangeSize * mMaxRangesInFlight bytes are buffered
+			int32_t mMaxRangesInFlight;
+		};
+		
+	} // namespace s3
+} // namespace hermit
+
+#endif
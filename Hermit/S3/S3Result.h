@@ -38,6 +38,7 @@ namespace hermit {
 			k403AccessDenied,
 			k404EntityNotFound,
 			k404NoSuchBucket,
+			k416RequestedRangeNotSatisfiable,
 			k500InternalServerError,
 			k503ServiceUnavailable,
 			kS3InternalError,
@@ -0,0 +1,112 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+#include <random>
+#include "S3Notification.h"
+#include "S3RetryPolicy.h"
+
+namespace hermit {
+	namespace s3 {
+		namespace S3RetryPolicy_Impl {
+			
+			//
+			const uint64_t kInitialRetryDelayInMilliseconds = 1000;
+			const uint64_t kMaxRetryDelayInMilliseconds = 30000;
+			
+			//
+			uint64_t RandomValue(uint64_t maxValue) {
+				static thread_local std::mt19937_64 sGenerator(std::random_device{}());
+				std::uniform_int_distribution<uint64_t> distribution(0, maxValue);
+				return distribution(sGenerator);
+			}
+			
+		} // namespace S3RetryPolicy_Impl
+		using namespace S3RetryPolicy_Impl;
+		
+		//
+		S3RetryPolicy::S3RetryPolicy(const char* opName, int maxRetries, bool retryChecksumMismatch) :
+		mOpName(opName),
+		mMaxRetries(maxRetries),
+		mRetryChecksumMismatch(retryChecksumMismatch),
+		mRetries(0),
+		mAccessDeniedRetries(0),
+		mLatestResult(S3Result::kUnknown) {
+		}
+		
+		//
+		void S3RetryPolicy::WillAttempt(const HermitPtr& h_) {
+			if (mRetries > 0) {
+				S3NotificationParams params(mOpName, mRetries, mLatestResult);
+				NOTIFY(h_, kS3RetryNotification, &params);
+			}
+		}
+		
+		//
+		S3RetryDecision S3RetryPolicy::AttemptComplete(const HermitPtr& h_, const S3Result& result) {
+			mLatestResult = result;
+			
+			if (!ShouldRetry(result)) {
+				if (mRetries > 0) {
+					S3NotificationParams params(mOpName, mRetries, result);
+					NOTIFY(h_, kS3RetryCompleteNotification, &params);
+				}
+				return S3RetryDecision::kDone;
+			}
+			if (++mRetries == mMaxRetries) {
+				S3NotificationParams params(mOpName, mRetries, result);
+				NOTIFY(h_, kS3MaxRetriesExceededNotification, &params);
+				return S3RetryDecision::kMaxRetriesExceeded;
+			}
+			return S3RetryDecision::kRetry;
+		}
+		
+		//
+		bool S3RetryPolicy::ShouldRetry(const S3Result& result) {
+			if ((result == S3Result::kTimedOut) ||
+				(result == S3Result::kNetworkConnectionLost) ||
+				((result == S3Result::kChecksumMismatch) && mRetryChecksumMismatch) ||
+				(result == S3Result::k500InternalServerError) ||
+				(result == S3Result::k503ServiceUnavailable) ||
+				(result == S3Result::kS3InternalError) ||
+				// borderline candidate for retry, but I've seen it recover "in the wild":
+				(result == S3Result::kHostNotFound)) {
+				return true;
+			}
+			// we allow a single retry on PermissionDenied since i've seen this fail due to
+			// flaky network behavior in the wild. (but we don't want to spam the server in
+			// cases where access is indeed denied so we only do it once.)
+			if ((result == S3Result::k403AccessDenied) && (mAccessDeniedRetries == 0)) {
+				++mAccessDeniedRetries;
+				return true;
+			}
+			return false;
+		}
+		
+		//
+		uint64_t S3RetryPolicy::NextDelayInMilliseconds() const {
+			uint64_t delay = kMaxRetryDelayInMilliseconds;
+			int doublings = std::max(mRetries - 1, 0);
+			if (doublings < 16) {
+				delay = std::min(kInitialRetryDelayInMilliseconds << doublings, kMaxRetryDelayInMilliseconds);
+			}
+			return (delay / 2) + RandomValue(delay / 2);
+		}
+		
+	} // namespace s3
+} // namespace hermit
@@ -0,0 +1,110 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef S3RetryPolicy_h
+#define S3RetryPolicy_h
+
+#include <cstdint>
+#include <memory>
+#include "Hermit/Foundation/AsyncTaskQueue.h"
+#include "Hermit/Foundation/DelayedTaskQueue.h"
+#include "Hermit/Foundation/Hermit.h"
+#include "S3Result.h"
+
+namespace hermit {
+	namespace s3 {
+		
+		//
+		const int32_t kS3RetryTaskPriority = 10;
+		
+		//
+		enum class S3RetryDecision {
+			kDone,
+			kRetry,
+			kMaxRetriesExceeded
+		};
+		
+		// Runs (target->*attempt)(h_) when performed.
+		template <typename T>
+		class S3RetryTaskT : public AsyncTask {
+		public:
+			//
+			typedef void (T::*AttemptFunction)(const HermitPtr& h_);
+			
+			//
+			S3RetryTaskT(const std::shared_ptr<T>& target, AttemptFunction attempt) :
+			mTarget(target),
+			mAttempt(attempt) {
+			}
+			
+			//
+			virtual void PerformTask(const HermitPtr& h_) override {
+				((*mTarget).*mAttempt)(h_);
+			}
+			
+			//
+			std::shared_ptr<T> mTarget;
+			AttemptFunction mAttempt;
+		};
+		
+		// The retry rules shared by S3 requests: which results are worth another attempt, how many
+		// attempts to make, and a jittered exponential backoff between them. The retry itself is
+		// scheduled on the DelayedTaskQueue so no thread sits in a sleep while waiting.
+		class S3RetryPolicy {
+		public:
+			// Requests whose responses carry no checksum of ours (bucket listing and creation) pass
+			// false for retryChecksumMismatch.
+			S3RetryPolicy(const char* opName, int maxRetries, bool retryChecksumMismatch = true);
+			
+			// Call at the start of each attempt, posts kS3RetryNotification for retries.
+			void WillAttempt(const HermitPtr& h_);
+			
+			// Decides what to do with the result of an attempt and posts the matching notification.
+			S3RetryDecision AttemptComplete(const HermitPtr& h_, const S3Result& result);
+			
+			//
+			bool ShouldRetry(const S3Result& result);
+			
+			// Backoff before the next attempt: doubles with each retry up to a cap, with the upper
+			// half randomized so that requests that failed together don't retry together.
+			uint64_t NextDelayInMilliseconds() const;
+			
+			// Calls (target->*attempt)(h_) after the backoff, or sooner if h_ aborts in the meantime
+			// (the attempt is expected to check for abort first). Returns false if the task queue
+			// has been shut down.
+			template <typename T>
+			bool ScheduleRetry(const HermitPtr& h_,
+							   const std::shared_ptr<T>& target,
+							   typename S3RetryTaskT<T>::AttemptFunction attempt) {
+				auto task = std::make_shared<S3RetryTaskT<T>>(target, attempt);
+				return QueueDelayedTask(h_, task, kS3RetryTaskPriority, NextDelayInMilliseconds());
+			}
+			
+			//
+			const char* mOpName;
+			int mMaxRetries;
+			bool mRetryChecksumMismatch;
+			int mRetries;
+			int mAccessDeniedRetries;
+			S3Result mLatestResult;
+		};
+		
+	} // namespace s3
+} // namespace hermit
+
+#endif
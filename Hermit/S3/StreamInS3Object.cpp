@@ -164,6 +164,7 @@ namespace hermit {
 					//
 					StreamInCompletion(const http::HTTPSessionPtr& session,
 									   const std::string& url,
+									   const std::string& range,
 									   int redirectCount,
 									   const std::string& host,
 									   const std::string& s3Path,
@@ -172,9 +173,10 @@ namespace hermit {
 									   const std::string& awsRegion,
 									   const ReceiverPtr& ourDataReceiver,
 									   const DataReceiverPtr& theirDataReceiver,
-									   const S3CompletionBlockPtr& completion) :
+									   const StreamInS3RequestCompletionPtr& completion) :
 					mSession(session),
 					mURL(url),
+					mRange(range),
 					mRedirectCount(redirectCount),
 					mHost(host),
 					mS3Path(s3Path),
@@ -190,70 +192,77 @@ namespace hermit {
 					class Completion : public DataCompletion {
 					public:
 						//
-						Completion(const S3CompletionBlockPtr& completion) : mCompletion(completion) {
+						Completion(const S3ParamVector& params, const StreamInS3RequestCompletionPtr& completion) :
+						mParams(params),
+						mCompletion(completion) {
 						}
 						
 						//
 						virtual void Call(const HermitPtr& h_, const StreamDataResult& result) override {
 							if (result == StreamDataResult::kCanceled) {
-								mCompletion->Call(h_, S3Result::kCanceled);
+								mCompletion->Call(h_, S3Result::kCanceled, S3ParamVector());
 								return;
 							}
 							if (result != StreamDataResult::kSuccess) {
 								NOTIFY_ERROR(h_, "StreamData failed.");
-								mCompletion->Call(h_, S3Result::kError);
+								mCompletion->Call(h_, S3Result::kError, S3ParamVector());
 								return;
 							}
-							mCompletion->Call(h_, S3Result::kSuccess);
+							mCompletion->Call(h_, S3Result::kSuccess, mParams);
 						}
 						
 						//
-						S3CompletionBlockPtr mCompletion;
+						S3ParamVector mParams;
+						StreamInS3RequestCompletionPtr mCompletion;
 					};
 					
 					//
 					virtual void Call(const HermitPtr& h_, const S3Result& result, const S3ParamVector& params) override {
 						if (result != S3Result::kSuccess) {
 							if (result == S3Result::kCanceled) {
-								mCompletion->Call(h_, S3Result::kCanceled);
+								mCompletion->Call(h_, S3Result::kCanceled, S3ParamVector());
 								return;
 							}
 							if (result == S3Result::kAuthorizationHeaderMalformed) {
-								mCompletion->Call(h_, S3Result::kAuthorizationHeaderMalformed);
+								mCompletion->Call(h_, S3Result::kAuthorizationHeaderMalformed, S3ParamVector());
 								return;
 							}
 							if (result == S3Result::k400BadRequest) {
-								mCompletion->Call(h_, S3Result::k400BadRequest);
+								mCompletion->Call(h_, S3Result::k400BadRequest, S3ParamVector());
 								return;
 							}
 							if (result == S3Result::k403AccessDenied) {
-								mCompletion->Call(h_, S3Result::k403AccessDenied);
+								mCompletion->Call(h_, S3Result::k403AccessDenied, S3ParamVector());
 								return;
 							}
 							if (result == S3Result::k404EntityNotFound) {
-								mCompletion->Call(h_, S3Result::k404EntityNotFound);
+								mCompletion->Call(h_, S3Result::k404EntityNotFound, S3ParamVector());
 								return;
 							}
 							if (result == S3Result::k404NoSuchBucket) {
-								mCompletion->Call(h_, S3Result::k404NoSuchBucket);
+								mCompletion->Call(h_, S3Result::k404NoSuchBucket, S3ParamVector());
+								return;
+							}
+							if (result == S3Result::k416RequestedRangeNotSatisfiable) {
+								mCompletion->Call(h_, S3Result::k416RequestedRangeNotSatisfiable, S3ParamVector());
 								return;
 							}
 							if (result == S3Result::kNetworkConnectionLost) {
-								mCompletion->Call(h_, S3Result::kNetworkConnectionLost);
+								mCompletion->Call(h_, S3Result::kNetworkConnectionLost, S3ParamVector());
 								return;
 							}
 							if ((result == S3Result::kS3InternalError) ||
 								(result == S3Result::k500InternalServerError) ||
 								(result == S3Result::k503ServiceUnavailable)) {
-								mCompletion->Call(h_, result);
+								mCompletion->Call(h_, result, S3ParamVector());
 								return;
 							}
 							if (result == S3Result::kTimedOut) {
-								mCompletion->Call(h_, S3Result::kTimedOut);
+								mCompletion->Call(h_, S3Result::kTimedOut, S3ParamVector());
 								return;
 							}
 							if (result == S3Result::k301PermanentRedirect) {
-								mCompletion->Call(h_, S3Result::k301PermanentRedirect);
+								mCompletion->Call(h_, S3Result::k301PermanentRedirect, S3ParamVector());
 								return;
 							}
 							if (result == S3Result::k307TemporaryRedirect) {
@@ -264,20 +273,21 @@ namespace hermit {
 										NOTIFY_ERROR(h_,
 													 "S3Result::k307TemporaryRedirect but new endpoint is empty for host:",
 													 mHost);
-										mCompletion->Call(h_, S3Result::kError);
+										mCompletion->Call(h_, S3Result::kError, S3ParamVector());
 										return;
 									}
 									if (pc.mEndpoint == mHost) {
 										NOTIFY_ERROR(h_,
 													 "S3Result::k307TemporaryRedirect but new endpoint is the same for host:",
 													 mHost);
-										mCompletion->Call(h_, S3Result::kError);
+										mCompletion->Call(h_, S3Result::kError, S3ParamVector());
 										return;
 									}
 									// Reset the data buffer, otherwise the result of the redirect will be appended.
 									mOurDataReceiver->mData.clear();
 									StreamInS3Object(h_,
 													 mSession,
+													 mRange,
 													 mRedirectCount + 1,
 													 pc.mEndpoint,
 													 mS3Path,
@@ -293,30 +303,31 @@ namespace hermit {
 								NOTIFY_ERROR(h_,
 											 "Unparsed 307 Temporary Redirect for host:", mHost,
 											 "response:", mOurDataReceiver->mData);
-								mCompletion->Call(h_, S3Result::kError);
+								mCompletion->Call(h_, S3Result::kError, S3ParamVector());
 								return;
 							}
 							NOTIFY_ERROR(h_, "StreamInS3Request failed for URL:", mURL);
-							mCompletion->Call(h_, result);
+							mCompletion->Call(h_, result, S3ParamVector());
 							return;
 						}
 
 						//	We currently put this value when we put an s3 object, but we can't assume it's
 						//	there for any given s3 object we're asked to fetch. So this checksum step is optional.
+						//	(It also only applies to the whole object, so ranged callers have to check it themselves.)
 						std::string s3sha256hex(GetSHA256(params));
-						if (!s3sha256hex.empty()) {
+						if (!s3sha256hex.empty() && mRange.empty()) {
 							std::string dataSHA256;
 							encoding::CalculateSHA256(mOurDataReceiver->mData, dataSHA256);
 							if (dataSHA256.empty()) {
 								NOTIFY_ERROR(h_, "CalculateSHA256 failed.");
-								mCompletion->Call(h_, S3Result::kError);
+								mCompletion->Call(h_, S3Result::kError, S3ParamVector());
 								return;
 							}
 							std::string dataSHA256Hex;
 							string::BinaryStringToHex(dataSHA256, dataSHA256Hex);
 							if (dataSHA256Hex.empty()) {
 								NOTIFY_ERROR(h_, "BinaryStringToHex failed.");
-								mCompletion->Call(h_, S3Result::kError);
+								mCompletion->Call(h_, S3Result::kError, S3ParamVector());
 								return;
 							}
 								
@@ -326,19 +337,20 @@ namespace hermit {
 											 "s3 value:", s3sha256hex,
 											 "local value:", dataSHA256Hex);
 									
-								mCompletion->Call(h_, S3Result::kChecksumMismatch);
+								mCompletion->Call(h_, S3Result::kChecksumMismatch, S3ParamVector());
 								return;
 							}
 						}
 							
 						auto buffer = DataBuffer(mOurDataReceiver->mData.data(), mOurDataReceiver->mData.size());
-						auto receiveCompletion = std::make_shared<Completion>(mCompletion);
+						auto receiveCompletion = std::make_shared<Completion>(params, mCompletion);
 						mTheirDataReceiver->Call(h_, buffer, true, receiveCompletion);
 					}
 					
 					//
 					http::HTTPSessionPtr mSession;
 					std::string mURL;
+					std::string mRange;
 					int mRedirectCount;
 					std::string mHost;
 					std::string mS3Path;
@@ -347,13 +359,14 @@ namespace hermit {
 					std::string mAWSRegion;
 					ReceiverPtr mOurDataReceiver;
 					DataReceiverPtr mTheirDataReceiver;
-					S3CompletionBlockPtr mCompletion;
+					StreamInS3RequestCompletionPtr mCompletion;
 				};
 				
 			public:
 				//
 				static void StreamInS3Object(const HermitPtr& h_,
 											 const http::HTTPSessionPtr& session,
+											 const std::string& range,
 											 int redirectCount,
 											 const std::string& host,
 											 const std::string& s3Path,
@@ -362,10 +375,10 @@ namespace hermit {
 											 const std::string& awsRegion,
 											 const ReceiverPtr& ourDataReceiver,
 											 const DataReceiverPtr& theirDataReceiver,
-											 const S3CompletionBlockPtr& completion) {
+											 const StreamInS3RequestCompletionPtr& completion) {
 					if (redirectCount > 5) {
 						NOTIFY_ERROR(h_, "Too many temporary redirects for s3Path:", s3Path);
-						completion->Call(h_, S3Result::kError);
+						completion->Call(h_, S3Result::kError, S3ParamVector());
 						return;
 					}
 					
@@ -438,6 +451,10 @@ namespace hermit {
 					params.push_back(std::make_pair("x-amz-date", dateTime));
 					params.push_back(std::make_pair("x-amz-content-sha256", contentSHA256));
 					params.push_back(std::make_pair("Authorization", authorization));
+					if (!range.empty()) {
+						// not a signed header, S3 only requires host and the x-amz-* headers to be signed
+						params.push_back(std::make_pair("Range", range));
+					}
 					
 					std::string url("https://");
 					url += host;
@@ -445,6 +462,7 @@ namespace hermit {
 					
 					auto streamCompletion = std::make_shared<StreamInCompletion>(session,
 																				 url,
+																				 range,
 																				 redirectCount,
 																				 host,
 																				 s3Path,
@@ -458,6 +476,38 @@ namespace hermit {
 				}
 			};
 			
+			//
+			class WholeObjectCompletion : public StreamInS3RequestCompletion {
+			public:
+				//
+				WholeObjectCompletion(const S3CompletionBlockPtr& completion) : mCompletion(completion) {
+				}
+				
+				//
+				virtual void Call(const HermitPtr& h_, const S3Result& result, const S3ParamVector& params) override {
+					mCompletion->Call(h_, result);
+				}
+				
+				//
+				S3CompletionBlockPtr mCompletion;
+			};
+			
+			//
+			void GetHostAndPath(const std::string& s3BucketName,
+								const std::string& s3ObjectKey,
+								std::string& outHost,
+								std::string& outS3Path) {
+				outHost = s3BucketName;
+				outHost += ".s3.amazonaws.com";
+				
+				std::string urlEncodedObjectKey;
+				http::URLEncode(s3ObjectKey, false, urlEncodedObjectKey);
+				outS3Path = urlEncodedObjectKey;
+				if (!outS3Path.empty() && (outS3Path[0] != '/')) {
+					outS3Path = "/" + outS3Path;
+				}
+			}
+			
 		} // namespace StreamInS3Object_Impl
 		using namespace StreamInS3Object_Impl;
 		
@@ -471,19 +521,57 @@ namespace hermit {
 							  const std::string& s3ObjectKey,
 							  const DataReceiverPtr& dataReceiver,
 							  const S3CompletionBlockPtr& completion) {
-			std::string host(s3BucketName);
-			host += ".s3.amazonaws.com";
+			std::string host;
+			std::string s3Path;
+			GetHostAndPath(s3BucketName, s3ObjectKey, host, s3Path);
 			
-			std::string urlEncodedObjectKey;
-			http::URLEncode(s3ObjectKey, false, urlEncodedObjectKey);
-			std::string s3Path(urlEncodedObjectKey);
-			if (!s3Path.empty() && (s3Path[0] != '/')) {
-				s3Path = "/" + s3Path;
+			auto ourDataReceiver = std::make_shared<Receiver>();
+			auto wholeObjectCompletion = std::make_shared<WholeObjectCompletion>(completion);
+			Redirector::StreamInS3Object(h_,
+										 session,
+										 "",
+										 0,
+										 host,
+										 s3Path,
+										 awsPublicKey,
+										 awsSigningKey,
+										 awsRegion,
+										 ourDataReceiver,
+										 dataReceiver,
+										 wholeObjectCompletion);
+		}
+		
+		//
+		void StreamInS3ObjectRange(const HermitPtr& h_,
+								   const http::HTTPSessionPtr& session,
+								   const std::string& awsPublicKey,
+								   const std::string& awsSigningKey,
+								   const std::string& awsRegion,
+								   const std::string& s3BucketName,
+								   const std::string& s3ObjectKey,
+								   const uint64_t& offset,
+								   const uint64_t& size,
+								   const DataReceiverPtr& dataReceiver,
+								   const StreamInS3RequestCompletionPtr& completion) {
+			if (size == 0) {
+				NOTIFY_ERROR(h_, "StreamInS3ObjectRange: empty range requested.");
+				completion->Call(h_, S3Result::kError, S3ParamVector());
+				return;
 			}
 			
+			std::string host;
+			std::string s3Path;
+			GetHostAndPath(s3BucketName, s3ObjectKey, host, s3Path);
+			
+			std::string range("bytes=");
+			range += std::to_string(offset);
+			range += "-";
+			range += std::to_string(offset + size - 1);
+			
 			auto ourDataReceiver = std::make_shared<Receiver>();
 			Redirector::StreamInS3Object(h_,
 										 session,
+										 range,
 										 0,
 										 host,
 										 s3Path,
@@ -19,11 +19,13 @@
 #ifndef StreamInS3Object_h
 #define StreamInS3Object_h
 
+#include <cstdint>
 #include <string>
 #include "Hermit/Foundation/Hermit.h"
 #include "Hermit/Foundation/StreamDataFunction.h"
 #include "Hermit/HTTP/HTTPSession.h"
 #include "S3Result.h"
+#include "StreamInS3RequestCompletion.h"
 
 namespace hermit {
 	namespace s3 {
@@ -39,6 +41,22 @@ namespace hermit {
 							  const DataReceiverPtr& dataReceiver,
 							  const S3CompletionBlockPtr& completion);
 		
+		// Fetches size bytes starting at offset. On success params holds the response headers
+		// (Content-Range, ETag, etc). An empty object fails with k416RequestedRangeNotSatisfiable.
+		// Unlike StreamInS3Object the x-amz-meta-sha256 hash isn't checked since it covers the
+		// whole object.
+		void StreamInS3ObjectRange(const HermitPtr& h_,
+								   const http::HTTPSessionPtr& session,
+								   const std::string& awsPublicKey,
+								   const std::string& awsSigningKey,
+								   const std::string& awsRegion,
+								   const std::string& s3BucketName,
+								   const std::string& s3ObjectKey,
+								   const uint64_t& offset,
+								   const uint64_t& size,
+								   const DataReceiverPtr& dataReceiver,
+								   const StreamInS3RequestCompletionPtr& completion);
+		
 	} // namespace s3
 } // namespace hermit
 
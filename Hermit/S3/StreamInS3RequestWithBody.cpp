@@ -266,6 +266,10 @@ namespace hermit {
 							mCompletion->Call(h_, S3Result::k404EntityNotFound, S3ParamVector());
 							return;
 						}
+						if (mHTTPStatus->mStatusCode == 416) {
+							mCompletion->Call(h_, S3Result::k416RequestedRangeNotSatisfiable, S3ParamVector());
+							return;
+						}
 						if (mHTTPStatus->mStatusCode == 500) {
 							ProcessXMLClass pc(h_);
 							pc.Process(mDataReceiver->mData);
@@ -21,6 +21,7 @@
 #include <vector>
 #include "Hermit/Encoding/CalculateHMACSHA256.h"
 #include "Hermit/Encoding/CalculateSHA256.h"
+#include "Hermit/Encoding/SHA256.h"
 #include "Hermit/Foundation/Notification.h"
 #include "Hermit/String/BinaryStringToHex.h"
 #include "Hermit/String/HexStringToBinary.h"
@@ -338,13 +339,9 @@ namespace hermit {
 				return;
 			}
 			
-			std::string dataSHA256;
-			encoding::CalculateSHA256(std::string(partData->Data(), partData->Size()), dataSHA256);
-			if (dataSHA256.empty()) {
-				NOTIFY_ERROR(h_, "GetS3ObjectWithVersion: CalculateSHA256 failed for partNumber:", partNumber);
-				completion->Call(h_, S3Result::kError, "");
-				return;
-			}
+			char sha256Buf[32];
+			encoding::CalculateSHA256(partData->Data(), partData->Size(), sha256Buf);
+			std::string dataSHA256(sha256Buf, 32);
 			
 			std::string dataSHA256Hex;
 			string::BinaryStringToHex(dataSHA256, dataSHA256Hex);
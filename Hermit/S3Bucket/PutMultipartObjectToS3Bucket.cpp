@@ -16,14 +16,21 @@
 //	along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <stdlib.h>
+#include <string.h>
 #include <vector>
-#include "Hermit/Encoding/CalculateSHA256.h"
+#include "Hermit/Encoding/SHA256.h"
 #include "Hermit/Foundation/Notification.h"
 #include "Hermit/String/BinaryStringToHex.h"
 #include "Hermit/S3/AbortS3MultipartUpload.h"
 #include "Hermit/S3/CompleteS3MultipartUpload.h"
 #include "Hermit/S3/InitiateS3MultipartUpload.h"
-#include "Hermit/S3/S3RetryClass.h"
+#include "Hermit/S3/S3MultipartUploadPlan.h"
+#include "Hermit/S3/S3Notification.h"
+#include "Hermit/S3/S3RetryPolicy.h"
 #include "Hermit/S3/UploadS3MultipartPart.h"
 #include "S3BucketImpl.h"
 
@@ -89,11 +96,7 @@ namespace hermit {
                     mUploadId(uploadId),
                     mOriginalResult(originalResult),
                     mCompletion(completion),
-                    mLatestResult(s3::S3Result::kUnknown),
-                    mRetries(0),
-                    mAccessDeniedRetries(0),
-                    mSleepInterval(1),
-                    mSleepIntervalStep(2) {
+                    mRetryPolicy("AbortUpload", S3BucketImpl::kMaxRetries) {
                     }
                     
                     //
@@ -103,10 +106,7 @@ namespace hermit {
                             return;
                         }
                         
-                        if (mRetries > 0) {
-                            s3::S3NotificationParams params("AbortUpload", mRetries, mLatestResult);
-                            NOTIFY(h_, s3::kS3RetryNotification, &params);
-                        }
+                        mRetryPolicy.WillAttempt(h_);
                         
                         mBucket->RefreshSigningKeyIfNeeded();
                         
@@ -124,59 +124,19 @@ namespace hermit {
                     
                     //
                     void Completion(const HermitPtr& h_, const s3::S3Result& result) {
-                        mLatestResult = result;
-                        
-                        if (!ShouldRetry(result)) {
-                            if (mRetries > 0) {
-                                s3::S3NotificationParams params("AbortUpload", mRetries, result);
-                                NOTIFY(h_, s3::kS3RetryCompleteNotification, &params);
-                            }
+                        auto decision = mRetryPolicy.AttemptComplete(h_, result);
+                        if (decision == s3::S3RetryDecision::kDone) {
                             ProcessResult(h_, result);
                             return;
                         }
-                        if (++mRetries == S3BucketImpl::kMaxRetries) {
-                            s3::S3NotificationParams params("AbortUpload", mRetries, result);
-                            NOTIFY(h_, s3::kS3MaxRetriesExceededNotification, &params);
-                            
+                        if (decision == s3::S3RetryDecision::kMaxRetriesExceeded) {
                             NOTIFY_ERROR(h_, "Maximum retries exceeded, most recent result:", (int)result);
                             mCompletion->Call(h_, result, "");
                             return;
                         }
-                        
-                        int fifthSecondIntervals = mSleepInterval * 5;
-                        for (int i = 0; i < fifthSecondIntervals; ++i) {
-                            if (CHECK_FOR_ABORT(h_)) {
-                                mCompletion->Call(h_, s3::S3Result::kCanceled, "");
-                                return;
-                            }
-                            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                        if (!mRetryPolicy.ScheduleRetry(h_, shared_from_this(), &AbortUploadClass::AbortUploadWithRetry)) {
+                            mCompletion->Call(h_, s3::S3Result::kCanceled, "");
                         }
-                        mSleepInterval += mSleepIntervalStep;
-                        mSleepIntervalStep += 2;
-                        
-                        AbortUploadWithRetry(h_);
-                    }
-                    
-                    //
-                    bool ShouldRetry(const s3::S3Result& result) {
-                        if ((result == s3::S3Result::kTimedOut) ||
-                            (result == s3::S3Result::kNetworkConnectionLost) ||
-                            (result == s3::S3Result::kChecksumMismatch) ||
-                            (result == s3::S3Result::k500InternalServerError) ||
-                            (result == s3::S3Result::k503ServiceUnavailable) ||
-                            (result == s3::S3Result::kS3InternalError) ||
-                            // borderline candidate for retry, but I've seen it recover "in the wild":
-                            (result == s3::S3Result::kHostNotFound)) {
-                            return true;
-                        }
-                        // we allow a single retry on PermissionDenied since i've seen this fail due to
-                        // flaky network behavior in the wild. (but we don't want to spam the server in
-                        // cases where access is indeed denied so we only do it once.)
-                        if ((result == s3::S3Result::k403AccessDenied) && (mAccessDeniedRetries == 0)) {
-                            ++mAccessDeniedRetries;
-                            return true;
-                        }
-                        return false;
                     }
                     
                     //
@@ -195,11 +155,7 @@ namespace hermit {
                     std::string mUploadId;
                     s3::S3Result mOriginalResult;
                     s3::PutS3ObjectCompletionPtr mCompletion;
-                    s3::S3Result mLatestResult;
-                    int mRetries;
-                    int mAccessDeniedRetries;
-                    int mSleepInterval;
-                    int mSleepIntervalStep;
+                    s3::S3RetryPolicy mRetryPolicy;
                 };
                 
                 //
@@ -244,11 +200,7 @@ namespace hermit {
                     mUploadId(uploadId),
                     mParts(parts),
                     mCompletion(completion),
-                    mLatestResult(s3::S3Result::kUnknown),
-                    mRetries(0),
-                    mAccessDeniedRetries(0),
-                    mSleepInterval(1),
-                    mSleepIntervalStep(2) {
+                    mRetryPolicy("CompleteUpload", S3BucketImpl::kMaxRetries) {
                     }
                     
                     //
@@ -258,10 +210,7 @@ namespace hermit {
                             return;
                         }
                         
-                        if (mRetries > 0) {
-                            s3::S3NotificationParams params("CompleteUpload", mRetries, mLatestResult);
-                            NOTIFY(h_, s3::kS3RetryNotification, &params);
-                        }
+                        mRetryPolicy.WillAttempt(h_);
                         
                         mBucket->RefreshSigningKeyIfNeeded();
                         
@@ -280,59 +229,19 @@ namespace hermit {
                     
                     //
                     void Completion(const HermitPtr& h_, const s3::S3Result& result) {
-                        mLatestResult = result;
-                        
-                        if (!ShouldRetry(result)) {
-                            if (mRetries > 0) {
-                                s3::S3NotificationParams params("CompleteUpload", mRetries, result);
-                                NOTIFY(h_, s3::kS3RetryCompleteNotification, &params);
-                            }
+                        auto decision = mRetryPolicy.AttemptComplete(h_, result);
+                        if (decision == s3::S3RetryDecision::kDone) {
                             ProcessResult(h_, result);
                             return;
                         }
-                        if (++mRetries == S3BucketImpl::kMaxRetries) {
-                            s3::S3NotificationParams params("CompleteUpload", mRetries, result);
-                            NOTIFY(h_, s3::kS3MaxRetriesExceededNotification, &params);
-                            
+                        if (decision == s3::S3RetryDecision::kMaxRetriesExceeded) {
                             NOTIFY_ERROR(h_, "Maximum retries exceeded, most recent result:", (int)result);
                             mCompletion->Call(h_, result, "");
                             return;
                         }
-                        
-                        int fifthSecondIntervals = mSleepInterval * 5;
-                        for (int i = 0; i < fifthSecondIntervals; ++i) {
-                            if (CHECK_FOR_ABORT(h_)) {
-                                mCompletion->Call(h_, s3::S3Result::kCanceled, "");
-                                return;
-                            }
-                            std::this_thread::sleep_for(std::chrono::milliseconds(200));
-                        }
-                        mSleepInterval += mSleepIntervalStep;
-                        mSleepIntervalStep += 2;
-                        
-                        CompleteUploadWithRetry(h_);
-                    }
-                    
-                    //
-                    bool ShouldRetry(const s3::S3Result& result) {
-                        if ((result == s3::S3Result::kTimedOut) ||
-                            (result == s3::S3Result::kNetworkConnectionLost) ||
-                            (result == s3::S3Result::kChecksumMismatch) ||
-                            (result == s3::S3Result::k500InternalServerError) ||
-                            (result == s3::S3Result::k503ServiceUnavailable) ||
-                            (result == s3::S3Result::kS3InternalError) ||
-                            // borderline candidate for retry, but I've seen it recover "in the wild":
-                            (result == s3::S3Result::kHostNotFound)) {
-                            return true;
-                        }
-                        // we allow a single retry on PermissionDenied since i've seen this fail due to
-                        // flaky network behavior in the wild. (but we don't want to spam the server in
-                        // cases where access is indeed denied so we only do it once.)
-                        if ((result == s3::S3Result::k403AccessDenied) && (mAccessDeniedRetries == 0)) {
-                            ++mAccessDeniedRetries;
-                            return true;
+                        if (!mRetryPolicy.ScheduleRetry(h_, shared_from_this(), &CompleteUploadClass::CompleteUploadWithRetry)) {
+                            mCompletion->Call(h_, s3::S3Result::kCanceled, "");
                         }
-                        return false;
                     }
                     
                     //
@@ -358,11 +267,7 @@ namespace hermit {
                     std::string mUploadId;
                     s3::PartVector mParts;
                     s3::PutS3ObjectCompletionPtr mCompletion;
-                    s3::S3Result mLatestResult;
-                    int mRetries;
-                    int mAccessDeniedRetries;
-                    int mSleepInterval;
-                    int mSleepIntervalStep;
+                    s3::S3RetryPolicy mRetryPolicy;
                 };
                 
                 //
@@ -375,6 +280,10 @@ namespace hermit {
                 
                 
                 
+                //
+                class MultipartUploadClass;
+                typedef std::shared_ptr<MultipartUploadClass> MultipartUploadClassPtr;
+                
                 //
                 class UploadPartClass;
                 typedef std::shared_ptr<UploadPartClass> UploadPartClassPtr;
@@ -400,47 +309,30 @@ namespace hermit {
                     //
                     UploadPartClass(const S3BucketImplPtr& bucket,
                                     const std::string& objectKey,
-                                    const SharedBufferPtr& data,
                                     const std::string& uploadId,
-                                    int64_t calculatedPartSize,
-                                    int32_t numberOfParts,
-                                    int32_t thisPartNumber,
-                                    const s3::PartVector& parts,
-                                    const s3::PutS3ObjectCompletionPtr& completion) :
+                                    int32_t partNumber,
+                                    const SharedBufferPtr& partData,
+                                    const MultipartUploadClassPtr& upload) :
                     mBucket(bucket),
                     mObjectKey(objectKey),
-                    mData(data),
                     mUploadId(uploadId),
-                    mCalculatedPartSize(calculatedPartSize),
-                    mNumberOfParts(numberOfParts),
-                    mThisPartNumber(thisPartNumber),
-                    mParts(parts),
-                    mCompletion(completion),
-                    mLatestResult(s3::S3Result::kUnknown),
-                    mRetries(0),
-                    mAccessDeniedRetries(0),
-                    mSleepInterval(1),
-                    mSleepIntervalStep(2) {
+                    mPartNumber(partNumber),
+                    mPartData(partData),
+                    mUpload(upload),
+                    mRetryPolicy("UploadPart", S3BucketImpl::kMaxRetries) {
                     }
                     
                     //
                     void UploadPartWithRetry(const HermitPtr& h_) {
                         if (CHECK_FOR_ABORT(h_)) {
-                            mCompletion->Call(h_, s3::S3Result::kCanceled, "");
+                            ProcessResult(h_, s3::S3Result::kCanceled, "");
                             return;
                         }
                         
-                        if (mRetries > 0) {
-                            s3::S3NotificationParams params("UploadPart", mRetries, mLatestResult);
-                            NOTIFY(h_, s3::kS3RetryNotification, &params);
-                        }
+                        mRetryPolicy.WillAttempt(h_);
                         
                         mBucket->RefreshSigningKeyIfNeeded();
                         
-                        uint64_t thisPartSize = mCalculatedPartSize;
-                        if (mThisPartNumber == mNumberOfParts) {
-                            thisPartSize += mData->Size() % mCalculatedPartSize;
-                        }
                         auto completion = std::make_shared<UploadPartCompletion>(shared_from_this());
                         UploadS3MultipartPart(h_,
 											  mBucket->mHTTPSession,
@@ -450,133 +342,45 @@ namespace hermit {
                                               mBucket->mBucketName,
                                               mObjectKey,
                                               mUploadId,
-                                              mThisPartNumber,
-                                              std::make_shared<SharedBuffer>(mData->Data() + (mThisPartNumber - 1) * mCalculatedPartSize, thisPartSize),
+                                              mPartNumber,
+                                              mPartData,
                                               completion);
                     }
                     
                     //
                     void Completion(const HermitPtr& h_, const s3::S3Result& result, const std::string& eTag) {
-                        mLatestResult = result;
-                        
-                        if (!ShouldRetry(result)) {
-                            if (mRetries > 0) {
-                                s3::S3NotificationParams params("UploadPart", mRetries, result);
-                                NOTIFY(h_, s3::kS3RetryCompleteNotification, &params);
-                            }
+                        auto decision = mRetryPolicy.AttemptComplete(h_, result);
+                        if (decision == s3::S3RetryDecision::kDone) {
                             ProcessResult(h_, result, eTag);
                             return;
                         }
-                        if (++mRetries == S3BucketImpl::kMaxRetries) {
-                            s3::S3NotificationParams params("UploadPart", mRetries, result);
-                            NOTIFY(h_, s3::kS3MaxRetriesExceededNotification, &params);
-                            
+                        if (decision == s3::S3RetryDecision::kMaxRetriesExceeded) {
                             NOTIFY_ERROR(h_, "Maximum retries exceeded, most recent result:", (int)result);
-                            mCompletion->Call(h_, result, "");
+                            ProcessResult(h_, result, "");
                             return;
                         }
-                        
-                        int fifthSecondIntervals = mSleepInterval * 5;
-                        for (int i = 0; i < fifthSecondIntervals; ++i) {
-                            if (CHECK_FOR_ABORT(h_)) {
-                                mCompletion->Call(h_, s3::S3Result::kCanceled, "");
-                                return;
-                            }
-                            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                        if (!mRetryPolicy.ScheduleRetry(h_, shared_from_this(), &UploadPartClass::UploadPartWithRetry)) {
+                            ProcessResult(h_, s3::S3Result::kCanceled, "");
                         }
-                        mSleepInterval += mSleepIntervalStep;
-                        mSleepIntervalStep += 2;
-                        
-                        UploadPartWithRetry(h_);
                     }
                     
                     //
-                    bool ShouldRetry(const s3::S3Result& result) {
-                        if ((result == s3::S3Result::kTimedOut) ||
-                            (result == s3::S3Result::kNetworkConnectionLost) ||
-                            (result == s3::S3Result::kChecksumMismatch) ||
-                            (result == s3::S3Result::k500InternalServerError) ||
-                            (result == s3::S3Result::k503ServiceUnavailable) ||
-                            (result == s3::S3Result::kS3InternalError) ||
-                            // borderline candidate for retry, but I've seen it recover "in the wild":
-                            (result == s3::S3Result::kHostNotFound)) {
-                            return true;
-                        }
-                        // we allow a single retry on PermissionDenied since i've seen this fail due to
-                        // flaky network behavior in the wild. (but we don't want to spam the server in
-                        // cases where access is indeed denied so we only do it once.)
-                        if ((result == s3::S3Result::k403AccessDenied) && (mAccessDeniedRetries == 0)) {
-                            ++mAccessDeniedRetries;
-                            return true;
-                        }
-                        return false;
-                    }
-                    
-                    //
-                    void ProcessResult(const HermitPtr& h_, const s3::S3Result& result, const std::string& eTag) {
-                        if (result == s3::S3Result::kSuccess) {
-                            mParts.push_back(std::make_pair(mThisPartNumber, eTag));
-                            if (mThisPartNumber < mNumberOfParts) {
-                                auto partUploader = std::make_shared<UploadPartClass>(mBucket,
-                                                                                      mObjectKey,
-                                                                                      mData,
-                                                                                      mUploadId,
-                                                                                      mCalculatedPartSize,
-                                                                                      mNumberOfParts,
-                                                                                      mThisPartNumber + 1,
-                                                                                      mParts,
-                                                                                      mCompletion);
-                                partUploader->UploadPartWithRetry(h_);
-                                return;
-                            }
-                            
-                            auto completer = std::make_shared<CompleteUploadClass>(mBucket,
-                                                                                   mObjectKey,
-                                                                                   mUploadId,
-                                                                                   mParts,
-                                                                                   mCompletion);
-                            completer->CompleteUploadWithRetry(h_);
-                            return;
-                        }
-                        
-                        if (result != s3::S3Result::kCanceled) {
-                            NOTIFY_ERROR(h_, "UploadMultipartPart failed.");
-                        }
-                        
-                        // we specifically want to avoid a cancel here because there can be an S3 cost
-                        // associated for partially uploaded multipart objects unless abort is called,
-                        // so we pass a special proxy here
-                        auto proxy = std::make_shared<AbortNotificationProxy>(h_);
-                        auto aborter = std::make_shared<AbortUploadClass>(mBucket, mObjectKey, mUploadId, result, mCompletion);
-                        aborter->AbortUploadWithRetry(proxy);
-                    }
+                    void ProcessResult(const HermitPtr& h_, const s3::S3Result& result, const std::string& eTag);
                     
                     //
                     S3BucketImplPtr mBucket;
                     std::string mObjectKey;
-                    SharedBufferPtr mData;
                     std::string mUploadId;
-                    int64_t mCalculatedPartSize;
-                    int32_t mNumberOfParts;
-                    int32_t mThisPartNumber;
-                    s3::PartVector mParts;
-                    s3::PutS3ObjectCompletionPtr mCompletion;
-                    s3::S3Result mLatestResult;
-                    int mRetries;
-                    int mAccessDeniedRetries;
-                    int mSleepInterval;
-                    int mSleepIntervalStep;
+                    int32_t mPartNumber;
+                    SharedBufferPtr mPartData;
+                    MultipartUploadClassPtr mUpload;
+                    s3::S3RetryPolicy mRetryPolicy;
                 };
                 
                 //
-                void UploadPartCompletion::Call(const HermitPtr& h_, const s3::S3Result& result, const std::string& uploadId) {
-                    mUploadPartClass->Completion(h_, result, uploadId);
+                void UploadPartCompletion::Call(const HermitPtr& h_, const s3::S3Result& result, const std::string& eTag) {
+                    mUploadPartClass->Completion(h_, result, eTag);
                 }
-
-                
-                
-                
-                
                 
                 //
                 class InitiateUploadClass;
@@ -603,32 +407,23 @@ namespace hermit {
                     //
                     InitiateUploadClass(const S3BucketImplPtr& bucket,
                                         const std::string& objectKey,
-                                        const SharedBufferPtr& data,
                                         const std::string& dataSHA256Hex,
-                                        const s3::PutS3ObjectCompletionPtr& completion) :
+                                        const MultipartUploadClassPtr& upload) :
                     mBucket(bucket),
                     mObjectKey(objectKey),
-                    mData(data),
                     mDataSHA256Hex(dataSHA256Hex),
-                    mCompletion(completion),
-                    mLatestResult(s3::S3Result::kUnknown),
-                    mRetries(0),
-                    mAccessDeniedRetries(0),
-                    mSleepInterval(1),
-                    mSleepIntervalStep(2) {
+                    mUpload(upload),
+                    mRetryPolicy("InitiateUpload", S3BucketImpl::kMaxRetries) {
                     }
                     
                     //
                     void InitiateUploadWithRetry(const HermitPtr& h_) {
                         if (CHECK_FOR_ABORT(h_)) {
-                            mCompletion->Call(h_, s3::S3Result::kCanceled, "");
+                            ProcessResult(h_, s3::S3Result::kCanceled, "");
                             return;
                         }
                         
-                        if (mRetries > 0) {
-                            s3::S3NotificationParams params("InitiateUpload", mRetries, mLatestResult);
-                            NOTIFY(h_, s3::kS3RetryNotification, &params);
-                        }
+                        mRetryPolicy.WillAttempt(h_);
                         
                         mBucket->RefreshSigningKeyIfNeeded();
                         
@@ -646,95 +441,438 @@ namespace hermit {
                     
                     //
                     void Completion(const HermitPtr& h_, const s3::S3Result& result, const std::string& uploadId) {
-                        mLatestResult = result;
-                        
-                        if (!ShouldRetry(result)) {
-                            if (mRetries > 0) {
-                                s3::S3NotificationParams params("InitiateUpload", mRetries, result);
-                                NOTIFY(h_, s3::kS3RetryCompleteNotification, &params);
-                            }
+                        auto decision = mRetryPolicy.AttemptComplete(h_, result);
+                        if (decision == s3::S3RetryDecision::kDone) {
                             ProcessResult(h_, result, uploadId);
                             return;
                         }
-                        if (++mRetries == S3BucketImpl::kMaxRetries) {
-                            s3::S3NotificationParams params("InitiateUpload", mRetries, result);
-                            NOTIFY(h_, s3::kS3MaxRetriesExceededNotification, &params);
-                            
+                        if (decision == s3::S3RetryDecision::kMaxRetriesExceeded) {
                             NOTIFY_ERROR(h_, "Maximum retries exceeded, most recent result:", (int)result);
-                            mCompletion->Call(h_, result, "");
+                            ProcessResult(h_, result, "");
                             return;
                         }
+                        if (!mRetryPolicy.ScheduleRetry(h_, shared_from_this(), &InitiateUploadClass::InitiateUploadWithRetry)) {
+                            ProcessResult(h_, s3::S3Result::kCanceled, "");
+                        }
+                    }
+                    
+                    //
+                    void ProcessResult(const HermitPtr& h_, const s3::S3Result& result, const std::string& uploadId);
+                    
+                    //
+                    S3BucketImplPtr mBucket;
+                    std::string mObjectKey;
+                    std::string mDataSHA256Hex;
+                    MultipartUploadClassPtr mUpload;
+                    s3::S3RetryPolicy mRetryPolicy;
+                };
+                
+                //
+                void InitiateUploadCompletion::Call(const HermitPtr& h_, const s3::S3Result& result, const std::string& uploadId) {
+                    mInitiateUploadClass->Completion(h_, result, uploadId);
+                }
+                
+                // Drives the parts of a multipart upload. Parts are either sliced on demand from a buffer
+                // holding the whole object, or handed to us as they fill by a StreamPartReceiver. Up to
+                // mMaxPartsInFlight parts upload at once; they can finish in any order, each one retries
+                // on its own, and the first failure stops new parts from being started. Once the
+                // in-flight parts drain we either complete or abort.
+                class MultipartUploadClass : public std::enable_shared_from_this<MultipartUploadClass> {
+                public:
+                    //
+                    MultipartUploadClass(const S3BucketImplPtr& bucket,
+                                         const std::string& objectKey,
+                                         const SharedBufferPtr& data,
+                                         const bool& useReducedRedundancyStorage,
+                                         const s3::S3MultipartUploadOptions& options,
+                                         const s3::S3MultipartUploadPlan& plan,
+                                         const s3::PutS3ObjectCompletionPtr& completion) :
+                    mBucket(bucket),
+                    mObjectKey(objectKey),
+                    mData(data),
+                    mUseReducedRedundancyStorage(useReducedRedundancyStorage),
+                    mOptions(options),
+                    mPartSize(plan.mPartSize),
+                    mMaxPartsInFlight(plan.mMaxPartsInFlight),
+                    mCompletion(completion),
+                    mDataOffset(0),
+                    mStreamPartCount(0),
+                    mInputComplete(false),
+                    mInitiateStarted(false),
+                    mInitiating(false),
+                    mNextPartNumber(1),
+                    mPartsInFlight(0),
+                    mFinished(false),
+                    mFailed(false),
+                    mFailedResult(s3::S3Result::kUnknown) {
+                    }
+                    
+                    // used when the whole object is in mData
+                    void Start(const HermitPtr& h_, const std::string& dataSHA256Hex) {
+                        {
+                            std::lock_guard<std::mutex> lock(mMutex);
+                            mInitiateStarted = true;
+                            mInitiating = true;
+                        }
+                        InitiateUpload(h_, dataSHA256Hex);
+                    }
+                    
+                    //
+                    void InitiateUpload(const HermitPtr& h_, const std::string& dataSHA256Hex) {
+                        auto initiateClass = std::make_shared<InitiateUploadClass>(mBucket,
+                                                                                   mObjectKey,
+                                                                                   dataSHA256Hex,
+                                                                                   shared_from_this());
+                        initiateClass->InitiateUploadWithRetry(h_);
+                    }
+                    
+                    //
+                    void UploadInitiated(const HermitPtr& h_, const s3::S3Result& result, const std::string& uploadId) {
+                        {
+                            std::lock_guard<std::mutex> lock(mMutex);
+                            mInitiating = false;
+                            if (result == s3::S3Result::kSuccess) {
+                                mUploadId = uploadId;
+                            }
+                            else if (!mFailed) {
+                                mFailed = true;
+                                mFailedResult = result;
+                            }
+                        }
+                        if ((result != s3::S3Result::kSuccess) && (result != s3::S3Result::kCanceled)) {
+                            NOTIFY_ERROR(h_, "InitiateMultipartUpload failed.");
+                        }
+                        UploadParts(h_);
+                        FinishIfDone(h_);
+                    }
+                    
+                    // Called by StreamPartReceiver each time it has filled a part, and once more with
+                    // whatever is left over when the stream ends.
+                    void AddStreamPart(const HermitPtr& h_, const SharedBufferPtr& partData) {
+                        bool initiate = false;
+                        bool tooManyParts = false;
+                        {
+                            std::lock_guard<std::mutex> lock(mMutex);
+                            if (mFailed) {
+                                return;
+                            }
+                            if (++mStreamPartCount > s3::kS3MaxParts) {
+                                mFailed = true;
+                                mFailedResult = s3::S3Result::kError;
+                                tooManyParts = true;
+                            }
+                            else {
+                                mReadyParts.push_back(partData);
+                                
+                                // a full part means the object won't be small enough for a single put, so start
+                                // the multipart upload (a short final part of a small object goes to PutObject
+                                // once the stream ends)
+                                if (!mInitiateStarted && (partData->Size() == mPartSize)) {
+                                    mInitiateStarted = true;
+                                    mInitiating = true;
+                                    initiate = true;
+                                }
+                            }
+                        }
+                        if (tooManyParts) {
+                            NOTIFY_ERROR(h_, "PutObjectFromStream: stream exceeds the part limit for part size:", mPartSize);
+                            return;
+                        }
+                        if (initiate) {
+                            // the stream's overall hash isn't known yet
+                            InitiateUpload(h_, "");
+                        }
+                    }
+                    
+                    // The stream waits on completion until there's room for another part.
+                    void ResumeStreamWhenReady(const HermitPtr& h_, const DataCompletionPtr& completion) {
+                        {
+                            std::lock_guard<std::mutex> lock(mMutex);
+                            mStreamCompletion = completion;
+                        }
+                        UploadParts(h_);
+                    }
+                    
+                    //
+                    void InputComplete(const HermitPtr& h_, const StreamDataResult& result) {
+                        {
+                            std::lock_guard<std::mutex> lock(mMutex);
+                            mInputComplete = true;
+                            if ((result != StreamDataResult::kSuccess) && !mFailed) {
+                                mFailed = true;
+                                mFailedResult = (result == StreamDataResult::kCanceled) ? s3::S3Result::kCanceled : s3::S3Result::kError;
+                            }
+                        }
+                        if ((result != StreamDataResult::kSuccess) && (result != StreamDataResult::kCanceled)) {
+                            NOTIFY_ERROR(h_, "PutObjectFromStream: dataProvider returned an error.");
+                        }
+                        FinishIfDone(h_);
+                    }
+                    
+                    //
+                    bool HasFailed() {
+                        std::lock_guard<std::mutex> lock(mMutex);
+                        return mFailed;
+                    }
+                    
+                    //
+                    void UploadParts(const HermitPtr& h_) {
+                        std::vector<UploadPartClassPtr> partUploaders;
+                        DataCompletionPtr streamCompletion;
+                        bool failed = false;
+                        {
+                            std::lock_guard<std::mutex> lock(mMutex);
+                            SharedBufferPtr partData;
+                            while (!mFailed && !mUploadId.empty() && (mPartsInFlight < mMaxPartsInFlight) && TakeNextPart(partData)) {
+                                partUploaders.push_back(std::make_shared<UploadPartClass>(mBucket,
+                                                                                          mObjectKey,
+                                                                                          mUploadId,
+                                                                                          mNextPartNumber,
+                                                                                          partData,
+                                                                                          shared_from_this()));
+                                ++mNextPartNumber;
+                                ++mPartsInFlight;
+                            }
+                            
+                            // a paused stream continues once there's room for another part
+                            if ((mStreamCompletion != nullptr) &&
+                                (mFailed || (((int32_t)mReadyParts.size() + mPartsInFlight) < mMaxPartsInFlight))) {
+                                streamCompletion = mStreamCompletion;
+                                mStreamCompletion = nullptr;
+                                failed = mFailed;
+                            }
+                        }
+                        // started outside the lock since a part can complete synchronously (e.g. on cancel)
+                        for (auto& partUploader : partUploaders) {
+                            partUploader->UploadPartWithRetry(h_);
+                        }
+                        if (streamCompletion != nullptr) {
+                            streamCompletion->Call(h_, failed ? StreamDataResult::kCanceled : StreamDataResult::kSuccess);
+                        }
+                    }
+                    
+                    //
+                    void PartComplete(const HermitPtr& h_, int32_t partNumber, const s3::S3Result& result, const std::string& eTag) {
+                        {
+                            std::lock_guard<std::mutex> lock(mMutex);
+                            --mPartsInFlight;
+                            if (result == s3::S3Result::kSuccess) {
+                                mParts.push_back(std::make_pair(partNumber, eTag));
+                            }
+                            else if (!mFailed) {
+                                mFailed = true;
+                                mFailedResult = result;
+                            }
+                        }
+                        if ((result != s3::S3Result::kSuccess) && (result != s3::S3Result::kCanceled)) {
+                            NOTIFY_ERROR(h_, "UploadMultipartPart failed.");
+                        }
+                        UploadParts(h_);
+                        FinishIfDone(h_);
+                    }
+                    
+                    //
+                    void FinishIfDone(const HermitPtr& h_) {
+                        {
+                            std::lock_guard<std::mutex> lock(mMutex);
+                            // a failed buffer upload has nothing more to wait for, a failed stream
+                            // still has to wind down its provider
+                            bool inputDone = mInputComplete || ((mData != nullptr) && mFailed);
+                            if (mFinished || !inputDone || (mPartsInFlight > 0) || mInitiating) {
+                                return;
+                            }
+                            if (!mFailed && mInitiateStarted && !mReadyParts.empty()) {
+                                return;
+                            }
+                            mFinished = true;
+                        }
                         
-                        int fifthSecondIntervals = mSleepInterval * 5;
-                        for (int i = 0; i < fifthSecondIntervals; ++i) {
-                            if (CHECK_FOR_ABORT(h_)) {
-                                mCompletion->Call(h_, s3::S3Result::kCanceled, "");
+                        if (mFailed) {
+                            if (mUploadId.empty()) {
+                                mCompletion->Call(h_, mFailedResult, "");
                                 return;
                             }
-                            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                            
+                            // we specifically want to avoid a cancel here because there can be an S3 cost
+                            // associated for partially uploaded multipart objects unless abort is called,
+                            // so we pass a special proxy here
+                            auto proxy = std::make_shared<AbortNotificationProxy>(h_);
+                            auto aborter = std::make_shared<AbortUploadClass>(mBucket, mObjectKey, mUploadId, mFailedResult, mCompletion);
+                            aborter->AbortUploadWithRetry(proxy);
+                            return;
+                        }
+                        
+                        if (!mInitiateStarted) {
+                            // the whole stream fit in less than one part so it goes up as a regular object
+                            SharedBufferPtr data(mReadyParts.empty() ? std::make_shared<SharedBuffer>() : mReadyParts.front());
+                            mBucket->PutObject(h_, mObjectKey, data, mUseReducedRedundancyStorage, mOptions, mCompletion);
+                            return;
                         }
-                        mSleepInterval += mSleepIntervalStep;
-                        mSleepIntervalStep += 2;
                         
-                        InitiateUploadWithRetry(h_);
+                        // parts finish out of order but CompleteMultipartUpload requires ascending part numbers
+                        std::sort(mParts.begin(), mParts.end());
+                        auto completer = std::make_shared<CompleteUploadClass>(mBucket,
+                                                                               mObjectKey,
+                                                                               mUploadId,
+                                                                               mParts,
+                                                                               mCompletion);
+                        completer->CompleteUploadWithRetry(h_);
                     }
                     
-                    //
-                    bool ShouldRetry(const s3::S3Result& result) {
-                        if ((result == s3::S3Result::kTimedOut) ||
-                            (result == s3::S3Result::kNetworkConnectionLost) ||
-                            (result == s3::S3Result::kChecksumMismatch) ||
-                            (result == s3::S3Result::k500InternalServerError) ||
-                            (result == s3::S3Result::k503ServiceUnavailable) ||
-                            (result == s3::S3Result::kS3InternalError) ||
-                            // borderline candidate for retry, but I've seen it recover "in the wild":
-                            (result == s3::S3Result::kHostNotFound)) {
+                    // must be called with mMutex held
+                    bool TakeNextPart(SharedBufferPtr& outPartData) {
+                        if (!mReadyParts.empty()) {
+                            outPartData = mReadyParts.front();
+                            mReadyParts.pop_front();
                             return true;
                         }
-                        // we allow a single retry on PermissionDenied since i've seen this fail due to
-                        // flaky network behavior in the wild. (but we don't want to spam the server in
-                        // cases where access is indeed denied so we only do it once.)
-                        if ((result == s3::S3Result::k403AccessDenied) && (mAccessDeniedRetries == 0)) {
-                            ++mAccessDeniedRetries;
+                        if ((mData != nullptr) && (mDataOffset < mData->Size())) {
+                            uint64_t partSize = std::min(mPartSize, mData->Size() - mDataOffset);
+                            outPartData = std::make_shared<SharedBuffer>(mData->Data() + mDataOffset, partSize);
+                            mDataOffset += partSize;
+                            if (mDataOffset == mData->Size()) {
+                                mInputComplete = true;
+                            }
                             return true;
                         }
                         return false;
                     }
                     
-                    //
-                    void ProcessResult(const HermitPtr& h_, const s3::S3Result& result, const std::string& uploadId) {
-                        uint64_t calculatedPartSize = 6 * 1024 * 1024;
-                        int32_t numberOfParts = (int32_t)(mData->Size() / calculatedPartSize);
-                        auto partUploader = std::make_shared<UploadPartClass>(mBucket,
-                                                                              mObjectKey,
-                                                                              mData,
-                                                                              uploadId,
-                                                                              calculatedPartSize,
-                                                                              numberOfParts,
-                                                                              1,
-                                                                              s3::PartVector(),
-                                                                              mCompletion);
-                        partUploader->UploadPartWithRetry(h_);
-                    }
-                    
                     //
                     S3BucketImplPtr mBucket;
                     std::string mObjectKey;
                     SharedBufferPtr mData;
-                    std::string mDataSHA256Hex;
+                    bool mUseReducedRedundancyStorage;
+                    s3::S3MultipartUploadOptions mOptions;
+                    uint64_t mPartSize;
+                    int32_t mMaxPartsInFlight;
                     s3::PutS3ObjectCompletionPtr mCompletion;
-                    s3::S3Result mLatestResult;
-                    int mRetries;
-                    int mAccessDeniedRetries;
-                    int mSleepInterval;
-                    int mSleepIntervalStep;
+                    std::mutex mMutex;
+                    uint64_t mDataOffset;
+                    std::deque<SharedBufferPtr> mReadyParts;
+                    int32_t mStreamPartCount;
+                    DataCompletionPtr mStreamCompletion;
+                    bool mInputComplete;
+                    bool mInitiateStarted;
+                    bool mInitiating;
+                    std::string mUploadId;
+                    int32_t mNextPartNumber;
+                    int32_t mPartsInFlight;
+                    bool mFinished;
+                    bool mFailed;
+                    s3::S3Result mFailedResult;
+                    s3::PartVector mParts;
                 };
                 
                 //
-                void InitiateUploadCompletion::Call(const HermitPtr& h_, const s3::S3Result& result, const std::string& uploadId) {
-                    mInitiateUploadClass->Completion(h_, result, uploadId);
+                void UploadPartClass::ProcessResult(const HermitPtr& h_, const s3::S3Result& result, const std::string& eTag) {
+                    mUpload->PartComplete(h_, mPartNumber, result, eTag);
+                }
+                
+                //
+                void InitiateUploadClass::ProcessResult(const HermitPtr& h_, const s3::S3Result& result, const std::string& uploadId) {
+                    mUpload->UploadInitiated(h_, result, uploadId);
                 }
                 
+                // Collects streamed data into part-sized buffers. Only the parts that are uploading
+                // or waiting for a slot are held in memory; the stream is paused until there's room.
+                class StreamPartReceiver : public DataReceiver {
+                public:
+                    //
+                    StreamPartReceiver(const MultipartUploadClassPtr& upload, uint64_t partSize) :
+                    mUpload(upload),
+                    mPartSize(partSize),
+                    mPartBuffer(nullptr),
+                    mPartBufferSize(0) {
+                    }
+                    
+                    //
+                    ~StreamPartReceiver() {
+                        if (mPartBuffer != nullptr) {
+                            free(mPartBuffer);
+                        }
+                    }
+                    
+                    //
+                    virtual void Call(const HermitPtr& h_,
+                                      const DataBuffer& data,
+                                      const bool& isEndOfData,
+                                      const DataCompletionPtr& completion) override {
+                        if (mUpload->HasFailed()) {
+                            completion->Call(h_, StreamDataResult::kCanceled);
+                            return;
+                        }
+                        
+                        const char* p = data.first;
+                        uint64_t remaining = data.second;
+                        while (remaining > 0) {
+                            if (mPartBuffer == nullptr) {
+                                mPartBuffer = (char*)malloc(mPartSize);
+                                if (mPartBuffer == nullptr) {
+                                    NOTIFY_ERROR(h_, "PutObjectFromStream: malloc failed for part size:", mPartSize);
+                                    completion->Call(h_, StreamDataResult::kError);
+                                    return;
+                                }
+                                mPartBufferSize = 0;
+                            }
+                            uint64_t bytesToCopy = std::min(remaining, mPartSize - mPartBufferSize);
+                            memcpy(mPartBuffer + mPartBufferSize, p, bytesToCopy);
+                            mPartBufferSize += bytesToCopy;
+                            p += bytesToCopy;
+                            remaining -= bytesToCopy;
+                            if (mPartBufferSize == mPartSize) {
+                                FlushPart(h_);
+                            }
+                        }
+                        mUpload->ResumeStreamWhenReady(h_, completion);
+                    }
+                    
+                    //
+                    void FlushPart(const HermitPtr& h_) {
+                        if (mPartBuffer == nullptr) {
+                            return;
+                        }
+                        if (mPartBufferSize == 0) {
+                            free(mPartBuffer);
+                            mPartBuffer = nullptr;
+                            return;
+                        }
+                        auto partData = std::make_shared<SharedBuffer>(mPartBuffer, mPartBufferSize, true);
+                        mPartBuffer = nullptr;
+                        mPartBufferSize = 0;
+                        mUpload->AddStreamPart(h_, partData);
+                    }
+                    
+                    //
+                    MultipartUploadClassPtr mUpload;
+                    uint64_t mPartSize;
+                    char* mPartBuffer;
+                    uint64_t mPartBufferSize;
+                };
+                typedef std::shared_ptr<StreamPartReceiver> StreamPartReceiverPtr;
+                
+                //
+                class StreamCompletion : public DataCompletion {
+                public:
+                    //
+                    StreamCompletion(const MultipartUploadClassPtr& upload, const StreamPartReceiverPtr& receiver) :
+                    mUpload(upload),
+                    mReceiver(receiver) {
+                    }
+                    
+                    //
+                    virtual void Call(const HermitPtr& h_, const StreamDataResult& result) override {
+                        if (result == StreamDataResult::kSuccess) {
+                            mReceiver->FlushPart(h_);
+                        }
+                        mUpload->InputComplete(h_, result);
+                    }
+                    
+                    //
+                    MultipartUploadClassPtr mUpload;
+                    StreamPartReceiverPtr mReceiver;
+                };
+                
 			} // namespace S3BucketImpl_PutMultipartObjectToS3Bucket_Impl
             using namespace S3BucketImpl_PutMultipartObjectToS3Bucket_Impl;
 			
@@ -743,32 +881,66 @@ namespace hermit {
                                                             const std::string& s3ObjectKey,
                                                             const SharedBufferPtr& data,
                                                             const bool& useReducedRedundancyStorage, // TODO: currently ignored
+                                                            const s3::S3MultipartUploadOptions& multipartUploadOptions,
                                                             const s3::PutS3ObjectCompletionPtr& completion) {
 				
-				//	This is handled internally for the PutS3Object case, but we need to do it here
-				//	for the multipart upload case.
-				std::string dataSHA256;
-				encoding::CalculateSHA256(std::string(data->Data(), data->Size()), dataSHA256);
-				if (dataSHA256.empty()) {
-					NOTIFY_ERROR(h_, "PutMultipartObjectToS3Bucket: CalculateSHA256 failed.");
-                    completion->Call(h_, s3::S3Result::kError, "");
+				s3::S3MultipartUploadPlan plan;
+				if (!s3::PlanS3MultipartUpload(data->Size(), multipartUploadOptions, plan)) {
+					NOTIFY_ERROR(h_, "PutMultipartObjectToS3Bucket: PlanS3MultipartUpload failed for size:", data->Size());
+					completion->Call(h_, s3::S3Result::kError, "");
 					return;
 				}
+				NOTIFY(h_, s3::kS3MultipartUploadPlanNotification, &plan);
+				
+				//	This is handled internally for the PutS3Object case, but we need to do it here
+				//	for the multipart upload case.
+				char dataSHA256[32];
+				encoding::CalculateSHA256(data->Data(), data->Size(), dataSHA256);
 				
 				std::string dataSHA256Hex;
-				string::BinaryStringToHex(dataSHA256, dataSHA256Hex);
+				string::BinaryStringToHex(std::string(dataSHA256, 32), dataSHA256Hex);
 				if (dataSHA256Hex.empty()) {
 					NOTIFY_ERROR(h_, "PutMultipartObjectToS3Bucket: BinaryStringToHex failed.");
                     completion->Call(h_, s3::S3Result::kError, "");
 					return;
 				}
                 
-                auto initiateClass = std::make_shared<InitiateUploadClass>(shared_from_this(),
-                                                                           s3ObjectKey,
-                                                                           data,
-                                                                           dataSHA256Hex,
-                                                                           completion);
-                initiateClass->InitiateUploadWithRetry(h_);
+                auto upload = std::make_shared<MultipartUploadClass>(shared_from_this(),
+                                                                     s3ObjectKey,
+                                                                     data,
+                                                                     useReducedRedundancyStorage,
+                                                                     multipartUploadOptions,
+                                                                     plan,
+                                                                     completion);
+                upload->Start(h_, dataSHA256Hex);
+			}
+			
+			//
+			void S3BucketImpl::PutObjectFromStream(const HermitPtr& h_,
+												   const std::string& s3ObjectKey,
+												   const uint64_t& expectedSize,
+												   const DataProviderPtr& dataProvider,
+												   const bool& useReducedRedundancyStorage,
+												   const s3::S3MultipartUploadOptions& multipartUploadOptions,
+												   const s3::PutS3ObjectCompletionPtr& completion) {
+				s3::S3MultipartUploadPlan plan;
+				if (!s3::PlanS3MultipartUpload(expectedSize, multipartUploadOptions, plan)) {
+					NOTIFY_ERROR(h_, "PutObjectFromStream: PlanS3MultipartUpload failed for size:", expectedSize);
+					completion->Call(h_, s3::S3Result::kError, "");
+					return;
+				}
+				NOTIFY(h_, s3::kS3MultipartUploadPlanNotification, &plan);
+				
+				auto upload = std::make_shared<MultipartUploadClass>(shared_from_this(),
+																	 s3ObjectKey,
+																	 nullptr,
+																	 useReducedRedundancyStorage,
+																	 multipartUploadOptions,
+																	 plan,
+																	 completion);
+				auto receiver = std::make_shared<StreamPartReceiver>(upload, plan.mPartSize);
+				auto streamCompletion = std::make_shared<StreamCompletion>(upload, receiver);
+				dataProvider->Call(h_, receiver, streamCompletion);
 			}
 			
 		} // namespace impl
@@ -31,6 +31,15 @@ namespace hermit {
             completion->Call(h_, s3::S3Result::kError);
 		}
 		
+		//
+		void S3Bucket::DeleteObjects(const HermitPtr& h_,
+									 const std::vector<std::string>& objectKeys,
+									 const s3::S3DeletedObjectReporterPtr& deletedObjectReporter,
+									 const s3::S3CompletionBlockPtr& completion) {
+			NOTIFY_ERROR(h_, "S3Bucket::DeleteObjects unimplemented");
+			completion->Call(h_, s3::S3Result::kError);
+		}
+		
 		//
 		void S3Bucket::GetObject(const HermitPtr& h_,
 								 const std::string& inS3ObjectKey,
@@ -40,6 +49,16 @@ namespace hermit {
 			inCompletion->Call(h_, s3::S3Result::kError);
 		}
 		
+		//
+		void S3Bucket::StreamInObject(const HermitPtr& h_,
+									  const std::string& inS3ObjectKey,
+									  const s3::S3RangedGetOptions& inOptions,
+									  const DataReceiverPtr& inDataReceiver,
+									  const s3::S3CompletionBlockPtr& inCompletion) {
+			NOTIFY_ERROR(h_, "S3Bucket::StreamInObject unimplemented");
+			inCompletion->Call(h_, s3::S3Result::kError);
+		}
+		
 		//
 		void S3Bucket::GetObjectVersion(const HermitPtr& h_,
 										const std::string& inS3ObjectKey,
@@ -55,11 +74,24 @@ namespace hermit {
 								 const std::string& inS3ObjectKey,
 								 const SharedBufferPtr& inData,
 								 const bool& inUseReducedRedundancyStorage,
+								 const s3::S3MultipartUploadOptions& multipartUploadOptions,
 								 const s3::PutS3ObjectCompletionPtr& inCompletion) {
 			NOTIFY_ERROR(h_, "S3Bucket::PutObject unimplemented");
 			inCompletion->Call(h_, s3::S3Result::kError, "");
 		}
 		
+		//
+		void S3Bucket::PutObjectFromStream(const HermitPtr& h_,
+										   const std::string& inS3ObjectKey,
+										   const uint64_t& inExpectedSize,
+										   const DataProviderPtr& inDataProvider,
+										   const bool& inUseReducedRedundancyStorage,
+										   const s3::S3MultipartUploadOptions& multipartUploadOptions,
+										   const s3::PutS3ObjectCompletionPtr& inCompletion) {
+			NOTIFY_ERROR(h_, "S3Bucket::PutObjectFromStream unimplemented");
+			inCompletion->Call(h_, s3::S3Result::kError, "");
+		}
+		
 		//
         void S3Bucket::DeleteObject(const HermitPtr& h_, const std::string& inObjectKey, const s3::S3CompletionBlockPtr& completion) {
 			NOTIFY_ERROR(h_, "S3Bucket::DeleteObject unimplemented");
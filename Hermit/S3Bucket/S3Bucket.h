@@ -20,10 +20,14 @@
 #define S3Bucket_h
 
 #include "Hermit/Foundation/Hermit.h"
+#include "Hermit/Foundation/StreamDataFunction.h"
 #include "Hermit/S3/GetS3Object.h"
 #include "Hermit/S3/GetS3ObjectWithVersion.h"
+#include "Hermit/S3/S3MultipartUploadPlan.h"
+#include "Hermit/S3/S3RangedGetOptions.h"
 #include "Hermit/S3/PutS3Object.h"
 #include "Hermit/S3/S3DeleteObject.h"
+#include "Hermit/S3/S3DeleteObjects.h"
 #include "Hermit/S3/S3GetBucketVersioning.h"
 #include "Hermit/S3/S3ListObjects.h"
 
@@ -45,6 +49,13 @@ namespace hermit {
 								   const s3::GetS3ObjectResponseBlockPtr& inResponseBlock,
 								   const s3::S3CompletionBlockPtr& inCompletion);
 			
+			// Delivers the object to dataReceiver in order, fetching it as concurrent ranged requests.
+			virtual void StreamInObject(const HermitPtr& h_,
+										const std::string& inS3ObjectKey,
+										const s3::S3RangedGetOptions& inOptions,
+										const DataReceiverPtr& inDataReceiver,
+										const s3::S3CompletionBlockPtr& inCompletion);
+			
 			//
 			virtual void GetObjectVersion(const HermitPtr& h_,
 										  const std::string& inS3ObjectKey,
@@ -52,18 +63,35 @@ namespace hermit {
 										  const s3::GetS3ObjectResponseBlockPtr& inResponseBlock,
 										  const s3::S3CompletionBlockPtr& inCompletion);
 			
-			//
+			// multipartUploadOptions only apply to objects large enough to be sent as a multipart upload
 			virtual void PutObject(const HermitPtr& h_,
 								   const std::string& inS3ObjectKey,
 								   const SharedBufferPtr& inData,
 								   const bool& inUseReducedRedundancyStorage,
+								   const s3::S3MultipartUploadOptions& multipartUploadOptions,
 								   const s3::PutS3ObjectCompletionPtr& inCompletion);
 			
+			// expectedSize is only a hint used to size the parts, pass 0 if it isn't known.
+			// Streams too small for a multipart upload are sent as a single object.
+			virtual void PutObjectFromStream(const HermitPtr& h_,
+											 const std::string& inS3ObjectKey,
+											 const uint64_t& inExpectedSize,
+											 const DataProviderPtr& inDataProvider,
+											 const bool& inUseReducedRedundancyStorage,
+											 const s3::S3MultipartUploadOptions& multipartUploadOptions,
+											 const s3::PutS3ObjectCompletionPtr& inCompletion);
+			
 			//
 			virtual void DeleteObject(const HermitPtr& h_,
                                       const std::string& objectKey,
                                       const s3::S3CompletionBlockPtr& completion);
 			
+			//	Deletes up to s3::kS3DeleteObjectsMaxKeys objects with one request; see s3::S3DeleteObjects.
+			virtual void DeleteObjects(const HermitPtr& h_,
+									   const std::vector<std::string>& objectKeys,
+									   const s3::S3DeletedObjectReporterPtr& deletedObjectReporter,
+									   const s3::S3CompletionBlockPtr& completion);
+			
 			//
 			virtual void IsVersioningEnabled(const HermitPtr& h_,
 											 const s3::S3GetBucketVersioningCompletionPtr& inCompletion);
@@ -20,7 +20,7 @@
 #include "Hermit/HTTP/CreateHTTPSession.h"
 #include "Hermit/S3/GenerateAWS4SigningKey.h"
 #include "Hermit/S3/GetS3BucketLocation.h"
-#include "Hermit/S3/S3RetryClass.h"
+#include "Hermit/S3/S3RetryPolicy.h"
 #include "S3BucketImpl.h"
 
 namespace hermit {
@@ -91,11 +91,7 @@ namespace hermit {
                     GetBucketLocationClass(const S3BucketImplPtr& bucket, const InitS3BucketCompletionPtr& completion) :
                     mBucket(bucket),
                     mCompletion(completion),
-                    mLatestResult(s3::S3Result::kUnknown),
-                    mRetries(0),
-                    mAccessDeniedRetries(0),
-                    mSleepInterval(1),
-                    mSleepIntervalStep(2) {
+                    mRetryPolicy("GetBucketLocation", S3BucketImpl::kMaxRetries) {
                     }
                     
                     //
@@ -105,10 +101,7 @@ namespace hermit {
                             return;
                         }
                         
-                        if (mRetries > 0) {
-                            s3::S3NotificationParams params("GetBucketLocation", mRetries, mLatestResult);
-                            NOTIFY(h_, s3::kS3RetryNotification, &params);
-                        }
+                        mRetryPolicy.WillAttempt(h_);
                         
                         auto completion = std::make_shared<GetBucketLocationCompletion>(shared_from_this());
                         GetS3BucketLocation(h_,
@@ -121,59 +114,19 @@ namespace hermit {
                     
                     //
                     void Completion(const HermitPtr& h_, const s3::S3Result& result, const std::string& location) {
-                        mLatestResult = result;
-                        
-                        if (!ShouldRetry(result)) {
-                            if (mRetries > 0) {
-                                s3::S3NotificationParams params("GetBucketLocation", mRetries, result);
-                                NOTIFY(h_, s3::kS3RetryCompleteNotification, &params);
-                            }
+                        auto decision = mRetryPolicy.AttemptComplete(h_, result);
+                        if (decision == s3::S3RetryDecision::kDone) {
                             ProcessResult(h_, result, location);
                             return;
                         }
-                        if (++mRetries == S3BucketImpl::kMaxRetries) {
-                            s3::S3NotificationParams params("GetBucketLocation", mRetries, result);
-                            NOTIFY(h_, s3::kS3MaxRetriesExceededNotification, &params);
-                            
+                        if (decision == s3::S3RetryDecision::kMaxRetriesExceeded) {
                             NOTIFY_ERROR(h_, "Maximum retries exceeded, most recent result:", (int)result);
                             mCompletion->Call(h_, S3ResultToWithS3BucketStatus(result));
                             return;
                         }
-                        
-                        int fifthSecondIntervals = mSleepInterval * 5;
-                        for (int i = 0; i < fifthSecondIntervals; ++i) {
-                            if (CHECK_FOR_ABORT(h_)) {
-                                mCompletion->Call(h_, WithS3BucketStatus::kCancel);
-                                return;
-                            }
-                            std::this_thread::sleep_for(std::chrono::milliseconds(200));
-                        }
-                        mSleepInterval += mSleepIntervalStep;
-                        mSleepIntervalStep += 2;
-                        
-                        GetBucketLocationWithRetry(h_);
-                    }
-                    
-                    //
-                    bool ShouldRetry(const s3::S3Result& result) {
-                        if ((result == s3::S3Result::kTimedOut) ||
-                            (result == s3::S3Result::kNetworkConnectionLost) ||
-                            (result == s3::S3Result::kChecksumMismatch) ||
-                            (result == s3::S3Result::k500InternalServerError) ||
-                            (result == s3::S3Result::k503ServiceUnavailable) ||
-                            (result == s3::S3Result::kS3InternalError) ||
-                            // borderline candidate for retry, but I've seen it recover "in the wild":
-                            (result == s3::S3Result::kHostNotFound)) {
-                            return true;
-                        }
-                        // we allow a single retry on PermissionDenied since i've seen this fail due to
-                        // flaky network behavior in the wild. (but we don't want to spam the server in
-                        // cases where access is indeed denied so we only do it once.)
-                        if ((result == s3::S3Result::k403AccessDenied) && (mAccessDeniedRetries == 0)) {
-                            ++mAccessDeniedRetries;
-                            return true;
+                        if (!mRetryPolicy.ScheduleRetry(h_, shared_from_this(), &GetBucketLocationClass::GetBucketLocationWithRetry)) {
+                            mCompletion->Call(h_, WithS3BucketStatus::kCancel);
                         }
-                        return false;
                     }
                     
                     //
@@ -195,11 +148,7 @@ namespace hermit {
                     //
                     S3BucketImplPtr mBucket;
                     InitS3BucketCompletionPtr mCompletion;
-                    s3::S3Result mLatestResult;
-                    int mRetries;
-                    int mAccessDeniedRetries;
-                    int mSleepInterval;
-                    int mSleepIntervalStep;
+                    s3::S3RetryPolicy mRetryPolicy;
                 };
                 
                 //
@@ -59,6 +59,13 @@ namespace hermit {
 									   const s3::GetS3ObjectResponseBlockPtr& inResponseBlock,
 									   const s3::S3CompletionBlockPtr& inCompletion) override;
 				
+				//
+				virtual void StreamInObject(const HermitPtr& h_,
+											const std::string& inS3ObjectKey,
+											const s3::S3RangedGetOptions& inOptions,
+											const DataReceiverPtr& inDataReceiver,
+											const s3::S3CompletionBlockPtr& inCompletion) override;
+				
 				//
 				virtual void GetObjectVersion(const HermitPtr& h_,
 											  const std::string& inS3ObjectKey,
@@ -71,13 +78,29 @@ namespace hermit {
 									   const std::string& inS3ObjectKey,
 									   const SharedBufferPtr& inData,
 									   const bool& inUseReducedRedundancyStorage,
+									   const s3::S3MultipartUploadOptions& multipartUploadOptions,
 									   const s3::PutS3ObjectCompletionPtr& inCompletion) override;
 				
+				//
+				virtual void PutObjectFromStream(const HermitPtr& h_,
+												 const std::string& inS3ObjectKey,
+												 const uint64_t& inExpectedSize,
+												 const DataProviderPtr& inDataProvider,
+												 const bool& inUseReducedRedundancyStorage,
+												 const s3::S3MultipartUploadOptions& multipartUploadOptions,
+												 const s3::PutS3ObjectCompletionPtr& inCompletion) override;
+				
 				//
 				virtual void DeleteObject(const HermitPtr& h_,
                                           const std::string& objectKey,
                                           const s3::S3CompletionBlockPtr& completion) override;
 				
+				//
+				virtual void DeleteObjects(const HermitPtr& h_,
+										   const std::vector<std::string>& objectKeys,
+										   const s3::S3DeletedObjectReporterPtr& deletedObjectReporter,
+										   const s3::S3CompletionBlockPtr& completion) override;
+				
 				//
 				virtual void IsVersioningEnabled(const HermitPtr& h_, const s3::S3GetBucketVersioningCompletionPtr& inCompletion) override;
 				
@@ -86,6 +109,7 @@ namespace hermit {
                                                   const std::string& s3ObjectKey,
                                                   const SharedBufferPtr& data,
                                                   const bool& useReducedRedundancyStorage, // TODO: currently ignored
+                                                  const s3::S3MultipartUploadOptions& multipartUploadOptions,
                                                   const s3::PutS3ObjectCompletionPtr& completion);
                 
 				//
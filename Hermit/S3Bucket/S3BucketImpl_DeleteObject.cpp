@@ -18,7 +18,7 @@
 
 #include "Hermit/Foundation/Notification.h"
 #include "Hermit/S3/S3DeleteObject.h"
-#include "Hermit/S3/S3RetryClass.h"
+#include "Hermit/S3/S3RetryPolicy.h"
 #include "S3BucketImpl.h"
 
 namespace hermit {
@@ -58,11 +58,7 @@ namespace hermit {
                     mBucket(bucket),
                     mObjectKey(objectKey),
                     mCompletion(completion),
-                    mLatestResult(s3::S3Result::kUnknown),
-                    mRetries(0),
-                    mAccessDeniedRetries(0),
-                    mSleepInterval(1),
-                    mSleepIntervalStep(2) {
+                    mRetryPolicy("DeleteObject", S3BucketImpl::kMaxRetries) {
                     }
                     
                     //
@@ -72,10 +68,7 @@ namespace hermit {
                             return;
                         }
                         
-                        if (mRetries > 0) {
-                            s3::S3NotificationParams params("DeleteObject", mRetries, mLatestResult);
-                            NOTIFY(h_, s3::kS3RetryNotification, &params);
-                        }
+                        mRetryPolicy.WillAttempt(h_);
                         
                         mBucket->RefreshSigningKeyIfNeeded();
                         
@@ -92,59 +85,19 @@ namespace hermit {
                     
                     //
                     void Completion(const HermitPtr& h_, const s3::S3Result& result) {
-                        mLatestResult = result;
-                        
-                        if (!ShouldRetry(result)) {
-                            if (mRetries > 0) {
-                                s3::S3NotificationParams params("DeleteObject", mRetries, result);
-                                NOTIFY(h_, s3::kS3RetryCompleteNotification, &params);
-                            }
+                        auto decision = mRetryPolicy.AttemptComplete(h_, result);
+                        if (decision == s3::S3RetryDecision::kDone) {
                             ProcessResult(h_, result);
                             return;
                         }
-                        if (++mRetries == S3BucketImpl::kMaxRetries) {
-                            s3::S3NotificationParams params("DeleteObject", mRetries, result);
-                            NOTIFY(h_, s3::kS3MaxRetriesExceededNotification, &params);
-                            
+                        if (decision == s3::S3RetryDecision::kMaxRetriesExceeded) {
                             NOTIFY_ERROR(h_, "DeleteObjectFromS3Bucket: maximum retries exceeded, most recent result:", (int)result);
                             mCompletion->Call(h_, result);
                             return;
                         }
-                        
-                        int fifthSecondIntervals = mSleepInterval * 5;
-                        for (int i = 0; i < fifthSecondIntervals; ++i) {
-                            if (CHECK_FOR_ABORT(h_)) {
-                                mCompletion->Call(h_, s3::S3Result::kCanceled);
-                                return;
-                            }
-                            std::this_thread::sleep_for(std::chrono::milliseconds(200));
-                        }
-                        mSleepInterval += mSleepIntervalStep;
-                        mSleepIntervalStep += 2;
-                        
-                        DeleteObjectWithRetry(h_);
-                    }
-                    
-                    //
-                    bool ShouldRetry(const s3::S3Result& result) {
-                        if ((result == s3::S3Result::kTimedOut) ||
-                            (result == s3::S3Result::kNetworkConnectionLost) ||
-                            (result == s3::S3Result::kChecksumMismatch) ||
-                            (result == s3::S3Result::k500InternalServerError) ||
-                            (result == s3::S3Result::k503ServiceUnavailable) ||
-                            (result == s3::S3Result::kS3InternalError) ||
-                            // borderline candidate for retry, but I've seen it recover "in the wild":
-                            (result == s3::S3Result::kHostNotFound)) {
-                            return true;
-                        }
-                        // we allow a single retry on PermissionDenied since i've seen this fail due to
-                        // flaky network behavior in the wild. (but we don't want to spam the server in
-                        // cases where access is indeed denied so we only do it once.)
-                        if ((result == s3::S3Result::k403AccessDenied) && (mAccessDeniedRetries == 0)) {
-                            ++mAccessDeniedRetries;
-                            return true;
+                        if (!mRetryPolicy.ScheduleRetry(h_, shared_from_this(), &DeleteObjectClass::DeleteObjectWithRetry)) {
+                            mCompletion->Call(h_, s3::S3Result::kCanceled);
                         }
-                        return false;
                     }
                     
                     //
@@ -156,11 +109,7 @@ namespace hermit {
                     S3BucketImplPtr mBucket;
                     std::string mObjectKey;
                     s3::S3CompletionBlockPtr mCompletion;
-                    s3::S3Result mLatestResult;
-                    int mRetries;
-                    int mAccessDeniedRetries;
-                    int mSleepInterval;
-                    int mSleepIntervalStep;
+                    s3::S3RetryPolicy mRetryPolicy;
                 };
                 
                 //
@@ -0,0 +1,180 @@
+//
+//	Hermit
+//	Copyright (C) 2017 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "Hermit/Foundation/Notification.h"
+#include "Hermit/S3/S3DeleteObjects.h"
+#include "Hermit/S3/S3RetryPolicy.h"
+#include "S3BucketImpl.h"
+
+namespace hermit {
+	namespace s3bucket {
+		namespace impl {
+			namespace S3BucketImpl_DeleteObjects_Impl {
+				
+				//
+				typedef std::shared_ptr<S3BucketImpl> S3BucketImplPtr;
+				
+				//
+				class DeleteObjectsClass;
+				typedef std::shared_ptr<DeleteObjectsClass> DeleteObjectsClassPtr;
+				
+				//
+				class DeleteObjectsCompletion : public s3::S3CompletionBlock {
+				public:
+					//
+					DeleteObjectsCompletion(const DeleteObjectsClassPtr& deleteObjectsClass) :
+					mDeleteObjectsClass(deleteObjectsClass) {
+					}
+					
+					//
+					virtual void Call(const HermitPtr& h_, const s3::S3Result& result) override;
+					
+					//
+					DeleteObjectsClassPtr mDeleteObjectsClass;
+				};
+				
+				//
+				class DeleteObjectsReporter : public s3::S3DeletedObjectReporter {
+				public:
+					//
+					DeleteObjectsReporter(const DeleteObjectsClassPtr& deleteObjectsClass) :
+					mDeleteObjectsClass(deleteObjectsClass) {
+					}
+					
+					//
+					virtual void Call(const HermitPtr& h_, const std::string& objectKey, const s3::S3Result& result) override;
+					
+					//
+					DeleteObjectsClassPtr mDeleteObjectsClass;
+				};
+				
+				//	The reporter is only called once a request has succeeded, so retrying the whole
+				//	request never reports a key twice. Keys that come back with InternalError or
+				//	SlowDown are held back and resent on their own under the same retry policy;
+				//	they're only reported if they still fail once the retries run out.
+				class DeleteObjectsClass : public std::enable_shared_from_this<DeleteObjectsClass> {
+				public:
+					//
+					DeleteObjectsClass(const S3BucketImplPtr& bucket,
+									   const std::vector<std::string>& objectKeys,
+									   const s3::S3DeletedObjectReporterPtr& deletedObjectReporter,
+									   const s3::S3CompletionBlockPtr& completion) :
+					mBucket(bucket),
+					mObjectKeys(objectKeys),
+					mDeletedObjectReporter(deletedObjectReporter),
+					mCompletion(completion),
+					mRetryPolicy("DeleteObjects", S3BucketImpl::kMaxRetries) {
+					}
+					
+					//
+					void DeleteObjectsWithRetry(const HermitPtr& h_) {
+						if (CHECK_FOR_ABORT(h_)) {
+							mCompletion->Call(h_, s3::S3Result::kCanceled);
+							return;
+						}
+						
+						mRetryPolicy.WillAttempt(h_);
+						
+						mBucket->RefreshSigningKeyIfNeeded();
+						
+						auto completion = std::make_shared<DeleteObjectsCompletion>(shared_from_this());
+						s3::S3DeleteObjects(h_,
+											mBucket->mHTTPSession,
+											mBucket->mAWSPublicKey,
+											mBucket->mAWSSigningKey,
+											mBucket->mAWSRegion,
+											mBucket->mBucketName,
+											mObjectKeys,
+											std::make_shared<DeleteObjectsReporter>(shared_from_this()),
+											completion);
+					}
+					
+					//
+					void ObjectDeleted(const HermitPtr& h_, const std::string& objectKey, const s3::S3Result& result) {
+						if (result == s3::S3Result::kS3InternalError) {
+							mRetryKeys.push_back(objectKey);
+							return;
+						}
+						mDeletedObjectReporter->Call(h_, objectKey, result);
+					}
+					
+					//
+					void Completion(const HermitPtr& h_, const s3::S3Result& result) {
+						// A successful request can still carry per-key failures worth another try;
+						// if so only those keys go in the next attempt.
+						s3::S3Result attemptResult = result;
+						if ((result == s3::S3Result::kSuccess) && !mRetryKeys.empty()) {
+							attemptResult = s3::S3Result::kS3InternalError;
+							mObjectKeys.swap(mRetryKeys);
+							mRetryKeys.clear();
+						}
+						
+						auto decision = mRetryPolicy.AttemptComplete(h_, attemptResult);
+						if (decision == s3::S3RetryDecision::kDone) {
+							mCompletion->Call(h_, result);
+							return;
+						}
+						if (decision == s3::S3RetryDecision::kMaxRetriesExceeded) {
+							NOTIFY_ERROR(h_, "DeleteObjects: maximum retries exceeded, most recent result:", (int)attemptResult);
+							if (attemptResult != result) {
+								for (auto it = begin(mObjectKeys); it != end(mObjectKeys); ++it) {
+									mDeletedObjectReporter->Call(h_, *it, attemptResult);
+								}
+							}
+							mCompletion->Call(h_, result);
+							return;
+						}
+						if (!mRetryPolicy.ScheduleRetry(h_, shared_from_this(), &DeleteObjectsClass::DeleteObjectsWithRetry)) {
+							mCompletion->Call(h_, s3::S3Result::kCanceled);
+						}
+					}
+					
+					//
+					S3BucketImplPtr mBucket;
+					std::vector<std::string> mObjectKeys;
+					std::vector<std::string> mRetryKeys;
+					s3::S3DeletedObjectReporterPtr mDeletedObjectReporter;
+					s3::S3CompletionBlockPtr mCompletion;
+					s3::S3RetryPolicy mRetryPolicy;
+				};
+				
+				//
+				void DeleteObjectsReporter::Call(const HermitPtr& h_, const std::string& objectKey, const s3::S3Result& result) {
+					mDeleteObjectsClass->ObjectDeleted(h_, objectKey, result);
+				}
+				
+				//
+				void DeleteObjectsCompletion::Call(const HermitPtr& h_, const s3::S3Result& result) {
+					mDeleteObjectsClass->Completion(h_, result);
+				}
+				
+			} // namespace S3BucketImpl_DeleteObjects_Impl
+			using namespace S3BucketImpl_DeleteObjects_Impl;
+			
+			//
+			void S3BucketImpl::DeleteObjects(const HermitPtr& h_,
+											 const std::vector<std::string>& objectKeys,
+											 const s3::S3DeletedObjectReporterPtr& deletedObjectReporter,
+											 const s3::S3CompletionBlockPtr& completion) {
+				auto deleteObjects = std::make_shared<DeleteObjectsClass>(shared_from_this(), objectKeys, deletedObjectReporter, completion);
+				deleteObjects->DeleteObjectsWithRetry(h_);
+			}
+			
+		} // namespace impl
+	} // namespace s3bucket
+} // namespace hermit
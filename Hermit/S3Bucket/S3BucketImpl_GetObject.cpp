@@ -19,7 +19,8 @@
 #include "Hermit/Foundation/Notification.h"
 #include "Hermit/S3/GetS3BucketLocation.h"
 #include "Hermit/S3/GetS3Object.h"
-#include "Hermit/S3/S3RetryClass.h"
+#include "Hermit/S3/S3Notification.h"
+#include "Hermit/S3/S3RetryPolicy.h"
 #include "S3BucketImpl.h"
 
 namespace hermit {
@@ -31,23 +32,23 @@ namespace hermit {
 				typedef std::shared_ptr<S3BucketImpl> S3BucketImplPtr;
 				
 				//
-				class GetObjectClass;
-				typedef std::shared_ptr<GetObjectClass> GetObjectClassPtr;
-				
-				//
-				class GetObjectCompletion : public s3::S3CompletionBlock {
+				class Receiver : public DataReceiver {
 				public:
 					//
-					GetObjectCompletion(const GetObjectClassPtr& getObjectClass) :
-					mGetObjectClass(getObjectClass) {
+					virtual void Call(const HermitPtr& h_,
+									  const DataBuffer& data,
+									  const bool& isEndOfData,
+									  const DataCompletionPtr& completion) override {
+						if (data.second > 0) {
+							mData.append(data.first, data.second);
+						}
+						completion->Call(h_, StreamDataResult::kSuccess);
 					}
 					
 					//
-					virtual void Call(const HermitPtr& h_, const s3::S3Result& result) override;
-					
-					//
-					GetObjectClassPtr mGetObjectClass;
+					std::string mData;
 				};
+				typedef std::shared_ptr<Receiver> ReceiverPtr;
 				
                 //
                 class GetBucketLocationCompletion : public s3::GetS3BucketLocationCompletion {
@@ -81,6 +82,27 @@ namespace hermit {
                 };
                 
 				//
+				class GetObjectClass;
+				typedef std::shared_ptr<GetObjectClass> GetObjectClassPtr;
+				
+				//
+				class GetObjectCompletion : public s3::S3CompletionBlock {
+				public:
+					//
+					GetObjectCompletion(const GetObjectClassPtr& getObjectClass) :
+					mGetObjectClass(getObjectClass) {
+					}
+					
+					//
+					virtual void Call(const HermitPtr& h_, const s3::S3Result& result) override;
+					
+					//
+					GetObjectClassPtr mGetObjectClass;
+				};
+				
+				//	Ranges retry their own transient errors inside StreamInObject. What's left to retry
+				//	here is a mismatch against the sha256 stored at upload time, which can only be seen
+				//	once the whole object is in; that gets one more fetch of the object.
 				class GetObjectClass : public std::enable_shared_from_this<GetObjectClass> {
 				public:
 					//
@@ -92,11 +114,7 @@ namespace hermit {
 					mObjectKey(objectKey),
 					mResponseBlock(responseBlock),
 					mCompletion(completion),
-					mLatestResult(s3::S3Result::kUnknown),
-					mRetries(0),
-					mAccessDeniedRetries(0),
-					mSleepInterval(1),
-					mSleepIntervalStep(2) {
+					mRetryPolicy("GetObject", 2) {
 					}
 					
 					//
@@ -106,82 +124,33 @@ namespace hermit {
 							return;
 						}
 						
-						if (mRetries > 0) {
-							s3::S3NotificationParams params("GetObject", mRetries, mLatestResult);
-							NOTIFY(h_, s3::kS3RetryNotification, &params);
-						}
-
-						mBucket->RefreshSigningKeyIfNeeded();
+						mRetryPolicy.WillAttempt(h_);
 						
+						// a fresh receiver each time so a failed attempt doesn't leave partial data behind
+						mReceiver = std::make_shared<Receiver>();
 						auto completion = std::make_shared<GetObjectCompletion>(shared_from_this());
-						s3::GetS3Object(h_,
-										mBucket->mHTTPSession,
-										mBucket->mAWSPublicKey,
-										mBucket->mAWSSigningKey,
-										mBucket->mAWSRegion,
-										mBucket->mBucketName,
-										mObjectKey,
-										mResponseBlock,
-										completion);
+						mBucket->StreamInObject(h_, mObjectKey, s3::S3RangedGetOptions(), mReceiver, completion);
 					}
 					
 					//
 					void Completion(const HermitPtr& h_, const s3::S3Result& result) {
-						mLatestResult = result;
-
-						if (!ShouldRetry(result)) {
-							if (mRetries > 0) {
-								s3::S3NotificationParams params("GetObject", mRetries, result);
-								NOTIFY(h_, s3::kS3RetryCompleteNotification, &params);
+						if (result == s3::S3Result::kChecksumMismatch) {
+							auto decision = mRetryPolicy.AttemptComplete(h_, result);
+							if (decision == s3::S3RetryDecision::kRetry) {
+								if (!mRetryPolicy.ScheduleRetry(h_, shared_from_this(), &GetObjectClass::GetObjectWithRetry)) {
+									ProcessResult(h_, s3::S3Result::kCanceled);
+								}
+								return;
 							}
-							ProcessResult(h_, result);
-							return;
-						}
-						if (++mRetries == S3BucketImpl::kMaxRetries) {
-							s3::S3NotificationParams params("GetObject", mRetries, result);
-							NOTIFY(h_, s3::kS3MaxRetriesExceededNotification, &params);
-
 							NOTIFY_ERROR(h_, "Maximum retries exceeded, most recent result:", (int)result);
-							mCompletion->Call(h_, result);
-							return;
 						}
-						
-						int fifthSecondIntervals = mSleepInterval * 5;
-						for (int i = 0; i < fifthSecondIntervals; ++i) {
-							if (CHECK_FOR_ABORT(h_)) {
-								mCompletion->Call(h_, s3::S3Result::kCanceled);
-								return;
-							}
-							std::this_thread::sleep_for(std::chrono::milliseconds(200));
+						else if (mRetryPolicy.mRetries > 0) {
+							s3::S3NotificationParams params("GetObject", mRetryPolicy.mRetries, result);
+							NOTIFY(h_, s3::kS3RetryCompleteNotification, &params);
 						}
-						mSleepInterval += mSleepIntervalStep;
-						mSleepIntervalStep += 2;
-						
-						GetObjectWithRetry(h_);
+						ProcessResult(h_, result);
 					}
 					
-					//
-					bool ShouldRetry(const s3::S3Result& result) {
-						if ((result == s3::S3Result::kTimedOut) ||
-							(result == s3::S3Result::kNetworkConnectionLost) ||
-							(result == s3::S3Result::kChecksumMismatch) ||
-							(result == s3::S3Result::k500InternalServerError) ||
-							(result == s3::S3Result::k503ServiceUnavailable) ||
-							(result == s3::S3Result::kS3InternalError) ||
-							// borderline candidate for retry, but I've seen it recover "in the wild":
-							(result == s3::S3Result::kHostNotFound)) {
-							return true;
-						}
-						// we allow a single retry on PermissionDenied since i've seen this fail due to
-						// flaky network behavior in the wild. (but we don't want to spam the server in
-						// cases where access is indeed denied so we only do it once.)
-						if ((result == s3::S3Result::k403AccessDenied) && (mAccessDeniedRetries == 0)) {
-							++mAccessDeniedRetries;
-							return true;
-						}
-						return false;
-					}
-
 					//
 					void ProcessResult(const HermitPtr& h_, const s3::S3Result& result) {
 						if (result == s3::S3Result::kCanceled) {
@@ -189,6 +158,7 @@ namespace hermit {
 							return;
 						}
 						if (result == s3::S3Result::kSuccess) {
+							mResponseBlock->Call(DataBuffer(mReceiver->mData.data(), mReceiver->mData.size()));
 							mCompletion->Call(h_, result);
 							return;
 						}
@@ -212,19 +182,16 @@ namespace hermit {
 						}
 						mCompletion->Call(h_, result);
 					}
-
+					
 					//
 					S3BucketImplPtr mBucket;
 					std::string mObjectKey;
 					s3::GetS3ObjectResponseBlockPtr mResponseBlock;
 					s3::S3CompletionBlockPtr mCompletion;
-					s3::S3Result mLatestResult;
-					int mRetries;
-					int mAccessDeniedRetries;
-					int mSleepInterval;
-					int mSleepIntervalStep;
+					ReceiverPtr mReceiver;
+					s3::S3RetryPolicy mRetryPolicy;
 				};
-
+				
 				//
 				void GetObjectCompletion::Call(const HermitPtr& h_, const s3::S3Result& result) {
 					mGetObjectClass->Completion(h_, result);
@@ -17,7 +17,7 @@
 //
 
 #include "Hermit/Foundation/Notification.h"
-#include "Hermit/S3/S3RetryClass.h"
+#include "Hermit/S3/S3RetryPolicy.h"
 #include "S3BucketImpl.h"
 
 namespace hermit {
@@ -57,11 +57,7 @@ namespace hermit {
                                              const s3::S3GetBucketVersioningCompletionPtr& completion) :
                     mBucket(bucket),
                     mCompletion(completion),
-                    mLatestResult(s3::S3Result::kUnknown),
-                    mRetries(0),
-                    mAccessDeniedRetries(0),
-                    mSleepInterval(1),
-                    mSleepIntervalStep(2) {
+                    mRetryPolicy("IsVersioningEnabled", S3BucketImpl::kMaxRetries) {
                     }
                     
                     //
@@ -71,10 +67,7 @@ namespace hermit {
                             return;
                         }
                         
-                        if (mRetries > 0) {
-                            s3::S3NotificationParams params("IsVersioningEnabled", mRetries, mLatestResult);
-                            NOTIFY(h_, s3::kS3RetryNotification, &params);
-                        }
+                        mRetryPolicy.WillAttempt(h_);
                                                 
                         auto completion = std::make_shared<IsVersioningEnabledCompletion>(shared_from_this());
                         s3::S3GetBucketVersioning(h_,
@@ -89,59 +82,19 @@ namespace hermit {
                     void Completion(const HermitPtr& h_,
                                     const s3::S3Result& result,
                                     const s3::S3BucketVersioningStatus& status) {
-                        mLatestResult = result;
-                        
-                        if (!ShouldRetry(result)) {
-                            if (mRetries > 0) {
-                                s3::S3NotificationParams params("IsVersioningEnabled", mRetries, result);
-                                NOTIFY(h_, s3::kS3RetryCompleteNotification, &params);
-                            }
+                        auto decision = mRetryPolicy.AttemptComplete(h_, result);
+                        if (decision == s3::S3RetryDecision::kDone) {
                             ProcessResult(h_, result, status);
                             return;
                         }
-                        if (++mRetries == S3BucketImpl::kMaxRetries) {
-                            s3::S3NotificationParams params("IsVersioningEnabled", mRetries, result);
-                            NOTIFY(h_, s3::kS3MaxRetriesExceededNotification, &params);
-                            
+                        if (decision == s3::S3RetryDecision::kMaxRetriesExceeded) {
                             NOTIFY_ERROR(h_, "Maximum retries exceeded, most recent result:", (int)result);
                             mCompletion->Call(h_, result, s3::S3BucketVersioningStatus::kUnknown);
                             return;
                         }
-                        
-                        int fifthSecondIntervals = mSleepInterval * 5;
-                        for (int i = 0; i < fifthSecondIntervals; ++i) {
-                            if (CHECK_FOR_ABORT(h_)) {
-                                mCompletion->Call(h_, s3::S3Result::kCanceled, s3::S3BucketVersioningStatus::kUnknown);
-                                return;
-                            }
-                            std::this_thread::sleep_for(std::chrono::milliseconds(200));
-                        }
-                        mSleepInterval += mSleepIntervalStep;
-                        mSleepIntervalStep += 2;
-                        
-                        IsVersioningEnabledWithRetry(h_);
-                    }
-                    
-                    //
-                    bool ShouldRetry(const s3::S3Result& result) {
-                        if ((result == s3::S3Result::kTimedOut) ||
-                            (result == s3::S3Result::kNetworkConnectionLost) ||
-                            (result == s3::S3Result::kChecksumMismatch) ||
-                            (result == s3::S3Result::k500InternalServerError) ||
-                            (result == s3::S3Result::k503ServiceUnavailable) ||
-                            (result == s3::S3Result::kS3InternalError) ||
-                            // borderline candidate for retry, but I've seen it recover "in the wild":
-                            (result == s3::S3Result::kHostNotFound)) {
-                            return true;
-                        }
-                        // we allow a single retry on PermissionDenied since i've seen this fail due to
-                        // flaky network behavior in the wild. (but we don't want to spam the server in
-                        // cases where access is indeed denied so we only do it once.)
-                        if ((result == s3::S3Result::k403AccessDenied) && (mAccessDeniedRetries == 0)) {
-                            ++mAccessDeniedRetries;
-                            return true;
+                        if (!mRetryPolicy.ScheduleRetry(h_, shared_from_this(), &IsVersioningEnabledClass::IsVersioningEnabledWithRetry)) {
+                            mCompletion->Call(h_, s3::S3Result::kCanceled, s3::S3BucketVersioningStatus::kUnknown);
                         }
-                        return false;
                     }
                     
                     //
@@ -154,11 +107,7 @@ namespace hermit {
                     //
                     S3BucketImplPtr mBucket;
                     s3::S3GetBucketVersioningCompletionPtr mCompletion;
-                    s3::S3Result mLatestResult;
-                    int mRetries;
-                    int mAccessDeniedRetries;
-                    int mSleepInterval;
-                    int mSleepIntervalStep;
+                    s3::S3RetryPolicy mRetryPolicy;
                 };
                 
                 //
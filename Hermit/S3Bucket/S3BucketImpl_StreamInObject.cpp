@@ -0,0 +1,505 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <strings.h>
+#include "Hermit/Encoding/SHA256.h"
+#include "Hermit/Foundation/Notification.h"
+#include "Hermit/S3/S3Notification.h"
+#include "Hermit/S3/S3RetryPolicy.h"
+#include "Hermit/S3/StreamInS3Object.h"
+#include "Hermit/String/BinaryStringToHex.h"
+#include "S3BucketImpl.h"
+
+namespace hermit {
+	namespace s3bucket {
+		namespace impl {
+			namespace S3BucketImpl_StreamInObject_Impl {
+				
+				//
+				typedef std::shared_ptr<S3BucketImpl> S3BucketImplPtr;
+				typedef std::shared_ptr<std::string> StringPtr;
+				
+				// header names aren't guaranteed to keep the case the server sent
+				std::string GetHeaderValue(const s3::S3ParamVector& params, const char* name) {
+					for (const auto& param : params) {
+						if (strcasecmp(param.first.c_str(), name) == 0) {
+							return param.second;
+						}
+					}
+					return "";
+				}
+				
+				// "bytes 0-8388607/123456789" -> 123456789
+				bool ParseContentRangeTotal(const std::string& contentRange, uint64_t& outTotal) {
+					auto slashPos = contentRange.rfind('/');
+					if ((slashPos == std::string::npos) || (slashPos + 1 == contentRange.size())) {
+						return false;
+					}
+					std::string total(contentRange.substr(slashPos + 1));
+					if (total.find_first_not_of("0123456789") != std::string::npos) {
+						return false;
+					}
+					outTotal = std::stoull(total);
+					return true;
+				}
+				
+				//
+				class RangeReceiver : public DataReceiver {
+				public:
+					//
+					RangeReceiver(uint64_t expectedSize) : mData(std::make_shared<std::string>()) {
+						mData->reserve(expectedSize);
+					}
+					
+					//
+					virtual void Call(const HermitPtr& h_,
+									  const DataBuffer& data,
+									  const bool& isEndOfData,
+									  const DataCompletionPtr& completion) override {
+						if (data.second > 0) {
+							mData->append(data.first, data.second);
+						}
+						completion->Call(h_, StreamDataResult::kSuccess);
+					}
+					
+					//
+					StringPtr mData;
+				};
+				typedef std::shared_ptr<RangeReceiver> RangeReceiverPtr;
+				
+				//
+				class StreamInObjectClass;
+				typedef std::shared_ptr<StreamInObjectClass> StreamInObjectClassPtr;
+				
+				//
+				class GetRangeClass;
+				typedef std::shared_ptr<GetRangeClass> GetRangeClassPtr;
+				
+				//
+				class GetRangeCompletion : public s3::StreamInS3RequestCompletion {
+				public:
+					//
+					GetRangeCompletion(const GetRangeClassPtr& getRangeClass) : mGetRangeClass(getRangeClass) {
+					}
+					
+					//
+					virtual void Call(const HermitPtr& h_, const s3::S3Result& result, const s3::S3ParamVector& params) override;
+					
+					//
+					GetRangeClassPtr mGetRangeClass;
+				};
+				
+				//
+				class GetRangeClass : public std::enable_shared_from_this<GetRangeClass> {
+				public:
+					//
+					GetRangeClass(const S3BucketImplPtr& bucket,
+								  const std::string& objectKey,
+								  uint64_t rangeIndex,
+								  uint64_t offset,
+								  uint64_t size,
+								  const StreamInObjectClassPtr& streamIn) :
+					mBucket(bucket),
+					mObjectKey(objectKey),
+					mRangeIndex(rangeIndex),
+					mOffset(offset),
+					mSize(size),
+					mStreamIn(streamIn),
+					mRetryPolicy("GetObjectRange", S3BucketImpl::kMaxRetries) {
+					}
+					
+					//
+					void GetRangeWithRetry(const HermitPtr& h_) {
+						if (CHECK_FOR_ABORT(h_)) {
+							ProcessResult(h_, s3::S3Result::kCanceled, s3::S3ParamVector());
+							return;
+						}
+						
+						mRetryPolicy.WillAttempt(h_);
+						
+						mBucket->RefreshSigningKeyIfNeeded();
+						
+						// a fresh receiver each time so a failed attempt doesn't leave partial data behind
+						mReceiver = std::make_shared<RangeReceiver>(mSize);
+						auto completion = std::make_shared<GetRangeCompletion>(shared_from_this());
+						s3::StreamInS3ObjectRange(h_,
+												  mBucket->mHTTPSession,
+												  mBucket->mAWSPublicKey,
+												  mBucket->mAWSSigningKey,
+												  mBucket->mAWSRegion,
+												  mBucket->mBucketName,
+												  mObjectKey,
+												  mOffset,
+												  mSize,
+												  mReceiver,
+												  completion);
+					}
+					
+					//
+					void Completion(const HermitPtr& h_, const s3::S3Result& result, const s3::S3ParamVector& params) {
+						auto decision = mRetryPolicy.AttemptComplete(h_, result);
+						if (decision == s3::S3RetryDecision::kDone) {
+							ProcessResult(h_, result, params);
+							return;
+						}
+						if (decision == s3::S3RetryDecision::kMaxRetriesExceeded) {
+							NOTIFY_ERROR(h_, "Maximum retries exceeded, most recent result:", (int)result);
+							ProcessResult(h_, result, s3::S3ParamVector());
+							return;
+						}
+						if (!mRetryPolicy.ScheduleRetry(h_, shared_from_this(), &GetRangeClass::GetRangeWithRetry)) {
+							ProcessResult(h_, s3::S3Result::kCanceled, s3::S3ParamVector());
+						}
+					}
+					
+					//
+					void ProcessResult(const HermitPtr& h_, const s3::S3Result& result, const s3::S3ParamVector& params);
+					
+					//
+					S3BucketImplPtr mBucket;
+					std::string mObjectKey;
+					uint64_t mRangeIndex;
+					uint64_t mOffset;
+					uint64_t mSize;
+					StreamInObjectClassPtr mStreamIn;
+					RangeReceiverPtr mReceiver;
+					s3::S3RetryPolicy mRetryPolicy;
+				};
+				
+				//
+				void GetRangeCompletion::Call(const HermitPtr& h_, const s3::S3Result& result, const s3::S3ParamVector& params) {
+					mGetRangeClass->Completion(h_, result, params);
+				}
+				
+				// Downloads an object as a series of ranged GETs, up to mMaxRangesInFlight at once. The
+				// first range also tells us the object's size, ETag and (if present) the sha256 we stored
+				// at upload time. Ranges can complete in any order; completed ranges wait in mCompletedRanges
+				// until everything ahead of them has been delivered, and no range is requested more than
+				// mMaxRangesInFlight ahead of the next one to deliver, which bounds the memory used.
+				class StreamInObjectClass : public std::enable_shared_from_this<StreamInObjectClass> {
+				public:
+					//
+					StreamInObjectClass(const S3BucketImplPtr& bucket,
+										const std::string& objectKey,
+										const s3::S3RangedGetOptions& options,
+										const DataReceiverPtr& dataReceiver,
+										const s3::S3CompletionBlockPtr& completion) :
+					mBucket(bucket),
+					mObjectKey(objectKey),
+					mRangeSize(std::max(options.mRangeSize, (uint64_t)1)),
+					mMaxRangesInFlight((uint64_t)std::max(options.mMaxRangesInFlight, 1)),
+					mDataReceiver(dataReceiver),
+					mCompletion(completion),
+					mSizeKnown(false),
+					mObjectSize(0),
+					mRangeCount(1),
+					mNextRangeToRequest(0),
+					mNextRangeToDeliver(0),
+					mRangesInFlight(0),
+					mDelivering(false),
+					mFinished(false),
+					mFailed(false),
+					mFailedResult(s3::S3Result::kUnknown) {
+						encoding::SHA256Init(mSHA256State);
+					}
+					
+					//
+					void Start(const HermitPtr& h_) {
+						{
+							std::lock_guard<std::mutex> lock(mMutex);
+							mNextRangeToRequest = 1;
+							mRangesInFlight = 1;
+						}
+						auto getRange = std::make_shared<GetRangeClass>(mBucket, mObjectKey, 0, 0, mRangeSize, shared_from_this());
+						getRange->GetRangeWithRetry(h_);
+					}
+					
+					//
+					void RangeComplete(const HermitPtr& h_,
+									   uint64_t rangeIndex,
+									   const s3::S3Result& result,
+									   const s3::S3ParamVector& params,
+									   const StringPtr& data) {
+						{
+							std::lock_guard<std::mutex> lock(mMutex);
+							--mRangesInFlight;
+							if (!mFailed) {
+								if ((rangeIndex == 0) && (result == s3::S3Result::k416RequestedRangeNotSatisfiable)) {
+									// nothing to fetch, but the receiver still expects its end of data
+									mSizeKnown = true;
+									mObjectSize = 0;
+									mRangeCount = 1;
+									mCompletedRanges[0] = std::make_shared<std::string>();
+								}
+								else if (result != s3::S3Result::kSuccess) {
+									Fail(result);
+								}
+								else if (rangeIndex == 0) {
+									ProcessFirstRange(h_, params, data);
+								}
+								else if (GetHeaderValue(params, "ETag") != mETag) {
+									NOTIFY_ERROR(h_, "StreamInObject: object changed during download, key:", mObjectKey);
+									Fail(s3::S3Result::kError);
+								}
+								else if (data->size() != RangeSize(rangeIndex)) {
+									NOTIFY_ERROR(h_, "StreamInObject: unexpected range size for key:", mObjectKey,
+												 "expected:", RangeSize(rangeIndex),
+												 "actual:", data->size());
+									Fail(s3::S3Result::kError);
+								}
+								else {
+									mCompletedRanges[rangeIndex] = data;
+								}
+							}
+						}
+						RequestRanges(h_);
+						DeliverRanges(h_);
+						FinishIfDone(h_);
+					}
+					
+					// must be called with mMutex held
+					void ProcessFirstRange(const HermitPtr& h_, const s3::S3ParamVector& params, const StringPtr& data) {
+						mETag = GetHeaderValue(params, "ETag");
+						mSHA256Hex = GetHeaderValue(params, "x-amz-meta-sha256");
+						
+						std::string contentRange(GetHeaderValue(params, "Content-Range"));
+						if (contentRange.empty()) {
+							// the server ignored the range and sent the whole object
+							mSizeKnown = true;
+							mObjectSize = data->size();
+							mRangeCount = 1;
+							mCompletedRanges[0] = data;
+							return;
+						}
+						if (!ParseContentRangeTotal(contentRange, mObjectSize)) {
+							NOTIFY_ERROR(h_, "StreamInObject: unparsed Content-Range:", contentRange);
+							Fail(s3::S3Result::kError);
+							return;
+						}
+						mSizeKnown = true;
+						mRangeCount = std::max((mObjectSize + mRangeSize - 1) / mRangeSize, (uint64_t)1);
+						if (data->size() != RangeSize(0)) {
+							NOTIFY_ERROR(h_, "StreamInObject: unexpected range size for key:", mObjectKey,
+										 "expected:", RangeSize(0),
+										 "actual:", data->size());
+							Fail(s3::S3Result::kError);
+							return;
+						}
+						mCompletedRanges[0] = data;
+					}
+					
+					// must be called with mMutex held
+					uint64_t RangeSize(uint64_t rangeIndex) {
+						uint64_t offset = rangeIndex * mRangeSize;
+						return std::min(mRangeSize, mObjectSize - offset);
+					}
+					
+					// must be called with mMutex held
+					void Fail(const s3::S3Result& result) {
+						if (!mFailed) {
+							mFailed = true;
+							mFailedResult = result;
+							mCompletedRanges.clear();
+						}
+					}
+					
+					//
+					void RequestRanges(const HermitPtr& h_) {
+						std::vector<GetRangeClassPtr> getRanges;
+						{
+							std::lock_guard<std::mutex> lock(mMutex);
+							while (!mFailed &&
+								   mSizeKnown &&
+								   (mNextRangeToRequest < mRangeCount) &&
+								   ((mNextRangeToRequest - mNextRangeToDeliver) < mMaxRangesInFlight)) {
+								getRanges.push_back(std::make_shared<GetRangeClass>(mBucket,
+																					mObjectKey,
+																					mNextRangeToRequest,
+																					mNextRangeToRequest * mRangeSize,
+																					RangeSize(mNextRangeToRequest),
+																					shared_from_this()));
+								++mNextRangeToRequest;
+								++mRangesInFlight;
+							}
+						}
+						for (auto& getRange : getRanges) {
+							getRange->GetRangeWithRetry(h_);
+						}
+					}
+					
+					//
+					void DeliverRanges(const HermitPtr& h_);
+					
+					//
+					void RangeDelivered(const HermitPtr& h_, const StreamDataResult& result) {
+						{
+							std::lock_guard<std::mutex> lock(mMutex);
+							mDelivering = false;
+							++mNextRangeToDeliver;
+							if (result == StreamDataResult::kCanceled) {
+								Fail(s3::S3Result::kCanceled);
+							}
+							else if (result != StreamDataResult::kSuccess) {
+								NOTIFY_ERROR(h_, "StreamInObject: dataReceiver returned an error.");
+								Fail(s3::S3Result::kError);
+							}
+						}
+						RequestRanges(h_);
+						DeliverRanges(h_);
+						FinishIfDone(h_);
+					}
+					
+					//
+					void FinishIfDone(const HermitPtr& h_) {
+						{
+							std::lock_guard<std::mutex> lock(mMutex);
+							if (mFinished || (mRangesInFlight > 0) || mDelivering) {
+								return;
+							}
+							if (!mFailed && (!mSizeKnown || (mNextRangeToDeliver < mRangeCount))) {
+								return;
+							}
+							mFinished = true;
+						}
+						mCompletion->Call(h_, mFailed ? mFailedResult : s3::S3Result::kSuccess);
+					}
+					
+					//
+					S3BucketImplPtr mBucket;
+					std::string mObjectKey;
+					uint64_t mRangeSize;
+					uint64_t mMaxRangesInFlight;
+					DataReceiverPtr mDataReceiver;
+					s3::S3CompletionBlockPtr mCompletion;
+					std::mutex mMutex;
+					bool mSizeKnown;
+					uint64_t mObjectSize;
+					uint64_t mRangeCount;
+					std::string mETag;
+					std::string mSHA256Hex;
+					encoding::SHA256State mSHA256State;
+					uint64_t mNextRangeToRequest;
+					uint64_t mNextRangeToDeliver;
+					uint64_t mRangesInFlight;
+					std::map<uint64_t, StringPtr> mCompletedRanges;
+					bool mDelivering;
+					bool mFinished;
+					bool mFailed;
+					s3::S3Result mFailedResult;
+				};
+				
+				//
+				class DeliverCompletion : public DataCompletion {
+				public:
+					//
+					DeliverCompletion(const StreamInObjectClassPtr& streamIn, const StringPtr& data) :
+					mStreamIn(streamIn),
+					mData(data) {
+					}
+					
+					//
+					virtual void Call(const HermitPtr& h_, const StreamDataResult& result) override {
+						mStreamIn->RangeDelivered(h_, result);
+					}
+					
+					//
+					StreamInObjectClassPtr mStreamIn;
+					StringPtr mData;
+				};
+				
+				//
+				void StreamInObjectClass::DeliverRanges(const HermitPtr& h_) {
+					StringPtr data;
+					bool isEndOfData = false;
+					{
+						std::lock_guard<std::mutex> lock(mMutex);
+						if (mDelivering || mFailed) {
+							return;
+						}
+						auto it = mCompletedRanges.find(mNextRangeToDeliver);
+						if (it == mCompletedRanges.end()) {
+							return;
+						}
+						data = it->second;
+						mCompletedRanges.erase(it);
+						isEndOfData = (mNextRangeToDeliver + 1 == mRangeCount);
+						mDelivering = true;
+					}
+					
+					// ranges are hashed in order as they're delivered (only one delivery is active at a time),
+					// and the last one is held back if the object doesn't match the hash stored at upload time
+					encoding::SHA256ProcessBytes(mSHA256State, data->data(), data->size());
+					if (isEndOfData && !mSHA256Hex.empty()) {
+						char sha256[32];
+						encoding::SHA256Finish(mSHA256State, sha256);
+						std::string sha256Hex;
+						string::BinaryStringToHex(std::string(sha256, 32), sha256Hex);
+						if (sha256Hex != mSHA256Hex) {
+							NOTIFY_ERROR(h_,
+										 "StreamInObject: checksum mismatch for key:", mObjectKey,
+										 "s3 value:", mSHA256Hex,
+										 "local value:", sha256Hex);
+							{
+								std::lock_guard<std::mutex> lock(mMutex);
+								mDelivering = false;
+								Fail(s3::S3Result::kChecksumMismatch);
+							}
+							FinishIfDone(h_);
+							return;
+						}
+					}
+					
+					auto completion = std::make_shared<DeliverCompletion>(shared_from_this(), data);
+					mDataReceiver->Call(h_, DataBuffer(data->data(), data->size()), isEndOfData, completion);
+				}
+				
+				//
+				void GetRangeClass::ProcessResult(const HermitPtr& h_, const s3::S3Result& result, const s3::S3ParamVector& params) {
+					StringPtr data;
+					if (mReceiver != nullptr) {
+						data = mReceiver->mData;
+					}
+					mReceiver = nullptr;
+					mStreamIn->RangeComplete(h_, mRangeIndex, result, params, data);
+				}
+				
+			} // namespace S3BucketImpl_StreamInObject_Impl
+			using namespace S3BucketImpl_StreamInObject_Impl;
+			
+			//
+			void S3BucketImpl::StreamInObject(const HermitPtr& h_,
+											  const std::string& inS3ObjectKey,
+											  const s3::S3RangedGetOptions& inOptions,
+											  const DataReceiverPtr& inDataReceiver,
+											  const s3::S3CompletionBlockPtr& inCompletion) {
+				auto streamIn = std::make_shared<StreamInObjectClass>(shared_from_this(),
+																	  inS3ObjectKey,
+																	  inOptions,
+																	  inDataReceiver,
+																	  inCompletion);
+				streamIn->Start(h_);
+			}
+			
+		} // namespace impl
+	} // namespace s3bucket
+} // namespace hermit
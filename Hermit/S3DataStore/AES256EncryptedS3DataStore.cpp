@@ -26,7 +26,8 @@ namespace hermit {
 															   bool useReducedRedundancyStorage,
 															   const std::string& aesKey) :
 		S3DataStore(bucket, useReducedRedundancyStorage),
-		mAESKey(aesKey) {
+		mAESKey(aesKey),
+		mCompressionCodec(encoding::CompressionCodec::kLZ4) {
 		}
 				
 	} // namespace s3datastore
@@ -20,6 +20,7 @@
 #define AES256EncryptedS3DataStore_h
 
 #include <string>
+#include "Hermit/Encoding/CompressionReceiver.h"
 #include "S3DataStore.h"
 
 namespace hermit {
@@ -49,6 +50,9 @@ namespace hermit {
             
             //
             std::string mAESKey;
+            
+            //	Codec for items written encrypted; kNone leaves them uncompressed. Items load either way.
+            encoding::CompressionCodec mCompressionCodec;
         };
         typedef std::shared_ptr<AES256EncryptedS3DataStore> AES256EncryptedS3DataStorePtr;
         
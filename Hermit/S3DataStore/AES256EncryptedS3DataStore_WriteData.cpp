@@ -16,7 +16,11 @@
 //    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#include <memory.h>
+#include <stdlib.h>
 #include "Hermit/Encoding/AES256EncryptCBC.h"
+#include "Hermit/Encoding/AES256GCMItem.h"
+#include "Hermit/Encoding/CompressedItem.h"
 #include "Hermit/Encoding/CreateInputVector.h"
 #include "Hermit/Foundation/Notification.h"
 #include "AES256EncryptedS3DataStore.h"
@@ -35,9 +39,44 @@ namespace hermit {
 				return;
 			}
 			
-			std::string encryptedS3Data;
 			if (encryptionSetting == datastore::EncryptionSetting::kUnencrypted) {
-				encryptedS3Data.assign(data->Data(), data->Size());
+				S3DataStore::WriteData(h_,
+									   path,
+									   data,
+									   encryptionSetting,
+									   completion);
+				return;
+			}
+			
+			//	Compress ahead of the encryption, which leaves nothing to compress.
+			DataBuffer plainText(data->Data(), data->Size());
+			std::string compressedItem;
+			if (!encoding::CompressItem(h_, plainText, mCompressionCodec, compressedItem)) {
+				NOTIFY_ERROR(h_, "CompressItem failed.");
+				completion->Call(h_, datastore::WriteDataStoreDataResult::kError);
+				return;
+			}
+			if (!compressedItem.empty()) {
+				plainText = DataBuffer(compressedItem.data(), compressedItem.size());
+			}
+			
+			//	Encrypt straight into the buffer that gets written, which takes it over.
+			uint64_t encryptedS3DataSize = 0;
+			char* encryptedS3Data = nullptr;
+			if (encryptionSetting == datastore::EncryptionSetting::kAES256GCM) {
+				encryptedS3DataSize = encoding::AES256GCMItemSize(plainText.second);
+				encryptedS3Data = (char*)malloc(encryptedS3DataSize);
+				if (encryptedS3Data == nullptr) {
+					NOTIFY_ERROR(h_, "malloc failed for size:", encryptedS3DataSize);
+					completion->Call(h_, datastore::WriteDataStoreDataResult::kError);
+					return;
+				}
+				if (!encoding::AES256EncryptGCMItemInto(h_, plainText, mAESKey, encryptedS3Data)) {
+					free(encryptedS3Data);
+					NOTIFY_ERROR(h_, "AES256EncryptGCMItemInto failed.");
+					completion->Call(h_, datastore::WriteDataStoreDataResult::kError);
+					return;
+				}
 			}
 			else {
 				std::string inputVector;
@@ -46,28 +85,33 @@ namespace hermit {
 					completion->Call(h_, datastore::WriteDataStoreDataResult::kError);
 					return;
 				}
-				encoding::AES256EncryptCBCCallbackClass dataCallback;
-				encoding::AES256EncryptCBC(h_,
-										   DataBuffer(data->Data(), data->Size()),
-										   mAESKey,
-										   inputVector,
-										   dataCallback);
 				
-				if (dataCallback.mStatus == encoding::kAES256EncryptCBC_Canceled) {
-					completion->Call(h_, datastore::WriteDataStoreDataResult::kCanceled);
+				encryptedS3DataSize = inputVector.size() + encoding::AES256EncryptCBCSize(plainText.second);
+				encryptedS3Data = (char*)malloc(encryptedS3DataSize);
+				if (encryptedS3Data == nullptr) {
+					NOTIFY_ERROR(h_, "malloc failed for size:", encryptedS3DataSize);
+					completion->Call(h_, datastore::WriteDataStoreDataResult::kError);
 					return;
 				}
-				if (dataCallback.mStatus != encoding::kAES256EncryptCBC_Success) {
-					NOTIFY_ERROR(h_, "AES256EncryptCBC failed.");
+				memcpy(encryptedS3Data, inputVector.data(), inputVector.size());
+				auto status = encoding::AES256EncryptCBCInto(h_,
+															 plainText,
+															 mAESKey,
+															 inputVector,
+															 encryptedS3Data + inputVector.size());
+				if (status != encoding::kAES256EncryptCBC_Success) {
+					free(encryptedS3Data);
+					if (status == encoding::kAES256EncryptCBC_Canceled) {
+						completion->Call(h_, datastore::WriteDataStoreDataResult::kCanceled);
+						return;
+					}
+					NOTIFY_ERROR(h_, "AES256EncryptCBCInto failed.");
 					completion->Call(h_, datastore::WriteDataStoreDataResult::kError);
 					return;
 				}
-				
-				encryptedS3Data = inputVector;
-				encryptedS3Data += dataCallback.mValue;
 			}
 			
-			SharedBufferPtr buffer = std::make_shared<SharedBuffer>(encryptedS3Data);
+			SharedBufferPtr buffer = std::make_shared<SharedBuffer>(encryptedS3Data, encryptedS3DataSize, true);
 			S3DataStore::WriteData(h_,
 								   path,
 								   buffer,
@@ -62,9 +62,43 @@ namespace hermit {
                                     const datastore::DataPathPtr& path,
                                     const datastore::DeleteDataStoreItemCompletionPtr& completion) override;
 			
+			//	WriteItems, LoadItems and ItemsExist issue their single-item requests directly,
+			//	keeping up to options.mMaxConcurrency of them outstanding on the HTTP session.
+			virtual void WriteItems(const HermitPtr& h_,
+									const datastore::DataStoreWriteItemVector& items,
+									const datastore::EncryptionSetting& encryptionSetting,
+									const datastore::DataStoreBatchOptions& options,
+									const datastore::WriteDataStoreItemsItemCallbackPtr& itemCallback,
+									const datastore::DataStoreBatchCompletionPtr& completion) override;
+			
+			//
+			virtual void LoadItems(const HermitPtr& h_,
+								   const datastore::DataPathVector& paths,
+								   const datastore::EncryptionSetting& encryptionSetting,
+								   const datastore::DataStoreBatchOptions& options,
+								   const datastore::LoadDataStoreItemsItemCallbackPtr& itemCallback,
+								   const datastore::DataStoreBatchCompletionPtr& completion) override;
+			
+			//
+			virtual void ItemsExist(const HermitPtr& h_,
+									const datastore::DataPathVector& paths,
+									const datastore::DataStoreBatchOptions& options,
+									const datastore::DataStoreItemsExistItemCallbackPtr& itemCallback,
+									const datastore::DataStoreBatchCompletionPtr& completion) override;
+			
+			//	Sends the paths to the bucket as multi-object deletes of up to
+			//	s3::kS3DeleteObjectsMaxKeys keys each, with up to options.mMaxConcurrency
+			//	requests outstanding.
+			virtual void DeleteItems(const HermitPtr& h_,
+									 const datastore::DataPathVector& paths,
+									 const datastore::DataStoreBatchOptions& options,
+									 const datastore::DeleteDataStoreItemsItemCallbackPtr& itemCallback,
+									 const datastore::DataStoreBatchCompletionPtr& completion) override;
+			
 			//
 			s3bucket::S3BucketPtr mBucket;
 			bool mUseReducedRedundancyStorage;
+			s3::S3MultipartUploadOptions mMultipartUploadOptions;
 		};
 		
 		//
@@ -0,0 +1,235 @@
+//
+//	Hermit
+//	Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//	This program is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include "Hermit/DataStore/DataStoreBatch.h"
+#include "Hermit/Foundation/Notification.h"
+#include "S3DataPath.h"
+#include "S3DataStore.h"
+
+namespace hermit {
+	namespace s3datastore {
+		namespace S3DataStore_BatchItems_Impl {
+			
+			//
+			datastore::DeleteDataStoreItemResult S3ResultToDeleteResult(const s3::S3Result& result) {
+				if (result == s3::S3Result::kSuccess) {
+					return datastore::DeleteDataStoreItemResult::kSuccess;
+				}
+				if (result == s3::S3Result::kCanceled) {
+					return datastore::DeleteDataStoreItemResult::kCanceled;
+				}
+				return datastore::DeleteDataStoreItemResult::kError;
+			}
+			
+			//	Each "item" run by the base class is one multi-object delete request.
+			class DeleteChunksRunner : public datastore::DataStoreBatchRunner {
+				//
+				typedef std::multimap<std::string, datastore::DataPathPtr> KeyPathMap;
+				
+				//
+				struct Chunk {
+					//
+					Chunk() : mHadError(false), mCanceled(false) {
+					}
+					
+					//
+					std::vector<std::string> mKeys;
+					KeyPathMap mUnreportedPaths;
+					bool mHadError;
+					bool mCanceled;
+				};
+				typedef std::shared_ptr<Chunk> ChunkPtr;
+				
+				//
+				typedef std::shared_ptr<DeleteChunksRunner> DeleteChunksRunnerPtr;
+				
+				//
+				class DeletedObjectReporter : public s3::S3DeletedObjectReporter {
+				public:
+					//
+					DeletedObjectReporter(const DeleteChunksRunnerPtr& runner, const ChunkPtr& chunk) :
+					mRunner(runner),
+					mChunk(chunk) {
+					}
+					
+					//
+					virtual void Call(const HermitPtr& h_, const std::string& objectKey, const s3::S3Result& result) override {
+						mRunner->ObjectDeleted(h_, mChunk, objectKey, result);
+					}
+					
+					//
+					DeleteChunksRunnerPtr mRunner;
+					ChunkPtr mChunk;
+				};
+				
+				//
+				class DeleteObjectsCompletion : public s3::S3CompletionBlock {
+				public:
+					//
+					DeleteObjectsCompletion(const DeleteChunksRunnerPtr& runner, const ChunkPtr& chunk) :
+					mRunner(runner),
+					mChunk(chunk) {
+					}
+					
+					//
+					virtual void Call(const HermitPtr& h_, const s3::S3Result& result) override {
+						mRunner->ChunkComplete(h_, mChunk, result);
+					}
+					
+					//
+					DeleteChunksRunnerPtr mRunner;
+					ChunkPtr mChunk;
+				};
+				
+			public:
+				//
+				DeleteChunksRunner(const s3bucket::S3BucketPtr& bucket,
+								   const datastore::DataPathVector& paths,
+								   const datastore::DataStoreBatchOptions& options,
+								   const datastore::DeleteDataStoreItemsItemCallbackPtr& itemCallback,
+								   const datastore::DataStoreBatchCompletionPtr& completion) :
+				DataStoreBatchRunner((paths.size() + s3::kS3DeleteObjectsMaxKeys - 1) / s3::kS3DeleteObjectsMaxKeys,
+									 options,
+									 false,
+									 completion),
+				mBucket(bucket),
+				mPaths(paths),
+				mItemCallback(itemCallback) {
+				}
+				
+				//
+				virtual void StartItem(const HermitPtr& h_, size_t index) override {
+					auto chunk = std::make_shared<Chunk>();
+					size_t first = index * s3::kS3DeleteObjectsMaxKeys;
+					size_t last = std::min(first + s3::kS3DeleteObjectsMaxKeys, mPaths.size());
+					for (size_t n = first; n < last; ++n) {
+						auto& key = static_cast<S3DataPath&>(*mPaths[n]).mPath;
+						chunk->mKeys.push_back(key);
+						chunk->mUnreportedPaths.insert(std::make_pair(key, mPaths[n]));
+					}
+					
+					auto runner = std::static_pointer_cast<DeleteChunksRunner>(shared_from_this());
+					auto reporter = std::make_shared<DeletedObjectReporter>(runner, chunk);
+					auto completion = std::make_shared<DeleteObjectsCompletion>(runner, chunk);
+					mBucket->DeleteObjects(h_, chunk->mKeys, reporter, completion);
+				}
+				
+				//
+				void ObjectDeleted(const HermitPtr& h_, const ChunkPtr& chunk, const std::string& objectKey, const s3::S3Result& result) {
+					auto it = chunk->mUnreportedPaths.find(objectKey);
+					if (it == chunk->mUnreportedPaths.end()) {
+						NOTIFY_ERROR(h_, "S3DataStore::DeleteItems: unexpected key reported:", objectKey);
+						return;
+					}
+					auto path = it->second;
+					chunk->mUnreportedPaths.erase(it);
+					ReportItem(h_, chunk, path, S3ResultToDeleteResult(result));
+				}
+				
+				//	If the request as a whole failed, none of its keys were reported, and they all
+				//	take its result.
+				void ChunkComplete(const HermitPtr& h_, const ChunkPtr& chunk, const s3::S3Result& result) {
+					auto itemResult = S3ResultToDeleteResult(result);
+					if ((itemResult == datastore::DeleteDataStoreItemResult::kSuccess) && !chunk->mUnreportedPaths.empty()) {
+						NOTIFY_ERROR(h_, "S3DataStore::DeleteItems: keys missing from result:", chunk->mUnreportedPaths.size());
+						itemResult = datastore::DeleteDataStoreItemResult::kError;
+					}
+					for (auto it = begin(chunk->mUnreportedPaths); it != end(chunk->mUnreportedPaths); ++it) {
+						ReportItem(h_, chunk, it->second, itemResult);
+					}
+					chunk->mUnreportedPaths.clear();
+					
+					auto chunkResult = datastore::DataStoreBatchResult::kSuccess;
+					if (chunk->mCanceled) {
+						chunkResult = datastore::DataStoreBatchResult::kCanceled;
+					}
+					else if (chunk->mHadError) {
+						chunkResult = datastore::DataStoreBatchResult::kError;
+					}
+					ItemComplete(h_, chunkResult);
+				}
+				
+				//
+				void ReportItem(const HermitPtr& h_,
+								const ChunkPtr& chunk,
+								const datastore::DataPathPtr& path,
+								const datastore::DeleteDataStoreItemResult& result) {
+					if (result == datastore::DeleteDataStoreItemResult::kCanceled) {
+						chunk->mCanceled = true;
+					}
+					else if (result != datastore::DeleteDataStoreItemResult::kSuccess) {
+						chunk->mHadError = true;
+					}
+					std::lock_guard<std::mutex> lock(mCallbackMutex);
+					mItemCallback->Call(h_, path, result);
+				}
+				
+				//
+				s3bucket::S3BucketPtr mBucket;
+				datastore::DataPathVector mPaths;
+				datastore::DeleteDataStoreItemsItemCallbackPtr mItemCallback;
+			};
+			
+		} // namespace S3DataStore_BatchItems_Impl
+		using namespace S3DataStore_BatchItems_Impl;
+		
+		//
+		void S3DataStore::WriteItems(const HermitPtr& h_,
+									 const datastore::DataStoreWriteItemVector& items,
+									 const datastore::EncryptionSetting& encryptionSetting,
+									 const datastore::DataStoreBatchOptions& options,
+									 const datastore::WriteDataStoreItemsItemCallbackPtr& itemCallback,
+									 const datastore::DataStoreBatchCompletionPtr& completion) {
+			datastore::WriteDataStoreItems(h_, *this, items, encryptionSetting, options, false, itemCallback, completion);
+		}
+		
+		//
+		void S3DataStore::LoadItems(const HermitPtr& h_,
+									const datastore::DataPathVector& paths,
+									const datastore::EncryptionSetting& encryptionSetting,
+									const datastore::DataStoreBatchOptions& options,
+									const datastore::LoadDataStoreItemsItemCallbackPtr& itemCallback,
+									const datastore::DataStoreBatchCompletionPtr& completion) {
+			datastore::LoadDataStoreItems(h_, *this, paths, encryptionSetting, options, false, itemCallback, completion);
+		}
+		
+		//
+		void S3DataStore::ItemsExist(const HermitPtr& h_,
+									 const datastore::DataPathVector& paths,
+									 const datastore::DataStoreBatchOptions& options,
+									 const datastore::DataStoreItemsExistItemCallbackPtr& itemCallback,
+									 const datastore::DataStoreBatchCompletionPtr& completion) {
+			datastore::DataStoreItemsExist(h_, *this, paths, options, false, itemCallback, completion);
+		}
+		
+		//
+		void S3DataStore::DeleteItems(const HermitPtr& h_,
+									  const datastore::DataPathVector& paths,
+									  const datastore::DataStoreBatchOptions& options,
+									  const datastore::DeleteDataStoreItemsItemCallbackPtr& itemCallback,
+									  const datastore::DataStoreBatchCompletionPtr& completion) {
+			auto runner = std::make_shared<DeleteChunksRunner>(mBucket, paths, options, itemCallback, completion);
+			runner->Start(h_);
+		}
+		
+	} // namespace s3datastore
+} // namespace hermit
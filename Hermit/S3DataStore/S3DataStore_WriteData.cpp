@@ -106,6 +106,7 @@ namespace hermit {
 							   dataPath.mPath,
 							   data,
 							   mUseReducedRedundancyStorage,
+							   mMultipartUploadOptions,
 							   putCompletion);
         }
         
@@ -0,0 +1,43 @@
+//
+//    Hermit
+//    Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef AES256Baseline_h
+#define AES256Baseline_h
+
+#include "Hermit/Encoding/AES256.h"
+
+//	The pre-table AES-256 implementation, one block at a time, for comparison with AES256Cipher.
+
+namespace aes256baseline {
+	
+	//
+	void KeyExpansion(const hermit::encoding::AESKey& inKey, hermit::encoding::AESKeySchedule& outKeySchedule);
+	
+	//
+	void Encode(const hermit::encoding::AESBlock& inInput,
+				const hermit::encoding::AESKeySchedule& inKeySchedule,
+				hermit::encoding::AESBlock& outResult);
+	
+	//
+	void Decode(const hermit::encoding::AESBlock& inInput,
+				const hermit::encoding::AESKeySchedule& inKeySchedule,
+				hermit::encoding::AESBlock& outResult);
+	
+} // namespace aes256baseline
+
+#endif /* AES256Baseline_h */
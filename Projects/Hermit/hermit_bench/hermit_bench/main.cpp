@@ -0,0 +1,293 @@
+//
+//    Hermit
+//    Copyright (C) 2018 Paul Young (aka peymojo)
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "Hermit/Encoding/AES256.h"
+#include "Hermit/Encoding/SHA256.h"
+#include "Hermit/Foundation/AsyncTaskQueue.h"
+#include "AES256Baseline.h"
+
+//	Throughput of the hashing and encryption paths, one line per engine and buffer size, so
+//	that changes to them can be measured on the machines they ship to. Engines the CPU can't
+//	run are reported as skipped.
+
+namespace {
+	
+	//
+	const std::uint64_t kBytesPerRun = 256 * 1024 * 1024;
+	
+	//	The byte-wise baseline is slow enough that a full run would dominate the bench.
+	const std::uint64_t kBaselineBytesPerRun = 16 * 1024 * 1024;
+	
+	//
+	typedef std::chrono::steady_clock Clock;
+	
+	//
+	double MegabytesPerSecond(std::uint64_t bytes, const Clock::time_point& start) {
+		std::chrono::duration<double> elapsed = Clock::now() - start;
+		return (bytes / (1024.0 * 1024.0)) / elapsed.count();
+	}
+	
+	//
+	std::string SizeString(std::uint64_t size) {
+		if (size >= 1024 * 1024) {
+			return std::to_string(size / (1024 * 1024)) + "MB";
+		}
+		if (size >= 1024) {
+			return std::to_string(size / 1024) + "KB";
+		}
+		return std::to_string(size) + "B";
+	}
+	
+	//
+	const char* SHA256EngineName(hermit::encoding::SHA256Engine engine) {
+		switch (engine) {
+			case hermit::encoding::SHA256Engine::kScalar:
+				return "scalar";
+			case hermit::encoding::SHA256Engine::kSHAExtensions:
+				return "SHA extensions";
+			case hermit::encoding::SHA256Engine::kAVX2MultiBuffer:
+				return "AVX2 multi-buffer";
+			default:
+				return "auto";
+		}
+	}
+	
+	//	Hashes kBytesPerRun bytes, bufferSize at a time, as one stream per buffer.
+	void BenchSHA256(hermit::encoding::SHA256Engine engine, std::uint64_t bufferSize) {
+		std::vector<char> data(bufferSize, 0x5a);
+		std::uint8_t digest[32];
+		std::uint64_t runs = kBytesPerRun / bufferSize;
+		auto start = Clock::now();
+		for (std::uint64_t n = 0; n < runs; ++n) {
+			hermit::encoding::CalculateSHA256(data.data(), bufferSize, digest);
+		}
+		printf("SHA-256 %-18s %8s  %10.1f MB/s\n",
+			   SHA256EngineName(engine),
+			   SizeString(bufferSize).c_str(),
+			   MegabytesPerSecond(runs * bufferSize, start));
+	}
+	
+	//	Hashes kBytesPerRun bytes as batches of streamCount buffers of bufferSize each.
+	void BenchSHA256Multi(hermit::encoding::SHA256Engine engine, std::uint64_t bufferSize, std::size_t streamCount) {
+		std::vector<std::vector<char>> buffers(streamCount, std::vector<char>(bufferSize, 0x5a));
+		std::vector<const char*> data;
+		std::vector<std::uint64_t> sizes(streamCount, bufferSize);
+		std::vector<std::vector<std::uint8_t>> digests(streamCount, std::vector<std::uint8_t>(32));
+		std::vector<void*> results;
+		for (std::size_t n = 0; n < streamCount; ++n) {
+			data.push_back(buffers[n].data());
+			results.push_back(digests[n].data());
+		}
+		std::uint64_t runs = kBytesPerRun / (bufferSize * streamCount);
+		auto start = Clock::now();
+		for (std::uint64_t n = 0; n < runs; ++n) {
+			hermit::encoding::CalculateSHA256Multi(data.data(), sizes.data(), streamCount, results.data());
+		}
+		printf("SHA-256 %-18s %8s  %10.1f MB/s (%d streams)\n",
+			   SHA256EngineName(engine),
+			   SizeString(bufferSize).c_str(),
+			   MegabytesPerSecond(runs * bufferSize * streamCount, start),
+			   (int)streamCount);
+	}
+	
+	//
+	void BenchSHA256Engines() {
+		const std::uint64_t kSizes[] = { 64, 1024, 64 * 1024, 1024 * 1024 };
+		const hermit::encoding::SHA256Engine kEngines[] = {
+			hermit::encoding::SHA256Engine::kScalar,
+			hermit::encoding::SHA256Engine::kSHAExtensions
+		};
+		for (auto engine : kEngines) {
+			if (!hermit::encoding::SetSHA256Engine(engine)) {
+				printf("SHA-256 %-18s skipped, not supported by this CPU\n", SHA256EngineName(engine));
+				continue;
+			}
+			for (auto size : kSizes) {
+				BenchSHA256(engine, size);
+			}
+		}
+		
+		const hermit::encoding::SHA256Engine kMultiEngines[] = {
+			hermit::encoding::SHA256Engine::kScalar,
+			hermit::encoding::SHA256Engine::kAVX2MultiBuffer
+		};
+		for (auto engine : kMultiEngines) {
+			if (!hermit::encoding::SetSHA256Engine(engine)) {
+				printf("SHA-256 %-18s skipped, not supported by this CPU\n", SHA256EngineName(engine));
+				continue;
+			}
+			BenchSHA256Multi(engine, 1024 * 1024, 8);
+		}
+		hermit::encoding::SetSHA256Engine(hermit::encoding::SHA256Engine::kAuto);
+	}
+	
+	//
+	enum class AESMode {
+		kEncryptECB,
+		kEncryptCBC,
+		kDecryptCBC,
+		kDecryptCBCParallel
+	};
+	
+	//
+	const char* AESModeName(AESMode mode) {
+		switch (mode) {
+			case AESMode::kEncryptECB:
+				return "ECB encrypt";
+			case AESMode::kEncryptCBC:
+				return "CBC encrypt";
+			case AESMode::kDecryptCBC:
+				return "CBC decrypt";
+			default:
+				return "CBC decrypt parallel";
+		}
+	}
+	
+	//	Runs kBytesPerRun bytes through the cipher, bufferSize at a time.
+	void BenchAES256(const hermit::encoding::AES256Cipher& cipher, AESMode mode, std::uint64_t bufferSize) {
+		std::vector<std::uint8_t> input(bufferSize, 0x5a);
+		std::vector<std::uint8_t> output(bufferSize);
+		size_t blockCount = bufferSize / 16;
+		hermit::encoding::AESBlock chain = {};
+		std::uint64_t runs = kBytesPerRun / bufferSize;
+		auto start = Clock::now();
+		for (std::uint64_t n = 0; n < runs; ++n) {
+			switch (mode) {
+				case AESMode::kEncryptECB:
+					cipher.EncryptBlocks(input.data(), output.data(), blockCount);
+					break;
+				case AESMode::kEncryptCBC:
+					cipher.EncryptBlocksCBC(chain, input.data(), output.data(), blockCount);
+					break;
+				case AESMode::kDecryptCBC:
+					cipher.DecryptBlocksCBC(chain, input.data(), output.data(), blockCount);
+					break;
+				case AESMode::kDecryptCBCParallel:
+					cipher.DecryptBlocksCBCParallel(chain, input.data(), output.data(), blockCount);
+					break;
+			}
+		}
+		printf("AES-256 %-8s %-21s %8s  %10.1f MB/s\n",
+			   cipher.UsesAESNI() ? "AES-NI" : "tables",
+			   AESModeName(mode),
+			   SizeString(bufferSize).c_str(),
+			   MegabytesPerSecond(runs * bufferSize, start));
+	}
+	
+	//	Runs kBaselineBytesPerRun bytes through the pre-table implementation, bufferSize at a
+	//	time, chaining CBC blocks the way AES256EncryptCBC and AES256DecryptCBC used to.
+	void BenchAES256Baseline(const hermit::encoding::AESKeySchedule& keySchedule,
+							 AESMode mode,
+							 std::uint64_t bufferSize) {
+		std::vector<std::uint8_t> input(bufferSize, 0x5a);
+		std::vector<std::uint8_t> output(bufferSize);
+		size_t blockCount = bufferSize / 16;
+		hermit::encoding::AESBlock chain = {};
+		std::uint64_t runs = kBaselineBytesPerRun / bufferSize;
+		auto start = Clock::now();
+		for (std::uint64_t n = 0; n < runs; ++n) {
+			for (size_t b = 0; b < blockCount; ++b) {
+				hermit::encoding::AESBlock block;
+				memcpy(block.bytes, input.data() + b * 16, 16);
+				hermit::encoding::AESBlock result;
+				switch (mode) {
+					case AESMode::kEncryptCBC:
+						for (int i = 0; i < 16; ++i) {
+							block.bytes[i] ^= chain.bytes[i];
+						}
+						aes256baseline::Encode(block, keySchedule, result);
+						chain = result;
+						break;
+					case AESMode::kDecryptCBC:
+						aes256baseline::Decode(block, keySchedule, result);
+						for (int i = 0; i < 16; ++i) {
+							result.bytes[i] ^= chain.bytes[i];
+						}
+						chain = block;
+						break;
+					default:
+						aes256baseline::Encode(block, keySchedule, result);
+						break;
+				}
+				memcpy(output.data() + b * 16, result.bytes, 16);
+			}
+		}
+		printf("AES-256 %-8s %-21s %8s  %10.1f MB/s\n",
+			   "baseline",
+			   AESModeName(mode),
+			   SizeString(bufferSize).c_str(),
+			   MegabytesPerSecond(runs * bufferSize, start));
+	}
+	
+	//
+	void BenchAES256Engines() {
+		hermit::encoding::AESKey key;
+		for (int n = 0; n < 32; ++n) {
+			key.bytes[n] = (std::uint8_t)n;
+		}
+		hermit::encoding::AES256Cipher cipher(key);
+		
+		const std::uint64_t kSizes[] = { 4 * 1024, 1024 * 1024, 16 * 1024 * 1024 };
+		
+		//	The old code had no parallel decrypt, so the baseline covers the serial modes only.
+		hermit::encoding::AESKeySchedule keySchedule;
+		aes256baseline::KeyExpansion(key, keySchedule);
+		const AESMode kBaselineModes[] = {
+			AESMode::kEncryptECB,
+			AESMode::kEncryptCBC,
+			AESMode::kDecryptCBC
+		};
+		for (auto mode : kBaselineModes) {
+			for (auto size : kSizes) {
+				BenchAES256Baseline(keySchedule, mode, size);
+			}
+		}
+		
+		const AESMode kModes[] = {
+			AESMode::kEncryptECB,
+			AESMode::kEncryptCBC,
+			AESMode::kDecryptCBC,
+			AESMode::kDecryptCBCParallel
+		};
+		for (bool useAESNI : { false, true }) {
+			if (!cipher.SetUsesAESNI(useAESNI)) {
+				printf("AES-256 AES-NI skipped, not supported by this CPU\n");
+				continue;
+			}
+			for (auto mode : kModes) {
+				for (auto size : kSizes) {
+					BenchAES256(cipher, mode, size);
+				}
+			}
+		}
+	}
+	
+} // private namespace
+
+int main(int argc, const char * argv[]) {
+	BenchSHA256Engines();
+	BenchAES256Engines();
+	hermit::ShutdownAsyncTaskQueue();
+	return 0;
+}